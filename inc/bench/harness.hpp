@@ -0,0 +1,181 @@
+/**
+ *
+ * @file      bench/harness.hpp
+ *
+ * @brief     This is the VPP micro-benchmark harness description file
+ *
+ * @details   The harness times the micro-benchmarks registered with the BENCH
+ *            macro, each of them once per set of arguments (e.g. a resolution
+ *            or a number of zones) so that the scaling curves of the kernels
+ *            show up. The number of iterations of a run doubles until the run
+ *            lasts long enough, and the synthetic inputs are generated from a
+ *            fixed seed so that the runs can be compared with one another.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+
+#include "vpp/scene.hpp"
+#include "vpp/util/allocation.hpp"
+
+namespace Bench {
+
+using Clock = std::chrono::steady_clock;
+
+class State final {
+    public:
+        State(const std::vector<int> &args, uint64_t iterations) noexcept;
+        ~State() noexcept = default;
+
+        /* The arguments of the run */
+        inline int arg(std::size_t i) const noexcept {
+            return arguments[i];
+        }
+
+        /* Timing the body of the loop: while (state.running()) { ... } */
+        inline bool running() noexcept {
+            if (done == 0) {
+                before = Util::Allocation::thread();
+                began  = Clock::now();
+            }
+            if (done++ < wanted) {
+                return true;
+            }
+            ended = Clock::now();
+            spent = Util::Allocation::since(before);
+            return false;
+        }
+
+        /* Excluding the per-iteration setup of the inputs from the timing */
+        inline void pause() noexcept {
+            paused = Clock::now();
+            halted = Util::Allocation::thread();
+        }
+
+        inline void resume() noexcept {
+            excluded += Clock::now() - paused;
+            auto setup = Util::Allocation::since(halted);
+            skipped.allocations += setup.allocations;
+            skipped.bytes       += setup.bytes;
+        }
+
+        /* The items (pixels, zones, pairs...) processed by each iteration */
+        inline void items(uint64_t n) noexcept {
+            processed = n;
+        }
+
+        uint64_t iterations() const noexcept;
+        Clock::duration elapsed() const noexcept;
+
+        /* The heap allocations of the timed loop, if they are tracked */
+        Util::Allocation::Counters allocated() const noexcept;
+
+        inline uint64_t items() const noexcept {
+            return processed;
+        }
+
+    private:
+        const std::vector<int> &arguments;
+        const uint64_t          wanted;
+        uint64_t                done;
+        uint64_t                processed;
+        Clock::time_point       began;
+        Clock::time_point       ended;
+        Clock::time_point       paused;
+        Clock::duration         excluded;
+
+        /* The heap allocations of the loop and of its excluded setups */
+        Util::Allocation::Counters before;
+        Util::Allocation::Counters halted;
+        Util::Allocation::Counters spent;
+        Util::Allocation::Counters skipped;
+};
+
+using Function = std::function<void (State &)>;
+
+class Case final {
+    public:
+        Case(std::string n, Function f) noexcept;
+        ~Case() noexcept = default;
+
+        /* Adding a run with a given set of arguments */
+        Case &with(std::vector<int> args) noexcept;
+
+        /* Adding one run per standard resolution, as (width, height) */
+        Case &resolutions() noexcept;
+
+        /* Adding one run per count, e.g. of zones */
+        Case &counts(const std::vector<int> &ns) noexcept;
+
+        const std::string             name;
+        const Function                function;
+        std::vector<std::vector<int>> runs;
+};
+
+class Registry final {
+    public:
+        static Registry &instance() noexcept;
+
+        Case &add(std::string name, Function f) noexcept;
+
+        /* Running the cases whose name contains the filter for at least the
+         * minimal time per run, printing a table or CSV lines */
+        int run(const std::string &filter, Clock::duration minimal,
+                bool csv) noexcept;
+
+    private:
+        Registry() noexcept;
+
+        std::vector<std::unique_ptr<Case>> cases;
+};
+
+/* Preventing the compiler from optimising a result away */
+template <typename T> inline void keep(T &&value) noexcept {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+/* The synthetic inputs, always the same for a given seed */
+namespace Synthetic {
+
+/* A textured BGR frame of some blurred noise */
+cv::Mat frame(int width, int height, uint64_t seed = 0) noexcept;
+
+/* A 16-bit depth map in millimetres, with some holes */
+cv::Mat depth(int width, int height, uint64_t seed = 0) noexcept;
+
+/* The boxes of some zones lying within a frame */
+std::vector<cv::Rect> boxes(int count, const cv::Size &frame,
+                            uint64_t seed = 0) noexcept;
+
+/* A scene viewing a frame with some zones marked in it */
+void scene(VPP::Scene &scene, int width, int height, int zones,
+           uint64_t seed = 0) noexcept;
+
+}  // namespace Synthetic
+
+}  // namespace Bench
+
+#define BENCH_CONCAT_(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_(a, b)
+
+/* Registering a benchmark function, the runs being added to the returned case,
+ * e.g. BENCH(scene_mark).counts({ 16, 256 }); */
+#define BENCH(fn)                                                   \
+    static Bench::Case & BENCH_CONCAT(bench_, __LINE__)             \
+        __attribute__((unused)) = Bench::Registry::instance().add(#fn, fn)
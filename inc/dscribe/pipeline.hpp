@@ -8,7 +8,9 @@
  *            of multi-level visual pipelines. It is composed of a primary
  *            freezable pipeline aimed at capturing and processing images at a
  *            scene as well as some capacities to make deferred processing on
- *            dedicated zone-level pipelines.
+ *            dedicated zone-level pipelines. A server runs several streams of
+ *            these pipelines in a single process, sharing their workers, their
+ *            metrics endpoint and their networks.
  *
  *            This file is part of the VPP framework (see link).
  *
@@ -22,20 +24,36 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <string>
 
 #include "customisation/configuration.hpp"
 #include "customisation/entity.hpp"
+#include "vpp/governor.hpp"
+#include "vpp/metrics.hpp"
 #include "vpp/pipeline.hpp"
+#include "vpp/scheduler.hpp"
 #include "vpp/stage/blur.hpp"
+#include "vpp/stage/cache.hpp"
 #include "vpp/stage/clustering.hpp"
+#include "vpp/stage/culling.hpp"
 #include "vpp/stage/dnn.hpp"
 #include "vpp/stage/input.hpp"
+#include "vpp/stage/motion.hpp"
 #include "vpp/stage/ocr/edging.hpp"
 #include "vpp/stage/ocr/mser.hpp"
 #include "vpp/stage/ocr/reader.hpp"
 #include "vpp/stage/overlay.hpp"
+#include "vpp/stage/publisher.hpp"
+#include "vpp/stage/reid.hpp"
+#include "vpp/stage/sharing.hpp"
+#include "vpp/stage/stillness.hpp"
+#include "vpp/stage/streamer.hpp"
 #include "vpp/stage/tracker.hpp"
+#include "vpp/task.hpp"
+#include "vpp/tracer.hpp"
 
 namespace DScribe {
 
@@ -48,13 +66,20 @@ class Core : public Parametrisable {
 
                 VPP::Stage::Input<>           input;
                 VPP::Stage::Input<>           depth;
+                VPP::Stage::Stillness         stillness;
                 VPP::Stage::Blur              blur;
+                VPP::Stage::Motion            motion;
                 VPP::Stage::DNN::Detector     detector;
                 VPP::Stage::Clustering        clustering;
+                VPP::Stage::Culling           culling;
+                VPP::Stage::Reid              reid;
                 VPP::Stage::Tracker           tracker;
                 VPP::Stage::OCR::MSER         mser;
                 VPP::Stage::OCR::Edging       edging;
+                VPP::Stage::Publisher         publish;
                 VPP::Stage::Overlay::ForScene overlay;
+                VPP::Stage::Streamer          stream;
+                VPP::Stage::Sharing           share;
         };
 
         class Classification : public VPP::Pipeline::ForZone {
@@ -62,9 +87,14 @@ class Core : public Parametrisable {
                 Classification() noexcept;
                 ~Classification() noexcept = default;
 
+                /* Must be before the stages using it */
+                VPP::Engine::Cache::Store    cache;
+
                 VPP::Stage::Input<VPP::Zone> input;
+                VPP::Stage::Cache::Lookup    lookup;
                 VPP::Stage::DNN::Classifier  classifier;
                 VPP::Stage::OCR::Reader      ocr;
+                VPP::Stage::Cache::Record    record;
                 VPP::Stage::Overlay::ForZone overlay;
         };
 
@@ -80,9 +110,97 @@ class Core : public Parametrisable {
         /* Must be first in the list */
         Customisation::Configuration configuration;
 
+        /* The workers running all the asynchronous tasks */
+        VPP::Task::Pool              pool;
+
+        /* The recorder of the timeline of all the threads */
+        VPP::Tracer                  tracer;
+
+        /* The endpoint serving the metrics of all the pipelines */
+        VPP::Metrics                 metrics;
+
+        /* The controller of the detection resolution */
+        VPP::Governor                governor;
+
         /* The two pipelines */
         Detection                    detection;
         Classification               classification;
 };
 
+class Stream : public Parametrisable {
+    public:
+        Stream() noexcept;
+
+        /** DScribe streams cannot be copied nor moved */
+        Stream(const Stream& other) = delete;
+        Stream(Stream&& other) = delete;
+        Stream& operator=(const Stream& other) = delete;
+        Stream& operator=(Stream&& other) = delete;
+        virtual ~Stream() noexcept = default;
+
+        /* Adding or removing the stream at runtime is starting or stopping
+         * both of its pipelines */
+        PARAMETER(Direct, None, Callable, bool) enabled;
+
+        /* The share of the workers of the server of this stream, which is
+         * only admitted if the workers can afford it */
+        VPP::Scheduler::Stream       schedule;
+
+        /* The controller of the detection resolution of this stream */
+        VPP::Governor                governor;
+
+        /* The two pipelines of the stream */
+        Core::Detection              detection;
+        Core::Classification         classification;
+
+    private:
+        Customisation::Error onEnabledUpdate(bool yes) noexcept;
+
+        /* The estimated cost of a detected scene in nanoseconds */
+        uint64_t cost() const noexcept;
+
+        /* Applying the largest decimation and the combined scale to the
+         * detector, at the safe points of the detection only */
+        void decimate() noexcept;
+        void rescale() noexcept;
+
+        /* The scales and the decimations of the detection set by the
+         * governor and by the scheduler, which are combined */
+        std::atomic<float>           governed;
+        std::atomic<float>           scheduled;
+        std::atomic<int>             thinned;
+        std::atomic<int>             paced;
+};
+
+class Server : public Parametrisable {
+    public:
+        static constexpr int MAX = 16;
+
+        Server() noexcept;
+
+        /** DScribe servers cannot be copied nor moved */
+        Server(const Server& other) = delete;
+        Server(Server&& other) = delete;
+        Server& operator=(const Server& other) = delete;
+        Server& operator=(Server&& other) = delete;
+        virtual ~Server() noexcept = default;
+
+        /* Must be first in the list */
+        Customisation::Configuration configuration;
+
+        /* The workers, the timeline recorder and the metrics endpoint shared
+         * by all the streams, whose engines also share the networks loaded
+         * with the same files and the batched inference services */
+        VPP::Task::Pool              pool;
+        VPP::Tracer                  tracer;
+        VPP::Metrics                 metrics;
+
+        /* The scheduler sharing the workers fairly between the streams */
+        VPP::Scheduler               scheduler;
+
+        /* The streams left disabled are not running, e.g. set stream3.enabled
+         * yes once its input is set up */
+        std::array<Stream, MAX>      stream;
+};
+
 } // namespace DScribe
@@ -0,0 +1,97 @@
+/**
+ *
+ * @file      dscribe/reload.hpp
+ *
+ * @brief     This is the d-scribe live configuration reload description
+ *
+ * @details   A live reload applies the changes of a script of set commands to
+ *            running pipelines without tearing them down: only the settings
+ *            differing from the ones applied before are set. The hot ones,
+ *            e.g. the thresholds or the decimation of the detection, are set
+ *            at the safe point between two frames of their pipeline, whereas
+ *            the cold ones, i.e. the ones loading a network, a model or a
+ *            dataset, are first loaded in the background by the engines of a
+ *            spare core, side by side with the running ones, so that the
+ *            running engines only attach to the loaded networks when they get
+ *            set at the safe point. The spare core only gets the settings of
+ *            the engines owning the cold changes, and never runs nor captures
+ *            anything.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "dscribe/pipeline.hpp"
+#include "dscribe/sweep.hpp"
+
+namespace DScribe {
+namespace Reload {
+
+/* A setting is a list of parameters and their values */
+using Setting = Sweep::Setting;
+
+/* Reading the set commands of a script, the last value of a parameter being
+ * the one kept, false if the script cannot be read */
+bool read(const std::string &path, Setting &setting) noexcept;
+
+/* The parameters of the loaded setting which are not in the applied one or
+ * which have another value there */
+Setting diff(const Setting &applied, const Setting &loaded) noexcept;
+
+/* Is a parameter cold, i.e. loading a network, a model or a dataset ? */
+bool cold(const std::string &parameter) noexcept;
+
+class Reloader final {
+    public:
+        explicit Reloader(Core &core) noexcept;
+        ~Reloader() noexcept;
+
+        /** Reloaders cannot be copied nor moved */
+        Reloader(const Reloader& other) = delete;
+        Reloader(Reloader&& other) = delete;
+        Reloader& operator=(const Reloader& other) = delete;
+        Reloader& operator=(Reloader&& other) = delete;
+
+        /* Applying the settings of a script changed since the previous
+         * reload, all of them being applied right away on the first one,
+         * false if the script cannot be read or applied */
+        bool reload(const std::string &path) noexcept;
+
+        /* Reloading a script whenever it gets modified, as polled every
+         * second */
+        void watch(const std::string &path) noexcept;
+
+    private:
+        /* Applying the hot settings at the safe point of their pipelines,
+         * and the ones of no pipeline right away */
+        bool defer(const Setting &hot) noexcept;
+
+        /* Loading the cold settings in the background before deferring
+         * them */
+        void load(const Setting &cold) noexcept;
+
+        Core                    &core;
+        Setting                  applied;
+        std::future<void>        loading;
+        std::thread              watcher;
+        bool                     watching;
+        std::condition_variable  wake;
+        std::mutex               poll;
+};
+
+}  // namespace Reload
+}  // namespace DScribe
@@ -0,0 +1,115 @@
+/**
+ *
+ * @file      dscribe/sweep.hpp
+ *
+ * @brief     This is the d-scribe accuracy versus latency sweep description
+ *
+ * @details   A sweep runs the headless benchmark over a grid of parameter
+ *            settings, replaying the same annotated recording for each of
+ *            them, and reports the throughput, the latency percentiles and the
+ *            accuracy of every setting in a table marking the Pareto-optimal
+ *            ones, i.e. the settings no other setting is both faster and more
+ *            accurate than.
+ *
+ *            The grid lists a parameter and its values per line, e.g.
+ *            "detection.detector.every 1 2 4", the settings being all the
+ *            combinations of the values. The annotations list a ground truth
+ *            box per line, as "<timestamp in ms> <id> <x> <y> <width>
+ *            <height>" in the pixels of the recorded frames.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "vpp/scene.hpp"
+
+namespace DScribe {
+namespace Sweep {
+
+/* A setting is a list of parameters and their values */
+using Setting = std::vector<std::pair<std::string, std::string>>;
+
+/* Reading the settings of a grid file, false if it cannot be read or holds
+ * a parameter without any value */
+bool grid(const std::string &path, std::vector<Setting> &settings) noexcept;
+
+/* The script applying a setting with the CLI set commands */
+std::string script(const Setting &setting) noexcept;
+
+/* The accuracy of a run: the average precision of the detections at an IoU
+ * of 0.5, and the MOTA and IDF1 of the tracks */
+struct Accuracy {
+    double   map;
+    double   mota;
+    double   idf1;
+    uint64_t frames;
+};
+
+class Scorer final {
+    public:
+        /* A box of a frame, either annotated or detected */
+        struct Box {
+            cv::Rect rect;
+            uint64_t id;
+            float    score;
+        };
+
+        Scorer() noexcept;
+        ~Scorer() noexcept = default;
+
+        /* Loading the annotations, false if they cannot be read */
+        bool load(const std::string &path) noexcept;
+
+        inline bool empty() const noexcept {
+            return truth.empty();
+        }
+
+        /* Forgetting the detections of the previous run */
+        void reset() noexcept;
+
+        /* Keeping the zones of an annotated scene */
+        void observe(const VPP::Scene &scene) noexcept;
+
+        /* The accuracy of the observed scenes against all the annotations,
+         * the annotated frames never observed counting as missed */
+        Accuracy score() const noexcept;
+
+    private:
+        std::map<uint64_t, std::vector<Box>> truth;
+        std::map<uint64_t, std::vector<Box>> detected;
+};
+
+/* The figures of the run of a setting */
+struct Result {
+    Setting  setting;
+    uint64_t frames;
+    double   fps;
+    double   p50, p99;
+    Accuracy accuracy;
+    bool     scored;
+    bool     optimal;
+};
+
+/* Marking the results no other result is better than on every figure */
+void pareto(std::vector<Result> &results) noexcept;
+
+/* The table of the results, either aligned for reading or as CSV */
+std::string table(const std::vector<Result> &results, bool csv) noexcept;
+
+}  // namespace Sweep
+}  // namespace DScribe
@@ -0,0 +1,153 @@
+/**
+ *
+ * @file      vpp/contour.hpp
+ *
+ * @brief     This is the VPP contour description file
+ *
+ * @details   This file describes the contours of the zones, as immutable spans
+ *            of points sharing their storage through reference counting, so
+ *            that copying a zone never copies its contour points. The points
+ *            are either owned by the contour itself or stored in the blocks of
+ *            an arena, such as the one of a scene, for the contours of a frame
+ *            to need a handful of allocations rather than one each. A block
+ *            is released with the last contour referencing it.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+namespace VPP {
+
+class Contour final {
+    public:
+        /* An arena of contour points, made of blocks that are never moved nor
+         * reallocated, for the stored contours to remain valid whilst other
+         * contours are stored in a thread-safe way */
+        class Arena final {
+            public:
+                explicit Arena(std::size_t chunk = 4096) noexcept;
+                ~Arena() noexcept = default;
+
+                /* Arenas cannot be copied, but moved for the scenes */
+                Arena(const Arena& other) = delete;
+                Arena(Arena&& other) noexcept;
+                Arena& operator=(const Arena& other) = delete;
+                Arena& operator=(Arena&& other) noexcept;
+
+                /* Storing a copy of some points into the arena */
+                Contour store(const cv::Point *points, std::size_t n) noexcept;
+                inline Contour store(const std::vector<cv::Point> &points)
+                    noexcept {
+                    return store(points.data(), points.size());
+                }
+
+                /* Starting a new block for the next stored contours, the
+                 * former block being released with its last contour */
+                void reset() noexcept;
+
+                /* The bytes of the block being filled */
+                std::size_t bytes() const noexcept;
+
+            private:
+                std::size_t                unit;
+                std::shared_ptr<cv::Point> block;
+                std::size_t                capacity;
+                std::size_t                used;
+                mutable std::mutex         storing;
+        };
+
+        Contour() noexcept : shared(), count(0) {}
+        ~Contour() noexcept = default;
+
+        /* Owning the points of a vector without copying them */
+        Contour(std::vector<cv::Point> points) noexcept;
+
+        /* Contours can be copied and moved unconditionally, sharing their
+         * points */
+        Contour(const Contour& other) = default;
+        Contour& operator=(const Contour& other) = default;
+
+        Contour(Contour&& other) noexcept
+            : shared(std::move(other.shared)), count(other.count) {
+            other.count = 0;
+        }
+
+        Contour& operator=(Contour&& other) noexcept {
+            shared      = std::move(other.shared);
+            count       = other.count;
+            other.count = 0;
+            return *this;
+        }
+
+        inline std::size_t size() const noexcept {
+            return count;
+        }
+
+        inline bool empty() const noexcept {
+            return count == 0;
+        }
+
+        inline const cv::Point *data() const noexcept {
+            return shared.get();
+        }
+
+        inline const cv::Point *begin() const noexcept {
+            return shared.get();
+        }
+
+        inline const cv::Point *end() const noexcept {
+            return shared.get() + count;
+        }
+
+        inline const cv::Point &operator[](std::size_t i) const noexcept {
+            return shared.get()[i];
+        }
+
+        /* Forgetting the points */
+        inline void clear() noexcept {
+            shared.reset();
+            count = 0;
+        }
+
+        /* Owning a copy of some points */
+        inline void assign(const cv::Point *first, const cv::Point *last)
+            noexcept {
+            *this = Contour(std::vector<cv::Point>(first, last));
+        }
+
+        /* A read-only matrix header on the points for the OpenCV functions,
+         * that shall not outlive the contour */
+        inline cv::Mat mat() const noexcept {
+            return cv::Mat(static_cast<int>(count), 1, CV_32SC2,
+                           const_cast<cv::Point *>(shared.get()));
+        }
+
+        /* A copy of the points */
+        inline std::vector<cv::Point> points() const noexcept {
+            return std::vector<cv::Point>(begin(), end());
+        }
+
+        /* A contour simplified with a polygonal approximation whose points
+         * lie within epsilon pixels of the contour */
+        Contour simplified(double epsilon) const noexcept;
+
+    private:
+        std::shared_ptr<const cv::Point> shared;
+        std::size_t                      count;
+};
+
+}  // namespace VPP
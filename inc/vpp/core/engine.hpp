@@ -8,6 +8,11 @@
  *            entity responsible of processing a scene. 
  *            It can process a scene in different manners, either synchronously 
  *            or asynchronously by using core tasks.
+ *            Asynchronous engines only launch the processing of a scene, and
+ *            return an operation completed later on, e.g. by a remote
+ *            inference server. The operation is either waited for, or
+ *            continued in the thread completing it, for a pipelined pipeline
+ *            to suspend the scene meanwhile rather than blocking its thread.
  *
  *            This file is part of the VPP framework (see link).
  *
@@ -21,7 +26,10 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <functional>
 #include <memory>
+#include <mutex>
 
 #include "customisation/entity.hpp"
 #include "customisation/parameter.hpp"
@@ -31,6 +39,56 @@
 namespace VPP {
 namespace Core {
 
+/* Outcome of the processing of a scene, whose copies all share the same
+ * state: an operation is either completed right away (without allocating
+ * any state), or pending until one of its copies completes it */
+class Operation final {
+    public:
+        using Continuation = std::function<void (Error::Type error)>;
+
+        /* A pending operation */
+        Operation() noexcept;
+
+        /* An operation already completed with an error */
+        explicit Operation(Error::Type error) noexcept;
+
+        ~Operation() noexcept = default;
+
+        Operation(const Operation& other) = default;
+        Operation(Operation&& other) = default;
+        Operation& operator=(const Operation& other) = default;
+        Operation& operator=(Operation&& other) = default;
+
+        /* Completing the operation, only the first completion counting */
+        void complete(Error::Type error) noexcept;
+
+        /* Is the operation completed ? */
+        bool ready() const noexcept;
+
+        /* Continuing the operation (only once) when completed, in the thread
+         * completing it, or right away in the calling thread if it already
+         * is */
+        void then(Continuation next) noexcept;
+
+        /* Waiting for the operation to complete, the calling thread helping
+         * the task pool meanwhile, and returning its error */
+        Error::Type wait() const noexcept;
+
+    private:
+        struct State {
+            State() noexcept;
+
+            std::mutex              access;
+            std::condition_variable completed;
+            bool                    done;
+            Error::Type             error;
+            Continuation            next;
+        };
+
+        std::shared_ptr<State> state;
+        Error::Type            error;
+};
+
 template <typename ...Z> class Engine : public Parametrisable {
     public:
         Engine() noexcept;
@@ -47,6 +105,23 @@ template <typename ...Z> class Engine : public Parametrisable {
 
         /* Processing a scene and its environment */
         virtual Error::Type process(Scene &s, Z&...z) noexcept;
+
+        /* Launching the processing of a scene and its environment, which
+         * the synchronous engines complete right away by processing it */
+        virtual Operation launch(Scene &s, Z&...z) noexcept;
+};
+
+/* Engine processing the scenes asynchronously, by launching them: the scene
+ * and its environment shall be kept by the caller until the operation
+ * completes. Processing a scene waits for the operation of its launch */
+template <typename ...Z> class AsyncEngine : public Engine<Z...> {
+    public:
+        AsyncEngine() noexcept;
+        virtual ~AsyncEngine() noexcept = default;
+
+        virtual Operation launch(Scene &s, Z&...z) noexcept override = 0;
+
+        virtual Error::Type process(Scene &s, Z&...z) noexcept override;
 };
 
 }  // namespace Core
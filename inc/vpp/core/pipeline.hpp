@@ -5,7 +5,16 @@
  * @brief     This is the VPP core pipeline description file
  *
  * @details   This file describes the general structure of a pipeline, i.e. the
- *            entity responsible of managing a vector of core stages. 
+ *            entity responsible of managing a vector of core stages. Stages
+ *            are either processed sequentially on a single thread, or, when
+ *            pipelined, by groups of stages running on their own workers and
+ *            connected by bounded scene queues. Within a group, consecutive
+ *            forked stages run concurrently on the task pool, each on its
+ *            own branch of the scene, and join before the next stage.
+ *            A pipelined worker suspends the scenes on the stages whose
+ *            engines are still pending (e.g. remote inferences), working on
+ *            the next scenes meanwhile, and resumes them in order as soon as
+ *            their engines complete.
  *
  *            This file is part of the VPP framework (see link).
  *
@@ -20,23 +29,25 @@
 #pragma once
 
 #include <condition_variable>
-#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <memory>
 #include <mutex>
-#include <thread>
+#include <tuple>
 #include <vector>
 
-#include "customisation/entity.hpp"
-#include "customisation/parameter.hpp"
+#include "vpp/core/engine.hpp"
+#include "vpp/core/runner.hpp"
 #include "vpp/core/stage.hpp"
 #include "vpp/error.hpp"
 #include "vpp/scene.hpp"
-#include "vpp/util/observability.hpp"
+#include "vpp/util/templates.hpp"
 
 namespace VPP {
 namespace Core {
 
-template <typename ...Z> class Pipeline : public Parametrisable {
+template <typename ...Z> class Pipeline : public Runner<Z...> {
     public:
         using Stage = VPP::Core::Stage<Z...>;
 
@@ -49,48 +60,189 @@ template <typename ...Z> class Pipeline : public Parametrisable {
         Pipeline& operator=(Pipeline&& other) = delete;
         virtual ~Pipeline() noexcept;
 
-        /* Implementing a default terminate entity implementation aimed at 
-         * stopping the pipeline safely before any new initialisation */
-        virtual void terminate() noexcept override;
-
-        /* Appending a new stage to the pipeline */
+        /* Appending a new stage to the pipeline, starting a new group of
+         * stages, i.e. a new worker when the pipeline is pipelined */
         Pipeline &operator >>(Stage &stage) noexcept;
-        
-        /* Starting and stopping the pipeline (or keeping it continuing) */
-        void start() noexcept;
-        void stop() noexcept;
-        PARAMETER(Direct, None, Callable, bool) running;
 
-        /* Freezing and unfreezing the pipeline */
-        void freeze() noexcept;
-        void unfreeze() noexcept;
-        PARAMETER(Direct, None, Callable, bool) frozen;
+        /* Appending a new stage to the pipeline within the current group of
+         * stages, i.e. sharing the worker of the previous stage */
+        Pipeline &join(Stage &stage) noexcept;
+
+        /* Appending a new stage to the pipeline within the current group of
+         * stages, as a branch running concurrently with the consecutive
+         * forked stages whilst forking. Only the scene stages not adding any
+         * image to the view can be forked, the other ones being simply
+         * joined */
+        Pipeline &fork(Stage &stage) noexcept;
+
+        /* Number of scenes in flight: 1 processes all stages sequentially on
+         * a single thread, whereas more scenes let each group of stages run
+         * concurrently on its own worker */
+        PARAMETER(Direct, Saturating, Immediate, int) inflight;
+
+        /* Frame budget in milliseconds (0 for none): the optional stages of a
+         * scene are bypassed, as estimated from their recent costs, whenever
+         * they would make it miss its deadline */
+        PARAMETER(Direct, Saturating, Immediate, int) budget;
+
+        /* Releasing the cached conversions of the views of the scenes right
+         * after the last stage reading them, as declared by the stages */
+        PARAMETER(Direct, None, Immediate, bool) releasing;
+
+        /* Running the consecutive forked stages concurrently, or one after
+         * the other in their order otherwise */
+        PARAMETER(Direct, None, Immediate, bool) forking;
+
+    protected:
+        /* The runner members are dependent names within the pipeline */
+        using Runner<Z...>::conclude;
+        using Runner<Z...>::deferring;
+        using Runner<Z...>::measure;
+        using Runner<Z...>::prepare;
+        using Runner<Z...>::profiled;
+        using Runner<Z...>::retire;
+        using Runner<Z...>::settle;
+        using Runner<Z...>::stages;
+
+        /* Running the pipeline sequentially, or overlapping its groups of
+         * stages when pipelined */
+        virtual void launch() noexcept override;
 
-        Util::Notifier<Scene, Z...> broadcast;
+        /* Finding the conversions released after every stage */
+        virtual void plan() noexcept override;
 
-        std::function<void (Scene &s, Z&... z) noexcept> finished;
+        virtual Error::Type process(uint64_t arrival, Scene*& s,
+                                    Z*&... z) noexcept override;
  
     private:
-        /* Processing thread for the pipeline */
-        inline void launch() noexcept;
-        void work(Scene*& s, Z*&... z) noexcept;
-        void prepare(Scene*& s, Z*&... z) noexcept;
-        Error::Type process(Scene*& s, Z*&... z) noexcept;
- 
-        Customisation::Error onRunningUpdate(bool yes) noexcept;
-        Customisation::Error onFrozenUpdate(bool yes) noexcept;
-
-        /* Storage for internal stages */
-        std::vector<std::reference_wrapper<Stage>> stages;
-
-        /* Thread management */
-        bool                     run;
-        bool                     retry;
-        bool                     halt;
-        bool                     zombie;
-        std::condition_variable  resume;
-        std::mutex               suspend;
-        std::thread              thread;
+        /* A stage processing a scene, possibly across the suspension of the
+         * scene whilst the operation of the stage is pending */
+        struct Step {
+            Step() noexcept;
+
+            Operation operation;
+            bool      processed;
+            bool      launched;
+            bool      profiled;
+            bool      timed;
+            uint64_t  started;
+            uint64_t  prepared;
+        };
+
+        /* Storage for the scenes in flight of a pipelined pipeline */
+        struct Frame {
+            Frame() noexcept;
+
+            /* Frames cannot be copied nor moved as they point to themselves */
+            Frame(const Frame& other) = delete;
+            Frame(Frame&& other) = delete;
+            Frame& operator=(const Frame& other) = delete;
+            Frame& operator=(Frame&& other) = delete;
+            ~Frame() noexcept = default;
+
+            /* Starting a new scene in the frame own storage */
+            void reset() noexcept;
+
+            /* Moving back the scene within the frame if a stage has bound it
+             * to some storage of its own */
+            void rehome() noexcept;
+
+            Scene              scene;
+            std::tuple<Z...>   storage;
+            Scene *            s;
+            std::tuple<Z*...>  z;
+            Error::Type        error;
+            uint64_t           started;
+
+            /* The stage a suspended scene resumes at, its deadline, and
+             * whether its operation completed for it to be resumed */
+            std::size_t        stage;
+            uint64_t           deadline;
+            Step               step;
+            bool               resumable;
+
+            private:
+                template <std::size_t ...I>
+                    void bind(Util::indices<I...>) noexcept;
+        };
+
+        /* Appending a new stage, possibly starting a new group of stages */
+        Pipeline &append(Stage &stage, bool split, bool forking) noexcept;
+
+        /* Overlapping the groups of stages on their own workers */
+        inline bool pipelined() const noexcept;
+        void overlap() noexcept;
+        void relay(std::size_t group) noexcept;
+        Error::Type process(std::size_t first, std::size_t last,
+                            uint64_t arrival, Scene*& s, Z*&... z) noexcept;
+
+        /* The deadline of a scene started at its arrival (0 for none) */
+        uint64_t due(uint64_t arrival) const noexcept;
+
+        /* Running the stages from the current one until the last one or
+         * the first error, a suspendable scene stopping at the stage whose
+         * operation is pending, the current stage being the one it resumes
+         * at. A holding scene stops at its first suspendable stage anyway,
+         * for not overtaking the scenes suspended before it */
+        Error::Type run(std::size_t &stage, std::size_t last,
+                        uint64_t deadline, Step *suspendable, bool holding,
+                        Scene*& s, Z*&... z) noexcept;
+
+        /* Processing a scene by a stage, i.e. engaging the stage (which
+         * launches it unless specialised) and completing it right away */
+        Error::Type step(std::size_t stage, uint64_t deadline, Scene*& s,
+                         Z*&... z) noexcept;
+        void engage(std::size_t stage, uint64_t deadline, Step &step,
+                    Scene*& s, Z*&... z) noexcept;
+        Error::Type complete(std::size_t stage, Step &step, Scene &s,
+                             Z&... z) noexcept;
+
+        /* Stamping the exits of the stages in [first, last) and releasing
+         * the conversions no following stage reads */
+        void pass(std::size_t first, std::size_t last, Scene &s) noexcept;
+
+        /* Running the forked stages in [first, last) on their branches */
+        Error::Type branch(std::size_t first, std::size_t last,
+                           uint64_t deadline, Scene*& s, Z*&... z) noexcept;
+
+        /* Is an optional stage to be bypassed for meeting the deadline ? */
+        bool shedding(std::size_t stage, uint64_t deadline) const noexcept;
+
+        /* Unpacking the content of frames */
+        template <std::size_t ...I>
+            Error::Type process(Frame &f, std::size_t first, std::size_t last,
+                                bool holding, Util::indices<I...>) noexcept;
+        template <std::size_t ...I>
+            Error::Type proceed(Frame &f, std::size_t last,
+                                Util::indices<I...>) noexcept;
+
+        /* Suspending a frame until the operation of its stage completes */
+        void suspend(Frame &f) noexcept;
+        template <std::size_t ...I>
+            bool conclude(Frame &f, Util::indices<I...>) noexcept;
+
+        /* Scene queues between pipelined workers */
+        Frame *pop(std::size_t queue) noexcept;
+        void push(std::size_t queue, Frame *f) noexcept;
+
+        /* Index of the first stage of every group of stages */
+        std::vector<std::size_t> groups;
+
+        /* The forked stages, and their branch scenes kept across the frames
+         * for reusing their zone nodes */
+        std::vector<bool>                   forked;
+        std::vector<std::unique_ptr<Scene>> branches;
+
+        /* The image modes released after every stage, which no following
+         * stage reads */
+        std::vector<std::vector<Image::Mode>> releases;
+
+        /* Pipelined workers management, the last queue being the one of the
+         * pipeline thread itself */
+        bool                                drain;
+        std::vector<std::deque<Frame *>>    queues;
+        std::condition_variable             ready;
+        std::mutex                          flow;
 };
 
 }  // namespace Core
@@ -0,0 +1,186 @@
+/**
+ *
+ * @file      vpp/core/runner.hpp
+ *
+ * @brief     This is the VPP core pipeline runner description file
+ *
+ * @details   This file describes what every pipeline shares, whatever the way
+ *            it processes its stages: its thread and its state machine, the
+ *            changes deferred to its safe points, its hooks, and the
+ *            profiling of its scenes and stages, as published in its metrics
+ *            parameter and exported to the metrics registry.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "customisation/entity.hpp"
+#include "customisation/parameter.hpp"
+#include "vpp/core/stage.hpp"
+#include "vpp/error.hpp"
+#include "vpp/scene.hpp"
+#include "vpp/util/metrics.hpp"
+#include "vpp/util/observability.hpp"
+#include "vpp/util/templates.hpp"
+
+namespace VPP {
+namespace Core {
+
+template <typename ...Z> class Runner : public Parametrisable {
+    public:
+        using Stage = VPP::Core::Stage<Z...>;
+
+        Runner() noexcept;
+
+        /** Runners cannot be copied nor moved */
+        Runner(const Runner& other) = delete;
+        Runner(Runner&& other) = delete;
+        Runner& operator=(const Runner& other) = delete;
+        Runner& operator=(Runner&& other) = delete;
+        virtual ~Runner() noexcept;
+
+        /* Implementing a default terminate entity implementation aimed at
+         * stopping the pipeline safely before any new initialisation */
+        virtual void terminate() noexcept override;
+
+        /* Priority of the tasks started by the stages, which the latency
+         * critical pipelines get ahead of the background ones */
+        PARAMETER(Mapped, None, Immediate, int) priority;
+
+        /* Cores running the pipeline and the workers of its stages, as
+         * indices and ranges (e.g. 0-3,6), big or little (empty for any) */
+        PARAMETER(Direct, None, Immediate, std::string) affinity;
+
+        /* Starting and stopping the pipeline (or keeping it continuing) */
+        void start() noexcept;
+        void stop() noexcept;
+        PARAMETER(Direct, None, Callable, bool) running;
+
+        /* Freezing and unfreezing the pipeline */
+        void freeze() noexcept;
+        void unfreeze() noexcept;
+        PARAMETER(Direct, None, Callable, bool) frozen;
+
+        /* Applying a change (e.g. setting some parameters of the stages) at
+         * the safe point between two frames concluded by the pipeline
+         * thread, or right away when the pipeline is not running */
+        void defer(std::function<void ()> change) noexcept;
+
+        /* Profiling the stages of the pipeline, their metrics and the ones of
+         * the pipeline being published about every second */
+        PARAMETER(Direct, None, Callable, bool) profiling;
+        PARAMETER(Direct, None, Immediate, std::string) metrics;
+
+        Util::Notifier<Scene, Z...> broadcast;
+
+        std::function<void (Scene &s, Z&... z) noexcept> finished;
+
+        /* Probing the end to end latency of every scene in nanoseconds, from
+         * the thread concluding the scenes */
+        std::function<void (uint64_t latency) noexcept> measured;
+
+    protected:
+        /* Binding a stage to the pipeline, exposing it for customisation */
+        void bind(Stage &stage) noexcept;
+
+        /* Running the pipeline on its thread until it halts or fails, by
+         * default by working on a single scene at once */
+        virtual void launch() noexcept;
+
+        /* Preparing the stages right before the pipeline runs, once they
+         * have declared their readings at setup */
+        virtual void plan() noexcept;
+
+        /* Processing a scene through all the stages, as started at the
+         * given arrival time, stopping at the first error */
+        virtual Error::Type process(uint64_t arrival, Scene*& s,
+                                    Z*&... z) noexcept = 0;
+
+        /* Processing the scenes one after the other until the pipeline
+         * halts or fails */
+        void work(Scene*& s, Z*&... z) noexcept;
+
+        /* Starting a new scene, recycling the former one */
+        void prepare(Scene*& s, Z*&... z) noexcept;
+
+        /* Applying the deferred changes, whilst no stage is running */
+        void settle() noexcept;
+
+        /* Are there any deferred changes to apply ? */
+        bool deferring() noexcept;
+
+        /* Concluding a scene, false if the pipeline shall stop */
+        bool conclude(Error::Type error, Scene &s, Z&... z) noexcept;
+        void retire() noexcept;
+
+        /* Recording the end to end latency of a scene and its latency since
+         * its capture, and publishing all the metrics, the memory held by
+         * the scene included, if they were not published for a second */
+        void measure(uint64_t started, Scene &s) noexcept;
+
+        /* Storage for internal stages */
+        std::vector<std::reference_wrapper<Stage>> stages;
+
+        /* Thread management: the pipeline is either idle (its thread, if
+         * any, being parked), running, or halting once its thread concludes
+         * the current scene. Every transition is notified, and the thread
+         * is only dismissed when the pipeline is terminated */
+        enum class State : int { IDLE, RUNNING, HALTING };
+
+        State                    state;
+        bool                     retry;
+        bool                     halt;
+        bool                     dismissed;
+        std::condition_variable  resume;
+        std::mutex               suspend;
+        std::thread              thread;
+
+        /* Pipeline instrumentation */
+        std::atomic<bool>                   profiled;
+
+    private:
+        template <std::size_t ...I>
+            void launch(Util::indices<I...>) noexcept;
+
+        /* Processing thread for the pipeline, which is kept across the runs,
+         * parked whilst the pipeline is idle */
+        void serve() noexcept;
+
+        Customisation::Error onRunningUpdate(bool yes) noexcept;
+        Customisation::Error onFrozenUpdate(bool yes) noexcept;
+        Customisation::Error onProfilingUpdate(bool yes) noexcept;
+
+        /* Exporting the metrics of the pipeline and of its stages */
+        void collect(Util::Metrics::Exposition &e) noexcept;
+
+        /* The changes deferred to the next safe point */
+        std::vector<std::function<void ()>> deferred;
+        std::mutex                          pending;
+
+        Util::Histogram                     latency;
+        Util::Histogram                     capture;
+        std::atomic<uint64_t>               held_images;
+        std::atomic<uint64_t>               held_zones;
+        std::atomic<uint64_t>               held_contours;
+        std::atomic<uint64_t>               published;
+        Util::Metrics::Registry::Handle     exported;
+};
+
+}  // namespace Core
+}  // namespace VPP
@@ -22,16 +22,21 @@
 
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include "customisation/entity.hpp"
 #include "customisation/parameter.hpp"
 #include "vpp/core/engine.hpp"
 #include "vpp/error.hpp"
 #include "vpp/scene.hpp"
+#include "vpp/util/allocation.hpp"
+#include "vpp/util/metrics.hpp"
+#include "vpp/util/mutex.hpp"
 #include "vpp/util/observability.hpp"
 
 namespace VPP {
@@ -58,6 +63,18 @@ template <typename ...Z> class Stage : public Parametrisable {
         /* Stage enable handling */
         void disable(bool yes) noexcept;
         PARAMETER(Direct, None, Callable, bool) disabled;
+
+        /* Stage shedding priority: 0 for an essential stage, otherwise an
+         * optional stage that a late pipeline bypasses, the lower priorities
+         * being bypassed first */
+        PARAMETER(Direct, Saturating, Immediate, int) priority;
+
+        /* Stage decimation: only processing the scenes whose count modulo
+         * every is the phase, the count restarting on every detected scene
+         * when aligned on the keyframes */
+        PARAMETER(Direct, Saturating, Immediate, int)  every;
+        PARAMETER(Direct, Saturating, Immediate, int)  phase;
+        PARAMETER(Direct, None, Immediate, bool)       aligned;
          
         /* Define and use the engines */
         Customisation::Error use(const std::string id, Engine &eng) noexcept;
@@ -68,20 +85,165 @@ template <typename ...Z> class Stage : public Parametrisable {
         Error::Type prepare(Scene*& s, Z*&...z) noexcept;
         virtual Error::Type process(Scene &s, Z&...z) noexcept;
 
+        /* Launching the processing of a scene, the operation only completing
+         * once the engine does, and resuming it once completed, which
+         * concludes it in the calling thread. Processing a scene launches it
+         * and resumes it right away, waiting for the engine */
+        Operation launch(Scene &s, Z&...z) noexcept;
+        Error::Type resume(const Operation &op, Scene &s, Z&...z) noexcept;
+
+        /* Can the pipelined pipelines suspend their scenes on the stage, by
+         * launching and resuming them ? The stages specialising process()
+         * are only run through it */
+        virtual bool suspendable() const noexcept;
+
         std::function<bool (const Scene &, const Z&...) noexcept> filter;
         Util::Notifier<Scene, Z...> broadcast;
 
+        /* The scene resources of a stage: a stage forked in a pipeline runs
+         * concurrently with the other forked ones, on its own branch of the
+         * scene sharing the images of the view, and with the zones of the
+         * scene only if it reads them. The zones it adds are merged back
+         * into the scene when the branches join, whereas any other change to
+         * the zones of the branch is discarded */
+        class Resource {
+            public:
+                static constexpr int NONE  = 0;
+                /* The zones of the scene */
+                static constexpr int ZONES = 1;
+                /* The images of the view, that a branch cannot add */
+                static constexpr int VIEW  = 2;
+        };
+
+        /* Declaring the resources read and written by the stage, and the
+         * image modes it reads for them to be converted once for all the
+         * branches. Stages read and write everything unless declared */
+        void declare(int reads, int writes,
+                     std::vector<Image::Mode> modes) noexcept;
+
+        inline int reading() const noexcept {
+            return reads;
+        }
+
+        inline int writing() const noexcept {
+            return writes;
+        }
+
+        inline const std::vector<Image::Mode> &converting() const noexcept {
+            return modes;
+        }
+
+        /* Declaring all the image modes the stage may read, on top of the
+         * ones declared for being converted, for the pipeline to release
+         * the conversions of a scene after their last reader. Stages read
+         * every mode unless declared */
+        void consume(std::vector<Image::Mode> m) noexcept;
+
+        /* May the stage read the images of a mode ? */
+        bool consuming(const Image::Mode &mode) const noexcept;
+
+        /* Can the stage run on its own branch of a scene ? */
+        inline bool forkable() const noexcept {
+            return (writes & Resource::VIEW) == 0;
+        }
+
+        /* Stage instrumentation, only recorded whilst profiling (as enabled
+         * by the pipeline) for a near zero cost otherwise */
+        struct Statistics {
+            Statistics() noexcept;
+            void reset() noexcept;
+
+            /* Recording the outcome of a preparation or of a processing */
+            void record(Util::Histogram &h, uint64_t since,
+                        Error::Type error) noexcept;
+
+            /* Updating the moving average of the cost of the stage */
+            void estimate(uint64_t ns) noexcept;
+
+            /* Accounting the heap allocations of a scene since a former
+             * snapshot, if the allocations are tracked */
+            void account(const Util::Allocation::Counters &before) noexcept;
+
+            std::string summary() const;
+
+            Util::Histogram       preparing;
+            Util::Histogram       processing;
+            std::atomic<uint64_t> frames;
+            std::atomic<uint64_t> retries;
+            std::atomic<uint64_t> unready;
+            std::atomic<uint64_t> failures;
+            std::atomic<uint64_t> allocations;
+            std::atomic<uint64_t> allocated;
+
+            /* Always recorded whilst the pipeline has a frame budget, and
+             * kept when the profiling is reset */
+            std::atomic<uint64_t> cost;
+            std::atomic<uint64_t> shed;
+        };
+
+        void profile(bool yes) noexcept;
+        inline bool profiling() const noexcept {
+            return profiled.load(std::memory_order_relaxed);
+        }
+
+        /* Copying a snapshot of the statistics into the metrics parameter */
+        void publish() noexcept;
+
+        Statistics statistics;
+        PARAMETER(Direct, None, Immediate, std::string) metrics;
+
     private:
-        bool skipped;
+        /* Is the scene due for the decimated stage ? */
+        bool due(const Scene &s) noexcept;
+
+        /* The decimation beat, and the sequence number of the last scene */
+        uint64_t beat;
+        uint64_t last;
+
+        /* The declared resources of the stage */
+        int                      reads;
+        int                      writes;
+        std::vector<Image::Mode> modes;
+        std::vector<Image::Mode> consumed;
+        bool                     restricted;
+
         bool runpdatable;
         Customisation::Error onBypassedUpdate(const bool &yes) noexcept;
         Customisation::Error onDisabledUpdate(const bool &yes) noexcept;
         
         std::unordered_map<std::string, std::reference_wrapper<Engine>> engines;
-        Engine *pEngine;
         Customisation::Error onEngineUpdate(const std::string &id) noexcept;
 
-        std::mutex suspend;
+        /* The engine and bypass state of the stage, published by epoch in
+         * one of two selections, which the frames enter and leave without
+         * locking. An engine replaced by a new selection is only disabled
+         * once the last frame in flight has left its former selection */
+        struct Selection {
+            Selection() noexcept;
+
+            Engine *              engine;
+            bool                  skipped;
+            std::atomic<uint32_t> users;
+            std::atomic<Engine *> retired;
+        };
+
+        Selection &enter() noexcept;
+        void leave(Selection &sel) noexcept;
+        void settle(Selection &sel) noexcept;
+
+        /* Publishing a new selection, only under the suspend mutex */
+        void select(Engine *eng, bool skip) noexcept;
+
+        inline const Selection &selected() const noexcept {
+            return selections[epoch.load(std::memory_order_acquire) & 1];
+        }
+
+        Selection             selections[2];
+        std::atomic<uint32_t> epoch;
+
+        Util::Mutex suspend;
+
+        std::atomic<bool> profiled;
 };
  
 }  // namespace Core
@@ -0,0 +1,177 @@
+/**
+ *
+ * @file      vpp/core/static.hpp
+ *
+ * @brief     This is the VPP core static pipeline description file
+ *
+ * @details   This file describes a pipeline whose stages are fixed at compile
+ *            time: the stages are processed sequentially on a single thread,
+ *            the stage sequence being unrolled and every stage processing
+ *            being called without any virtual dispatch. The stages and their
+ *            engines are still exposed for customisation, and the pipeline
+ *            is run and profiled as a dynamic one, which remains the one to
+ *            use whenever the topology is to be changed, pipelined, forked or
+ *            given a frame budget.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+
+#include "vpp/core/runner.hpp"
+#include "vpp/core/stage.hpp"
+#include "vpp/error.hpp"
+#include "vpp/scene.hpp"
+#include "vpp/util/allocation.hpp"
+#include "vpp/util/templates.hpp"
+#include "vpp/util/trace.hpp"
+
+namespace VPP {
+namespace Core {
+
+/* Only declared for deducing the core stage a stage derives from */
+template <typename ...Z> Stage<Z...> *stage_of(Stage<Z...> *) noexcept;
+
+template <typename F, typename ...S> struct stage_base {
+    using type = typename std::remove_pointer<
+                     decltype(stage_of(static_cast<F *>(nullptr)))>::type;
+};
+
+template <typename B, typename ...S> class Static;
+
+template <typename ...Z, typename ...S>
+    class Static<Stage<Z...>, S...> : public Runner<Z...> {
+    public:
+        using Stage = VPP::Core::Stage<Z...>;
+
+        static_assert(Util::all<std::is_base_of<Stage, S>::value...>::value,
+                      "All the stages of a static pipeline shall derive "
+                      "from the same core stage!");
+
+        /* The stages are processed in the order they are provided */
+        explicit Static(S&... stages) noexcept;
+
+        /** Pipelines cannot be copied nor moved */
+        Static(const Static& other) = delete;
+        Static(Static&& other) = delete;
+        Static& operator=(const Static& other) = delete;
+        Static& operator=(Static&& other) = delete;
+        virtual ~Static() noexcept;
+
+        /* Running all the stages on a scene, stopping at the first error */
+        inline Error::Type process(Scene*& s, Z*&... z) noexcept {
+            return process(At<0>(), s, z...);
+        }
+
+    protected:
+        /* Starting a new scene before running all the stages on it */
+        virtual Error::Type process(uint64_t arrival, Scene*& s,
+                                    Z*&... z) noexcept override;
+
+    private:
+        template <std::size_t I>
+            using At   = std::integral_constant<std::size_t, I>;
+        template <std::size_t I>
+            using Type = typename std::tuple_element<I, std::tuple<S...>>::type;
+
+        /* The unrolled stage sequence, ending past the last stage */
+        inline Error::Type process(At<sizeof...(S)>, Scene*& /*s*/,
+                                   Z*&... /*z*/) noexcept {
+            return Error::NONE;
+        }
+
+        template <std::size_t I>
+            inline Error::Type process(At<I>, Scene*& s, Z*&... z) noexcept {
+            auto error = step<I>(s, z...);
+            if (error != Error::NONE) {
+                return error;
+            }
+            return process(At<I + 1>(), s, z...);
+        }
+
+        template <std::size_t I>
+            Error::Type step(Scene*& s, Z*&... z) noexcept;
+
+        /* The stages, with their actual types */
+        std::tuple<S&...> sequence;
+};
+
+/* A static pipeline of some stages, all deriving from the same core stage */
+template <typename ...S>
+    using StaticPipeline = Static<typename stage_base<S...>::type, S...>;
+
+template <typename ...Z, typename ...S>
+    Static<Stage<Z...>, S...>::Static(S&... s) noexcept
+    : Customisation::Entity("Pipeline"), Runner<Z...>(), sequence(s...) {
+    /* Expose the stages as a dynamic pipeline does */
+    int bound[] = { 0, (this->bind(s), 0)... };
+    (void) bound;
+}
+
+template <typename ...Z, typename ...S>
+    Static<Stage<Z...>, S...>::~Static() noexcept {
+    /* Cleanly exit the thread, which runs the stages of the pipeline */
+    this->terminate();
+}
+
+template <typename ...Z, typename ...S>
+    Error::Type Static<Stage<Z...>, S...>::process(uint64_t /*arrival*/,
+                                                   Scene*& s, Z*&... z)
+    noexcept {
+    Util::Trace::Span span("pipeline", this->name());
+    this->prepare(s, z...);
+
+    return process(s, z...);
+}
+
+template <typename ...Z, typename ...S> template <std::size_t I>
+    Error::Type Static<Stage<Z...>, S...>::step(Scene*& s, Z*&... z)
+    noexcept {
+    auto &stage = std::get<I>(sequence);
+
+    Util::Trace::Span traced("stage", stage.name());
+    auto profiled = stage.profiling();
+    auto started  = profiled ? Util::Histogram::now() : 0;
+    auto heap     = profiled ? Util::Allocation::thread() :
+                               Util::Allocation::Counters{ 0, 0 };
+    auto error    = stage.prepare(s, z...);
+    if (profiled) {
+        stage.statistics.record(stage.statistics.preparing, started, error);
+    }
+    if (error != Error::NONE) {
+        return error;
+    }
+
+    /* The actual stage type is known, hence no virtual dispatch */
+    using Actual  = Type<I>;
+    auto prepared = profiled ? Util::Histogram::now() : 0;
+    error         = stage.Actual::process(*s, *z...);
+    if (profiled) {
+        stage.statistics.record(stage.statistics.processing, prepared,
+                                error);
+        stage.statistics.account(heap);
+    }
+
+    /* Stamping the exit of the stage for the latency breakdown, of the
+     * scene pipelines only as the zone ones run once per zone */
+    if ( (sizeof...(Z) == 0) && (error == Error::NONE) && (profiled) ) {
+        s->exited(stage.name(), Util::Histogram::now() / 1000);
+    }
+
+    return error;
+}
+
+}  // namespace Core
+}  // namespace VPP
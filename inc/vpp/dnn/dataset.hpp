@@ -26,6 +26,7 @@
 #include "customisation/entity.hpp"
 #include "customisation/file.hpp"
 #include "vpp/scene.hpp"
+#include "vpp/util/task.hpp"
 
 namespace VPP {
 namespace DNN {
@@ -41,6 +42,16 @@ class Dataset : public Parametrisable {
         std::string label(const Zone &zone) const noexcept;
         std::string label(const Zone &zone, float threshold) const noexcept;
 
+        /* Labelling a zone with the dataset predictions above a threshold,
+         * without materialising any label string */
+        void tag(Zone &zone, float threshold) const noexcept;
+
+        /* Interned label of a class of a dataset, or an empty string */
+        static const std::string &lookup(int16_t dataset, int16_t id) noexcept;
+
+        /* Text of a zone, materialising its labels and its description */
+        static std::string text(const Zone &zone) noexcept;
+
         int16_t ID() const noexcept;
         int size() const noexcept;
 
@@ -53,6 +64,12 @@ class Dataset : public Parametrisable {
 
     protected:
         int16_t id;
+
+    private:
+        /* Loading the dataset labels, as a phase of the startup */
+        Customisation::Error instantiate() noexcept;
+
+        Util::Task::Startup::Phase loading;
 };
 
 }  // namespace DNN
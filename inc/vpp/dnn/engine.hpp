@@ -19,25 +19,79 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <future>
+
 #include "customisation/parameter.hpp"
 #include "vpp/dnn/dataset.hpp"
 #include "vpp/dnn/setup.hpp"
 #include "vpp/core/engine.hpp"
+#include "vpp/util/metrics.hpp"
+#include "vpp/util/task.hpp"
 
 namespace VPP {
 namespace DNN {
 namespace Engine {
 
-template <typename ...Z> class Core : public VPP::Core::Engine<Z...> {
+/* The DNN engines either infer synchronously, by processing the scenes, or
+ * asynchronously, by launching them (e.g. on an inference server), the
+ * other entry point waiting for or completing right away the one they
+ * implement */
+template <typename ...Z> class Core : public VPP::Core::AsyncEngine<Z...> {
     public:
         Core() noexcept;
-        virtual ~Core() noexcept = default; 
+        virtual ~Core() noexcept;
+
+        /* Launching a scene inferred synchronously, i.e. processing it */
+        virtual VPP::Core::Operation launch(Scene &s, Z&... z) noexcept
+            override;
 
         std::string label(const Zone &zone) const noexcept;
 
+        /* Labelling a zone with the engine dataset and threshold */
+        void tag(Zone &zone) const noexcept;
+
+        /* The scenes wait for the warm-up of the network (if any) */
+        virtual Error::Type prepare(Scene*& s, Z*&... z) noexcept override;
+
+        /* Is the network warmed up ? */
+        inline bool warm() const noexcept {
+            return warmed.load(std::memory_order_acquire);
+        }
+
         VPP::DNN::Dataset                               dataset;
         VPP::DNN::Setup                                 network;
         PARAMETER(Direct, Saturating, Immediate, float) threshold;
+
+        /* The number of dummy inferences run at setup for the first scenes
+         * not to pay for the lazy allocations and kernel compilations, and
+         * whether they run in the background, the first scene then waiting
+         * for them */
+        PARAMETER(Direct, Saturating, Immediate, int)   warmup;
+        PARAMETER(Direct, None, Immediate, bool)        background;
+
+        /* The latencies of the network inferences, as exported metrics */
+        Util::Histogram                                 inference;
+
+    protected:
+        /* Warming the network up with the dummy inferences of an engine */
+        void warm(std::function<void () noexcept> infer) noexcept;
+
+        /* Waiting for the warm-up in progress (if any) */
+        void cool() noexcept;
+
+        /* Loading the engine as a phase of the startup, i.e. concurrently
+         * with the other engines when enabled, the error being the one of
+         * the loading when it runs right away, as once the startup is over */
+        Customisation::Error load(
+            std::function<Customisation::Error () noexcept> loader) noexcept;
+
+    private:
+        Util::Task::Startup::Phase                      loading;
+        std::future<void>                               warming;
+        std::atomic<bool>                               warmed;
+        Util::Metrics::Registry::Handle                 exported;
 };
 
 /* Describing an engine for handling a full scene */
@@ -25,14 +25,61 @@
 # error ERROR: VPP does not support the OpenCV DNN!
 #endif
 
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <opencv2/dnn.hpp>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "customisation/parameter.hpp"
 #include "vpp/dnn/engine.hpp"
+#include "vpp/dnn/remote.hpp"
 #include "vpp/types.hpp"
 
 namespace VPP {
 namespace DNN {
+
+/* A network shared by all the engines using the same model with the same
+ * backend, target and precision preferences. OpenCV networks are not
+ * reentrant, so the inferences on a shared network are serialised with its
+ * access lock */
+class Network {
+    public:
+        using Preparer = std::function<void (cv::dnn::Net &net) noexcept>;
+
+        /* Sharing the network loaded for this model and preferences, and
+         * loading it and preparing it if it does not exist yet */
+        static std::shared_ptr<Network> share(const std::string &architecture,
+                                              const std::string &weights,
+                                              int backend, int target,
+                                              int precision,
+                                              const Preparer &prepare) noexcept;
+
+        /* The target inferring at a given precision, i.e. the FP16 variant
+         * of the OpenCL and CUDA targets in FP16 */
+        static int precise(int target, int precision) noexcept;
+
+        /* Quantising a floating-point network to INT8 with some calibration
+         * blobs, a network already quantised being left as it is */
+        static bool quantise(cv::dnn::Net &net,
+                             const std::vector<cv::Mat> &calibration) noexcept;
+
+        explicit Network(cv::dnn::Net n) noexcept
+            : net(std::move(n)), access() {}
+        ~Network() noexcept = default;
+
+        /* Networks cannot be copied nor moved */
+        Network(const Network& other) = delete;
+        Network(Network&& other) = delete;
+        Network& operator=(const Network& other) = delete;
+        Network& operator=(Network&& other) = delete;
+
+        cv::dnn::Net net;
+        std::mutex   access;
+};
+
 namespace Engine {
 
 template <typename ...Z> class OCV : public Core<Z...> {
@@ -48,10 +95,47 @@ template <typename ...Z> class OCV : public Core<Z...> {
         PARAMETER(Direct, Bounded, Immediate, std::vector<float>) mean;
         PARAMETER(Direct, Bounded, Immediate, float)              scale;
 
+        /* The inference server the blobs are shipped to (if any), the local
+         * network being the fallback */
+        VPP::DNN::Remote                                          remote;
+
     protected:
-        std::string  architecture, weights;
-        cv::dnn::Net net;
-        cv::Scalar   offset;
+        /* Loading (or reloading) the network of the engine, as a phase of
+         * the startup */
+        virtual Customisation::Error instantiate() noexcept;
+
+        /* Inferring a blob on the inference server if any, false for it to
+         * be inferred locally on the (shared) network instead */
+        bool offload(const cv::Mat &blob, std::vector<cv::Mat> &outputs,
+                     bool batchable) noexcept;
+
+        /* Apply the backend and target preference, timing all the available
+         * pairs running at the precision to keep the fastest one in auto
+         * mode */
+        void prefer(int backend, int target, int precision) noexcept;
+
+        /* The calibration blobs of the INT8 quantisation, either from the
+         * images listed in the calibration file or synthetic ones */
+        std::vector<cv::Mat> calibrate() noexcept;
+
+        /* The number of images inferred at once by the engine */
+        virtual int batching() noexcept {
+            return 1;
+        }
+
+        /* Reserve the shared network for an inference */
+        inline std::unique_lock<std::mutex> reserve() noexcept {
+            return (shared != nullptr) ?
+                std::unique_lock<std::mutex>(shared->access) :
+                std::unique_lock<std::mutex>();
+        }
+
+        std::string              architecture, weights;
+        std::pair<int, int>      preference;
+        int                      precision;
+        std::shared_ptr<Network> shared;
+        cv::dnn::Net             net;
+        cv::Scalar               offset;
 };
 
 }  // namespace Engine
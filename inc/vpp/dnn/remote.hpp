@@ -0,0 +1,115 @@
+/**
+ *
+ * @file      vpp/dnn/remote.hpp
+ *
+ * @brief     This is the VPP remote DNN inference description file
+ *
+ * @details   This is the definition of the remote inference backend of the
+ *            OCV DNN engines, shipping their preprocessed blobs to a shared
+ *            inference server instead of running their network locally. The
+ *            requests of all the engines using the same server and model are
+ *            sent on a single connection, several of them being in flight at
+ *            once, and the ones of the batchable engines (e.g. classifiers)
+ *            being coalesced into batches. Any failing or late request is
+ *            reported for the engine to fall back to its local network.
+ *
+ *            The VPP inference protocol exchanges frames in the little-endian
+ *            order of the hosts:
+ *              - a request is the 'VPPI' magic (uint32), its identifier
+ *                (uint32), the length of the model name (uint32) and its
+ *                characters, then a single float32 NCHW tensor;
+ *              - a response is the 'VPPI' magic, the request identifier, a
+ *                status (int32, 0 for success) and the number of outputs
+ *                (uint32), then as many float32 tensors in the order of the
+ *                unconnected output layers of the model.
+ *            A tensor is its number of dimensions (uint32), its dimensions
+ *            (int32 each) and its data.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "customisation/entity.hpp"
+#include "customisation/parameter.hpp"
+
+namespace VPP {
+namespace DNN {
+
+class Remote : public Parametrisable {
+    public:
+        /* The completion of a blob inferred asynchronously, called once with
+         * its outputs, empty if it failed */
+        using Completion = std::function<void (std::vector<cv::Mat> &outputs)>;
+
+        Remote() noexcept;
+        virtual ~Remote() noexcept;
+
+        virtual Customisation::Error setup() noexcept override;
+
+        /* Is there a server to infer on ? */
+        bool enabled() const noexcept;
+
+        /* Inferring a float32 blob on the server, coalescing it with the
+         * other pending batchable blobs of the same shape if batchable. It
+         * is false if the server is unreachable, fails or is late */
+        bool infer(const cv::Mat &blob, std::vector<cv::Mat> &outputs,
+                   bool batchable) noexcept;
+
+        /* Inferring a float32 blob on the server without waiting for it, the
+         * completion being called in the thread receiving its outputs, or
+         * with none once the server is unreachable, fails or is late */
+        void infer(const cv::Mat &blob, bool batchable,
+                   Completion done) noexcept;
+
+        /* The server as host:port (empty for inferring locally), and the
+         * name of the model it runs (empty for its default one) */
+        PARAMETER(Direct, None, Immediate, std::string)     server;
+        PARAMETER(Direct, None, Immediate, std::string)     model;
+
+        /* The time in milliseconds a request is waited for, before falling
+         * back to the local inference */
+        PARAMETER(Direct, Saturating, Immediate, int)       timeout;
+
+        /* The maximal number of requests in flight on the connection */
+        PARAMETER(Direct, Saturating, Immediate, int)       inflight;
+
+        /* The time in microseconds a batchable blob waits for others, and
+         * the maximal number of blobs coalesced into a request */
+        PARAMETER(Direct, Saturating, Immediate, int)       window;
+        PARAMETER(Direct, Saturating, Immediate, int)       coalesce;
+
+        /* The number of blobs inferred locally for the lack of a response */
+        std::atomic<uint64_t>                               fallbacks;
+
+    private:
+        class Client;
+
+        /* The connection a blob is inferred on, if any and inferable */
+        std::shared_ptr<Client> connection(const cv::Mat &blob) noexcept;
+
+        /* Accounting a blob inferred locally for the lack of a response */
+        void miss() noexcept;
+
+        std::mutex              access;
+        std::shared_ptr<Client> client;
+};
+
+}  // namespace DNN
+}  // namespace VPP
@@ -19,8 +19,12 @@
 
 #pragma once
 
+#include <string>
+#include <utility>
+
 #include "customisation/entity.hpp"
 #include "customisation/file.hpp"
+#include "customisation/parameter.hpp"
 
 namespace VPP {
 namespace DNN {
@@ -32,8 +36,43 @@ class Setup : public Parametrisable {
 
         virtual Customisation::Error setup() noexcept override;
 
+        /* Backend or target value requesting the fastest available one */
+        static const int AUTO = -1;
+
+        /** Precisions of the inferences */
+        enum class Precision : int {
+            /** Floating-point weights and activations of the network */
+            FP32 = 0,
+            /** Half-precision floating-point inferences on the targets
+             *  supporting it */
+            FP16 = 1,
+            /** 8-bit integer inferences on the CPU, either of a network
+             *  already quantised or of a one quantised at setup */
+            INT8 = 2
+        };
+
         Customisation::File architecture;
         Customisation::File weights;
+
+        /* The preferred inference backend and target (if supported) */
+        PARAMETER(Mapped, None, Immediate, int) backend;
+        PARAMETER(Mapped, None, Immediate, int) target;
+
+        /* The precision of the inferences, and the file listing the images
+         * (one path per line) calibrating the INT8 quantisation */
+        PARAMETER(Mapped, None, Immediate, int) precision;
+        Customisation::File                     calibration;
+
+        /* The file keeping the backends and targets timed as the fastest
+         * ones, for warm starts not to time them again */
+        Customisation::File cache;
+
+        /* Recalling and remembering the fastest backend and target for a key
+         * describing the network and its input */
+        bool recall(const std::string &key,
+                    std::pair<int, int> &fastest) noexcept;
+        void remember(const std::string &key,
+                      const std::pair<int, int> &fastest) noexcept;
 };
 
 }  // namespace DNN
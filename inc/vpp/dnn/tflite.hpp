@@ -0,0 +1,164 @@
+/**
+ *
+ * @file      vpp/dnn/tflite.hpp
+ *
+ * @brief     This is the VPP DNN TensorFlow Lite engine description file
+ *
+ * @details   This is the definition of the VPP TensorFlow Lite (TFLite) DNN
+ *            engine, a class that gathers any generic information for
+ *            describing a TFLite engine running on the CPU or offloaded to
+ *            the NNAPI, GPU or Edge TPU delegates. Quantised models are fed
+ *            with their 8-bit inputs as they are, and the inputs are resized
+ *            and converted straight into the input tensor of the network,
+ *            from the YUV planes of the native camera images when there are
+ *            some.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include "vpp/config.hpp"
+#ifndef VPP_HAS_TFLITE_SUPPORT
+# error ERROR: VPP does not support TensorFlow Lite!
+#endif
+
+#include <memory>
+#include <mutex>
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+
+#include "customisation/parameter.hpp"
+#include "tensorflow/lite/c/c_api.h"
+#include "vpp/dnn/engine.hpp"
+#include "vpp/view.hpp"
+
+namespace VPP {
+namespace DNN {
+
+/* An interpreter shared by all the engines using the same model on the same
+ * delegate. TFLite interpreters are not reentrant and their tensors are
+ * theirs, so the filling of the inputs, the inferences and the reading of
+ * the outputs of a shared interpreter are serialised with its access lock */
+class Interpreter {
+    public:
+        /** Delegates running the inferences */
+        enum class Delegate : int {
+            /** The CPU kernels, with their threads */
+            CPU     = 0,
+            /** The Android neural networks API, i.e. the NPU, DSP or GPU of
+             *  the device */
+            NNAPI   = 1,
+            /** The OpenCL or OpenGL GPU delegate */
+            GPU     = 2,
+            /** The first Coral Edge TPU found */
+            EDGETPU = 3
+        };
+
+        /* Sharing the interpreter of a model on a delegate, and loading it
+         * if it does not exist yet, on the CPU if the delegate cannot run
+         * it */
+        static std::shared_ptr<Interpreter> share(const std::string &model,
+                                                  int delegate, int threads,
+                                                  int precision) noexcept;
+
+        Interpreter(TfLiteModel *m, TfLiteInterpreterOptions *o,
+                    TfLiteDelegate *d, int kind,
+                    TfLiteInterpreter *i) noexcept;
+        ~Interpreter() noexcept;
+
+        /* Interpreters cannot be copied nor moved */
+        Interpreter(const Interpreter& other) = delete;
+        Interpreter(Interpreter&& other) = delete;
+        Interpreter& operator=(const Interpreter& other) = delete;
+        Interpreter& operator=(Interpreter&& other) = delete;
+
+        TfLiteInterpreter * const interpreter;
+        const int                 delegated;
+        std::mutex                access;
+
+    private:
+        TfLiteModel              *model;
+        TfLiteInterpreterOptions *options;
+        TfLiteDelegate           *delegate;
+};
+
+namespace Engine {
+
+template <typename ...Z> class TFLite : public Core<Z...> {
+    public:
+        TFLite() noexcept;
+        virtual ~TFLite() noexcept = default;
+
+        Customisation::Error setup() noexcept override;
+        void terminate() noexcept override;
+
+        /* The delegate of the inferences (cpu, nnapi, gpu or edgetpu) and
+         * the number of CPU threads of the interpreter */
+        PARAMETER(Mapped, None, Immediate, int)                   delegate;
+        PARAMETER(Direct, Saturating, Immediate, int)             threads;
+
+        /* The normalisation of the floating-point inputs, the 8-bit inputs
+         * of the quantised networks being the pixels as they are */
+        PARAMETER(Direct, None, Immediate, bool)                  RGB;
+        PARAMETER(Direct, Bounded, Immediate, std::vector<float>) mean;
+        PARAMETER(Direct, Bounded, Immediate, float)              scale;
+
+    protected:
+        /* Loading (or reloading) the interpreter of the engine, as a phase
+         * of the startup */
+        virtual Customisation::Error instantiate() noexcept;
+
+        /* Reserve the shared interpreter for filling its input, inferring
+         * and reading its outputs */
+        inline std::unique_lock<std::mutex> reserve() noexcept {
+            return (shared != nullptr) ?
+                std::unique_lock<std::mutex>(shared->access) :
+                std::unique_lock<std::mutex>();
+        }
+
+        /* Filling the input tensor with the colour image of a view, right
+         * from the planes of its native YUV image if any, or with a BGR
+         * image, resized to the input of the network */
+        void fill(View &view) noexcept;
+        void fill(const cv::Mat &bgr) noexcept;
+
+        /* Inferring the input tensor, false on failure */
+        bool invoke() noexcept;
+
+        /* An output tensor dequantised as a row of floats, away from the
+         * interpreter */
+        cv::Mat output(int index) const noexcept;
+
+        /* The number of output tensors */
+        int outputs() const noexcept;
+
+        std::string                  model;
+        int                          delegated;
+        int                          threaded;
+        int                          precision;
+        std::shared_ptr<Interpreter> shared;
+        cv::Size                     shape;
+        cv::Scalar                   offset;
+
+    private:
+        /* The input tensor as a matrix header, and the storing of the 8-bit
+         * staging image into the inputs of the floating-point and INT8
+         * networks */
+        cv::Mat tensor() const noexcept;
+        void    store(cv::Mat &input) noexcept;
+
+        cv::Mat staged, luma, chroma;
+};
+
+}  // namespace Engine
+}  // namespace DNN
+}  // namespace VPP
@@ -35,5 +35,11 @@ using ForZone = Core::Engine<Zone>;
 /* Describing an engine for handling multiple zones in a scene */
 using ForZones = Core::Engine<Zones>;
 
+/* Describing the asynchronous engines for handling a full scene, a single
+ * zone or multiple zones in a scene */
+using AsyncForScene = Core::AsyncEngine<>;
+using AsyncForZone  = Core::AsyncEngine<Zone>;
+using AsyncForZones = Core::AsyncEngine<Zones>;
+
 }  // namespace Engine
 }  // namespace VPP
@@ -22,19 +22,106 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
+#include <vector>
 
+#include "customisation/parameter.hpp"
 #include "vpp/error.hpp"
 #include "vpp/scene.hpp"
 #include "vpp/engine.hpp"
+#include "vpp/util/metrics.hpp"
+#include "vpp/util/mutex.hpp"
 
 namespace VPP {
 namespace Engine {
 
+/* The ring of scene slots of a bridge: the producer forwards scenes into free
+ * slots which are queued until the consumer prepares them, the slot being
+ * consumed being only released on the next preparation */
+class BridgeSlots final {
+    public:
+        /** What to do with a scene forwarded to a full bridge */
+        enum class Policy : int {
+            /** Drop the oldest scene waiting in the bridge */
+            DROP_OLDEST = 0,
+            /** Drop the scene being forwarded */
+            DROP_NEWEST = 1,
+            /** Block the producer until a slot is released */
+            BLOCK       = 2,
+            /** Drop the waiting zones with the same UUID as the zones of the
+             * scene being forwarded, and then the oldest scene if needed */
+            KEEP_LATEST = 3
+        };
+
+        BridgeSlots() noexcept;
+        ~BridgeSlots() noexcept = default;
+
+        /* Empty the bridge with a given number of slots (at least 2), and
+         * release any blocked producer */
+        void reset(int depth) noexcept;
+
+        void forward(Scene scn, Policy policy) noexcept;
+        void forward(Zones zs) noexcept;
+        void forward(Zone &z) noexcept;
+
+        /* The last forwarded scene */
+        Scene &newest() noexcept;
+
+        /* Are there no scene (and no zone if zoned) left to consume ? */
+        bool empty(bool zoned) noexcept;
+
+        /* Release the consumed slot and get the next queued scene if any */
+        Scene *next() noexcept;
+
+        /* Get the next zone to consume, or the next batch of at most count
+         * zones (all of them if 0), moving to the next queued scene only
+         * once all the zones of the consumed one were handed over */
+        Error::Type next(Scene*& scn, Zone*& z) noexcept;
+        Error::Type next(Scene*& scn, Zones*& zs, std::size_t count) noexcept;
+
+        /* The number of scenes forwarded to the bridge, and dropped by it */
+        std::atomic<uint64_t>   forwarded;
+        std::atomic<uint64_t>   dropped;
+
+    private:
+        /* The zones of a slot are handed over from a cursor, so that draining
+         * a slot is linear in its number of zones */
+        struct Slot {
+            inline bool drained() const noexcept {
+                return served >= zones.size();
+            }
+
+            Scene       scene;
+            Zones       zones;
+            std::size_t served = 0;
+        };
+
+        /* Moving to the next queued slot if the consumed one is drained,
+         * returning true if the consumed slot was released */
+        bool advance() noexcept;
+
+        /* Getting a free slot, or -1 if the scene shall be dropped */
+        int acquire(std::unique_lock<Util::Mutex> &lock, const Scene &scn,
+                    Policy policy) noexcept;
+        void release(int slot) noexcept;
+
+        Util::Mutex                 access;
+        std::condition_variable_any released;
+        std::vector<Slot>       slots;
+        std::vector<int>        queued;
+        std::vector<int>        spares;
+        int                     rd, wr;
+        bool                    discarding;
+};
+
 template <typename ...Z> class Bridge : public Core::Engine<Z...> {
     public:
+        using Policy = BridgeSlots::Policy;
+
         Bridge() noexcept;
-        ~Bridge() noexcept = default;
+        ~Bridge() noexcept;
 
         /* Forwarding a scene or a scene with a list of zone references to this
          * bridge. If the scene shall not be copied, then use std::move when
@@ -46,22 +133,41 @@ template <typename ...Z> class Bridge : public Core::Engine<Z...> {
         Scene &scene() noexcept;
         bool empty() noexcept;
 
+        /* The number of scenes forwarded to the bridge, and dropped by it */
+        inline uint64_t forwarded() const noexcept {
+            return slots.forwarded.load(std::memory_order_relaxed);
+        }
+
+        inline uint64_t dropped() const noexcept {
+            return slots.dropped.load(std::memory_order_relaxed);
+        }
+
         Customisation::Error setup() noexcept override;
         /* Prepare returns not existing if there is nothing more to process */
         Error::Type prepare(Scene*& s, Z*&... z) noexcept override;
         void terminate() noexcept override;
 
+        /* The number of scene slots, including the one being consumed */
+        PARAMETER(Direct, Saturating, Immediate, int) depth;
+
+        /* The policy applied to scenes forwarded to a full bridge */
+        PARAMETER(Mapped, None, Immediate, int)       policy;
+
+        /* The maximal number of zones handed over at once by a bridge for
+         * multiple zones, all the zones of the scene if 0 */
+        PARAMETER(Direct, Saturating, Immediate, int) batch;
+
     private:
-        std::mutex  access;
-        int         rd, wr;
-        Scene       scenes[2];
-        Zones       zones[2]; 
+        BridgeSlots                     slots;
+        Util::Metrics::Registry::Handle exported;
 };
 
 template <> class Bridge<> : public Core::Engine<> {
     public:
+        using Policy = BridgeSlots::Policy;
+
         Bridge() noexcept;
-        ~Bridge() noexcept = default;
+        ~Bridge() noexcept;
 
         /* Forwarding a scene or a scene with a list of zone references to this
          * bridge. If the scene shall not be copied, then use std::move when
@@ -69,15 +175,29 @@ template <> class Bridge<> : public Core::Engine<> {
         void forward(Scene scn) noexcept;
         bool empty() noexcept;
 
+        /* The number of scenes forwarded to the bridge, and dropped by it */
+        inline uint64_t forwarded() const noexcept {
+            return slots.forwarded.load(std::memory_order_relaxed);
+        }
+
+        inline uint64_t dropped() const noexcept {
+            return slots.dropped.load(std::memory_order_relaxed);
+        }
+
         Customisation::Error setup() noexcept override;
         /* Prepare returns not existing if there is nothing more to process */
         Error::Type prepare(Scene*& s) noexcept override;
         void terminate() noexcept override;
 
+        /* The number of scene slots, including the one being consumed */
+        PARAMETER(Direct, Saturating, Immediate, int) depth;
+
+        /* The policy applied to scenes forwarded to a full bridge */
+        PARAMETER(Mapped, None, Immediate, int)       policy;
+
     private:
-        std::mutex  access;
-        int         rd, wr;
-        Scene       scenes[2];
+        BridgeSlots                     slots;
+        Util::Metrics::Registry::Handle exported;
 };
 
 /* Describing a bridge for handling a full scene */
@@ -0,0 +1,120 @@
+/**
+ *
+ * @file      vpp/engine/cache.hpp
+ *
+ * @brief     These are the VPP classification cache engines
+ *
+ * @details   These engines keep the classification results of the tracked
+ *            zones by UUID, so that zones seen again with fresh enough results
+ *            can skip the classification stages altogether
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "customisation/entity.hpp"
+#include "customisation/parameter.hpp"
+#include "vpp/engine.hpp"
+#include "vpp/zone.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Cache {
+
+class Store : public Parametrisable {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        Store() noexcept;
+        ~Store() noexcept = default;
+
+        Customisation::Error clear() noexcept override;
+
+        /* Restore the cached results of the zone if they are still fresh,
+         * and drop them otherwise */
+        bool restore(Zone &zone) noexcept;
+
+        /* Record the results of a zone unless it was served from the cache */
+        void record(const Zone &zone) noexcept;
+
+        /* Check if the zone has been served from the cache in this pass */
+        bool served(const Zone &zone) const noexcept;
+
+        /* Refresh rules: maximal age in seconds, minimal IoU with the cached
+         * bounding box, and minimal best score after the recall decay */
+        PARAMETER(Direct, Saturating, Immediate, float) lifetime;
+        PARAMETER(Direct, Saturating, Immediate, float) overlap;
+        PARAMETER(Direct, Saturating, Immediate, float) threshold;
+
+        /* Recall factor applied to the cached scores at each use */
+        PARAMETER(Direct, Saturating, Immediate, float) recall;
+
+        /* Number of entries kept at most, the expired ones being purged
+         * first, then the least recently recorded or served ones */
+        PARAMETER(Direct, Saturating, Immediate, int)   capacity;
+
+    private:
+        struct Entry {
+            BBox                  bbox;
+            Predictions           predictions;
+            Labels                labels;
+            std::string           description;
+            Clock::time_point     stamp;
+            bool                  served;
+            std::list<uint64_t>::iterator recent;
+        };
+
+        /* Dropping an entry, and its rank in the recency order */
+        void drop(std::unordered_map<uint64_t, Entry>::iterator it) noexcept;
+
+        /* Making room for a new entry under the capacity */
+        void purge(Clock::time_point now) noexcept;
+
+        mutable std::mutex                  access;
+        std::unordered_map<uint64_t, Entry> entries;
+
+        /* The UUIDs of the entries, from the most recently recorded or
+         * served to the least recently ones */
+        std::list<uint64_t>                 recency;
+};
+
+class Lookup : public VPP::Engine::ForZone {
+    public:
+        explicit Lookup(Store &s) noexcept;
+        ~Lookup() noexcept;
+
+        Error::Type process(Scene &scene, Zone &zone) noexcept override;
+
+    private:
+        Store &store;
+};
+
+class Record : public VPP::Engine::ForZone {
+    public:
+        explicit Record(Store &s) noexcept;
+        ~Record() noexcept;
+
+        Error::Type process(Scene &scene, Zone &zone) noexcept override;
+
+    private:
+        Store &store;
+};
+
+}  // namespace Cache
+}  // namespace Engine
+}  // namespace VPP
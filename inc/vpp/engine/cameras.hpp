@@ -0,0 +1,85 @@
+/**
+ *
+ * @file      vpp/engine/cameras.hpp
+ *
+ * @brief     This is the VPP multi-camera capture engine definition
+ *
+ * @details   This engine captures several video sources at once, aligns
+ *            their frames in time and combines them in a single scene, so
+ *            that a single pipeline (and its DNN batching and thread pools)
+ *            processes all the cameras of a host.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "customisation/parameter.hpp"
+#include "vpp/engine.hpp"
+#include "vpp/engine/capture.hpp"
+#include "vpp/error.hpp"
+#include "vpp/scene.hpp"
+
+namespace VPP {
+namespace Engine {
+
+class Cameras : public Engine::ForScene {
+    public:
+        static constexpr int MAX = 4;
+
+        Cameras() noexcept;
+        ~Cameras() noexcept = default;
+
+        Customisation::Error setup() noexcept override;
+        Error::Type process(Scene &scene) noexcept override;
+        void terminate() noexcept override;
+
+        /* The area of the combined scene where the frames of a camera are
+         * placed (empty if the camera is not in use) */
+        const cv::Rect &area(int camera) const noexcept;
+
+        /* Maximal time difference between the frames of a time slot */
+        PARAMETER(Direct, Bounded, Immediate, int) tolerance;
+
+        /* Number of attempts for catching up with the other cameras */
+        PARAMETER(Direct, Bounded, Immediate, int) retries;
+
+        /* Number of cameras per row of the combined scene (0 for all) */
+        PARAMETER(Direct, Bounded, Immediate, int) columns;
+
+        /* The cameras without any protocol set are left unused */
+        std::array<Capture, MAX> camera;
+
+    private:
+        /* Capture the frames of all the used cameras concurrently */
+        Error::Type capture(const std::vector<int> &which) noexcept;
+
+        /* Combine the frames of the used cameras in a single image */
+        cv::Mat combine() noexcept;
+
+        /* The mask of the combined image, as composed from the masks of the
+         * used cameras, and only composed again when they change */
+        std::shared_ptr<const Util::OCV::Mask> mosaic(const cv::Size &size)
+            noexcept;
+
+        std::vector<int>          used;
+        std::array<Scene, MAX>    frames;
+        std::array<cv::Rect, MAX> areas;
+
+        std::array<std::shared_ptr<const Util::OCV::Mask>, MAX> masks;
+        std::shared_ptr<const Util::OCV::Mask>                  composed;
+};
+
+}  // namespace Engine
+}  // namespace VPP
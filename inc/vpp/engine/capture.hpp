@@ -21,14 +21,23 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "customisation/parameter.hpp"
 #include "vpp/error.hpp"
 #include "vpp/scene.hpp"
 #include "vpp/engine.hpp"
+#include "vpp/engine/subscription.hpp"
 #include "vpp/util/io/input.hpp"
+#include "vpp/util/ocv/mask.hpp"
+#include "vpp/util/metrics.hpp"
 
 namespace VPP {
 namespace Engine {
@@ -36,7 +45,7 @@ namespace Engine {
 class Capture : public Engine::ForScene {
     public:
         Capture() noexcept;
-        ~Capture() noexcept = default;
+        ~Capture() noexcept;
 
         Customisation::Error setup() noexcept override;
         Error::Type process(Scene &scene) noexcept override;
@@ -62,15 +71,131 @@ class Capture : public Engine::ForScene {
          * parameters accordingly */
         PARAMETER(Direct, WhiteListed, Callable, std::string) mode;
 
+        /* Decoding backend and (hardware) acceleration preferred by the
+         * inputs supporting such choices */
+        PARAMETER(Direct, WhiteListed, Immediate, std::string) backend;
+        PARAMETER(Direct, WhiteListed, Immediate, std::string) acceleration;
+
+        /* Number of frames read ahead by a capture thread (0 for reading the
+         * frames synchronously in the pipeline) and whether the oldest frames
+         * are dropped to always process the latest one */
+        PARAMETER(Direct, Bounded, Immediate, int) prefetch;
+        PARAMETER(Direct, None, Immediate, bool) dropping;
+
+        /* File caching the modes probed for the identified devices */
+        PARAMETER(Direct, None, Immediate, std::string) modes_cache;
+
+        /* Colour modes required by the next stages (as a list of bgr, hsv,
+         * yuv, ycc or gray), all converted at once on every captured frame */
+        PARAMETER(Direct, None, Callable, std::string) conversions;
+
+        /* Name of the channel publishing the captured frames to the
+         * subscriptions of the other pipelines (empty for not publishing) */
+        PARAMETER(Direct, None, Immediate, std::string) channel;
+
+        /* The static mask of the source, as the inclusion polygons (the whole
+         * frame if none) minus the exclusion polygons, each a list of points
+         * "x,y x,y x,y" normalised to the frame size and separated by ';',
+         * and the masked ratio above which the tiles are skipped and the
+         * zones dropped */
+        PARAMETER(Direct, None, Immediate, std::string)  inclusions;
+        PARAMETER(Direct, None, Immediate, std::string)  exclusions;
+        PARAMETER(Direct, Saturating, Immediate, float)  masking;
+
     private:
+        /* A capture thread reading the frames of an input into a ring of
+         * buffers, for the source jitter not to stall the pipeline */
+        class Prefetcher {
+            public:
+                Prefetcher(Util::IO::Input &in, int depth) noexcept;
+                ~Prefetcher() noexcept;
+
+                /* Prefetchers cannot be copied nor moved */
+                Prefetcher(const Prefetcher& other) = delete;
+                Prefetcher(Prefetcher&& other) = delete;
+                Prefetcher& operator=(const Prefetcher& other) = delete;
+                Prefetcher& operator=(Prefetcher&& other) = delete;
+
+                /* Get the next frame, or the latest one when dropping, only
+                 * waiting when no frame has been read ahead */
+                Error::Type read(cv::Mat &image, Image::Mode &mode,
+                                 bool dropping) noexcept;
+
+            private:
+                struct Slot {
+                    cv::Mat     image;
+                    Image::Mode mode;
+                    Error::Type error;
+                };
+
+                void run() noexcept;
+
+                Util::IO::Input &       input;
+                std::vector<Slot>       slots;
+                std::size_t             head;
+                std::size_t             count;
+                bool                    dropped;
+                bool                    exiting;
+                std::mutex              access;
+                std::condition_variable ready;
+                std::condition_variable served;
+                std::thread             worker;
+        };
+
+        /* The settings a source is opened with (cold ones, reopening the
+         * source when changed) and the settings of the capture thread and of
+         * the publishing (warm ones, only restarting these when changed) */
+        struct Settings {
+            std::string protocol, source, user, password;
+            std::string backend, acceleration;
+            int         width, height, rotation;
+
+            bool operator == (const Settings &other) const noexcept;
+        };
+
+        struct Threading {
+            int         prefetch;
+            std::string channel;
+        };
+
+        Settings snapshot() const noexcept;
+
+        /* Restarting the capture thread and the publishing of an open source
+         * if their settings have changed */
+        void rewire() noexcept;
+
+        /* Rebuilding the mask of the source, as a new one for the scenes in
+         * flight to keep the former one */
+        Customisation::Error remask() noexcept;
+
         Customisation::Error onProtocolUpdate(const std::string &p) noexcept;
         Customisation::Error onSourceUpdate(const std::string &s) noexcept;
         Customisation::Error onUserUpdate(const std::string &u) noexcept;
         Customisation::Error onModeUpdate(const std::string &m) noexcept;
+        Customisation::Error onConversionsUpdate(const std::string &c)
+            noexcept;
+
+        /* Get the modes of the next source from the cache, or probe them and
+         * cache them */
+        std::vector<std::string> probe(const std::string &s) noexcept;
 
         std::vector<std::unique_ptr<Util::IO::Input>> sources;
         Util::IO::Input *                             current;
         Util::IO::Input *                             next;
+        std::unique_ptr<Prefetcher>                   prefetcher;
+        std::shared_ptr<Channel>                      publishing;
+        std::vector<Image::Mode>                      converted;
+        Settings                                      opened;
+        Threading                                     wired;
+        std::shared_ptr<const Util::OCV::Mask>        mask;
+
+        /* Capture instrumentation: the intervals between the captured frames
+         * show the jitter of the source */
+        Util::Histogram                               intervals;
+        std::atomic<uint64_t>                         captured;
+        std::atomic<uint64_t>                         failures;
+        uint64_t                                      last;
+        Util::Metrics::Registry::Handle               exported;
 };
 
 }  // namespace Engine
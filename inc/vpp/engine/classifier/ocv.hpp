@@ -24,12 +24,36 @@ namespace VPP {
 namespace Engine {
 namespace Classifier {
 
+/* Asynchronous classifier: a zone inferred on the inference server (if any)
+ * completes once its response is received, the zones in flight meanwhile
+ * being batched together by the server connection */
 class OCV : public VPP::DNN::Engine::OCV<Zone> {
     public:
         OCV() noexcept;
         ~OCV() noexcept;
 
-        Error::Type process(Scene &scene, Zone &zone) noexcept override;
+        VPP::Core::Operation launch(Scene &scene, Zone &zone) noexcept
+            override;
+
+    private:
+        /* Classifying a zone on the local (shared) network */
+        void classify(Zone &zone, const cv::Mat &input) noexcept;
+};
+
+/* Batched variant: all the zones are letterboxed in a single NCHW blob of at
+ * most batch images and classified with a single forward pass */
+class Batch : public VPP::DNN::Engine::OCV<Zones> {
+    public:
+        Batch() noexcept;
+        ~Batch() noexcept;
+
+        Error::Type process(Scene &scene, Zones &zones) noexcept override;
+
+        /* The maximal number of zones per forward pass */
+        PARAMETER(Direct, Saturating, Immediate, int) batch;
+
+    protected:
+        int batching() noexcept override;
 };
 
 }  // namespace Classifier
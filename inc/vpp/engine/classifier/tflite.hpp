@@ -0,0 +1,38 @@
+/**
+ *
+ * @file      vpp/engine/classifier/tflite.hpp
+ *
+ * @brief     This is the VPP TFLite DNN classifier description file
+ *
+ * @details   This is an engine for running any TensorFlow Lite (TFLite)
+ *            classifier
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include "vpp/dnn/tflite.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Classifier {
+
+class TFLite : public VPP::DNN::Engine::TFLite<Zone> {
+    public:
+        TFLite() noexcept;
+        ~TFLite() noexcept;
+
+        Error::Type process(Scene &scene, Zone &zone) noexcept override;
+};
+
+}  // namespace Classifier
+}  // namespace Engine
+}  // namespace VPP
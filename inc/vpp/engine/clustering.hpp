@@ -35,6 +35,7 @@ class Clustering : public Engine::ForScene {
         Task::Clustering::DilateAndJoin dnj;
 #ifdef VPP_HAS_SIMILARITY_CLUSTERING_SUPPORT
         Task::Clustering::Similarity    similarity;
+        Task::Clustering::Classwise     classwise;
 #endif
 };
 
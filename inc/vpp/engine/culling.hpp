@@ -0,0 +1,64 @@
+/**
+ *
+ * @file      vpp/engine/culling.hpp
+ *
+ * @brief     These are the VPP engines culling the zones out of range
+ *
+ * @details   The zones of a scene with depth are dropped whenever their mean
+ *            depth, in constant time from the integral images of the depth
+ *            map, or their metric size is out of the configured window, for
+ *            the far or tiny zones not to reach the expensive stages.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <atomic>
+
+#include "customisation/parameter.hpp"
+#include "vpp/error.hpp"
+#include "vpp/scene.hpp"
+#include "vpp/engine.hpp"
+#include "vpp/util/metrics.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Culling {
+
+class Depth : public Engine::ForScene {
+    public:
+        Depth() noexcept;
+        ~Depth() noexcept;
+
+        /* Dropping the zones out of the depth and size windows */
+        Error::Type process(Scene &scene) noexcept override;
+
+        /* The depth window in metres */
+        PARAMETER(Direct, Saturating, Immediate, float) nearest;
+        PARAMETER(Direct, Saturating, Immediate, float) farthest;
+
+        /* The window of the largest side of the zones in metres */
+        PARAMETER(Direct, Saturating, Immediate, float) smallest;
+        PARAMETER(Direct, Saturating, Immediate, float) largest;
+
+        /* Are the zones without any valid depth kept? */
+        PARAMETER(Direct, None, Immediate, bool)        unknown;
+
+        /* The number of zones culled */
+        std::atomic<uint64_t> culled;
+
+    private:
+        Util::Metrics::Registry::Handle exported;
+};
+
+}  // namespace Culling
+}  // namespace Engine
+}  // namespace VPP
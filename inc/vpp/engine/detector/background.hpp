@@ -0,0 +1,95 @@
+/**
+ *
+ * @file      vpp/engine/detector/background.hpp
+ *
+ * @brief     This is the VPP background subtraction detector description file
+ *
+ * @details   This is an engine for detecting the foreground zones of a fixed
+ *            camera with a background subtraction model, as a cheap detector
+ *            or as a gate for the costly DNN detectors
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/video/background_segm.hpp>
+
+#include "customisation/parameter.hpp"
+#include "vpp/engine.hpp"
+#include "vpp/error.hpp"
+#include "vpp/scene.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Detector {
+
+class Background : public Engine::ForScene {
+    public:
+        /** Background subtraction models */
+        enum class Model : int {
+            /** Mixture of gaussians */
+            MOG2 = 0,
+            /** K nearest neighbours */
+            KNN  = 1
+        };
+
+        Background() noexcept;
+        ~Background() noexcept = default;
+
+        Customisation::Error setup() noexcept override;
+        Error::Type process(Scene &scene) noexcept override;
+        void terminate() noexcept override;
+
+        /* Update the background model with the scene and measure its share
+         * of foreground pixels, without marking any zone */
+        Error::Type measure(Scene &scene) noexcept;
+
+        /* The share of foreground pixels of the scene, or a negative value
+         * if the scene was not measured */
+        float foreground(const Scene &scene) const noexcept;
+
+        /* The background subtraction model */
+        PARAMETER(Mapped, None, Immediate, int)         model;
+
+        /* The pyramid level of the gray frame the model is built upon */
+        PARAMETER(Direct, Saturating, Immediate, int)   level;
+
+        /* The number of frames the background model is built upon */
+        PARAMETER(Direct, Saturating, Immediate, int)   history;
+
+        /* The squared distance threshold for a pixel to be a foreground one
+         * (the Mahalanobis distance for MOG2, the Euclidean one for KNN) */
+        PARAMETER(Direct, Saturating, Immediate, double) distance;
+
+        /* The learning rate of the model, automatic if negative */
+        PARAMETER(Direct, Saturating, Immediate, double) learning;
+
+        /* The dilation in pixels of the foreground pixels before grouping
+         * them into connected components */
+        PARAMETER(Direct, Saturating, Immediate, int)   dilation;
+
+        /* The minimal area in frame pixels of a foreground zone */
+        PARAMETER(Direct, Saturating, Immediate, int)   area;
+
+    private:
+        cv::Ptr<cv::BackgroundSubtractor> subtractor;
+        cv::Mat                           mask;
+        cv::Mat                           labels;
+        cv::Mat                           stats;
+        cv::Mat                           centroids;
+        uint64_t                          stamp;
+        float                             share;
+};
+
+}  // namespace Detector
+}  // namespace Engine
+}  // namespace VPP
@@ -0,0 +1,118 @@
+/**
+ *
+ * @file      vpp/engine/detector/cascade.hpp
+ *
+ * @brief     This is the VPP cascade detector description file
+ *
+ * @details   A cascade detector runs a fast detector on every scene, and only
+ *            runs an accurate (and slower) detector on the scenes, or on the
+ *            regions of the scenes, where the fast detector finds zones whose
+ *            scores are within an uncertainty band.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include "vpp/config.hpp"
+#ifndef VPP_HAS_OPENCV_DNN_SUPPORT
+# error ERROR: VPP does not have support of OpenCV DNN!
+#endif
+
+#include <atomic>
+#include <list>
+#include <vector>
+
+#include "customisation/parameter.hpp"
+#include "vpp/engine.hpp"
+#include "vpp/engine/detector/ocv.hpp"
+#ifdef VPP_HAS_DARKNET_SUPPORT
+#include "vpp/engine/detector/darknet.hpp"
+#endif
+#include "vpp/util/metrics.hpp"
+#include "vpp/util/ocv/nms.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Detector {
+
+class Cascade : public VPP::Engine::ForScene {
+    public:
+        /* The accurate detector is a Darknet one when available */
+#ifdef VPP_HAS_DARKNET_SUPPORT
+        using Accurate = Darknet;
+#else
+        using Accurate = OCV;
+#endif
+
+        enum class Routing : int {
+            /* The accurate detections replace all the fast ones */
+            FRAME   = 0,
+            /* The accurate detections within the regions of the uncertain
+             * zones replace these uncertain zones only */
+            REGIONS = 1
+        };
+
+        Cascade() noexcept;
+        ~Cascade() noexcept;
+
+        Error::Type process(Scene &scene) noexcept override;
+
+        /* The fast detector zones scoring below low are rejected, and those
+         * scoring below high are uncertain */
+        PARAMETER(Direct, Saturating, Immediate, float) low;
+        PARAMETER(Direct, Saturating, Immediate, float) high;
+
+        PARAMETER(Mapped, None, Immediate, int)         routing;
+
+        /* The share of their size by which the regions of the uncertain zones
+         * are grown on each side, for giving some context to the accurate
+         * detector */
+        PARAMETER(Direct, Saturating, Immediate, float) margin;
+
+        /* The accurate detector must run without any latency for its
+         * detections to be found in the scenes they are requested for */
+        OCV      fast;
+        Accurate accurate;
+
+        /* The statistics of each level of the cascade */
+        struct Level {
+            Level() noexcept;
+
+            Util::Histogram       latency;
+            std::atomic<uint64_t> scenes;
+            std::atomic<uint64_t> zones;
+        };
+
+        Level                 first;
+        Level                 second;
+
+        /* The number of fast detector zones for each outcome */
+        std::atomic<uint64_t> confident;
+        std::atomic<uint64_t> uncertain;
+        std::atomic<uint64_t> rejected;
+
+    private:
+        Error::Type refine(Scene &scene, std::list<Zone> &doubts) noexcept;
+
+        /* The merging of the zones detected in the overlapping regions, with
+         * its reused buffers */
+        Util::OCV::NMS        merger;
+        std::vector<Zone>     found;
+        std::vector<cv::Rect> boxes;
+        std::vector<float>    scores;
+        std::vector<int>      classIds, indices;
+
+        Util::Metrics::Registry::Handle exported;
+};
+
+}  // namespace Detector
+}  // namespace Engine
+}  // namespace VPP
@@ -24,10 +24,19 @@
 # error ERROR: VPP does not have support of Darknet!
 #endif
 
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <opencv2/core/core.hpp>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "customisation/parameter.hpp"
 #include "vpp/dnn/engine.hpp"
+#include "vpp/util/ocv/nms.hpp"
 
 extern "C" {
 #include "darknet/darknet.h"
@@ -39,6 +48,63 @@ namespace Detector {
 
 class Darknet : public VPP::DNN::Engine::ForScene {
     public:
+        /* A Darknet inference service shares a single network loaded with a
+         * given batch size between all the detectors using the same model, 
+         * and serialises their inferences on it. Requests collected within a
+         * time window are inferred in one batch */
+        class Service {
+            public:
+                using Clock = std::chrono::steady_clock;
+
+                /* Sharing the service of a network and batch size, and
+                 * starting it if it does not exist yet */
+                static std::shared_ptr<Service> 
+                    share(const std::string &architecture,
+                          const std::string &weights, int batch) noexcept;
+
+                Service(::network *n, int batch) noexcept;
+                ~Service() noexcept;
+
+                /* Services cannot be copied nor moved */
+                Service(const Service& other) = delete;
+                Service(Service&& other) = delete;
+                Service& operator=(const Service& other) = delete;
+                Service& operator=(Service&& other) = delete;
+
+                /* Infer a network input in the next batch, waiting no longer
+                 * than the window for other requests to join, and get the
+                 * detections for a frame of the given size */
+                detection *infer(const float *input, const cv::Size &frame,
+                                 float threshold, float hierarchy,
+                                 Clock::duration window,
+                                 int &nboxes) noexcept;
+
+                ::network * const net;
+
+            private:
+                struct Request {
+                    const float *     input;
+                    cv::Size          frame;
+                    float             threshold;
+                    float             hierarchy;
+                    Clock::time_point deadline;
+                    detection *       dets;
+                    int               nboxes;
+                    bool              done;
+                };
+
+                void run() noexcept;
+
+                const int               batch;
+                std::vector<float>      buffer;
+                std::mutex              access;
+                std::condition_variable ready;
+                std::condition_variable served;
+                std::vector<Request *>  requests;
+                bool                    exiting;
+                std::thread             worker;
+        };
+
         Darknet() noexcept;
         ~Darknet() noexcept;
 
@@ -49,12 +115,74 @@ class Darknet : public VPP::DNN::Engine::ForScene {
         PARAMETER(Direct, Saturating, Immediate, float) hierarchy;
         PARAMETER(Direct, Saturating, Immediate, float) nms;
 
+        /* Class-aware NMS, and the spread of the Gaussian soft NMS (0 for a
+         * hard NMS) */
+        PARAMETER(Direct, None, Immediate, bool)        classwise;
+        PARAMETER(Direct, Saturating, Immediate, float) soft;
+
+        /* Detection latency in frames: with a latency of 1, the detections of
+         * a frame are attached to the next one, so that inferring a frame
+         * overlaps with post-processing the previous one */
+        PARAMETER(Direct, Saturating, Immediate, int)   latency;
+
+        /* Fused pre-processing: letterbox 8-bit frames straight into the
+         * network input rather than through full-size float planes */
+        PARAMETER(Direct, None, Immediate, bool)        fused;
+
+        /* Batch size of the shared inference service (1 for no batching)
+         * and the time window for collecting a batch in ms */
+        PARAMETER(Direct, Saturating, Immediate, int)   batch;
+        PARAMETER(Direct, Saturating, Immediate, float) window;
+
     private:
+        /* Loading (or reloading) the network of the engine, as a phase of
+         * the startup */
+        Customisation::Error instantiate() noexcept;
+
+        /* The parameters read by the inferences and the post-processing, as
+         * snapshotted once per frame */
+        struct Settings {
+            float                    threshold;
+            float                    hierarchy;
+            float                    nms;
+            bool                     classwise;
+            float                    soft;
+            Service::Clock::duration window;
+        };
+
+        /* Take a snapshot of the parameters for the current frame */
+        Settings snapshot() const noexcept;
+
+        /* Wait for the pending inference (if any) */
+        bool settle() noexcept;
+
+        /* Fill in the network input with the frame */
+        void prepare(const cv::Mat &input) noexcept;
+
+        /* Infer the prepared network input for a frame of the given size */
+        detection *infer(const cv::Size &frame, const Settings &settings,
+                         int &nboxes) noexcept;
+
+        /* Attach the filtered detections to the scene and release them */
+        void capture(Scene &scene, detection *dets, int nboxes,
+                     const Settings &settings) noexcept;
+
+        std::future<int>         pending;
+        detection *              detected;
+        int                      detections;
+        std::shared_ptr<Service> service;
+        int                      batched;
         std::string architecture, weights;
         ::network * net;
         int         input_w, input_h;
-        cv::Mat     input_f, input_p[3];
+        cv::Mat     input_f, input_p[3], resized;
         image       img_input, img_yolo;
+
+        /* The NMS of the detections, with its reused buffers */
+        Util::OCV::NMS        suppression;
+        std::vector<cv::Rect> boxes;
+        std::vector<float>    scores;
+        std::vector<int>      classIds, indices;
 };
 
 }  // namespace Detector
@@ -18,7 +18,11 @@
 
 #pragma once
 
+#include <atomic>
+#include <future>
+
 #include "vpp/dnn/ocv.hpp"
+#include "vpp/util/ocv/nms.hpp"
 
 namespace VPP {
 namespace Engine {
@@ -29,18 +33,105 @@ class OCV : public VPP::DNN::Engine::OCV<> {
         OCV() noexcept;
         ~OCV() noexcept;
 
-        Customisation::Error setup() noexcept override;
         Error::Type process(Scene &scene) noexcept override;
         void terminate() noexcept override;
 
         PARAMETER(Direct, Saturating, Immediate, float) nms;
 
+        /* Class-aware NMS, and the spread of the Gaussian soft NMS (0 for a
+         * hard NMS) */
+        PARAMETER(Direct, None, Immediate, bool)        classwise;
+        PARAMETER(Direct, Saturating, Immediate, float) soft;
+
+        /* Detection latency in frames: with a latency of 1, the detections of
+         * a frame are attached to the next one, so that inferring a frame
+         * overlaps with post-processing the previous one */
+        PARAMETER(Direct, Saturating, Immediate, int)   latency;
+
+        /* Tiling mode: frames larger than the network input are split into
+         * overlapping tiles at the network resolution, which are all inferred
+         * at once in a single batch (without any latency) */
+        PARAMETER(Direct, None, Immediate, bool)        tiled;
+        PARAMETER(Direct, Saturating, Immediate, float) overlap;
+
+        /* Scaling the network input (when it is not tiled), e.g. for a
+         * governor to trade the detection quality for its latency */
+        void rescale(float factor) noexcept;
+
+        /* Detecting only within the regions of interest of a scene, padded
+         * to the network aspect ratio and inferred all at once in a single
+         * batch (without any latency) */
+        Error::Type process(Scene &scene,
+                            const std::vector<cv::Rect> &rois) noexcept;
+
     private:
+        /* Loading the network along with its output layers */
+        Customisation::Error instantiate() noexcept override;
+
+        /* The parameters read by the post-processing, as snapshotted once per
+         * frame */
+        struct Settings {
+            float threshold;
+            float nms;
+            bool  classwise;
+            float soft;
+        };
+
+        /* Take a snapshot of the parameters for the current frame */
+        Settings snapshot() const noexcept;
+
+        /* The candidate detections, whose buffers are reused across frames */
+        struct Candidates {
+            inline void clear() noexcept {
+                classIds.clear();
+                confidences.clear();
+                boxes.clear();
+            }
+
+            std::vector<int>      classIds;
+            std::vector<float>    confidences;
+            std::vector<cv::Rect> boxes;
+        };
+
+        /* Decode the Region output rows in [first, last) of an area */
+        void decode(const cv::Mat &output, int first, int last,
+                    const cv::Rect &area) noexcept;
+
+        /* Drop the regions of a frame mostly in the masked areas (if any) */
+        void unmasked(const Scene &scene, const cv::Size &frame,
+                      std::vector<cv::Rect> &regions) noexcept;
+
+        /* Attach the candidates kept by the NMS (if any) to the scene, the
+         * candidates of overlapping tiles being merged */
+        void attach(Scene &scene, bool merging) noexcept;
+
+        /* The network input scaled to a multiple of the network stride */
+        cv::Size resolution() const noexcept;
+
+        /* Wait for the pending inference (if any) */
+        bool settle() noexcept;
+        
+        /* Attach the detections of a frame of the given size to the scene */
+        Error::Type extract(Scene &scene, std::vector<cv::Mat> &outputs,
+                            const cv::Size &frame) noexcept;
+
+        /* Detect in all the tiles of the input in a single batch */
+        Error::Type tile(Scene &scene, const cv::Mat &input,
+                         const std::vector<cv::Rect> &tiles) noexcept;
+
+        std::future<int>         pending;
+        std::vector<cv::Mat>     outputs;
+        cv::Size                 inferred;
         std::vector<cv::String>  names;
         std::vector<int>         outLayers;
         std::string              outLayerType;
         bool                     needsResizing;
         cv::Mat                  imInfo;
+        Candidates               candidates;
+        Util::OCV::NMS           suppression;
+        std::vector<int>         indices;
+        std::atomic<float>       factor;
+        Settings                 settings;
 };
 
 }  // namespace Detector
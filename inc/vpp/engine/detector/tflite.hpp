@@ -0,0 +1,40 @@
+/**
+ *
+ * @file      vpp/engine/detector/tflite.hpp
+ *
+ * @brief     This is the VPP TFLite DNN detector description file
+ *
+ * @details   This is an engine for running any TensorFlow Lite (TFLite) SSD
+ *            detector, i.e. a network ending with the detection
+ *            post-processing operator, whose outputs are the boxes, the
+ *            classes, the scores and the number of the detections
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include "vpp/dnn/tflite.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Detector {
+
+class TFLite : public VPP::DNN::Engine::TFLite<> {
+    public:
+        TFLite() noexcept;
+        ~TFLite() noexcept;
+
+        Error::Type process(Scene &scene) noexcept override;
+};
+
+}  // namespace Detector
+}  // namespace Engine
+}  // namespace VPP
@@ -0,0 +1,199 @@
+/**
+ *
+ * @file      vpp/engine/link.hpp
+ *
+ * @brief     These are the VPP network link engines definition
+ *
+ * @details   These engines bridge the pipelines of different hosts over TCP:
+ *            an uplink sends the metadata of the scenes in the VPP wire format
+ *            along with the crops of the zones the far side needs, instead of
+ *            the full frames, and a downlink receives them into a bridge, for
+ *            the far side pipelines to consume the same scenes and zones as
+ *            from a local bridge. The frames of the far side scenes are only
+ *            made of the received crops, at their place in the original frame.
+ *
+ *            The uplink queues the messages for a sender thread batching them,
+ *            the queue policy pushing the back pressure of a slow link onto
+ *            the pipeline, and reconnects to the downlink whenever the link
+ *            fails.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "customisation/parameter.hpp"
+#include "vpp/engine.hpp"
+#include "vpp/engine/bridge.hpp"
+#include "vpp/error.hpp"
+#include "vpp/scene.hpp"
+#include "vpp/util/metrics.hpp"
+#include "vpp/wire.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Link {
+
+static constexpr uint32_t MAGIC   = 0x4c505056; /* "VPPL" */
+static constexpr uint16_t VERSION = 1;
+
+/* The header of a link message: size includes the header, the wire message
+ * of the scene and the crops, each of them being padded to 8 bytes */
+struct Header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t crops;
+    int32_t  width, height;
+    uint32_t wire;
+    uint32_t size;
+};
+
+/* The encodings of the crops */
+enum Encoding : uint32_t {
+    RAW  = 0,
+    JPEG = 1
+};
+
+/* The header of a crop, followed by its encoded pixels */
+struct Crop {
+    int32_t  x, y, width, height;
+    uint32_t bytes;
+    uint32_t encoding;
+};
+
+static_assert(sizeof(Header) == 24, "Link::Header is not packed");
+static_assert(sizeof(Crop) == 24, "Link::Crop is not packed");
+
+}  // namespace Link
+
+class Uplink : public Engine::ForScene {
+    public:
+        using Policy = BridgeSlots::Policy;
+
+        Uplink() noexcept;
+        ~Uplink() noexcept;
+
+        Customisation::Error setup() noexcept override;
+        Error::Type process(Scene &scene) noexcept override;
+        void terminate() noexcept override;
+
+        /* The host:port of the downlink, or empty for not sending */
+        PARAMETER(Direct, None, Immediate, std::string) server;
+
+        /* The number of messages queued, and the policy applied to the
+         * messages of a full queue: drop-oldest, drop-newest or block */
+        PARAMETER(Direct, Saturating, Immediate, int)   depth;
+        PARAMETER(Mapped, None, Immediate, int)         policy;
+
+        /* The number of messages sent at once, and how long in milliseconds
+         * the sender waits for a batch to fill */
+        PARAMETER(Direct, Saturating, Immediate, int)   batch;
+        PARAMETER(Direct, Saturating, Immediate, int)   linger;
+
+        /* The JPEG quality of the crops, or 0 for the raw BGR pixels */
+        PARAMETER(Direct, Saturating, Immediate, int)   quality;
+
+        /* How long in milliseconds a connection or a send may take before
+         * the link is deemed failed */
+        PARAMETER(Direct, Saturating, Immediate, int)   timeout;
+
+        /* The optional fields of the zones to send */
+        PARAMETER(Direct, None, Immediate, bool)        contours;
+        PARAMETER(Direct, None, Immediate, bool)        descriptions;
+
+        /* The zones whose crops are sent, all of them if undefined */
+        std::function<bool (const Scene &, const Zone &) noexcept> cropping;
+
+        /* The link statistics */
+        std::atomic<uint64_t>                           sent;
+        std::atomic<uint64_t>                           dropped;
+        std::atomic<uint64_t>                           reconnections;
+
+    private:
+        /* Encoding the message of a scene */
+        void encode(Scene &scene, std::vector<uint8_t> &message) noexcept;
+
+        /* Sending the batches of the queued messages */
+        void run() noexcept;
+        void stop() noexcept;
+
+        Wire::Writer                      writer;
+        std::vector<uint8_t>              encoded;
+        std::mutex                        access;
+        std::condition_variable           queued;
+        std::condition_variable           released;
+        std::deque<std::vector<uint8_t>>  messages;
+        std::vector<std::vector<uint8_t>> spares;
+        bool                              exiting;
+        std::thread                       sender;
+        Util::Metrics::Registry::Handle   exported;
+};
+
+template <typename ...Z> class Downlink : public Core::Engine<Z...> {
+    public:
+        Downlink() noexcept;
+        ~Downlink() noexcept;
+
+        Customisation::Error setup() noexcept override;
+        /* Prepare returns not existing if there is nothing more to process */
+        Error::Type prepare(Scene*& s, Z*&... z) noexcept override;
+        void terminate() noexcept override;
+
+        /* The TCP port the uplinks connect to, and their maximal number */
+        PARAMETER(Direct, Bounded, Immediate, int)      port;
+        PARAMETER(Direct, Saturating, Immediate, int)   links;
+
+        /* The bridge the received scenes are forwarded to, with its depth,
+         * policy and batch, the block policy pushing the back pressure onto
+         * the uplinks */
+        Bridge<Z...>                                    bridge;
+
+        /* The link statistics */
+        std::atomic<uint64_t>                           received;
+        std::atomic<uint64_t>                           rejected;
+
+    private:
+        /* Receiving the messages of the uplinks */
+        void serve() noexcept;
+        void stop() noexcept;
+
+        /* Receiving a message of a link, false if the link failed */
+        bool receive(int fd, uint64_t salt) noexcept;
+
+        /* Rebuilding the scene of a message */
+        bool decode(const uint8_t *message, std::size_t size, uint64_t salt,
+                    Scene &scene) noexcept;
+
+        int                               listener;
+        std::vector<int>                  uplinks;
+        std::vector<uint64_t>             salts;
+        uint64_t                          accepted;
+        std::vector<uint64_t>             storage;
+        std::atomic<bool>                 serving;
+        std::thread                       server;
+        Util::Metrics::Registry::Handle   exported;
+};
+
+/* Describing the downlinks handling single or multiple zones in a scene */
+using DownlinkForZone  = Downlink<Zone>;
+using DownlinkForZones = Downlink<Zones>;
+
+}  // namespace Engine
+}  // namespace VPP
@@ -0,0 +1,74 @@
+/**
+ *
+ * @file      vpp/engine/motion.hpp
+ *
+ * @brief     These are various engines to manage motion within scenes
+ *
+ * @details   This is a collection of engines for finding the regions of the
+ *            scenes with some motion, so that the static parts of the frames
+ *            are not processed again
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <mutex>
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+#include "customisation/parameter.hpp"
+#include "vpp/error.hpp"
+#include "vpp/scene.hpp"
+#include "vpp/engine.hpp"
+#include "vpp/task/motion.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Motion {
+
+class Proposal : public Engine::ForScene {
+    public:
+        Proposal() noexcept;
+        ~Proposal() noexcept = default;
+
+        Customisation::Error setup() noexcept override;
+
+        Error::Type process(Scene &scene) noexcept override;
+
+        /* Get the regions proposed for the scene, if any were computed for
+         * this very scene */
+        bool regions(const Scene &scene, 
+                     std::vector<cv::Rect> &rois) const noexcept;
+
+        /* The minimal flow magnitude in pixels for a moving pixel */
+        PARAMETER(Direct, Saturating, Immediate, float) speed;
+
+        /* The dilation in pixels of the moving pixels before merging them */
+        PARAMETER(Direct, Saturating, Immediate, int)   dilation;
+
+        /* The margin in pixels added around each proposed region */
+        PARAMETER(Direct, Saturating, Immediate, int)   margin;
+
+        /* The minimal area in pixels of a proposed region */
+        PARAMETER(Direct, Saturating, Immediate, int)   area;
+
+        Scene        latest;
+        Task::Motion task;
+
+    private:
+        mutable std::mutex    access;
+        uint64_t              stamp;
+        std::vector<cv::Rect> proposed;
+};
+
+}  // namespace Motion
+}  // namespace Engine
+}  // namespace VPP
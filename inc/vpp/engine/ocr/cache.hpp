@@ -0,0 +1,78 @@
+/**
+ *
+ * @file      vpp/engine/ocr/cache.hpp
+ *
+ * @brief     This is a cache of OCR results keyed by the look of the crops
+ *
+ * @details   The crops are identified by their size and a difference hash of
+ *            their content, so that the unchanged text regions are not read
+ *            again from one frame to another
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <opencv2/core/core.hpp>
+#include <string>
+
+#include "customisation/entity.hpp"
+#include "customisation/parameter.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace OCR {
+
+class Cache : public Parametrisable {
+    public:
+        Cache() noexcept;
+        ~Cache() noexcept = default;
+
+        Customisation::Error clear() noexcept override;
+
+        /* The 64-bit difference hash of a BGR crop */
+        static uint64_t hash(const cv::Mat &crop) noexcept;
+
+        /* Get the text of a similar crop (if any), the most recently used
+         * entries being kept atop */
+        bool recall(const cv::Mat &crop, uint64_t h, 
+                    std::string &text) noexcept;
+
+        /* Store the text read in a crop, dropping the least recently used
+         * entry when full */
+        void store(const cv::Mat &crop, uint64_t h, 
+                   const std::string &text) noexcept;
+
+        /* The maximal number of cached crops (0 for disabling the cache) */
+        PARAMETER(Direct, Saturating, Immediate, int) capacity;
+
+        /* The maximal number of different hash bits between similar crops */
+        PARAMETER(Direct, Saturating, Immediate, int) distance;
+
+    private:
+        struct Entry {
+            cv::Size    size;
+            uint64_t    hash;
+            std::string text;
+        };
+
+        std::list<Entry>::iterator find(const cv::Size &size, 
+                                        uint64_t h) noexcept;
+
+        std::mutex       access;
+        std::list<Entry> entries;
+};
+
+}  // namespace OCR
+}  // namespace Engine
+}  // namespace VPP
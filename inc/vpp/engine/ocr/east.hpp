@@ -0,0 +1,54 @@
+/**
+ *
+ * @file      vpp/engine/ocr/east.hpp
+ *
+ * @brief     This is an EAST DNN engine aimed at detecting areas for OCR
+ *
+ * @details   This is an engine for running an EAST text detector with the
+ *            OpenCV (OCV) DNN module, and marking its rotated text boxes as
+ *            text zones to be read
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+#include "vpp/dnn/ocv.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace OCR {
+
+class EAST : public VPP::DNN::Engine::OCV<> {
+    public:
+        EAST() noexcept;
+        ~EAST() noexcept;
+
+        Error::Type process(Scene &scene) noexcept override;
+
+        PARAMETER(Direct, Saturating, Immediate, float) nms;
+
+    private:
+        /* Decode the rotated boxes out of the score and geometry maps */
+        void decode(const cv::Mat &scores, const cv::Mat &geometry) noexcept;
+
+        /* Buffers reused from one frame to another */
+        std::vector<cv::Mat>         outputs;
+        std::vector<cv::RotatedRect> boxes;
+        std::vector<float>           confidences;
+        std::vector<int>             indices;
+};
+
+}  // namespace OCR
+}  // namespace Engine
+}  // namespace VPP
@@ -2,7 +2,7 @@
  *
  * @file      vpp/engine/ocr/tesseract.hpp
  *
- * @brief     This is the Tesseract OCR engine
+ * @brief     These are the Tesseract OCR engines
  *
  *            This file is part of the VPP framework (see link).
  *
@@ -21,23 +21,77 @@
 # error ERROR: VPP does not support the Tesseract OCR!
 #endif
 
+#include <memory>
+#include <mutex>
+#include <opencv2/core/core.hpp>
 #include <string>
 #include <tesseract/baseapi.h>
+#include <vector>
 
 #include "customisation/parameter.hpp"
 #include "vpp/error.hpp"
 #include "vpp/engine.hpp"
+#include "vpp/engine/ocr/cache.hpp"
 #include "vpp/scene.hpp"
+#include "vpp/task.hpp"
 #include "vpp/types.hpp"
 
 namespace VPP {
 namespace Engine {
 namespace OCR {
 
+/* The pre-processing front-end of the Tesseract readings, providing them with
+ * single-channel crops: either gray or binarised ones, binarised once per
+ * frame for all the zones to read, and upscaled when too small for their text
+ * to be read */
+class Frontend : public Parametrisable {
+    public:
+        /** Binarisations of the gray image */
+        enum class Binarisation : int {
+            /** The gray image as it is */
+            NONE     = 0,
+            /** Mean of the window minus an offset as a threshold */
+            ADAPTIVE = 1,
+            /** Sauvola threshold out of the mean and deviation of the window */
+            SAUVOLA  = 2
+        };
+
+        Frontend() noexcept;
+        ~Frontend() noexcept = default;
+
+        /* Preparing the image of a scene within an area holding all the zones
+         * to read, unless it is already prepared */
+        void prepare(Scene &scene, const cv::Rect &area) noexcept;
+
+        /* The prepared crop of a zone within the prepared area */
+        cv::Mat crop(const cv::Rect &zone) noexcept;
+
+        PARAMETER(Mapped, None, Immediate, int)         binarisation;
+
+        /* The side of the binarisation windows, in pixels */
+        PARAMETER(Direct, Saturating, Immediate, int)   window;
+
+        /* The offset of the adaptive thresholds, in gray levels */
+        PARAMETER(Direct, Saturating, Immediate, float) offset;
+
+        /* The sensitivity to the deviation of the Sauvola thresholds */
+        PARAMETER(Direct, Saturating, Immediate, float) sensitivity;
+
+        /* The minimal height of the crops, the smaller being upscaled to it,
+         * or 0 for never upscaling them */
+        PARAMETER(Direct, Saturating, Immediate, int)   height;
+
+    private:
+        std::mutex access;
+        cv::Mat    source;
+        cv::Rect   area;
+        cv::Mat    prepared;
+};
+
 class Tesseract : public Engine::ForZone {
     public:
         Tesseract() noexcept;
-        ~Tesseract() noexcept = default;
+        ~Tesseract() noexcept;
 
         Customisation::Error setup() noexcept override;
         Error::Type process(Scene &scene, Zone &zone) noexcept override;
@@ -48,13 +102,119 @@ class Tesseract : public Engine::ForZone {
         PARAMETER(Direct, Bounded, Immediate, int)      oem;
         PARAMETER(Direct, Bounded, Immediate, int)      psm;
 
+        /* The minimal confidence (in percents) of the words to keep */
+        PARAMETER(Direct, Saturating, Immediate, float) confidence;
+
+        /* The texts already read in similar crops */
+        Cache cache;
+
+        /* The pre-processing of the crops to read */
+        Frontend preprocessing;
+
     private:
+        /* Initialising the OCR with the language data, as a phase of the
+         * startup */
+        Customisation::Error instantiate() noexcept;
+
+        Util::Task::Startup::Phase loading;
         std::string               current_path, current_language;
         tesseract::OcrEngineMode  current_oem;
         tesseract::PageSegMode    current_psm;
         tesseract::TessBaseAPI    tess;
 };
 
+/* A pool of Tesseract APIs initialised alike, each concurrent reading 
+ * borrowing its own API, and new APIs being only created when all the others
+ * are busy */
+class Pool {
+    public:
+        Pool() noexcept;
+        ~Pool() noexcept;
+
+        /* Initialise the first API with some settings, dropping all others */
+        int init(const std::string &path, const std::string &language,
+                 tesseract::OcrEngineMode oem, 
+                 tesseract::PageSegMode psm) noexcept;
+        void end() noexcept;
+
+        /* Borrow an idle API (or nullptr on error), and give it back */
+        tesseract::TessBaseAPI *acquire() noexcept;
+        void release(tesseract::TessBaseAPI *api) noexcept;
+
+    private:
+        std::unique_ptr<tesseract::TessBaseAPI> create(int &error) noexcept;
+
+        std::mutex                                           access;
+        std::string                                          path, language;
+        tesseract::OcrEngineMode                             oem;
+        tesseract::PageSegMode                               psm;
+        std::vector<std::unique_ptr<tesseract::TessBaseAPI>> apis;
+        std::vector<tesseract::TessBaseAPI *>                idle;
+};
+
+/* Reading all the zones handed over at once, in parallel */
+class Tesseracts : public Engine::ForZones {
+    public:
+        class Reading : public VPP::Tasks::List<Reading, Zones&, Scene&> {
+            public:
+                using Parent = VPP::Tasks::List<Reading, Zones&, Scene&>;
+                using typename Parent::Mode;
+                using Parent::process;
+                using Parent::next;
+
+                explicit Reading(const int mode, Pool &p, Cache &c,
+                                 Frontend &f) noexcept;
+                virtual ~Reading() noexcept = default;
+
+                Error::Type process(Zone &zone, Scene &scene) noexcept;
+
+                /* The minimal confidence of the words to keep */
+                float minimal;
+
+            private:
+                Pool     &pool;
+                Cache    &cache;
+                Frontend &frontend;
+        };
+
+        Tesseracts() noexcept;
+        ~Tesseracts() noexcept;
+
+        Customisation::Error setup() noexcept override;
+        Error::Type process(Scene &scene, Zones &zones) noexcept override;
+        void terminate() noexcept override;
+
+        PARAMETER(Direct, None, Immediate, std::string) path;
+        PARAMETER(Direct, None, Immediate, std::string) language;
+        PARAMETER(Direct, Bounded, Immediate, int)      oem;
+        PARAMETER(Direct, Bounded, Immediate, int)      psm;
+
+        /* The minimal confidence (in percents) of the words to keep */
+        PARAMETER(Direct, Saturating, Immediate, float) confidence;
+
+        /* Only the zones matching the selection are read */
+        Scene::ZoneFilter selection;
+
+        /* The texts already read in similar crops */
+        Cache    cache;
+
+        /* The pre-processing of the crops to read */
+        Frontend preprocessing;
+
+        Pool     apis;
+        Reading  reading;
+
+    private:
+        /* Initialising the OCR with the language data, as a phase of the
+         * startup */
+        Customisation::Error instantiate() noexcept;
+
+        Util::Task::Startup::Phase loading;
+        std::string               current_path, current_language;
+        tesseract::OcrEngineMode  current_oem;
+        tesseract::PageSegMode    current_psm;
+};
+
 }  // namespace OCR
 }  // namespace Engine
 }  // namespace VPP
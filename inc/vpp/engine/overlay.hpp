@@ -19,6 +19,9 @@
 
 #pragma once
 
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 
@@ -49,30 +52,78 @@ class Logo : public Customisation::Entity {
         Logo() noexcept;
         ~Logo() noexcept = default;
 
-        VPP::UI::Overlay::Layer                  layer;
-        PARAMETER(Direct, None, Immediate, bool) show;
-        VPP::Offset                              at;
+        /* The style of the logo for a given overlay */
+        LayerStyle style(const VPP::UI::Overlay &overlay) const noexcept;
+
+        VPP::UI::Overlay::Layer                       layer;
+        PARAMETER(Direct, None, Immediate, bool)      show;
+        VPP::Offset                                   at;
+        PARAMETER(Direct, Saturating, Immediate, int) reference;
+};
+
+/* The immutable drawings of a scene, captured once styled */
+struct Drawing {
+    uint64_t                ts;
+    VPP::UI::Overlay::Batch batch;
+    bool                    logo;
+};
+using Drawings = std::shared_ptr<const Drawing>;
+
+/* The frame of a scene along with its deferred drawings, if any */
+struct Frame {
+    cv::Mat  image;
+    Drawings drawings;
 };
 
 template <typename ...Z> class Core : public VPP::Core::Engine<Z...> {
     public:
+        enum class Rendering : int {
+            /** Drawing in the scene drawable, within the pipeline */
+            INLINE   = 0,
+            /** Only capturing the drawings of the scene within the pipeline,
+             *  the consumers rendering them into their frames */
+            DEFERRED = 1,
+            /** Drawing nothing at all, e.g. for headless deployments */
+            NONE     = 2
+        };
 
         Core() noexcept;
         ~Core() noexcept = default;
 
         Error::Type process(Scene &scene, Z&...z) noexcept override;
 
-        void define(std::string name, ZoneStylist s) noexcept;
+        /* Defining a style, whose stylist may only depend on the class of
+         * the zones (classwise) for being called once per class of a scene
+         * rather than once per zone */
+        void define(std::string name, ZoneStylist s,
+                    bool classwise = false) noexcept;
+
+        /* Capturing the frame of a scene with its deferred drawings, e.g. in
+         * the context of a notifier */
+        Frame capture(const Scene &scene) const noexcept;
+
+        /* Rendering the deferred drawings of a frame into this frame, e.g. in
+         * a dispatcher thread */
+        void render(Frame &frame) const noexcept;
 
         VPP::UI::Overlay                                         overlay;
         PARAMETER(Direct, WhiteListed, Callable, std::string)    style;
+        PARAMETER(Mapped, None, Immediate, int)                  rendering;
         Logo                                                     logo;
 
     private:
         Customisation::Error onStyleUpdate(const std::string &s) noexcept;
 
+        /* Keeping the drawings of the latest scenes for their consumers */
+        void defer(const Scene &scene) noexcept;
+
         ZoneStylist *                                stylist;
+        bool                                         memoised;
         std::unordered_map<std::string, ZoneStylist> styles;
+        std::unordered_map<std::string, bool>        classwise;
+
+        mutable std::mutex                           access;
+        std::deque<Drawings>                         drawings;
 };
 
 /* Describing an engine for handling a full scene */
@@ -0,0 +1,66 @@
+/**
+ *
+ * @file      vpp/engine/publisher.hpp
+ *
+ * @brief     This is the VPP publisher engine definition
+ *
+ * @details   This engine publishes the metadata of the scenes in the VPP wire
+ *            format, either to an in-process sink or by appending them to a
+ *            file or a named pipe, a single reused buffer holding the message
+ *            of the latest scene.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <fstream>
+#include <functional>
+#include <string>
+
+#include "customisation/parameter.hpp"
+#include "vpp/engine.hpp"
+#include "vpp/error.hpp"
+#include "vpp/scene.hpp"
+#include "vpp/wire.hpp"
+
+namespace VPP {
+namespace Engine {
+
+class Publisher : public Engine::ForScene {
+    public:
+        /* The sink of the messages, which are only valid within the call */
+        using Sink = std::function<void (const uint8_t *data,
+                                         std::size_t size) noexcept>;
+
+        Publisher() noexcept;
+        ~Publisher() noexcept = default;
+
+        Customisation::Error setup() noexcept override;
+        Error::Type process(Scene &scene) noexcept override;
+        void terminate() noexcept override;
+
+        /* The file or named pipe to append the messages to, if any */
+        PARAMETER(Direct, None, Immediate, std::string) path;
+
+        /* The optional fields of the zones to publish */
+        PARAMETER(Direct, None, Immediate, bool)        contours;
+        PARAMETER(Direct, None, Immediate, bool)        descriptions;
+
+        /* The in-process sink of the messages, if any */
+        Sink                                            sink;
+
+    private:
+        Wire::Writer  writer;
+        std::ofstream file;
+};
+
+}  // namespace Engine
+}  // namespace VPP
@@ -0,0 +1,51 @@
+/**
+ *
+ * @file      vpp/engine/recorder.hpp
+ *
+ * @brief     This is the VPP recorder engine definition
+ *
+ * @details   This engine records the original images and timestamps of the
+ *            scenes in a recording, to be replayed with the "vpp/file"
+ *            capture protocol.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <string>
+
+#include "customisation/parameter.hpp"
+#include "vpp/error.hpp"
+#include "vpp/scene.hpp"
+#include "vpp/engine.hpp"
+#include "vpp/util/io/recording.hpp"
+
+namespace VPP {
+namespace Engine {
+
+class Recorder : public Engine::ForScene {
+    public:
+        Recorder() noexcept;
+        ~Recorder() noexcept = default;
+
+        Customisation::Error setup() noexcept override;
+        Error::Type process(Scene &scene) noexcept override;
+        void terminate() noexcept override;
+
+        /* The recording to append the scenes to */
+        PARAMETER(Direct, None, Immediate, std::string) path;
+
+    private:
+        Util::IO::Recorder recorder;
+};
+
+}  // namespace Engine
+}  // namespace VPP
@@ -0,0 +1,149 @@
+/**
+ *
+ * @file      vpp/engine/reid/gallery.hpp
+ *
+ * @brief     This is the VPP re-identification gallery description file
+ *
+ * @details   A gallery keeps one appearance embedding per tracked UUID in a
+ *            fixed-size contiguous matrix, the least recently seen UUIDs being
+ *            replaced first, so that the embeddings outlive their tracks. The
+ *            embeddings of the zones of a scene are staged before it is
+ *            tracked, scored against the tracked ones in a single GEMM as a
+ *            matcher measure, and folded into the gallery once tracked.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <cstring>
+#include <mutex>
+#include <opencv2/core/core.hpp>
+#include <unordered_map>
+#include <vector>
+
+#include "customisation/parameter.hpp"
+#include "vpp/error.hpp"
+#include "vpp/scene.hpp"
+#include "vpp/task/matcher.hpp"
+#include "vpp/tracker.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Reid {
+
+class Gallery : public Parametrisable {
+    public:
+        Gallery() noexcept;
+        ~Gallery() noexcept = default;
+
+        Customisation::Error setup() noexcept override;
+
+        /* The number of UUIDs kept in the gallery */
+        PARAMETER(Direct, Saturating, Immediate, int)   capacity;
+
+        /* The weight of the former embedding of a UUID when folding a new
+         * one into it */
+        PARAMETER(Direct, Saturating, Immediate, float) momentum;
+
+        /* Staging the L2-normalised embeddings of some zones of a scene about
+         * to be tracked, one row per zone */
+        void stage(const std::vector<const Zone *> &zones,
+                   const cv::Mat &embeddings) noexcept;
+
+        /* Folding the staged embeddings of the tracked scene zones into the
+         * gallery rows of their UUIDs */
+        void commit(const Scene &scene) noexcept;
+
+        /* The cosine similarities of tracker contexts, one row per source and
+         * one column per destination, unknown contexts scoring 0 */
+        template <typename Src, typename Dst>
+            Error::Type similarities(const Src &srcs, const Dst &dsts,
+                                     cv::Mat &results) noexcept {
+            std::lock_guard<std::mutex> lock(access);
+            const int n = static_cast<int>(srcs.size());
+            const int m = static_cast<int>(dsts.size());
+            results.create(n, m, CV_32F);
+            if ( (n == 0) || (m == 0) || (rows.empty()) ) {
+                results.setTo(0);
+                return Error::NONE;
+            }
+
+            /* Gather the embeddings and score them all at once */
+            gather(srcs, a);
+            gather(dsts, b);
+            cv::gemm(a, b, 1.0, cv::noArray(), 0.0, results, cv::GEMM_2_T);
+
+            return Error::NONE;
+        }
+
+        /* The cosine similarity of two tracker contexts */
+        float similarity(const VPP::Tracker::Context &one,
+                         const VPP::Tracker::Context &other) noexcept;
+
+        /* Defining the cosine measure of a matcher of tracker contexts */
+        template <typename Src, typename Dst,
+                  template <typename, typename> class Evaluator>
+            void serve(VPP::Task::Matcher::Generic<Src, Dst, Evaluator> &m)
+            noexcept {
+            using VPP::Task::Matcher::containee_object_t;
+            using VPP::Task::Matcher::storable_wrapper_t;
+
+            m.define("cosine",
+                     [this](containee_object_t<Src> &s,
+                            containee_object_t<Dst> &d) noexcept {
+                         return similarity(s, d); },
+                     [this](storable_wrapper_t<Src> &ss,
+                            storable_wrapper_t<Dst> &ds,
+                            cv::Mat &results) noexcept {
+                         return similarities(ss, ds, results); });
+        }
+
+    private:
+        /* The embedding of a context: the staged one of its original zone if
+         * any, or the gallery one of its UUID, or nullptr if unknown */
+        const float *embedding(const VPP::Tracker::Context &c) const noexcept;
+
+        template <typename L>
+            void gather(const L &contexts, cv::Mat &into) const noexcept {
+            into.create(static_cast<int>(contexts.size()), rows.cols, CV_32F);
+            int i = 0;
+            for (auto &c : contexts) {
+                const VPP::Tracker::Context &context = c;
+                auto e = embedding(context);
+                if (e != nullptr) {
+                    std::memcpy(into.ptr<float>(i), e,
+                                rows.cols * sizeof(float));
+                } else {
+                    into.row(i).setTo(0);
+                }
+                ++i;
+            }
+        }
+
+        std::mutex                               access;
+
+        /* The gallery rows, their UUIDs and latest timestamps */
+        cv::Mat                                  rows;
+        std::vector<uint64_t>                    owners;
+        std::vector<uint64_t>                    stamps;
+        std::unordered_map<uint64_t, int>        index;
+
+        /* The staged embeddings, by zone */
+        cv::Mat                                  staged;
+        std::unordered_map<const Zone *, int>    probes;
+
+        /* The gathered embeddings, kept across the scenes */
+        cv::Mat                                  a, b;
+};
+
+}  // namespace Reid
+}  // namespace Engine
+}  // namespace VPP
@@ -0,0 +1,46 @@
+/**
+ *
+ * @file      vpp/engine/reid/ocv.hpp
+ *
+ * @brief     This is the VPP OCV DNN re-identification description file
+ *
+ * @details   This is an engine for running any OpenCV (OCV) DNN appearance
+ *            embedding network on all the zones of a scene in batches, and for
+ *            staging the L2-normalised embeddings in a gallery.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include "vpp/dnn/ocv.hpp"
+#include "vpp/engine/reid/gallery.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Reid {
+
+class OCV : public VPP::DNN::Engine::OCV<> {
+    public:
+        explicit OCV(Gallery &g) noexcept;
+        ~OCV() noexcept;
+
+        Error::Type process(Scene &scene) noexcept override;
+
+        /* The maximal number of zones per forward pass */
+        PARAMETER(Direct, Saturating, Immediate, int) batch;
+
+    private:
+        Gallery &gallery;
+};
+
+}  // namespace Reid
+}  // namespace Engine
+}  // namespace VPP
@@ -0,0 +1,83 @@
+/**
+ *
+ * @file      vpp/engine/selection.hpp
+ *
+ * @brief     These are the VPP engines selecting the zones to process
+ *
+ * @details   The zones of a scene are ranked by their utility, as weighted
+ *            from their size, their detection score, the time since they were
+ *            last selected and their distance from the frame centre. Only the
+ *            most useful ones are kept for the expensive zone stages, the
+ *            others being deferred to the next scenes.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "customisation/parameter.hpp"
+#include "vpp/error.hpp"
+#include "vpp/scene.hpp"
+#include "vpp/engine.hpp"
+#include "vpp/util/metrics.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Selection {
+
+class Utility : public Engine::ForZones {
+    public:
+        Utility() noexcept;
+        ~Utility() noexcept;
+
+        Customisation::Error setup() noexcept override;
+
+        /* Ranking the zones, and only keeping the most useful ones */
+        Error::Type process(Scene &scene, Zones &zones) noexcept override;
+
+        /* The weights of the utility terms */
+        PARAMETER(Direct, Saturating, Immediate, float) size;
+        PARAMETER(Direct, Saturating, Immediate, float) score;
+        PARAMETER(Direct, Saturating, Immediate, float) staleness;
+        PARAMETER(Direct, Saturating, Immediate, float) centrality;
+
+        /* The time in milliseconds after which a zone is fully stale */
+        PARAMETER(Direct, Saturating, Immediate, int)   horizon;
+
+        /* The maximal number of zones kept (0 for no limit), and the budget
+         * in milliseconds they shall fit in (0 for no budget) */
+        PARAMETER(Direct, Saturating, Immediate, int)   most;
+        PARAMETER(Direct, Saturating, Immediate, int)   budget;
+
+        /* The cost probe of a zone in nanoseconds, no budget applying if not
+         * set or if the cost is not known yet */
+        std::function<uint64_t () noexcept> costing;
+
+        /* The number of zones deferred to the next scenes */
+        std::atomic<uint64_t> deferred;
+
+    private:
+        float utility(const Scene &scene, const Zone &z) const noexcept;
+
+        /* The timestamp of the scene each zone was last selected in */
+        std::unordered_map<uint64_t, uint64_t> selected;
+        std::vector<std::pair<float, std::size_t>> ranks;
+        Zones                                  kept;
+        Util::Metrics::Registry::Handle        exported;
+};
+
+}  // namespace Selection
+}  // namespace Engine
+}  // namespace VPP
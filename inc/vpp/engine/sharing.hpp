@@ -0,0 +1,63 @@
+/**
+ *
+ * @file      vpp/engine/sharing.hpp
+ *
+ * @brief     This is the VPP sharing engine definition
+ *
+ * @details   This engine shares the output frames of the scenes, along with
+ *            their metadata in the VPP wire format, with the co-located
+ *            processes through a shared-memory ring, the frames being copied
+ *            once into the ring and viewed in place by the taps.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <string>
+
+#include "customisation/parameter.hpp"
+#include "vpp/engine.hpp"
+#include "vpp/error.hpp"
+#include "vpp/scene.hpp"
+#include "vpp/util/io/ring.hpp"
+#include "vpp/wire.hpp"
+
+namespace VPP {
+namespace Engine {
+
+class Sharing : public Engine::ForScene {
+    public:
+        Sharing() noexcept;
+        ~Sharing() noexcept = default;
+
+        Customisation::Error setup() noexcept override;
+        Error::Type process(Scene &scene) noexcept override;
+        void terminate() noexcept override;
+
+        /* The ring file, e.g. in /dev/shm, or empty for not sharing */
+        PARAMETER(Direct, None, Immediate, std::string) path;
+
+        /* The number of slots of the ring and their size in megabytes */
+        PARAMETER(Direct, Saturating, Immediate, int)   slots;
+        PARAMETER(Direct, Saturating, Immediate, int)   size;
+
+        /* The optional fields of the zones to share */
+        PARAMETER(Direct, None, Immediate, bool)        contours;
+        PARAMETER(Direct, None, Immediate, bool)        descriptions;
+
+    private:
+        Util::IO::Ring ring;
+        Wire::Writer   writer;
+        bool           oversized;
+};
+
+}  // namespace Engine
+}  // namespace VPP
@@ -0,0 +1,77 @@
+/**
+ *
+ * @file      vpp/engine/stillness.hpp
+ *
+ * @brief     These are the VPP engines detecting the still scenes
+ *
+ * @details   A still scene is nearly identical to the last processed one, as
+ *            compared on a tiny gray thumbnail, either from their sum of
+ *            absolute differences or from their perceptual (difference) hash.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <atomic>
+#include <opencv2/core/core.hpp>
+
+#include "customisation/parameter.hpp"
+#include "vpp/error.hpp"
+#include "vpp/scene.hpp"
+#include "vpp/engine.hpp"
+#include "vpp/util/metrics.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Stillness {
+
+class Difference : public Engine::ForScene {
+    public:
+        enum class Method : int {
+            /* Mean absolute difference of the gray levels */
+            SAD   = 0,
+            /* Share of the differing bits of the 64-bit difference hashes */
+            HASH  = 1
+        };
+
+        Difference() noexcept;
+        ~Difference() noexcept;
+
+        Customisation::Error setup() noexcept override;
+
+        /* Marking the still scenes as such */
+        Error::Type process(Scene &scene) noexcept override;
+
+        PARAMETER(Mapped, None, Immediate, int)         method;
+
+        /* The side in pixels of the thumbnail compared by the SAD method */
+        PARAMETER(Direct, Saturating, Immediate, int)   side;
+
+        /* The change below which a scene is still, in [0, 1] */
+        PARAMETER(Direct, Saturating, Immediate, float) threshold;
+
+        /* The maximal number of successive still scenes, for the scenes to
+         * be processed again once in a while */
+        PARAMETER(Direct, Saturating, Immediate, int)   longest;
+
+        /* The number of scenes found still */
+        std::atomic<uint64_t> skipped;
+
+    private:
+        cv::Mat                         reference;
+        uint64_t                        hash;
+        int                             successive;
+        Util::Metrics::Registry::Handle exported;
+};
+
+}  // namespace Stillness
+}  // namespace Engine
+}  // namespace VPP
@@ -0,0 +1,103 @@
+/**
+ *
+ * @file      vpp/engine/streamer.hpp
+ *
+ * @brief     This is the VPP streamer engine definition
+ *
+ * @details   This engine serves the output frames of the scenes as a Motion
+ *            JPEG stream over HTTP ('GET /stream') to any number of clients.
+ *            The frames are only captured while some clients are connected,
+ *            and are rendered, scaled down and encoded once in the server
+ *            thread whatever the number of clients, within a frame rate cap.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include "vpp/config.hpp"
+#ifndef VPP_HAS_IMAGE_CODEC_SUPPORT
+# error ERROR: VPP does not have support of OpenCV image codecs!
+#endif
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "customisation/parameter.hpp"
+#include "vpp/engine.hpp"
+#include "vpp/error.hpp"
+#include "vpp/scene.hpp"
+#include "vpp/util/metrics.hpp"
+
+namespace VPP {
+namespace Engine {
+
+class Streamer : public Engine::ForScene {
+    public:
+        /* The renderer of a captured frame, called in the server thread, and
+         * its capture from a scene, called in the pipeline */
+        using Renderer = std::function<cv::Mat () noexcept>;
+        using Capture  = std::function<Renderer (const Scene &) noexcept>;
+
+        Streamer() noexcept;
+        ~Streamer() noexcept;
+
+        Customisation::Error setup() noexcept override;
+        Error::Type process(Scene &scene) noexcept override;
+        void terminate() noexcept override;
+
+        /* The TCP port serving the stream, or 0 for not serving it */
+        PARAMETER(Direct, Bounded, Immediate, int)      port;
+
+        /* The JPEG quality of the stream */
+        PARAMETER(Direct, Saturating, Immediate, int)   quality;
+
+        /* The frame rate and width caps of the stream, 0 for no cap */
+        PARAMETER(Direct, Saturating, Immediate, float) fps;
+        PARAMETER(Direct, Saturating, Immediate, int)   width;
+
+        /* The maximal number of clients */
+        PARAMETER(Direct, Saturating, Immediate, int)   clients;
+
+        /* The capture of the frames, copying the scene output by default */
+        Capture                                         capture;
+
+        /* The encoding latencies and the number of encoded frames */
+        Util::Histogram                                 encoding;
+        std::atomic<uint64_t>                           frames;
+
+    private:
+        void serve() noexcept;
+        void stop() noexcept;
+        void admit(int client) noexcept;
+        void broadcast(const std::vector<uint8_t> &jpeg) noexcept;
+
+        std::atomic<bool>               serving;
+        std::thread                     server;
+        int                             listener;
+        int                             wakeup[2];
+
+        /* The latest captured frame, not yet rendered, and its timestamp */
+        std::mutex                      access;
+        Renderer                        pending;
+        uint64_t                        latest;
+
+        /* The connected clients, only handled by the server thread */
+        std::vector<int>                viewers;
+        std::atomic<int>                connected;
+
+        Util::Metrics::Registry::Handle exported;
+};
+
+}  // namespace Engine
+}  // namespace VPP
@@ -0,0 +1,146 @@
+/**
+ *
+ * @file      vpp/engine/subscription.hpp
+ *
+ * @brief     This is the VPP subscription engine definition
+ *
+ * @details   This is an input engine getting the frames captured by a capture
+ *            engine of another pipeline, for several pipelines to analyse the
+ *            same camera opened only once. The capture publishes its views on
+ *            a named channel as immutable frames counted by reference, and
+ *            every subscription queues these frames with its own policy, the
+ *            views of all the pipelines sharing the same image buffers.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "customisation/parameter.hpp"
+#include "vpp/error.hpp"
+#include "vpp/scene.hpp"
+#include "vpp/engine.hpp"
+#include "vpp/util/metrics.hpp"
+
+namespace VPP {
+namespace Engine {
+
+/* A channel fanning the views published by a capture out to the queues of
+ * its subscriptions. A published view is copied once into a frame, whose
+ * images share the buffers of the captured ones, and the subscriptions only
+ * hold references to this frame */
+class Channel final {
+    public:
+        using Frame = std::shared_ptr<const View>;
+
+        /** What to do with a frame published to a full queue */
+        enum class Policy : int {
+            /** Drop the oldest frame waiting in the queue */
+            DROP_OLDEST = 0,
+            /** Drop the frame being published */
+            DROP_NEWEST = 1,
+            /** Block the capture until a frame is consumed */
+            BLOCK       = 2
+        };
+
+        /* The queue of frames of a subscription */
+        class Queue final {
+            public:
+                Queue() noexcept;
+                ~Queue() noexcept = default;
+
+                /* Empty and reopen the queue with a given depth and policy */
+                void reset(int depth, Policy policy) noexcept;
+
+                /* Queue a frame according to the policy */
+                void push(const Frame &frame) noexcept;
+
+                /* Get the next frame, waiting at most for some milliseconds,
+                 * or nullptr if none was published in the meantime */
+                Frame pop(int ms) noexcept;
+
+                /* Release any blocked capture and consumer until reset */
+                void close() noexcept;
+
+                /* The number of frames received, and dropped by the queue */
+                std::atomic<uint64_t>   received;
+                std::atomic<uint64_t>   dropped;
+
+            private:
+                std::size_t             depth;
+                Policy                  policy;
+                std::deque<Frame>       frames;
+                bool                    closed;
+                std::mutex              access;
+                std::condition_variable pushed;
+                std::condition_variable popped;
+        };
+
+        Channel() noexcept;
+        ~Channel() noexcept = default;
+
+        /* Channels cannot be copied nor moved */
+        Channel(const Channel& other) = delete;
+        Channel(Channel&& other) = delete;
+        Channel& operator=(const Channel& other) = delete;
+        Channel& operator=(Channel&& other) = delete;
+
+        /* Get the channel of a given name, shared by its capture and all its
+         * subscriptions for as long as any of them uses it */
+        static std::shared_ptr<Channel> share(const std::string &name)
+            noexcept;
+
+        /* Publish a view to all the subscribed queues, if any */
+        void publish(const View &view) noexcept;
+
+        void subscribe(const std::shared_ptr<Queue> &queue) noexcept;
+        void unsubscribe(const std::shared_ptr<Queue> &queue) noexcept;
+
+    private:
+        std::mutex                          access;
+        std::vector<std::shared_ptr<Queue>> queues;
+};
+
+class Subscription : public Engine::ForScene {
+    public:
+        using Policy = Channel::Policy;
+
+        Subscription() noexcept;
+        ~Subscription() noexcept;
+
+        Customisation::Error setup() noexcept override;
+        /* Process retries when no frame was published for a while */
+        Error::Type process(Scene &scene) noexcept override;
+        void terminate() noexcept override;
+
+        /* The name of the channel published by a capture engine */
+        PARAMETER(Direct, None, Immediate, std::string) channel;
+
+        /* The number of frames queued, and the policy applied to the frames
+         * published to a full queue */
+        PARAMETER(Direct, Saturating, Immediate, int)   depth;
+        PARAMETER(Mapped, None, Immediate, int)         policy;
+
+    private:
+        std::shared_ptr<Channel>         joined;
+        std::shared_ptr<Channel::Queue>  queue;
+        Util::Metrics::Registry::Handle  exported;
+};
+
+}  // namespace Engine
+}  // namespace VPP
@@ -26,6 +26,7 @@
 #include "vpp/scene.hpp"
 #include "vpp/task/tracker/histogram.hpp"
 #include "vpp/task/matcher.hpp"
+#include "vpp/util/mutex.hpp"
 
 namespace VPP {
 namespace Engine {
@@ -38,7 +39,7 @@ class CamShift : public VPP::Engine::ForScene {
                                             VPP::Tracker::Histogram::Contexts&,
                                             VPP::Task::Matcher::Estimator::Any>;
 
-        CamShift(Scene &history, std::mutex &synchro,
+        CamShift(Scene &history, Util::Mutex &synchro,
                  std::vector<Zone> *added = nullptr,
                  std::vector<Zone> *removed = nullptr) noexcept;
         ~CamShift() noexcept = default;
@@ -51,10 +52,13 @@ class CamShift : public VPP::Engine::ForScene {
         Matcher                                    matcher;
 
     private:
-        std::mutex &                          update;
+        Util::Mutex &                         update;
         Scene &                               latest;
         std::vector<Zone> *                   entering;
         std::vector<Zone> *                   leaving;
+
+        /* The new zones of the scene, kept allocated across the scenes */
+        Zones                                 zones;
 };
 
 }  // namespace Tracker
@@ -21,6 +21,7 @@
 #include <mutex>
 
 #include "vpp/engine.hpp"
+#include "vpp/util/mutex.hpp"
 
 namespace VPP {
 namespace Engine {
@@ -28,7 +29,7 @@ namespace Tracker {
 
 class History : public VPP::Engine::ForScene {
     public:
-        explicit History(Scene &history, std::mutex &synchro) noexcept;
+        explicit History(Scene &history, Util::Mutex &synchro) noexcept;
         ~History() noexcept;
 
         Customisation::Error setup() noexcept override;
@@ -36,7 +37,7 @@ class History : public VPP::Engine::ForScene {
 
     private:
         Scene      &latest;
-        std::mutex &update;
+        Util::Mutex &update;
 };
 
 }  // namespace Tracker
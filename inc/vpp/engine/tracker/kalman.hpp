@@ -21,11 +21,15 @@
 
 #pragma once
 
+#include <opencv2/core/core.hpp>
+#include <vector>
+
 #include "vpp/error.hpp"
 #include "vpp/engine.hpp"
 #include "vpp/scene.hpp"
 #include "vpp/task/tracker/kalman.hpp"
 #include "vpp/task/matcher.hpp"
+#include "vpp/util/mutex.hpp"
 
 namespace VPP {
 namespace Engine {
@@ -33,12 +37,20 @@ namespace Tracker {
 
 class Kalman : public VPP::Engine::ForScene {
     public:
+        enum class Association : int {
+            /* All the new zones are matched at once with the tracked ones */
+            SINGLE = 0,
+            /* The confident new zones are matched first, and the remaining
+             * ones only continue the tracks left unmatched */
+            BYTE   = 1
+        };
+
         using Matcher = 
                 VPP::Task::Matcher::Generic<VPP::Tracker::Kalman::Contexts&,
                                             VPP::Tracker::Kalman::Contexts&,
                                             VPP::Task::Matcher::Estimator::Any>;
 
-        Kalman(Scene &history, std::mutex &synchro,
+        Kalman(Scene &history, Util::Mutex &synchro,
                std::vector<Zone> *added = nullptr,
                std::vector<Zone> *removed = nullptr) noexcept;
         ~Kalman() noexcept = default;
@@ -47,16 +59,57 @@ class Kalman : public VPP::Engine::ForScene {
 
         Error::Type process(Scene &scene) noexcept override;
 
+        /* Forecasting the regions of the tracked zones in a scene, grown by
+         * sigmas standard deviations of their uncertainty so that a detector
+         * only looks there, false if nothing is tracked */
+        bool regions(const Scene &scene, float sigmas,
+                     std::vector<cv::Rect> &rois) noexcept;
+
         VPP::Tracker::Kalman::Engine           engine;
         VPP::Task::Tracker::Kalman::Prediction prediction;
         VPP::Task::Tracker::Kalman::Correction correction;
         Matcher                               matcher;
 
+        /* The association of the new zones with the tracked ones, and the
+         * score from which a new zone is confident. The unconfident zones are
+         * matched by the recovery matcher, and never start a new track */
+        PARAMETER(Mapped, None, Immediate, int)         association;
+        PARAMETER(Direct, Saturating, Immediate, float) confidence;
+        Matcher                               recovery;
+
+        /* Whether the zones are tracked in metres when the view has depth,
+         * rather than in pixels, the zones being deprojected for it */
+        PARAMETER(Direct, None, Immediate, bool)        depth;
+
+        /* The squared Mahalanobis distance beyond which a new zone cannot be
+         * a tracked one with the mahalanobis measures of the matchers */
+        PARAMETER(Direct, Saturating, Immediate, float) gate;
+
     private:
-        std::mutex &                          update;
+        /* Defining the mahalanobis measures of a matcher */
+        void serve(Matcher &m) noexcept;
+
+        /* Matching the sources with the destinations and merging them, the
+         * matched destinations being flagged (if requested) */
+        Error::Type associate(Matcher &m, VPP::Tracker::Kalman::Contexts &src,
+                              VPP::Tracker::Kalman::Contexts &dst,
+                              std::vector<bool> *matched = nullptr) noexcept;
+
+        Util::Mutex &                         update;
         Scene &                               latest;
         std::vector<Zone> *                   entering;
         std::vector<Zone> *                   leaving;
+
+        /* The new zones of the scene, kept allocated across the scenes */
+        Zones                                 zones;
+
+        /* The estimates of the valid contexts after the latest scene */
+        struct Seed {
+            VPP::Tracker::Kalman::StateVector x;
+            VPP::Tracker::Kalman::StateMatrix p;
+        };
+        std::vector<Seed>                     seeds;
+        uint64_t                              seeded;
 };
 
 }  // namespace Tracker
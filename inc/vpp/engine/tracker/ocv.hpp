@@ -23,6 +23,7 @@
 #include "vpp/scene.hpp"
 #include "vpp/task/tracker/ocv.hpp"
 #include "vpp/task/matcher.hpp"
+#include "vpp/util/mutex.hpp"
 
 namespace VPP {
 namespace Engine {
@@ -35,7 +36,7 @@ class OCV : public VPP::Engine::ForScene {
                                             VPP::Tracker::OCV::Contexts&,
                                             VPP::Task::Matcher::Estimator::Any>;
 
-        OCV(Scene &history, std::mutex &synchro,
+        OCV(Scene &history, Util::Mutex &synchro,
                  std::vector<Zone> *added = nullptr,
                  std::vector<Zone> *removed = nullptr) noexcept;
         ~OCV() noexcept = default;
@@ -48,10 +49,13 @@ class OCV : public VPP::Engine::ForScene {
         Matcher                              matcher;
 
     private:
-        std::mutex &                          update;
+        Util::Mutex &                         update;
         Scene &                               latest;
         std::vector<Zone> *                   entering;
         std::vector<Zone> *                   leaving;
+
+        /* The new zones of the scene, kept allocated across the scenes */
+        Zones                                 zones;
 };
 
 }  // namespace Tracker
@@ -0,0 +1,125 @@
+/**
+ *
+ * @file      vpp/governor.hpp
+ *
+ * @brief     This is the VPP resolution governor description file
+ *
+ * @details   This is a closed-loop controller of the processing resolution:
+ *            it watches the end to end latency of the scenes and the CPU and
+ *            GPU utilisation, and steps the processing scale of its actuators
+ *            down or up within bounds, with some hysteresis, so that the same
+ *            configuration runs near the best quality fitting the budget of
+ *            any platform. On the embedded targets it also watches the
+ *            temperatures of the thermal zones and the frequencies of the CPU
+ *            and GPU, for reducing the work before the device throttles, and
+ *            decimates the detection once the scale is at its minimum.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "customisation/entity.hpp"
+#include "customisation/parameter.hpp"
+#include "vpp/util/metrics.hpp"
+
+namespace VPP {
+
+/** Customisable closed-loop controller of the processing resolution */
+class Governor : public Parametrisable {
+    public:
+        using Actuator  = std::function<void (float scale) noexcept>;
+        using Decimator = std::function<void (int every) noexcept>;
+
+        Governor() noexcept;
+        ~Governor() noexcept = default;
+
+        /* Adding an actuator of the processing scale, before running */
+        void actuate(Actuator a) noexcept;
+
+        /* Adding an actuator of the decimation, before running */
+        void decimate(Decimator d) noexcept;
+
+        /* Recording the latency of a scene in nanoseconds, and stepping the
+         * scale once per period, always from the same thread */
+        void measure(uint64_t latency) noexcept;
+
+        /* The 90th percentile latency targeted in milliseconds (0 for a
+         * fixed scale, unless watching the temperatures or frequencies) */
+        PARAMETER(Direct, Saturating, Immediate, int)   target;
+
+        /* The bounds of the processing scale, the step between two scales
+         * and the hysteresis margin below the target and the ceiling */
+        PARAMETER(Direct, Saturating, Immediate, float) minimum;
+        PARAMETER(Direct, Saturating, Immediate, float) maximum;
+        PARAMETER(Direct, Saturating, Immediate, float) step;
+        PARAMETER(Direct, Saturating, Immediate, float) hysteresis;
+
+        /* The evaluation period in milliseconds */
+        PARAMETER(Direct, Saturating, Immediate, int)   period;
+
+        /* The utilisation ceiling, and the (e.g. Jetson) GPU load file */
+        PARAMETER(Direct, Saturating, Immediate, float) ceiling;
+        PARAMETER(Direct, None, Immediate, std::string) gpu;
+
+        /* The thermal zone temperature files, separated by commas, the
+         * temperature in degrees above which the work is reduced and the
+         * margin below it for restoring the work */
+        PARAMETER(Direct, None, Immediate, std::string) thermal;
+        PARAMETER(Direct, Saturating, Immediate, float) hot;
+        PARAMETER(Direct, Saturating, Immediate, float) cooling;
+
+        /* The cpufreq or devfreq directories of the CPU and GPU, separated
+         * by commas, and the ratio of their maximal frequency below which a
+         * busy device is deemed throttled */
+        PARAMETER(Direct, None, Immediate, std::string) clocks;
+        PARAMETER(Direct, Saturating, Immediate, float) throttled;
+
+        /* The largest decimation once at the minimal scale (1 for none) */
+        PARAMETER(Direct, Saturating, Immediate, int)   largest;
+
+        /* The actual processing scale, as applied to the actuators */
+        PARAMETER(Direct, Saturating, Callable, float)  scale;
+
+        /* The actual decimation, as applied to the decimators */
+        PARAMETER(Direct, Saturating, Callable, int)    decimation;
+
+    private:
+        Customisation::Error onScaleUpdate(const float &s) noexcept;
+        Customisation::Error onDecimationUpdate(const int &every) noexcept;
+
+        /* The CPU utilisation since the last call, and the GPU load, both in
+         * [0, 1] or negative if unknown */
+        float cpu() noexcept;
+        float load() noexcept;
+
+        /* The hottest thermal zone in degrees, and the lowest ratio of the
+         * actual to the maximal frequencies, both negative if unknown */
+        float temperature() noexcept;
+        float clocking() noexcept;
+
+        /* Stepping the work down or up, false if already at its bounds */
+        bool reduce() noexcept;
+        bool restore() noexcept;
+
+        std::vector<Actuator>  actuators;
+        std::vector<Decimator> decimators;
+        Util::Histogram        latencies;
+        uint64_t               evaluated;
+        uint64_t               busy, total;
+        float                  warmth;
+};
+
+}  // namespace VPP
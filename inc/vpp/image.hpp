@@ -19,9 +19,17 @@
 
 #pragma once
 
+#include <cstdint>
 #include <opencv2/core/core.hpp>
+#include <vector>
 #include "vpp/log.hpp"
 
+namespace Util {
+namespace OCV {
+class Footprint;
+}  // namespace OCV
+}  // namespace Util
+
 namespace VPP {
 
 class Image final {
@@ -37,7 +45,11 @@ class Image final {
                 static constexpr int DEPTH16   = 0x20;
                 static constexpr int DEPTHF    = 0x40;
                 static constexpr int MOTION    = 0x80;
-                static constexpr int MASK      = 0xFF;
+                /* Native (semi-)planar YUV 4:2:0 camera and decoder images */
+                static constexpr int NV12      = 0x100;
+                static constexpr int NV21      = 0x200;
+                static constexpr int I420      = 0x400;
+                static constexpr int MASK      = 0x7FF;
 
                 /* Get the number of channels in a given mode */
                 inline static int channels(int m) noexcept {
@@ -59,6 +71,10 @@ class Image final {
                         case DEPTH16:
                         case DEPTHF:
                         case GRAY:
+                        /* (Semi-)planar modes are single channel buffers */
+                        case NV12:
+                        case NV21:
+                        case I420:
                             return 1;
 
                         /* Otherwise, the mode is broken */
@@ -67,6 +83,12 @@ class Image final {
                     }
                 }
 
+                /* Get the number of planes (Y, U and V) or channels in a given
+                 * mode */
+                inline static int planes(int m) noexcept {
+                    return is_native(m) ? 3 : channels(m);
+                }
+
                 inline static bool is_colour(int m) noexcept {
                     return (m == BGR) || (m == HSV) || (m == YUV) ||
                            (m == YCrCb);
@@ -84,12 +106,16 @@ class Image final {
                     return (m == MOTION);
                 }
 
+                inline static bool is_native(int m) noexcept {
+                    return (m == NV12) || (m == NV21) || (m == I420);
+                }
+
 
                 inline Mode() noexcept : mode(AMBIGUOUS) {}
 
                 inline Mode(int m) noexcept : mode(m) {
                     ASSERT( is_colour(m) || is_gray(m) || is_depth(m) || 
-                            is_motion(m),
+                            is_motion(m) || is_native(m),
                            "Image::Mode::Mode(): invalid mode provided "
                            "%d!", m); 
                 }
@@ -128,11 +154,19 @@ class Image final {
                 inline bool is_motion() const noexcept {
                     return is_motion(mode);
                 }
+
+                inline bool is_native() const noexcept {
+                    return is_native(mode);
+                }
  
                 inline int channels() const noexcept {
                     return channels(mode);
                 }
 
+                inline int planes() const noexcept {
+                    return planes(mode);
+                }
+
                 inline bool valid() const noexcept {
                     return channels() != 0;
                 }
@@ -147,7 +181,7 @@ class Image final {
                 #define MODE(x) (Mode::x << 4)
 
                 /* Channel indexes are coded on bits[0:3] and modes are encoded
-                 *  in bits [4:9]*/
+                 *  in bits [4:14]*/
 
                 /* B only exists in BGR */
                 static constexpr int B       = 0x000 | MODE(BGR);
@@ -159,12 +193,12 @@ class Image final {
                 static constexpr int H       = 0x000 | MODE(HSV);
                 /* S only exists in HSV */
                 static constexpr int S       = 0x001 | MODE(HSV);
-                /* V exists in HSV and YUV*/
+                /* V exists in HSV, YUV and the native modes */
                 static constexpr int V       = 0x002 | (MODE(HSV)&MODE(YUV));
-                /* Y exists in YUV and YCrCb */
+                /* Y exists in YUV, YCrCb and the native modes */
                 static constexpr int Y       = 0x000 | (MODE(YUV)&MODE(YCrCb));
-                /* U only exists in YUV */
-                static constexpr int U       = 0x001 | MODE(YUV);
+                /* U exists in YUV and the native modes */
+                static constexpr int U       = 0x001 | (MODE(YUV)&MODE(NV12));
                 /* Cr only exists in YCrCb */
                 static constexpr int Cr      = 0x001 | MODE(YCrCb);
                 /* Cb only exists in YCrCb */
@@ -185,6 +219,9 @@ class Image final {
                 static constexpr int DEPTH16 = MODE(DEPTH16);
                 static constexpr int DEPTHF  = MODE(DEPTHF);
                 static constexpr int MOTION  = MODE(MOTION);
+                static constexpr int NV12    = MODE(NV12);
+                static constexpr int NV21    = MODE(NV21);
+                static constexpr int I420    = MODE(I420);
                 /* Mask for getting the mode */
                 static constexpr int MODE    = MODE(MASK);
                 #undef MODE
@@ -199,7 +236,7 @@ class Image final {
 
                 inline static bool valid(int c) {
                     return (c >=0) && 
-                           (Channel::id(c) < Mode::channels(Channel::mode(c)));
+                           (Channel::id(c) < Mode::planes(Channel::mode(c)));
                 }
 
                 inline explicit Channel(int c) noexcept : channel(c) {
@@ -220,7 +257,7 @@ class Image final {
                      * valid */
                     return ( ((mode(channel) == Mode::AMBIGUOUS) || 
                               (mode(channel) == m)) &&
-                             (id(channel) < m.channels()) );
+                             (id(channel) < m.planes()) );
                 }
 
                 inline Channel &on(const Mode &m) noexcept {
@@ -261,6 +298,72 @@ class Image final {
                 int channel;
             };
 
+        /* A view on a single channel of an 8-bit image, striding over the
+         * pixels of its interleaved buffer rather than copying it out. Only
+         * the OpenCV APIs requiring a contiguous matrix need a copy of it */
+        class Strided final {
+            public:
+                inline Strided() noexcept : base(), offset(0) {}
+                inline Strided(cv::Mat m, int channel) noexcept
+                    : base(std::move(m)), offset(channel) {}
+                inline ~Strided() noexcept = default;
+
+                inline Strided(const Strided& other) = default;
+                inline Strided(Strided&& other) = default;
+                inline Strided& operator=(const Strided& other) = default;
+                inline Strided& operator=(Strided&& other) = default;
+
+                inline bool empty() const noexcept {
+                    return base.empty();
+                }
+
+                inline int rows() const noexcept {
+                    return base.rows;
+                }
+
+                inline int cols() const noexcept {
+                    return base.cols;
+                }
+
+                inline cv::Size size() const noexcept {
+                    return base.size();
+                }
+
+                /* The distance in bytes between two pixels of a row */
+                inline int stride() const noexcept {
+                    return base.channels();
+                }
+
+                /* Is it a plain single-channel matrix ? */
+                inline bool contiguous() const noexcept {
+                    return base.channels() == 1;
+                }
+
+                /* The first pixel of a row, the next ones being every stride
+                 * bytes */
+                inline const uchar *row(int y) const noexcept {
+                    return base.ptr<uchar>(y) + offset;
+                }
+
+                inline uchar at(int y, int x) const noexcept {
+                    return row(y)[x * stride()];
+                }
+
+                /* The view of an area, cropped to the view */
+                inline Strided operator()(const cv::Rect &roi) const noexcept {
+                    return Strided(base(roi & cv::Rect(0, 0, base.cols,
+                                                       base.rows)), offset);
+                }
+
+                /* The single-channel matrix of the view, only copied when the
+                 * view is strided */
+                cv::Mat mat() const noexcept;
+
+            private:
+                cv::Mat base;
+                int     offset;
+        };
+
         static Image INVALID;
 
         /* Invalid image */
@@ -295,9 +398,16 @@ class Image final {
             return original;
         }
 
+        /* The output is the original image unless drawn, in which case the
+         * drawn tiles are composed with the original ones */
         const cv::Mat &output() const noexcept;
 
+        /* The drawable is copied from the original image tile by tile, only
+         * for the tiles of the area to draw in (the whole image by default),
+         * the copy being returned as a whole for drawing at the image
+         * coordinates. Flushing the drawable resets it to the original */
         cv::Mat &drawable() noexcept;
+        cv::Mat &drawable(const cv::Rect &area) noexcept;
 
         inline const cv::Rect & frame() const noexcept {
             return boundaries;
@@ -305,9 +415,16 @@ class Image final {
 
         void flush() noexcept;
 
+        /* The planes of the native images are extracted as views on their
+         * buffer whenever they are not interleaved */
         cv::Mat extract(const Channel &c, const cv::Rect &roi) const noexcept;
         cv::Mat extract(const Channel &c) const noexcept;
 
+        /* The channels are viewed in place, even when interleaved, and only
+         * copied for the I420 planes not spanning whole rows */
+        Strided channel(const Channel &c, const cv::Rect &roi) const noexcept;
+        Strided channel(const Channel &c) const noexcept;
+
         bool translatable(const Mode &mode) const noexcept;
 
         /* The next all create new matrices, even in the same mode. Calling
@@ -318,11 +435,39 @@ class Image final {
         cv::Mat to(const Mode &mode, float scale = 1.0,
                    float offset = 0.0) const noexcept;
 
+        /* The image mirrored on the (OpenCL) device, lazily uploaded on its
+         * first use, and its translations done on the device. The mirror is
+         * not shared by the copies of the image, and shall not be used
+         * concurrently on its first use */
+        const cv::UMat &device() noexcept;
+        void to(const Mode &mode, cv::UMat &out, float scale = 1.0,
+                float offset = 0.0) noexcept;
+
+        /* OpenCV colour conversion code between two modes, or -1 if there is
+         * no direct conversion */
+        static int conversion(const Mode &from, const Mode &to) noexcept;
+
+        /* The bytes held by the image, its drawable included, which are not
+         * already accounted in a footprint */
+        std::size_t footprint(Util::OCV::Footprint &f) const noexcept;
+
     private:
-        Mode     m;
-        cv::Rect boundaries;
-        cv::Mat  original;
-        cv::Mat  copy;
+        /* View a plane of a native image, with an area in the image */
+        Strided plane(int id, const cv::Rect &area) const noexcept;
+
+        /* Copy the tiles of an area from the original to the drawable, and
+         * copy the drawn tiles of another image of the same original */
+        void touch(const cv::Rect &area) const noexcept;
+        void redraw(const Image &other) noexcept;
+
+        Mode                         m;
+        cv::Rect                     boundaries;
+        cv::Mat                      original;
+        mutable cv::Mat              copy;
+        mutable std::vector<uint8_t> drawn;
+        mutable int                  tiling;
+        mutable std::size_t          touched;
+        cv::UMat                     mirror;
 };
 
 }  // namespace VPP
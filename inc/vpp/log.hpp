@@ -29,6 +29,8 @@
 #define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOGTAG, __VA_ARGS__)
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOGTAG, __VA_ARGS__)
 
+#define LOGFLUSH() ((void)0)
+
 #else /* On Linux */
 #include <cstdio>
 
@@ -36,15 +38,26 @@ extern FILE *STDE;
 extern FILE *STDW;
 extern FILE *STDO;
 
-#define LOGE(...)                                    \
-    fprintf(STDE, "[E] " LOGTAG ": " __VA_ARGS__); \
-    fprintf(STDE, "\n")
-#define LOGW(...)                                    \
-    fprintf(STDW, "[W] " LOGTAG ": " __VA_ARGS__); \
-    fprintf(STDW, "\n")
-#define LOGI(...)                                    \
-    fprintf(STDO, "[I] " LOGTAG ": " __VA_ARGS__); \
-    fprintf(STDO, "\n")
+namespace VPP {
+namespace Log {
+
+/* Messages are formatted in the calling thread and queued without locking in
+ * a ring of the thread, for a background writer to print them in order. The
+ * messages of a same format are limited to a burst per second, the number of
+ * suppressed (or dropped) messages being reported with the next one */
+void print(FILE *file, const char *format, ...) noexcept
+    __attribute__((format(printf, 2, 3)));
+
+/* Synchronously print all the queued messages */
+void flush() noexcept;
+
+}  // namespace Log
+}  // namespace VPP
+
+#define LOGE(...) VPP::Log::print(STDE, "[E] " LOGTAG ": " __VA_ARGS__)
+#define LOGW(...) VPP::Log::print(STDW, "[W] " LOGTAG ": " __VA_ARGS__)
+#define LOGI(...) VPP::Log::print(STDO, "[I] " LOGTAG ": " __VA_ARGS__)
+#define LOGFLUSH() VPP::Log::flush()
 
 #endif
 
@@ -65,6 +78,7 @@ extern FILE *STDO;
     if ((!(condition)))        \
     {                          \
         LOGE(__VA_ARGS__);     \
+        LOGFLUSH();            \
     };                         \
     assert(condition)
 #endif
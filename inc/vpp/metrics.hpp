@@ -0,0 +1,60 @@
+/**
+ *
+ * @file      vpp/metrics.hpp
+ *
+ * @brief     This is the VPP metrics endpoint description file
+ *
+ * @details   This is the customisable interface of the process-wide registry
+ *            of the metrics of the pipelines, stages, bridges and engines. It
+ *            serves them over HTTP in the Prometheus text format, for
+ *            monitoring long-running deployments.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "customisation/entity.hpp"
+#include "customisation/parameter.hpp"
+#include "vpp/util/metrics.hpp"
+
+namespace VPP {
+
+/** Customisable process-wide metrics endpoint */
+class Metrics : public Parametrisable {
+    public:
+        Metrics() noexcept;
+
+        /* Metrics cannot be copied nor moved */
+        Metrics(const Metrics& other) = delete;
+        Metrics(Metrics&& other) = delete;
+        Metrics& operator=(const Metrics& other) = delete;
+        Metrics& operator=(Metrics&& other) = delete;
+        ~Metrics() noexcept;
+
+        /* The TCP port serving 'GET /metrics', or 0 for not serving them */
+        PARAMETER(Direct, Bounded, Callable, int) port;
+
+    private:
+        Customisation::Error onPortUpdate(const int &p) noexcept;
+
+        void serve(int socket) noexcept;
+        void stop() noexcept;
+
+        std::atomic<bool>                 serving;
+        std::thread                       server;
+        int                               listener;
+        Util::Metrics::Registry::Handle   pooling;
+};
+
+}  // namespace VPP
@@ -21,6 +21,7 @@
 #pragma once
 
 #include "vpp/core/pipeline.hpp"
+#include "vpp/core/static.hpp"
 #include "vpp/scene.hpp"
 
 namespace VPP {
@@ -35,5 +36,10 @@ using ForZone = Core::Pipeline<Zone>;
 /* Describing a pipeline for handling multiple zones in a scene */
 using ForZones = Core::Pipeline<Zones>;
 
+/* Describing a pipeline of stages fixed at compile time, all of them being
+ * either scene, zone or zones stages */
+template <typename ...S>
+    using Static = Core::StaticPipeline<S...>;
+
 }  // namespace Pipeline
 }  // namespace VPP
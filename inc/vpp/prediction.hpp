@@ -6,7 +6,8 @@
  *
  * @details   This file describes the structure of a prediction and adds a few
  *            methods to handle it. A prediction is basically a score, a list 
- *            index and an object index within this list.
+ *            index and an object index within this list. Predictions are kept
+ *            as a small sorted array of the best ones, without any allocation.
  *
  *            This file is part of the VPP framework (see link).
  *
@@ -21,10 +22,70 @@
 #pragma once
 
 #include <cstdint>
+#include <initializer_list>
 #include <set>
+#include <vector>
 
 namespace VPP {
 
+/**
+ *  Class Classes
+ *
+ *  A compact set of prediction classes: a dense bitset per dataset, indexed by
+ *  the class identifiers. It is built once from a configured class list, and
+ *  testing a prediction is then a single bit test
+ */
+class Classes final {
+    public:
+        Classes() noexcept : masks() {}
+
+        /* Building the set from (dataset, id) GIDs */
+        explicit Classes(const std::set<int32_t> &gids) noexcept : masks() {
+            for (auto gid : gids) {
+                insert(static_cast<int16_t>(gid >> 16),
+                       static_cast<int16_t>(gid & 0xFFFF));
+            }
+        }
+
+        inline bool empty() const noexcept {
+            return masks.empty();
+        }
+
+        inline void clear() noexcept {
+            masks.clear();
+        }
+
+        inline void insert(int16_t dataset, int16_t id) noexcept {
+            if ((dataset < 0) || (id < 0)) {
+                return;
+            }
+            if (masks.size() <= static_cast<std::size_t>(dataset)) {
+                masks.resize(dataset + 1);
+            }
+            auto &mask = masks[dataset];
+            auto word  = static_cast<std::size_t>(id) / 64;
+            if (mask.size() <= word) {
+                mask.resize(word + 1, 0);
+            }
+            mask[word] |= (UINT64_C(1) << (id % 64));
+        }
+
+        inline bool contains(int16_t dataset, int16_t id) const noexcept {
+            if ((dataset < 0) || (id < 0) ||
+                (static_cast<std::size_t>(dataset) >= masks.size())) {
+                return false;
+            }
+            auto &mask = masks[dataset];
+            auto word  = static_cast<std::size_t>(id) / 64;
+            return (word < mask.size()) &&
+                   ((mask[word] >> (id % 64)) & 1);
+        }
+
+    private:
+        /* The 64-class words of each dataset */
+        std::vector<std::vector<uint64_t>> masks;
+};
+
 class Prediction final {
     public:
         Prediction() noexcept : score(-1), dataset(-1), id(-1) {}
@@ -53,6 +114,10 @@ class Prediction final {
             return (valid.find(gid()) != valid.end());
         }
 
+        inline bool is_in(const Classes &valid) const noexcept {
+            return valid.contains(dataset, id);
+        }
+
         inline bool operator == (const Prediction &other) const noexcept {
             return (score == other.score);
         }
@@ -87,4 +152,197 @@ class Prediction final {
         int16_t id;
 };
 
+/** 
+ *  Class Predictions
+ *
+ *  An inline array of the top predictions sorted by decreasing scores, with
+ *  at most one prediction per GID. Predictions are stored in place, so that
+ *  copying them never allocates anything. When full, the lowest scores are
+ *  dropped
+ */
+class Predictions final {
+    public:
+        static const int capacity = 8;
+
+        using iterator       = Prediction *;
+        using const_iterator = const Prediction *;
+
+        Predictions() noexcept : count(0), items() {}
+
+        Predictions(std::initializer_list<Prediction> preds) noexcept 
+            : count(0), items() {
+            for (auto const &p : preds) {
+                insert(p);
+            }
+        }
+
+        inline bool empty() const noexcept {
+            return count == 0;
+        }
+
+        inline int size() const noexcept {
+            return count;
+        }
+
+        inline void clear() noexcept {
+            count = 0;
+        }
+
+        inline iterator begin() noexcept {
+            return items;
+        }
+
+        inline iterator end() noexcept {
+            return items + count;
+        }
+
+        inline const_iterator begin() const noexcept {
+            return items;
+        }
+
+        inline const_iterator end() const noexcept {
+            return items + count;
+        }
+
+        inline Prediction &front() noexcept {
+            return items[0];
+        }
+
+        inline const Prediction &front() const noexcept {
+            return items[0];
+        }
+
+        /* Prediction with a given GID, if any */
+        inline Prediction *find(int32_t gid) noexcept {
+            for (int i = 0; i < count; ++i) {
+                if (items[i].gid() == gid) {
+                    return &items[i];
+                }
+            }
+            return nullptr;
+        }
+
+        /* Insert a new prediction after all the ones with a higher or equal
+         * score, or raise the score of a prediction with the same GID if it is
+         * higher. Returns false if the prediction falls out of the top */
+        inline bool insert(const Prediction &pred) noexcept {
+            auto found = find(pred.gid());
+            int  at;
+            if (found != nullptr) {
+                if (pred.score <= found->score) {
+                    return true;
+                }
+                at = static_cast<int>(found - items);
+            } else if (count < capacity) {
+                at = count++;
+            } else if (pred.score > items[capacity-1].score) {
+                at = capacity-1;
+            } else {
+                return false;
+            }
+
+            /* Shift the entry up to its rank */
+            while ( (at > 0) && (items[at-1].score < pred.score) ) {
+                items[at] = items[at-1];
+                --at;
+            }
+            items[at] = pred;
+
+            return true;
+        }
+
+        /* Scale all the scores, keeping the ordering for positive factors */
+        inline void scale(float factor) noexcept {
+            for (int i = 0; i < count; ++i) {
+                items[i].score *= factor;
+            }
+        }
+
+        /* Merge other predictions, after applying a recall factor to the
+         * current ones */
+        inline void merge(const Predictions &other, float recall) noexcept {
+            scale(recall);
+            for (auto const &p : other) {
+                insert(p);
+            }
+        }
+
+    private:
+        int        count;
+        Prediction items[capacity];
+};
+
+/** 
+ *  Class Labels
+ *
+ *  The datasets labelling the predictions of a zone, along with their score
+ *  thresholds. Labels are only identifiers, the label strings being looked up
+ *  in the dataset interned labels whenever they are needed for display
+ */
+class Labels final {
+    public:
+        static const int capacity = 4;
+
+        struct Label {
+            int16_t dataset;
+            float   threshold;
+        };
+
+        using const_iterator = const Label *;
+
+        Labels() noexcept : count(0), items() {}
+
+        inline bool empty() const noexcept {
+            return count == 0;
+        }
+
+        inline int size() const noexcept {
+            return count;
+        }
+
+        inline void clear() noexcept {
+            count = 0;
+        }
+
+        inline const_iterator begin() const noexcept {
+            return items;
+        }
+
+        inline const_iterator end() const noexcept {
+            return items + count;
+        }
+
+        /* Label with a dataset, updating its threshold if already there */
+        inline void add(int16_t dataset, float threshold) noexcept {
+            for (int i = 0; i < count; ++i) {
+                if (items[i].dataset == dataset) {
+                    items[i].threshold = threshold;
+                    return;
+                }
+            }
+            if (count < capacity) {
+                items[count].dataset   = dataset;
+                items[count].threshold = threshold;
+                ++count;
+            }
+        }
+
+        /* Merge other labels, keeping the current thresholds */
+        inline void merge(const Labels &other) noexcept {
+            for (auto const &l : other) {
+                bool found = false;
+                for (int i = 0; (i < count) && (!found); ++i) {
+                    found = (items[i].dataset == l.dataset);
+                }
+                if (!found) {
+                    add(l.dataset, l.threshold);
+                }
+            }
+        }
+
+    private:
+        int   count;
+        Label items[capacity];
+};
+
 }  // namespace VPP
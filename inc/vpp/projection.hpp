@@ -17,9 +17,25 @@
 #pragma once
 
 #include <opencv2/core/core.hpp>
+#include <vector>
 
 namespace VPP {
 
+/* A pinhole camera model, with inverse Brown-Conrady distortion coefficients
+ * (all nil for an undistorted model), deprojecting whole rows of pixels at
+ * once for building point clouds */
+struct Pinhole {
+    float fx, fy, ppx, ppy;
+    float coeffs[5];
+
+    cv::Point3f deproject(const cv::Point &p, float z) const noexcept;
+
+    /* Deproject the n pixels of row y starting from column x with their z
+     * depths, the invalid (non-positive) ones being deprojected as NaN */
+    void deproject(int x, int y, const float *z, int n,
+                   cv::Point3f *points) const noexcept;
+};
+
 class Projecter {
     public:
         Projecter() noexcept = default;
@@ -28,6 +44,34 @@ class Projecter {
         virtual cv::Point project(const cv::Point3f &p) const noexcept = 0;
         virtual cv::Point3f deproject(const cv::Point &p,
                                       float z) const noexcept = 0;
+
+        /* Batch projections back and forth, by default point by point */
+        virtual void project(const std::vector<cv::Point3f> &p,
+                             std::vector<cv::Point> &pixels) const noexcept;
+        virtual void deproject(const std::vector<cv::Point> &p, float z,
+                               std::vector<cv::Point3f> &points)
+            const noexcept;
+
+        /* Batch deprojection of points at their own (valid) depths */
+        virtual void deproject(const std::vector<cv::Point> &p,
+                               const std::vector<float> &z,
+                               std::vector<cv::Point3f> &points)
+            const noexcept;
+
+        /* Deproject a depth map (or a region of it with the origin of the
+         * region in the depth map) into an organised point cloud of 3-channel
+         * floats, invalid depths being deprojected as NaN. The depth map is
+         * either of metric floats or of raw 16-bit units scaled by zscale */
+        virtual void deproject(const cv::Mat &depth, const cv::Point &origin,
+                               cv::Mat &cloud) const noexcept;
+
+        /* Locating a point of the image in the raw depth map of its view
+         * when it is not aligned with it (i.e. a sparse depth map), by
+         * default they are aligned */
+        virtual cv::Point locate(const cv::Point &p,
+                                 const cv::Mat &/*depth*/) const noexcept {
+            return p;
+        }
         float   zscale;
 };
 
@@ -26,8 +26,11 @@
 #include <cstdint>
 #include <list>
 #include <opencv2/core/core.hpp>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "vpp/util/ocv/functions.hpp"
 #include "vpp/view.hpp"
 #include "vpp/zone.hpp"
 
@@ -39,6 +42,91 @@ class Scene final {
         using ZoneFilter = 
             std::function<bool (const Zone &) noexcept>;
 
+        /** Contiguous structure of arrays of the zones geometry, for batch
+         *  geometric queries without walking the zones list. The i-th entry of
+         *  each array describes the i-th zone of the scene */
+        class Geometry final {
+            public:
+                Geometry() noexcept;
+                ~Geometry() noexcept = default;
+
+                inline std::size_t size() const noexcept {
+                    return uuids.size();
+                }
+
+                void clear() noexcept;
+                void reserve(std::size_t n) noexcept;
+                void emplace_back(Zone &zone) noexcept;
+
+                /* Intersection over union of a rectangle against all the
+                 * zones, results having as many floats as zones */
+                void iou(const cv::Rect &r, float *results) const noexcept;
+
+                /* Intersection over union of all the zones against all the
+                 * other zones, as a rows by other columns float matrix */
+                void iou(const Geometry &other, float *results) const noexcept;
+
+                /* Indices of the zones fully contained in a rectangle */
+                std::vector<std::size_t> within(const cv::Rect &r) 
+                    const noexcept;
+
+                /* Indices of the zones containing a point */
+                std::vector<std::size_t> containing(const cv::Point &p) 
+                    const noexcept;
+
+                /* Indices of the zones whose area is in a [min, max] range */
+                std::vector<std::size_t> sized(float min, float max)
+                    const noexcept;
+
+                /* Indices of the zones overlapping a rectangle, using the
+                 * uniform grid when it is built and a linear scan otherwise */
+                std::vector<std::size_t> intersecting(const cv::Rect &r)
+                    const noexcept;
+
+                /* Build the uniform grid of the entries, with cells about the
+                 * mean zone size and at most 64 by 64 of them */
+                void grid() noexcept;
+
+                inline bool gridded() const noexcept {
+                    return !starts.empty();
+                }
+
+                /* Bounding boxes corners, identifiers and top scores */
+                Util::OCV::Rects        boxes;
+                std::vector<uint64_t>   uuids;
+                std::vector<float>      scores;
+
+                /* Zones described by each entry, for mapping back indices */
+                std::vector<Zone *>     zones;
+
+            private:
+                /* Grid origin, cell size and dimensions in cells */
+                float                   ox, oy, cw, ch;
+                int                     cols, rows;
+
+                /* Packed cells: the entries of the cell c are the entries in
+                 * the [starts[c], starts[c+1]) range */
+                std::vector<uint32_t>   starts;
+                std::vector<uint32_t>   entries;
+        };
+
+        /** The exit of a stage, stamped in us of the steady clock as for the
+         *  capture time of the view */
+        struct Exit {
+            std::string stage;
+            uint64_t    us;
+        };
+
+        /** The memory held by a scene, in bytes */
+        struct Footprint {
+            std::size_t images;   /* Host images and their cached forms */
+            std::size_t zones;    /* Zones, spare ones and geometry index */
+            std::size_t contours; /* Contour points of the zones */
+        };
+
+        /* Minimal number of zones for the spatial queries to use the grid */
+        static constexpr std::size_t gridding = 64;
+
         Scene() noexcept;
         ~Scene() noexcept = default;
 
@@ -52,6 +140,13 @@ class Scene final {
             return view.ts_ms();
         }
 
+        /* The sequence number of the scene, strictly positive and unique to
+         * every scene, a recycled one getting a new number when cleared,
+         * whatever the time stamps of their frames */
+        inline uint64_t sequence() const noexcept {
+            return serial;
+        }
+
         inline bool broken() const noexcept {
             return view.empty();
         }
@@ -60,6 +155,55 @@ class Scene final {
             return areas.empty();
         }
 
+        /* Is the scene nearly identical to the previous one, so that the
+         * stages may reuse their previous results rather than compute them
+         * again ? */
+        inline bool still() const noexcept {
+            return stillness;
+        }
+
+        inline void still(bool yes) noexcept {
+            stillness = yes;
+        }
+
+        /* Was the scene detected afresh rather than tracked from the previous
+         * ones, for the decimated stages to align on the detections ? */
+        inline bool keyframe() const noexcept {
+            return detected;
+        }
+
+        inline void keyframe(bool yes) noexcept {
+            detected = yes;
+        }
+
+        /* Stamping the exit of a stage, whilst the pipeline is profiling */
+        inline void exited(std::string stage, uint64_t us) noexcept {
+            departures.push_back(Exit{ std::move(stage), us });
+        }
+
+        /* The stage exits of the scene, in their processing order */
+        inline const std::vector<Exit> &exits() const noexcept {
+            return departures;
+        }
+
+        /* The latency in us from the capture to the last stage exit, 0 if
+         * unknown */
+        uint64_t latency_us() const noexcept;
+
+        /* The latency breakdown, as "stage +us" for each exit since either
+         * the capture or the previous exit */
+        std::string breakdown() const;
+
+        /* The memory currently held by the scene, its spare zones included */
+        Footprint footprint() noexcept;
+
+        /* Clearing a scene for reusing it with a next frame, its zones being
+         * kept as spare list nodes for the next marked zones */
+        void clear() noexcept;
+
+        /* Handing back extracted zones, as spare list nodes */
+        void recycle(std::list<Zone> &zones) noexcept;
+
         Zone &mark(Zone zone) noexcept;
         
         inline Zone &mark(BBox bbox) noexcept {
@@ -77,6 +221,31 @@ class Scene final {
             return mark(Zone(BBox(bbox, view.frame())));
         }
 
+        /* Deprojecting the flat states of the zones in metres at once if the
+         * view has any depth, as the consumers of the metric states do on
+         * demand, and flattening them back in pixels for the consumers of 2D
+         * states */
+        void deproject() noexcept;
+        void flatten() noexcept;
+
+        /* The geometry index of the scene zones, rebuilt on request whenever
+         * the zones may have been altered since its last update */
+        const Geometry &geometry() noexcept;
+
+        /* Forcing a rebuild of the geometry index and of the cached zone
+         * views after zones obtained from the queries below have been moved,
+         * resized or otherwise altered in place */
+        inline void reindex() noexcept {
+            stale = true;
+            ++generation;
+        }
+
+        /* Spatial queries, for the zones overlapping an area or another zone
+         * (the zone itself excluded). They rely on a uniform grid lazily built
+         * over the geometry index for crowded scenes */
+        Zones zones(const cv::Rect &area) noexcept;
+        Zones overlapping(const Zone &zone) noexcept;
+
         ConstZones zones() const noexcept;
         Zones zones() noexcept;
 
@@ -85,21 +254,95 @@ class Scene final {
         Zones zones(const ZoneFilter &f) noexcept;
         ConstZones zones(const ZoneFilter &f) const noexcept;
 
+        /* Class filtering, on the context prediction of the zones */
+        Zones zones(const Classes &c) noexcept;
+        ConstZones zones(const Classes &c) const noexcept;
+
+        /* Filling a caller-owned vector with the zones, its capacity being
+         * reused from frame to frame */
+        void zones(Zones &into) noexcept;
+        void zones(const ZoneFilterDelegate &f, Zones &into) noexcept;
+        void zones(const ZoneFilter &f, Zones &into) noexcept;
+        void zones(const Classes &c, Zones &into) noexcept;
+
+        /* Cached zone views, valid until zones are marked or extracted (or
+         * the scene is reindexed). The filtered views are memoised by the
+         * address of their delegate, which shall not change of filtering
+         * meanwhile */
+        const Zones &cached() noexcept;
+        const Zones &cached(const ZoneFilterDelegate &f) noexcept;
+
         std::list<Zone> extract(const ZoneFilterDelegate &f) noexcept;
         std::list<Zone> extract(const ZoneFilter &f) noexcept;
+        std::list<Zone> extract(const Classes &c) noexcept;
+
+        /* The zone filter of a class set, for the stages and tasks filtering
+         * their zones */
+        static ZoneFilter filter(Classes c) noexcept;
 
         /* Remembering a scene for tracking: everything is copied except the
          * images (useless) */
         Scene remember() const noexcept;
 
+        /* Remembering a scene into another one, reusing its zones and their
+         * buffers rather than allocating new ones */
+        void remember(Scene &into) const noexcept;
+
+        /* Remembering only the zone fields selected by a copier, on top of
+         * their geometry, identifier, state and context */
+        Scene remember(const Zone::Copier &copier) const noexcept;
+        void remember(Scene &into, const Zone::Copier &copier) const noexcept;
+
         /* The visual environment captured for the scene */
         View view;
 
+        /* The arena of the contour points of the zones of the scene, a new
+         * block being started with every cleared scene */
+        Contour::Arena contours;
+
     private:
         /* Using a double-linked list to ensure that zones keep their actual
          * locations unless removed from the scene, including when other zones
          * are appended or removed */
         std::list<Zone> areas;
+
+        /* Spare list nodes, for marking zones without allocating any node in
+         * the steady state */
+        std::list<Zone> spares;
+
+        /* The geometry index is appended when marking zones and is stale as
+         * soon as zones are extracted or mutably accessed */
+        Geometry        index;
+        bool            stale;
+
+        /* Set by the stillness and detection stages for the next stages */
+        bool            stillness;
+        bool            detected;
+
+        /* The stage exits, kept allocated across the cleared scenes */
+        std::vector<Exit> departures;
+
+        /* The sequence number of the scene, since its last clearing */
+        uint64_t        serial;
+
+        /* The invalid zone returned when marking a zone outside the frame,
+         * which is owned by the scene as the branches of a forked pipeline
+         * mark their zones concurrently */
+        Zone            discarded;
+
+        /* The cached zone views of a generation of the zones, the view of all
+         * the zones having no filter. The generation changes whenever zones
+         * are marked or extracted */
+        struct Memo {
+            const ZoneFilterDelegate *filter;
+            uint64_t                  generation;
+            Zones                     zones;
+        };
+        uint64_t          generation;
+        std::vector<Memo> memos;
+
+        /* The memo of a filter, refreshed if of a former generation */
+        const Zones &memoised(const ZoneFilterDelegate *f) noexcept;
 };
 
 }  // namespace VPP
@@ -0,0 +1,145 @@
+/**
+ *
+ * @file      vpp/scheduler.hpp
+ *
+ * @brief     This is the VPP cross-pipeline scheduler description file
+ *
+ * @details   This is a closed-loop scheduler sharing the workers of a process
+ *            between the streams of pipelines it runs. Every stream has a
+ *            weight, a frame rate and a latency target: its demand is the cost
+ *            of its stages (as estimated by their instrumentation) at its frame
+ *            rate, and its fair share of the workers is its weighted part of
+ *            their capacity. A stream is only admitted if its demand fits the
+ *            capacity left, and the streams missing their latency target, or
+ *            exceeding their fair share of an overloaded capacity, are first
+ *            decimated and then scaled down, before any other stream is
+ *            degraded.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "customisation/entity.hpp"
+#include "customisation/parameter.hpp"
+#include "vpp/util/metrics.hpp"
+
+namespace VPP {
+
+/** Customisable scheduler of the streams of pipelines of a process */
+class Scheduler : public Parametrisable {
+    public:
+        /** The scheduling of a stream of pipelines */
+        class Stream : public Parametrisable {
+            public:
+                using Decimator = std::function<void (int every) noexcept>;
+                using Scaler    = std::function<void (float scale) noexcept>;
+                using Coster    = std::function<uint64_t () noexcept>;
+
+                Stream() noexcept;
+                ~Stream() noexcept = default;
+
+                /* The share of the workers of the stream, relative to the
+                 * weights of the other streams */
+                PARAMETER(Direct, Saturating, Immediate, int)   weight;
+
+                /* The frame rate expected from the stream */
+                PARAMETER(Direct, Saturating, Immediate, float) rate;
+
+                /* The 90th percentile of the end to end latency targeted in
+                 * milliseconds (0 for only sharing the workers fairly) */
+                PARAMETER(Direct, Saturating, Immediate, int)   target;
+
+                /* The actual degradation of the stream: the decimation of
+                 * its costly stages, then the scale of its processing */
+                PARAMETER(Direct, Saturating, Immediate, int)   decimation;
+                PARAMETER(Direct, Saturating, Immediate, float) scale;
+
+                /* Adding the actuators of the degradation and the estimator
+                 * of the cost of a scene in nanoseconds, before running. The
+                 * actuators are called from the thread of any stream, which
+                 * defers their actions to the safe points of its pipelines */
+                void decimate(Decimator d) noexcept;
+                void rescale(Scaler s) noexcept;
+                void cost(Coster c) noexcept;
+
+                /* Admitting the stream if its demand fits the capacity left
+                 * by the other admitted streams, and retiring it */
+                bool admit() noexcept;
+                void retire() noexcept;
+
+                /* Recording the latency of a scene in nanoseconds, from the
+                 * thread concluding the scenes of the stream */
+                void measure(uint64_t latency) noexcept;
+
+            private:
+                friend class Scheduler;
+
+                /* The cost of a scene, as estimated by the stages, or by the
+                 * median latency of the scenes if not instrumented */
+                uint64_t estimate() noexcept;
+
+                /* Applying the degradation to the actuators */
+                void apply() noexcept;
+
+                Scheduler *            scheduler;
+                std::vector<Decimator> decimators;
+                std::vector<Scaler>    scalers;
+                Coster                 coster;
+                Util::Histogram        latencies;
+                bool                   admitted;
+        };
+
+        Scheduler() noexcept;
+        ~Scheduler() noexcept = default;
+
+        /* Enrolling a stream, before running */
+        void enrol(Stream &stream) noexcept;
+
+        /* The share of the workers of the pool the streams may use */
+        PARAMETER(Direct, Saturating, Immediate, float) capacity;
+
+        /* The largest decimation and the smallest scale of a stream, and the
+         * ratio between two successive scales */
+        PARAMETER(Direct, Saturating, Immediate, int)   largest;
+        PARAMETER(Direct, Saturating, Immediate, float) minimum;
+        PARAMETER(Direct, Saturating, Immediate, float) step;
+
+        /* The margin below the targets and the capacity for restoring the
+         * degraded streams */
+        PARAMETER(Direct, Saturating, Immediate, float) hysteresis;
+
+        /* The period in milliseconds between two evaluations */
+        PARAMETER(Direct, Saturating, Immediate, int)   period;
+
+    private:
+        /* The demand of a stream, and the capacity of the workers, both in
+         * nanoseconds of work per second */
+        double demand(Stream &stream) noexcept;
+        double available() noexcept;
+
+        /* Degrading or restoring a stream by a step, if it can be */
+        bool degrade(Stream &stream) noexcept;
+        bool restore(Stream &stream) noexcept;
+
+        /* Evaluating all the streams once per period */
+        void evaluate() noexcept;
+
+        std::mutex                                  access;
+        std::vector<std::reference_wrapper<Stream>> streams;
+        uint64_t                                    evaluated;
+};
+
+}  // namespace VPP
@@ -0,0 +1,47 @@
+/**
+ *
+ * @file      vpp/stage/cache.hpp
+ *
+ * @brief     These are the VPP classification cache stages
+ *
+ * @details   These stages respectively restore and record the classification
+ *            results of the tracked zones from and into a shared cache store
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include "vpp/engine/cache.hpp"
+#include "vpp/stage.hpp"
+
+namespace VPP {
+namespace Stage {
+namespace Cache {
+
+class Lookup : public Stage::ForZone {
+    public:
+        explicit Lookup(VPP::Engine::Cache::Store &store) noexcept;
+        ~Lookup() noexcept = default;
+
+        VPP::Engine::Cache::Lookup lookup;
+};
+
+class Record : public Stage::ForZone {
+    public:
+        explicit Record(VPP::Engine::Cache::Store &store) noexcept;
+        ~Record() noexcept = default;
+
+        VPP::Engine::Cache::Record record;
+};
+
+}  // namespace Cache
+}  // namespace Stage
+}  // namespace VPP
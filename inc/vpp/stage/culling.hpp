@@ -0,0 +1,37 @@
+/**
+ *
+ * @file      vpp/stage/culling.hpp
+ *
+ * @brief     This is the VPP zone culling stage description
+ *
+ * @details   This stage drops the zones of a scene out of the depth and size
+ *            windows, before the tracking and the classification stages.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include "vpp/engine/culling.hpp"
+#include "vpp/stage.hpp"
+
+namespace VPP {
+namespace Stage {
+
+class Culling : public Stage::ForScene {
+    public:
+        Culling() noexcept;
+        ~Culling() noexcept = default;
+
+        VPP::Engine::Culling::Depth depth;
+};
+
+}  // namespace Stage
+}  // namespace VPP
@@ -26,10 +26,22 @@
 #endif
 #ifdef VPP_HAS_OPENCV_DNN_SUPPORT
 #include "vpp/engine/classifier/ocv.hpp"
+#include "vpp/engine/detector/cascade.hpp"
 #include "vpp/engine/detector/ocv.hpp"
 #endif
+#ifdef VPP_HAS_TFLITE_SUPPORT
+#include "vpp/engine/classifier/tflite.hpp"
+#include "vpp/engine/detector/tflite.hpp"
+#endif
+#ifdef VPP_HAS_TRACKING_SUPPORT
+#include "vpp/engine/detector/background.hpp"
+#endif
 #include "vpp/stage.hpp"
 
+#include <functional>
+#include <opencv2/core/core.hpp>
+#include <vector>
+
 namespace VPP {
 namespace Stage {
 namespace DNN {
@@ -39,12 +51,67 @@ class Detector : public Stage::ForScene {
         Detector() noexcept;
         ~Detector() noexcept = default;
 
+        /* Only detecting every interval frames, or as soon as the tracking
+         * confidence falls below the threshold: the tracker propagates the
+         * zones on its own on the frames in between */
+        virtual Error::Type process(Scene &s) noexcept override;
+
+        /* The specialised processing is never suspended */
+        virtual bool suspendable() const noexcept override;
+
+        PARAMETER(Direct, Saturating, Immediate, int)   interval;
+        PARAMETER(Direct, Saturating, Immediate, float) threshold;
+
+        /* The tracking confidence probe, always confident if not set */
+        std::function<float () noexcept> tracking;
+
+        /* Only detecting within the regions proposed for the scene unless
+         * they cover too much of the frame, the detection engines being
+         * expected to run without any latency in this case */
+        PARAMETER(Direct, None, Immediate, bool)        cropped;
+        PARAMETER(Direct, Saturating, Immediate, float) coverage;
+
+        /* The regions proposal probe, never proposing anything if not set */
+        std::function<bool (const Scene &, 
+                            std::vector<cv::Rect> &) noexcept> proposals;
+
+        /* Only detecting within the regions predicted by the tracker unless
+         * they cover too much of the frame, with a full frame detection every
+         * refresh detections for the new objects to be found */
+        PARAMETER(Direct, None, Immediate, bool)        predicted;
+        PARAMETER(Direct, Saturating, Immediate, int)   refresh;
+
+        /* The regions prediction probe, never predicting anything if not set */
+        std::function<bool (const Scene &, 
+                            std::vector<cv::Rect> &) noexcept> predictions;
+
+#ifdef VPP_HAS_TRACKING_SUPPORT
+        /* Only detecting when the share of foreground pixels found by the
+         * background engine reaches the activity, for fixed cameras */
+        PARAMETER(Direct, None, Immediate, bool)        gated;
+        PARAMETER(Direct, Saturating, Immediate, float) activity;
+#endif
+
 #ifdef VPP_HAS_DARKNET_SUPPORT
         VPP::Engine::Detector::Darknet darknet;
 #endif
 #ifdef VPP_HAS_OPENCV_DNN_SUPPORT
         VPP::Engine::Detector::OCV     ocv;
+        VPP::Engine::Detector::Cascade cascade;
+#endif
+#ifdef VPP_HAS_TFLITE_SUPPORT
+        VPP::Engine::Detector::TFLite  tflite;
+#endif
+#ifdef VPP_HAS_TRACKING_SUPPORT
+        VPP::Engine::Detector::Background background;
 #endif
+
+    private:
+        Error::Type detect(Scene &s, 
+                           const std::vector<cv::Rect> &rois) noexcept;
+
+        int elapsed;
+        int passes;
 };
 
 class Classifier : public Stage::ForZone {
@@ -53,7 +120,21 @@ class Classifier : public Stage::ForZone {
         ~Classifier() noexcept = default;
 
 #ifdef VPP_HAS_OPENCV_DNN_SUPPORT
-        VPP::Engine::Classifier::OCV ocv;
+        VPP::Engine::Classifier::OCV    ocv;
+#endif
+#ifdef VPP_HAS_TFLITE_SUPPORT
+        VPP::Engine::Classifier::TFLite tflite;
+#endif
+};
+
+/* Classifying all the zones handed over at once, in batches */
+class Classifiers : public Stage::ForZones {
+    public:
+        Classifiers() noexcept;
+        ~Classifiers() noexcept = default;
+
+#ifdef VPP_HAS_OPENCV_DNN_SUPPORT
+        VPP::Engine::Classifier::Batch ocv;
 #endif
 };
 
@@ -22,7 +22,10 @@
 #pragma once
 
 #include "vpp/engine/bridge.hpp"
+#include "vpp/engine/cameras.hpp"
 #include "vpp/engine/capture.hpp"
+#include "vpp/engine/link.hpp"
+#include "vpp/engine/subscription.hpp"
 #include "vpp/stage.hpp"
 
 namespace VPP {
@@ -33,7 +36,10 @@ template <typename ...Z> class Input : public Core::Stage<Z...> {
         Input() noexcept;
         ~Input() noexcept = default;
 
-        VPP::Engine::Bridge<Z...> bridge;
+        VPP::Engine::Bridge<Z...>   bridge;
+
+        /* Getting the scenes sent by the uplinks of other hosts */
+        VPP::Engine::Downlink<Z...> downlink;
 };
 
 template <> class Input<> : public Core::Stage<> {
@@ -43,6 +49,10 @@ template <> class Input<> : public Core::Stage<> {
 
         VPP::Engine::Bridge<> bridge;
         VPP::Engine::Capture  capture;
+        VPP::Engine::Cameras  cameras;
+
+        /* Getting the frames captured by another pipeline */
+        VPP::Engine::Subscription subscription;
 };
 
 /* Describing a stage input for handling a full scene */
@@ -0,0 +1,34 @@
+/**
+ *
+ * @file      vpp/stage/motion.hpp
+ *
+ * @brief     This is the VPP motion handling stage definition
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include "vpp/engine/motion.hpp"
+#include "vpp/stage.hpp"
+
+namespace VPP {
+namespace Stage {
+
+class Motion : public Stage::ForScene {
+    public:
+        Motion() noexcept;
+        ~Motion() noexcept = default;
+
+        VPP::Engine::Motion::Proposal proposal;
+};
+
+}  // namespace Stage
+}  // namespace VPP
@@ -16,7 +16,11 @@
 
 #pragma once
 
+#include "vpp/config.hpp"
 #include "vpp/engine/ocr/mser.hpp"
+#ifdef VPP_HAS_OPENCV_DNN_SUPPORT
+#include "vpp/engine/ocr/east.hpp"
+#endif
 #include "vpp/stage.hpp"
 
 namespace VPP {
@@ -29,6 +33,9 @@ class MSER : public Stage::ForScene  {
         ~MSER() noexcept = default;
 
         VPP::Engine::OCR::MSER mser;
+#ifdef VPP_HAS_OPENCV_DNN_SUPPORT
+        VPP::Engine::OCR::EAST east;
+#endif
 };
 
 }  // namespace OCR
@@ -38,6 +38,17 @@ class Reader : public Stage::ForZone  {
 #endif
 };
 
+/* Reading all the text zones handed over at once, in parallel */
+class Readers : public Stage::ForZones  {
+    public:
+        Readers() noexcept;
+        ~Readers() noexcept = default;
+
+#ifdef VPP_HAS_TESSERACT_SUPPORT
+        VPP::Engine::OCR::Tesseracts tesseract;
+#endif
+};
+
 }  // namespace OCR
 }  // namespace Stage
 }  // namespace VPP
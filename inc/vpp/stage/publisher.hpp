@@ -0,0 +1,38 @@
+/**
+ *
+ * @file      vpp/stage/publisher.hpp
+ *
+ * @brief     These is the VPP publisher stage definition
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include "vpp/engine/link.hpp"
+#include "vpp/engine/publisher.hpp"
+#include "vpp/stage.hpp"
+
+namespace VPP {
+namespace Stage {
+
+class Publisher : public Stage::ForScene {
+    public:
+        Publisher() noexcept;
+        ~Publisher() noexcept = default;
+
+        VPP::Engine::Publisher wire;
+
+        /* Sending the scenes to the downlink of another host */
+        VPP::Engine::Uplink    uplink;
+};
+
+}  // namespace Stage
+}  // namespace VPP
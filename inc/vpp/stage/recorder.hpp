@@ -0,0 +1,34 @@
+/**
+ *
+ * @file      vpp/stage/recorder.hpp
+ *
+ * @brief     These is the VPP recorder stage definition
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include "vpp/engine/recorder.hpp"
+#include "vpp/stage.hpp"
+
+namespace VPP {
+namespace Stage {
+
+class Recorder : public Stage::ForScene {
+    public:
+        Recorder() noexcept;
+        ~Recorder() noexcept = default;
+
+        VPP::Engine::Recorder recorder;
+};
+
+}  // namespace Stage
+}  // namespace VPP
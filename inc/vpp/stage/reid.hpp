@@ -0,0 +1,47 @@
+/**
+ *
+ * @file      vpp/stage/reid.hpp
+ *
+ * @brief     This is the VPP re-identification stage description
+ *
+ * @details   This stage computes the appearance embeddings of the zones of a
+ *            scene before it is tracked, and stages them in its gallery. The
+ *            gallery then serves the cosine measure to the tracker matchers,
+ *            and keeps the embeddings of the tracked UUIDs once the tracked
+ *            scene is committed to it.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include "vpp/config.hpp"
+#include "vpp/engine/reid/gallery.hpp"
+#ifdef VPP_HAS_OPENCV_DNN_SUPPORT
+#include "vpp/engine/reid/ocv.hpp"
+#endif
+#include "vpp/stage.hpp"
+
+namespace VPP {
+namespace Stage {
+
+class Reid : public Stage::ForScene {
+    public:
+        Reid() noexcept;
+        ~Reid() noexcept = default;
+
+        VPP::Engine::Reid::Gallery gallery;
+#ifdef VPP_HAS_OPENCV_DNN_SUPPORT
+        VPP::Engine::Reid::OCV     ocv;
+#endif
+};
+
+}  // namespace Stage
+}  // namespace VPP
@@ -0,0 +1,38 @@
+/**
+ *
+ * @file      vpp/stage/selection.hpp
+ *
+ * @brief     This is the VPP zone selection stage description
+ *
+ * @details   This stage only keeps the most useful zones of a scene, for the
+ *            expensive zone stages following it to bound the latency of the
+ *            crowded scenes, the other zones being deferred to the next ones.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include "vpp/engine/selection.hpp"
+#include "vpp/stage.hpp"
+
+namespace VPP {
+namespace Stage {
+
+class Selection : public Stage::ForZones {
+    public:
+        Selection() noexcept;
+        ~Selection() noexcept = default;
+
+        VPP::Engine::Selection::Utility utility;
+};
+
+}  // namespace Stage
+}  // namespace VPP
@@ -0,0 +1,34 @@
+/**
+ *
+ * @file      vpp/stage/sharing.hpp
+ *
+ * @brief     These is the VPP sharing stage definition
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include "vpp/engine/sharing.hpp"
+#include "vpp/stage.hpp"
+
+namespace VPP {
+namespace Stage {
+
+class Sharing : public Stage::ForScene {
+    public:
+        Sharing() noexcept;
+        ~Sharing() noexcept = default;
+
+        VPP::Engine::Sharing ring;
+};
+
+}  // namespace Stage
+}  // namespace VPP
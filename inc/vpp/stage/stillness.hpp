@@ -0,0 +1,43 @@
+/**
+ *
+ * @file      vpp/stage/stillness.hpp
+ *
+ * @brief     This is the VPP stillness stage description
+ *
+ * @details   This stage marks the scenes nearly identical to the previous one
+ *            as still, for the next stages to reuse their previous results,
+ *            e.g. by filtering them out.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include "vpp/engine/stillness.hpp"
+#include "vpp/stage.hpp"
+
+namespace VPP {
+namespace Stage {
+
+class Stillness : public Stage::ForScene {
+    public:
+        Stillness() noexcept;
+        ~Stillness() noexcept = default;
+
+        /* A filter for the stages to skip the still scenes */
+        static inline bool moving(const Scene &s) noexcept {
+            return !s.still();
+        }
+
+        VPP::Engine::Stillness::Difference difference;
+};
+
+}  // namespace Stage
+}  // namespace VPP
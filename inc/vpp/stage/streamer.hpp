@@ -0,0 +1,34 @@
+/**
+ *
+ * @file      vpp/stage/streamer.hpp
+ *
+ * @brief     These is the VPP streamer stage definition
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include "vpp/engine/streamer.hpp"
+#include "vpp/stage.hpp"
+
+namespace VPP {
+namespace Stage {
+
+class Streamer : public Stage::ForScene {
+    public:
+        Streamer() noexcept;
+        ~Streamer() noexcept = default;
+
+        VPP::Engine::Streamer mjpeg;
+};
+
+}  // namespace Stage
+}  // namespace VPP
@@ -22,8 +22,12 @@
 #include "vpp/engine/tracker/none.hpp"
 #include "vpp/engine/tracker/ocv.hpp"
 #include "vpp/stage.hpp"
+#include "vpp/util/metrics.hpp"
+#include "vpp/util/mutex.hpp"
 #include "vpp/util/observability.hpp"
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 
 namespace VPP {
@@ -32,7 +36,7 @@ namespace Stage {
 class Tracker : public Stage::ForScene {
     public:
         Tracker() noexcept;
-        ~Tracker() noexcept = default;
+        ~Tracker() noexcept;
 
         VPP::Engine::Tracker::OCV      ocv;
         VPP::Engine::Tracker::CamShift camshift;
@@ -40,21 +44,57 @@ class Tracker : public Stage::ForScene {
         VPP::Engine::Tracker::History  history;
         VPP::Engine::Tracker::None     none;
 
+        /* An immutable snapshot of the tracker output, published after every
+         * scene, that the readers share without any locking nor copying */
+        struct Snapshot {
+            Scene             scene;
+            std::vector<Zone> entering;
+            std::vector<Zone> leaving;
+        };
+        using Published = std::shared_ptr<const Snapshot>;
+
+        /* The latest published snapshot, never null */
+        Published current() const noexcept;
+
+        /* Copying the latest published snapshot */
         void snapshot(Scene &s) noexcept;
         void snapshot(std::vector<Zone> &entering,
                       std::vector<Zone> &leaving) noexcept;
         void snapshot(Scene &s, std::vector<Zone> &entering, 
                       std::vector<Zone> &leaving) noexcept;
 
+        /* The share of the zones tracked after the latest detection that
+         * are still tracked, used for scheduling the detections */
+        float confidence() noexcept;
+
         virtual Error::Type process(Scene &s) noexcept override;
 
+        /* The specialised processing is never suspended */
+        virtual bool suspendable() const noexcept override;
+
         Util::Notifier<Scene, std::vector<Zone>, std::vector<Zone>> event;
 
     protected:
-        std::mutex        synchro;
-        Scene             latest;
-        std::vector<Zone> added;
-        std::vector<Zone> removed;
+        /* Publishing the latest scene and its changes, the engines only
+         * updating them under the synchro mutex */
+        Published publish() noexcept;
+
+        Util::Mutex              synchro;
+        Scene                    latest;
+        std::vector<Zone>        added;
+        std::vector<Zone>        removed;
+        std::atomic<std::size_t> reference;
+
+        /* The published snapshot, atomically swapped, and the previous one
+         * kept for the next publication once no reader holds it anymore */
+        Published                 published;
+        std::shared_ptr<Snapshot> spare;
+
+        /* Tracker instrumentation, as exported metrics */
+        std::atomic<uint64_t>           tracked;
+        std::atomic<uint64_t>           entered;
+        std::atomic<uint64_t>           left;
+        Util::Metrics::Registry::Handle exported;
 };
 
 }  // namespace Stage
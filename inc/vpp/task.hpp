@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <string>
 #include <type_traits>
 #include <utility>
 
@@ -31,6 +32,34 @@
 namespace VPP {
 namespace Task {
 
+/** Customisable process-wide pool of workers running the asynchronous tasks */
+class Pool : public Parametrisable {
+    public:
+        Pool() noexcept;
+        ~Pool() noexcept = default;
+
+        /* Number of persistent workers (0 for launching a thread per task) */
+        PARAMETER(Direct, Saturating, Callable, int) workers;
+
+        /* Shares of the workers of the tasks of every priority */
+        PARAMETER(Direct, Saturating, Callable, int) critical;
+        PARAMETER(Direct, Saturating, Callable, int) normal;
+        PARAMETER(Direct, Saturating, Callable, int) background;
+
+        /* Cores running the workers */
+        PARAMETER(Direct, None, Callable, std::string) affinity;
+
+        /* Setting the engines up concurrently at startup, on the workers */
+        PARAMETER(Direct, None, Callable, bool) concurrent;
+
+    private:
+        Customisation::Error onWorkersUpdate(const int &w) noexcept;
+        Customisation::Error onAffinityUpdate(const std::string &a) noexcept;
+        Customisation::Error onConcurrentUpdate(const bool &yes) noexcept;
+        Customisation::Error onWeightUpdate(int priority,
+                                            const int &w) noexcept;
+};
+
 /** Single task */
 template <typename T, typename ...E> 
     class Single : public Parametrisable, public Util::Task::Single<T, E...> {
@@ -70,15 +99,34 @@ template <typename T, typename L, typename ...E>
         using Parent::wait;
 
         inline explicit List(const int mode) noexcept
-            : Customisation::Entity("Tasks"), Parent(mode) {};
+            : Customisation::Entity("Tasks"), Parent(mode) {
+            grain.denominate("grain")
+                 .describe("The number of list items handed out at once to "
+                           "each task")
+                 .characterise(Customisation::Trait::CONFIGURABLE);
+            grain.range(1, 1024);
+            grain.trigger([this](const int &g) {
+                          return onGrainUpdate(g); });
+            expose(grain);
+            grain = 1;
+        };
         inline ~List() noexcept = default;
 
+        /* Number of items handed out at once to each task */
+        PARAMETER(Direct, Saturating, Callable, int) grain;
+
         inline Error::Type process(Util::containee_object_t<L> &/*o*/, 
                                    E&... /*e*/) noexcept {
             LOGE("%s[%s]::process(): Process shall be redefined in child "
                  "classes!", value_to_string().c_str(), name().c_str());
             return Error::NOT_EXISTING;
         }
+
+    private:
+        inline Customisation::Error onGrainUpdate(const int &g) noexcept {
+            Parent::granulate(g);
+            return Customisation::Error::NONE;
+        }
 };
 
 /** Task lists: runs two lists X and Y of tasks, running each task along the
@@ -94,9 +142,22 @@ template <typename T, typename X, typename Y, typename ...E>
         using Parent::wait;
 
         inline explicit Lists(const int mode) noexcept
-            : Customisation::Entity("Tasks"), Parent(mode) {};
+            : Customisation::Entity("Tasks"), Parent(mode) {
+            grain.denominate("grain")
+                 .describe("The number of list item pairs handed out at once "
+                           "to each task")
+                 .characterise(Customisation::Trait::CONFIGURABLE);
+            grain.range(1, 1024);
+            grain.trigger([this](const int &g) {
+                          return onGrainUpdate(g); });
+            expose(grain);
+            grain = 16;
+        };
         inline ~Lists() noexcept = default;
 
+        /* Number of item pairs handed out at once to each task */
+        PARAMETER(Direct, Saturating, Callable, int) grain;
+
         inline Error::Type process(Util::containee_object_t<X> &/*xo*/, 
                                    Util::containee_object_t<Y> &/*yo*/, 
                                    E&... /*e*/) noexcept {
@@ -104,6 +165,12 @@ template <typename T, typename X, typename Y, typename ...E>
                  "classes!", value_to_string().c_str(), name().c_str());
             return Error::NOT_EXISTING;
         }
+
+    private:
+        inline Customisation::Error onGrainUpdate(const int &g) noexcept {
+            Parent::granulate(g);
+            return Customisation::Error::NONE;
+        }
 };
 
 /* Describing parallel tasks operating on bidimentional tiles in a scene */
@@ -118,7 +185,7 @@ class Tiled : public Parametrisable,
 
         inline explicit Tiled(const int mode) noexcept 
             : Customisation::Entity("Tasks"), Parent(mode), frame(), it(),
-              tiles_total(0) {
+              tiles_total(0), masking(nullptr) {
             tile.denominate("tile")
                 .describe("The tile geometry to use for the processing");
             expose(tile);
@@ -139,6 +206,7 @@ class Tiled : public Parametrisable,
         inline ~Tiled() noexcept = default;
         
         inline Error::Type start(Scene &s, cv::Rect f) noexcept {
+            mask(s);
             frame        = std::move(f);
             it           = cv::Rect(frame.tl(), static_cast<cv::Size>(tile));
             tiles_total  = 0;
@@ -150,11 +218,17 @@ class Tiled : public Parametrisable,
         Stride stride;
 
     protected:
-        /** Iterator to do things in parallel */
+        /** Getting the mask of the scene (if any), at its frame resolution */
+        inline void mask(Scene &s) noexcept {
+            masking = (s.view.mask != nullptr) ?
+                      &s.view.mask->raster(s.view.frame().size()) : nullptr;
+        }
+
+        /** Iterator to do things in parallel, the masked tiles being skipped
+         * altogether */
         inline bool next(Scene& /*s*/, cv::Rect &roi) noexcept {
-            if (frame.contains(it.tl())) {
+            while (frame.contains(it.tl())) {
                 roi = it;
-                ++ tiles_total;
     
                 /* Compute the next location */
                 it.x += stride.x;
@@ -162,7 +236,11 @@ class Tiled : public Parametrisable,
                     it.x = frame.x;
                     it.y += stride.y;
                 }
-                return true;
+
+                if ( (masking == nullptr) || (!masking->excluded(roi)) ) {
+                    ++ tiles_total;
+                    return true;
+                }
             }
 
             return false;
@@ -178,6 +256,9 @@ class Tiled : public Parametrisable,
         cv::Rect frame;
         cv::Rect it;
         int      tiles_total;
+
+        /* The mask of the scene being processed, if any */
+        const Util::OCV::Mask::Raster *masking;
 };
 
 }  // namespace Task
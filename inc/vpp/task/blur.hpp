@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <atomic>
+
 #include "customisation/parameter.hpp"
 #include "vpp/error.hpp"
 #include "vpp/task.hpp"
@@ -44,13 +46,43 @@ class Skipping : public VPP::Tasks::Tiled<Skipping> {
          * skip the scene */
         PARAMETER(Direct, Bounded, Immediate, float) coverage;
 
+        /* Sampling level, the level of the shared gray pyramid on which the
+         * sharpness is estimated, 0 being the full-resolution frame */
+        PARAMETER(Direct, Bounded, Immediate, int) sampling;
+
+        /* Calibration gain, the factor applied to the sharpness measured at
+         * each sampling level to match the full-resolution threshold */
+        PARAMETER(Direct, Bounded, Immediate, float) gain;
+
         Error::Type start(Scene &s, cv::Rect &frame) noexcept;
         Error::Type wait() noexcept;
 
         Error::Type process(Scene &s, cv::Rect &r) noexcept;
 
     private:
-        int tiles_valid;
+        /* The parameters read by all the tiles, as snapshotted once per
+         * scene before any tile is processed */
+        struct Settings {
+            float sharpness;
+            float coverage;
+        };
+
+        Settings         settings;
+
+        /* Gray frame shared by all the tiles, its scale with respect to the
+         * tiled frame and the calibration of its measures */
+        cv::Mat          gray;
+        float            sx, sy;
+        float            calibration;
+
+        /* Tiles count and the minimal number of valid tiles for the scene */
+        int              tiles_expected;
+        float            tiles_required;
+
+        /* Valid and blurred tiles, tiles being skipped once the outcome is
+         * known */
+        std::atomic<int> tiles_valid;
+        std::atomic<int> tiles_blurred;
 };
 
 }  // namespace Blur
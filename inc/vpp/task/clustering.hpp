@@ -20,6 +20,7 @@
 #pragma once
 
 #include <mutex>
+#include <vector>
 
 #include "customisation/parameter.hpp"
 #include "vpp/config.hpp"
@@ -37,6 +38,14 @@ class DilateAndJoin : public VPP::Task::Single<DilateAndJoin, Scene&> {
         using Parent::start;
         using Parent::wait;
 
+        /** Algorithms for joining the overlapping dilated zones */
+        enum class Joining : int {
+            /** Repeated pairwise scans of all the clusters */
+            PAIRWISE = 0,
+            /** Sweep-line over the clusters and union-find of components */
+            SWEEP    = 1
+        };
+
         explicit DilateAndJoin(const int mode) noexcept;
         virtual ~DilateAndJoin() noexcept = default;
 
@@ -51,6 +60,9 @@ class DilateAndJoin : public VPP::Task::Single<DilateAndJoin, Scene&> {
          * a standard dilatation is applied */
         PARAMETER(Direct, None, Immediate, bool) cross;
 
+        /* Joining algorithm, the pairwise one being kept for comparison */
+        PARAMETER(Mapped, None, Immediate, int) joining;
+
         Error::Type process(Scene &scn) noexcept;
 };
 
@@ -73,6 +85,62 @@ class Similarity : public VPP::Task::Single<Similarity, Scene&> {
 
         Error::Type process(Scene &scn) noexcept;
 };
+
+/* The zones sharing a prediction class, along with the clustering buffers that
+ * are kept from one frame to the next */
+class Partition {
+    public:
+        Partition() noexcept : gid(-1), zones(), clusters(), areas(),
+                               weights(), labels(), order(), firsts() {}
+        ~Partition() noexcept = default;
+
+        /* Dataset and class identifier of the zones */
+        int32_t                 gid;
+
+        /* Zones to cluster and resulting clusters */
+        std::vector<Zone>       zones;
+        std::vector<Zone>       clusters;
+
+        /* Grouped rectangles and their weights, cluster label of each zone,
+         * and zones sorted by label with the first zone of each label */
+        std::vector<cv::Rect>   areas;
+        std::vector<int>        weights;
+        std::vector<int>        labels;
+        std::vector<int>        order;
+        std::vector<int>        firsts;
+};
+
+using Partitions = std::vector<Partition>;
+
+/* Similarity clustering of the zones of each prediction class apart, all the
+ * classes being clustered in parallel */
+class Classwise : public VPP::Tasks::List<Classwise, Partitions&> {
+    public:
+        using Parent = VPP::Tasks::List<Classwise, Partitions&>;
+        using typename Parent::Mode;
+        using Parent::process;
+        using Parent::next;
+
+        explicit Classwise(const int mode) noexcept;
+        ~Classwise() noexcept = default;
+
+        /* Zone filter to be applied prior to clustering */
+        Scene::ZoneFilter filter;
+
+        /* Similarity threshold, the smaller the pickier it becomes */
+        PARAMETER(Direct, None, Immediate, double) threshold;
+
+        /* Cluster the filtered zones of a scene, class by class */
+        Error::Type cluster(Scene &scn) noexcept;
+
+        Error::Type process(Partition &p) noexcept;
+
+    private:
+        /* Partitions are reused across frames, only the first used of them
+         * holding the zones of the current frame */
+        Partitions  partitions;
+        std::size_t used;
+};
 #endif
 
 }  // namespace Clustering
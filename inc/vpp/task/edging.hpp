@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <opencv2/core.hpp>
 #include <vector>
 
 #include "vpp/error.hpp"
@@ -33,6 +34,29 @@ class Edging : public VPP::Task::Single<Edging, Scene&> {
         using Parent::process;
         using Parent::start;
 
+        /* A Canny edge detection of a colour plane at a threshold level */
+        struct Level {
+            const cv::Mat *plane;
+            int            low;
+            int            high;
+            int            kernel;
+            cv::Mat        edges;
+        };
+
+        /* Running all the Canny edge detections as parallel tasks */
+        class Canny : public VPP::Tasks::List<Canny, std::vector<Level>&> {
+            public:
+                using Parent = VPP::Tasks::List<Canny, std::vector<Level>&>;
+                using typename Parent::Mode;
+                using Parent::process;
+                using Parent::next;
+
+                explicit Canny(const int mode) noexcept;
+                virtual ~Canny() noexcept = default;
+
+                Error::Type process(Level &level) noexcept;
+        };
+
         explicit Edging(const int mode) noexcept;
         ~Edging() noexcept = default;
 
@@ -45,6 +69,16 @@ class Edging : public VPP::Task::Single<Edging, Scene&> {
         PARAMETER(Direct, Saturating, Immediate, int) levels;
 
         Error::Type process(Scene &scene) noexcept;
+
+        Canny canny;
+
+    private:
+        /* Intermediate buffers reused from one frame to another */
+        cv::Mat              scaled;
+        cv::Mat              blurred;
+        cv::Mat              edged;
+        std::vector<cv::Mat> planes;
+        std::vector<Level>   detections;
 };
 
 }  // namespace Task
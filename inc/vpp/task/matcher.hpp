@@ -21,10 +21,17 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <numeric>
 #include <opencv2/core/mat.hpp>
 #include <unordered_map>
+#include <vector>
 
+#include "vpp/log.hpp"
 #include "vpp/task.hpp"
+#include "vpp/util/metrics.hpp"
+#include "vpp/util/ocv/functions.hpp"
 
 namespace VPP {
 namespace Task {
@@ -39,6 +46,46 @@ template <typename Src, typename Dst>
         = std::function<float (containee_object_t<Src>&, 
                                containee_object_t<Dst>&) noexcept>;
 
+/* Batch measures fill the whole results matrix at once, i.e. one row per
+ * source and one column per destination */
+template <typename Src, typename Dst>
+    using Batch 
+        = std::function<Error::Type (storable_wrapper_t<Src>&, 
+                                     storable_wrapper_t<Dst>&,
+                                     cv::Mat &results) noexcept>;
+
+/* Row measures score a source against all the destinations at once, filling
+ * one row of results */
+template <typename Src, typename Dst>
+    using Row 
+        = std::function<void (containee_object_t<Src>&, 
+                              storable_wrapper_t<Dst>&,
+                              float *results) noexcept>;
+
+/* A measure and its row implementation, the estimators scoring the pairs one
+ * at a time with the former and the rows with the latter */
+template <typename Src, typename Dst>
+struct Kernel {
+    Measure<Src, Dst> pair;
+    Row<Src, Dst>     row;
+};
+
+/* Building the kernel of any (constant) measure functor: the row loop calls
+ * the functor directly, so that it is inlined whenever its type is known at
+ * compile time, and only a single indirect call remains per row */
+template <typename Src, typename Dst, typename F>
+    inline Kernel<Src, Dst> kernel(F f) noexcept {
+    Kernel<Src, Dst> k;
+    k.row = [f](containee_object_t<Src> &s, storable_wrapper_t<Dst> &dsts,
+                float *r) noexcept {
+                for (auto &d : dsts) {
+                    *r ++ = f(s, static_cast<containee_object_t<Dst>&>(d));
+                }
+            };
+    k.pair = std::move(f);
+    return k;
+}
+
 template <typename Src, typename Dst>
 class Single : public VPP::Task::Single<Single<Src, Dst>> {
     public:
@@ -52,11 +99,11 @@ class Single : public VPP::Task::Single<Single<Src, Dst>> {
         inline ~Single() = default;
 
         inline Error::Type start(Src s, Dst d, cv::Mat &results, 
-                                 Measure<Src, Dst> evaluator) noexcept {
+                                 Kernel<Src, Dst> evaluator) noexcept {
             /* Preallocate the results matrix to allow parallel computation and
              * to ensure that it is fully contiguous in memory */ 
             results = std::move(cv::Mat(s.size(), d.size(), CV_32F));
-            measure = std::move(evaluator);
+            row     = std::move(evaluator.row);
             src     = std::move(storable_wrapper_t<Src>(s));
             dst     = std::move(storable_wrapper_t<Dst>(d));
             scores  = results.ptr<float>();
@@ -66,17 +113,15 @@ class Single : public VPP::Task::Single<Single<Src, Dst>> {
         inline Error::Type process() noexcept {
             float *r = scores;
             for (auto &s : src) {
-                for (auto &d : dst) {
-                    *r ++ = measure(static_cast<containee_object_t<Src>&>(s),
-                                    static_cast<containee_object_t<Dst>&>(d));
-                }
+                row(static_cast<containee_object_t<Src>&>(s), dst, r);
+                r += dst.size();
             }
 
             return Error::OK;
         }
 
     protected:
-        Measure<Src, Dst>       measure;
+        Row<Src, Dst>           row;
         storable_wrapper_t<Src> src;
         storable_wrapper_t<Dst> dst;
         float *                 scores;
@@ -95,11 +140,11 @@ class List : public VPP::Tasks::List<List<Src, Dst>, Src, float *> {
         inline ~List() = default;
 
         inline Error::Type start(Src s, Dst d, cv::Mat &results, 
-                                 Measure<Src, Dst> evaluator) noexcept {
+                                 Kernel<Src, Dst> evaluator) noexcept {
             /* Preallocate the results matrix to allow parallel computation and
              * to ensure that it is fully contiguous in memory */ 
             results = std::move(cv::Mat(s.size(), d.size(), CV_32F));
-            measure = std::move(evaluator);
+            row     = std::move(evaluator.row);
             dst     = std::move(storable_wrapper_t<Dst>(d));
             scores  = results.ptr<float>();
             return Parent::start(s, scores);
@@ -113,15 +158,13 @@ class List : public VPP::Tasks::List<List<Src, Dst>, Src, float *> {
 
         inline Error::Type process(containee_object_t<Src> &s,
                                    float *&r) noexcept {
-            for (auto &d : dst) {
-                *r ++ = measure(s, static_cast<containee_object_t<Dst>&>(d));
-            }
+            row(s, dst, r);
 
             return Error::OK;
         }
 
     protected:
-        Measure<Src, Dst>       measure;
+        Row<Src, Dst>           row;
         storable_wrapper_t<Dst> dst;
         float *                 scores;
 };
@@ -139,11 +182,11 @@ class Lists : public VPP::Tasks::Lists<Lists<Src, Dst>, Src, Dst, float *> {
         inline ~Lists() = default;
 
         inline Error::Type start(Src s, Dst d, cv::Mat &results, 
-                                 Measure<Src, Dst> evaluator) noexcept {
+                                 Kernel<Src, Dst> evaluator) noexcept {
             /* Preallocate the results matrix to allow parallel computation and
              * to ensure that it is fully contiguous in memory */ 
             results = std::move(cv::Mat(s.size(), d.size(), CV_32F));
-            measure = std::move(evaluator);
+            measure = std::move(evaluator.pair);
             scores  = results.ptr<float>();
             return Parent::start(s, d, scores);
         }
@@ -179,7 +222,10 @@ class Any : public Parametrisable {
             /** Process estimation by source line */
             ROW     =  0,
             /** Process estimation globally */
-            GLOBAL  =  1
+            GLOBAL  =  1,
+            /** Process estimation globally or by source line, whichever is
+             *  the fastest for the size of the estimation */
+            AUTO    =  2
         };
 
         inline explicit
@@ -187,20 +233,40 @@ class Any : public Parametrisable {
                 const int mode_list   = List<Src, Dst>::Mode::Async*8,
                 const int mode_lists  = Lists<Src, Dst>::Mode::Async*8) 
             noexcept : Customisation::Entity("Tasks"), single(mode_single), 
-                       list(mode_list), lists(mode_lists) {
+                       list(mode_list), lists(mode_lists), 
+                       running(Granularity::ROW), pairs(0), began(0),
+                       bands(), runs() {
             granularity.denominate("granularity")
                        .describe("The granularity of tasks for the matcher "
                                  "estimator: either all for a single task "
-                                 "computation, row for one task per row, or "
-                                 "measure for one task per measure")
+                                 "computation, row for one task per row, "
+                                 "measure for one task per measure, or auto "
+                                 "for timing the all and row granularities "
+                                 "and using the fastest for each size")
                         .characterise(Customisation::Trait::CONFIGURABLE);
             granularity.define(
                     { { "all",     static_cast<int>(Granularity::GLOBAL) }, 
                       { "row",     static_cast<int>(Granularity::ROW)},
-                      { "measure", static_cast<int>(Granularity::MEASURE) } });
+                      { "measure", static_cast<int>(Granularity::MEASURE) },
+                      { "auto",    static_cast<int>(Granularity::AUTO) } });
             expose(granularity);
         
             granularity = static_cast<int>(Granularity::ROW);
+
+            cutoff.denominate("cutoff")
+                  .describe("The number of pairs below which the auto "
+                            "granularity always computes in a single task")
+                  .characterise(Customisation::Trait::SETTABLE);
+            cutoff.range(0, 1 << 20);
+            expose(cutoff);
+
+            cutoff = 256;
+
+            /* Expose the chunking of the row and measure estimators */
+            list.denominate("rows");
+            expose(list);
+            lists.denominate("measures");
+            expose(lists);
         }
         inline ~Any() = default;
 
@@ -211,21 +277,26 @@ class Any : public Parametrisable {
         Any& operator=(Any&& other) = delete;
 
         inline Error::Type start(Src s, Dst d, cv::Mat &results, 
-                                 Measure<Src, Dst> evaluator) noexcept {
-            switch(granularity) {
-                case static_cast<int>(Granularity::MEASURE):
+                                 Kernel<Src, Dst> evaluator) noexcept {
+            pairs   = static_cast<uint64_t>(s.size()) * d.size();
+            running = choose();
+            runs[static_cast<int>(running) + 1]
+                .fetch_add(1, std::memory_order_relaxed);
+            began   = Util::Histogram::now();
+            switch(running) {
+                case Granularity::MEASURE:
                     return lists.start(std::forward<Src>(s),
                                        std::forward<Dst>(d), 
                                        std::forward<cv::Mat&>(results), 
                                        std::move(evaluator));
                     break;
-                case static_cast<int>(Granularity::ROW):
+                case Granularity::ROW:
                     return list.start(std::forward<Src>(s),
                                       std::forward<Dst>(d), 
                                       std::forward<cv::Mat&>(results), 
                                       std::move(evaluator));
                     break;
-                case static_cast<int>(Granularity::GLOBAL):
+                case Granularity::GLOBAL:
                 default:
                     return single.start(std::forward<Src>(s),
                                         std::forward<Dst>(d), 
@@ -236,27 +307,137 @@ class Any : public Parametrisable {
         }
 
         inline Error::Type wait() noexcept {
-            switch(granularity) {
-                case static_cast<int>(Granularity::MEASURE):
-                    return lists.wait();
+            Error::Type error;
+            switch(running) {
+                case Granularity::MEASURE:
+                    error = lists.wait();
                     break;
-                case static_cast<int>(Granularity::ROW):
-                    return list.wait();
+                case Granularity::ROW:
+                    error = list.wait();
                     break;
-                case static_cast<int>(Granularity::GLOBAL):
+                case Granularity::GLOBAL:
                 default:
-                    return single.wait();
+                    error = single.wait();
                     break;
             }
+
+            learn(Util::Histogram::now() - began);
+            return error;
+        }
+
+        /* The granularity of the latest estimation */
+        inline Granularity selected() const noexcept {
+            return running;
+        }
+
+        /* The number of estimations run with a granularity */
+        inline uint64_t estimations(Granularity g) const noexcept {
+            return runs[static_cast<int>(g) + 1]
+                .load(std::memory_order_relaxed);
         }
 
         /* Matching evaluator: the scoring evaluator */
         PARAMETER(Mapped, None, Immediate, int) granularity;
 
+        /* The number of pairs below which the parallel tasks cost more to
+         * dispatch than they save */
+        PARAMETER(Direct, Saturating, Immediate, int) cutoff;
+
     protected:
         Single<Src, Dst> single;
         List<Src, Dst>   list;
         Lists<Src, Dst>  lists;
+
+    private:
+        /* The auto granularity keeps the cost per pair of each candidate for
+         * each power of two of the number of pairs, each candidate being
+         * timed a few times first, and the slowest being timed again every
+         * so often for following the load of the task pool */
+        static constexpr int      BANDS   = 32;
+        static constexpr uint32_t TRIALS  = 4;
+        static constexpr uint32_t REVISIT = 64;
+
+        struct Band {
+            Band() noexcept : cost{0, 0}, trials{0, 0}, count(0),
+                              fastest(-1) {}
+
+            uint64_t cost[2];
+            uint32_t trials[2];
+            uint32_t count;
+            int      fastest;
+        };
+
+        /* The candidates are GLOBAL (0) and ROW (1) */
+        static inline Granularity candidate(int c) noexcept {
+            return (c == 0) ? Granularity::GLOBAL : Granularity::ROW;
+        }
+
+        inline Band &band() noexcept {
+            int b = (pairs == 0) ? 0 : 63 - __builtin_clzll(pairs);
+            return bands[std::min(b, BANDS - 1)];
+        }
+
+        inline bool tuned() const noexcept {
+            return (static_cast<int>(granularity) == 
+                    static_cast<int>(Granularity::AUTO)) &&
+                   (pairs >= static_cast<uint64_t>(static_cast<int>(cutoff)));
+        }
+
+        inline Granularity choose() noexcept {
+            if (static_cast<int>(granularity) != 
+                static_cast<int>(Granularity::AUTO)) {
+                return static_cast<Granularity>(static_cast<int>(granularity));
+            }
+            if (!tuned()) {
+                return Granularity::GLOBAL;
+            }
+
+            auto &b = band();
+            for (int c = 0; c < 2; ++c) {
+                if (b.trials[c] < TRIALS) {
+                    return candidate(c);
+                }
+            }
+
+            int best = (b.cost[0] <= b.cost[1]) ? 0 : 1;
+            if ((++b.count % REVISIT) == 0) {
+                return candidate(1 - best);
+            }
+            return candidate(best);
+        }
+
+        inline void learn(uint64_t ns) noexcept {
+            if ( (!tuned()) || (running == Granularity::MEASURE) ) {
+                return;
+            }
+
+            /* Costs are kept per 1024 pairs, as a moving average */
+            auto &b   = band();
+            int   c   = (running == Granularity::GLOBAL) ? 0 : 1;
+            auto  per = (ns << 10) / pairs;
+            b.cost[c] = (b.trials[c] == 0) ? per : (3 * b.cost[c] + per) / 4;
+            if (b.trials[c] < TRIALS) {
+                ++b.trials[c];
+            }
+
+            if ( (b.trials[0] < TRIALS) || (b.trials[1] < TRIALS) ) {
+                return;
+            }
+            int best = (b.cost[0] <= b.cost[1]) ? 0 : 1;
+            if (best != b.fastest) {
+                b.fastest = best;
+                LOGD("%s[%s]::wait(): Using the %s granularity from %d pairs",
+                     value_to_string().c_str(), name().c_str(),
+                     (best == 0) ? "all" : "row",
+                     static_cast<int>(pairs));
+            }
+        }
+
+        Granularity           running;
+        uint64_t              pairs;
+        uint64_t              began;
+        Band                  bands[BANDS];
+        std::atomic<uint64_t> runs[4];
 };
 
 }  // namespace Estimator
@@ -273,7 +454,18 @@ using Matches = std::vector<Match>;
 
 class Measures {
     public:
-        Measures() = default;
+        /* Assignment solvers for extracting the matches */
+        enum class Assignment : int {
+            /** Greedily pick the best remaining score */
+            GREEDY    = 0,
+            /** Optimal assignment with the Hungarian algorithm */
+            HUNGARIAN = 1,
+            /** Near-optimal assignment with the auction algorithm */
+            AUCTION   = 2
+        };
+
+        Measures() noexcept : measurements(), gated(false), sources(0), 
+                              destinations(0), candidates() {}
         ~Measures() = default;
 
         /* 
@@ -281,10 +473,13 @@ class Measures {
          * provided threshold. If exclusive_dst is set, then a given destination
          * can only match one source in the returned matches. Similarly, if
          * exclusive src is set then a given source can only match once in the
-         * returned matches
+         * returned matches. Optimal assignments are only relevant in the fully
+         * exclusive case, and they maximise the number of matches first, then
+         * their total score. Matches are always sorted by decreasing score
          */
         Matches extract(float threshold, bool exclusive_dst = true, 
-                        bool exclusive_src = true) const noexcept;
+                        bool exclusive_src = true,
+                        Assignment solver = Assignment::GREEDY) const noexcept;
         
         /* Scores obtained by source for each destination */
         std::vector<float> scores(Match &m) const noexcept;
@@ -293,7 +488,26 @@ class Measures {
         std::vector<float> peers(Match &m) const noexcept;
 
     protected:
+        /* Dense measurements: one row per source, one column per destination */
         cv::Mat measurements;
+
+        /* Sparse measurements: only the gated candidate pairs are scored, and
+         * all other pairs can never match */
+        bool    gated;
+        int     sources;
+        int     destinations;
+        Matches candidates;
+
+    private:
+        cv::Mat densify() const noexcept;
+        Matches greedy(float threshold, bool exclusive_dst, 
+                       bool exclusive_src) const noexcept;
+        Matches ranked(float threshold, bool exclusive_dst, 
+                       bool exclusive_src) const noexcept;
+        Matches hungarian(const cv::Mat &measures,
+                          float threshold) const noexcept;
+        Matches auction(const cv::Mat &measures,
+                        float threshold) const noexcept;
 };
 
 template <typename Src, typename Dst,
@@ -316,7 +530,9 @@ class Generic : public Parametrisable, public Measures {
                                containee_object_t<Dst>&) noexcept -> float {
                                 return 0.0f;}));
 
-            define("iou_image", iou_image);
+            define("iou_image", ([](containee_object_t<Src> &s,
+                                    containee_object_t<Dst> &d) noexcept {
+                                     return iou_image(s, d); }), iou_images);
 
             threshold.denominate("threshold")
                      .describe("The minimum score for considering a (source, "
@@ -325,18 +541,49 @@ class Generic : public Parametrisable, public Measures {
                      .characterise(Customisation::Trait::SETTABLE);
             expose(threshold);
 
+            assignment.denominate("assignment")
+                      .describe("The assignment solver for extracting the "
+                                "matches: either greedy, hungarian for an "
+                                "optimal assignment or auction for a "
+                                "near-optimal one")
+                      .characterise(Customisation::Trait::SETTABLE);
+            assignment.define(
+                { { "greedy",    static_cast<int>(Assignment::GREEDY) },
+                  { "hungarian", static_cast<int>(Assignment::HUNGARIAN) },
+                  { "auction",   static_cast<int>(Assignment::AUCTION) } });
+            expose(assignment);
+
+            assignment = static_cast<int>(Assignment::GREEDY);
+
+            gating.denominate("gating")
+                  .describe("The maximal distance in pixels between a source "
+                            "and a destination box for scoring the pair, or "
+                            "-1 for scoring all pairs")
+                  .characterise(Customisation::Trait::SETTABLE);
+            gating.range(-1, 65535);
+            expose(gating);
+
+            gating = -1;
+
             estimator.denominate("estimator");
             expose(estimator);
         }
         inline ~Generic() = default;
 
-        inline Error::Type define(std::string key,
-                                  Estimator::Measure<Src, Dst> e) noexcept {
+        /* Defining a measure selectable at runtime: any measure functor may
+         * be provided, but only lambdas and functors (not std::functions nor
+         * function pointers) are inlined in the row estimators */
+        template <typename F>
+            inline Error::Type define(std::string key, F e,
+                                      Estimator::Batch<Src, Dst> b = nullptr)
+            noexcept {
             auto found = measures.find(key);
             if (found != measures.end()) {
                 return Error::INVALID_VALUE;
             }
-            auto p = measures.emplace(key, std::move(e));
+            auto p = measures.emplace(key, Measurement{
+                                    Estimator::kernel<Src, Dst>(std::move(e)),
+                                    std::move(b)});
             measure.define(std::move(key), &p.first->second);
             
             return Error::OK;
@@ -359,11 +606,20 @@ class Generic : public Parametrisable, public Measures {
         Generic& operator=(const Generic& other) = delete;
         Generic& operator=(Generic&& other) = delete;
 
-        inline Error::Type estimate(Src s, Dst d, 
-                                    Estimator::Measure<Src, Dst> e) noexcept {
+        /* Estimating with a measure known at compile time, bypassing the
+         * runtime selected one */
+        template <typename F>
+            inline Error::Type estimate(Src s, Dst d, F e) noexcept {
+            return estimate(std::forward<Src>(s), std::forward<Dst>(d),
+                            Estimator::kernel<Src, Dst>(std::move(e)));
+        }
+
+        inline Error::Type estimate(Src s, Dst d,
+                                    Estimator::Kernel<Src, Dst> e) noexcept {
             /* Keep track of the requested source and destination objects */
             src = std::move(storable_wrapper_t<Src>(s));
             dst = std::move(storable_wrapper_t<Dst>(d));
+            gated = false;
 
             auto error = estimator.start(std::forward<Src>(s),
                                          std::forward<Dst>(d), 
@@ -376,16 +632,35 @@ class Generic : public Parametrisable, public Measures {
         }
             
         inline Error::Type estimate(Src s, Dst d) noexcept {
-            Estimator::Measure<Src, Dst> eval =
-                *(static_cast<Estimator::Measure<Src,Dst>*>
+            auto &m = *(static_cast<Measurement*>
                                         (static_cast<void *>(measure)));
+
+            /* Gating only scores the pairs of nearby boxes */
+            if (static_cast<int>(gating) >= 0) {
+                return gate(std::forward<Src>(s), std::forward<Dst>(d),
+                            m.kernel.pair);
+            }
+
+            /* Batch measures bypass the pair by pair estimator tasks */
+            if (m.batch != nullptr) {
+                src = std::move(storable_wrapper_t<Src>(s));
+                dst = std::move(storable_wrapper_t<Dst>(d));
+                gated = false;
+                measurements = std::move(cv::Mat(src.size(), dst.size(),
+                                                 CV_32F));
+                return m.batch(src, dst, measurements);
+            }
+
+            Estimator::Kernel<Src, Dst> eval = m.kernel;
             return estimate(std::forward<Src>(s), std::forward<Dst>(d),
                             std::move(eval)); 
         }
 
         inline Matches extract(bool exclusive_dst = true, 
                                bool exclusive_src = true) const noexcept {
-            return Measures::extract(threshold, exclusive_dst, exclusive_src);
+            return Measures::extract(threshold, exclusive_dst, exclusive_src,
+                                     static_cast<Assignment>(
+                                        static_cast<int>(assignment)));
         }
 
         /* Source object reference */
@@ -405,21 +680,106 @@ class Generic : public Parametrisable, public Measures {
         /* Matching threshold: the minimum similarity threshold to consider a
          * match */
         PARAMETER(Direct, None, Immediate, float) threshold;
+
+        /* Matching gating: the maximal distance between boxes to consider a
+         * match */
+        PARAMETER(Direct, Saturating, Immediate, int) gating;
+
+        /* Matching assignment: the solver used for extracting the matches */
+        PARAMETER(Mapped, None, Immediate, int) assignment;
     
         inline static float iou_image(containee_object_t<Src>&src, 
                                       containee_object_t<Dst>&dst) noexcept {
             return src.zone(-1).iou(dst.zone(-1));
         }
 
+        inline static Error::Type iou_images(storable_wrapper_t<Src> &srcs,
+                                             storable_wrapper_t<Dst> &dsts,
+                                             cv::Mat &results) noexcept {
+            Util::OCV::iou(boxes(srcs), boxes(dsts), results.ptr<float>());
+
+            return Error::OK;
+        }
+
+        /* Latest boxes of a list of objects */
+        template <typename L> 
+            inline static Util::OCV::Rects boxes(L &l) noexcept {
+            Util::OCV::Rects r;
+            r.reserve(l.size());
+            for (auto &o : l) {
+                r.emplace_back(static_cast<containee_object_t<L>&>(o).zone(-1));
+            }
+            return r;
+        }
+
     private:
+        /* Sort and sweep along the horizontal axis for finding the pairs of
+         * boxes that are close enough to be scored */
+        inline Error::Type gate(Src s, Dst d,
+                                Estimator::Measure<Src, Dst> &e) noexcept {
+            src = std::move(storable_wrapper_t<Src>(s));
+            dst = std::move(storable_wrapper_t<Dst>(d));
+            measurements.release();
+            candidates.clear();
+            gated        = true;
+            sources      = static_cast<int>(src.size());
+            destinations = static_cast<int>(dst.size());
+
+            const auto sb = boxes(src);
+            const auto db = boxes(dst);
+            const auto g  = static_cast<float>(static_cast<int>(gating));
+            
+            std::vector<int> so(sources), dso(destinations), active;
+            std::iota(so.begin(), so.end(), 0);
+            std::iota(dso.begin(), dso.end(), 0);
+            std::sort(so.begin(), so.end(), [&sb](int a, int b) noexcept {
+                      return sb.x0[a] < sb.x0[b]; });
+            std::sort(dso.begin(), dso.end(), [&db](int a, int b) noexcept {
+                      return db.x0[a] < db.x0[b]; });
+
+            std::size_t next = 0;
+            for (auto i : so) {
+                /* As sources are sorted, destinations ending too far on the
+                 * left of this source are too far from all next sources */
+                active.erase(std::remove_if(active.begin(), active.end(),
+                                            [&db, &sb, g, i](int j) noexcept {
+                                            return db.x1[j] + g < sb.x0[i]; }),
+                             active.end());
+                while ( (next < dso.size()) && 
+                        (db.x0[dso[next]] <= sb.x1[i] + g) ) {
+                    auto j = dso[next++];
+                    if (db.x1[j] + g >= sb.x0[i]) {
+                        active.emplace_back(j);
+                    }
+                }
+
+                for (auto j : active) {
+                    if ( (db.x0[j] <= sb.x1[i] + g) &&
+                         (db.y0[j] <= sb.y1[i] + g) &&
+                         (sb.y0[i] <= db.y1[j] + g) ) {
+                        candidates.emplace_back(i, j, 
+                            e(static_cast<containee_object_t<Src>&>(src[i]),
+                              static_cast<containee_object_t<Dst>&>(dst[j])));
+                    }
+                }
+            }
+
+            return Error::OK;
+        }
+
+        /* A measure kernel and its optional batch implementation */
+        struct Measurement {
+            Estimator::Kernel<Src, Dst> kernel;
+            Estimator::Batch<Src, Dst>  batch;
+        };
+
         /* Use reference to containers not to duplicate container structures */
         Evaluator<Src, Dst>                            estimator;
         storable_wrapper_t<Src>                        src;
         storable_wrapper_t<Dst>                        dst;
 
         /* List of all available estimators */
-        std::unordered_map<std::string,
-                           Estimator::Measure<Src,Dst>> measures;
+        std::unordered_map<std::string, Measurement>   measures;
 };
 
 }  // namespace Matcher
@@ -9,7 +9,10 @@
  *            estimator, meant to create the motion view of the scene, a Vx/Vy
  *            two channel matrix estimating the speed of each pixel.
  *            It allows the prediction of the current scene zones from the
- *            previous one.
+ *            previous one. The flow may be restricted to the previous zones,
+ *            either densely within their dilated areas or sparsely on their
+ *            corners, for its cost to scale with the area of the zones, and
+ *            the median flow of the zones may be set as their speed.
  *
  *            This file is part of the VPP framework (see link).
  *
@@ -23,9 +26,12 @@
 
 #pragma once
 
+#include <opencv2/video/tracking.hpp>
+
 #include "customisation/entity.hpp"
 #include "vpp/error.hpp"
 #include "vpp/scene.hpp"
+#include "vpp/util/ocv/mask.hpp"
 
 namespace VPP {
 namespace Task {
@@ -33,6 +39,22 @@ namespace Task {
 class Motion : public Parametrisable {
     public: 
 
+        /** Optical flow backends */
+        enum class Backend : int {
+            /** Dense Farneback flow on the CPU */
+            FARNEBACK     = 0,
+            /** Dense Farneback flow with OpenCL, when available */
+            OPENCL        = 1,
+            /** Dense inverse search flow, with its ultrafast preset */
+            DIS_ULTRAFAST = 2,
+            /** Dense inverse search flow, with its fast preset */
+            DIS_FAST      = 3,
+            /** Sparse pyramidal Lucas-Kanade flow on the previous zones */
+            SPARSE        = 4,
+            /** Dense Farneback flow within the dilated previous zones */
+            ZONES         = 5
+        };
+
         Motion(Scene &history) noexcept;
         ~Motion() noexcept = default;
         
@@ -59,8 +81,51 @@ class Motion : public Parametrisable {
          * derivatives for the polynomial expansion at each pixel */
         PARAMETER(Direct, Saturating, Immediate, double) sigma;
 
+        /* The optical flow backend */
+        PARAMETER(Mapped, None, Immediate, int)          backend;
+
+        /* The dilation in pixels of the flow image of the previous zones for
+         * the zones backend */
+        PARAMETER(Direct, Saturating, Immediate, int)    dilation;
+
+        /* Whether the median flow of every flat zone of the scene is set as
+         * its speed in pixels */
+        PARAMETER(Direct, None, Immediate, bool)         speeds;
+
     private:
+        /* Estimating the flow of the images, being an area of the frame
+         * for the dense flows */
+        void farneback(const cv::Mat &old_gray, const cv::Mat &gray,
+                       cv::Mat &flow, bool device,
+                       const cv::Rect &area) noexcept;
+        void dis(const cv::Mat &old_gray, const cv::Mat &gray,
+                 cv::Mat &flow, int preset) noexcept;
+        void sparse(const cv::Mat &old_gray, const cv::Mat &gray,
+                    cv::Mat &flow,
+                    const Util::OCV::Mask::Raster *masking) noexcept;
+        void zoned(const cv::Mat &old_gray, const cv::Mat &gray,
+                   cv::Mat &flow,
+                   const Util::OCV::Mask::Raster *masking) noexcept;
+
+        /* The areas of the previous zones in a flow image, unless masked */
+        void previous_areas(const cv::Size &size, int margin,
+                            const Util::OCV::Mask::Raster *masking,
+                            std::vector<cv::Rect> &areas) const noexcept;
+
+        /* Setting the median flow of the flat zones as their speed */
+        void measure(Scene &scene, const cv::Mat &flow) const noexcept;
+
         Scene &latest;
+
+        /* The half-size gray image of the latest scene, and its timestamp */
+        cv::Mat  previous;
+        uint64_t stamp;
+
+#if CV_VERSION_MAJOR >= 4
+        /* The dense inverse search instance, and its preset */
+        cv::Ptr<cv::DISOpticalFlow> searcher;
+        int                         searching;
+#endif
 };
 
 }  // namespace Task
@@ -30,6 +30,7 @@
 #include "vpp/task.hpp"
 #include "vpp/scene.hpp"
 #include "vpp/types.hpp"
+#include "vpp/util/ocv/mask.hpp"
 
 namespace VPP {
 namespace Task {
@@ -55,15 +56,83 @@ class MSER : public Task::Single<MSER, Scene&> {
         PARAMETER(Direct, None, Immediate, double) min_margin;
         PARAMETER(Direct, None, Immediate, int)    edge_blur_size;
 
-        std::function<bool (const cv::Mat &img, const cv::Rect &,
+        /* Multi-scale mode: candidate regions are first searched in the gray
+         * image downscaled by the input scale, and only refined within those
+         * candidates at full resolution (1 for a full resolution search) */
+        PARAMETER(Direct, Saturating, Immediate, int) input_scale;
+
+        /* Restricted mode: only search within the zones already in the scene
+         * (as tracked from the previous frame or detected) */
+        PARAMETER(Direct, None, Immediate, bool)      restricted;
+
+        /* The margin in pixels around the candidates and restricted zones */
+        PARAMETER(Direct, Saturating, Immediate, int) margin;
+
+        /* Multi-channel mode: the channels searched in parallel, each with its
+         * own detectors, the regions of the channels being merged */
+        PARAMETER(Mapped, None, Immediate, std::vector<int>) channels;
+
+        /* The overlap (IoU) above which a region of a channel is merged with
+         * a region of a former channel */
+        PARAMETER(Direct, Saturating, Immediate, float) overlap;
+
+        /* The region filter, called with the view of the channel, and from
+         * the parallel searches in multi-channel mode */
+        std::function<bool (const Image::Strided &img, const cv::Rect &,
                             const std::vector<cv::Point> &contour) 
                       noexcept> filter;
 
         Error::Type process(Scene &scene) noexcept;
 
     private:
-        /* OpenCV MSER shared smart pointer */
-        cv::Ptr<cv::MSER> core;
+        /* A searched channel, with its OpenCV MSER shared smart pointers (at
+         * full and coarse scales) and its region buffers reused from frame to
+         * frame */
+        struct Plane {
+            int                                  channel;
+            Image::Strided                       image;
+            cv::Ptr<cv::MSER>                    core;
+            cv::Ptr<cv::MSER>                    coarse;
+            std::vector<std::vector<cv::Point> > areas;
+            std::vector<cv::Rect>                bboxes;
+            std::vector<std::vector<cv::Point> > found;
+            std::vector<cv::Rect>                boxes;
+        };
+        using Planes = std::vector<Plane>;
+
+        /* Searching the planes in parallel tasks */
+        class Search : public VPP::Tasks::List<Search, Planes&, MSER&> {
+            public:
+                using Parent = VPP::Tasks::List<Search, Planes&, MSER&>;
+                using typename Parent::Mode;
+                using Parent::process;
+
+                explicit Search(const int mode) noexcept : Parent(mode) {}
+                ~Search() noexcept = default;
+
+                Error::Type process(Plane &p, MSER &m) noexcept {
+                    m.search(p);
+                    return Error::OK;
+                }
+        };
+
+        /* Search the filtered regions of a plane within the regions of
+         * interest */
+        void search(Plane &p) noexcept;
+
+        /* Keep the filtered regions found within a region of interest */
+        void detect(Plane &p, const cv::Rect &roi) noexcept;
+
+        /* Mark the regions of all the planes, but the ones overlapping the
+         * regions of a former plane */
+        void merge(Scene &scene) noexcept;
+
+        Planes                         planes;
+        Search                         searches;
+        std::vector<cv::Rect>          rois;
+
+        /* The mask of the scene being searched, if any */
+        const Util::OCV::Mask::Raster *masking;
 };
 
 }  // namespace Task
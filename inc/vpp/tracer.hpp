@@ -0,0 +1,47 @@
+/**
+ *
+ * @file      vpp/tracer.hpp
+ *
+ * @brief     This is the VPP trace recorder description file
+ *
+ * @details   This is the customisable interface of the process-wide recorder
+ *            of the spans of the pipelines, stages, tasks and bridges, for
+ *            exporting them as a timeline.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <string>
+
+#include "customisation/entity.hpp"
+#include "customisation/parameter.hpp"
+
+namespace VPP {
+
+/** Customisable process-wide trace recorder */
+class Tracer : public Parametrisable {
+    public:
+        Tracer() noexcept;
+        ~Tracer() noexcept = default;
+
+        /* Recording the spans (and forgetting the previous ones) */
+        PARAMETER(Direct, None, Callable, bool)        recording;
+
+        /* Exporting the recorded spans into this Chrome trace file */
+        PARAMETER(Direct, None, Callable, std::string) output;
+
+    private:
+        Customisation::Error onRecordingUpdate(const bool &yes) noexcept;
+        Customisation::Error onOutputUpdate(const std::string &path) noexcept;
+};
+
+}  // namespace VPP
@@ -17,23 +17,33 @@
 
 #pragma once
 
+#include <algorithm>
 #include <functional>
 #include <list>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "customisation.hpp"
 #include "vpp/log.hpp"
 #include "vpp/scene.hpp"
+#include "vpp/util/slab.hpp"
 #include "vpp/scene.hpp"
 
 namespace VPP {
 namespace Tracker {
 
+    /* The history of a context is a bounded stack of zones whose slots are
+     * allocated once and reused across frames: the bottom entry is the
+     * tracked zone and the entries atop are the later estimations */
     class Context {
         public:
+            /* Room for the original, a prediction and a measurement */
+            static const unsigned int minimum = 3;
+
             inline Context(Zone &o, Zone::Copier &c, unsigned int sz = 0) 
-                noexcept : uuid(o.uuid), original(&o), copier(c), zones() {
-                zones.reserve(sz);
+                noexcept : uuid(o.uuid), original(&o), copier(c), seen(0),
+                           zones(std::max(sz, minimum) + 1), count(0) {
                 stack(o);
             }
             inline ~Context() = default;
@@ -44,7 +54,7 @@ namespace Tracker {
             inline Context& operator=(Context&& other) = delete;
 
             inline bool valid() const noexcept {
-                return (zones.size() > 0) && (zones.front().valid());
+                return (count > 0) && (zones.front().valid());
             }
 
             inline bool invalid() const noexcept {
@@ -52,16 +62,42 @@ namespace Tracker {
             }
 
             inline bool updated() const noexcept {
-                return zones.size() > 1;
+                return count > 1;
+            }
+
+            /* The confidence in the context, in [0, 1], for the trackers
+             * that estimate it to hide */
+            inline float accuracy() const noexcept {
+                return 1.0f;
             }
 
             inline int computed() const noexcept {
-                return zones.size() - 1;
+                return count - 1;
+            }
+
+            inline unsigned int stacked() const noexcept {
+                return count;
             }
 
+            /* Stack a copy of the zone made with the context copier */
             inline Zone &stack(const Zone &zone) noexcept {
-                zones.push_back(std::move(zone.copy(copier)));
-                return zones.back();
+                zone.copy(zones[count], copier);
+                return push();
+            }
+
+            /* Stack a geometry-only copy of the zone (bounding box, UUID and
+             * state), as required for the prediction steps */
+            inline Zone &shadow(const Zone &zone) noexcept {
+                zone.copy(zones[count]);
+                return push();
+            }
+
+            /* Drop the entry atop, keeping its slot for a later use */
+            inline void unstack() noexcept {
+                ASSERT(updated(),
+                       "Tracker::Context::unstack(): Cannot unstack the "
+                       "tracked zone!");
+                --count;
             }
            
             inline void invalidate() noexcept {
@@ -72,15 +108,9 @@ namespace Tracker {
             }
 
             inline void flatten() noexcept {
-                if (updated()) {
-                    /* Update from top to bottom, keeping all information */
-                    Zone latest = std::move(zones.back());
-                    zones.pop_back();
-                    latest.update(zones.back());
-                    zones.back() = std::move(latest);
-
-                    /* Loop again (in case) */
-                    flatten();
+                /* Update from top to bottom, keeping all information */
+                while (updated()) {
+                    fold();
                 }
             }
 
@@ -103,12 +133,12 @@ namespace Tracker {
             }
 
             inline unsigned int offset_of(int offset) const noexcept {
-                ASSERT(offset >= -static_cast<int>(zones.size()) && 
-                       offset < static_cast<int>(zones.size()),
+                ASSERT(offset >= -static_cast<int>(count) && 
+                       offset < static_cast<int>(count),
                        "Tracker::Context::zone(): invalid offset %d provided "
-                       "for a zones vector of size %d", offset,
-                       static_cast<int>(zones.size()));
-                return (offset < 0) ? zones.size() + offset : offset;
+                       "for a zones history of size %d", offset,
+                       static_cast<int>(count));
+                return (offset < 0) ? count + offset : offset;
             }
 
             inline Zone &zone(int offset) noexcept {
@@ -123,8 +153,33 @@ namespace Tracker {
             Zone *            original;
             Zone::Copier&     copier;
 
-        protected:
+            /* The timestamp of the latest scene the context was seen in */
+            uint64_t          seen;
+
+        private:
+            /* Commit the zone copied in the spare slot. When this was the last
+             * spare slot, the previous top is folded onto the entry below so
+             * that the history never grows */
+            inline Zone &push() noexcept {
+                if (count + 1 == zones.size()) {
+                    fold();
+                    std::swap(zones[count], zones[count + 1]);
+                }
+                return zones[count++];
+            }
+
+            /* Update the entry below with the entry atop and drop the latter.
+             * Swapping keeps both slot buffers alive */
+            inline void fold() noexcept {
+                auto &latest = zones[count - 1];
+                auto &older  = zones[count - 2];
+                latest.update(older);
+                std::swap(older, latest);
+                --count;
+            }
+
             std::vector<Zone> zones;
+            unsigned int      count;
     };
     
     using Contexts = std::vector<std::reference_wrapper<Context>>;
@@ -136,10 +191,20 @@ namespace Tracker {
             using ContextFilter = std::function<bool (const C&) noexcept>;
             using Contexts = std::vector<std::reference_wrapper<C>>;
 
+            /* The contexts evicted first when there are too many of them */
+            enum class Eviction : int {
+                /* The ones unseen for the longest time */
+                OLDEST   = 0,
+                /* The ones with the lowest accuracy */
+                WEAKEST  = 1,
+                /* The ones with the smallest zones */
+                SMALLEST = 2
+            };
+
             /* Default constructor and destructor */
             inline Engine(Zone::Copier c, unsigned int sz = 0) noexcept
                 : Customisation::Entity("Tracker"), zone_copier(std::move(c)),
-                  stack_size(sz) {
+                  stack_size(sz), storage(), ranked(), classes() {
                 recall.denominate("recall")
                       .describe("The factor to apply to all predictions scores "
                                 "of all historic contexts")
@@ -147,8 +212,38 @@ namespace Tracker {
                 recall.range(0.0f, 1.0f);
                 Customisation::Entity::expose(recall);
 
+                capacity.denominate("capacity")
+                        .describe("The maximal number of contexts, or 0 for "
+                                  "an unlimited number")
+                        .characterise(Customisation::Trait::SETTABLE);
+                capacity.range(0, 1000000);
+                Customisation::Entity::expose(capacity);
+
+                quota.denominate("quota")
+                     .describe("The maximal number of contexts of a given "
+                               "class, or 0 for an unlimited number")
+                     .characterise(Customisation::Trait::SETTABLE);
+                quota.range(0, 1000000);
+                Customisation::Entity::expose(quota);
+
+                eviction.denominate("eviction")
+                        .describe("The contexts evicted first when there are "
+                                  "too many of them: either oldest for the "
+                                  "ones unseen for the longest time, weakest "
+                                  "for the least accurate ones or smallest "
+                                  "for the ones with the smallest zones")
+                        .characterise(Customisation::Trait::SETTABLE);
+                eviction.define(
+                    { { "oldest",   static_cast<int>(Eviction::OLDEST) },
+                      { "weakest",  static_cast<int>(Eviction::WEAKEST) },
+                      { "smallest", static_cast<int>(Eviction::SMALLEST) } });
+                Customisation::Entity::expose(eviction);
+
                 /* Use the global zone recall by default */
-                recall = Zone::recall;
+                recall   = Zone::recall;
+                capacity = 0;
+                quota    = 0;
+                eviction = static_cast<int>(Eviction::OLDEST);
             }
             inline ~Engine() = default;
 
@@ -267,6 +362,9 @@ namespace Tracker {
                 if (removed != nullptr) {
                     removed->clear();
                 }
+
+                /* Evict the contexts in excess, along with their zones */
+                evict(scene); 
                 
                 for (auto it = storage.begin(); it != storage.end(); ) {
                     if (it->invalid()) {
@@ -279,6 +377,7 @@ namespace Tracker {
                         /* If there is already a zone attached to this one,
                          * then update the original zone! */
                         if (it->original != nullptr) {
+                            it->seen = scene.ts_ms();
                             if (it->updated()) {
                                 it->flatten();
                                 auto z = it->zone().copy(zone_copier);
@@ -316,10 +415,89 @@ namespace Tracker {
              * the historic zones */
             PARAMETER(Direct, Saturating, Immediate, float) recall;
 
+            /* Lifecycle limits: the maximal numbers of contexts, overall and
+             * per class, and which contexts are evicted first */
+            PARAMETER(Direct, Saturating, Immediate, int)   capacity;
+            PARAMETER(Direct, Saturating, Immediate, int)   quota;
+            PARAMETER(Mapped, None, Immediate, int)         eviction;
+
         protected:
-            Zone::Copier       zone_copier;
-            const unsigned int stack_size;
-            std::list<C>       storage;
+            /* Is the context a to be evicted before the context b ? */
+            static inline bool before(Eviction order, uint64_t now,
+                                      const C &a, const C &b) noexcept {
+                /* The contexts seen in this scene are not updated yet */
+                auto sa = (a.original != nullptr) ? now : a.seen;
+                auto sb = (b.original != nullptr) ? now : b.seen;
+                switch (order) {
+                    case Eviction::WEAKEST:
+                        if (a.accuracy() != b.accuracy()) {
+                            return a.accuracy() < b.accuracy();
+                        }
+                        break;
+                    case Eviction::SMALLEST:
+                        if (a.zone().area() != b.zone().area()) {
+                            return a.zone().area() < b.zone().area();
+                        }
+                        break;
+                    case Eviction::OLDEST:
+                    default:
+                        break;
+                }
+                return sa < sb;
+            }
+
+            /* Invalidate the contexts (and their zones) above the limits,
+             * keeping the best ones for the eviction order */
+            inline void evict(Scene &scene) noexcept {
+                const int most  = capacity;
+                const int share = quota;
+                if ( ( (most <= 0) || 
+                       (static_cast<int>(storage.size()) <= most) ) &&
+                     (share <= 0) ) {
+                    return;
+                }
+
+                ranked.clear();
+                for (auto &c : storage) {
+                    if (c.valid()) {
+                        ranked.emplace_back(&c);
+                    }
+                }
+
+                auto order = static_cast<Eviction>(static_cast<int>(eviction));
+                auto now   = scene.ts_ms();
+                std::stable_sort(ranked.begin(), ranked.end(),
+                                 [order, now](const C *a, const C *b) noexcept {
+                                     return before(order, now, *b, *a); });
+
+                classes.clear();
+                int kept = 0;
+                for (auto c : ranked) {
+                    const auto &p = c->zone().context;
+                    auto &n = classes[(static_cast<int>(p.dataset) << 16) | 
+                                      (static_cast<int>(p.id) & 0xFFFF)];
+                    if ( ( (most > 0) && (kept >= most) ) ||
+                         ( (share > 0) && (n >= share) ) ) {
+                        if (c->original != nullptr) {
+                            c->original->invalidate();
+                        }
+                        c->invalidate();
+                    } else {
+                        ++kept;
+                        ++n;
+                    }
+                }
+            }
+
+            Zone::Copier                      zone_copier;
+            const unsigned int                stack_size;
+
+            /* The contexts come from a slab not to fragment the heap */
+            std::list<C, Util::SlabAllocator<C>> storage;
+
+        private:
+            std::vector<C *>                  ranked;
+            std::unordered_map<int, int>      classes;
     };
 
 }  // namespace Tracker
@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <opencv2/imgproc.hpp>
 #include <utility>
 
@@ -46,6 +47,18 @@ struct Parameters {
         std::vector<float>          storage;
 
         Mask                        mask;
+
+        /* Shared back projection: the per-channel contributions to the flat
+         * histogram bin index and the bin index image of the current frame */
+        bool                        shared;
+        std::vector<int>            lut;
+        cv::Mat                     quantised;
+
+        /* The mask of the current frame (if any), and the capture time and
+         * image of the frame, for quantising each frame only once */
+        cv::Mat                     masked;
+        uint64_t                    clocked;
+        const uchar *               source;
         
         bool operator == (const Parameters &other) const noexcept;
 };
@@ -56,7 +69,8 @@ class Context : public VPP::Tracker::Context {
                          unsigned int sz, Parameters &params) noexcept;
         ~Context() noexcept = default;
 
-        /* Initialising the histogram (recalculating it) */ 
+        /* Initialising the histogram (recalculating it), by counting the
+         * bins of the shared bin index image whenever available */
         void initialise(View &view) noexcept;
 
         /* Comparing with another histogram */
@@ -80,6 +94,20 @@ class Context : public VPP::Tracker::Context {
 
 using Contexts = std::vector<std::reference_wrapper<Context>>;
 
+/* The batch similarities of all the source and destination signatures, with
+ * the Bhattacharyya (HISTCMP_BHATTACHARYYA), correlation (HISTCMP_CORREL) or
+ * alternative chi-square (HISTCMP_CHISQR_ALT) method. The signatures are
+ * packed once into normalised matrices, the first two being a single product
+ * of these matrices. The results are a source-rows by destination-columns
+ * float matrix of scores from 1 for identical signatures down to 0 (or -1 for
+ * the correlation), and an empty signature always scores 0 */
+void similarities(const Contexts &srcs, const Contexts &dsts,
+                  enum cv::HistCompMethods method, cv::Mat &results) noexcept;
+
+/* The similarity of a single pair, as scored by the batch implementation */
+float similarity(const Context &src, const Context &dst,
+                 enum cv::HistCompMethods method) noexcept;
+
 class Engine : public VPP::Tracker::Engine<Engine, Context> {
     public:
         class Ranges : public Parametrisable {
@@ -112,8 +140,17 @@ class Engine : public VPP::Tracker::Engine<Engine, Context> {
         Ranges                                                         ranges;
         PARAMETER(Direct, Saturating, Immediate, std::vector<int32_t>) bins;
 
+        /* Compute the bin index image once per frame and share it for all the
+         * context back projections */
+        PARAMETER(Direct, None, Immediate, bool)                       shared;
+
         void prepare(Zones &zs) noexcept;
 
+        /* Quantise the view into the shared bin index image (if enabled) and
+         * compute its mask (if any), once for all the contexts initialised or
+         * back projected in this view */
+        void quantise(View &view) noexcept;
+
         Image::Mode mode() const noexcept {
             return config.mode;
         }
@@ -20,7 +20,9 @@
 
 #pragma once
 
+#include <cstddef>
 #include <opencv2/video/tracking.hpp>
+#include <vector>
 
 #include "customisation.hpp"
 #include "vpp/tracker.hpp"
@@ -30,25 +32,113 @@ namespace VPP {
 namespace Tracker {
 namespace Kalman {
 
+/* Fixed-size kernels for the batched Kalman backend */
+using StateVector   = Zone::State::Vector;
+using StateMatrix   = cv::Matx<float, Zone::State::length,
+                                      Zone::State::length>;
+using MeasureVector = Zone::Measure::Vector;
+using MeasureMatrix = cv::Matx<float, Zone::Measure::length,
+                                      Zone::Measure::length>;
+using Observation   = cv::Matx<float, Zone::Measure::length,
+                                      Zone::State::length>;
+
+/* The states and error covariances of the batched filters of all the contexts
+ * of an engine, laid out as a structure of arrays: an aligned row of floats,
+ * or lane, per state element and per error covariance element, each context
+ * owning a slot, i.e. a column, so that the filters of all the contexts are
+ * predicted and corrected at once in a single loop over their slots */
+class Filters {
+    public:
+        static constexpr int states = Zone::State::length;
+        static constexpr int lanes  = states + states * states;
+
+        Filters() noexcept;
+        ~Filters() noexcept = default;
+
+        /* Filters cannot be copied, as the contexts hold their slots */
+        Filters(const Filters &other) = delete;
+        Filters(Filters &&other) = delete;
+        Filters &operator=(const Filters &other) = delete;
+        Filters &operator=(Filters &&other) = delete;
+
+        /* Acquiring a slot for a new context, and releasing it */
+        unsigned int acquire() noexcept;
+        void release(unsigned int slot) noexcept;
+
+        /* Setting and getting the state and error covariance of a slot */
+        void assign(unsigned int slot, const StateVector &x,
+                    const StateMatrix &p) noexcept;
+        void fetch(unsigned int slot, StateVector &x,
+                   StateMatrix &p) const noexcept;
+        StateVector state(unsigned int slot) const noexcept;
+
+        /* Predicting the n slots as x = F.x and P = F.P.Ft + Q */
+        void predict(const unsigned int *slots, std::size_t n,
+                     const StateMatrix &F, const StateMatrix &Q) noexcept;
+
+        /* Correcting the n slots with their measures z, the gain being
+         * K = P.Ht.S^-1 with the innovation covariance S = H.P.Ht + R */
+        void correct(const unsigned int *slots, const MeasureVector *z,
+                     std::size_t n, const Observation &H,
+                     const MeasureMatrix &R) noexcept;
+
+    private:
+        inline float *lane(int l) noexcept {
+            return storage.ptr<float>(l);
+        }
+
+        inline const float *lane(int l) const noexcept {
+            return storage.ptr<float>(l);
+        }
+
+        /* The lanes, whose rows are aligned for any capacity multiple of the
+         * block size, and the slots released for the next contexts */
+        cv::Mat                   storage;
+        unsigned int              used;
+        std::vector<unsigned int> spares;
+};
+
 class Parameters : public cv::KalmanFilter {
     public:
         Parameters() noexcept 
             : cv::KalmanFilter(Zone::State::length, Zone::Measure::length, 0, 
-                               CV_32F), timeout(10.0) {};
+                               CV_32F), timeout(10.0), batched(true), 
+              transition(), observation(), process(), noise(), error() {};
         Parameters(const Parameters &other) noexcept = default;        
         Parameters(Parameters &&other) noexcept = default;
         Parameters &operator=(const Parameters &other) = delete;
         Parameters &operator=(Parameters &&other) = delete;
         ~Parameters() noexcept = default;
 
+        /* Refresh the fixed-size copies of the model matrices */
+        void freeze() noexcept;
+
         float timeout;
+        bool  batched;
+
+        /* Fixed-size copies of F, H, Q, R and of the initial error covariance
+         * used by the batched backend */
+        StateMatrix   transition;
+        Observation   observation;
+        StateMatrix   process;
+        MeasureMatrix noise;
+        StateMatrix   error;
 };
 
+class Engine;
+
 class Context : public VPP::Tracker::Context, cv::KalmanFilter {
     public:
         explicit Context(Zone &zone, Zone::Copier &copier,
-                         unsigned int sz, Parameters &params) noexcept;
-        ~Context() noexcept = default;
+                         unsigned int sz, Parameters &params,
+                         Filters &filters) noexcept;
+        ~Context() noexcept;
+
+        /* Contexts cannot be copied nor moved, as they own their slot */
+        Context(const Context &other) = delete;
+        Context(Context &&other) = delete;
+        Context &operator=(const Context &other) = delete;
+        Context &operator=(Context &&other) = delete;
 
         /* Initialising the Karman filter (resetting the filters) */ 
         void initialise() noexcept;
@@ -64,19 +154,52 @@ class Context : public VPP::Tracker::Context, cv::KalmanFilter {
          * stacked */
         void correct(unsigned int threshold = 2) noexcept;
 
+        /* The a posteriori state and error covariance of the filter */
+        void posterior(StateVector &state, 
+                       StateMatrix &covariance) const noexcept;
+
+        /* The predicted measure H.x and the innovation covariance
+         * S = H.P.Ht + R of the filter */
+        void innovation(MeasureVector &measure,
+                        MeasureMatrix &covariance) const noexcept;
+
     protected:
-        float       validity;
-        Parameters &config;
+        friend class Engine;
+
+        /* Is the context predicted, and stacking the prediction atop once
+         * its slot is predicted by the batched backend */
+        bool predictable() const noexcept;
+        void predicted(const VPP::View &view, float dt) noexcept;
+
+        float        validity;
+        Parameters & config;
+
+        /* The slot holding the state and error covariance of the context in
+         * the filters of the batched backend */
+        Filters &    bank;
+        unsigned int slot;
 };
 
 using Contexts = std::vector<std::reference_wrapper<Context>>;
 
+/* The squared Mahalanobis distances between the latest zones of the source
+ * contexts and the predicted measures of the destination contexts, with the
+ * innovation covariances of the latter. The destinations are whitened once,
+ * their Cholesky factors being laid out as structures of arrays for scoring
+ * all the destinations of a source at once. The results are a source-rows by
+ * destination-columns float matrix */
+void mahalanobis(const Contexts &srcs, const Contexts &dsts,
+                 cv::Mat &results) noexcept;
+
+/* The squared Mahalanobis distance of a single pair, as the batch one */
+float mahalanobis(const Context &src, const Context &dst) noexcept;
+
 class Engine : public VPP::Tracker::Engine<Engine, Context> {
     public:
         using Parent = VPP::Tracker::Engine<Engine, Context>;
 
         explicit Engine(const Zone::Copier &c, unsigned int sz = 2) noexcept;
-        ~Engine() noexcept = default;
+        ~Engine() noexcept;
 
         Customisation::Error setup() noexcept override;
 
@@ -90,6 +213,10 @@ class Engine : public VPP::Tracker::Engine<Engine, Context> {
          * matrix */
         PARAMETER(Direct, None, Immediate, float)              tscale;
 
+        /* Batched backend: use the fixed-size kernels instead of the generic
+         * OpenCV Kalman filter */
+        PARAMETER(Direct, None, Immediate, bool)               batched;
+
         /* Transition state matrix F (8x8) */
         PARAMETER(Direct, None, Immediate, std::vector<float>) F0;
         PARAMETER(Direct, None, Immediate, std::vector<float>) F1;
@@ -125,11 +252,31 @@ class Engine : public VPP::Tracker::Engine<Engine, Context> {
         PARAMETER(Direct, None, Immediate, std::vector<float>) R4;
         
         void prepare(Zones &zs) noexcept;
+
+        /* Predicting, respectively correcting, the contexts all at once, in a
+         * single loop over their slots for the batched backend */
+        void predict(const VPP::View &view, float dt,
+                     Contexts &cs) noexcept;
+        void correct(Contexts &cs, unsigned int threshold = 2) noexcept;
+
+        /* The frozen model shared by all the contexts */
+        inline const Parameters &parameters() const noexcept {
+            return model;
+        }
                                    
     protected:
         Customisation::Error onPredictabilityUpdate(const float &t) noexcept;
 
         Parameters           model;
+
+        /* The filters of all the contexts, which outlive them */
+        Filters              filters;
+
+    private:
+        /* The slots and measures gathered for the batched backend */
+        std::vector<unsigned int>   slots;
+        std::vector<MeasureVector>  measures;
+        Contexts                    selected;
 };
 
 }  // namespace Kalman
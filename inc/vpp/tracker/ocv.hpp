@@ -32,10 +32,18 @@ namespace OCV {
         
 using Factory = std::function<cv::Ptr<cv::Tracker>() noexcept>;
 
+/* The images the trackers run on: a level of the view pyramid, either in
+ * colour or in gray, the boxes being scaled to and from the level */
+struct Sampling {
+    int  level;
+    bool gray;
+};
+
 class Context : public VPP::Tracker::Context {
     public:
         explicit Context(Zone &zone, Zone::Copier &copier,
-                         unsigned int sz, Factory *factory) noexcept;
+                         unsigned int sz, Factory *factory,
+                         const Sampling &sampling) noexcept;
         ~Context() noexcept = default;
 
         /* Initialising the tracker */ 
@@ -45,7 +53,11 @@ class Context : public VPP::Tracker::Context {
         void predict(VPP::View &view) noexcept;
 
     protected:
+        /* The image to track on, and its scale with respect to the frame */
+        const cv::Mat &input(VPP::View &view, double &scale) const noexcept;
+
         cv::Ptr<cv::Tracker> tracker;
+        const Sampling       sampling;
 };
 
 using Contexts = std::vector<std::reference_wrapper<Context>>;
@@ -64,6 +76,11 @@ class Engine : public VPP::Tracker::Engine<Engine, Context> {
         /* The tracker model to use */
         PARAMETER(Direct, WhiteListed, Callable, std::string) tracker;
 
+        /* The pyramid level and the colour of the images the new trackers
+         * run on, as trackers seldom need the full resolution colour frames */
+        PARAMETER(Direct, Saturating, Immediate, int)         level;
+        PARAMETER(Direct, None, Immediate, bool)              gray;
+
         void prepare(Zones &zs) noexcept;
 
     protected:
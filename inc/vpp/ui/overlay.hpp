@@ -16,6 +16,10 @@
 
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
 #include "vpp/log.hpp"
 #include "vpp/util/ocv/overlay.hpp"
 #include "vpp/scene.hpp"
@@ -32,6 +36,7 @@ class Overlay : public Util::OCV::Overlay {
         using TextStyle    = Util::OCV::Overlay::TextStyle;
         using Font         = Util::OCV::Overlay::Font;
         using Layer        = Util::OCV::Overlay::Layer;
+        using Batch        = Util::OCV::Overlay::Batch;
 
         using Util::OCV::Overlay::draw;
 
@@ -51,6 +56,28 @@ class Overlay : public Util::OCV::Overlay {
         using ZoneStylist = 
             std::function<ZoneStyle (const VPP::Zone &,
                                      const ZoneStyle &) noexcept>;
+
+        /* The styles of the zones of a frame, memoised by class and by
+         * quantised score for the stylists only depending on the class of
+         * the zones: the stylist is called once per class of the frame, and
+         * the colour is adapted once per score bucket */
+        class Styles final {
+            public:
+                static constexpr int buckets = 32;
+
+                Styles(const ZoneStylist &s, const ZoneStyle &b) noexcept
+                    : stylist(s), base(b), classes(), adapted() {}
+                ~Styles() noexcept = default;
+
+                /* The adapted style of a zone */
+                const ZoneStyle &of(const VPP::Zone &zone) noexcept;
+
+            private:
+                const ZoneStylist &                     stylist;
+                const ZoneStyle &                       base;
+                std::unordered_map<int32_t, ZoneStyle>  classes;
+                std::unordered_map<int64_t, ZoneStyle>  adapted;
+        };
  
         Overlay() noexcept;
         ~Overlay() noexcept;
@@ -90,10 +117,40 @@ class Overlay : public Util::OCV::Overlay {
                   const ZoneStyle &style, const ZoneStylist &stylist)
             const noexcept;
 
+        /* Scene drawing with memoised styles */
+        void draw(cv::Mat &frame, const VPP::Scene &scn,
+                  Styles &styles) const noexcept;
+
+        /* Collecting the boxes and descriptions of all the zones of a scene
+         * in a batch, for drawing them later on */
+        void collect(Batch &batch, const VPP::Scene &scn,
+                     const ZoneStylist &stylist) const;
+        void collect(Batch &batch, const VPP::Scene &scn,
+                     Styles &styles) const;
+
+        /* Conservative area drawn for a zone, including its description */
+        cv::Rect area(const VPP::Zone &zone, const ZoneStylist &stylist)
+            const noexcept;
+        cv::Rect area(const VPP::Zone &zone, Styles &styles) const noexcept;
+
         /* Default style */
         ZoneStyle defaultZoneStyle;
 
     private:
+        /* Adding the box and the description of a zone to a batch, with its
+         * colour adapted to its score (if requested) or already adapted */
+        static void collect(Batch &batch, const VPP::Zone &zone,
+                            ZoneStyle style);
+        static void add(Batch &batch, const VPP::Zone &zone,
+                        const ZoneStyle &style);
+
+        /* Adapting the colour of a style to a score (if requested) */
+        static ZoneStyle adapt(ZoneStyle style, float score) noexcept;
+
+        /* Conservative area drawn for a zone in a style */
+        static cv::Rect drawn(const VPP::Zone &zone,
+                              const ZoneStyle &style) noexcept;
+
         static ZoneStyle defaultZoneStylist(const VPP::Zone &zone, 
                                             const ZoneStyle &baseStyle)
             noexcept;
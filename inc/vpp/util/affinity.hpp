@@ -0,0 +1,49 @@
+/**
+ *
+ * @file      vpp/util/affinity.hpp
+ *
+ * @brief     This is the VPP thread affinity description file
+ *
+ * @details   Threads can be pinned on a list of cores, given by their indices
+ *            and ranges (e.g. "0-3,6"), or as the "big" or "little" cores of
+ *            the highest or lowest capacity on heterogeneous processors. The
+ *            NUMA node of the calling thread is also provided, for keeping the
+ *            buffers close to the threads using them on multi-socket hosts.
+ *            Pinning is only supported on Linux, and a no-op elsewhere.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Util {
+namespace Affinity {
+
+using Cores = std::vector<int>;
+
+/* Parsing a list of cores, the unknown cores being ignored */
+Cores parse(const std::string &cores) noexcept;
+
+/* Pinning the calling thread or another one on some cores, an empty list
+ * standing for all the cores, and returning false if it cannot be pinned */
+bool pin(const Cores &cores) noexcept;
+bool pin(std::thread &thread, const Cores &cores) noexcept;
+
+/* The number of NUMA nodes of the host, and the one of the core running the
+ * calling thread */
+int nodes() noexcept;
+int node() noexcept;
+
+}  // namespace Affinity
+}  // namespace Util
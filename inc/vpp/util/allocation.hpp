@@ -0,0 +1,53 @@
+/**
+ *
+ * @file      vpp/util/allocation.hpp
+ *
+ * @brief     This is the VPP heap allocation accounting description file
+ *
+ * @details   When the VPP is built with the VPP_ALLOCATION_TRACKING option,
+ *            the global allocation operators are replaced by ones counting the
+ *            heap allocations and their bytes, per thread and for the whole
+ *            process, for checking that the steady state of the pipelines is
+ *            free of any allocation. Otherwise the counters are always null,
+ *            and the allocations are left untouched.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <cstdint>
+
+namespace Util {
+namespace Allocation {
+
+struct Counters {
+    uint64_t allocations; /* Heap allocations */
+    uint64_t bytes;       /* Bytes requested by these allocations */
+};
+
+/* Are the allocations counted, i.e. is the allocation hook built in ? */
+bool tracked() noexcept;
+
+/* The allocations of the calling thread since it started */
+Counters thread() noexcept;
+
+/* The allocations of all the threads since the process started */
+Counters process() noexcept;
+
+/* The allocations of the calling thread since a former snapshot of its own */
+inline Counters since(const Counters &before) noexcept {
+    auto now = thread();
+    return Counters{ now.allocations - before.allocations,
+                     now.bytes - before.bytes };
+}
+
+}  // namespace Allocation
+}  // namespace Util
@@ -21,6 +21,7 @@
 #include <camera/NdkCameraMetadata.h>
 #include <media/NdkImageReader.h>
 #include <opencv2/opencv.hpp>
+#include <cstdint>
 #include <future>
 #include <queue>
 #include <string>
@@ -99,6 +100,8 @@ public:
     {
         std::promise<int> *promise;
         cv::Mat *image;
+        VPP::Image::Mode *mode;
+        int64_t *timestamp;
     };
 
     AndroidCamera() noexcept;
@@ -128,6 +131,7 @@ public:
     int setup(Mode mode, int screenOrientation) noexcept;
 
     virtual int read(cv::Mat &image, VPP::Image::Mode &mode) noexcept override;
+    virtual int attach(VPP::View &view) noexcept override;
 
     const Sensor &sensor() const noexcept;
     const Mode &mode() const noexcept;
@@ -158,6 +162,9 @@ private:
     ACaptureSessionOutput *imageOutput;
     ACameraCaptureSession *captureSession;
     ACameraCaptureSession_stateCallbacks captureStateCallbacks;
+
+    // The capture time of the last image read, in us of the steady clock
+    uint64_t imageClock;
 };
 
 } // namespace IO
@@ -0,0 +1,88 @@
+/**
+ *
+ * @file      vpp/util/io/android_exchange.hpp
+ *
+ * @brief     These are the Android zero-copy frame and result exchanges
+ *
+ * @details   The frames provided by the Java side, either in direct byte
+ *            buffers or in hardware buffers, are wrapped into images without
+ *            any copy. The wrapped images hold a reference on their buffers,
+ *            which are only released once the last image header on them is.
+ *            The results of the scenes are serialised in a direct byte buffer
+ *            allocated once by the Java side, so that no Java object is
+ *            created per frame.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <jni.h>
+#include <opencv2/core.hpp>
+
+#if __ANDROID_API__ >= 26
+#include <android/hardware_buffer.h>
+#endif
+
+#include "vpp/image.hpp"
+#include "vpp/scene.hpp"
+
+namespace Util {
+namespace IO {
+namespace Android {
+
+/* Wrapping a frame stored in a direct byte buffer into an image, as rows of
+ * stride bytes (0 for packed rows). For the native modes, the height is the
+ * one of the luma plane, the chroma planes following it in the buffer. The
+ * image is empty if the buffer is not a direct one or is too small */
+cv::Mat wrap(JNIEnv *env, jobject buffer, int width, int height, int stride,
+             const VPP::Image::Mode &mode) noexcept;
+
+#if __ANDROID_API__ >= 29
+/* Wrapping a YUV 4:2:0 hardware buffer into an NV12 or NV21 image, locked for
+ * CPU reads as long as the image is used. The image is empty if the chroma
+ * plane is not interleaved and right after the luma plane, as the buffer
+ * cannot be wrapped into a single native image then */
+cv::Mat wrap(AHardwareBuffer *buffer, VPP::Image::Mode &mode) noexcept;
+#endif
+
+/* The scene results, serialised in a preallocated direct byte buffer in the
+ * native byte order as:
+ *   - the timestamp of the scene in ms (int64) and the zone count (int32);
+ *   - for every zone, its uuid (int64), its bounding box as x, y, width and
+ *     height (4 x int32), its context score (float32) and global identifier
+ *     (int32). */
+class Results final {
+    public:
+        static constexpr std::size_t header = 12;
+        static constexpr std::size_t record = 32;
+
+        Results() noexcept;
+        ~Results() noexcept = default;
+
+        /* Using the direct byte buffer of the Java side for all the next
+         * serialisations, returning its capacity in zones or -1 if it is not
+         * a direct buffer */
+        int attach(JNIEnv *env, jobject buffer) noexcept;
+
+        /* Serialising a scene, returning the number of zones written, the
+         * zones in excess of the buffer capacity being dropped */
+        int write(const VPP::Scene &scene) noexcept;
+
+    private:
+        uint8_t     *data;
+        std::size_t  capacity;
+};
+
+}  // namespace Android
+}  // namespace IO
+}  // namespace Util
@@ -0,0 +1,93 @@
+/**
+ *
+ * @file      vpp/util/io/gstreamer.hpp
+ *
+ * @brief     This is the GStreamer pipeline Input class definition
+ *
+ * @details   This input pulls the frames of a GStreamer pipeline, given by its
+ *            launch string, from an appsink named "vpp", which is appended to
+ *            the pipeline if not already part of it. The pipeline can then do
+ *            the jitter buffering, the (hardware) decoding and the scaling of
+ *            the frames with any element of the platform. The appsink caps are
+ *            negotiated as NV12, NV21 or BGR frames of the capture mode, and
+ *            the frames are wrapped in place into images holding their sample,
+ *            which is only released with the last image using it.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include "vpp/config.hpp"
+#ifndef VPP_HAS_GSTREAMER_CAPTURE_SUPPORT
+# error ERROR: VPP does not support the GStreamer capture pipelines!
+#endif
+
+#include <cstdint>
+#include <gst/gst.h>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "vpp/util/io/input.hpp"
+
+namespace Util {
+namespace IO {
+
+class GStreamer : public Input {
+    public:
+        GStreamer() noexcept;
+        virtual ~GStreamer() noexcept;
+
+        GStreamer(const GStreamer& other) = delete;
+        GStreamer(GStreamer&& other) = delete;
+        GStreamer& operator=(const GStreamer& other) = delete;
+        GStreamer& operator=(GStreamer&& other) = delete;
+
+        /* The native size of the frames, then the sizes scaled to by the
+         * pipeline */
+        virtual std::vector<std::string> modes() noexcept override;
+
+        virtual int open(const std::string &protocol, int id) noexcept override;
+        virtual int open(const std::string &protocol,
+                         const std::string &source) noexcept override;
+
+        virtual int setup(const std::string &username,
+                          const std::string &password) noexcept override;
+        /* A null width or height is the native size of the frames */
+        virtual int setup(int &width, int &height, int &rotation)
+            noexcept override;
+
+        virtual int read(cv::Mat &image, VPP::Image::Mode &m) noexcept override;
+        virtual int attach(VPP::View &view) noexcept override;
+
+        virtual int close() noexcept override;
+
+    private:
+        /* Starting the pipeline with some caps, and getting its first sample
+         * for the negotiated size */
+        bool start(const std::string &caps, int &width, int &height) noexcept;
+        void stop() noexcept;
+
+        /* Logging the pending errors of the pipeline, if any */
+        bool failed() noexcept;
+
+        /* The steady clock timestamp in us of a sample, 0 if unknown */
+        uint64_t stamp(GstSample *sample) noexcept;
+
+        std::string launch;
+        GstElement *pipeline;
+        GstElement *sink;
+        GstSample  *pending;
+        uint64_t    stamped;
+};
+
+} // namespace IO
+} // namespace Util
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <future>
 #include <opencv2/core/core.hpp>
 #include <string>
 #include <vector>
@@ -53,8 +54,18 @@ class Image : public Input {
         virtual int close() noexcept override;
 
     private:
+        /* Fetch the next snapshot in the background while the current one is
+         * decoded and processed */
+        void prefetch() noexcept;
+        void settle() noexcept;
+
         Customisation::Socket      socket;
         std::vector<unsigned char> data;
+        std::vector<unsigned char> next;
+        std::future<int>           pending;
+
+        /* The reduced decoding mode of the snapshots larger than requested */
+        int                        decoding;
 };
 
 } // namespace IO
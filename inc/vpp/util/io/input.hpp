@@ -23,6 +23,7 @@
 
 #include "vpp/projection.hpp"
 #include "vpp/image.hpp"
+#include "vpp/view.hpp"
 
 namespace Util {
 namespace IO {
@@ -41,6 +42,10 @@ class Input {
         bool supports(const std::string &protocol) const noexcept;
         virtual std::vector<std::string> sources() const noexcept;
         virtual std::vector<std::string> modes() noexcept;
+
+        /* The identity of the opened device and of its driver or firmware
+         * versions, for caching its probed modes (empty if unknown) */
+        virtual std::string identity() const noexcept;
  
         virtual int open(const std::string &protocol, int id) noexcept;
 
@@ -51,9 +56,18 @@ class Input {
                           const std::string &password) noexcept;
         
         virtual int setup(int &width, int &height, int &rotation) noexcept;
+
+        /* Preferring a decoding backend and a (hardware) acceleration for
+         * the next opening, inputs without such choices ignore them */
+        virtual int prefer(const std::string &backend,
+                           const std::string &acceleration) noexcept;
         
         virtual int read(cv::Mat &image, VPP::Image::Mode &m) noexcept;
 
+        /* Attaching anything else known about the image read (e.g. its
+         * timestamp or other recorded images) to the view using it */
+        virtual int attach(VPP::View &view) noexcept;
+
         virtual int close() noexcept;
 
         virtual VPP::Projecter *projecter() const noexcept;
@@ -0,0 +1,64 @@
+/**
+ *
+ * @file      vpp/util/io/mapped.hpp
+ *
+ * @brief     This is the read-only memory-mapped file definition
+ *
+ * @details   A mapped file is viewed in place from the page cache instead of
+ *            being read into a buffer of its own, so that large files such as
+ *            the network weights are loaded lazily, and shared by all the
+ *            processes mapping them.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace Util {
+namespace IO {
+
+class Mapped {
+    public:
+        Mapped() noexcept;
+        ~Mapped() noexcept;
+
+        Mapped(const Mapped& other) = delete;
+        Mapped(Mapped&& other) = delete;
+        Mapped& operator=(const Mapped& other) = delete;
+        Mapped& operator=(Mapped&& other) = delete;
+
+        /* Mapping a whole file, replacing any former one. Empty files are
+         * opened but not mapped */
+        int open(const std::string &path) noexcept;
+        int close() noexcept;
+
+        inline bool opened() const noexcept {
+            return opening;
+        }
+
+        inline const char *data() const noexcept {
+            return map;
+        }
+
+        inline std::size_t size() const noexcept {
+            return length;
+        }
+
+    private:
+        const char *map;
+        std::size_t length;
+        bool        opening;
+};
+
+}  // namespace IO
+}  // namespace Util
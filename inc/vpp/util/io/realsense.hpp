@@ -4,6 +4,13 @@
  *
  * @brief     This is the Intel Realsense Input class definition
  *
+ * @details   The sources are the indices or the serial numbers of the devices,
+ *            optionally followed by their inter-camera hardware sync mode, as
+ *            in "0@master" and "1@slave" for the synchronised devices of a
+ *            multi-camera capture. Every device has its own pipeline and
+ *            processing thread, and the synchronised ones have their frames
+ *            stamped by the host clock for matching their timestamps.
+ *
  *            This file is part of the VPP framework (see link).
  *
  * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
@@ -44,6 +51,8 @@ public:
 
     virtual std::vector<std::string> modes() noexcept override;
 
+    virtual std::string identity() const noexcept override;
+
     virtual int open(const std::string &protocol, int id) noexcept override;
 
     virtual int open(const std::string &protocol,
@@ -55,6 +64,7 @@ public:
     virtual int setup(int &width, int &height, int &rotation) noexcept override;
 
     virtual int read(cv::Mat &image, VPP::Image::Mode &m) noexcept override;
+    virtual int attach(VPP::View &view) noexcept override;
 
     virtual int close() noexcept override;
 
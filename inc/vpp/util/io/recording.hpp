@@ -0,0 +1,124 @@
+/**
+ *
+ * @file      vpp/util/io/recording.hpp
+ *
+ * @brief     These are the view recorder and replay Input class definitions
+ *
+ * @details   A recording is an append-only file of raw frames, each frame
+ *            holding the timestamp and the original images of a view (colour,
+ *            depth and motion). Recordings are replayed without any copy by
+ *            memory-mapping them.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+
+#include "vpp/projection.hpp"
+#include "vpp/util/io/input.hpp"
+#include "vpp/view.hpp"
+
+namespace Util {
+namespace IO {
+
+class Recorder {
+    public:
+        Recorder() noexcept;
+        ~Recorder() noexcept;
+
+        Recorder(const Recorder& other) = delete;
+        Recorder(Recorder&& other) = delete;
+        Recorder& operator=(const Recorder& other) = delete;
+        Recorder& operator=(Recorder&& other) = delete;
+
+        /* Recordings are always appended to */
+        int open(const std::string &path) noexcept;
+        int write(VPP::View &view) noexcept;
+        int close() noexcept;
+
+        inline bool opened() const noexcept {
+            return file.is_open();
+        }
+
+    private:
+        std::ofstream file;
+};
+
+class Replay : public Input {
+    public:
+        Replay() noexcept;
+        virtual ~Replay() noexcept;
+
+        Replay(const Replay& other) = delete;
+        Replay(Replay&& other) = delete;
+        Replay& operator=(const Replay& other) = delete;
+        Replay& operator=(Replay&& other) = delete;
+
+        virtual std::vector<std::string> modes() noexcept override;
+
+        virtual int open(const std::string &protocol, int id) noexcept override;
+        virtual int open(const std::string &protocol,
+                         const std::string &source) noexcept override;
+
+        virtual int setup(const std::string &username,
+                          const std::string &password) noexcept override;
+        virtual int setup(int &width, int &height, int &rotation) 
+            noexcept override;
+
+        /* The images read out of a recording remain views on the recording
+         * for as long as it is open */
+        virtual int read(cv::Mat &image, VPP::Image::Mode &m) noexcept override;
+        virtual int attach(VPP::View &view) noexcept override;
+
+        virtual int close() noexcept override;
+
+        virtual VPP::Projecter *projecter() const noexcept override;
+
+    private:
+        /* A flat projecter for replaying recorded depth maps */
+        class Flat : public VPP::Projecter {
+            public:
+                cv::Point project(const cv::Point3f &p) const 
+                    noexcept override;
+                cv::Point3f deproject(const cv::Point &p,
+                                      float z) const noexcept override;
+        };
+
+        struct Extra {
+            cv::Mat          data;
+            VPP::Image::Mode mode;
+            float            zscale;
+        };
+
+        /* Index the frames of the memory-mapped recording */
+        void scan() noexcept;
+
+        int                                   fd;
+        unsigned char *                       map;
+        std::size_t                           length;
+        std::vector<std::size_t>              index;
+        std::size_t                           next;
+        bool                                  realtime;
+        std::chrono::steady_clock::time_point start;
+        uint64_t                              first;
+        uint64_t                              ts;
+        std::vector<Extra>                    extras;
+        Flat                                  flat;
+};
+
+} // namespace IO
+} // namespace Util
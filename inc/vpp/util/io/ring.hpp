@@ -0,0 +1,135 @@
+/**
+ *
+ * @file      vpp/util/io/ring.hpp
+ *
+ * @brief     These are the shared-memory frame ring and tap definitions
+ *
+ * @details   A ring is a memory-mapped file, usually in /dev/shm, made of a
+ *            control block and a fixed number of fixed-size slots, each slot
+ *            holding a frame along with an opaque metadata message (e.g. in
+ *            the VPP wire format). A single writer publishes the frames in
+ *            sequence, the slots being recycled in turn, and wakes the waiting
+ *            readers up through a futex in the control block. The readers tap
+ *            the ring from other processes and view the frames in place, the
+ *            sequence number of a slot telling whether it has been recycled
+ *            in the meantime.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <opencv2/core/core.hpp>
+#include <string>
+
+namespace Util {
+namespace IO {
+
+class Ring {
+    public:
+        /* The control block heading the ring */
+        struct Control {
+            uint32_t              magic;
+            uint32_t              slots;
+            uint64_t              size;
+            std::atomic<uint64_t> latest;
+            std::atomic<uint32_t> futex;
+            uint32_t              reserved;
+        };
+
+        /* The header of a slot, followed by its frame and metadata. Its
+         * sequence is 0 while being written */
+        struct Slot {
+            std::atomic<uint64_t> sequence;
+            uint64_t              ts;
+            int32_t               type;
+            int32_t               rows;
+            int32_t               cols;
+            uint32_t              reserved;
+            uint64_t              frame;
+            uint64_t              metadata;
+        };
+
+        Ring() noexcept;
+        ~Ring() noexcept;
+
+        Ring(const Ring& other) = delete;
+        Ring(Ring&& other) = delete;
+        Ring& operator=(const Ring& other) = delete;
+        Ring& operator=(Ring&& other) = delete;
+
+        /* Creating a ring of slots of a given size (in bytes), replacing any
+         * former one at the same path */
+        int open(const std::string &path, int slots,
+                 std::size_t size) noexcept;
+        int close() noexcept;
+
+        inline bool opened() const noexcept {
+            return control != nullptr;
+        }
+
+        /* Publishing a frame with its metadata, the frame data being written
+         * once in the next slot. Frames not fitting in a slot are rejected */
+        int write(uint64_t ts, const cv::Mat &frame, const void *metadata,
+                  std::size_t size) noexcept;
+
+    private:
+        std::string    file;
+        unsigned char *map;
+        std::size_t    length;
+        Control *      control;
+};
+
+class Tap {
+    public:
+        /* A frame viewed in place in its slot, along with its metadata */
+        struct Frame {
+            uint64_t       sequence;
+            uint64_t       ts;
+            cv::Mat        image;
+            const uint8_t *metadata;
+            std::size_t    length;
+        };
+
+        Tap() noexcept;
+        ~Tap() noexcept;
+
+        Tap(const Tap& other) = delete;
+        Tap(Tap&& other) = delete;
+        Tap& operator=(const Tap& other) = delete;
+        Tap& operator=(Tap&& other) = delete;
+
+        int open(const std::string &path) noexcept;
+        int close() noexcept;
+
+        /* Waiting for a frame newer than a sequence, for up to a timeout (in
+         * milliseconds), and returning the latest sequence */
+        uint64_t wait(uint64_t sequence, int timeout_ms) const noexcept;
+
+        /* Viewing the latest frame, if any yet, returning false otherwise */
+        bool read(Frame &frame) const noexcept;
+
+        /* Whether the slot of a frame has not been recycled since it has been
+         * read, and hence whether the frame viewed was intact */
+        bool intact(const Frame &frame) const noexcept;
+
+    private:
+        const Ring::Slot *slot(uint64_t sequence) const noexcept;
+
+        unsigned char *    map;
+        std::size_t        length;
+        Ring::Control *    control;
+};
+
+} // namespace IO
+} // namespace Util
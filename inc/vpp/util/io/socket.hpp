@@ -0,0 +1,51 @@
+/**
+ *
+ * @file      vpp/util/io/socket.hpp
+ *
+ * @brief     These are the VPP TCP socket helpers
+ *
+ * @details   These helpers send and receive whole buffers over the blocking
+ *            TCP sockets of the remote inferences and of the network links,
+ *            connect to a host:port server within a timeout, and listen on a
+ *            port.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace Util {
+namespace IO {
+namespace Socket {
+
+/* Sending some data, false if the connection failed */
+bool put(int fd, const void *data, std::size_t size) noexcept;
+
+/* Receiving some data, every chunk being waited for up to ms milliseconds */
+bool get(int fd, void *data, std::size_t size, int ms) noexcept;
+
+/* Connecting to a host:port server within ms milliseconds, without any
+ * send ever blocking for longer, or -1 if not connected */
+int dial(const std::string &server, int ms) noexcept;
+
+/* Listening on a TCP port of all the interfaces, or -1 if not listening */
+int listening(int port, int backlog) noexcept;
+
+/* Reading the request line of an HTTP client within ms milliseconds, as its
+ * method and its path without any query (e.g. "GET /metrics"), or an empty
+ * string if the client sent nothing */
+std::string requested(int fd, int ms) noexcept;
+
+}  // namespace Socket
+}  // namespace IO
+}  // namespace Util
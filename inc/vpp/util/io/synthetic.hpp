@@ -0,0 +1,116 @@
+/**
+ *
+ * @file      vpp/util/io/synthetic.hpp
+ *
+ * @brief     This is the synthetic input class definition
+ *
+ * @details   A synthetic input generates frames of some textured boxes moving
+ *            over a textured background, either as fast as they are read or
+ *            at their frame rate, and with the timestamps of their frame rate,
+ *            so that the pipelines can be run, compared and soaked without any
+ *            camera nor recording. The source is either the number of frames
+ *            to generate before the end of the input (0 for an endless input)
+ *            or a comma separated list of options among frames=<count>,
+ *            boxes=<count>, fps=<rate>, seed=<seed> (0 for a random one),
+ *            text=yes for labelling the boxes, noise=<sigma> for some
+ *            Gaussian noise and paced=yes for reading at the frame rate.
+ *
+ *            The depth protocol generates the matching depth maps of a floor
+ *            plane with the boxes standing on it, the inputs opened with the
+ *            same source generating the same scenes.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "vpp/projection.hpp"
+#include "vpp/util/io/input.hpp"
+
+namespace Util {
+namespace IO {
+
+class Synthetic : public Input {
+    public:
+        Synthetic() noexcept;
+        virtual ~Synthetic() noexcept;
+
+        Synthetic(const Synthetic& other) = delete;
+        Synthetic(Synthetic&& other) = delete;
+        Synthetic& operator=(const Synthetic& other) = delete;
+        Synthetic& operator=(Synthetic&& other) = delete;
+
+        virtual int open(const std::string &protocol, int id) noexcept override;
+        virtual int open(const std::string &protocol,
+                         const std::string &source) noexcept override;
+
+        virtual int setup(const std::string &username,
+                          const std::string &password) noexcept override;
+        virtual int setup(int &width, int &height, int &rotation)
+            noexcept override;
+
+        virtual int read(cv::Mat &image, VPP::Image::Mode &m) noexcept override;
+        virtual int attach(VPP::View &view) noexcept override;
+
+        virtual int close() noexcept override;
+
+        virtual VPP::Projecter *projecter() const noexcept override;
+
+    private:
+        struct Box {
+            cv::Rect2f   area;
+            cv::Point2f  speed;
+            cv::Mat      texture;
+            float        depth;
+        };
+
+        /* A pinhole lens with a field of view of about 53 degrees */
+        class Lens final : public VPP::Projecter {
+            public:
+                Lens() noexcept;
+                void focus(int width, int height) noexcept;
+
+                cv::Point project(const cv::Point3f &p) const noexcept
+                    override;
+                cv::Point3f deproject(const cv::Point &p,
+                                      float z) const noexcept override;
+
+            private:
+                VPP::Pinhole model;
+        };
+
+        /* Moving the boxes to the next frame, bouncing on the frame edges */
+        void move() noexcept;
+
+        uint64_t         frames;
+        uint64_t         next;
+        int              moving;
+        uint64_t         seed;
+        double           period;
+        bool             text;
+        double           noise;
+        bool             paced;
+        bool             depth;
+        cv::Mat          background;
+        cv::Mat          noised;
+        std::vector<Box> boxes;
+        Lens             lens;
+
+        std::chrono::steady_clock::time_point started;
+};
+
+} // namespace IO
+} // namespace Util
@@ -0,0 +1,81 @@
+/**
+ *
+ * @file      vpp/util/io/v4l2.hpp
+ *
+ * @brief     This is the V4L2 camera Input class definition
+ *
+ * @details   This input streams the USB and CSI cameras of Linux through the
+ *            memory-mapped buffer queues of their V4L2 drivers. The NV12 and
+ *            NV21 frames are wrapped in place into native images holding their
+ *            buffer, which is only queued back to the driver once the last
+ *            image using it is released with its scene. The YUYV frames are
+ *            converted and the MJPEG frames decoded straight from the mapped
+ *            buffers. The frames also keep the timestamps of the driver.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "vpp/util/io/input.hpp"
+
+namespace Util {
+namespace IO {
+
+class V4L2 : public Input {
+    public:
+        V4L2() noexcept;
+        virtual ~V4L2() noexcept;
+
+        V4L2(const V4L2& other) = delete;
+        V4L2(V4L2&& other) = delete;
+        V4L2& operator=(const V4L2& other) = delete;
+        V4L2& operator=(V4L2&& other) = delete;
+
+        virtual std::vector<std::string> sources() const noexcept override;
+        virtual std::vector<std::string> modes() noexcept override;
+        virtual std::string identity() const noexcept override;
+
+        virtual int open(const std::string &protocol, int id) noexcept override;
+        virtual int open(const std::string &protocol,
+                         const std::string &source) noexcept override;
+
+        virtual int setup(const std::string &username,
+                          const std::string &password) noexcept override;
+        virtual int setup(int &width, int &height, int &rotation)
+            noexcept override;
+
+        virtual int read(cv::Mat &image, VPP::Image::Mode &m) noexcept override;
+        virtual int attach(VPP::View &view) noexcept override;
+
+        virtual int close() noexcept override;
+
+        /* The opened device and its mapped buffers, shared with the images
+         * wrapping these buffers for as long as any of them is used */
+        class Device;
+
+    private:
+        std::string             path;
+        std::shared_ptr<Device> device;
+        uint32_t                format;
+        int                     width;
+        int                     height;
+        std::size_t             stride;
+        uint64_t                stamped;
+};
+
+} // namespace IO
+} // namespace Util
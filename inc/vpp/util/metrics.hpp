@@ -0,0 +1,253 @@
+/**
+ *
+ * @file      vpp/util/metrics.hpp
+ *
+ * @brief     This is a collection of lock-free metrics for instrumenting the
+ *            processing of scenes
+ *
+ * @details   Latencies are recorded in nanoseconds into histograms of 4 linear
+ *            sub-buckets per power of two (as HDR histograms do), so that any
+ *            percentile is known within 25% whatever its magnitude. Recording
+ *            is a few relaxed atomic operations, and the histograms may be read
+ *            at any time, yet without any consistency between their buckets.
+ *            The instrumented objects attach collectors to the process-wide
+ *            registry, which only read their lock-free metrics when they are
+ *            exported in the Prometheus text format.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Util {
+
+class Histogram final {
+    public:
+        /* The number of linear sub-buckets per power of two, as a power of 2 */
+        static constexpr int SUBBITS  = 2;
+        static constexpr int BUCKETS  = 64 << SUBBITS;
+
+        Histogram() noexcept : buckets(), total(0), sum(0), peak(0) {
+            reset();
+        }
+
+        /* Histograms cannot be copied nor moved */
+        Histogram(const Histogram& other) = delete;
+        Histogram(Histogram&& other) = delete;
+        Histogram& operator=(const Histogram& other) = delete;
+        Histogram& operator=(Histogram&& other) = delete;
+        ~Histogram() noexcept = default;
+
+        /* The steady clock in nanoseconds */
+        static inline uint64_t now() noexcept {
+            return static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch())
+                    .count());
+        }
+
+        inline void reset() noexcept {
+            for (auto &b : buckets) {
+                b.store(0, std::memory_order_relaxed);
+            }
+            total.store(0, std::memory_order_relaxed);
+            sum.store(0, std::memory_order_relaxed);
+            peak.store(0, std::memory_order_relaxed);
+        }
+
+        inline void record(uint64_t ns) noexcept {
+            buckets[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+            total.fetch_add(1, std::memory_order_relaxed);
+            sum.fetch_add(ns, std::memory_order_relaxed);
+
+            auto p = peak.load(std::memory_order_relaxed);
+            while ( (ns > p) && 
+                    (!peak.compare_exchange_weak(p, ns, 
+                                                 std::memory_order_relaxed)) ) {
+            }
+        }
+
+        inline uint64_t count() const noexcept {
+            return total.load(std::memory_order_relaxed);
+        }
+
+        inline uint64_t mean() const noexcept {
+            auto n = count();
+            return (n == 0) ? 0 : sum.load(std::memory_order_relaxed) / n;
+        }
+
+        inline uint64_t max() const noexcept {
+            return peak.load(std::memory_order_relaxed);
+        }
+
+        /* The upper bound of the bucket holding the q-quantile, q being
+         * within [0, 1] */
+        inline uint64_t percentile(double q) const noexcept {
+            auto n = count();
+            if (n == 0) {
+                return 0;
+            }
+
+            auto rank  = static_cast<uint64_t>(q * static_cast<double>(n));
+            uint64_t seen = 0;
+            for (int i = 0; i < BUCKETS; ++i) {
+                seen += buckets[i].load(std::memory_order_relaxed);
+                if (seen > rank) {
+                    auto upper = ceiling(i);
+                    return (upper < max()) ? upper : max();
+                }
+            }
+            return max();
+        }
+
+        /* A short human readable summary, in microseconds */
+        inline std::string summary() const {
+            char text[128];
+            snprintf(text, sizeof(text), 
+                     "mean %.1fus p50 %.1fus p90 %.1fus p99 %.1fus "
+                     "max %.1fus", mean() / 1e3, percentile(0.5) / 1e3,
+                     percentile(0.9) / 1e3, percentile(0.99) / 1e3,
+                     max() / 1e3);
+            return std::string(text);
+        }
+
+    private:
+        static inline int bucket(uint64_t v) noexcept {
+            if (v < (1u << SUBBITS)) {
+                return static_cast<int>(v);
+            }
+            int msb = 63 - __builtin_clzll(v);
+            int sub = static_cast<int>((v >> (msb - SUBBITS)) & 
+                                       ((1u << SUBBITS) - 1));
+            return ((msb - SUBBITS + 1) << SUBBITS) + sub;
+        }
+
+        static inline uint64_t ceiling(int i) noexcept {
+            if (i < (1 << SUBBITS)) {
+                return static_cast<uint64_t>(i);
+            }
+            int msb = (i >> SUBBITS) + SUBBITS - 1;
+            int sub = i & ((1 << SUBBITS) - 1);
+            if (msb >= 63) {
+                return UINT64_MAX;
+            }
+            return ((static_cast<uint64_t>((1 << SUBBITS) + sub + 1)) << 
+                    (msb - SUBBITS)) - 1;
+        }
+
+        std::atomic<uint64_t> buckets[BUCKETS];
+        std::atomic<uint64_t> total;
+        std::atomic<uint64_t> sum;
+        std::atomic<uint64_t> peak;
+};
+
+/* Recording the lifetime of a scope into a histogram */
+class Timing final {
+    public:
+        inline explicit Timing(Histogram &h) noexcept 
+            : histogram(h), start(Histogram::now()) {}
+        inline ~Timing() noexcept {
+            histogram.record(Histogram::now() - start);
+        }
+
+        /* Timings cannot be copied nor moved */
+        Timing(const Timing& other) = delete;
+        Timing(Timing&& other) = delete;
+        Timing& operator=(const Timing& other) = delete;
+        Timing& operator=(Timing&& other) = delete;
+
+    private:
+        Histogram &histogram;
+        uint64_t   start;
+};
+
+namespace Metrics {
+
+/* The samples of all the metric families, as gathered by the collectors */
+class Exposition final {
+    public:
+        Exposition() noexcept : families() {}
+
+        /* Labels are formatted as in 'name="value",other="value"' */
+        void counter(const std::string &family, const std::string &help,
+                     const std::string &labels, uint64_t value);
+        void gauge(const std::string &family, const std::string &help,
+                   const std::string &labels, double value);
+
+        /* Exporting a latency histogram as a summary in seconds */
+        void summary(const std::string &family, const std::string &help,
+                     const std::string &labels, const Histogram &h);
+
+        /* The Prometheus text format of all the samples */
+        std::string text() const;
+
+        /* Quoting a label value */
+        static std::string quote(const std::string &value);
+
+    private:
+        struct Family {
+            std::string              type;
+            std::string              help;
+            std::vector<std::string> samples;
+        };
+
+        Family &family(const std::string &name, const char *type,
+                       const std::string &help);
+
+        std::map<std::string, Family> families;
+};
+
+class Registry final {
+    public:
+        using Collector = std::function<void (Exposition &e)>;
+        using Handle    = uint64_t;
+
+        static Registry &instance() noexcept;
+
+        /* Registries cannot be copied nor moved */
+        Registry(const Registry& other) = delete;
+        Registry(Registry&& other) = delete;
+        Registry& operator=(const Registry& other) = delete;
+        Registry& operator=(Registry&& other) = delete;
+        ~Registry() noexcept = default;
+
+        /* Collectors shall be detached before their objects are destroyed,
+         * detaching waiting for any collection in progress */
+        Handle attach(Collector c);
+        void detach(Handle h) noexcept;
+
+        /* An identifier to tell apart objects sharing a same name */
+        uint64_t identify() noexcept;
+
+        std::string collect();
+
+    private:
+        Registry() noexcept;
+
+        std::mutex                               access;
+        std::vector<std::pair<Handle, Collector>> collectors;
+        Handle                                   handles;
+        std::atomic<uint64_t>                    identifiers;
+};
+
+}  // namespace Metrics
+
+}  // namespace Util
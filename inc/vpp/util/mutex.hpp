@@ -0,0 +1,111 @@
+/**
+ *
+ * @file      vpp/util/mutex.hpp
+ *
+ * @brief     This is the VPP named mutex description file
+ *
+ * @details   The mutexes of the hot path of the framework are named, so that
+ *            their contention can be profiled when the VPP is built with the
+ *            VPP_LOCK_PROFILING option: their acquisitions, the contended ones,
+ *            the time waited for them and the time they are held are recorded
+ *            per name, all the mutexes of a name being accounted together, and
+ *            exported with the metrics. Otherwise a named mutex is a mere
+ *            standard mutex, its name being ignored.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "vpp/config.hpp"
+#include "vpp/util/metrics.hpp"
+
+namespace Util {
+
+class Mutex final {
+    public:
+        /* The contention of all the mutexes of a name */
+        struct Contention {
+            Contention() noexcept;
+
+            std::atomic<uint64_t> acquisitions;
+            std::atomic<uint64_t> contended;
+            Histogram             waiting;
+            Histogram             holding;
+        };
+
+#ifdef VPP_HAS_LOCK_PROFILING
+        /* The name shall be a literal */
+        explicit Mutex(const char *name) noexcept;
+#else
+        explicit inline Mutex(const char * /*name*/) noexcept : native() {}
+#endif
+        ~Mutex() noexcept = default;
+
+        /* Mutexes cannot be copied nor moved */
+        Mutex(const Mutex& other) = delete;
+        Mutex(Mutex&& other) = delete;
+        Mutex& operator=(const Mutex& other) = delete;
+        Mutex& operator=(Mutex&& other) = delete;
+
+#ifdef VPP_HAS_LOCK_PROFILING
+        inline void lock() noexcept {
+            if (!native.try_lock()) {
+                auto waited = Histogram::now();
+                native.lock();
+                acquired = Histogram::now();
+                contention->contended.fetch_add(1, std::memory_order_relaxed);
+                contention->waiting.record(acquired - waited);
+            } else {
+                acquired = Histogram::now();
+            }
+            contention->acquisitions.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        inline bool try_lock() noexcept {
+            if (!native.try_lock()) {
+                return false;
+            }
+            acquired = Histogram::now();
+            contention->acquisitions.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        inline void unlock() noexcept {
+            contention->holding.record(Histogram::now() - acquired);
+            native.unlock();
+        }
+#else
+        inline void lock() noexcept {
+            native.lock();
+        }
+
+        inline bool try_lock() noexcept {
+            return native.try_lock();
+        }
+
+        inline void unlock() noexcept {
+            native.unlock();
+        }
+#endif
+
+    private:
+        std::mutex   native;
+#ifdef VPP_HAS_LOCK_PROFILING
+        Contention  *contention;
+        uint64_t     acquired;
+#endif
+};
+
+}  // namespace Util
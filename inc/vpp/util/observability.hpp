@@ -13,6 +13,14 @@
  *            The observer callback function shall not block nor shall it keep
  *            a reference of the notification object. It shall instead extract
  *            the required information and exit ASAP.
+ *            Observers that have to block (e.g. for displaying or for sending
+ *            over a network) shall rather connect asynchronously: a payload is
+ *            then extracted from the notification in the notifier context,
+ *            and queued for being delivered in a dispatcher thread of their
+ *            own.
+ *            The list of observers is replaced on every connection change
+ *            (copy on write), so that signalling never waits for a connection
+ *            or a disconnection to complete.
  *
  *            This file is part of the VPP framework (see link).
  *
@@ -26,40 +34,246 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <functional>
-#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace Util {
  
 template <typename ...O> class Notifier {
     public:
         using Callback = std::function<void(const O&... o, int error) noexcept>;
-        using Handle = typename std::list<Callback>::iterator;
+        using Handle   = uint64_t;
 
+        /** What to do with a payload queued to a full asynchronous observer */
+        enum class Overflow : int {
+            /** Drop the oldest payload of the queue */
+            DROP_OLDEST = 0,
+            /** Drop the payload being queued */
+            DROP_NEWEST = 1,
+            /** Block the notifier until the observer dequeues a payload */
+            BLOCK       = 2
+        };
+
+        template <typename P> using Extractor = 
+            std::function<P(const O&... o, int error) noexcept>;
+        template <typename P> using Delivery = 
+            std::function<void(P &payload) noexcept>;
+
+        Notifier() noexcept : connection(), listeners(), handles(0) {}
+
+        /* Notifiers cannot be copied nor moved */
+        Notifier(const Notifier& other) = delete;
+        Notifier(Notifier&& other) = delete;
+        Notifier& operator=(const Notifier& other) = delete;
+        Notifier& operator=(Notifier&& other) = delete;
+
+        ~Notifier() noexcept {
+            std::lock_guard<std::mutex> lock(connection);
+            auto current = std::atomic_load(&listeners);
+            if (current) {
+                for (auto &l : *current) {
+                    l->stop();
+                }
+            }
+            std::atomic_store(&listeners, List());
+        }
+
+        /* Connecting an observer called in the notifier context */
         inline Handle connect(Callback c) {
-            notifications.emplace_back(std::move(c));
-            auto it = notifications.end();
-            return (--it);
+            return attach(std::make_shared<Inline>(++handles, std::move(c)));
         };
 
+        /* Connecting an asynchronous observer with an extractor of payloads
+         * called in the notifier context, and a delivery of the payloads
+         * called in a dispatcher thread, with at most depth payloads being
+         * queued in between. The payload type shall be given explicitly, and
+         * a delivery shall never disconnect its own observer */
+        template <typename P> 
+            inline Handle connect(Extractor<P> extract, Delivery<P> deliver,
+                                  std::size_t depth = 8,
+                                  Overflow overflow = Overflow::DROP_OLDEST) {
+            auto l = std::make_shared<Queued<P>>(++handles, std::move(extract),
+                                                 std::move(deliver), depth,
+                                                 overflow);
+            l->start();
+            return attach(std::move(l));
+        }
+
         inline void disconnect(Handle c) {
-            for (auto it = notifications.begin(); 
-                      it != notifications.end(); ++it) {
-                if (it == c) {
-                    notifications.erase(it);
+            std::shared_ptr<Listener> removed;
+            {
+                std::lock_guard<std::mutex> lock(connection);
+                auto current = std::atomic_load(&listeners);
+                if (!current) {
                     return;
                 }
+
+                auto updated = std::make_shared<Listeners>();
+                updated->reserve(current->size());
+                for (auto &l : *current) {
+                    if (l->handle == c) {
+                        removed = l;
+                    } else {
+                        updated->push_back(l);
+                    }
+                }
+                std::atomic_store(&listeners, List(std::move(updated)));
+            }
+
+            /* Signals in progress may still queue into a stopped observer */
+            if (removed) {
+                removed->stop();
             }
         }
 
         inline void signal(const O&... o, int error) {
-            for (auto &c : notifications) {
-                c(o..., error);
+            auto current = std::atomic_load(&listeners);
+            if (!current) {
+                return;
+            }
+
+            for (auto &l : *current) {
+                l->notify(o..., error);
             }
         }
 
     private:
-        std::list<Callback> notifications;
+        struct Listener {
+            explicit Listener(Handle h) noexcept : handle(h) {}
+            virtual ~Listener() noexcept = default;
+
+            virtual void notify(const O&... o, int error) noexcept = 0;
+            virtual void stop() noexcept {}
+
+            const Handle handle;
+        };
+
+        struct Inline final : public Listener {
+            Inline(Handle h, Callback c) noexcept 
+                : Listener(h), callback(std::move(c)) {}
+
+            void notify(const O&... o, int error) noexcept override {
+                callback(o..., error);
+            }
+
+            Callback callback;
+        };
+
+        template <typename P> struct Queued final : public Listener {
+            Queued(Handle h, Extractor<P> e, Delivery<P> d, std::size_t n,
+                   Overflow o) noexcept 
+                : Listener(h), extract(std::move(e)), deliver(std::move(d)),
+                  depth(n > 0 ? n : 1), overflow(o), access(), available(),
+                  released(), payloads(), running(false), dispatcher() {}
+
+            ~Queued() noexcept {
+                stop();
+            }
+
+            void start() noexcept {
+                running    = true;
+                dispatcher = std::thread([this]() { dispatch(); });
+            }
+
+            void stop() noexcept override {
+                {
+                    std::lock_guard<std::mutex> lock(access);
+                    running = false;
+                }
+                available.notify_all();
+                released.notify_all();
+
+                if (dispatcher.joinable()) {
+                    dispatcher.join();
+                }
+            }
+
+            void notify(const O&... o, int error) noexcept override {
+                P payload = extract(o..., error);
+
+                std::unique_lock<std::mutex> lock(access);
+                if (payloads.size() >= depth) {
+                    switch (overflow) {
+                        case Overflow::DROP_NEWEST:
+                            return;
+                        case Overflow::BLOCK:
+                            released.wait(lock, [this]() {
+                                return (!running) || 
+                                       (payloads.size() < depth); });
+                            break;
+                        default:
+                            payloads.pop_front();
+                            break;
+                    }
+                }
+
+                if (!running) {
+                    return;
+                }
+
+                payloads.emplace_back(std::move(payload));
+                lock.unlock();
+                available.notify_one();
+            }
+
+            void dispatch() noexcept {
+                std::unique_lock<std::mutex> lock(access);
+                while (running) {
+                    available.wait(lock, [this]() { 
+                        return (!running) || (!payloads.empty()); });
+                    if (!running) {
+                        break;
+                    }
+
+                    P payload = std::move(payloads.front());
+                    payloads.pop_front();
+                    lock.unlock();
+                    released.notify_one();
+                    deliver(payload);
+                    lock.lock();
+                }
+                payloads.clear();
+            }
+
+            Extractor<P>            extract;
+            Delivery<P>             deliver;
+            const std::size_t       depth;
+            const Overflow          overflow;
+            std::mutex              access;
+            std::condition_variable available;
+            std::condition_variable released;
+            std::deque<P>           payloads;
+            bool                    running;
+            std::thread             dispatcher;
+        };
+
+        using Listeners = std::vector<std::shared_ptr<Listener>>;
+        using List      = std::shared_ptr<const Listeners>;
+
+        inline Handle attach(std::shared_ptr<Listener> l) {
+            std::lock_guard<std::mutex> lock(connection);
+            auto current = std::atomic_load(&listeners);
+            auto updated = current ? std::make_shared<Listeners>(*current)
+                                   : std::make_shared<Listeners>();
+            auto h       = l->handle;
+            updated->push_back(std::move(l));
+            std::atomic_store(&listeners, List(std::move(updated)));
+
+            return h;
+        }
+
+        /* The connection changes are serialised, but never the signals */
+        std::mutex            connection;
+        List                  listeners;
+        std::atomic<uint64_t> handles;
 };
 
 }  // namespace Util
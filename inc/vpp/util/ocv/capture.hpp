@@ -40,6 +40,8 @@ class Capture : public Util::IO::Input {
         Capture& operator=(const Capture& other) = delete;
         Capture& operator=(Capture&& other) = delete;
 
+        virtual std::string identity() const noexcept override;
+
         virtual int open(const std::string &protocol, int id) noexcept override;
         int open(int id) noexcept;
 
@@ -52,12 +54,17 @@ class Capture : public Util::IO::Input {
         virtual int setup(int &width, int &height, int &rotation) 
             noexcept override;
 
+        virtual int prefer(const std::string &backend,
+                           const std::string &acceleration) noexcept override;
+
         virtual int read(cv::Mat &image, VPP::Image::Mode &m) noexcept override;
 
         virtual int close() noexcept override;
 
     private:
         cv::VideoCapture cap;
+        int              api;
+        int              acceleration;
 };
 
 } // namespace OCV
@@ -19,7 +19,10 @@
 
 #pragma once
 
+#include <cstddef>
+#include <opencv2/core/mat.hpp>
 #include <opencv2/core/types.hpp>
+#include <vector>
 
 namespace Util {
 namespace OCV {
@@ -44,5 +47,59 @@ template <typename P>
  */
 template <typename R> typename R::value_type affinity(const R &a, const R &b);
 
+/* This is a structure of arrays of rectangles, for batch processing them */
+class Rects {
+    public:
+        Rects() noexcept = default;
+        ~Rects() noexcept = default;
+
+        inline void reserve(std::size_t n) noexcept {
+            x0.reserve(n);
+            y0.reserve(n);
+            x1.reserve(n);
+            y1.reserve(n);
+        }
+
+        inline void emplace_back(const cv::Rect &r) noexcept {
+            x0.emplace_back(static_cast<float>(r.x));
+            y0.emplace_back(static_cast<float>(r.y));
+            x1.emplace_back(static_cast<float>(r.x + r.width));
+            y1.emplace_back(static_cast<float>(r.y + r.height));
+        }
+
+        inline std::size_t size() const noexcept {
+            return x0.size();
+        }
+
+        /* Top-left and bottom-right corners coordinates */
+        std::vector<float> x0, y0, x1, y1;
+};
+
+/* This is the batch intersection over union of all source and destination
+ * rectangles, the union being the bounding rectangle of both rectangles as in
+ * VPP::BBox::iou(). The results are a source-rows by destination-columns
+ * contiguous matrix of floats */
+void iou(const Rects &src, const Rects &dst, float *results) noexcept;
+
+/* This converts an 8-bit BGR image into the scaled R, G and B float planes of
+ * a width by height planar buffer, with its top-left corner at the provided
+ * location. The buffer must be large enough for the image to fit at this
+ * location */
+void planarise(const cv::Mat &bgr, float *planes, int width, int height,
+               const cv::Point &at, float scale) noexcept;
+
+/* This converts a 16-bit unsigned or a float depth map into a float depth map
+ * in metres of the same size, scaling the unsigned depths and turning all the
+ * invalid depths (nil, negative or NaN) into NaN */
+void metric(const cv::Mat &depth, float scale, cv::Mat &metres) noexcept;
+
+/* This merges the overlapping rectangles into their bounding rectangles until
+ * none of them overlap */
+void merge(std::vector<cv::Rect> &rects) noexcept;
+
+/* This is the index of the first greatest of n > 0 values, the greatest value
+ * being returned in best */
+int argmax(const float *values, int n, float &best) noexcept;
+
 }  // namespace OCV
 }  // namespace Util
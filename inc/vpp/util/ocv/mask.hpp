@@ -0,0 +1,98 @@
+/**
+ *
+ * @file      vpp/util/ocv/mask.hpp
+ *
+ * @brief     This is the static mask of the relevant areas of a source
+ *
+ * @details   This is a mask of the areas of a source worth processing, made
+ *            of the inclusion polygons (the whole frame if none) minus the
+ *            exclusion polygons, in coordinates normalised to the frame size.
+ *            It is rasterised once per resolution, with the integral of its
+ *            relevant pixels, for the tasks to skip their masked tiles and to
+ *            drop the zones mostly in the masked areas in constant time.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+
+namespace Util {
+namespace OCV {
+
+class Mask final {
+    public:
+        /* The mask rasterised at a resolution */
+        class Raster final {
+            public:
+                /* The relevant pixels (255) and the masked ones (0) */
+                cv::Mat  pixels;
+
+                /* The bounding box of the relevant pixels */
+                cv::Rect bounds;
+
+                /* The ratio of a region which is masked, its parts outside
+                 * of the frame being masked */
+                float masked(const cv::Rect &r) const noexcept;
+
+                /* Is a region masked more than the threshold of the mask? */
+                inline bool excluded(const cv::Rect &r) const noexcept {
+                    return masked(r) > threshold;
+                }
+
+            private:
+                friend class Mask;
+
+                cv::Mat sums;
+                float   threshold;
+        };
+
+        using Polygon = std::vector<cv::Point2f>;
+
+        Mask() noexcept;
+        ~Mask() noexcept = default;
+
+        /* Defining the mask from the inclusion and exclusion polygons, as
+         * lists of normalised points "x,y x,y x,y" separated by ';', and the
+         * masked ratio above which a region is excluded. False if any polygon
+         * is invalid */
+        bool define(const std::string &inclusions,
+                    const std::string &exclusions, float threshold) noexcept;
+
+        /* Composing the masks of the cells of a mosaic, the cells being in
+         * normalised coordinates and a null mask leaving its cell relevant */
+        void compose(const std::vector<const Mask *> &masks,
+                     const std::vector<cv::Rect_<float>> &cells) noexcept;
+
+        /* Is nothing masked? */
+        inline bool empty() const noexcept {
+            return included.empty() && excluded.empty();
+        }
+
+        /* The mask at a resolution, only rasterised on its first use */
+        const Raster &raster(const cv::Size &size) const noexcept;
+
+    private:
+        std::vector<Polygon>       included;
+        std::vector<Polygon>       excluded;
+        float                      threshold;
+
+        /* The rasters are never moved once built, as the tasks keep them */
+        mutable std::mutex         rasterising;
+        mutable std::deque<Raster> rasters;
+};
+
+}  // namespace OCV
+}  // namespace Util
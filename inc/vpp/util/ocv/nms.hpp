@@ -0,0 +1,103 @@
+/**
+ *
+ * @file      vpp/util/ocv/nms.hpp
+ *
+ * @brief     This is the non-maximum suppression of the detected boxes
+ *
+ * @details   This is the non-maximum suppression shared by all the detectors.
+ *            The candidate boxes are sorted once by decreasing scores, and
+ *            each of them is only compared with the boxes already kept for
+ *            its class (or for all the classes), as a structure of arrays
+ *            whose overlaps are computed 4 at a time with whatever SIMD
+ *            instructions OpenCV was built with, a candidate being rejected
+ *            as soon as a kept box overlaps it. The suppression may also be a
+ *            Gaussian soft one, or merge the boxes cut by the tile borders
+ *            into the whole ones.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <opencv2/core/types.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace Util {
+namespace OCV {
+
+class NMS {
+    public:
+        NMS() noexcept;
+        ~NMS() noexcept = default;
+
+        /* The overlap above which a box is suppressed by a better one */
+        float threshold;
+
+        /* The score a box shall exceed for being kept */
+        float minimal;
+
+        /* Are the boxes only suppressed by the boxes of their class? */
+        bool  classwise;
+
+        /* The Gaussian soft suppression spread (0 for a hard suppression):
+         * the scores of the overlapping boxes are decayed by exp(-o²/sigma)
+         * instead, the boxes being dropped once scoring below the minimal
+         * score */
+        float sigma;
+
+        /* Merging the boxes found in several overlapping tiles: the overlap
+         * is over the smallest box rather than the union, for the boxes cut
+         * by the tile borders to be suppressed by the whole ones, and the
+         * kept boxes are grown to the boxes they suppress */
+        bool  merging;
+
+        /* Suppressing the non-maximum boxes, with the classes of the boxes
+         * (if any), the indices of the kept boxes being by decreasing scores.
+         * The scores are decayed in place by a soft suppression, and the kept
+         * boxes grown in place when merging */
+        void apply(std::vector<cv::Rect> &boxes, std::vector<float> &scores,
+                   const std::vector<int> &classes,
+                   std::vector<int> &kept) noexcept;
+
+    private:
+        /* The boxes of a class as a structure of arrays */
+        struct Boxes {
+            void clear() noexcept;
+            void push(const cv::Rect &r, int i) noexcept;
+            void erase(std::size_t n) noexcept;
+
+            std::vector<float> x0, y0, x1, y1, area;
+            std::vector<int>   index;
+        };
+
+        /* The index in the boxes of the first box overlapping a box more
+         * than the threshold, or -1 if none does */
+        int overlapped(const Boxes &b, const float *a)
+            const noexcept;
+
+        /* The overlaps of a box with all the boxes */
+        void overlaps(const Boxes &b, const float *a, float *results)
+            const noexcept;
+
+        void suppress(std::vector<cv::Rect> &boxes,
+                      std::vector<int> &kept) noexcept;
+        void decay(std::vector<cv::Rect> &boxes, std::vector<float> &scores,
+                   std::vector<int> &kept) noexcept;
+
+        std::vector<int>                order;
+        std::vector<int>                keys;
+        std::unordered_map<int, Boxes>  groups;
+        std::vector<float>              buffer;
+};
+
+}  // namespace OCV
+}  // namespace Util
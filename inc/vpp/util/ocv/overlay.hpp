@@ -7,6 +7,8 @@
  * @details   This is the definition of a base class for displaying visual
  *            information on an OCV frame using a common style. It allows to
  *            draw boxes of all kinds, put text anywhere and overlay images.
+ *            The glyphs of each font are rasterised once per size in an atlas,
+ *            and batches of boxes and texts are drawn in a few passes.
  *
  *            This file is part of the VPP framework (see link).
  *
@@ -20,8 +22,13 @@
 
 #pragma once
 
+#include <cstdint>
+#include <mutex>
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace Util {
 namespace OCV {
@@ -43,6 +50,10 @@ class Overlay {
 
         struct LayerStyle final {
             double saturation;
+            /* The frame height the layer is sized for, the layer being scaled
+             * to the height of the frames it is merged into, or 0 for never
+             * scaling it */
+            int    reference;
         };
 
         class Font {
@@ -67,6 +78,43 @@ class Overlay {
 
             protected:
                 explicit Font(std::string id, std::string path) noexcept;
+
+                /* The horizontal advance of some text */
+                virtual int advance(const std::string &text, int thickness,
+                                    int height) const noexcept;
+
+                /* Drawing some text from its origin, as the font does */
+                virtual void raster(cv::Mat &frame, const std::string &text,
+                                    const cv::Point &origin, int thickness,
+                                    AAMode antialiasing, cv::Scalar color,
+                                    int height) const noexcept;
+
+                /* Drawing a line of text from its origin glyph by glyph, the
+                 * glyphs being rasterised once per size in the font atlas */
+                void stamp(cv::Mat &frame, const std::string &line,
+                           cv::Point origin, int thickness,
+                           AAMode antialiasing, const cv::Scalar &color,
+                           int height) const noexcept;
+
+            private:
+                /* A glyph coverage mask, its offset from the origin and the
+                 * advance to the next glyph */
+                struct Glyph {
+                    cv::Mat   mask;
+                    cv::Point offset;
+                    int       advance;
+                };
+
+                const Glyph *glyph(const std::string &g, int thickness,
+                                   AAMode antialiasing, int height)
+                    const noexcept;
+
+                /* The glyphs by size, i.e. height, thickness and antialiasing,
+                 * and then by UTF-8 character */
+                using Glyphs = std::unordered_map<std::string, Glyph>;
+                mutable std::mutex                             access;
+                mutable std::unordered_map<uint64_t, Glyphs>   atlas;
+                mutable std::size_t                            glyphs;
         };
         
         struct TextStyle final {
@@ -77,6 +125,39 @@ class Overlay {
             Font *     font;
         };
 
+        /* A batch of boxes and texts drawn at once: all the translucent boxes
+         * are blended in a single pass over the rows they cover, and then all
+         * the outlines and all the texts are drawn in their batch order */
+        class Batch {
+            public:
+                Batch() noexcept;
+                ~Batch() noexcept;
+
+                void clear() noexcept;
+                bool empty() const noexcept;
+
+                void add(const cv::Rect &box, const DrawingStyle &style);
+                void add(std::string text, const cv::Point &at,
+                         const TextStyle &style);
+
+            private:
+                friend class Overlay;
+
+                struct Box {
+                    cv::Rect     rect;
+                    DrawingStyle style;
+                };
+
+                struct Text {
+                    std::string text;
+                    cv::Point   at;
+                    TextStyle   style;
+                };
+
+                std::vector<Box>  boxes;
+                std::vector<Text> texts;
+        };
+
         class Layer {
             public:
                 Layer() noexcept;
@@ -84,8 +165,15 @@ class Overlay {
 
                 void clear() noexcept;
                 bool empty() const noexcept;
+                /* Blending the premultiplied layer into its rectangle of a
+                 * BGR frame, a negative location being from the right or the
+                 * bottom of the frame */
                 void merge(cv::Mat &frame, const cv::Point &at,
                            const LayerStyle &style) const noexcept;
+
+                /* The size of the layer once merged into a frame */
+                cv::Size size(const cv::Size &frame,
+                              const LayerStyle &style) const noexcept;
                 void set(const std::string &filename) noexcept;
                 void set(cv::Size size, const uint8_t *bgr,
                          const uint8_t *alpha) noexcept;
@@ -95,7 +183,17 @@ class Overlay {
                 int height;
 
             private:
+                /* Getting the layer scaled to a size, as cached until the
+                 * frames are of another size */
+                void scaled(const cv::Size &to, cv::Mat &f,
+                            cv::Mat &m) const noexcept;
+
+                /* The premultiplied colours and the inverse alpha of the
+                 * layer, both as 8-bit BGR images */
                 cv::Mat fg, msk;
+
+                mutable std::mutex access;
+                mutable cv::Mat    sfg, smsk;
         };
 
 
@@ -133,6 +231,9 @@ class Overlay {
         void draw(cv::Mat &frame, const std::string &text, const cv::Point &at,
                   const TextStyle &style) const noexcept;
 
+        /* Batch drawing primitive */
+        void draw(cv::Mat &frame, const Batch &batch) const noexcept;
+
         /* Default styles */
         DrawingStyle defaultDrawingStyle;
         LayerStyle   defaultLayerStyle;
@@ -0,0 +1,112 @@
+/**
+ *
+ * @file      vpp/util/ocv/pool.hpp
+ *
+ * @brief     This is a pool of OpenCV matrix buffers
+ *
+ * @details   This is an OpenCV matrix allocator recycling the buffers of the
+ *            released matrices for the next matrices of the same size. As
+ *            the frames keep the same geometry, the conversions and scalings
+ *            done on every frame eventually reuse the buffers of the former
+ *            frames instead of allocating and freeing large chunks of memory,
+ *            for a flat memory footprint. On NUMA hosts, the buffers are
+ *            recycled per node, so that a matrix gets a buffer local to the
+ *            node of the thread creating it.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <opencv2/core/mat.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace Util {
+namespace OCV {
+
+class Pool final : public cv::MatAllocator {
+    public:
+#if CV_VERSION_MAJOR >= 4
+        using Access = cv::AccessFlag;
+#else
+        using Access = int;
+#endif
+
+        struct Statistics {
+            std::size_t allocations; /* Buffers allocated from the system */
+            std::size_t reuses;      /* Buffers reused from the pool */
+            std::size_t used;        /* Bytes used by the live matrices */
+            std::size_t pooled;      /* Bytes kept in the pool */
+            std::size_t peak;        /* Peak of the used and pooled bytes */
+        };
+
+        /* The pool shared by all the images, never destroyed for matrices
+         * to be released at any time */
+        static Pool &shared() noexcept;
+
+        /* Create a matrix whose buffer comes from the shared pool */
+        static cv::Mat mat(const cv::Size &size, int type) noexcept;
+
+        Pool() noexcept;
+        ~Pool() noexcept;
+
+        /* Pools cannot be copied nor moved */
+        Pool(const Pool& other) = delete;
+        Pool(Pool&& other) = delete;
+        Pool& operator=(const Pool& other) = delete;
+        Pool& operator=(Pool&& other) = delete;
+
+        cv::UMatData *allocate(int dims, const int *sizes, int type,
+                               void *data, std::size_t *step, Access flags,
+                               cv::UMatUsageFlags usage) const override;
+        bool allocate(cv::UMatData *data, Access flags,
+                      cv::UMatUsageFlags usage) const override;
+        void deallocate(cv::UMatData *data) const override;
+
+        /* Maximal number of bytes kept in the pool, the buffers released
+         * beyond being freed */
+        void limit(std::size_t bytes) noexcept;
+
+        /* Free all the buffers kept in the pool */
+        void trim() noexcept;
+
+        Statistics statistics() const noexcept;
+
+    private:
+        using Buffers = std::unordered_multimap<std::size_t, uchar *>;
+
+        uchar *take(std::size_t size, int node) const noexcept;
+        void give(uchar *buffer, std::size_t size, int node) const noexcept;
+
+        mutable std::mutex                                     access;
+        mutable std::vector<Buffers>                           buffers;
+        mutable Statistics                                     stats;
+        std::size_t                                            max_pooled;
+};
+
+/* Accounting the memory held by some matrices, every buffer being counted
+ * once whatever the number of matrices sharing it */
+class Footprint final {
+    public:
+        Footprint() noexcept : seen() {}
+        ~Footprint() noexcept = default;
+
+        /* The bytes of the buffer of a matrix, or 0 if already counted */
+        std::size_t add(const cv::Mat &m) noexcept;
+
+    private:
+        std::vector<const void *> seen;
+};
+
+}  // namespace OCV
+}  // namespace Util
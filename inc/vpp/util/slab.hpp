@@ -0,0 +1,147 @@
+/**
+ *
+ * @file      vpp/util/slab.hpp
+ *
+ * @brief     This is the VPP slab allocator description file
+ *
+ * @details   A slab hands out fixed-size blocks carved out of large chunks,
+ *            the released blocks being kept in a free list for the next
+ *            allocations, and the chunks being only returned to the system
+ *            with the slab. Node-based containers with many short-lived nodes
+ *            then neither fragment the heap nor call the system allocator in
+ *            the steady state. Slabs are not thread-safe.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace Util {
+
+class Slab final {
+    public:
+        /* A slab of blocks of a given size, allocated by chunks of blocks */
+        explicit Slab(std::size_t size, std::size_t blocks = 64) noexcept;
+        ~Slab() noexcept = default;
+
+        /* Slabs cannot be copied nor moved */
+        Slab(const Slab& other) = delete;
+        Slab(Slab&& other) = delete;
+        Slab& operator=(const Slab& other) = delete;
+        Slab& operator=(Slab&& other) = delete;
+
+        inline std::size_t size() const noexcept {
+            return block;
+        }
+
+        /* Getting a block, throwing std::bad_alloc as operator new does */
+        void *allocate();
+
+        /* Handing a block back to the slab, for the next allocations */
+        void release(void *p) noexcept;
+
+        /* The numbers of blocks carved out and in use */
+        inline std::size_t capacity() const noexcept {
+            return chunks.size() * count;
+        }
+
+        inline std::size_t used() const noexcept {
+            return live;
+        }
+
+    private:
+        /* The free blocks are chained through their first bytes */
+        struct Free {
+            Free *next;
+        };
+
+        const std::size_t                    block;
+        const std::size_t                    count;
+        std::vector<std::unique_ptr<char[]>> chunks;
+        Free *                               available;
+        std::size_t                          live;
+};
+
+/* The slabs shared by all the rebound copies of a slab allocator, one per
+ * block size */
+class Slabs final {
+    public:
+        Slabs() noexcept : slabs() {}
+        ~Slabs() noexcept = default;
+
+        /* Slabs cannot be copied nor moved */
+        Slabs(const Slabs& other) = delete;
+        Slabs(Slabs&& other) = delete;
+        Slabs& operator=(const Slabs& other) = delete;
+        Slabs& operator=(Slabs&& other) = delete;
+
+        /* The slab of the blocks of a given size, created on first use */
+        Slab &of(std::size_t size);
+
+    private:
+        std::vector<std::unique_ptr<Slab>> slabs;
+};
+
+/* A standard allocator for node-based containers: single objects come from
+ * the slab of their size, and arrays from the system allocator */
+template <typename T> class SlabAllocator {
+    public:
+        using value_type = T;
+
+        template <typename U> struct rebind {
+            using other = SlabAllocator<U>;
+        };
+
+        SlabAllocator() : slabs(std::make_shared<Slabs>()) {}
+
+        /* Moved containers keep sharing the slabs of their allocator */
+        SlabAllocator(const SlabAllocator &other) noexcept
+            : slabs(other.slabs) {}
+
+        template <typename U>
+            SlabAllocator(const SlabAllocator<U> &other) noexcept
+            : slabs(other.slabs) {}
+
+        inline T *allocate(std::size_t n) {
+            if (n == 1) {
+                return static_cast<T *>(slabs->of(sizeof(T)).allocate());
+            }
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        }
+
+        inline void deallocate(T *p, std::size_t n) noexcept {
+            if (n == 1) {
+                slabs->of(sizeof(T)).release(p);
+            } else {
+                ::operator delete(p);
+            }
+        }
+
+        template <typename U>
+            inline bool operator==(const SlabAllocator<U> &other)
+            const noexcept {
+            return slabs == other.slabs;
+        }
+
+        template <typename U>
+            inline bool operator!=(const SlabAllocator<U> &other)
+            const noexcept {
+            return slabs != other.slabs;
+        }
+
+        std::shared_ptr<Slabs> slabs;
+};
+
+}  // namespace Util
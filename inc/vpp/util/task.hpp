@@ -22,11 +22,23 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <forward_list>
+#include <functional>
 #include <future>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
 
+#include "vpp/util/affinity.hpp"
+#include "vpp/util/mutex.hpp"
 #include "vpp/util/templates.hpp"
 
 namespace Util {
@@ -78,6 +90,195 @@ class Core {
         std::forward_list<std::future<int> > _status;  /// Status when task ends
 };
 
+/** Priorities of the tasks, every task inheriting the priority of the thread
+ * starting it, and running with it */
+class Priority {
+    public:
+        /** Latency-critical tasks, e.g. the ones of the detection path */
+        static constexpr int Critical   = 0;
+        /** Default tasks */
+        static constexpr int Normal     = 1;
+        /** Background tasks, e.g. the classification or OCR ones */
+        static constexpr int Background = 2;
+        /** Number of priorities */
+        static constexpr int Levels     = 3;
+
+        /** Priority of the calling thread */
+        static int current() noexcept;
+
+        /** Scoped priority of the calling thread */
+        class Scope {
+            public:
+                explicit Scope(int priority) noexcept;
+                ~Scope() noexcept;
+
+                /** Scopes cannot be copied nor moved */
+                Scope(const Scope& other) = delete;
+                Scope(Scope&& other) = delete;
+                Scope& operator=(const Scope& other) = delete;
+                Scope& operator=(Scope&& other) = delete;
+
+            private:
+                int _previous;  /// Priority of the thread before the scope
+        };
+};
+
+/** Process-wide pool of persistent workers running the asynchronous tasks, so
+ * that starting a task does not create nor destroy any thread. The pending
+ * works are scheduled by priority, every priority getting a share of the
+ * workers in proportion to its weight, so that the background works are
+ * preempted by the critical ones without ever being starved */
+class Pool {
+    public:
+        /** Accessing the process-wide pool */
+        static Pool &instance() noexcept;
+
+        /** Pools cannot be copied nor moved */
+        Pool(const Pool& other) = delete;
+        Pool(Pool&& other) = delete;
+        Pool& operator=(const Pool& other) = delete;
+        Pool& operator=(Pool&& other) = delete;
+        ~Pool() noexcept;
+
+        /** Resizing the pool, a 0-sized pool launching a thread per task */
+        void resize(int workers) noexcept;
+
+        /** Number of workers in the pool */
+        int size() noexcept;
+
+        /** Pinning the workers on some cores (all of them if empty), the
+         * workers created later on being pinned on them as well */
+        void pin(const Util::Affinity::Cores &cores) noexcept;
+
+        /** Weighting a priority (by default 16, 4 and 1 from the critical
+         * to the background ones) */
+        void weigh(int priority, int weight) noexcept;
+
+        /** Weight of a priority */
+        int weight(int priority) noexcept;
+
+        /** Submitting some work to the pool, at the priority of the calling
+         * thread by default */
+        std::future<int> submit(const Core::Work &work) noexcept;
+        std::future<int> submit(const Core::Work &work, int priority) noexcept;
+
+        /** Running a pending work in the calling thread if there is any, so
+         * that waiting tasks help the pool rather than starving it */
+        bool help() noexcept;
+
+    private:
+        Pool() noexcept;
+
+        /** Processing loop of the workers */
+        void run() noexcept;
+
+        /** Taking the next pending work (if any) with the lock held, i.e.
+         * the one of the priority whose virtual time is the earliest */
+        bool take(std::function<void()> &job) noexcept;
+
+        /** Is there any pending work? */
+        bool pending() const noexcept;
+
+        using Jobs = std::deque<std::function<void()> >;
+
+        std::mutex               _access;                  /// Access mutex
+        std::condition_variable  _ready;                   /// Pending work
+        Jobs                     _jobs[Priority::Levels];  /// Pending works
+        int                      _weights[Priority::Levels]; /// Shares
+        uint64_t                 _passes[Priority::Levels];  /// Virtual times
+        uint64_t                 _clock;                   /// Virtual time
+        std::vector<std::thread> _workers;                 /// Workers
+        Util::Affinity::Cores    _cores;                   /// Worker cores
+        bool                     _exiting;                 /// Exit status
+};
+
+/** Process-wide startup of the engines, whose slow setups (the loading of
+ * their models) run as phases on the pool concurrently with the other ones
+ * when enabled, a phase only waiting for the phases it depends on. The
+ * startup ends once all its phases are waited for, usually when a pipeline
+ * starts, any later setup running again in the calling thread */
+class Startup {
+    public:
+        /** A phase of the startup, whose copies all share the same state, a
+         * default phase being already complete */
+        class Phase {
+            public:
+                Phase() noexcept;
+                ~Phase() noexcept = default;
+
+                Phase(const Phase& other) = default;
+                Phase(Phase&& other) = default;
+                Phase& operator=(const Phase& other) = default;
+                Phase& operator=(Phase&& other) = default;
+
+                /** Is the phase complete? */
+                bool ready() const noexcept;
+
+                /** Waiting for the phase to complete, the calling thread
+                 * helping the pool meanwhile, and returning its error */
+                int wait() const noexcept;
+
+            private:
+                friend class Startup;
+
+                struct State {
+                    State() noexcept;
+
+                    mutable std::mutex      access;     /// Access mutex
+                    std::condition_variable completed;  /// Completion
+                    bool                    done;       /// Completed?
+                    int                     error;      /// Setup error
+                    std::string             name;       /// Phase name
+                    uint64_t                elapsed;    /// Duration in ns
+                };
+
+                std::shared_ptr<State> _state;          /// Shared state
+        };
+
+        /** Accessing the process-wide startup */
+        static Startup &instance() noexcept;
+
+        /** Startups cannot be copied nor moved */
+        Startup(const Startup& other) = delete;
+        Startup(Startup&& other) = delete;
+        Startup& operator=(const Startup& other) = delete;
+        Startup& operator=(Startup&& other) = delete;
+        ~Startup() noexcept;
+
+        /** Running the setups concurrently during the startup (or not) */
+        void concurrent(bool yes) noexcept;
+        bool concurrent() noexcept;
+
+        /** Running a named setup once the phases it depends on are complete,
+         * on the pool when concurrent during the startup, or else right away
+         * in the calling thread, a failed dependency failing the phase */
+        Phase run(std::string name, Core::Work setup,
+                  std::vector<Phase> after = {}) noexcept;
+
+        /** Running a named setup again as a phase, once its former run is
+         * complete, and returning the error of a setup run right away (0
+         * for a setup still running in the background) */
+        int run(Phase &phase, std::string name, Core::Work setup) noexcept;
+
+        /** Ending the startup: waiting for all its phases, logging their
+         * timing breakdown, and returning the first error (if any) */
+        int wait() noexcept;
+
+        /** The timing breakdown of the last startup, from the slowest phase
+         * to the fastest one, and the time all of them took together */
+        std::string summary() noexcept;
+
+    private:
+        Startup() noexcept;
+
+        std::mutex               _access;       /// Access mutex
+        bool                     _concurrent;   /// Concurrent setups?
+        std::vector<Phase>       _phases;       /// Phases of the startup
+        std::vector<Phase>       _ended;        /// Phases of the last one
+        uint64_t                 _began;        /// Start time in ns
+        uint64_t                 _lasted;       /// Duration in ns
+};
+
 /* Using the curiously recurring template pattern (CRTP) for performance
  * T is the final task class, E is the optional environment parameter 
  * references. This class instantiate a single task for performing actions in 
@@ -134,9 +335,15 @@ template <typename T, typename ...E> class Core : public Util::Task::Core {
         using typename Util::Task::Core::Mode;
 
         inline explicit Core(const int mode) noexcept
-            : Util::Task::Core(mode), synchro() {}
+            : Util::Task::Core(mode), synchro("tasks"), chunk(1) {}
         inline ~Core() noexcept = default;
 
+        /** Setting the number of environments handed out at once to each
+         * task, so that a single synchronisation covers a whole chunk */
+        inline void granulate(const int grain) noexcept {
+            chunk = std::max(1, grain);
+        }
+
         /** Start processing the environment */
         inline int start(E&... e) noexcept {
            /* This is where the trick is: Do not force passing by reference, 
@@ -152,7 +359,11 @@ template <typename T, typename ...E> class Core : public Util::Task::Core {
 
     protected:
         inline int dispatch(E... e) noexcept {
-            std::unique_lock<std::mutex> access(synchro, std::defer_lock);
+            if (chunk > 1) {
+                return chunked(Util::indices_for<E...>(), e...);
+            }
+
+            std::unique_lock<Util::Mutex> access(synchro, std::defer_lock);
             int error  = 0;
             bool again = true;
             while (again) {
@@ -169,6 +380,38 @@ template <typename T, typename ...E> class Core : public Util::Task::Core {
             return error;
         }
 
+        /** Chunked dispatching: the environments of a whole chunk are all
+         * iterated at once, before being processed outside the lock */
+        template <std::size_t ...I>
+            inline int chunked(Util::indices<I...>, E&... e) noexcept {
+            std::vector<std::tuple<E...> > environments;
+            int error  = 0;
+            bool again = true;
+
+            environments.reserve(chunk);
+            while (again) {
+                {
+                    std::lock_guard<Util::Mutex> access(synchro);
+                    while ( (static_cast<int>(environments.size()) < chunk) &&
+                            (static_cast<T *>(this)->next(e...)) ) {
+                        environments.emplace_back(e...);
+                    }
+                }
+
+                /* A partial chunk means that the iteration is over */
+                again = (static_cast<int>(environments.size()) == chunk);
+                for (auto &env : environments) {
+                    error = static_cast<T *>(this)->process(
+                                                        std::get<I>(env)...);
+                    if (error < 0) {
+                        return error;
+                    }
+                }
+                environments.clear();
+            }
+            return error;
+        }
+
         /** Iterator to do things in parallel */
         inline bool next(E&... /*e*/) noexcept {
             /* next(): Next environment computation shall be redefined in child
@@ -189,7 +432,10 @@ template <typename T, typename ...E> class Core : public Util::Task::Core {
         }
 
         /** Mutex for synchronising access between tasks */
-        std::mutex            synchro;
+        Util::Mutex           synchro;
+
+        /** Number of environments handed out at once to each task */
+        int                   chunk;
 };
 
 /* Tasks list are only relevant when the L type is a container! 
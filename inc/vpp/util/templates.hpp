@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <type_traits>
 
 namespace Util {
@@ -61,4 +62,25 @@ template <typename T>
     using storable_wrapper_t =
         typename storable_wrapper<T>::type;
 
+/* Compile-time index sequences for unpacking tuples, as C++11 lacks them */
+template <std::size_t ...I>
+    struct indices {};
+
+template <std::size_t N, std::size_t ...I>
+    struct build_indices : build_indices<N-1, N-1, I...> {};
+
+template <std::size_t ...I>
+    struct build_indices<0, I...> {
+        using type = indices<I...>; };
+
+template <typename ...T>
+    using indices_for = typename build_indices<sizeof...(T)>::type;
+
+/* Compile-time conjunction of booleans, as C++11 lacks fold expressions */
+template <bool ...B>
+    struct bools {};
+
+template <bool ...B>
+    using all = std::is_same<bools<true, B...>, bools<B..., true>>;
+
 }  // namespace Util
@@ -0,0 +1,91 @@
+/**
+ *
+ * @file      vpp/util/trace.hpp
+ *
+ * @brief     This is a timeline trace recorder
+ *
+ * @details   Spans of execution are recorded as complete events into buffers
+ *            of the recording threads, without any lock, and are exported as
+ *            a Chrome trace (JSON) file, that can be opened in Perfetto or in
+ *            chrome://tracing for showing the overlap between all the threads.
+ *            When the recorder is disabled, a span costs a single relaxed
+ *            atomic load.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace Util {
+namespace Trace {
+
+/* The recording status, only to be read through enabled() */
+extern std::atomic<bool> recording;
+
+/* Enabling or disabling the recording of the spans */
+void enable(bool yes) noexcept;
+
+inline bool enabled() noexcept {
+    return recording.load(std::memory_order_relaxed);
+}
+
+/* Forgetting all the recorded spans, whilst not recording only */
+void clear() noexcept;
+
+/* Exporting the recorded spans as a Chrome trace file */
+bool save(const std::string &path) noexcept;
+
+/* Recording a span started beforehand, from a steady clock time in ns up to
+ * now, e.g. from the capture of a scene, the category shall be a literal */
+void span(const char *category, const char *name, uint64_t since) noexcept;
+
+/* Recording the span of its lifetime, the category shall be a literal */
+class Span final {
+    public:
+        inline Span(const char *category, const char *name) noexcept
+            : start(0), category(category), label(name) {
+            if (enabled()) {
+                begin();
+            }
+        }
+
+        inline Span(const char *category, const std::string &name) noexcept
+            : Span(category, name.c_str()) {}
+
+        inline ~Span() noexcept {
+            if (start != 0) {
+                end();
+            }
+        }
+
+        /* Spans cannot be copied nor moved */
+        Span(const Span& other) = delete;
+        Span(Span&& other) = delete;
+        Span& operator=(const Span& other) = delete;
+        Span& operator=(Span&& other) = delete;
+
+    private:
+        void begin() noexcept;
+        void end() noexcept;
+
+        static constexpr std::size_t LENGTH = 40;
+
+        uint64_t    start;
+        const char *category;
+        const char *label;
+        char        name[LENGTH];
+};
+
+}  // namespace Trace
+}  // namespace Util
@@ -23,11 +23,18 @@
 
 #pragma once
 
+#include <array>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include "vpp/error.hpp"
 #include "vpp/image.hpp"
 #include "vpp/projection.hpp"
+#include "vpp/util/ocv/mask.hpp"
 
 namespace VPP {
 
@@ -35,42 +42,71 @@ class View final {
     public: 
         class Depth final {
             public:
-                Depth() noexcept : neighbourhood(), depth_map(nullptr), 
-                                   projecter(nullptr) {};
+                Depth() noexcept : neighbourhood(), filling(false),
+                                   depth_map(nullptr), projecter(nullptr),
+                                   integrated(nullptr), sums(), counts(),
+                                   indexed(nullptr), labels(), valids(),
+                                   measured(nullptr), metric(), caching() {};
 
                 ~Depth() noexcept = default;
 
                 Depth(const Depth& other) noexcept 
-                    : neighbourhood(other.neighbourhood), depth_map(nullptr), 
-                      projecter(other.projecter) {}
+                    : neighbourhood(other.neighbourhood),
+                      filling(other.filling), depth_map(nullptr),
+                      projecter(other.projecter), integrated(nullptr),
+                      sums(), counts(), indexed(nullptr), labels(), valids(),
+                      measured(nullptr), metric(), caching() {}
 
                 Depth(Depth&& other) noexcept
                     : neighbourhood(std::move(other.neighbourhood)), 
-                      depth_map(nullptr), projecter(other.projecter) {}
+                      filling(other.filling), depth_map(nullptr),
+                      projecter(other.projecter), integrated(nullptr),
+                      sums(), counts(), indexed(nullptr), labels(), valids(),
+                      measured(nullptr), metric(), caching() {}
 
                 Depth& operator=(const Depth& other) noexcept {
                     neighbourhood = other.neighbourhood;
+                    filling       = other.filling;
                     depth_map     = nullptr; 
                     projecter     = other.projecter;
+                    integrated    = nullptr;
+                    indexed       = nullptr;
+                    measured      = nullptr;
                     return *this;
                 }
 
                 Depth& operator=(Depth&& other) noexcept {
                     neighbourhood = std::move(other.neighbourhood);
+                    filling       = other.filling;
                     depth_map     = nullptr; 
                     projecter     = other.projecter;
+                    integrated    = nullptr;
+                    indexed       = nullptr;
+                    measured      = nullptr;
                     return *this;
                 }
 
                 Error::Type map(const Image &d, const Projecter &p) noexcept;
                 Error::Type remap(const Image &d, bool force=false) noexcept;
 
-                /* Returns -1 if the depth is not valid */
+                /* Returns -1 if the depth is not valid, or the depth of the
+                 * nearest valid pixel when filling the holes */
                 float at(const cv::Point &pix) const noexcept;
 
-                /* Returns the average of the valid depth points */
+                /* Returns the average of the valid depth points, in constant
+                 * time from integral images built on the first call */
                 float at(const cv::Rect &area) const noexcept;
 
+                /* The depth map in metres, NaN for all its invalid depths, as
+                 * converted once on the first call and shared by all the depth
+                 * lookups. There must be a depth map */
+                const cv::Mat &metres() const noexcept;
+
+                /* Whether a depth image is the mapped depth map */
+                inline bool maps(const Image &d) const noexcept {
+                    return depth_map == &d;
+                }
+
                 /* Scaling factor from first to second mode */
                 float scaler(const Image::Mode &from,
                              const Image::Mode &to) const noexcept;
@@ -84,14 +120,143 @@ class View final {
                 cv::Point3f deproject(const cv::Point &p) const noexcept;
                 cv::Point project(const cv::Point3f &p) const noexcept;
 
+                /* Batch deprojection of points at the same depth, and
+                 * organised point cloud of an area (NaN for the invalid
+                 * depths), empty if there is no depth map at all */
+                void deproject(const std::vector<cv::Point> &p, float z,
+                               std::vector<cv::Point3f> &points)
+                    const noexcept;
+                cv::Mat cloud(const cv::Rect &area) const noexcept;
+
+                /* Batch deprojection of points at their own depths, the
+                 * invalid ones only getting an invalid depth */
+                void deproject(const std::vector<cv::Point> &p,
+                               const std::vector<float> &z,
+                               std::vector<cv::Point3f> &points)
+                    const noexcept;
+
+                /* Whether there is a depth map to deproject from */
+                inline bool available() const noexcept {
+                    return (depth_map != nullptr) && (projecter != nullptr);
+                }
+
                 /* Neighbourhood for finding the right depth because of holes
                  * in the depth map*/
                 std::vector<uint16_t>        neighbourhood;
                 static std::vector<uint16_t> default_neighbourhood;
 
+                /* Whether the holes of the depth map are filled with the
+                 * depth of their nearest valid pixel for all lookups */
+                bool filling;
+
             private:
+                /* Build the integral images of the depth map if needed */
+                void integrate() const noexcept;
+
+                /* Build the nearest valid pixel index of the depth map if
+                 * needed, and return the nearest valid pixel of a located
+                 * pixel of the depth map */
+                void index() const noexcept;
+                cv::Point nearest(const cv::Point &pix) const noexcept;
+
                 Image const     *depth_map;
                 Projecter const *projecter;
+
+                /* Integral images of the valid depths and of their count for
+                 * the integrated depth map, labels of the nearest valid
+                 * pixels for the indexed depth map, and metric depths of the
+                 * measured depth map, all lazily built in a thread-safe way */
+                mutable Image const            *integrated;
+                mutable cv::Mat                 sums;
+                mutable cv::Mat                 counts;
+                mutable Image const            *indexed;
+                mutable cv::Mat                 labels;
+                mutable std::vector<cv::Point>  valids;
+                mutable Image const            *measured;
+                mutable cv::Mat                 metric;
+                mutable std::mutex              caching;
+        };
+
+        /* A pyramid of an image of the view, every level being half the size
+         * of the previous one, lazily built with area resizes on first use
+         * and shared by all the users of the view */
+        class Pyramid final {
+            public:
+                explicit Pyramid(cv::Mat base) noexcept;
+                ~Pyramid() noexcept = default;
+
+                /* Pyramids cannot be copied nor moved */
+                Pyramid(const Pyramid& other) = delete;
+                Pyramid(Pyramid&& other) = delete;
+                Pyramid& operator=(const Pyramid& other) = delete;
+                Pyramid& operator=(Pyramid&& other) = delete;
+
+                /* The level 0 is the image itself, and the image of the
+                 * deepest level is returned for any deeper level */
+                const cv::Mat &level(int k) noexcept;
+
+                /* The smallest level whose image is at least of this size */
+                const cv::Mat &fitting(const cv::Size &size) noexcept;
+
+                /* The bytes of the levels built, the base one excluded */
+                std::size_t footprint(Util::OCV::Footprint &f) noexcept;
+
+            private:
+                std::deque<cv::Mat> levels;
+                std::mutex          building;
+        };
+
+        /* Letterboxed crops of some areas of an image of the view, all of
+         * the same size: every area is centred in its crop, scaled up to 4
+         * times and padded with a fill colour. The missing crops are built
+         * in a single parallel pass into a batch buffer of their own, and
+         * shared by all the users of the view, each area being cropped only
+         * once */
+        class Crops final {
+            public:
+                struct Crop {
+                    cv::Mat image;
+                    float   scale;
+                };
+
+                Crops(cv::Mat base, const Image::Mode &mode,
+                      const cv::Size &size, const cv::Scalar &fill) noexcept;
+                ~Crops() noexcept = default;
+
+                /* Crops cannot be copied nor moved */
+                Crops(const Crops& other) = delete;
+                Crops(Crops&& other) = delete;
+                Crops& operator=(const Crops& other) = delete;
+                Crops& operator=(Crops&& other) = delete;
+
+                /* Is it the crops of a certain mode, size and fill colour ? */
+                bool of(const Image::Mode &mode, const cv::Size &size,
+                        const cv::Scalar &fill) const noexcept;
+
+                /* Is it the crops of a certain mode ? */
+                inline bool of(const Image::Mode &m) const noexcept {
+                    return mode == m;
+                }
+
+                /* The crops of the areas, in the same order */
+                std::vector<Crop> of(const std::vector<cv::Rect> &areas)
+                    noexcept;
+
+                /* The bytes of the crops built, the base image excluded */
+                std::size_t footprint(Util::OCV::Footprint &f) noexcept;
+
+            private:
+                struct Entry {
+                    cv::Rect area;
+                    Crop     crop;
+                };
+
+                const cv::Mat      base;
+                const int          mode;
+                const cv::Size     size;
+                const cv::Scalar   fill;
+                std::vector<Entry> entries;
+                std::mutex         building;
         };
 
         View() noexcept;
@@ -108,19 +273,46 @@ class View final {
         View& operator=(View&& other) noexcept;
 
         inline bool empty() const noexcept {
-            return images.empty();
+            for (int i = 0; i < MODES; ++i) {
+                if (images[i].mode() == (1 << i)) {
+                    return false;
+                }
+            }
+            return true;
         }
 
         inline const cv::Rect & frame() const noexcept {
             return boundaries;
         }
 
+        /* The wall-clock timestamp of the view, in ms since the epoch */
         inline uint64_t ts_ms() const noexcept {
             return ts;
         }
 
-        /* Adding a new image in the view. Beware that only one colour image,
-         * one depth map and one motion map can be used in a single view.*/
+        /* Setting the timestamp of the view, e.g. when replaying it */
+        inline void stamp(uint64_t ms) noexcept {
+            ts = ms;
+        }
+
+        /* The monotonic capture time of the view, in us of the steady clock,
+         * for measuring the latencies of its processing */
+        inline uint64_t clock_us() const noexcept {
+            return clocked;
+        }
+
+        /* Setting the capture time of the view, e.g. from a hardware
+         * timestamp already converted to the steady clock */
+        inline void clock(uint64_t us) noexcept {
+            clocked = us;
+        }
+
+        /* The current time in us of the steady clock */
+        static uint64_t now_us() noexcept;
+
+        /* Adding a new image in the view. Beware that only one colour image
+         * (be it a native planar one), one depth map and one motion map
+         * can be used in a single view.*/
         Error::Type use(cv::Mat data, Image::Mode mode) noexcept;
         Error::Type use(cv::Mat depth, Image::Mode mode, 
                         const ProjectionDelegate &pd) noexcept;
@@ -135,7 +327,9 @@ class View final {
         /* "Uncached" image, i.e. should conversion happens, those are not
          * cached back, but if a cached version is found, then use it!
          * Besides, if done on a small region of interest, the conversion
-         * is only done on this region of interest */
+         * is only done on this region of interest, and the latest converted
+         * regions of interest are kept for serving the same regions (or
+         * smaller ones within them) again without any conversion */
         Image image(const Image::Mode &mode, const cv::Rect &roi) noexcept;
         Image bgr(const cv::Rect &roi) noexcept;
         Image hsv(const cv::Rect &roi) noexcept;
@@ -155,21 +349,105 @@ class View final {
         /* Force caching a certain mode of the image */
         Image &cache(const Image::Mode &mode) noexcept;
 
+        /* Force caching several modes of the image at once, converting them
+         * band by band for the BGR image to be read only once from memory */
+        Error::Type prefetch(const std::vector<Image::Mode> &modes) noexcept;
+
+        /* Release the cached conversion of a mode, with its pyramid, crops,
+         * device mirror and converted regions, for its buffers to get back
+         * to the frame pool. The images used in the view, the depth maps and
+         * the motion map are kept, and any later user converts it again */
+        void release(const Image::Mode &mode) noexcept;
+
+        /* Pyramid of the cached image in a certain mode */
+        Pyramid &pyramid(const Image::Mode &mode) noexcept;
+
+        /* Letterboxed crops of the cached image in a certain mode */
+        Crops &crops(const Image::Mode &mode, const cv::Size &size,
+                     const cv::Scalar &fill) noexcept;
+
+        /* The 4D (NCHW) input blob of a network for the cached image in a
+         * certain mode, resized from the smallest fitting level of its
+         * pyramid, mean subtracted, scaled and possibly with its first and
+         * last channels swapped, and only built once for all the networks
+         * of the view sharing the same pre-processing */
+        cv::Mat blob(const Image::Mode &mode, const cv::Size &size,
+                     double scale, const cv::Scalar &mean, bool swap)
+            noexcept;
+
+        /* Image in a certain mode on the (OpenCL) device, converted there from
+         * the colour image uploaded once, unless already cached on the host,
+         * and cached on the device for the next users */
+        const cv::UMat &device(const Image::Mode &mode) noexcept;
+
+        /* The bytes held by the host images of the view, with their cached
+         * conversions, pyramids and crops, which are not already accounted
+         * in a footprint */
+        std::size_t footprint(Util::OCV::Footprint &f) noexcept;
+
         /* Proxy to get depth information from a view (if any) */
         Depth depth;
 
+        /* The static mask of the relevant areas of the source (if any), as
+         * shared by all the copies of the view */
+        std::shared_ptr<const Util::OCV::Mask> mask;
+
     private:
-        void shortcut(Image::Mode m, Image *i) noexcept;
-        void reshortcut() noexcept;
-        Image *                        c_bgr;
-        Image *                        c_hsv;
-        Image *                        c_yuv;
-        Image *                        c_ycc;
-        Image *                        c_gray;
-        Image *                        c_motion;
+        /* The images are stored in a table indexed by their mode bit */
+        static constexpr int MODES = 11;
+        static inline int slot(int mode) noexcept {
+            for (int i = 0; i < MODES; ++i) {
+                if (mode == (1 << i)) {
+                    return i;
+                }
+            }
+            return -1;
+        }
+        Image &store(Image image) noexcept;
+        Image *cached_native() noexcept;
+
+        /* Map the depth object onto the depth map of this view */
+        void remap() noexcept;
+
+        /* A colour region of interest converted from a source image, the
+         * least recently used ones being dropped first */
+        struct Converted {
+            int          mode;
+            cv::Rect     area;
+            const uchar *source;
+            Image        image;
+        };
+        bool converted(int mode, const cv::Rect &area, const uchar *source,
+                       Image &image) noexcept;
+        void convert(int mode, const cv::Rect &area, const uchar *source,
+                     const Image &image) noexcept;
+        std::list<Converted>           conversions;
+        std::mutex                     converting;
+
+        std::unordered_map<int, std::unique_ptr<Pyramid>> pyramids;
+        std::mutex                                        scaling;
+
+        std::vector<std::unique_ptr<Crops>>               croppings;
+        std::mutex                                        cropping;
+
+        struct Blob {
+            int        mode;
+            cv::Size   size;
+            double     scale;
+            cv::Scalar mean;
+            bool       swap;
+            cv::Mat    data;
+        };
+        std::vector<Blob>                                 blobs;
+        std::mutex                                        blobbing;
+
+        std::unordered_map<int, cv::UMat>                 mirrors;
+
         cv::Rect                       boundaries;
-        std::unordered_map<int, Image> images;
+        std::array<Image, MODES>       images;
+        int                            originals;
         uint64_t                       ts;
+        uint64_t                       clocked;
 };
 
 }  // namespace VPP
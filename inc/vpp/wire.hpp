@@ -0,0 +1,204 @@
+/**
+ *
+ * @file      vpp/wire.hpp
+ *
+ * @brief     This is the VPP scene wire format description file
+ *
+ * @details   The wire format is a compact binary form of the metadata of a
+ *            scene for the downstream consumers: a header, then one fixed-size
+ *            record per zone (UUID, bounding box, state, context and top
+ *            predictions), then the optional contours and descriptions the
+ *            records refer to by offset. Messages are written into a reused
+ *            buffer, and read in place without any parsing nor copy. All the
+ *            values are in the host byte order.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+#include "vpp/prediction.hpp"
+#include "vpp/scene.hpp"
+
+namespace VPP {
+namespace Wire {
+
+static constexpr uint32_t MAGIC   = 0x53505056; /* "VPPS" */
+static constexpr uint16_t VERSION = 1;
+
+/* The optional fields of the zones */
+enum Field : uint16_t {
+    CONTOURS     = 1,
+    DESCRIPTIONS = 2
+};
+
+/* The header of a message, whose size includes the header itself */
+struct Header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t fields;
+    uint64_t ts;
+    uint32_t count;
+    uint32_t size;
+};
+
+struct Score {
+    float   score;
+    int16_t dataset;
+    int16_t id;
+};
+
+/* The record of a zone, its contour and description being stored after all
+ * the records, at offsets from the start of the message */
+struct Record {
+    uint64_t uuid;
+    int32_t  x, y, width, height;
+    float    state[Zone::State::length];
+    Score    context;
+    Score    predictions[Predictions::capacity];
+    uint32_t ranked;
+    uint32_t contour;
+    uint32_t points;
+    uint32_t description;
+    uint32_t length;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(Header) == 24, "Wire::Header is not packed");
+static_assert(sizeof(Record) % 8 == 0, "Wire::Record is not 8-byte aligned");
+static_assert(sizeof(cv::Point) == 2 * sizeof(int32_t),
+              "cv::Point is not a pair of 32-bit integers");
+
+class Writer final {
+    public:
+        Writer() noexcept : buffer() {}
+        ~Writer() noexcept = default;
+
+        /* Writing the message of a scene with some optional fields, into the
+         * buffer of the former messages */
+        void write(const Scene &scene, uint16_t fields) noexcept;
+
+        inline const uint8_t *data() const noexcept {
+            return buffer.data();
+        }
+
+        inline std::size_t size() const noexcept {
+            return buffer.size();
+        }
+
+    private:
+        std::vector<uint8_t> buffer;
+};
+
+class Reader final {
+    public:
+        /* A view on the record of a zone within a message */
+        class Zone final {
+            public:
+                inline uint64_t uuid() const noexcept {
+                    return record->uuid;
+                }
+
+                inline cv::Rect bbox() const noexcept {
+                    return cv::Rect(record->x, record->y, record->width,
+                                    record->height);
+                }
+
+                inline const float *state() const noexcept {
+                    return record->state;
+                }
+
+                inline Prediction context() const noexcept {
+                    return convert(record->context);
+                }
+
+                inline int ranked() const noexcept {
+                    return static_cast<int>(record->ranked);
+                }
+
+                inline Prediction prediction(int i) const noexcept {
+                    return convert(record->predictions[i]);
+                }
+
+                /* The contour points, if any */
+                inline int points() const noexcept {
+                    return static_cast<int>(record->points);
+                }
+
+                inline const cv::Point *contour() const noexcept {
+                    return reinterpret_cast<const cv::Point *>(
+                               base + record->contour);
+                }
+
+                /* The description characters, not zero-terminated */
+                inline std::size_t length() const noexcept {
+                    return record->length;
+                }
+
+                inline const char *description() const noexcept {
+                    return reinterpret_cast<const char *>(
+                               base + record->description);
+                }
+
+            private:
+                friend class Reader;
+
+                Zone(const uint8_t *b, const Record *r) noexcept
+                    : base(b), record(r) {}
+
+                static inline Prediction convert(const Score &s) noexcept {
+                    return Prediction(s.score, s.dataset, s.id);
+                }
+
+                const uint8_t *base;
+                const Record  *record;
+        };
+
+        /* Reading a message in place, which must outlive the reader and be
+         * aligned on 8 bytes */
+        Reader(const void *data, std::size_t size) noexcept;
+        ~Reader() noexcept = default;
+
+        /* Whether the message is complete and consistent */
+        inline bool valid() const noexcept {
+            return consistent;
+        }
+
+        /* The header and zones of a message, only when valid */
+        inline uint64_t ts() const noexcept {
+            return header->ts;
+        }
+
+        inline uint16_t fields() const noexcept {
+            return header->fields;
+        }
+
+        inline int size() const noexcept {
+            return consistent ? static_cast<int>(header->count) : 0;
+        }
+
+        inline Zone zone(int i) const noexcept {
+            return Zone(base, records + i);
+        }
+
+    private:
+        const uint8_t *base;
+        const Header  *header;
+        const Record  *records;
+        bool           consistent;
+};
+
+}  // namespace Wire
+}  // namespace VPP
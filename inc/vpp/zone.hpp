@@ -24,11 +24,13 @@
 
 #pragma once
 
+#include <algorithm>
 #include <list>
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc.hpp>
 #include <vector>
 
+#include "vpp/contour.hpp"
 #include "vpp/coordinates.hpp"
 #include "vpp/log.hpp"
 #include "vpp/prediction.hpp"
@@ -84,7 +86,6 @@ class BBox : public cv::Rect {
 class Zone;
 using Zones = std::vector<std::reference_wrapper<Zone>>;
 using ConstZones = std::vector<std::reference_wrapper<const Zone>>;
-using Contour = std::vector<cv::Point>;
 using Contours = std::vector<std::reference_wrapper<Contour>>;
 using ConstContours = std::vector<std::reference_wrapper<const Contour>>;
 
@@ -99,64 +100,49 @@ class Zone final : public BBox {
          *
          *  A Zone measure is composed of a 3d centre point c=(cx, cy, cz)
          *  expressed in meters, a width and an height. It can be accessed
-         *  either as a 5-float raw array, by name or as a matrix 
+         *  either as a 5-float raw array, by name, as a fixed-size vector or
+         *  as a matrix header on its values
          */
        class Measure {
             public:
                 static const int length = 5;
-
-                inline Measure() noexcept 
-                    : centre(), size(), measure(length, 1, CV_32F, &centre.x, 
-                                                cv::Mat::AUTO_STEP) {}
-
-                inline Measure(const Measure &other) noexcept 
-                    : centre(other.centre), size(other.size),
-                      measure(length, 1, CV_32F, &centre.x, 
-                              cv::Mat::AUTO_STEP) {}
-
-                inline Measure(Measure&& other) noexcept 
-                    : centre(std::move(other.centre)),
-                      size(std::move(other.size)),
-                      measure(length, 1, CV_32F, &centre.x, 
-                              cv::Mat::AUTO_STEP) {}
-
-                inline Measure& operator=(const Measure& other) noexcept {
-                    centre = other.centre;
-                    size   = other.size;
-                    measure = cv::Mat(length, 1, CV_32F, &centre.x, 
-                                      cv::Mat::AUTO_STEP);
-                    return *this;
-                }
-
-                inline Measure& operator=(Measure&& other) noexcept {
-                    centre = std::move(other.centre);
-                    size   = std::move(other.size);
-                    measure = cv::Mat(length, 1, CV_32F, &centre.x, 
-                                      cv::Mat::AUTO_STEP);
-                    return *this;
-                }
-                
+                using Vector = cv::Matx<float, length, 1>;
+
+                inline Measure() noexcept : centre(), size() {}
+                inline Measure(const Measure &other) noexcept = default;
+                inline Measure(Measure&& other) noexcept = default;
+                inline Measure& operator=(const Measure& other) noexcept 
+                    = default;
+                inline Measure& operator=(Measure&& other) noexcept = default;
                 inline ~Measure() = default;
 
                 Triplet centre;
                 Couple  size;
 
-                inline operator cv::Mat&() noexcept {
-                    return measure;
+                inline float *data() noexcept {
+                    return &centre.x;
+                }
+
+                inline const float *data() const noexcept {
+                    return &centre.x;
                 }
 
-                inline operator const cv::Mat&() const noexcept {
-                    return measure;
+                inline Vector vector() const noexcept {
+                    return Vector(data());
+                }
+
+                /* A matrix header on the measure values, only for the OpenCV
+                 * APIs requiring a cv::Mat */
+                inline cv::Mat mat() noexcept {
+                    return cv::Mat(length, 1, CV_32F, data(), 
+                                   cv::Mat::AUTO_STEP);
                 }
 
                 inline float &operator[] (int id) noexcept {
                     ASSERT(id < length && id >=0,
                            "Invalid measure index provided %d!", id);
-                    return *(&centre.x+id);
+                    return *(data()+id);
                 }
-
-            private:
-                cv::Mat measure;
         };
 
         /** 
@@ -165,41 +151,21 @@ class Zone final : public BBox {
          *  A Zone state is composed of a 3d centre point c=(c.x, c.y, c.z)
          *  expressed in meters, a width and an height in the same units and a 
          *  speed vector v=(v.x, v.y, v.z) expressed in m/s. It can be accessed
-         *  either as a 8-float raw array, by name or as a matrix.
+         *  either as a 8-float raw array, by name, as a fixed-size vector or as
+         *  a matrix header on its values.
          */
         class State {
             public:
                 static const int length = 8;
+                using Vector = cv::Matx<float, length, 1>;
 
                 /* Constructor and copy constructor */
-                inline State() noexcept 
-                    : centre(), size(), speed(),
-                      state(length, 1, CV_32F, &centre.x, cv::Mat::AUTO_STEP) {}
-
-                inline State(const State &other) noexcept
-                    : centre(other.centre), size(other.size),
-                      speed(other.speed), 
-                      state(length, 1, CV_32F, &centre.x, cv::Mat::AUTO_STEP) {}
-
-                inline State(State &&other) noexcept
-                    : centre(std::move(other.centre)), 
-                      size(std::move(other.size)),
-                      speed(std::move(other.speed)), 
-                      state(length, 1, CV_32F, &centre.x, cv::Mat::AUTO_STEP) {}
-
-                inline State &operator = (const State &other) noexcept {
-                    centre = other.centre;
-                    size   = other.size;
-                    speed  = other.speed;
-                    return *this;
-                }
-
-                inline State &operator = (State &&other) noexcept {
-                    centre = std::move(other.centre);
-                    size   = std::move(other.size);
-                    speed  = std::move(other.speed);
-                    return *this;
-                }
+                inline State() noexcept : centre(), size(), speed() {}
+                inline State(const State &other) noexcept = default;
+                inline State(State &&other) noexcept = default;
+                inline State &operator = (const State &other) noexcept 
+                    = default;
+                inline State &operator = (State &&other) noexcept = default;
 
                 inline State &operator = (const Measure &measure) noexcept {
                     centre = measure.centre;
@@ -208,6 +174,11 @@ class Zone final : public BBox {
                     return *this;
                 }
 
+                inline State &operator = (const Vector &v) noexcept {
+                    std::copy(v.val, v.val + length, data());
+                    return *this;
+                }
+
                 inline ~State() = default;
 
                 /* Geometry and displacement */
@@ -215,12 +186,23 @@ class Zone final : public BBox {
                 Couple   size;
                 Triplet  speed;
 
-                inline operator cv::Mat&() noexcept {
-                    return state;
+                inline float *data() noexcept {
+                    return &centre.x;
+                }
+
+                inline const float *data() const noexcept {
+                    return &centre.x;
+                }
+
+                inline Vector vector() const noexcept {
+                    return Vector(data());
                 }
 
-                inline operator const cv::Mat&() const noexcept {
-                    return state;
+                /* A matrix header on the state values, only for the OpenCV
+                 * APIs requiring a cv::Mat */
+                inline cv::Mat mat() noexcept {
+                    return cv::Mat(length, 1, CV_32F, data(), 
+                                   cv::Mat::AUTO_STEP);
                 }
  
                 inline operator Measure() const noexcept {
@@ -233,22 +215,29 @@ class Zone final : public BBox {
                 inline float &operator[] (int id) noexcept {
                     ASSERT(id < length && id >=0,
                            "Invalid state index provided %d!", id);
-                    return *(&centre.x+id);
+                    return *(data()+id);
                 }
-
-            private:
-                cv::Mat state;
         };
 
+        /* Raw array accesses rely on packed floats */
+        static_assert(sizeof(Measure) == Measure::length * sizeof(float),
+                      "Zone::Measure is not a packed array of floats");
+        static_assert(sizeof(State) == State::length * sizeof(float),
+                      "Zone::State is not a packed array of floats");
+
         /* Universal unique identifier for a zone. Zone which are marked, i.e.
          * have been attached to a scene have a strictly positive UUID */
         uint64_t                uuid;
 
-        /* State is updated when marked if UUID is nil */
+        /* State is updated when marked if UUID is nil, though only flat (in
+         * pixels with an invalid depth) until a consumer of the metric states
+         * deprojects all the flat zones of the scene at once */
         State                   state;
+        bool                    deprojected;
         Contour                 contour;
-        std::list<Prediction>   predictions;
+        Predictions             predictions;
         Prediction              context;
+        Labels                  labels;
         std::string             description;
 
         Zone() noexcept = default;
@@ -268,39 +257,48 @@ class Zone final : public BBox {
             return predict(std::move(pred), 1.0);
         }
         
-        Zone &predict(std::list<Prediction> preds, float recall_f) noexcept;
+        Zone &predict(const Predictions &preds, float recall_f) noexcept;
 
-        inline Zone &predict(std::list<Prediction> preds) noexcept {
-            return predict(std::move(preds), 1.0);
+        inline Zone &predict(const Predictions &preds) noexcept {
+            return predict(preds, 1.0);
         }
 
         /* A handful of specific dedicated constructors */
         Zone(BBox bbox) noexcept : BBox(std::move(bbox)), uuid(0), state(),
-                                   contour(), predictions(), context(),
+                                   deprojected(false), contour(),
+                                   predictions(), context(), labels(),
                                    description() {}
    
         Zone(BBox bbox, Prediction pred) noexcept
-            : BBox(std::move(bbox)), uuid(0), state(), contour(),
-              predictions({ pred }), context(std::move(pred)), description() {}
-
-        Zone(BBox bbox, std::list<Prediction> preds) noexcept
-            : BBox(std::move(bbox)), uuid(0), state(), contour(),
-              description() {
-            predict(std::move(preds));
+            : BBox(std::move(bbox)), uuid(0), state(), deprojected(false),
+              contour(), predictions({ pred }), context(std::move(pred)),
+              labels(), description() {}
+
+        Zone(BBox bbox, const Predictions &preds) noexcept
+            : BBox(std::move(bbox)), uuid(0), state(), deprojected(false),
+              contour(), predictions(), context(), labels(), description() {
+            predict(preds);
         }
 
         Zone(BBox bbox, Contour c) noexcept 
-                : BBox(std::move(bbox)), uuid(0), state(),
+                : BBox(std::move(bbox)), uuid(0), state(), deprojected(false),
                   contour(std::move(c)), predictions(), context(), 
-                  description() {}
+                  labels(), description() {}
 
         Zone(Contour c) noexcept
-                : BBox(std::move(cv::boundingRect(c))), uuid(0), state(),
-                  contour(std::move(c)), predictions(), context(),
-                  description() {}
+                : BBox(std::move(cv::boundingRect(c.mat()))), uuid(0), state(),
+                  deprojected(false), contour(std::move(c)), predictions(),
+                  context(), labels(), description() {}
 
+        /* Updating the zone from its state, and its state from the zone,
+         * either in metres when deprojected in a view with depth, or only
+         * flat otherwise */
         void project(const View &view) noexcept;
         void deproject(const View &view) noexcept;
+        void flatten() noexcept;
+
+        /* Organised point cloud of the zone, for estimating its size */
+        cv::Mat cloud(const View &view) const noexcept;
 
         using Copier = 
             std::function<void (Zone& out, const Zone &in) noexcept>;
@@ -311,18 +309,39 @@ class Zone final : public BBox {
                 static void Geometry(Zone& out, const Zone &in) noexcept;
                 static void AllButContour(Zone& out, const Zone &in) noexcept;
                 static void All(Zone& out, const Zone &in) noexcept;
+
+                /* Copying all, the contours being simplified within epsilon
+                 * pixels for the remembered scenes to hold fewer points */
+                static Copier Simplified(double epsilon) noexcept;
         };
 
         Zone copy(const Copier &copier = Copy::BBoxOnly) const noexcept {
             Zone out(static_cast<cv::Rect>(*this));
-            out.uuid  = uuid;
-            out.state = state;
+            out.uuid        = uuid;
+            out.state       = state;
+            out.deprojected = deprojected;
 
             copier(out, *this);
             /* Relying on copy-elision here */
             return out;
         }
 
+        /* In-place copy, reusing the buffers already owned by out */
+        void copy(Zone &out, 
+                  const Copier &copier = Copy::BBoxOnly) const noexcept {
+            static_cast<cv::Rect &>(out) = *this;
+            out.uuid        = uuid;
+            out.state       = state;
+            out.deprojected = deprojected;
+            out.contour.clear();
+            out.predictions.clear();
+            out.context = Prediction();
+            out.labels.clear();
+            out.description.clear();
+
+            copier(out, *this);
+        }
+
         Zone &update(Zone &older, float recall_f) noexcept;
         inline Zone &update(Zone &older) noexcept {
             return update(older, 1.0);
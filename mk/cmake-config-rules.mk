@@ -120,6 +120,12 @@ CMAKE_OPTIONS+=	-DCODE_FIX=$(CODE_FIX)
 MAKE_OPTIONS+=	CODE_FIX=$(CODE_FIX)
 endif
 
+# Profile-guided optimisation step
+ifdef PGO
+CMAKE_OPTIONS+=	-DPGO=$(PGO)
+MAKE_OPTIONS+=	PGO=$(PGO)
+endif
+
 # Target directories aliases (for faster typing)
 BLD_VER_DIR:=$(BLD_DIR)/$(OS)/$(ABI)/$(BLD)
 OUT_VER_DIR:=$(OUT_DIR)/$(OS)/$(ABI)/$(BLD)
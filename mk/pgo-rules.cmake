@@ -0,0 +1,89 @@
+#
+# This is a portable configuration for the profile-guided optimisation (PGO)
+#
+# The PGO is a three steps workflow within the same build directory:
+#   1. configure with -DPGO=GENERATE and build the instrumented vpp library,
+#      vpp-bench and d-scribe executables;
+#   2. run the pgo-train target, which runs the micro-benchmarks and the
+#      headless d-scribe benchmark on a synthetic input (and on the recording
+#      of PGO_RECORDING if any), the profiles being written in PGO_DIR;
+#   3. configure again with -DPGO=USE and rebuild for the optimised build.
+#
+# This file is part of the VPP framework (see link).
+#
+# Author:   Olivier Stoltz-Douchet <ezdayo@gmail.com>
+#
+# Copyright (c) 2019-2020 Olivier Stoltz-Douchet
+# License:  http://opensource.org/licenses/MIT MIT
+# Link:     https://github.com/ezdayo/vpp
+#
+
+# Options for the profile-guided optimisation
+set(PGO "OFF" CACHE STRING
+    "Profile-guided optimisation step, one of OFF, GENERATE or USE")
+set_property(CACHE PGO PROPERTY STRINGS OFF GENERATE USE)
+set(PGO_DIR "${PROJECT_BINARY_DIR}/pgo" CACHE PATH
+    "Directory of the profiles of the profile-guided optimisation")
+set(PGO_FRAMES 600 CACHE STRING
+    "Number of frames of each d-scribe training run")
+set(PGO_RECORDING "" CACHE FILEPATH
+    "VPP recording replayed by the training, none if empty")
+
+# Clang profiles are raw ones, to be merged before being used
+if(CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+    find_program(LLVM_PROFDATA NAMES llvm-profdata)
+    set(PGO_PROFILE "${PGO_DIR}/vpp.profdata")
+else()
+    set(PGO_PROFILE "${PGO_DIR}")
+endif()
+
+if(PGO STREQUAL "GENERATE")
+    set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -fprofile-generate=${PGO_DIR}")
+
+    # The training configurations of d-scribe
+    include(mk/configure-file-rules.cmake)
+    set(PGO_PROTOCOL "vpp/synthetic")
+    set(PGO_SOURCE "${PGO_FRAMES}")
+    configure_this_file(pgo-synthetic ${PROJECT_BINARY_DIR})
+    set(PGO_TRAINING COMMAND d-scribe --bench=${PGO_FRAMES}
+                             ${PROJECT_BINARY_DIR}/pgo-synthetic)
+
+    if(NOT PGO_RECORDING STREQUAL "")
+        set(PGO_PROTOCOL "vpp/file")
+        set(PGO_SOURCE "${PGO_RECORDING}")
+        configure_this_file(pgo-recording ${PROJECT_BINARY_DIR})
+        set(PGO_TRAINING ${PGO_TRAINING}
+                         COMMAND d-scribe --bench=${PGO_FRAMES}
+                                 ${PROJECT_BINARY_DIR}/pgo-recording)
+    endif()
+
+    if(CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+        set(PGO_MERGE "${LLVM_PROFDATA} merge -output=${PGO_PROFILE}")
+        set(PGO_TRAINING ${PGO_TRAINING}
+                         COMMAND sh -c "${PGO_MERGE} ${PGO_DIR}/*.profraw")
+    endif()
+
+    # Add a specific training target
+    add_custom_target(pgo-train
+            COMMAND vpp-bench --min-time=0.05
+            ${PGO_TRAINING}
+            WORKING_DIRECTORY ${PROJECT_SOURCE_DIR}/etc
+            COMMENT "Training the profile-guided optimisation"
+            VERBATIM)
+    add_dependencies(pgo-train vpp-bench d-scribe)
+
+elseif(PGO STREQUAL "USE")
+    if(NOT EXISTS "${PGO_PROFILE}")
+        message(FATAL_ERROR "Cannot find the PGO profile ${PGO_PROFILE}: "
+                            "build with -DPGO=GENERATE and run pgo-train!")
+    endif()
+
+    # Multi-threaded training runs leave slightly inconsistent counters, and
+    # the sources not run by the training have no profile
+    set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -fprofile-use=${PGO_PROFILE}")
+    enable_cxx_compiler_flag_if_supported(-fprofile-correction)
+    enable_cxx_compiler_flag_if_supported(-Wno-missing-profile)
+
+elseif(NOT PGO STREQUAL "OFF")
+    message(FATAL_ERROR "Unknown PGO step ${PGO}, use one of OFF|GENERATE|USE.")
+endif()
@@ -0,0 +1,165 @@
+/**
+ *
+ * @file      bench/dnn.cpp
+ *
+ * @brief     These are the VPP DNN precision micro-benchmarks
+ *
+ * @details   The inferences are timed at every precision, each reduced
+ *            precision output being first validated against the FP32 one. The
+ *            network is the one of the VPP_BENCH_MODEL weights file (and of
+ *            the VPP_BENCH_CONFIG architecture file if any) when defined, and
+ *            a synthetic convolutional one otherwise.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <cstdio>
+#include <cstdlib>
+#include <opencv2/dnn.hpp>
+#include <string>
+#include <vector>
+
+#include "bench/harness.hpp"
+#include "vpp/dnn/ocv.hpp"
+#include "vpp/dnn/setup.hpp"
+
+using VPP::DNN::Network;
+using Precision = VPP::DNN::Setup::Precision;
+
+namespace {
+
+constexpr int side = 224;
+
+/* Four 3x3 convolutions of 16 channels with random weights */
+cv::dnn::Net synthetic() {
+    cv::dnn::Net net;
+    cv::RNG rng(1);
+    int channels = 3;
+    for (int i = 0; i < 4; ++i) {
+        int shape[] = { 16, channels, 3, 3 };
+        cv::Mat weights(4, shape, CV_32F), bias(1, 16, CV_32F);
+        rng.fill(weights, cv::RNG::UNIFORM, cv::Scalar(-0.2), cv::Scalar(0.2));
+        rng.fill(bias, cv::RNG::UNIFORM, cv::Scalar(-0.1), cv::Scalar(0.1));
+
+        cv::dnn::LayerParams conv;
+        conv.set("kernel_size", 3);
+        conv.set("pad", 1);
+        conv.set("num_output", 16);
+        conv.set("bias_term", true);
+        conv.blobs = { weights, bias };
+        net.addLayerToPrev("conv" + std::to_string(i), "Convolution", conv);
+
+        cv::dnn::LayerParams relu;
+        net.addLayerToPrev("relu" + std::to_string(i), "ReLU", relu);
+        channels = 16;
+    }
+    return net;
+}
+
+cv::dnn::Net network() {
+    auto model  = std::getenv("VPP_BENCH_MODEL");
+    auto config = std::getenv("VPP_BENCH_CONFIG");
+    if (model == nullptr) {
+        return synthetic();
+    }
+    return cv::dnn::readNet(model, (config != nullptr) ? config : "", "");
+}
+
+/* Preparing a network for inferring at a precision, as the engines do */
+bool prepare(cv::dnn::Net &net, int precision,
+             const std::vector<cv::Mat> &calibration) {
+    if (precision == static_cast<int>(Precision::INT8)) {
+        if (!Network::quantise(net, calibration)) {
+            return false;
+        }
+        net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+        return true;
+    }
+
+    /* OpenCV falls back to the CPU if there is no OpenCL device */
+    auto target = (precision == static_cast<int>(Precision::FP16)) ?
+                        cv::dnn::DNN_TARGET_OPENCL : cv::dnn::DNN_TARGET_CPU;
+    net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+    net.setPreferableTarget(Network::precise(target, precision));
+    return true;
+}
+
+cv::Mat infer(cv::dnn::Net &net, const cv::Mat &blob) {
+    net.setInput(blob);
+    return net.forward().clone();
+}
+
+/* The blobs have more than 2 dimensions, so they are flattened for their
+ * maximum to be located */
+cv::Mat flat(const cv::Mat &blob) {
+    return cv::Mat(1, static_cast<int>(blob.total()), CV_32F,
+                   const_cast<float *>(blob.ptr<float>()));
+}
+
+/* Inferring at the precision of the argument, i.e. 0 for FP32, 1 for FP16 and
+ * 2 for INT8, the output deviation from the FP32 one being reported once */
+void dnn_precision(Bench::State &state) {
+    static bool reported[3] = { false, false, false };
+    const int precision = state.arg(0);
+
+    std::vector<cv::Mat> calibration;
+    for (int i = 0; i < 8; ++i) {
+        calibration.emplace_back(cv::dnn::blobFromImage(
+            Bench::Synthetic::frame(side, side, i + 1), 1.0 / 255.0,
+            cv::Size(side, side)));
+    }
+    auto blob = cv::dnn::blobFromImage(Bench::Synthetic::frame(side, side),
+                                       1.0 / 255.0, cv::Size(side, side));
+
+    cv::dnn::Net net;
+    try {
+        auto reference = network();
+        prepare(reference, static_cast<int>(Precision::FP32), calibration);
+        auto expected = infer(reference, blob);
+
+        net = network();
+        if (!prepare(net, precision, calibration)) {
+            net = reference;
+        }
+        auto output = infer(net, blob);
+
+        if (!reported[precision]) {
+            reported[precision] = true;
+            double largest = cv::norm(expected, output, cv::NORM_INF);
+            double scale   = cv::norm(expected, cv::NORM_L2);
+            double error   = cv::norm(expected, output, cv::NORM_L2) /
+                             ((scale > 0) ? scale : 1.0);
+            cv::Point top, got;
+            cv::minMaxLoc(flat(expected), nullptr, nullptr, nullptr, &top);
+            cv::minMaxLoc(flat(output), nullptr, nullptr, nullptr, &got);
+            std::fprintf(stderr, "dnn_precision/%d: max deviation %g, "
+                         "relative L2 error %g, top-1 %s\n", precision,
+                         largest, error, (top == got) ? "kept" : "changed");
+        }
+    } catch (const cv::Exception &e) {
+        if (!reported[precision]) {
+            reported[precision] = true;
+            std::fprintf(stderr, "dnn_precision/%d: %s\n", precision,
+                         e.what());
+        }
+        return;
+    }
+
+    while (state.running()) {
+        net.setInput(blob);
+        Bench::keep(net.forward());
+    }
+    state.items(side * side);
+}
+
+}  // namespace
+
+BENCH(dnn_precision).counts({ 0, 1, 2 });
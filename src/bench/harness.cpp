@@ -0,0 +1,250 @@
+/**
+ *
+ * @file      bench/harness.cpp
+ *
+ * @brief     This is the VPP micro-benchmark harness implementation file
+ *
+ * @details   This is the entry point of the vpp-bench executable, which runs
+ *            all the registered micro-benchmarks, or only the ones whose name
+ *            contains the --filter=<text> argument, for at least the number of
+ *            seconds of the --min-time=<s> argument per run. The results are
+ *            printed as a table, or as CSV lines with the --csv argument for
+ *            plotting them or comparing them with former results, with the
+ *            heap allocations per iteration when the VPP counts them.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <opencv2/imgproc.hpp>
+
+#include "bench/harness.hpp"
+
+namespace Bench {
+
+State::State(const std::vector<int> &args, uint64_t iterations) noexcept
+    : arguments(args), wanted(iterations), done(0), processed(0), began(),
+      ended(), paused(), excluded(Clock::duration::zero()),
+      before{ 0, 0 }, halted{ 0, 0 }, spent{ 0, 0 }, skipped{ 0, 0 } {}
+
+uint64_t State::iterations() const noexcept {
+    return wanted;
+}
+
+Clock::duration State::elapsed() const noexcept {
+    return (ended - began) - excluded;
+}
+
+Util::Allocation::Counters State::allocated() const noexcept {
+    return Util::Allocation::Counters{ spent.allocations - skipped.allocations,
+                                       spent.bytes - skipped.bytes };
+}
+
+Case::Case(std::string n, Function f) noexcept
+    : name(std::move(n)), function(std::move(f)), runs() {}
+
+Case &Case::with(std::vector<int> args) noexcept {
+    runs.emplace_back(std::move(args));
+    return *this;
+}
+
+Case &Case::resolutions() noexcept {
+    return with({ 320, 240 }).with({ 640, 480 }).with({ 1280, 720 })
+          .with({ 1920, 1080 });
+}
+
+Case &Case::counts(const std::vector<int> &ns) noexcept {
+    for (auto n : ns) {
+        with({ n });
+    }
+    return *this;
+}
+
+Registry::Registry() noexcept : cases() {}
+
+Registry &Registry::instance() noexcept {
+    static Registry registry;
+    return registry;
+}
+
+Case &Registry::add(std::string name, Function f) noexcept {
+    cases.emplace_back(new Case(std::move(name), std::move(f)));
+    return *cases.back();
+}
+
+int Registry::run(const std::string &filter, Clock::duration minimal,
+                  bool csv) noexcept {
+    /* The allocations per iteration are only reported when tracked */
+    const bool heap = Util::Allocation::tracked();
+    if (csv) {
+        std::printf("name,iterations,ns_per_iteration,items_per_second%s\n",
+                    heap ? ",allocations_per_iteration,bytes_per_iteration" :
+                           "");
+    } else {
+        std::printf("%-40s %12s %16s %16s", "Benchmark", "Iterations",
+                    "ns/iteration", "items/s");
+        if (heap) {
+            std::printf(" %14s %14s", "allocs/iter", "bytes/iter");
+        }
+        std::printf("\n");
+    }
+
+    int ran = 0;
+    for (auto &c : cases) {
+        if (c->name.find(filter) == std::string::npos) {
+            continue;
+        }
+
+        /* Cases without any argument are run once without them */
+        auto runs = c->runs;
+        if (runs.empty()) {
+            runs.emplace_back();
+        }
+
+        for (auto &args : runs) {
+            std::string label(c->name);
+            for (auto a : args) {
+                label += "/" + std::to_string(a);
+            }
+
+            /* Doubling the iterations until the run lasts long enough */
+            uint64_t         iterations = 1;
+            Clock::duration            elapsed;
+            uint64_t                   items;
+            Util::Allocation::Counters allocated;
+            while (true) {
+                State state(args, iterations);
+                c->function(state);
+                elapsed   = state.elapsed();
+                items     = state.items();
+                allocated = state.allocated();
+                if ((elapsed >= minimal) || (iterations >= (1ULL << 30))) {
+                    break;
+                }
+                iterations *= 2;
+            }
+
+            auto ns = std::chrono::duration<double, std::nano>(elapsed)
+                          .count() / iterations;
+            auto throughput = (ns > 0) ? items * 1e9 / ns : 0.0;
+            auto allocs = static_cast<double>(allocated.allocations) /
+                          iterations;
+            auto bytes  = static_cast<double>(allocated.bytes) / iterations;
+            if (csv) {
+                std::printf("%s,%llu,%.1f,%.1f", label.c_str(),
+                            static_cast<unsigned long long>(iterations), ns,
+                            throughput);
+                if (heap) {
+                    std::printf(",%.2f,%.1f", allocs, bytes);
+                }
+            } else {
+                std::printf("%-40s %12llu %16.1f %16.1f", label.c_str(),
+                            static_cast<unsigned long long>(iterations), ns,
+                            throughput);
+                if (heap) {
+                    std::printf(" %14.2f %14.1f", allocs, bytes);
+                }
+            }
+            std::printf("\n");
+            std::fflush(stdout);
+            ++ran;
+        }
+    }
+
+    return ran;
+}
+
+namespace Synthetic {
+
+cv::Mat frame(int width, int height, uint64_t seed) noexcept {
+    cv::RNG rng(seed + 1);
+    cv::Mat bgr(height, width, CV_8UC3);
+    rng.fill(bgr, cv::RNG::UNIFORM, cv::Scalar::all(0),
+             cv::Scalar::all(256));
+
+    /* Some blur gives a texture closer to the one of an actual frame */
+    cv::GaussianBlur(bgr, bgr, cv::Size(5, 5), 0);
+    return bgr;
+}
+
+cv::Mat depth(int width, int height, uint64_t seed) noexcept {
+    cv::RNG rng(seed + 1);
+    cv::Mat d(height, width, CV_16UC1);
+    rng.fill(d, cv::RNG::UNIFORM, cv::Scalar(500), cv::Scalar(5000));
+
+    /* One pixel out of 16 has no valid depth */
+    cv::Mat holes(height, width, CV_8UC1);
+    rng.fill(holes, cv::RNG::UNIFORM, cv::Scalar(0), cv::Scalar(16));
+    d.setTo(0, holes == 0);
+    return d;
+}
+
+std::vector<cv::Rect> boxes(int count, const cv::Size &frame,
+                            uint64_t seed) noexcept {
+    cv::RNG rng(seed + 1);
+    std::vector<cv::Rect> rs;
+    rs.reserve(count);
+
+    /* The zones are from 4% to 20% of the frame size */
+    for (int i = 0; i < count; ++i) {
+        auto w = std::max(1, frame.width  * rng.uniform(4, 20) / 100);
+        auto h = std::max(1, frame.height * rng.uniform(4, 20) / 100);
+        auto x = rng.uniform(0, std::max(1, frame.width - w));
+        auto y = rng.uniform(0, std::max(1, frame.height - h));
+        rs.emplace_back(x, y, w, h);
+    }
+    return rs;
+}
+
+void scene(VPP::Scene &scene, int width, int height, int zones,
+           uint64_t seed) noexcept {
+    scene.clear();
+    scene.view.use(frame(width, height, seed), VPP::Image::Mode::BGR);
+    for (auto &b : boxes(zones, cv::Size(width, height), seed)) {
+        scene.mark(b);
+    }
+}
+
+}  // namespace Synthetic
+
+}  // namespace Bench
+
+int main(int argc, char **argv) {
+    std::string filter;
+    double      seconds = 0.2;
+    bool        csv     = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--filter=", 9) == 0) {
+            filter = argv[i] + 9;
+        } else if (std::strncmp(argv[i], "--min-time=", 11) == 0) {
+            seconds = std::atof(argv[i] + 11);
+        } else if (std::strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        } else {
+            std::fprintf(stderr, "Usage: %s [--filter=<text>] "
+                         "[--min-time=<seconds>] [--csv]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    auto minimal = std::chrono::duration_cast<Bench::Clock::duration>(
+                        std::chrono::duration<double>(seconds));
+    auto ran = Bench::Registry::instance().run(filter, minimal, csv);
+    if (ran == 0) {
+        std::fprintf(stderr, "No benchmark matches '%s'!\n", filter.c_str());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+/**
+ *
+ * @file      bench/matcher.cpp
+ *
+ * @brief     These are the VPP matcher micro-benchmarks
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "bench/harness.hpp"
+#include "vpp/scene.hpp"
+#include "vpp/task/matcher.hpp"
+
+using VPP::Scene;
+using VPP::Zone;
+using VPP::Zones;
+using VPP::Task::Matcher::Measures;
+
+namespace Estimator = VPP::Task::Matcher::Estimator;
+
+namespace {
+
+/* Dense measurements of a given size, as an estimator would leave them */
+class Dense : public Measures {
+    public:
+        Dense(int sources, int destinations) noexcept : Measures() {
+            cv::RNG rng(1);
+            measurements.create(sources, destinations, CV_32F);
+            rng.fill(measurements, cv::RNG::UNIFORM, cv::Scalar(0.0f),
+                     cv::Scalar(1.0f));
+        }
+};
+
+template <Measures::Assignment A> void extract(Bench::State &state) {
+    const int n = state.arg(0);
+    Dense measures(n, n);
+    while (state.running()) {
+        auto matches = measures.extract(0.5f, true, true, A);
+        Bench::keep(matches);
+    }
+    state.items(n * n);
+}
+
+void measures_extract_greedy(Bench::State &state) {
+    extract<Measures::Assignment::GREEDY>(state);
+}
+
+void measures_extract_hungarian(Bench::State &state) {
+    extract<Measures::Assignment::HUNGARIAN>(state);
+}
+
+void measures_extract_auction(Bench::State &state) {
+    extract<Measures::Assignment::AUCTION>(state);
+}
+
+/* Estimating the IoU of all the pairs of zones of a scene */
+using Any = Estimator::Any<Zones &, Zones &>;
+
+template <Any::Granularity G> void estimate(Bench::State &state) {
+    const int n = state.arg(0);
+    Scene scene;
+    Bench::Synthetic::scene(scene, 1280, 720, n);
+    auto zones = scene.zones();
+
+    Any any;
+    any.granularity = static_cast<int>(G);
+    auto kernel = Estimator::kernel<Zones &, Zones &>(
+                      [](Zone &s, Zone &d) noexcept { return s.iou(d); });
+
+    cv::Mat results;
+    while (state.running()) {
+        any.start(zones, zones, results, kernel);
+        any.wait();
+        Bench::keep(results);
+    }
+    state.items(n * n);
+}
+
+void estimator_measure(Bench::State &state) {
+    estimate<Any::Granularity::MEASURE>(state);
+}
+
+void estimator_row(Bench::State &state) {
+    estimate<Any::Granularity::ROW>(state);
+}
+
+void estimator_global(Bench::State &state) {
+    estimate<Any::Granularity::GLOBAL>(state);
+}
+
+void estimator_auto(Bench::State &state) {
+    estimate<Any::Granularity::AUTO>(state);
+}
+
+}  // namespace
+
+BENCH(measures_extract_greedy).counts({ 16, 64, 256 });
+BENCH(measures_extract_hungarian).counts({ 16, 64, 256 });
+BENCH(measures_extract_auction).counts({ 16, 64, 256 });
+BENCH(estimator_measure).counts({ 16, 64, 256 });
+BENCH(estimator_row).counts({ 16, 64, 256 });
+BENCH(estimator_global).counts({ 16, 64, 256 });
+BENCH(estimator_auto).counts({ 16, 64, 256 });
@@ -0,0 +1,126 @@
+/**
+ *
+ * @file      bench/tasks.cpp
+ *
+ * @brief     These are the VPP task, engine and bridge micro-benchmarks
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "bench/harness.hpp"
+#include "vpp/engine/blur.hpp"
+#include "vpp/engine/bridge.hpp"
+#include "vpp/scene.hpp"
+#include "vpp/task/clustering.hpp"
+#include "vpp/util/task.hpp"
+
+using VPP::Scene;
+using VPP::Task::Clustering::DilateAndJoin;
+
+namespace {
+
+/* Starting and waiting for an empty task, i.e. the overhead of a task */
+template <int M> void task(Bench::State &state) {
+    Util::Task::Core core(M);
+    while (state.running()) {
+        core.start([]() noexcept { return 0; });
+        Bench::keep(core.wait());
+    }
+    state.items(1);
+}
+
+void task_sync(Bench::State &state) {
+    task<Util::Task::Core::Mode::Sync>(state);
+}
+
+void task_lazy(Bench::State &state) {
+    task<Util::Task::Core::Mode::Lazy>(state);
+}
+
+void task_async(Bench::State &state) {
+    task<Util::Task::Core::Mode::Async>(state);
+}
+
+/* Joining the dilated zones of a scene, the scene being restored out of the
+ * timing between the iterations */
+void dilate_and_join(Bench::State &state, DilateAndJoin::Joining joining) {
+    const int n = state.arg(0);
+    Scene origin;
+    Bench::Synthetic::scene(origin, 1280, 720, n);
+
+    DilateAndJoin clustering(DilateAndJoin::Mode::Sync);
+    clustering.ratio   = 0.1f;
+    clustering.joining = static_cast<int>(joining);
+
+    Scene scene;
+    while (state.running()) {
+        state.pause();
+        scene.clear();
+        origin.remember(scene);
+        state.resume();
+
+        clustering.process(scene);
+    }
+    state.items(n);
+}
+
+void dilate_and_join_pairwise(Bench::State &state) {
+    dilate_and_join(state, DilateAndJoin::Joining::PAIRWISE);
+}
+
+void dilate_and_join_sweep(Bench::State &state) {
+    dilate_and_join(state, DilateAndJoin::Joining::SWEEP);
+}
+
+/* Estimating the sharpness of a fresh view, its gray image included */
+void blur_skipping(Bench::State &state) {
+    auto frame = Bench::Synthetic::frame(state.arg(0), state.arg(1));
+    VPP::Engine::Blur::Skipping blur;
+    while (state.running()) {
+        state.pause();
+        Scene scene;
+        scene.view.use(frame, VPP::Image::Mode::BGR);
+        state.resume();
+
+        Bench::keep(blur.process(scene));
+    }
+    state.items(state.arg(0) * state.arg(1));
+}
+
+/* Forwarding a scene through a bridge and preparing it on the other side */
+void bridge_forward_prepare(Bench::State &state) {
+    const int n = state.arg(0);
+    Scene origin;
+    Bench::Synthetic::scene(origin, 1280, 720, n);
+
+    VPP::Engine::BridgeSlots slots;
+    slots.reset(4);
+    while (state.running()) {
+        state.pause();
+        Scene scene;
+        origin.remember(scene);
+        state.resume();
+
+        slots.forward(std::move(scene),
+                      VPP::Engine::BridgeSlots::Policy::DROP_OLDEST);
+        Bench::keep(slots.next());
+    }
+    state.items(n);
+}
+
+}  // namespace
+
+BENCH(task_sync);
+BENCH(task_lazy);
+BENCH(task_async);
+BENCH(dilate_and_join_pairwise).counts({ 16, 64, 256 });
+BENCH(dilate_and_join_sweep).counts({ 16, 64, 256, 1024 });
+BENCH(blur_skipping).resolutions();
+BENCH(bridge_forward_prepare).counts({ 0, 16, 256 });
@@ -0,0 +1,124 @@
+/**
+ *
+ * @file      bench/tracker.cpp
+ *
+ * @brief     These are the VPP tracker micro-benchmarks
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "bench/harness.hpp"
+#include "vpp/scene.hpp"
+#include "vpp/tracker/histogram.hpp"
+#include "vpp/tracker/kalman.hpp"
+
+using VPP::Scene;
+using VPP::Zone;
+
+namespace Histogram = VPP::Tracker::Histogram;
+namespace Kalman = VPP::Tracker::Kalman;
+
+namespace {
+
+/* Predicting and correcting the Kalman filters of all the zones of a scene,
+ * with either the batched backend or the generic OpenCV Kalman filter */
+void kalman(Bench::State &state, bool batched, bool correcting) {
+    const int n = state.arg(0);
+    Scene scene;
+    Bench::Synthetic::scene(scene, 1280, 720, n);
+    auto zones = scene.zones();
+
+    Kalman::Engine engine(Zone::Copy::BBoxOnly);
+    engine.batched = batched;
+    engine.setup();
+    engine.prepare(zones);
+    auto contexts = engine.contexts();
+
+    while (state.running()) {
+        engine.predict(scene.view, 0.033f, contexts);
+        if (correcting) {
+            for (auto &c : contexts) {
+                auto &context = c.get();
+                context.shadow(*context.original);
+            }
+            engine.correct(contexts);
+        }
+    }
+    state.items(n);
+}
+
+void kalman_predict(Bench::State &state) {
+    kalman(state, true, false);
+}
+
+void kalman_predict_correct(Bench::State &state) {
+    kalman(state, true, true);
+}
+
+void kalman_predict_correct_ocv(Bench::State &state) {
+    kalman(state, false, true);
+}
+
+/* Camshifting the histograms of the zones of a scene in the next view, with
+ * the bin index image shared or not by the back projections */
+void histogram(Bench::State &state, bool shared) {
+    const int n = state.arg(2);
+    Scene scene;
+    Bench::Synthetic::scene(scene, state.arg(0), state.arg(1), n);
+    auto zones = scene.zones();
+
+    Histogram::Engine engine(Zone::Copy::Geometry, 3);
+    engine.shared = shared;
+    engine.setup();
+    scene.view.cache(engine.mode());
+    engine.quantise(scene.view);
+    engine.prepare(zones);
+    auto contexts = engine.contexts();
+    for (auto &c : contexts) {
+        c.get().initialise(scene.view);
+    }
+
+    cv::TermCriteria term(cv::TermCriteria::EPS | cv::TermCriteria::COUNT,
+                          10, 1);
+    auto next = Bench::Synthetic::frame(state.arg(0), state.arg(1), 1);
+    while (state.running()) {
+        state.pause();
+        VPP::View view;
+        view.use(next, VPP::Image::Mode::BGR);
+        state.resume();
+
+        view.cache(engine.mode());
+        engine.quantise(view);
+        for (auto &c : contexts) {
+            c.get().camshift(view, term, 0.4f);
+        }
+    }
+    state.items(n);
+}
+
+void histogram_camshift(Bench::State &state) {
+    histogram(state, true);
+}
+
+void histogram_camshift_unshared(Bench::State &state) {
+    histogram(state, false);
+}
+
+}  // namespace
+
+BENCH(kalman_predict).counts({ 16, 64, 256, 1024 });
+BENCH(kalman_predict_correct).counts({ 16, 64, 256, 1024 });
+BENCH(kalman_predict_correct_ocv).counts({ 16, 64, 256, 1024 });
+BENCH(histogram_camshift).with({ 640, 480, 16 }).with({ 640, 480, 64 })
+                         .with({ 1280, 720, 16 }).with({ 1280, 720, 64 });
+BENCH(histogram_camshift_unshared).with({ 640, 480, 16 })
+                                  .with({ 640, 480, 64 })
+                                  .with({ 1280, 720, 16 })
+                                  .with({ 1280, 720, 64 });
@@ -0,0 +1,195 @@
+/**
+ *
+ * @file      bench/view.cpp
+ *
+ * @brief     These are the VPP image, view and scene micro-benchmarks
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "bench/harness.hpp"
+#include "vpp/image.hpp"
+#include "vpp/projection.hpp"
+#include "vpp/scene.hpp"
+#include "vpp/view.hpp"
+
+using VPP::Image;
+using VPP::Scene;
+using VPP::View;
+
+namespace {
+
+/* A pinhole camera of a 60 degrees horizontal field of view */
+class Pinhole : public VPP::Projecter {
+    public:
+        Pinhole(int width, int height) noexcept
+            : VPP::Projecter(), f(width * 0.866f), cx(width * 0.5f),
+              cy(height * 0.5f) {
+            zscale = 0.001f;
+        }
+
+        cv::Point project(const cv::Point3f &p) const noexcept override {
+            return cv::Point(static_cast<int>(cx + f * p.x / p.z),
+                             static_cast<int>(cy + f * p.y / p.z));
+        }
+
+        cv::Point3f deproject(const cv::Point &p,
+                              float z) const noexcept override {
+            return cv::Point3f((p.x - cx) * z / f, (p.y - cy) * z / f, z);
+        }
+
+    private:
+        float f, cx, cy;
+};
+
+template <int M> void image_to(Bench::State &state) {
+    Image bgr(Bench::Synthetic::frame(state.arg(0), state.arg(1)),
+              Image::Mode::BGR);
+    while (state.running()) {
+        auto converted = bgr.to(M);
+        Bench::keep(converted);
+    }
+    state.items(state.arg(0) * state.arg(1));
+}
+
+void image_to_gray(Bench::State &state) {
+    image_to<Image::Mode::GRAY>(state);
+}
+
+void image_to_hsv(Bench::State &state) {
+    image_to<Image::Mode::HSV>(state);
+}
+
+void image_to_half_gray(Bench::State &state) {
+    Image bgr(Bench::Synthetic::frame(state.arg(0), state.arg(1)),
+              Image::Mode::BGR);
+    while (state.running()) {
+        auto converted = bgr.to(Image::Mode::GRAY, 0.5f);
+        Bench::keep(converted);
+    }
+    state.items(state.arg(0) * state.arg(1));
+}
+
+/* Caching a mode in a fresh view of the frame, as every stage does it */
+void view_cache_gray(Bench::State &state) {
+    auto frame = Bench::Synthetic::frame(state.arg(0), state.arg(1));
+    while (state.running()) {
+        View view;
+        view.use(frame, Image::Mode::BGR);
+        Bench::keep(view.cache(Image::Mode::GRAY));
+    }
+    state.items(state.arg(0) * state.arg(1));
+}
+
+/* Caching all the modes in a loop or prefetching them at once */
+void view_cache_all(Bench::State &state) {
+    auto frame = Bench::Synthetic::frame(state.arg(0), state.arg(1));
+    while (state.running()) {
+        View view;
+        view.use(frame, Image::Mode::BGR);
+        Bench::keep(view.cache(Image::Mode::GRAY));
+        Bench::keep(view.cache(Image::Mode::HSV));
+        Bench::keep(view.cache(Image::Mode::YUV));
+    }
+    state.items(state.arg(0) * state.arg(1));
+}
+
+void view_prefetch_all(Bench::State &state) {
+    auto frame = Bench::Synthetic::frame(state.arg(0), state.arg(1));
+    while (state.running()) {
+        View view;
+        view.use(frame, Image::Mode::BGR);
+        view.prefetch({ Image::Mode::GRAY, Image::Mode::HSV,
+                        Image::Mode::YUV });
+        Bench::keep(view);
+    }
+    state.items(state.arg(0) * state.arg(1));
+}
+
+/* The depth of a zone count of points and of areas in a VGA depth map */
+void depth_at_point(Bench::State &state) {
+    const int n = state.arg(0);
+    Pinhole camera(640, 480);
+    View view;
+    view.use(Bench::Synthetic::depth(640, 480), Image::Mode::DEPTH16, camera);
+
+    std::vector<cv::Point> points;
+    for (auto &b : Bench::Synthetic::boxes(n, cv::Size(640, 480))) {
+        points.emplace_back(b.x + b.width / 2, b.y + b.height / 2);
+    }
+
+    while (state.running()) {
+        float sum = 0.0f;
+        for (auto &p : points) {
+            sum += view.depth.at(p);
+        }
+        Bench::keep(sum);
+    }
+    state.items(n);
+}
+
+void depth_at_area(Bench::State &state) {
+    const int n = state.arg(0);
+    Pinhole camera(640, 480);
+    View view;
+    view.use(Bench::Synthetic::depth(640, 480), Image::Mode::DEPTH16, camera);
+
+    /* The integral images are built on the first call, out of the loop */
+    auto areas = Bench::Synthetic::boxes(n, cv::Size(640, 480));
+    Bench::keep(view.depth.at(areas.front()));
+
+    while (state.running()) {
+        float sum = 0.0f;
+        for (auto &a : areas) {
+            sum += view.depth.at(a);
+        }
+        Bench::keep(sum);
+    }
+    state.items(n);
+}
+
+/* Marking the zones of a cleared scene, the zone nodes being kept as spares
+ * from one iteration to the next as in the steady state of a pipeline */
+void scene_mark(Bench::State &state) {
+    const int n = state.arg(0);
+    auto boxes = Bench::Synthetic::boxes(n, cv::Size(1280, 720));
+    Scene scene;
+    while (state.running()) {
+        scene.clear();
+        for (auto &b : boxes) {
+            Bench::keep(scene.mark(b));
+        }
+    }
+    state.items(n);
+}
+
+void scene_zones(Bench::State &state) {
+    const int n = state.arg(0);
+    Scene scene;
+    Bench::Synthetic::scene(scene, 1280, 720, n);
+    while (state.running()) {
+        auto zones = scene.zones();
+        Bench::keep(zones);
+    }
+    state.items(n);
+}
+
+}  // namespace
+
+BENCH(image_to_gray).resolutions();
+BENCH(image_to_hsv).resolutions();
+BENCH(image_to_half_gray).resolutions();
+BENCH(view_cache_gray).resolutions();
+BENCH(view_cache_all).resolutions();
+BENCH(view_prefetch_all).resolutions();
+BENCH(depth_at_point).counts({ 16, 256, 4096 });
+BENCH(depth_at_area).counts({ 16, 256, 4096 });
+BENCH(scene_mark).counts({ 16, 64, 256, 1024 });
+BENCH(scene_zones).counts({ 16, 64, 256, 1024 });
@@ -8,7 +8,10 @@
  *            D-Scribe example. It uses the CLI capabilities of the
  *            Customisation framework and provides two visualisation windows
  *            (one after the detection pipeline and the other after the
- *            classification pipeline).
+ *            classification pipeline), or runs headless for benchmarking
+ *            both pipelines on the configured source, possibly sweeping a
+ *            grid of settings for their accuracy and latency trade-offs, or
+ *            serves several streams of both pipelines in a single process.
  *
  *            This file is part of the VPP framework (see link).
  *
@@ -20,28 +23,54 @@
  *
  **/
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <mutex>
 #include <opencv2/core.hpp>
 #include <opencv2/core/utils/logger.hpp>
 #include <opencv2/opencv.hpp>
 #include <opencv2/highgui.hpp>
+#include <sys/resource.h>
 #include <unistd.h>
 
 #include "customisation.hpp"
 #include "dscribe/pipeline.hpp"
+#include "dscribe/reload.hpp"
+#include "dscribe/sweep.hpp"
+#include "vpp/dnn/dataset.hpp"
 #include "vpp/log.hpp"
+#include "vpp/util/metrics.hpp"
 
 using VPP::Scene;
 using VPP::Zone;
+using VPP::Engine::Overlay::Frame;
 using VPP::Engine::Overlay::ZoneStyle;
 
-static void onScene(const Scene &scn, int error) {
+/* The displayed scenes are copied in the detection context, and rendered and
+ * displayed in a dispatcher thread so that the detection never waits for the
+ * display */
+static Frame onScene(const VPP::Engine::Overlay::ForScene &overlay,
+                     const Scene &scn, int error) noexcept {
     if (error) {
         LOGE("OOOPS! Error %d on scene '%08lx'! This shall never happen...",
              error, scn.ts_ms());
-    } else {
-        cv::imshow("detection", 
-                   scn.view.cached(VPP::Image::Mode::BGR)->output());
+        return Frame();
+    }
+
+    return overlay.capture(scn);
+}
+
+static void onDisplay(const VPP::Engine::Overlay::ForScene &overlay,
+                      Frame &frame) noexcept {
+    overlay.render(frame);
+    if (!frame.image.empty()) {
+        cv::imshow("detection", frame.image);
         cv::waitKey(1);
     }
 }
@@ -50,7 +79,7 @@ static void onZone(DScribe::Core &dscribe,
                    const Scene &scn, const Zone &z, int error) {
     if (error) {
         LOGE("OOOPS! Error %d on zone '%s'! This shall never happen...",
-             error, z.description.c_str());
+             error, VPP::DNN::Dataset::text(z).c_str());
     } else {
         if (dscribe.classification.input.bridge.empty()) {
             cv::imshow("classification",
@@ -89,17 +118,342 @@ ZoneStyle example_style(const VPP::Zone &zone,
     return style;
 }
 
+/* Printing the statistics of a profiled stage */
+template <typename S>
+static void summarise(const char *pipeline, const S &stage) noexcept {
+    printf("  %s/%s: %s\n", pipeline, stage.name().c_str(),
+           stage.statistics.summary().c_str());
+}
+
+/* Replaying the configured source through both pipelines as fast as possible
+ * for a number of frames (0 for the whole source), without any display, and
+ * reporting their throughput and latencies, on the standard output and in
+ * the Prometheus text format in the report file if any, as well as in the
+ * result of a sweep, whose observer gets the detected scenes */
+static int benchmark(DScribe::Core &dscribe, uint64_t frames,
+                     const std::string &report,
+                     DScribe::Sweep::Result *result = nullptr,
+                     std::function<void (const Scene &)> observe = nullptr)
+    noexcept {
+    std::mutex              access;
+    std::condition_variable progress;
+    uint64_t                done    = 0;
+    bool                    ended   = false;
+    std::atomic<uint64_t>   zones(0);
+    Util::Histogram         latency;
+
+    dscribe.detection.broadcast.connect(
+        [&](const Scene &s, int error) noexcept {
+            std::lock_guard<std::mutex> lock(access);
+            if (error < 0) {
+                ended = true;
+            } else {
+                ++done;
+                if (observe != nullptr) {
+                    observe(s);
+                }
+            }
+            progress.notify_one(); });
+    dscribe.classification.broadcast.connect(
+        [&zones](const Scene &, const Zone &, int error) noexcept {
+            if (error >= 0) {
+                zones.fetch_add(1, std::memory_order_relaxed);
+            } });
+
+    auto measured = dscribe.detection.measured;
+    dscribe.detection.measured = [&latency, measured](uint64_t ns) noexcept {
+        latency.record(ns);
+        if (measured != nullptr) {
+            measured(ns);
+        } };
+
+    /* The classification pipeline stops whenever its bridge is empty */
+    auto forward = dscribe.detection.finished;
+    dscribe.detection.finished = [&dscribe, forward](Scene &s) noexcept {
+        if (forward != nullptr) {
+            forward(s);
+        }
+        dscribe.classification.start(); };
+
+    /* The pipelines shall never wait in a frozen state while benchmarked */
+    dscribe.detection.profiling      = true;
+    dscribe.classification.profiling = true;
+    dscribe.detection.unfreeze();
+    dscribe.classification.unfreeze();
+
+    auto began = std::chrono::steady_clock::now();
+    dscribe.classification.start();
+    dscribe.detection.start();
+    {
+        /* Stop after the frames, at the end of the source or after 5s
+         * without any new scene */
+        std::unique_lock<std::mutex> lock(access);
+        while ( (!ended) && ((frames == 0) || (done < frames)) ) {
+            auto seen = done;
+            if (!progress.wait_for(lock, std::chrono::seconds(5),
+                                   [&] { return ended || done != seen; })) {
+                LOGW("Benchmark stalled after %lu frames!",
+                     static_cast<unsigned long>(done));
+                break;
+            }
+        }
+    }
+    auto elapsed = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - began).count();
+    dscribe.detection.stop();
+    dscribe.classification.stop();
+
+    uint64_t scenes;
+    {
+        std::lock_guard<std::mutex> lock(access);
+        scenes = done;
+    }
+    auto fps = (elapsed > 0) ? scenes / elapsed : 0.0;
+
+    /* The peak resident set size is in kilobytes on Linux */
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    auto rss = static_cast<uint64_t>(usage.ru_maxrss);
+
+    auto &bridge = dscribe.classification.input.bridge;
+    printf("Benchmark: %lu frames in %.3fs, %.2f fps\n",
+           static_cast<unsigned long>(scenes), elapsed, fps);
+    printf("  detection latency: %s\n", latency.summary().c_str());
+    printf("  classified zones: %lu\n",
+           static_cast<unsigned long>(zones.load()));
+    printf("  bridge: %lu scenes forwarded, %lu dropped\n",
+           static_cast<unsigned long>(bridge.forwarded()),
+           static_cast<unsigned long>(bridge.dropped()));
+    printf("  peak RSS: %lu kB\n", static_cast<unsigned long>(rss));
+    printf("  startup: %s\n",
+           Util::Task::Startup::instance().summary().c_str());
+
+    if (result != nullptr) {
+        result->frames = scenes;
+        result->fps    = fps;
+        result->p50    = latency.percentile(0.5) / 1e6;
+        result->p99    = latency.percentile(0.99) / 1e6;
+    }
+
+    auto &d = dscribe.detection;
+    {
+        const char *p = "detection";
+        summarise(p, d.input);
+        summarise(p, d.depth);
+        summarise(p, d.stillness);
+        summarise(p, d.blur);
+        summarise(p, d.motion);
+        summarise(p, d.detector);
+        summarise(p, d.clustering);
+        summarise(p, d.culling);
+        summarise(p, d.reid);
+        summarise(p, d.tracker);
+        summarise(p, d.mser);
+        summarise(p, d.edging);
+        summarise(p, d.publish);
+        summarise(p, d.overlay);
+        summarise(p, d.stream);
+        summarise(p, d.share);
+    }
+    auto &c = dscribe.classification;
+    {
+        const char *p = "classification";
+        summarise(p, c.input);
+        summarise(p, c.lookup);
+        summarise(p, c.ocr);
+        summarise(p, c.classifier);
+        summarise(p, c.record);
+        summarise(p, c.overlay);
+    }
+
+    if (report.empty()) {
+        return 0;
+    }
+
+    /* The report holds the benchmark figures along with all the metrics */
+    auto &registry = Util::Metrics::Registry::instance();
+    auto handle = registry.attach([&](Util::Metrics::Exposition &e) {
+        e.counter("vpp_bench_frames_total", "Frames benchmarked", "",
+                  scenes);
+        e.gauge("vpp_bench_seconds", "Duration of the benchmark", "",
+                elapsed);
+        e.gauge("vpp_bench_fps", "Throughput of the benchmark", "", fps);
+        e.counter("vpp_bench_zones_total", "Zones classified", "",
+                  zones.load());
+        e.gauge("vpp_bench_peak_rss_bytes", "Peak resident set size", "",
+                static_cast<double>(rss) * 1024.0);
+        e.summary("vpp_bench_latency_seconds",
+                  "Detection latency of the benchmarked scenes", "",
+                  latency); });
+    auto text = registry.collect();
+    registry.detach(handle);
+
+    std::ofstream out(report);
+    out << text;
+    if (!out) {
+        LOGE("Cannot write the benchmark report '%s'!", report.c_str());
+        return -1;
+    }
+
+    return 0;
+}
+
+#ifdef CUSTOMISATION_HAS_CLI
+/* Sweeping the grid of settings, e.g. d-scribe --sweep=grid.txt
+ * --truth=truth.txt --report=pareto.csv replay.cli, each setting being
+ * applied after the scripts to fresh pipelines replaying the same source,
+ * and scored against the annotations if any */
+static int sweep(int argc, char **argv) noexcept {
+    std::string grid, truth, report;
+    uint64_t    frames = 0;
+    int         first  = 0;
+    for (; first < argc; ++first) {
+        if (strncmp(argv[first], "--sweep=", 8) == 0) {
+            grid = argv[first] + 8;
+        } else if (strncmp(argv[first], "--truth=", 8) == 0) {
+            truth = argv[first] + 8;
+        } else if (strncmp(argv[first], "--bench=", 8) == 0) {
+            frames = strtoull(argv[first] + 8, nullptr, 10);
+        } else if (strncmp(argv[first], "--report=", 9) == 0) {
+            report = argv[first] + 9;
+        } else {
+            break;
+        }
+    }
+
+    std::vector<DScribe::Sweep::Setting> settings;
+    DScribe::Sweep::Scorer               scorer;
+    if ( (!DScribe::Sweep::grid(grid, settings)) ||
+         ( (!truth.empty()) && (!scorer.load(truth)) ) ) {
+        return 1;
+    }
+
+    STDE = stderr;
+    STDW = stdout;
+    STDO = stdout;
+    cv::utils::logging::setLogLevel(cv::utils::logging::LOG_LEVEL_SILENT);
+
+    std::vector<DScribe::Sweep::Result> results;
+    for (auto const &setting : settings) {
+        /* The setting is applied by a temporary script of set commands */
+        char path[] = "/tmp/d-scribe-sweep-XXXXXX";
+        int  fd     = mkstemp(path);
+        if (fd < 0) {
+            LOGE("Cannot create the script of a sweep setting!");
+            return 1;
+        }
+        auto text = DScribe::Sweep::script(setting);
+        auto written = write(fd, text.data(), text.size());
+        close(fd);
+        if (written != static_cast<ssize_t>(text.size())) {
+            LOGE("Cannot write the script of a sweep setting!");
+            unlink(path);
+            return 1;
+        }
+
+        DScribe::Core      dscribe;
+        Customisation::CLI cli(dscribe);
+        for (int i = first; i < argc; ++i) {
+            cli.script(argv[i]);
+        }
+        cli.script(path);
+        unlink(path);
+
+        DScribe::Sweep::Result result{ setting, 0, 0.0, 0.0, 0.0,
+                                       { 0.0, 0.0, 0.0, 0 }, false, false };
+        scorer.reset();
+        auto error = benchmark(dscribe, frames, std::string(), &result,
+                               [&scorer](const Scene &s) noexcept {
+                                   scorer.observe(s); });
+        dscribe.finalise();
+        if (error != 0) {
+            return 1;
+        }
+
+        if (!scorer.empty()) {
+            result.accuracy = scorer.score();
+            result.scored   = true;
+        }
+        results.emplace_back(std::move(result));
+    }
+
+    DScribe::Sweep::pareto(results);
+    printf("Sweep: %lu settings\n%s",
+           static_cast<unsigned long>(results.size()),
+           DScribe::Sweep::table(results, false).c_str());
+
+    if (!report.empty()) {
+        std::ofstream out(report);
+        out << DScribe::Sweep::table(results, true);
+        if (!out) {
+            LOGE("Cannot write the sweep report '%s'!", report.c_str());
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Serving the streams configured by the scripts, and then taking the commands
+ * adding or removing streams at runtime, without any display */
+static int serve(int argc, char **argv) noexcept {
+    DScribe::Server server;
+    Customisation::CLI cli(server);
+
+    for (auto &s : server.stream) {
+        auto &style = s.detection.overlay.ocv.overlay.defaultZoneStyle;
+        style.text.font =
+            Util::OCV::Overlay::Font::use("DejaVuSans",
+                        "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf");
+        style.box.thickness = -4;
+        style.box.color = { 255, 128, 128, 192 };
+        style.text.color = style.box.color;
+        style.adaptColor = true;
+    }
+
+    STDE = stderr;
+    STDW = stdout;
+    STDO = stdout;
+    cv::utils::logging::setLogLevel(cv::utils::logging::LOG_LEVEL_SILENT);
+
+    for (int i = 0; i < argc; ++i) {
+        cli.script(argv[i]);
+    }
+    cli.interactive();
+
+    for (auto &s : server.stream) {
+        s.enabled = false;
+    }
+    server.finalise();
+
+    return 0;
+}
+#endif
+
 /*
  * Program Entry Point
  */
 int main(int argc, char **argv) {
 #ifdef CUSTOMISATION_HAS_CLI
+    /* The server mode runs the streams of a single configuration, e.g.
+     * d-scribe --server cameras.cli, with set stream3.enabled yes adding a
+     * stream and set stream3.enabled no removing it */
+    if ( (argc > 1) && (strcmp(argv[1], "--server") == 0) ) {
+        return serve(argc - 2, argv + 2);
+    }
+
+    /* The sweep mode runs the headless benchmark for every setting of a
+     * grid, with its own fresh pipelines */
+    if ( (argc > 1) && (strncmp(argv[1], "--sweep=", 8) == 0) ) {
+        return sweep(argc - 1, argv + 1);
+    }
+
     DScribe::Core dscribe;
     Customisation::CLI cli(dscribe);
 
     /* Define an example ZoneStylist for OCV overlay engine */
     auto &overlay_engine = dscribe.detection.overlay.ocv;
-    overlay_engine.define("example", example_style);
+    overlay_engine.define("example", example_style, true);
 
     /* Set a standard type for zones */
     auto &style = overlay_engine.overlay.defaultZoneStyle;
@@ -118,37 +472,76 @@ int main(int argc, char **argv) {
     STDO = stdout;
     cv::utils::logging::setLogLevel(cv::utils::logging::LOG_LEVEL_SILENT);
     
+    /* The headless benchmark mode replays the source configured by the
+     * scripts, e.g. d-scribe --bench=1000 --report=bench.prom setup.cli,
+     * whereas the watched script is live reloaded whenever it is modified,
+     * e.g. d-scribe --watch=live.cli, without stopping the pipelines */
+    bool        headless = false;
+    uint64_t    frames   = 0;
+    std::string report;
+    std::string watched;
+    int         first    = 1;
+    for (; first < argc; ++first) {
+        if (strncmp(argv[first], "--bench=", 8) == 0) {
+            headless = true;
+            frames   = strtoull(argv[first] + 8, nullptr, 10);
+        } else if (strncmp(argv[first], "--report=", 9) == 0) {
+            report = argv[first] + 9;
+        } else if (strncmp(argv[first], "--watch=", 8) == 0) {
+            watched = argv[first] + 8;
+        } else {
+            break;
+        }
+    }
+
+    if (headless) {
+        for (int i = first; i < argc; ++i) {
+            cli.script(argv[i]);
+        }
+        auto error = benchmark(dscribe, frames, report);
+        dscribe.finalise();
+        fclose(stdnull);
+        return (error == 0) ? 0 : 1;
+    }
+
     cv::namedWindow("detection", cv::WINDOW_KEEPRATIO);
     cv::namedWindow("classification", cv::WINDOW_KEEPRATIO);
 
-    /* Forward the detected scene to the classification pipeline */
+    /* Forward the detected scene to the classification pipeline, which runs
+     * concurrently: the detection only blocks when the bridge is full */
+    auto &bridge = dscribe.classification.input.bridge;
+    bridge.depth  = 4;
+    bridge.policy = 
+        static_cast<int>(VPP::Engine::BridgeForZone::Policy::BLOCK);
     dscribe.detection.finished = 
         [&dscribe] (Scene &s) {
         if (!s.zones().empty()) {
             dscribe.classification.input.bridge.forward(std::move(s));
             dscribe.classification.input.bridge.forward(
                 std::move(dscribe.classification.input.bridge.scene().zones()));
-            dscribe.detection.freeze();
             dscribe.classification.start();
         } };
-
-    dscribe.classification.finished = 
-        [&dscribe] (Scene &/*s*/, Zone &/*z*/) {
-            if (dscribe.classification.input.bridge.empty()) {
-                dscribe.detection.unfreeze();
-            }
-        };
     
-    dscribe.detection.broadcast.connect(onScene);
+    dscribe.detection.broadcast.connect<Frame>(
+        [&overlay_engine](const Scene &scn, int error) noexcept {
+            return onScene(overlay_engine, scn, error); },
+        [&overlay_engine](Frame &frame) noexcept {
+            onDisplay(overlay_engine, frame); }, 2);
     dscribe.classification.broadcast.connect([&dscribe](const Scene &scn,
                                                         const Zone &z, 
                                                         int error) { 
                 return onZone(dscribe, scn, z, error); } );
    
-    if (argc <= 1) { 
+    DScribe::Reload::Reloader reloader(dscribe);
+    if (!watched.empty()) {
+        reloader.reload(watched);
+        reloader.watch(watched);
+    }
+
+    if (first >= argc) { 
         cli.interactive();
     } else {
-        for (int i=1; i < argc; ++i) {
+        for (int i = first; i < argc; ++i) {
             cli.script(argv[i]);
         }
     }
@@ -14,6 +14,9 @@
  *
  **/
 
+#include <algorithm>
+#include <memory>
+
 #include "dscribe/pipeline.hpp"
 #include "vpp/dnn/dataset.hpp"
 
@@ -23,17 +26,25 @@
 namespace DScribe {
 
 Core::Detection::Detection() noexcept
-    : VPP::Pipeline::ForScene(), input(), depth(), blur(), detector(), 
-      clustering(), overlay() {
+    : VPP::Pipeline::ForScene(), input(), depth(), stillness(), blur(),
+      motion(), detector(), clustering(), culling(), reid(), publish(),
+      overlay(), stream(), share() {
     USES(input);
     USES(depth);
+    USES(stillness);
     USES(blur);
+    USES(motion);
     USES(detector);
     USES(clustering);
+    USES(culling);
+    USES(reid);
     USES(tracker);
     USES(mser);
     USES(edging);
+    USES(publish);
     USES(overlay);
+    USES(stream);
+    USES(share);
 
     input.use("capture");
 
@@ -48,40 +59,261 @@ Core::Detection::Detection() noexcept
     clustering.basic.dnj.filter = VPP::DNN::Dataset::isText;
     clustering.basic.similarity.filter = VPP::DNN::Dataset::isText;
 
-    /* Create the pipeline! */
-    *this >> input >> depth >> blur >> detector >> clustering >> tracker
-          >> mser >> edging >> overlay;
+    /* Detect again as soon as the tracker loses too many zones */
+    detector.tracking = [this]() noexcept { return tracker.confidence(); };
+
+    /* Motion regions are only proposed on request, as the flow is costly */
+    motion.bypass(true);
+    detector.proposals = 
+        [this](const VPP::Scene &s, std::vector<cv::Rect> &rois) noexcept {
+            return motion.proposal.regions(s, rois); };
+
+    /* Tracked regions, when predicted, are grown by two standard deviations */
+    detector.predictions = 
+        [this](const VPP::Scene &s, std::vector<cv::Rect> &rois) noexcept {
+            return tracker.kalman.regions(s, 2.0f, rois); };
+
+    /* Appearance embeddings are only computed on request, as they are costly,
+     * and are then scored by the tracker matchers and kept once tracked */
+    reid.bypass(true);
+    reid.gallery.serve(tracker.kalman.matcher);
+    reid.gallery.serve(tracker.kalman.recovery);
+    tracker.broadcast.connect([this](const VPP::Scene &s, int) noexcept {
+                                  reid.gallery.commit(s); });
+
+    /* A late scene is first rid of its overlay, then of its text detection,
+     * for the tracking to keep up with the frames */
+    overlay.priority = 1;
+    mser.priority    = 2;
+    edging.priority  = 2;
+
+    /* Still scenes, as only found with fixed cameras, skip the blur, motion
+     * and detection stages, the tracker reusing its latest zones */
+    stillness.bypass(true);
+    blur.filter     = VPP::Stage::Stillness::moving;
+    motion.filter   = VPP::Stage::Stillness::moving;
+    detector.filter = VPP::Stage::Stillness::moving;
+
+    /* The zones out of range are culled before being identified, tracked and
+     * classified, as long as there is some depth */
+    culling.filter = [](const VPP::Scene &s) noexcept {
+                         return s.view.depth.available(); };
+
+    /* The streamed frames are rendered with their drawings in the streamer
+     * thread, only the drawings being captured within the pipeline */
+    stream.mjpeg.capture = [this](const VPP::Scene &s) noexcept {
+        auto frame = std::make_shared<VPP::Engine::Overlay::Frame>(
+                         overlay.ocv.capture(s));
+        return [this, frame]() noexcept {
+            overlay.ocv.render(*frame);
+            return frame->image; }; };
+
+    /* Create the pipeline! The motion, which proposes the regions of the
+     * detector, comes first. The blur check and the detection then run one
+     * after the other, a blurred scene being dropped before its detection,
+     * unless the pipeline is forking, which runs them concurrently as soon
+     * as the latency matters more than the inferences of blurred scenes */
+    *this >> input >> depth >> stillness >> motion;
+    fork(blur).fork(detector);
+    *this >> clustering >> culling >> reid >> tracker >> mser >> edging
+          >> publish >> overlay >> stream >> share;
 }
 
 Core::Classification::Classification() noexcept
-    : VPP::Pipeline::ForZone(), input(), classifier(), ocr(), overlay() {
+    : VPP::Pipeline::ForZone(), cache(), input(), lookup(cache), classifier(),
+      ocr(), record(cache), overlay() {
+    USES(cache);
     USES(input);
+    USES(lookup);
     USES(classifier);
     USES(ocr);
+    USES(record);
     USES(overlay);
 
     input.use("bridge");
 
+    /* Zones restored from the cache skip the classification altogether */
+    classifier.filter = 
+        [this](const VPP::Scene &, const VPP::Zone &z) noexcept {
+            return !VPP::DNN::Dataset::isText(z) && !cache.served(z); };
+    ocr.filter = 
+        [this](const VPP::Scene &, const VPP::Zone &z) noexcept {
+            return VPP::DNN::Dataset::isText(z) && !cache.served(z); };
+
+    /* A late zone is first rid of its overlay, then of its recognition */
+    overlay.priority    = 1;
+    ocr.priority        = 2;
+    classifier.priority = 3;
+
     /* Create the pipeline! */
-    *this >> input >> ocr >> classifier >> overlay;
+    *this >> input >> lookup >> ocr >> classifier >> record >> overlay;
+}
+
+/* Forwarding the detected scenes of a detection pipeline to its classification
+ * pipeline, the classification being (re)started on every forwarded scene if
+ * requested */
+static void wire(Core::Detection &detection,
+                 Core::Classification &classification,
+                 bool restarting) noexcept {
+    /* Forward the detected scene to the classification pipeline, only keeping
+     * the latest version of the zones waiting for their classification */
+    classification.input.bridge.depth  = 4;
+    classification.input.bridge.policy = 
+        static_cast<int>(VPP::Engine::BridgeForZone::Policy::KEEP_LATEST);
+    detection.finished = 
+        [&detection, &classification, restarting] (VPP::Scene &s) {
+            if ( (!s.zones().empty()) && (!s.still()) ) {
+                classification.input.bridge.forward(std::move(s));
+                classification.input.bridge.forward(
+                    std::move(classification.input.bridge.scene().zones()));
+                if (restarting) {
+                    classification.start();
+                }
+            } };
 }
 
 Core::Core() noexcept
-    : Customisation::Entity("DScribe"), configuration(), detection(), 
-      classification() {
+    : Customisation::Entity("DScribe"), configuration(), pool(), tracer(),
+      metrics(), governor(), detection(), classification() {
     USES(configuration);
+    USES(pool);
+    USES(tracer);
+    USES(metrics);
+    USES(governor);
     USES(detection);
     USES(classification);
 
-    /* Forward the detected scene to the classification pipeline */
-    detection.finished = 
-        [this] (VPP::Scene &s) {
-            if (!s.zones().empty()) {
-                classification.input.bridge.forward(std::move(s));
-                classification.input.bridge.forward(
-                    std::move(classification.input.bridge.scene().zones()));
+    wire(detection, classification, false);
 
-            } };
+    /* Scale the detection down whenever the scenes get late */
+    detection.measured = 
+        [this] (uint64_t latency) { governor.measure(latency); };
+#ifdef VPP_HAS_OPENCV_DNN_SUPPORT
+    governor.actuate([this] (float scale) { 
+                         detection.detector.ocv.rescale(scale); });
+#endif
+    governor.decimate([this] (int every) {
+                          detection.detector.every = every; });
+
+    denominate("dscribe");
+}
+
+Stream::Stream() noexcept
+    : Customisation::Entity("Stream"), schedule(), governor(), detection(),
+      classification(), governed(1.0f), scheduled(1.0f), thinned(1),
+      paced(1) {
+    enabled.denominate("enabled")
+           .describe("Are the pipelines of the stream running?")
+           .characterise(Customisation::Trait::SETTABLE);
+    enabled = false;
+    enabled.use(Customisation::Translator::BoolFormat::NO_YES);
+    enabled.trigger([this](const bool &yes) {
+                        return onEnabledUpdate(yes); });
+    expose(enabled);
+
+    USES(schedule);
+    USES(governor);
+    USES(detection);
+    USES(classification);
+
+    wire(detection, classification, true);
+
+    /* The scenes of the stream are scaled down by its governor whenever they
+     * get late or the device gets hot, and decimated and scaled down by the
+     * scheduler whenever the stream misses its target or exceeds its share
+     * of the workers, the largest decimation of both being applied. The
+     * scheduler degrades the stream from the thread of any other stream, so
+     * the detector is only ever altered at the safe points of its pipeline */
+    detection.measured = 
+        [this] (uint64_t latency) {
+            governor.measure(latency);
+            schedule.measure(latency); };
+    governor.decimate([this] (int every) {
+                          thinned.store(every, std::memory_order_relaxed);
+                          detection.defer([this] () { decimate(); }); });
+    schedule.decimate([this] (int every) {
+                          paced.store(every, std::memory_order_relaxed);
+                          detection.defer([this] () { decimate(); }); });
+    schedule.cost([this] () { return cost(); });
+#ifdef VPP_HAS_OPENCV_DNN_SUPPORT
+    governor.actuate([this] (float scale) {
+                         governed.store(scale, std::memory_order_relaxed);
+                         detection.defer([this] () { rescale(); }); });
+    schedule.rescale([this] (float scale) {
+                         scheduled.store(scale, std::memory_order_relaxed);
+                         detection.defer([this] () { rescale(); }); });
+#endif
+}
+
+uint64_t Stream::cost() const noexcept {
+    /* The moving average costs of the stages, as estimated whilst the
+     * detection has a frame budget */
+    auto &d = detection;
+    uint64_t ns = 0;
+    for (auto c : { &d.input.statistics.cost, &d.depth.statistics.cost,
+                    &d.stillness.statistics.cost, &d.blur.statistics.cost,
+                    &d.motion.statistics.cost, &d.detector.statistics.cost,
+                    &d.clustering.statistics.cost,
+                    &d.culling.statistics.cost, &d.reid.statistics.cost,
+                    &d.tracker.statistics.cost, &d.mser.statistics.cost,
+                    &d.edging.statistics.cost, &d.publish.statistics.cost,
+                    &d.overlay.statistics.cost, &d.stream.statistics.cost,
+                    &d.share.statistics.cost }) {
+        ns += c->load(std::memory_order_relaxed);
+    }
+
+    return ns;
+}
+
+void Stream::decimate() noexcept {
+    detection.detector.every = std::max(thinned.load(std::memory_order_relaxed),
+                                        paced.load(std::memory_order_relaxed));
+}
+
+void Stream::rescale() noexcept {
+#ifdef VPP_HAS_OPENCV_DNN_SUPPORT
+    detection.detector.ocv.rescale(governed.load(std::memory_order_relaxed) *
+                                   scheduled.load(std::memory_order_relaxed));
+#endif
+}
+
+Customisation::Error Stream::onEnabledUpdate(bool yes) noexcept {
+    /* The classification starts first for not dropping the first scenes, and
+     * stops last for classifying the last ones */
+    if (yes) {
+        if (!schedule.admit()) {
+            return Customisation::Error::INVALID_REQUEST;
+        }
+        classification.start();
+        detection.start();
+    } else {
+        detection.stop();
+        classification.stop();
+        schedule.retire();
+    }
+
+    return Customisation::Error::NONE;
+}
+
+static const char *names[Server::MAX] = {
+    "stream0",  "stream1",  "stream2",  "stream3",  "stream4",  "stream5",
+    "stream6",  "stream7",  "stream8",  "stream9",  "stream10", "stream11",
+    "stream12", "stream13", "stream14", "stream15" };
+
+Server::Server() noexcept
+    : Customisation::Entity("DScribe"), configuration(), pool(), tracer(),
+      metrics(), scheduler(), stream() {
+    USES(configuration);
+    USES(pool);
+    USES(tracer);
+    USES(metrics);
+    USES(scheduler);
+
+    for (int i = 0; i < MAX; ++i) {
+        stream[i].denominate(names[i]);
+        expose(stream[i]);
+        scheduler.enrol(stream[i].schedule);
+    }
 
     denominate("dscribe");
 }
@@ -0,0 +1,365 @@
+/**
+ *
+ * @file      dscribe/reload.cpp
+ *
+ * @brief     This is the d-scribe live configuration reload implementation
+ *
+ * @details   This is the diff of the scripts and the deferred application of
+ *            their changes to the running pipelines.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "customisation.hpp"
+#include "dscribe/reload.hpp"
+#include "vpp/log.hpp"
+
+namespace DScribe {
+namespace Reload {
+
+bool read(const std::string &path, Setting &setting) noexcept {
+    std::ifstream in(path);
+    if (!in) {
+        LOGE("Cannot read the reloaded script '%s'!", path.c_str());
+        return false;
+    }
+
+    setting.clear();
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream words(line);
+        std::string        command, parameter, value;
+        if ( (!(words >> command >> parameter)) || (command != "set") ) {
+            continue;
+        }
+        std::getline(words >> std::ws, value);
+
+        bool found = false;
+        for (auto &p : setting) {
+            if (p.first == parameter) {
+                p.second = value;
+                found    = true;
+            }
+        }
+        if (!found) {
+            setting.emplace_back(parameter, value);
+        }
+    }
+
+    return true;
+}
+
+Setting diff(const Setting &applied, const Setting &loaded) noexcept {
+    Setting changed;
+    for (auto const &l : loaded) {
+        bool same = false;
+        for (auto const &a : applied) {
+            if (a.first == l.first) {
+                same = (a.second == l.second);
+                break;
+            }
+        }
+        if (!same) {
+            changed.emplace_back(l);
+        }
+    }
+
+    return changed;
+}
+
+bool cold(const std::string &parameter) noexcept {
+    std::istringstream names(parameter);
+    std::string        name;
+    while (std::getline(names, name, '.')) {
+        if ( (name == "network") || (name == "model") ||
+             (name == "dataset") ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Is a parameter one of the pipelines of the core ? */
+static bool piped(const std::string &parameter) noexcept {
+    return (parameter.compare(0, 10, "detection.") == 0) ||
+           (parameter.compare(0, 15, "classification.") == 0);
+}
+
+/* The engine owning a cold parameter of a pipeline, i.e. the names before
+ * its network, model or dataset, empty if it is not an engine of a stage or
+ * if it is an input one */
+static std::string owner(const std::string &parameter) noexcept {
+    if (!piped(parameter)) {
+        return std::string();
+    }
+
+    std::istringstream names(parameter);
+    std::string        name, engine;
+    int                depth = 0;
+    while (std::getline(names, name, '.')) {
+        if ( (name == "network") || (name == "model") ||
+             (name == "dataset") ) {
+            return (depth >= 2) ? engine : std::string();
+        }
+        if (name == "input") {
+            return std::string();
+        }
+        engine += ((depth++ > 0) ? "." : "") + name;
+    }
+
+    return std::string();
+}
+
+/* Is a parameter running, freezing or capturing anything ? */
+static bool live(const std::string &parameter) noexcept {
+    std::istringstream names(parameter);
+    std::string        name;
+    while (std::getline(names, name, '.')) {
+        if ( (name == "running") || (name == "frozen") ||
+             (name == "input") ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* The parameters of a pipeline of the core */
+static Setting of(const Setting &setting, const std::string &pipeline)
+    noexcept {
+    Setting selected;
+    for (auto const &p : setting) {
+        if (p.first.compare(0, pipeline.size() + 1, pipeline + ".") == 0) {
+            selected.emplace_back(p);
+        }
+    }
+
+    return selected;
+}
+
+#ifdef CUSTOMISATION_HAS_CLI
+/* Applying a setting with a temporary script of set commands */
+static bool apply(Core &core, const Setting &setting) noexcept {
+    if (setting.empty()) {
+        return true;
+    }
+
+    char path[] = "/tmp/d-scribe-reload-XXXXXX";
+    int  fd     = mkstemp(path);
+    if (fd < 0) {
+        LOGE("Cannot create the script of a reloaded setting!");
+        return false;
+    }
+    auto text    = Sweep::script(setting);
+    auto written = write(fd, text.data(), text.size());
+    close(fd);
+    if (written != static_cast<ssize_t>(text.size())) {
+        LOGE("Cannot write the script of a reloaded setting!");
+        unlink(path);
+        return false;
+    }
+
+    Customisation::CLI cli(core);
+    cli.script(path);
+    unlink(path);
+
+    return true;
+}
+#else
+static bool apply(Core &, const Setting &) noexcept {
+    LOGE("Need to configure the Customisation library with its CLI");
+    return false;
+}
+#endif
+
+Reloader::Reloader(Core &c) noexcept
+    : core(c), applied(), loading(), watcher(), watching(false), wake(),
+      poll() {}
+
+Reloader::~Reloader() noexcept {
+    {
+        /* Inside a lock_guard scoped block, as we need to stop polling */
+        std::lock_guard<std::mutex> lock(poll);
+        watching = false;
+    }
+    wake.notify_all();
+
+    if (watcher.joinable()) {
+        watcher.join();
+    }
+    if (loading.valid()) {
+        loading.wait();
+    }
+}
+
+bool Reloader::reload(const std::string &path) noexcept {
+    Setting loaded;
+    if (!read(path, loaded)) {
+        return false;
+    }
+
+    /* The first script is applied as it is */
+    if (applied.empty()) {
+        applied = loaded;
+        return apply(core, loaded);
+    }
+
+    auto changed = diff(applied, loaded);
+    if (changed.empty()) {
+        return true;
+    }
+
+    Setting hot, models;
+    for (auto const &p : changed) {
+        /* The cold parameters out of the engines of the pipelines load
+         * nothing side by side and are applied right away */
+        if ( (cold(p.first)) && (!owner(p.first).empty()) ) {
+            models.emplace_back(p);
+        } else {
+            hot.emplace_back(p);
+        }
+
+        bool found = false;
+        for (auto &a : applied) {
+            if (a.first == p.first) {
+                a.second = p.second;
+                found    = true;
+            }
+        }
+        if (!found) {
+            applied.emplace_back(p);
+        }
+    }
+    LOGI("Reloading '%s': %lu hot and %lu cold changes", path.c_str(),
+         static_cast<unsigned long>(hot.size()),
+         static_cast<unsigned long>(models.size()));
+
+    /* A single cold reload runs at once */
+    if (loading.valid()) {
+        loading.wait();
+    }
+    if (!models.empty()) {
+        load(models);
+    }
+
+    return defer(hot);
+}
+
+bool Reloader::defer(const Setting &hot) noexcept {
+    auto  detection      = of(hot, "detection");
+    auto  classification = of(hot, "classification");
+    auto &c              = core;
+
+    Setting others;
+    for (auto const &p : hot) {
+        if (!piped(p.first)) {
+            others.emplace_back(p);
+        }
+    }
+
+    if (!detection.empty()) {
+        core.detection.defer([&c, detection] { apply(c, detection); });
+    }
+    if (!classification.empty()) {
+        core.classification.defer([&c, classification] {
+                                      apply(c, classification); });
+    }
+
+    return apply(core, others);
+}
+
+void Reloader::load(const Setting &cold) noexcept {
+    /* The spare core only gets the settings applied so far of the engines
+     * owning these cold ones, for them to load the very networks the
+     * running ones will share, and it is only released once both the
+     * pipelines have attached to them. Its pipelines are never started,
+     * and its inputs are never opened */
+    std::vector<std::string> engines;
+    for (auto const &p : cold) {
+        auto engine = owner(p.first);
+        if (std::find(engines.begin(), engines.end(), engine) ==
+            engines.end()) {
+            engines.emplace_back(std::move(engine));
+        }
+    }
+
+    Setting owned;
+    for (auto const &p : applied) {
+        if (live(p.first)) {
+            continue;
+        }
+        for (auto const &e : engines) {
+            if (p.first.compare(0, e.size() + 1, e + ".") == 0) {
+                owned.emplace_back(p);
+                break;
+            }
+        }
+    }
+
+    auto &c = core;
+    loading = std::async(std::launch::async, [&c, owned, cold] {
+        std::shared_ptr<Core> spare(new Core(), [](Core *s) noexcept {
+                                        s->finalise();
+                                        delete s; });
+        apply(*spare, owned);
+
+        auto detection      = of(cold, "detection");
+        auto classification = of(cold, "classification");
+        c.detection.defer([&c, spare, detection] {
+                              apply(c, detection); });
+        c.classification.defer([&c, spare, classification] {
+                                   apply(c, classification); }); });
+}
+
+void Reloader::watch(const std::string &path) noexcept {
+    {
+        /* Inside a lock_guard scoped block, as we need to start polling */
+        std::lock_guard<std::mutex> lock(poll);
+        if (watching) {
+            LOGE("Cannot watch '%s' whilst watching another script!",
+                 path.c_str());
+            return;
+        }
+        watching = true;
+    }
+
+    watcher = std::thread([this, path] {
+        struct stat status;
+        auto modified = (stat(path.c_str(), &status) == 0) ?
+                        status.st_mtime : 0;
+
+        std::unique_lock<std::mutex> lock(poll);
+        while (!wake.wait_for(lock, std::chrono::seconds(1),
+                              [this] { return !this->watching; })) {
+            if ( (stat(path.c_str(), &status) != 0) ||
+                 (status.st_mtime == modified) ) {
+                continue;
+            }
+            modified = status.st_mtime;
+
+            /* Reloading out of the lock, for not delaying the stop */
+            lock.unlock();
+            reload(path);
+            lock.lock();
+        } });
+}
+
+}  // namespace Reload
+}  // namespace DScribe
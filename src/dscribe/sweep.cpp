@@ -0,0 +1,315 @@
+/**
+ *
+ * @file      dscribe/sweep.cpp
+ *
+ * @brief     This is the d-scribe accuracy versus latency sweep implementation
+ *
+ * @details   This is the grid, the scoring against the annotations and the
+ *            Pareto table of the sweeps of the headless benchmark.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "dscribe/sweep.hpp"
+#include "vpp/log.hpp"
+
+namespace DScribe {
+namespace Sweep {
+
+bool grid(const std::string &path, std::vector<Setting> &settings) noexcept {
+    std::ifstream in(path);
+    if (!in) {
+        LOGE("Cannot read the sweep grid '%s'!", path.c_str());
+        return false;
+    }
+
+    /* The settings are all the combinations of the values of the lines */
+    settings.assign(1, Setting());
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream words(line);
+        std::string        parameter, value;
+        if ( (!(words >> parameter)) || (parameter[0] == '#') ) {
+            continue;
+        }
+
+        std::vector<Setting> combined;
+        while (words >> value) {
+            for (auto const &s : settings) {
+                combined.emplace_back(s);
+                combined.back().emplace_back(parameter, value);
+            }
+        }
+        if (combined.empty()) {
+            LOGE("No value for the swept parameter '%s'!", parameter.c_str());
+            return false;
+        }
+        settings = std::move(combined);
+    }
+
+    return true;
+}
+
+std::string script(const Setting &setting) noexcept {
+    std::string text;
+    for (auto const &p : setting) {
+        text += "set " + p.first + " " + p.second + "\n";
+    }
+    return text;
+}
+
+Scorer::Scorer() noexcept : truth(), detected() {}
+
+bool Scorer::load(const std::string &path) noexcept {
+    std::ifstream in(path);
+    if (!in) {
+        LOGE("Cannot read the annotations '%s'!", path.c_str());
+        return false;
+    }
+
+    truth.clear();
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream words(line);
+        uint64_t ts, id;
+        int      x, y, w, h;
+        if ( (line.empty()) || (line[0] == '#') ) {
+            continue;
+        }
+        if ( (!(words >> ts >> id >> x >> y >> w >> h)) ||
+             (w <= 0) || (h <= 0) ) {
+            LOGE("Invalid annotation '%s'!", line.c_str());
+            return false;
+        }
+        truth[ts].emplace_back(Box{ cv::Rect(x, y, w, h), id, 1.0f });
+    }
+
+    return true;
+}
+
+void Scorer::reset() noexcept {
+    detected.clear();
+}
+
+void Scorer::observe(const VPP::Scene &scene) noexcept {
+    auto ts = scene.ts_ms();
+    if (truth.find(ts) == truth.end()) {
+        return;
+    }
+
+    auto &boxes = detected[ts];
+    boxes.clear();
+    for (const VPP::Zone &z : scene.zones()) {
+        boxes.emplace_back(Box{ static_cast<const cv::Rect &>(z), z.uuid,
+                                z.context.score });
+    }
+}
+
+static float iou(const cv::Rect &a, const cv::Rect &b) noexcept {
+    auto common = (a & b).area();
+    auto all    = a.area() + b.area() - common;
+    return (all > 0) ? static_cast<float>(common) / all : 0.0f;
+}
+
+Accuracy Scorer::score() const noexcept {
+    Accuracy accuracy{ 0.0, 0.0, 0.0, 0 };
+
+    /* The detections are matched to the annotations of their frame in the
+     * order of their scores, each to its best overlapping annotation, the
+     * annotated frames never observed having no detection at all */
+    std::vector<std::pair<float, bool>>     ranked;
+    std::map<uint64_t, uint64_t>            tracked;
+    std::map<std::pair<uint64_t, uint64_t>, uint64_t> shared;
+    uint64_t annotations = 0, detections = 0, matches = 0, switches = 0;
+
+    for (auto const &f : truth) {
+        auto const &annotated = f.second;
+        auto        observed  = detected.find(f.first);
+        auto        found     = (observed != detected.end()) ?
+                                observed->second : std::vector<Box>();
+        std::sort(found.begin(), found.end(),
+                  [](const Box &a, const Box &b) noexcept {
+                      return a.score > b.score; });
+
+        std::vector<bool> taken(annotated.size(), false);
+        for (auto const &d : found) {
+            int   best    = -1;
+            float overlap = 0.5f;
+            for (std::size_t i = 0; i < annotated.size(); ++i) {
+                auto o = iou(d.rect, annotated[i].rect);
+                if ( (!taken[i]) && (o >= overlap) ) {
+                    best    = static_cast<int>(i);
+                    overlap = o;
+                }
+            }
+            ranked.emplace_back(d.score, best >= 0);
+            if (best < 0) {
+                continue;
+            }
+
+            /* An identity switch is an annotation matched to another track
+             * than on its previous match */
+            taken[best] = true;
+            ++matches;
+            auto id = annotated[best].id;
+            auto t  = tracked.find(id);
+            if ( (t != tracked.end()) && (t->second != d.id) ) {
+                ++switches;
+            }
+            tracked[id] = d.id;
+            ++shared[std::make_pair(id, d.id)];
+        }
+
+        annotations += annotated.size();
+        detections  += found.size();
+        accuracy.frames += (observed != detected.end()) ? 1 : 0;
+    }
+
+    if (annotations == 0) {
+        return accuracy;
+    }
+
+    /* The average precision is the area under the interpolated precision
+     * recall curve */
+    std::stable_sort(ranked.begin(), ranked.end(),
+                     [](const std::pair<float, bool> &a,
+                        const std::pair<float, bool> &b) noexcept {
+                         return a.first > b.first; });
+    std::vector<double> precisions, recalls;
+    uint64_t hits = 0;
+    for (std::size_t i = 0; i < ranked.size(); ++i) {
+        hits += (ranked[i].second) ? 1 : 0;
+        precisions.emplace_back(static_cast<double>(hits) / (i + 1));
+        recalls.emplace_back(static_cast<double>(hits) / annotations);
+    }
+    for (std::size_t i = precisions.size(); i-- > 1;) {
+        precisions[i - 1] = std::max(precisions[i - 1], precisions[i]);
+    }
+    double recalled = 0.0;
+    for (std::size_t i = 0; i < precisions.size(); ++i) {
+        accuracy.map += (recalls[i] - recalled) * precisions[i];
+        recalled      = recalls[i];
+    }
+
+    auto misses   = annotations - matches;
+    auto spurious = detections - matches;
+    accuracy.mota = 1.0 - static_cast<double>(misses + spurious + switches) /
+                          annotations;
+
+    /* The identities are paired one to one, the most shared pairs first */
+    std::vector<std::pair<uint64_t, std::pair<uint64_t, uint64_t>>> pairs;
+    for (auto const &s : shared) {
+        pairs.emplace_back(s.second, s.first);
+    }
+    std::sort(pairs.begin(), pairs.end(),
+              [](const std::pair<uint64_t, std::pair<uint64_t, uint64_t>> &a,
+                 const std::pair<uint64_t, std::pair<uint64_t, uint64_t>> &b)
+              noexcept { return a.first > b.first; });
+    std::map<uint64_t, bool> identities, tracks;
+    uint64_t identified = 0;
+    for (auto const &p : pairs) {
+        if ( (!identities[p.second.first]) && (!tracks[p.second.second]) ) {
+            identities[p.second.first] = true;
+            tracks[p.second.second]    = true;
+            identified                += p.first;
+        }
+    }
+    accuracy.idf1 = 2.0 * identified / (annotations + detections);
+
+    return accuracy;
+}
+
+void pareto(std::vector<Result> &results) noexcept {
+    /* Faster means a higher throughput and a lower tail latency */
+    auto dominates = [](const Result &a, const Result &b) noexcept {
+        bool as_good = (a.fps >= b.fps) && (a.p99 <= b.p99) &&
+                       ( (!a.scored) || (!b.scored) ||
+                         (a.accuracy.map >= b.accuracy.map) );
+        bool better  = (a.fps > b.fps) || (a.p99 < b.p99) ||
+                       ( (a.scored) && (b.scored) &&
+                         (a.accuracy.map > b.accuracy.map) );
+        return as_good && better; };
+
+    for (auto &r : results) {
+        r.optimal = true;
+        for (auto const &o : results) {
+            if (dominates(o, r)) {
+                r.optimal = false;
+                break;
+            }
+        }
+    }
+}
+
+static std::string describe(const Setting &setting) noexcept {
+    std::string text;
+    for (auto const &p : setting) {
+        text += ((text.empty()) ? "" : ",") + p.first + "=" + p.second;
+    }
+    return (text.empty()) ? std::string("default") : text;
+}
+
+std::string table(const std::vector<Result> &results, bool csv) noexcept {
+    bool scored = false;
+    int  width  = 7;
+    for (auto const &r : results) {
+        scored = scored || r.scored;
+        width  = std::max(width,
+                          static_cast<int>(describe(r.setting).size()));
+    }
+
+    std::string text;
+    char        line[128];
+    if (csv) {
+        text = "setting,frames,fps,p50_ms,p99_ms";
+        text += (scored) ? ",map,mota,idf1,pareto\n" : ",pareto\n";
+    } else {
+        snprintf(line, sizeof(line), "%-*s %8s %8s %8s %8s", width,
+                 "setting", "frames", "fps", "p50(ms)", "p99(ms)");
+        text = line;
+        text += (scored) ? "      mAP     MOTA     IDF1 pareto\n" :
+                           " pareto\n";
+    }
+
+    for (auto const &r : results) {
+        auto setting = describe(r.setting);
+        if (csv) {
+            snprintf(line, sizeof(line), ",%lu,%.2f,%.2f,%.2f",
+                     static_cast<unsigned long>(r.frames), r.fps, r.p50,
+                     r.p99);
+            text += "\"" + setting + "\"" + line;
+        } else {
+            snprintf(line, sizeof(line), " %8lu %8.2f %8.2f %8.2f",
+                     static_cast<unsigned long>(r.frames), r.fps, r.p50,
+                     r.p99);
+            text += setting + std::string(width - setting.size(), ' ') +
+                    line;
+        }
+
+        if (scored) {
+            snprintf(line, sizeof(line), (csv) ? ",%.4f,%.4f,%.4f" :
+                                                 " %8.4f %8.4f %8.4f",
+                     r.accuracy.map, r.accuracy.mota, r.accuracy.idf1);
+            text += line;
+        }
+        text += (csv) ? ((r.optimal) ? ",yes\n" : ",no\n") :
+                        ((r.optimal) ? "      *\n" : "\n");
+    }
+
+    return text;
+}
+
+}  // namespace Sweep
+}  // namespace DScribe
@@ -0,0 +1,108 @@
+/**
+ *
+ * @file      vpp/contour.cpp
+ *
+ * @brief     This is the VPP contour implementation file
+ *
+ * @details   These are the contours of the zones, sharing their points.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+
+#include "vpp/contour.hpp"
+
+namespace VPP {
+
+Contour::Arena::Arena(std::size_t chunk) noexcept
+    : unit(std::max<std::size_t>(chunk, 1)), block(), capacity(0), used(0),
+      storing() {}
+
+Contour::Arena::Arena(Arena&& other) noexcept
+    : unit(other.unit), block(std::move(other.block)),
+      capacity(other.capacity), used(other.used), storing() {
+    other.capacity = 0;
+    other.used     = 0;
+}
+
+Contour::Arena& Contour::Arena::operator=(Arena&& other) noexcept {
+    unit           = other.unit;
+    block          = std::move(other.block);
+    capacity       = other.capacity;
+    used           = other.used;
+    other.capacity = 0;
+    other.used     = 0;
+    return *this;
+}
+
+Contour Contour::Arena::store(const cv::Point *points, std::size_t n)
+    noexcept {
+    Contour c;
+    if (n == 0) {
+        return c;
+    }
+
+    /* Inside a lock_guard scoped block */
+    std::lock_guard<std::mutex> lock(storing);
+
+    /* The contours larger than a block get a block of their own */
+    if ( (block == nullptr) || (capacity - used < n) ) {
+        capacity = std::max(unit, n);
+        block    = std::shared_ptr<cv::Point>(
+                       new cv::Point[capacity],
+                       std::default_delete<cv::Point[]>());
+        used     = 0;
+    }
+
+    auto at = block.get() + used;
+    std::copy(points, points + n, at);
+    used += n;
+
+    c.shared = std::shared_ptr<const cv::Point>(block, at);
+    c.count  = n;
+    return c;
+}
+
+void Contour::Arena::reset() noexcept {
+    /* Inside a lock_guard scoped block */
+    std::lock_guard<std::mutex> lock(storing);
+    block.reset();
+    capacity = 0;
+    used     = 0;
+}
+
+std::size_t Contour::Arena::bytes() const noexcept {
+    /* Inside a lock_guard scoped block */
+    std::lock_guard<std::mutex> lock(storing);
+    return capacity * sizeof(cv::Point);
+}
+
+Contour::Contour(std::vector<cv::Point> points) noexcept
+    : shared(), count(points.size()) {
+    if (count > 0) {
+        auto owned = std::make_shared<std::vector<cv::Point>>(
+                         std::move(points));
+        shared = std::shared_ptr<const cv::Point>(owned, owned->data());
+    }
+}
+
+Contour Contour::simplified(double epsilon) const noexcept {
+    if ( (count < 3) || (epsilon <= 0) ) {
+        return *this;
+    }
+
+    std::vector<cv::Point> approx;
+    cv::approxPolyDP(mat(), approx, epsilon, true);
+    return Contour(std::move(approx));
+}
+
+}  // namespace VPP
@@ -37,5 +37,18 @@ template <typename ...Z>
     return Error::OK;
 }
 
+template <typename ...Z> 
+    Operation Engine<Z...>::launch(Scene &s, Z&... z) noexcept {
+    return Operation(process(s, z...));
+}
+
+template <typename ...Z> AsyncEngine<Z...>::AsyncEngine() noexcept
+    : Engine<Z...>() {}
+
+template <typename ...Z> 
+    Error::Type AsyncEngine<Z...>::process(Scene &s, Z&... z) noexcept {
+    return launch(s, z...).wait();
+}
+
 }  // namespace Core
 }  // namespace VPP
@@ -19,257 +19,665 @@
 #pragma once
 
 #include <forward_list>
+#include <utility>
 
 #include "vpp/log.hpp"
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <iterator>
+
 #include "vpp/core/pipeline.hpp"
+#include "vpp/util/task.hpp"
+#include "vpp/util/trace.hpp"
 
 namespace VPP {
 namespace Core {
 
 template <typename ...Z> Pipeline<Z...>::Pipeline() noexcept 
-    : Customisation::Entity("Pipeline"), finished(),
-      stages(), run(false), retry(false), halt(false), zombie(false),
-      resume(), suspend(), thread() {
-    /* Define the running parameter */
-    running.denominate("running");
-    running.describe("Is the pipeline running ?");
-    running = false;
-    running.use(Customisation::Translator::BoolFormat::NO_YES);
-    running.trigger([this](const bool &yes) {
-                    return this->onRunningUpdate(yes); });
-    expose(running).characterise(Customisation::Trait::SETTABLE);
-
-    /* Define the frozen parameter */
-    frozen.denominate("frozen");
-    frozen.describe("Is the pipeline frozen ?");
-    frozen = false;
-    frozen.use(Customisation::Translator::BoolFormat::NO_YES);
-    frozen.trigger([this](const bool &yes) {
-                   return this->onFrozenUpdate(yes); });
-    expose(frozen).characterise(Customisation::Trait::SETTABLE);
-}
- 
-template <typename ...Z> Pipeline<Z...>::~Pipeline() noexcept {
-    /* Cleanly exit the thread to prevent program termination */
-    terminate();
+    : Customisation::Entity("Pipeline"), Runner<Z...>(), groups(), forked(),
+      branches(), releases(), drain(false), queues(), ready(), flow() {
+    /* Define the inflight parameter */
+    inflight.denominate("inflight");
+    inflight.describe("Number of scenes in flight (1 for sequential "
+                      "processing)");
+    inflight.range(1, 16);
+    inflight = 1;
+    this->expose(inflight).characterise(Customisation::Trait::CONFIGURABLE);
+
+    /* Define the budget parameter */
+    budget.denominate("budget");
+    budget.describe("The processing budget of a scene in milliseconds, its "
+                    "optional stages being bypassed when it gets late (0 for "
+                    "always running all the stages)");
+    budget.range(0, 10000);
+    budget = 0;
+    this->expose(budget).characterise(Customisation::Trait::SETTABLE);
+
+    /* Define the releasing parameter */
+    releasing.denominate("releasing");
+    releasing.describe("Are the cached conversions of a scene released after "
+                       "the last stage reading them ?");
+    releasing = true;
+    releasing.use(Customisation::Translator::BoolFormat::NO_YES);
+    this->expose(releasing).characterise(Customisation::Trait::SETTABLE);
+
+    /* Define the forking parameter */
+    forking.denominate("forking");
+    forking.describe("Are the consecutive forked stages run concurrently on "
+                     "their branches of the scene ?");
+    forking = false;
+    forking.use(Customisation::Translator::BoolFormat::NO_YES);
+    this->expose(forking).characterise(Customisation::Trait::SETTABLE);
 }
 
-template <typename ...Z> void Pipeline<Z...>::terminate() noexcept {
-    /* Cleanly exit the thread to prevent program termination */
-    unfreeze();
-    stop();
+template <typename ...Z> Pipeline<Z...>::~Pipeline() noexcept {
+    /* Cleanly exit the thread, which runs the stages of the pipeline */
+    this->terminate();
 }
 
 template <typename ...Z>
 Pipeline<Z...> &Pipeline<Z...>::operator>>(Stage &stage)
     noexcept {
-    
-    {
-        /* Inside a lock_guard scoped block */
-        std::lock_guard<std::mutex> lock(suspend);
- 
-        /* This shall never happen */
-        ASSERT(((!run) && (!thread.joinable())),
-               "%s[%s]:operator >>() called whilst thread is running!", 
-                 value_to_string().c_str(), name().c_str());
+    return append(stage, true, false);
+}
+
+template <typename ...Z>
+Pipeline<Z...> &Pipeline<Z...>::join(Stage &stage) noexcept {
+    return append(stage, false, false);
+}
 
-        stages.emplace_back(stage); 
+template <typename ...Z>
+Pipeline<Z...> &Pipeline<Z...>::fork(Stage &stage) noexcept {
+    /* The zones of a zone pipeline belong to the scene, hence cannot be
+     * branched out of it */
+    if ( (sizeof...(Z) > 0) || (!stage.forkable()) ) {
+        LOGW("%s[%s]::fork(): Stage %s cannot be forked, joining it instead",
+             this->value_to_string().c_str(), this->name().c_str(),
+             stage.name().c_str());
+        return append(stage, false, false);
     }
 
-    ASSERT((!stage.name().empty()),
-            "%s[%s]:operator >>(Stage &) cannot bound an unnamed stage!",
-            value_to_string().c_str(), name().c_str());
-    
-    expose(stage);
- 
+    return append(stage, false, true);
+}
+
+template <typename ...Z>
+Pipeline<Z...> &Pipeline<Z...>::append(Stage &stage, bool split,
+                                       bool forking) noexcept {
+    /* The very first stage always starts a new group */
+    if ( (split) || (groups.empty()) ) {
+        groups.emplace_back(stages.size());
+    }
+    forked.push_back(forking);
+    branches.emplace_back(forking ? new Scene() : nullptr);
+    this->bind(stage);
+    plan();
+
     return *this;
 }
 
-template <typename ...Z> void Pipeline<Z...>::start() noexcept {
-    running = true;
+template <typename ...Z> Pipeline<Z...>::Step::Step() noexcept
+    : operation(Error::NONE), processed(false), launched(false),
+      profiled(false), timed(false), started(0), prepared(0) {}
+
+template <typename ...Z> Pipeline<Z...>::Frame::Frame() noexcept
+    : scene(), storage(), s(nullptr), z(), error(Error::NONE), started(0),
+      stage(0), deadline(0), step(), resumable(false) {
+    reset();
 }
 
-template <typename ...Z> void Pipeline<Z...>::stop() noexcept {
-    running = false;
+template <typename ...Z> void Pipeline<Z...>::Frame::reset() noexcept {
+    s       = &scene;
+    error   = Error::NONE;
+    started = Util::Histogram::now();
+    bind(Util::indices_for<Z...>());
 }
 
-template <typename ...Z> void Pipeline<Z...>::freeze() noexcept {
-    frozen = true;
+template <typename ...Z> void Pipeline<Z...>::Frame::rehome() noexcept {
+    /* Moving the scene keeps its zones at their actual locations, so that
+     * any zone reference remains valid */
+    if (s != &scene) {
+        scene = std::move(*s);
+        s     = &scene;
+    }
 }
 
-template <typename ...Z> void Pipeline<Z...>::unfreeze() noexcept {
-    frozen = false;
+template <typename ...Z> template <std::size_t ...I>
+    void Pipeline<Z...>::Frame::bind(Util::indices<I...>) noexcept {
+    z = std::tuple<Z*...>(&std::get<I>(storage)...);
 }
 
-template <typename ...Z>
-    void Pipeline<Z...>::work(Scene* &s, Z*&... z) noexcept {
-    bool notify = false;
+template <typename ...Z> bool Pipeline<Z...>::pipelined() const noexcept {
+    return (static_cast<int>(inflight) > 1) && (groups.size() > 1);
+}
 
-    while (true) {
-        auto error = process(s, z...);
+template <typename ...Z> void Pipeline<Z...>::launch() noexcept {
+    if (pipelined()) {
+        return overlap();
+    }
 
-        /* Error handling: exiting with broken empty scene */
-        if (error) {
+    Runner<Z...>::launch();
+}
 
-            /* Only broadcast actual errors and not retry or not ready status */
-            if (error < 0) {
-                LOGE("%s[%s]:process() error %d!", 
-                      value_to_string().c_str(), name().c_str(), error);
-                broadcast.signal(*s, *z..., error);
-            }
+template <typename ...Z> void Pipeline<Z...>::overlap() noexcept {
+    std::vector<std::unique_ptr<Frame>> frames;
+    std::vector<std::thread>            workers;
+    const auto                          sink = groups.size();
+
+    {
+        /* Inside a lock_guard scoped block, as we need to access the queues */
+        std::lock_guard<std::mutex> lock(flow);
+
+        /* All frames are initially available to the first group */
+        drain = false;
+        queues.assign(sink + 1, std::deque<Frame *>());
+        for (int i = 0; i < static_cast<int>(inflight); ++i) {
+            frames.emplace_back(new Frame());
+            queues.front().push_back(frames.back().get());
+        }
+    }
+
+    const auto p = Util::Task::Priority::current();
+    for (std::size_t g = 0; g < sink; ++g) {
+        workers.emplace_back([this, g, p] {
+                                 Util::Task::Priority::Scope scope(p);
+                                 return this->relay(g); });
+    }
+
+    /* The pipeline thread concludes the frames in order before recycling
+     * them to the first group of stages. Whenever some changes are deferred,
+     * the concluded frames are held back until all of them are, so that the
+     * changes are applied whilst no stage is running */
+    std::vector<Frame *> held;
+    bool                 carry_on = true;
+    while (carry_on) {
+        auto f = pop(sink);
+        measure(f->started, *f->s);
+        carry_on = conclude(*f, Util::indices_for<Z...>());
+        held.push_back(f);
+
+        if ( (carry_on) && (deferring()) && (held.size() < frames.size()) ) {
+            continue;
+        }
+        if (held.size() == frames.size()) {
+            settle();
         }
+        for (auto h : held) {
+            push(0, h);
+        }
+        held.clear();
+    }
+
+    {
+        /* Inside a lock_guard scoped block, as we need to access the queues */
+        std::lock_guard<std::mutex> lock(flow);
+        drain = true;
+    }
+    ready.notify_all();
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    {
+        /* Inside a lock_guard scoped block, as we need to access the queues */
+        std::lock_guard<std::mutex> lock(flow);
+        queues.clear();
+    }
+
+    retire();
+}
+
+template <typename ...Z> void Pipeline<Z...>::relay(std::size_t group)
+    noexcept {
+    const auto first = groups[group];
+    const auto last  = (group + 1 < groups.size()) ? groups[group + 1] :
+                                                     stages.size();
 
-        { 
-            /* Lock and wait safely inside scoped block */
-            std::unique_lock<std::mutex> lock(suspend);
-              
-            /* If there is a not ready error and a retry pending then give it
-             * another try ! */
-            bool do_retry = (error == Error::RETRY) || 
-                            ( (error == Error::NOT_READY) && (retry) );
-
-            bool do_exit = ( (!run) || (error < 0) ||
-                             ( (error == Error::NOT_READY) && (!retry) ));
-
-            retry = false;
-
-            /* If no longer running or if an error happened, then exit */
-            if (do_exit) {
-                /* Flushing what's inside and beyond the pipeline */
-                flush();
-                run    = false;
-                halt   = false;
-                zombie = true;
-                resume.notify_all();
+    /* The frames suspended by the group, in their order. Every frame popped
+     * whilst some are suspended is queued after them, even once done, for
+     * the frames to leave the group in order */
+    std::deque<Frame *> suspended;
+
+    while (true) {
+        Frame *f       = nullptr;
+        bool   resumed = false;
+        {
+            /* Lock and wait safely for a frame to resume or to process */
+            std::unique_lock<std::mutex> lock(flow);
+            ready.wait(lock, [this, group, &suspended] {
+                       return this->drain ||
+                              ( (!suspended.empty()) &&
+                                (suspended.front()->resumable) ) ||
+                              (!this->queues[group].empty()); } );
+
+            /* The pending operations refer to their frames until they
+             * complete, hence are waited for when draining */
+            if (drain) {
+                ready.wait(lock, [&suspended] {
+                           return std::all_of(suspended.begin(),
+                                              suspended.end(),
+                                              [](const Frame *s) {
+                                                  return s->resumable; }); });
                 return;
             }
 
-            /* Notify only if not halted, and wait for halt clearance
-             * otherwise */
-            notify = (!halt) && (!do_retry); 
+            resumed = (!suspended.empty()) && (suspended.front()->resumable);
+            auto &from = resumed ? suspended : queues[group];
+            f = from.front();
+            from.pop_front();
+        }
 
-            if (halt) {
-                resume.wait(lock, [this] { return !this->halt; } );
+        /* A resumed frame carries on from its suspended stage, whereas the
+         * first group starts a new scene, and the next ones only forward
+         * the erroneous scenes to the pipeline thread */
+        if (resumed) {
+            if (f->stage < last) {
+                f->error = proceed(*f, last, Util::indices_for<Z...>());
             }
+        } else if ( (first == 0) || (f->error == Error::NONE) ) {
+            f->error = process(*f, first, last, !suspended.empty(),
+                               Util::indices_for<Z...>());
         }
 
-        if (notify) {
-            broadcast.signal(*s, *z..., error);
-            if (finished != nullptr) {
-                finished(*s, *z...);
+        /* A frame stopped at a stage is suspended, a resumed one remaining
+         * the first one in order */
+        if ( (f->error == Error::NONE) && (f->stage < last) ) {
+            suspend(*f);
+            if (resumed) {
+                suspended.push_front(f);
+            } else {
+                suspended.push_back(f);
             }
-        } 
+            continue;
+        }
+
+        if ( (!resumed) && (!suspended.empty()) ) {
+            f->stage     = last;
+            f->resumable = true;
+            suspended.push_back(f);
+            continue;
+        }
+
+        f->rehome();
+        push(group + 1, f);
     }
 }
 
+template <typename ...Z> void Pipeline<Z...>::suspend(Frame &f) noexcept {
+    /* The continuation runs in the thread completing the operation */
+    f.resumable = false;
+    auto frame  = &f;
+    f.step.operation.then([this, frame](Error::Type) {
+                              std::lock_guard<std::mutex> lock(this->flow);
+                              frame->resumable = true;
+                              this->ready.notify_all(); });
+}
+
+template <typename ...Z> typename Pipeline<Z...>::Frame *
+    Pipeline<Z...>::pop(std::size_t queue) noexcept {
+    /* Lock and wait safely for a frame to process */
+    std::unique_lock<std::mutex> lock(flow);
+    ready.wait(lock, [this, queue] { 
+               return this->drain || (!this->queues[queue].empty()); } );
+
+    if (drain) {
+        return nullptr;
+    }
+
+    auto f = queues[queue].front();
+    queues[queue].pop_front();
+
+    return f;
+}
+
+template <typename ...Z>
+    void Pipeline<Z...>::push(std::size_t queue, Frame *f) noexcept {
+    {
+        /* Inside a lock_guard scoped block, as we need to access the queues */
+        std::lock_guard<std::mutex> lock(flow);
+        queues[queue].push_back(f);
+    }
+    ready.notify_all();
+}
+
+template <typename ...Z> template <std::size_t ...I>
+    bool Pipeline<Z...>::conclude(Frame &f, Util::indices<I...>) noexcept {
+    return conclude(f.error, *f.s, *std::get<I>(f.z)...);
+}
+
 template <typename ...Z> Error::Type
-    Pipeline<Z...>::process(Scene* &s, Z*&... z) noexcept {
+    Pipeline<Z...>::process(uint64_t arrival, Scene* &s, Z*&... z) noexcept {
 
     ASSERT((!stages.empty()), "%s[%s]::process() is empty!",
-            value_to_string().c_str(), name().c_str());
+            this->value_to_string().c_str(), this->name().c_str());
     
     if (stages.empty()) {
         return Error::NOT_EXISTING;
     }
 
     prepare(s, z...);
-    for (auto &stage : stages) { 
-         auto error = stage.get().prepare(s, z...);
-         /* Stop at the the first encountered error */
-         if (error != Error::NONE) {
-             return error;
-         }
-         
-         error = stage.get().process(*s, *z...);
-         if (error != Error::NONE) {
-             return error;
-         }
+
+    return process(0, stages.size(), arrival, s, z...);
+}
+
+template <typename ...Z> bool
+    Pipeline<Z...>::shedding(std::size_t stage, uint64_t deadline) 
+    const noexcept {
+    auto p = static_cast<int>(stages[stage].get().priority);
+    if (p == 0) {
+        return false;
     }
 
-    return Error::NONE;
+    /* The downstream stages of a lower or same priority would be bypassed
+     * as well, whereas the others would still run */
+    auto needed = stages[stage].get().statistics.cost.load(
+                      std::memory_order_relaxed);
+    for (auto i = stage + 1; i < stages.size(); ++i) {
+        auto &next = stages[i].get();
+        auto q     = static_cast<int>(next.priority);
+        if ( (q == 0) || (q > p) ) {
+            needed += next.statistics.cost.load(std::memory_order_relaxed);
+        }
+    }
+
+    return Util::Histogram::now() + needed > deadline;
 }
-        
+
 template <typename ...Z>
-Customisation::Error Pipeline<Z...>::onRunningUpdate(bool yes) noexcept {
-    
-    {  
-        /* Only allow pipeline running when the component is locked! */ 
-        if (yes && ((traits() & Customisation::Trait::LOCKED) != 
-                    (Customisation::Trait::LOCKED))) {
-                return Customisation::Error::NONE;            
+void Pipeline<Z...>::plan() noexcept {
+    releases.assign(stages.size(), {});
+
+    /* A conversion is released after its last reader, unless it is the last
+     * stage, the scene being concluded or forwarded right after it */
+    for (auto m : { Image::Mode::BGR, Image::Mode::GRAY, Image::Mode::HSV,
+                    Image::Mode::YUV, Image::Mode::YCrCb }) {
+        std::size_t last = 0;
+        for (std::size_t i = 0; i < stages.size(); ++i) {
+            if (stages[i].get().consuming(m)) {
+                last = i;
+            }
         }
+        if (last + 1 < stages.size()) {
+            releases[last].emplace_back(m);
+        }
+    }
+}
 
-        /* Lock and wait safely inside scoped block */
-        std::unique_lock<std::mutex> lock(suspend);
+template <typename ...Z> uint64_t
+    Pipeline<Z...>::due(uint64_t arrival) const noexcept {
+    auto allowed = static_cast<uint64_t>(static_cast<int>(budget));
+    return (allowed > 0) ? arrival + allowed * 1000000ull : 0;
+}
 
-        /* A joinable thread is a running thread */
-        bool joinable = thread.joinable();
+template <typename ...Z> Error::Type
+    Pipeline<Z...>::process(std::size_t first, std::size_t last,
+                            uint64_t arrival, Scene* &s, Z*&... z) noexcept {
+    Util::Trace::Span span("pipeline", this->name());
 
-        /* In any case, the pipeline is no longer halted, since we modify its
-         * running status: requesting a running thread cannot be halted nor can
-         * be a stopped one! */
-        if (halt) {
-            halt = false;
-            resume.notify_all();
+    auto i = first;
+    return run(i, last, due(arrival), nullptr, false, s, z...);
+}
+
+template <typename ...Z> Error::Type
+    Pipeline<Z...>::run(std::size_t &i, std::size_t last, uint64_t deadline,
+                        Step *suspendable, bool holding, Scene* &s,
+                        Z*&... z) noexcept {
+    bool branching = forking;
+
+    while (i < last) { 
+        /* The consecutive forked stages run concurrently whilst forking */
+        auto next = i + 1;
+        while ( (branching) && (forked[i]) && (next < last) &&
+                (forked[next]) ) {
+            ++next;
         }
 
-        /* If the pipeline is in a coherent state, then leave ASAP */
-        if ( (run == yes) && (run == joinable) ) {
-            /* If requesting to start again whilst running, this is likely a
-             * retry man... */
-            if (run) { 
-                retry = true; 
-            } 
-            return Customisation::Error::NONE;
+        Error::Type error;
+        if (next - i > 1) {
+            error = branch(i, next, deadline, s, z...);
+        } else if ( (suspendable == nullptr) ||
+                    (!stages[i].get().suspendable()) ) {
+            error = step(i, deadline, s, z...);
+        } else {
+            /* Stopping at the stage whilst its operation is pending */
+            engage(i, deadline, *suspendable, s, z...);
+            if ( (holding) || (!suspendable->operation.ready()) ) {
+                return Error::NONE;
+            }
+            error = complete(i, *suspendable, *s, *z...);
         }
 
-        /* If the thread is a zombie thread, then join it */
-        if (zombie) {
-            thread.join();
-            zombie = false;
-            joinable = false;
+        /* Stop at the the first encountered error */
+        if (error != Error::NONE) {
+            return error;
         }
 
-        /* From now on, there cannot be any zombie thread */
-        if (yes != joinable) {
-            run = yes;
-            if (yes) {
-                thread = std::thread([this] { return this->launch(); } );
-                return Customisation::Error::NONE;
-            } 
-            else {
-                /* If no longer running then flush the pipeline content */
-            }
+        pass(i, next, *s);
+        i = next;
+    }
+
+    return Error::NONE;
+}
+
+template <typename ...Z>
+    void Pipeline<Z...>::pass(std::size_t first, std::size_t last,
+                              Scene &s) noexcept {
+    /* Stamping the exits of the stages for the latency breakdown, of the
+     * scene pipelines only as the zone ones run once per zone */
+    if ( (sizeof...(Z) == 0) && (profiled.load(std::memory_order_relaxed)) ) {
+        auto us = Util::Histogram::now() / 1000;
+        for (auto k = first; k < last; ++k) {
+            s.exited(stages[k].get().name(), us);
         }
+    }
 
-        /* Wait for any resume event, including a zombie notification. Use a
-         * 10 ms watchdog to mitigate race conditions with another thread that
-         * is changing the status of this pipeline */
-        resume.wait_for(lock, std::chrono::milliseconds(10));
+    /* Releasing the conversions no following stage reads, of the scene
+     * pipelines only as the zone ones run once per zone */
+    if ( (sizeof...(Z) == 0) && (releasing) ) {
+        for (auto k = first; k < last; ++k) {
+            for (auto &m : releases[k]) {
+                s.view.release(m);
+            }
+        }
     }
+}
+
+template <typename ...Z> Error::Type
+    Pipeline<Z...>::step(std::size_t i, uint64_t deadline, Scene* &s,
+                         Z*&... z) noexcept {
+    Step current;
+    engage(i, deadline, current, s, z...);
 
-    /* Tail recursion only, BUT keep it outside the unique_lock scope block to
-     * prevent deadlocks... */
-    return onRunningUpdate(yes);
+    return complete(i, current, *s, *z...);
 }
 
 template <typename ...Z>
-Customisation::Error Pipeline<Z...>::onFrozenUpdate(bool yes) noexcept {    
-    /* Inside a lock_guard scoped block, as we need to access thread status
-     * variables */
-    std::lock_guard<std::mutex> lock(suspend);
-
-    /* If the pipeline is not running or if it is in the right state, then we
-     * are done */
-    if (halt == (yes && run)) {
-        return Customisation::Error::NONE;
-    } 
-    
-    /* Update the halt status and notify the pipeline, once out of the mutex */
-    halt = yes & run;
-    resume.notify_all();
+    void Pipeline<Z...>::engage(std::size_t i, uint64_t deadline, Step &st,
+                                Scene* &s, Z*&... z) noexcept {
+    auto &stage  = stages[i].get();
+    st.processed = false;
+    st.launched  = false;
+    if ( (deadline != 0) && (shedding(i, deadline)) ) {
+        stage.statistics.shed.fetch_add(1, std::memory_order_relaxed);
+        st.operation = Operation(Error::NONE);
+        return;
+    }
+
+    Util::Trace::Span traced("stage", stage.name());
+    st.profiled = stage.profiling();
+    st.timed    = (st.profiled) || (deadline != 0);
+    st.started  = st.timed ? Util::Histogram::now() : 0;
+    auto heap   = st.profiled ? Util::Allocation::thread() :
+                                Util::Allocation::Counters{ 0, 0 };
+    auto error  = stage.prepare(s, z...);
+    if (st.profiled) {
+        stage.statistics.record(stage.statistics.preparing, st.started,
+                                error);
+    }
+    if (error != Error::NONE) {
+        st.operation = Operation(error);
+        return;
+    }
     
-    return Customisation::Error::NONE;
+    /* Only the stages which are not specialised are launched, the other
+     * ones being processed right away */
+    st.prepared  = st.timed ? Util::Histogram::now() : 0;
+    st.processed = true;
+    st.launched  = stage.suspendable();
+    st.operation = (st.launched) ? stage.launch(*s, *z...) :
+                                   Operation(stage.process(*s, *z...));
+
+    /* The allocations of a suspended scene are only accounted until its
+     * launch, as the thread works on other scenes meanwhile */
+    if (st.profiled) {
+        stage.statistics.account(heap);
+    }
+}
+
+template <typename ...Z> Error::Type
+    Pipeline<Z...>::complete(std::size_t i, Step &st, Scene &s,
+                             Z&... z) noexcept {
+    if (!st.processed) {
+        return st.operation.wait();
+    }
+
+    auto &stage = stages[i].get();
+    auto error  = (st.launched) ? stage.resume(st.operation, s, z...) :
+                                  st.operation.wait();
+    if (st.profiled) {
+        stage.statistics.record(stage.statistics.processing, st.prepared, 
+                                error);
+    }
+    if ( (error == Error::NONE) && (st.timed) ) {
+        stage.statistics.estimate(Util::Histogram::now() - st.started);
+    }
+
+    return error;
+}
+
+template <typename ...Z> Error::Type
+    Pipeline<Z...>::branch(std::size_t first, std::size_t last,
+                           uint64_t deadline, Scene* &s, Z*&... z) noexcept {
+    Util::Trace::Span span("pipeline", "fork");
+    using Resource = typename Stage::Resource;
+
+    /* Converting the images read by the branches once for all of them, as
+     * the branches share the images cached in the view of the scene */
+    std::vector<Image::Mode> modes;
+    for (auto i = first; i < last; ++i) {
+        for (auto &m : stages[i].get().converting()) {
+            if (std::find(modes.begin(), modes.end(), m) == modes.end()) {
+                modes.push_back(m);
+            }
+        }
+    }
+    if (!modes.empty()) {
+        s->view.prefetch(modes);
+    }
+
+    /* Every branch starts from the scene, with its zones only if read */
+    const auto           n = last - first;
+    std::vector<Scene *> scenes(n);
+    std::vector<std::size_t> kept(n, 0);
+    for (auto i = first; i < last; ++i) {
+        auto &b = *branches[i];
+        if ((stages[i].get().reading() & Resource::ZONES) != 0) {
+            s->remember(b);
+            kept[i - first] = b.zones().size();
+        } else {
+            b.clear();
+            b.view = s->view;
+        }
+        b.still(s->still());
+        b.keyframe(s->keyframe());
+        scenes[i - first] = &b;
+    }
+
+    /* The first branch is run by the calling thread and the others by the
+     * task pool, which the calling thread helps whilst waiting */
+    std::vector<Error::Type>      errors(n, Error::NONE);
+    std::vector<std::future<int>> pending;
+    auto &pool = Util::Task::Pool::instance();
+    for (auto i = first + 1; i < last; ++i) {
+        Util::Task::Core::Work work = 
+            [this, i, first, deadline, &scenes, &errors, &z...]() noexcept {
+                auto k    = i - first;
+                errors[k] = step(i, deadline, scenes[k], z...);
+                return 0; };
+        pending.emplace_back((pool.size() > 0) ? pool.submit(work) :
+                             std::async(std::launch::async, work));
+    }
+    errors[0] = step(first, deadline, scenes[0], z...);
+    for (auto &p : pending) {
+        while ( (p.wait_for(std::chrono::seconds(0)) != 
+                 std::future_status::ready) && (pool.help()) ) {}
+        p.get();
+    }
+
+    /* Joining the branches in order: merging the zones they added, and
+     * reporting the error of the first failing one */
+    auto error = Error::NONE;
+    for (auto i = first; i < last; ++i) {
+        auto k = i - first;
+        auto b = scenes[k];
+        if ((stages[i].get().writing() & Resource::ZONES) != 0) {
+            auto zones = b->extract([](const Zone &) noexcept { 
+                                        return true; });
+            auto added = zones.begin();
+            std::advance(added, std::min(kept[k], zones.size()));
+            for (; added != zones.end(); ++added) {
+                s->mark(std::move(*added));
+            }
+            b->recycle(zones);
+        }
+        if (b->keyframe()) {
+            s->keyframe(true);
+        }
+        if ( (error == Error::NONE) && (errors[k] != Error::NONE) ) {
+            error = errors[k];
+        }
+
+        /* Releasing the images of the branch until the next scene */
+        branches[i]->clear();
+    }
+
+    return error;
+}
+
+template <typename ...Z> template <std::size_t ...I> Error::Type
+    Pipeline<Z...>::process(Frame &f, std::size_t first, std::size_t last,
+                            bool holding, Util::indices<I...>) noexcept {
+
+    /* Starting a new scene within the frame own storage */
+    if (first == 0) {
+        f.reset();
+        prepare(f.s, std::get<I>(f.z)...);
+    }
+
+    Util::Trace::Span span("pipeline", this->name());
+    f.stage    = first;
+    f.deadline = due(f.started);
+
+    return run(f.stage, last, f.deadline, &f.step, holding, f.s,
+               std::get<I>(f.z)...);
+}
+
+template <typename ...Z> template <std::size_t ...I> Error::Type
+    Pipeline<Z...>::proceed(Frame &f, std::size_t last,
+                            Util::indices<I...>) noexcept {
+    auto error = complete(f.stage, f.step, *f.s, *std::get<I>(f.z)...);
+    if (error != Error::NONE) {
+        return error;
+    }
+
+    /* Carrying on with the next stages, as the first scene in order */
+    Util::Trace::Span span("pipeline", this->name());
+    pass(f.stage, f.stage + 1, *f.s);
+    ++f.stage;
+
+    return run(f.stage, last, f.deadline, &f.step, false, f.s,
+               std::get<I>(f.z)...);
 }
 
 }  // namespace Core
@@ -0,0 +1,576 @@
+/**
+ *
+ * @file      vpp/core/runner.tpl.hpp
+ *
+ * @brief     This is the VPP pipeline runner implementation
+ *
+ * @details   This is the class for running any pipeline
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#pragma once
+
+#include <tuple>
+#include <utility>
+
+#include "vpp/core/runner.hpp"
+#include "vpp/log.hpp"
+#include "vpp/util/task.hpp"
+#include "vpp/util/trace.hpp"
+
+namespace VPP {
+namespace Core {
+
+template <typename ...Z> Runner<Z...>::Runner() noexcept
+    : Customisation::Entity("Pipeline"), broadcast(), finished(), measured(),
+      stages(), state(State::IDLE), retry(false), halt(false),
+      dismissed(false), resume(), suspend(), thread(), profiled(false),
+      deferred(), pending(), latency(), capture(), held_images(0),
+      held_zones(0), held_contours(0), published(0), exported(0) {
+    /* Define the running parameter */
+    running.denominate("running");
+    running.describe("Is the pipeline running ?");
+    running = false;
+    running.use(Customisation::Translator::BoolFormat::NO_YES);
+    running.trigger([this](const bool &yes) {
+                    return this->onRunningUpdate(yes); });
+    expose(running).characterise(Customisation::Trait::SETTABLE);
+
+    /* Define the frozen parameter */
+    frozen.denominate("frozen");
+    frozen.describe("Is the pipeline frozen ?");
+    frozen = false;
+    frozen.use(Customisation::Translator::BoolFormat::NO_YES);
+    frozen.trigger([this](const bool &yes) {
+                   return this->onFrozenUpdate(yes); });
+    expose(frozen).characterise(Customisation::Trait::SETTABLE);
+
+    /* Define the priority parameter */
+    priority.denominate("priority");
+    priority.describe("The priority of the tasks of the pipeline: critical "
+                      "ones preempting the normal and background ones");
+    priority.define(
+        { { "critical",   Util::Task::Priority::Critical },
+          { "normal",     Util::Task::Priority::Normal },
+          { "background", Util::Task::Priority::Background } });
+    priority = Util::Task::Priority::Normal;
+    expose(priority).characterise(Customisation::Trait::SETTABLE);
+
+    /* Define the affinity parameter */
+    affinity.denominate("affinity");
+    affinity.describe("The cores running the pipeline: indices and ranges "
+                      "such as 0-3,6, big or little, or empty for any core");
+    affinity = "";
+    expose(affinity).characterise(Customisation::Trait::SETTABLE);
+
+    /* Define the profiling parameter */
+    profiling.denominate("profiling");
+    profiling.describe("Are the latencies and counters of the stages "
+                       "recorded ?");
+    profiling = false;
+    profiling.use(Customisation::Translator::BoolFormat::NO_YES);
+    profiling.trigger([this](const bool &yes) {
+                      return this->onProfilingUpdate(yes); });
+    expose(profiling).characterise(Customisation::Trait::SETTABLE);
+
+    /* Define the metrics parameter */
+    metrics.denominate("metrics");
+    metrics.describe("The end to end latency of the scenes, as last "
+                     "published whilst profiling");
+    expose(metrics);
+
+    /* Export the metrics whenever the registry is collected */
+    exported = Util::Metrics::Registry::instance().attach(
+        [this](Util::Metrics::Exposition &e) { collect(e); });
+}
+
+template <typename ...Z> Runner<Z...>::~Runner() noexcept {
+    Util::Metrics::Registry::instance().detach(exported);
+
+    /* Cleanly exit the thread to prevent program termination */
+    terminate();
+}
+
+template <typename ...Z> void Runner<Z...>::terminate() noexcept {
+    /* Cleanly exit the thread to prevent program termination */
+    unfreeze();
+    stop();
+
+    {
+        /* Inside a lock_guard scoped block, as we need to access the thread
+         * status variables */
+        std::lock_guard<std::mutex> lock(suspend);
+        dismissed = true;
+    }
+    resume.notify_all();
+
+    /* The parked thread needs the lock for exiting */
+    if (thread.joinable()) {
+        thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(suspend);
+    dismissed = false;
+    state     = State::IDLE;
+}
+
+template <typename ...Z> void Runner<Z...>::start() noexcept {
+    running = true;
+}
+
+template <typename ...Z> void Runner<Z...>::stop() noexcept {
+    running = false;
+}
+
+template <typename ...Z> void Runner<Z...>::freeze() noexcept {
+    frozen = true;
+}
+
+template <typename ...Z> void Runner<Z...>::unfreeze() noexcept {
+    frozen = false;
+}
+
+template <typename ...Z>
+    void Runner<Z...>::defer(std::function<void ()> change) noexcept {
+    {
+        /* Inside a lock_guard scoped block, as we need to access the thread
+         * status variables: the changes are queued whilst the thread runs,
+         * which retires only after having applied all of them */
+        std::lock_guard<std::mutex> lock(suspend);
+        if (state != State::IDLE) {
+            std::lock_guard<std::mutex> queue(pending);
+            deferred.emplace_back(std::move(change));
+            return;
+        }
+    }
+
+    change();
+}
+
+template <typename ...Z> void Runner<Z...>::settle() noexcept {
+    std::vector<std::function<void ()>> changes;
+    {
+        /* Inside a lock_guard scoped block, as we need to access the queue */
+        std::lock_guard<std::mutex> lock(pending);
+        changes.swap(deferred);
+    }
+
+    /* The changes run out of the locks, for they may well set the running
+     * or frozen status of the pipeline */
+    for (auto &change : changes) {
+        change();
+    }
+}
+
+template <typename ...Z> void Runner<Z...>::bind(Stage &stage) noexcept {
+    {
+        /* Inside a lock_guard scoped block */
+        std::lock_guard<std::mutex> lock(suspend);
+
+        /* This shall never happen */
+        ASSERT((state == State::IDLE),
+               "%s[%s]::bind() called whilst thread is running!",
+                 value_to_string().c_str(), name().c_str());
+
+        stages.emplace_back(stage);
+        stage.profile(profiled);
+    }
+
+    ASSERT((!stage.name().empty()),
+            "%s[%s]::bind() cannot bind an unnamed stage!",
+            value_to_string().c_str(), name().c_str());
+
+    expose(stage);
+}
+
+template <typename ...Z> void Runner<Z...>::plan() noexcept {}
+
+template <typename ...Z> void Runner<Z...>::serve() noexcept {
+    std::unique_lock<std::mutex> lock(suspend);
+
+    while (true) {
+        resume.wait(lock, [this] {
+                    return (this->dismissed) ||
+                           (this->state == State::RUNNING); } );
+        if (dismissed) {
+            return;
+        }
+
+        /* Running the pipeline, out of the lock, until it halts or fails,
+         * its workers and tasks inheriting its priority and cores */
+        lock.unlock();
+        {
+            Util::Task::Priority::Scope scope(priority);
+            auto cores = static_cast<std::string>(affinity);
+            if (!cores.empty()) {
+                Util::Affinity::pin(Util::Affinity::parse(cores));
+            }
+            launch();
+        }
+        lock.lock();
+    }
+}
+
+template <typename ...Z> void Runner<Z...>::launch() noexcept {
+    launch(Util::indices_for<Z...>());
+}
+
+template <typename ...Z> template <std::size_t ...I>
+    void Runner<Z...>::launch(Util::indices<I...>) noexcept {
+    Scene             scene;
+    std::tuple<Z...>  storage;
+    std::tuple<Z*...> z(&std::get<I>(storage)...);
+    auto s = &scene;
+
+    return work(s, std::get<I>(z)...);
+}
+
+template <typename ...Z>
+    void Runner<Z...>::work(Scene* &s, Z*&... z) noexcept {
+    bool carry_on = true;
+
+    while (carry_on) {
+        /* No stage is running between two frames */
+        settle();
+
+        auto started = Util::Histogram::now();
+        auto error   = process(started, s, z...);
+        measure(started, *s);
+        carry_on = conclude(error, *s, *z...);
+    }
+
+    retire();
+}
+
+template <typename ...Z>
+    void Runner<Z...>::prepare(Scene*& s, Z*&... z) noexcept {
+    /* Recycling the scene keeps its zone nodes for the next frame, whereas
+     * the zones of a zone pipeline belong to their scene */
+    if (sizeof...(Z) == 0) {
+        s->clear();
+    }
+    int reset[] = { 0, (*z = std::move(Z()), 0)... };
+    (void) reset;
+}
+
+template <typename ...Z>
+bool Runner<Z...>::conclude(Error::Type error, Scene &s, Z&... z) noexcept {
+    bool notify = false;
+
+    /* Error handling: exiting with broken empty scene */
+    if (error) {
+
+        /* Only broadcast actual errors and not retry or not ready status */
+        if (error < 0) {
+            LOGE("%s[%s]:process() error %d!",
+                  value_to_string().c_str(), name().c_str(), error);
+            broadcast.signal(s, z..., error);
+        }
+    }
+
+    {
+        /* Lock and wait safely inside scoped block */
+        std::unique_lock<std::mutex> lock(suspend);
+
+        /* If there is a not ready error and a retry pending then give it
+         * another try ! */
+        bool do_retry = (error == Error::RETRY) ||
+                        ( (error == Error::NOT_READY) && (retry) );
+
+        bool do_exit = ( (state != State::RUNNING) || (error < 0) ||
+                         ( (error == Error::NOT_READY) && (!retry) ));
+
+        retry = false;
+
+        /* If no longer running or if an error happened, then exit */
+        if (do_exit) {
+            /* Flushing what's inside and beyond the pipeline */
+            flush();
+            state  = State::HALTING;
+            halt   = false;
+            return false;
+        }
+
+        /* Notify only if not halted, and wait for halt clearance
+         * otherwise */
+        notify = (!halt) && (!do_retry);
+
+        if (halt) {
+            Util::Trace::Span frozen("pipeline", "frozen");
+            resume.wait(lock, [this] { return !this->halt; } );
+        }
+    }
+
+    if (notify) {
+        broadcast.signal(s, z..., error);
+        if (finished != nullptr) {
+            finished(s, z...);
+        }
+    }
+
+    return true;
+}
+
+template <typename ...Z> bool Runner<Z...>::deferring() noexcept {
+    /* Inside a lock_guard scoped block, as we need to access the queue */
+    std::lock_guard<std::mutex> lock(pending);
+    return !deferred.empty();
+}
+
+template <typename ...Z> void Runner<Z...>::retire() noexcept {
+    /* Lock and wait safely for the thread transitions */
+    std::unique_lock<std::mutex> lock(suspend);
+
+    /* Applying the changes deferred until the thread retired before getting
+     * idle, so that the ones deferred meanwhile are queued after them, and
+     * that the pipeline cannot be restarted whilst they are applied */
+    while (deferring()) {
+        lock.unlock();
+        settle();
+        lock.lock();
+    }
+
+    /* Unless one of these changes has restarted the pipeline */
+    if (state != State::RUNNING) {
+        state = State::IDLE;
+    }
+    resume.notify_all();
+}
+
+template <typename ...Z>
+Customisation::Error Runner<Z...>::onRunningUpdate(bool yes) noexcept {
+    /* Only allow pipeline running when the component is locked! */
+    if (yes && ((traits() & Customisation::Trait::LOCKED) !=
+                (Customisation::Trait::LOCKED))) {
+            return Customisation::Error::NONE;
+    }
+
+    /* Only run once all the engines set up at startup are ready */
+    if (yes) {
+        auto error = Util::Task::Startup::instance().wait();
+        if (error) {
+            LOGE("%s[%s]::start(): Cannot start with engines failing their "
+                 "setup (error %d)!", value_to_string().c_str(),
+                 name().c_str(), error);
+            return static_cast<Customisation::Error>(error);
+        }
+    }
+
+    /* Lock and wait safely for the thread transitions */
+    std::unique_lock<std::mutex> lock(suspend);
+
+    /* The deferred changes run on the pipeline thread, which shall never
+     * wait for its own transitions */
+    bool own = (std::this_thread::get_id() == thread.get_id());
+
+    /* In any case, the pipeline is no longer halted, since we modify its
+     * running status: requesting a running thread cannot be halted nor can
+     * be a stopped one! */
+    if (halt) {
+        halt = false;
+        resume.notify_all();
+    }
+
+    while (true) {
+        switch (state) {
+            case State::RUNNING:
+                /* If requesting to start again whilst running, this is likely
+                 * a retry man... */
+                if (yes) {
+                    retry = true;
+                    return Customisation::Error::NONE;
+                }
+
+                /* The thread exits once it concludes its current scene */
+                state = State::HALTING;
+                resume.notify_all();
+                if (own) {
+                    return Customisation::Error::NONE;
+                }
+                break;
+
+            case State::IDLE:
+                /* Waking up the parked thread, or creating it on the first
+                 * run of the pipeline */
+                if (yes) {
+                    plan();
+                    state = State::RUNNING;
+                    if (thread.joinable()) {
+                        resume.notify_all();
+                    } else {
+                        thread = std::thread([this] {
+                                                 return this->serve(); } );
+                    }
+                }
+                return Customisation::Error::NONE;
+
+            case State::HALTING:
+                /* The thread applying its deferred changes keeps running
+                 * when restarted, and retires otherwise */
+                if (own) {
+                    if (yes) {
+                        state = State::RUNNING;
+                    }
+                    return Customisation::Error::NONE;
+                }
+
+                /* Wait for the thread to park, it notifies it */
+                resume.wait(lock, [this] {
+                            return this->state != State::HALTING; } );
+                break;
+        }
+    }
+}
+
+template <typename ...Z>
+Customisation::Error Runner<Z...>::onFrozenUpdate(bool yes) noexcept {
+    /* Inside a lock_guard scoped block, as we need to access thread status
+     * variables */
+    std::lock_guard<std::mutex> lock(suspend);
+
+    /* If the pipeline is not running or if it is in the right state, then we
+     * are done */
+    bool run = (state == State::RUNNING);
+    if (halt == (yes && run)) {
+        return Customisation::Error::NONE;
+    }
+
+    /* Update the halt status and notify the pipeline, once out of the mutex */
+    halt = yes & run;
+    resume.notify_all();
+
+    return Customisation::Error::NONE;
+}
+
+template <typename ...Z>
+Customisation::Error Runner<Z...>::onProfilingUpdate(bool yes) noexcept {
+    /* Inside a lock_guard scoped block, as we need to access the stages */
+    std::lock_guard<std::mutex> lock(suspend);
+
+    if ( (yes) && (!profiled) ) {
+        latency.reset();
+        capture.reset();
+        published = Util::Histogram::now();
+    }
+    profiled = yes;
+    for (auto &stage : stages) {
+        stage.get().profile(yes);
+    }
+
+    return Customisation::Error::NONE;
+}
+
+template <typename ...Z>
+void Runner<Z...>::measure(uint64_t started, Scene &s) noexcept {
+    auto recording = profiled.load(std::memory_order_relaxed);
+    if ( (!recording) && (!measured) ) {
+        return;
+    }
+
+    auto now = Util::Histogram::now();
+    if (measured) {
+        measured(now - started);
+    }
+    if (!recording) {
+        return;
+    }
+    latency.record(now - started);
+
+    /* The capture latency adds the time the scene waited for the pipeline,
+     * since the capture time of its view */
+    auto captured = s.view.clock_us() * 1000;
+    if ( (captured != 0) && (captured < now) ) {
+        capture.record(now - captured);
+        Util::Trace::span("pipeline", "capture", captured);
+    }
+
+    /* Only a single thread concludes the scenes, hence publishes */
+    if (now - published.load(std::memory_order_relaxed) < 1000000000ull) {
+        return;
+    }
+    published.store(now, std::memory_order_relaxed);
+
+    /* The memory held by the scene is only accounted when published */
+    auto held = s.footprint();
+    held_images.store(held.images, std::memory_order_relaxed);
+    held_zones.store(held.zones, std::memory_order_relaxed);
+    held_contours.store(held.contours, std::memory_order_relaxed);
+
+    metrics = "scenes " + std::to_string(latency.count()) + "; latency " +
+              latency.summary() + "; capture " + capture.summary() +
+              "; held " + std::to_string(held.images) + " image, " +
+              std::to_string(held.zones) + " zone and " +
+              std::to_string(held.contours) + " contour bytes";
+    for (auto &stage : stages) {
+        stage.get().publish();
+    }
+}
+
+template <typename ...Z>
+void Runner<Z...>::collect(Util::Metrics::Exposition &e) noexcept {
+    /* Inside a lock_guard scoped block, as we need to access the stages */
+    std::lock_guard<std::mutex> lock(suspend);
+
+    auto labels = "pipeline=" + Util::Metrics::Exposition::quote(name());
+    e.summary("vpp_pipeline_latency_seconds",
+              "End to end latency of the scenes whilst profiling", labels,
+              latency);
+    e.summary("vpp_pipeline_capture_latency_seconds",
+              "Latency of the scenes since their capture whilst profiling",
+              labels, capture);
+    e.gauge("vpp_scene_image_bytes",
+            "Bytes of the images held by the last published scene", labels,
+            held_images.load(std::memory_order_relaxed));
+    e.gauge("vpp_scene_zone_bytes",
+            "Bytes of the zones held by the last published scene", labels,
+            held_zones.load(std::memory_order_relaxed));
+    e.gauge("vpp_scene_contour_bytes",
+            "Bytes of the contours held by the last published scene", labels,
+            held_contours.load(std::memory_order_relaxed));
+
+    for (auto &stage : stages) {
+        const auto &s = stage.get().statistics;
+        auto l = labels + ",stage=" +
+                 Util::Metrics::Exposition::quote(stage.get().name());
+        e.summary("vpp_stage_prepare_seconds",
+                  "Preparation latency of the stages whilst profiling", l,
+                  s.preparing);
+        e.summary("vpp_stage_process_seconds",
+                  "Processing latency of the stages whilst profiling", l,
+                  s.processing);
+        e.counter("vpp_stage_frames_total", "Frames processed by the stages",
+                  l, s.frames.load(std::memory_order_relaxed));
+        e.counter("vpp_stage_retries_total", "Frames retried by the stages",
+                  l, s.retries.load(std::memory_order_relaxed));
+        e.counter("vpp_stage_unready_total",
+                  "Frames the stages were not ready for", l,
+                  s.unready.load(std::memory_order_relaxed));
+        e.counter("vpp_stage_errors_total", "Frames failed by the stages",
+                  l, s.failures.load(std::memory_order_relaxed));
+        if (Util::Allocation::tracked()) {
+            e.counter("vpp_stage_allocations_total",
+                      "Heap allocations of the stages whilst profiling", l,
+                      s.allocations.load(std::memory_order_relaxed));
+            e.counter("vpp_stage_allocated_bytes_total",
+                      "Bytes allocated by the stages whilst profiling", l,
+                      s.allocated.load(std::memory_order_relaxed));
+        }
+        e.counter("vpp_stage_shed_total",
+                  "Frames the optional stages were bypassed for", l,
+                  s.shed.load(std::memory_order_relaxed));
+        e.gauge("vpp_stage_cost_seconds",
+                "Moving average of the cost of the stages", l,
+                s.cost.load(std::memory_order_relaxed) / 1e9);
+    }
+}
+
+}  // namespace Core
+}  // namespace VPP
@@ -18,6 +18,9 @@
 
 #pragma once
 
+#include <algorithm>
+#include <thread>
+
 #include "vpp/log.hpp"
 #include "vpp/core/stage.hpp"
 
@@ -25,8 +28,11 @@ namespace VPP {
 namespace Core {
 
 template <typename ...Z> Stage<Z...>::Stage(bool update) noexcept 
-    : Customisation::Entity("Stage"), filter(), broadcast(), skipped(false),
-      runpdatable(update), engines(), pEngine(nullptr), suspend() {
+    : Customisation::Entity("Stage"), filter(), broadcast(), beat(0),
+      last(0), reads(Resource::ZONES | Resource::VIEW),
+      writes(Resource::ZONES | Resource::VIEW), modes(), consumed(),
+      restricted(false), runpdatable(update), engines(), selections(),
+      epoch(0), suspend("stage"), profiled(false) {
 
     /* Define the bypassed parameter */
     bypassed.denominate("bypassed")
@@ -49,6 +55,40 @@ template <typename ...Z> Stage<Z...>::Stage(bool update) noexcept
     disabled.trigger([this](const bool &yes) { 
                      return onDisabledUpdate(yes); });
     expose(disabled);
+
+    /* Define the priority parameter */
+    priority.denominate("priority")
+            .describe("The shedding priority of the stage: 0 if it is "
+                      "essential, otherwise the lower the priority, the "
+                      "sooner it is bypassed when a scene is late")
+            .characterise(Customisation::Trait::SETTABLE);
+    priority.range(0, 100);
+    priority = 0;
+    expose(priority);
+
+    /* Define the decimation parameters */
+    every.denominate("every")
+         .describe("The stage only processes one scene out of every")
+         .characterise(Customisation::Trait::SETTABLE);
+    every.range(1, 1000);
+    every = 1;
+    expose(every);
+
+    phase.denominate("phase")
+         .describe("The count, modulo every, of the scenes the stage "
+                   "processes, for spreading the decimated stages")
+         .characterise(Customisation::Trait::SETTABLE);
+    phase.range(0, 999);
+    phase = 0;
+    expose(phase);
+
+    aligned.denominate("aligned")
+           .describe("Is the count of the scenes restarted on every detected "
+                     "scene ?")
+           .characterise(Customisation::Trait::SETTABLE);
+    aligned = false;
+    aligned.use(Customisation::Translator::BoolFormat::NO_YES);
+    expose(aligned);
             
     /* Define the uses parameter */
     engine.denominate("uses")
@@ -57,6 +97,92 @@ template <typename ...Z> Stage<Z...>::Stage(bool update) noexcept
     engine.trigger([this](const std::string &eng) { 
                    return onEngineUpdate(eng); });
     expose(engine);
+
+    /* Define the metrics parameter */
+    metrics.denominate("metrics")
+           .describe("The latencies and counters of the stage, as last "
+                     "published whilst its pipeline is profiling");
+    expose(metrics);
+}
+
+template <typename ...Z> Stage<Z...>::Selection::Selection() noexcept
+    : engine(nullptr), skipped(false), users(0), retired(nullptr) {}
+
+template <typename ...Z> Stage<Z...>::Statistics::Statistics() noexcept
+    : preparing(), processing(), frames(0), retries(0), unready(0), 
+      failures(0), allocations(0), allocated(0), cost(0), shed(0) {}
+
+template <typename ...Z> void Stage<Z...>::Statistics::reset() noexcept {
+    preparing.reset();
+    processing.reset();
+    frames      = 0;
+    retries     = 0;
+    unready     = 0;
+    failures    = 0;
+    allocations = 0;
+    allocated   = 0;
+}
+
+template <typename ...Z> 
+    void Stage<Z...>::Statistics::record(Util::Histogram &h, uint64_t since,
+                                         Error::Type error) noexcept {
+    h.record(Util::Histogram::now() - since);
+    if (error == Error::RETRY) {
+        retries.fetch_add(1, std::memory_order_relaxed);
+    } else if (error == Error::NOT_READY) {
+        unready.fetch_add(1, std::memory_order_relaxed);
+    } else if (error < 0) {
+        failures.fetch_add(1, std::memory_order_relaxed);
+    } else if (&h == &processing) {
+        frames.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+template <typename ...Z> 
+    void Stage<Z...>::Statistics::estimate(uint64_t ns) noexcept {
+    /* Only the worker of the stage updates its cost, as a 1/8 average */
+    auto c = cost.load(std::memory_order_relaxed);
+    cost.store((c == 0) ? ns : c - (c >> 3) + (ns >> 3),
+               std::memory_order_relaxed);
+}
+
+template <typename ...Z> void Stage<Z...>::Statistics::account(
+    const Util::Allocation::Counters &before) noexcept {
+    if (!Util::Allocation::tracked()) {
+        return;
+    }
+
+    auto spent = Util::Allocation::since(before);
+    allocations.fetch_add(spent.allocations, std::memory_order_relaxed);
+    allocated.fetch_add(spent.bytes, std::memory_order_relaxed);
+}
+
+template <typename ...Z> 
+    std::string Stage<Z...>::Statistics::summary() const {
+    auto text = "frames " + std::to_string(frames.load()) + 
+                ", retries " + std::to_string(retries.load()) +
+                ", not ready " + std::to_string(unready.load()) +
+                ", errors " + std::to_string(failures.load()) +
+                ", shed " + std::to_string(shed.load()) +
+                "; prepare " + preparing.summary() + 
+                "; process " + processing.summary();
+    if (Util::Allocation::tracked()) {
+        text += "; allocations " + std::to_string(allocations.load()) +
+                ", bytes " + std::to_string(allocated.load());
+    }
+
+    return text;
+}
+
+template <typename ...Z> void Stage<Z...>::profile(bool yes) noexcept {
+    if ( (yes) && (!profiling()) ) {
+        statistics.reset();
+    }
+    profiled.store(yes, std::memory_order_relaxed);
+}
+
+template <typename ...Z> void Stage<Z...>::publish() noexcept {
+    metrics = statistics.summary();
 }
 
 template <typename ...Z> void Stage<Z...>::bypass(bool yes) noexcept {
@@ -78,7 +204,7 @@ Customisation::Error Stage<Z...>::use(const std::string id,
     
     {
         /* Inside a lock_guard scoped block */
-        std::lock_guard<std::mutex> lock(suspend);
+        std::lock_guard<Util::Mutex> lock(suspend);
 
         engines.emplace(id, engine);
 
@@ -97,65 +223,184 @@ Customisation::Error Stage<Z...>::use(const std::string &id) noexcept {
     return engine.set(id);
 }
 
+template <typename ...Z>
+    typename Stage<Z...>::Selection &Stage<Z...>::enter() noexcept {
+    /* The selection is only entered if still the published one once its
+     * users are counted, as the one before it may be being recycled */
+    for (;;) {
+        auto e    = epoch.load(std::memory_order_seq_cst);
+        auto &sel = selections[e & 1];
+        sel.users.fetch_add(1, std::memory_order_seq_cst);
+        if (epoch.load(std::memory_order_seq_cst) == e) {
+            return sel;
+        }
+        leave(sel);
+    }
+}
+
+template <typename ...Z>
+    void Stage<Z...>::leave(Selection &sel) noexcept {
+    if ( (sel.users.fetch_sub(1, std::memory_order_acq_rel) == 1) &&
+         (sel.retired.load(std::memory_order_acquire) != nullptr) ) {
+        settle(sel);
+    }
+}
+
+template <typename ...Z>
+    void Stage<Z...>::settle(Selection &sel) noexcept {
+    /* Either the last user or the publisher disables it, but only once */
+    auto retired = sel.retired.exchange(nullptr, std::memory_order_acq_rel);
+    if (retired != nullptr) {
+        retired->disable();
+    }
+}
+
+template <typename ...Z>
+    void Stage<Z...>::select(Engine *eng, bool skip) noexcept {
+    auto e     = epoch.load(std::memory_order_relaxed);
+    auto &cur  = selections[e & 1];
+    auto &next = selections[(e + 1) & 1];
+
+    /* The frames still in the selection before the current one are only
+     * about to leave it, as they entered it at least two updates ago, or
+     * awaiting its engine */
+    while (next.users.load(std::memory_order_seq_cst) != 0) {
+        std::this_thread::yield();
+    }
+    settle(next);
+
+    /* Enabling the new engine only now, as it may just have been retired */
+    if ( (eng != nullptr) && (eng != cur.engine) ) {
+        eng->enable();
+    }
+
+    next.engine  = eng;
+    next.skipped = skip;
+    epoch.store(e + 1, std::memory_order_seq_cst);
+
+    /* The replaced engine is disabled once its last frame has left it */
+    if ( (cur.engine != nullptr) && (cur.engine != eng) ) {
+        cur.retired.store(cur.engine, std::memory_order_release);
+        if (cur.users.load(std::memory_order_seq_cst) == 0) {
+            settle(cur);
+        }
+    }
+}
+
 template <typename ...Z>
     Error::Type Stage<Z...>::prepare(Scene*& s, Z*&...z) noexcept {
+    auto &sel = enter();
+    ASSERT((sel.engine != nullptr),
+            "%s[%s]::prepare() has no valid engine set!",
+            value_to_string().c_str(), name().c_str());
+
+    auto error = Error::NOT_EXISTING;
+    if (sel.engine != nullptr) {
+        error = sel.engine->prepare(s, z...);
+    }
+    leave(sel);
 
-    Engine *the_engine = nullptr;
-    
-    {
-        /* Inside a lock_guard scoped block */
-        std::lock_guard<std::mutex> lock(suspend);
+    return error;
+}
+
+template <typename ...Z>
+    void Stage<Z...>::declare(int r, int w, std::vector<Image::Mode> m)
+    noexcept {
+    reads      = r;
+    writes     = w;
+    modes      = std::move(m);
+    restricted = true;
+}
+
+template <typename ...Z>
+    void Stage<Z...>::consume(std::vector<Image::Mode> m) noexcept {
+    consumed   = std::move(m);
+    restricted = true;
+}
 
-        ASSERT((pEngine != nullptr),
-                "%s[%s]::prepare() has no valid engine set!",
-                value_to_string().c_str(), name().c_str());
-         the_engine = pEngine;
+template <typename ...Z>
+    bool Stage<Z...>::consuming(const Image::Mode &mode) const noexcept {
+    if (!restricted) {
+        return true;
     }
 
-    if  (the_engine != nullptr) {
-        return the_engine->prepare(s, z...);
-    } else {
-        return Error::NOT_EXISTING;
+    return (std::find(modes.begin(), modes.end(), mode) != modes.end()) ||
+           (std::find(consumed.begin(), consumed.end(), mode) !=
+            consumed.end());
+}
+
+template <typename ...Z>
+    bool Stage<Z...>::due(const Scene &s) noexcept {
+    /* The stages of a pipeline process the scenes in order, and the zone
+     * stages process all the zones of a scene in a row, the scenes being told
+     * apart by their sequence numbers as frames may share a time stamp */
+    if (s.sequence() != last) {
+        last = s.sequence();
+        beat = ( (aligned) && (s.keyframe()) ) ? 0 : beat + 1;
     }
 
+    int n = every;
+    return (n <= 1) || (beat % n == static_cast<uint64_t>(phase % n));
 }
 
 template <typename ...Z>
     Error::Type Stage<Z...>::process(Scene &s, Z&...z) noexcept {
+    return resume(launch(s, z...), s, z...);
+}
 
-    Error::Type error  = Error::NONE;
-    Engine *the_engine = nullptr;
-    
-    {
-        /* Inside a lock_guard scoped block */
-        std::lock_guard<std::mutex> lock(suspend);
-
-        if (!skipped) {
-            ASSERT((pEngine != nullptr),
-                    "%s[%s]::process() has no valid engine set!",
-                    value_to_string().c_str(), name().c_str());
-            the_engine = pEngine;
-        }
+template <typename ...Z>
+    Operation Stage<Z...>::launch(Scene &s, Z&...z) noexcept {
+    auto &sel = enter();
+    ASSERT((sel.skipped) || (sel.engine != nullptr),
+            "%s[%s]::launch() has no valid engine set!",
+            value_to_string().c_str(), name().c_str());
+
+    /* The scenes are counted even when the stage is skipped */
+    bool scheduled = due(s);
+    if  ( (sel.skipped) || (sel.engine == nullptr) || (!scheduled) ||
+          ( (filter != nullptr) && (!filter(s, z...)) ) ) {
+        leave(sel);
+        return Operation(Error::NONE);
     }
 
-    if  ( (the_engine != nullptr) && 
-          ( (filter == nullptr) || (filter(s, z...)) ) ) {
-        error = the_engine->process(s, z...);
+    auto op = sel.engine->launch(s, z...);
+    if (op.ready()) {
+        leave(sel);
+        return op;
     }
 
+    /* The selection is only left once the engine completes, for it not to
+     * be disabled whilst its operation is pending */
+    Operation done;
+    op.then([this, &sel, done](Error::Type error) mutable {
+                this->leave(sel);
+                done.complete(error); });
+
+    return done;
+}
+
+template <typename ...Z>
+    Error::Type Stage<Z...>::resume(const Operation &op, Scene &s,
+                                    Z&...z) noexcept {
+    auto error = op.wait();
     broadcast.signal(s, z..., error);
   
     return error;
 }
 
+template <typename ...Z>
+    bool Stage<Z...>::suspendable() const noexcept {
+    return true;
+}
+
 template <typename ...Z> 
 Customisation::Error Stage<Z...>::onBypassedUpdate(const bool &yes) noexcept {
         
     /* Inside a lock_guard scoped block */
-    std::lock_guard<std::mutex> lock(suspend);
+    std::lock_guard<Util::Mutex> lock(suspend);
 
     /* A disabled stage is always skipped! */
-    skipped = yes || disabled;
+    select(selected().engine, yes || disabled);
 
     return Customisation::Error::NONE;
 }
@@ -184,20 +429,17 @@ Customisation::Error Stage<Z...>::onEngineUpdate(const std::string &id)
     }
 
     /* Inside a lock_guard scoped block */
-    std::lock_guard<std::mutex> lock(suspend);
+    std::lock_guard<Util::Mutex> lock(suspend);
     
     /* If alredy using the right engine, then we are good to go! */
-    if ((pEngine == nullptr) || (pEngine->name() != id)) {
-   
-        if ( (!runpdatable) && (pEngine != nullptr) ) {
-            pEngine->disable();
-        }
+    auto &sel = selected();
+    if ((sel.engine == nullptr) || (sel.engine->name() != id)) {
 
-        /* Otherwise, search for the right engine */
+        /* Otherwise, search for the right engine, the former one being
+         * disabled once the frames in flight have left it */
         auto found = engines.find(id);
         if  (found != engines.end()) {
-            pEngine = &found->second.get();
-            pEngine->enable();
+            select(&found->second.get(), sel.skipped);
         } else {
             error = Customisation::Error::NOT_EXISTING;
         }
@@ -16,10 +16,15 @@
  *
  **/
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
 #include <vector>
 
 #include "vpp/dnn/dataset.hpp"
 #include "vpp/log.hpp"
+#include "vpp/util/io/mapped.hpp"
 
 namespace VPP {
 namespace DNN {
@@ -30,10 +35,89 @@ struct DatasetCore {
         int16_t                  text_id;
 };
 
-static std::vector<DatasetCore> datasets = {};
+/* The labels of the datasets, loaded once for the whole process and never
+ * released, so that the labelling threads read them without any lock */
+class Datasets final {
+    public:
+        static constexpr int capacity = 256;
+
+        static Datasets &instance() noexcept {
+            static Datasets *registry = new Datasets();
+            return *registry;
+        }
+
+        /* The id of the dataset of a label file, loading it if new */
+        int16_t load(const std::string &path) noexcept;
+
+        inline const DatasetCore *get(int id) const noexcept {
+            if ( (id < 0) || (id >= size()) ) {
+                return nullptr;
+            }
+            return cores[id];
+        }
+
+        inline int size() const noexcept {
+            return count.load(std::memory_order_acquire);
+        }
+
+    private:
+        Datasets() noexcept : loading(), cores(), count(0) {}
+
+        std::mutex                                   loading;
+        std::array<const DatasetCore *, capacity>    cores;
+        std::atomic<int>                             count;
+};
+
+constexpr int Datasets::capacity;
+
+int16_t Datasets::load(const std::string &path) noexcept {
+    std::lock_guard<std::mutex> lock(loading);
+
+    int n = count.load(std::memory_order_relaxed);
+    for (int i = 0; i < n; ++i) {
+        if (cores[i]->path == path) {
+            return static_cast<int16_t>(i);
+        }
+    }
+
+    if (n >= capacity) {
+        LOGE("Datasets::load(): No room left for dataset '%s'!",
+             path.c_str());
+        return -1;
+    }
+
+    /* The label file is split in place, one label per line */
+    Util::IO::Mapped file;
+    if (file.open(path) < 0) {
+        return -1;
+    }
+
+    auto ds = new DatasetCore({ path, {}, -1 });
+    auto at = file.data();
+    auto end = at + file.size();
+    while (at < end) {
+        auto eol = std::find(at, end, '\n');
+        std::string line(at, eol);
+        if (line.find("text") != std::string::npos) {
+            ds->text_id = static_cast<int16_t>(ds->classes.size());
+        }
+        ds->classes.emplace_back(std::move(line));
+        at = (eol < end) ? eol + 1 : end;
+    }
+
+    /* Publishing the dataset only once it is complete */
+    cores[n] = ds;
+    count.store(n + 1, std::memory_order_release);
+
+    return static_cast<int16_t>(n);
+}
+
+static inline Datasets &datasets() noexcept {
+    return Datasets::instance();
+}
 
 Dataset::Dataset() noexcept
-    : Customisation::Entity("Dataset"), labels(""), id(-1) {
+    : Customisation::Entity("Dataset"), labels(""), id(-1), loading() {
         labels.denominate("labels")
               .describe("The configuration file for the dataset labels")
               .characterise(Customisation::Trait::CONFIGURABLE);
@@ -41,20 +125,20 @@ Dataset::Dataset() noexcept
 }
 
 Dataset::~Dataset() noexcept {
+    loading.wait();
     terminate();
 } 
 
 Customisation::Error Dataset::setup() noexcept {
-    int16_t cur_id = 0;
-    std::string requested = labels;
+    /* Loading the labels concurrently with the other engines */
+    auto &startup = Util::Task::Startup::instance();
+    return static_cast<Customisation::Error>(
+        startup.run(loading, name(), [this]() noexcept {
+                        return static_cast<int>(instantiate()); }));
+}
 
-    for (const auto &ds : datasets) {
-        if (ds.path == requested) {
-            id = cur_id;
-            return Customisation::Error::NONE;
-        }
-        cur_id ++;
-    }
+Customisation::Error Dataset::instantiate() noexcept {
+    std::string requested = labels;
 
     if (!labels.exists()) {
         LOGE("%s[%s]::setup(): Cannot find dataset '%s'!", 
@@ -62,20 +146,11 @@ Customisation::Error Dataset::setup() noexcept {
         return Customisation::Error::NOT_EXISTING;
     }
 
-    datasets.emplace_back(DatasetCore({ requested, {}, -1 }));
-    auto &ds = datasets.back();
-
-    id = cur_id;
-
-    int text_id = 0;
-    std::ifstream ifs(requested);
-    std::string line;
-    while (std::getline(ifs, line)) {
-        if (line.find("text") != std::string::npos) {
-            ds.text_id = text_id;
-        }
-        ++ text_id;
-        ds.classes.push_back(line);
+    id = datasets().load(requested);
+    if (id < 0) {
+        LOGE("%s[%s]::setup(): Cannot load dataset '%s'!",
+             value_to_string().c_str(), name().c_str(), requested.c_str());
+        return Customisation::Error::INVALID_VALUE;
     }
  
     return Customisation::Error::NONE;
@@ -89,40 +164,103 @@ std::string Dataset::label(const Zone &zone) const noexcept {
     return label(zone, 0.0);
 }
 
+/* Append the labels of the predictions of a dataset above a threshold */
+static void append(std::string &desc, const Zone &zone, int16_t id,
+                   float threshold) noexcept {
+    auto ds = datasets().get(id);
+    if ( (ds == nullptr) || (ds->classes.empty()) ) {
+        return;
+    }
+
+    bool first = true;
+    for (auto &prediction : zone.predictions) {
+        if ((prediction.dataset != id) || (prediction.score) < threshold) {
+            continue;
+        }
+        auto classId = prediction.id;
+        ASSERT(classId < static_cast<int>(ds->classes.size()),
+               "Dataset::label(): Invalid class id %d provided for a "
+               "%d-class dataset", classId, (int)ds->classes.size());
+        if (!first) desc+="|";
+        desc += ds->classes[classId];
+        first = false;
+    }
+}
+
+/* Append the distance of a zone if known, i.e. if the consumer labelling it
+ * deprojected its scene beforehand */
+static void distance(std::string &desc, const Zone &zone) noexcept {
+    int cm = zone.state.centre.z *100;
+    if (cm > 0) {
+        desc += " @ " + std::to_string(cm/100) + "." + 
+                std::to_string(cm%100) + "m";
+    }
+}
+
 std::string Dataset::label(const Zone &zone, float threshold) const noexcept {
     std::string desc;
 
     if (id >= 0) {
-        ASSERT(id < (int) datasets.size(),
+        ASSERT(id < (int) datasets().size(),
                "%s[%s]::label(): "
                "Invalid dataset id %d for a %d-entry dataset list",
                value_to_string().c_str(), name().c_str(),
-               id, (int) datasets.size());
- 
-        auto ds = datasets[id];
-        if (!ds.classes.empty()) {
-            for (auto &prediction : zone.predictions) {
-                if ((prediction.dataset != id) ||
-                    (prediction.score) < threshold) {
-                    continue;
-                }
-                auto classId = prediction.id;
-                ASSERT(classId < static_cast<int>(ds.classes.size()),
-                       "%s[%s]::label(): "
-                       "Invalid class id %d provided for a %d-class dataset",
-                       value_to_string().c_str(), name().c_str(),
-                       classId, (int)ds.classes.size());
-                if (!desc.empty()) desc+="|";
-                desc += ds.classes[classId];
+               id, (int) datasets().size());
+        append(desc, zone, id, threshold);
+    }
+
+    distance(desc, zone);
+
+    return desc;
+}
+
+void Dataset::tag(Zone &zone, float threshold) const noexcept {
+    if (id >= 0) {
+        zone.labels.add(id, threshold);
+    }
+}
+
+const std::string &Dataset::lookup(int16_t dataset, int16_t id) noexcept {
+    static const std::string none;
+
+    auto ds = datasets().get(dataset);
+    if (ds == nullptr) {
+        return none;
+    }
+
+    const auto &classes = ds->classes;
+    if ( (id < 0) || (id >= (int) classes.size()) ) {
+        return none;
+    }
+
+    return classes[id];
+}
+
+std::string Dataset::text(const Zone &zone) noexcept {
+    std::string desc;
+
+    /* The first dataset labels the zone, the next ones refine it */
+    bool first = true;
+    for (auto const &l : zone.labels) {
+        if ( (l.dataset < 0) || (l.dataset >= (int) datasets().size()) ) {
+            continue;
+        }
+        if (first) {
+            append(desc, zone, l.dataset, l.threshold);
+        } else {
+            std::string refined;
+            append(refined, zone, l.dataset, l.threshold);
+            if (!refined.empty()) {
+                desc += "(" + refined + ")";
             }
         }
+        first = false;
     }
 
-    int cm = zone.state.centre.z *100;
-    if (cm > 0) {
-        desc += " @ " + std::to_string(cm/100) + "." + 
-                std::to_string(cm%100) + "m";
+    if (!zone.labels.empty()) {
+        distance(desc, zone);
     }
+    desc += zone.description;
 
     return desc;
 }
@@ -133,12 +271,12 @@ int16_t Dataset::ID() const noexcept {
 
 int Dataset::size() const noexcept {
     if (id >= 0) {
-        ASSERT(id < (int) datasets.size(),
+        ASSERT(id < (int) datasets().size(),
                "%s[%s]::size(): "
                "Invalid dataset id %d for a %d-entry dataset list",
                value_to_string().c_str(), name().c_str(),
-               id, (int) datasets.size());
-        return datasets[id].classes.size();
+               id, (int) datasets().size());
+        return datasets().get(id)->classes.size();
     }
 
     return 0;
@@ -146,12 +284,12 @@ int Dataset::size() const noexcept {
 
 int16_t Dataset::textID() const noexcept {
     if (id >= 0) {
-        ASSERT(id < (int) datasets.size(),
+        ASSERT(id < (int) datasets().size(),
                "%s[%s]::textID(): "
                "Invalid dataset id %d for a %d-entry dataset list",
                value_to_string().c_str(), name().c_str(),
-               id, (int) datasets.size());
-        return datasets[id].text_id;
+               id, (int) datasets().size());
+        return datasets().get(id)->text_id;
     }
 
     return -1;
@@ -165,12 +303,12 @@ bool Dataset::isText(const Zone &zone) noexcept {
     auto dataset_id = zone.context.dataset;
 
     if (dataset_id >= 0) {
-        ASSERT(dataset_id < (int) datasets.size(),
+        ASSERT(dataset_id < (int) datasets().size(),
                "Dataset::isText(): "
                "Invalid dataset id %d for a %d-entry dataset list",
-               dataset_id, (int) datasets.size());
+               dataset_id, (int) datasets().size());
 
-        return (zone.context.id == datasets[dataset_id].text_id);
+        return (zone.context.id == datasets().get(dataset_id)->text_id);
     }
 
     return false;
@@ -17,13 +17,17 @@
  **/
 
 #include "vpp/dnn/engine.hpp"
+#include "vpp/log.hpp"
+#include "vpp/util/trace.hpp"
 
 namespace VPP {
 namespace DNN {
 namespace Engine {
 
 template <typename ...Z> Core<Z...>::Core() noexcept 
-    : VPP::Core::Engine<Z...>(), dataset(), network(), threshold(0.4f) {
+    : VPP::Core::AsyncEngine<Z...>(), dataset(), network(), threshold(0.4f),
+      warmup(0), background(false), inference(), loading(), warming(),
+      warmed(true), exported(0) {
 
         dataset.denominate("dataset")
                .describe("The network dataset configuration file")
@@ -40,6 +44,92 @@ template <typename ...Z> Core<Z...>::Core() noexcept
                  .characterise(Customisation::Trait::SETTABLE);
         threshold.range(0.0f, 1.0f);
         Customisation::Entity::expose(threshold);
+
+        warmup.denominate("warmup")
+              .describe("The number of dummy inferences run at setup for "
+                        "the first scenes not to be late (0 for none)")
+              .characterise(Customisation::Trait::CONFIGURABLE);
+        warmup.range(0, 16);
+        Customisation::Entity::expose(warmup);
+
+        background.denominate("background")
+                  .describe("Is the network warmed up in the background, the "
+                            "first scene waiting for the warm-up to be done?")
+                  .characterise(Customisation::Trait::CONFIGURABLE);
+        background.use(Customisation::Translator::BoolFormat::NO_YES);
+        Customisation::Entity::expose(background);
+
+        exported = Util::Metrics::Registry::instance().attach(
+            [this](Util::Metrics::Exposition &e) {
+                e.summary("vpp_dnn_inference_seconds",
+                          "Latency of the network inferences",
+                          "engine=" + Util::Metrics::Exposition::quote(
+                                          this->name()), inference); });
+}
+
+template <typename ...Z> Core<Z...>::~Core() noexcept {
+    loading.wait();
+    cool();
+    Util::Metrics::Registry::instance().detach(exported);
+}
+
+template <typename ...Z>
+Error::Type Core<Z...>::prepare(Scene*& s, Z*&... z) noexcept {
+    if (!warm()) {
+        Util::Trace::Span span("dnn", "warming");
+        cool();
+    }
+
+    return VPP::Core::Engine<Z...>::prepare(s, z...);
+}
+
+template <typename ...Z>
+VPP::Core::Operation Core<Z...>::launch(Scene &s, Z&... z) noexcept {
+    return VPP::Core::Operation(this->process(s, z...));
+}
+
+template <typename ...Z>
+void Core<Z...>::warm(std::function<void () noexcept> infer) noexcept {
+    cool();
+
+    int n = warmup;
+    if (n <= 0) {
+        return;
+    }
+
+    auto run = [this, n, infer]() noexcept {
+        auto started = Util::Histogram::now();
+        for (int i = 0; i < n; ++i) {
+            infer();
+        }
+        LOGI("%s[%s]::setup(): Warmed up in %.2fms",
+             this->value_to_string().c_str(), this->name().c_str(),
+             static_cast<double>(Util::Histogram::now() - started) / 1e6);
+        warmed.store(true, std::memory_order_release);
+    };
+
+    warmed.store(false, std::memory_order_release);
+    if (background) {
+        warming = std::async(std::launch::async, run);
+    } else {
+        run();
+    }
+}
+
+template <typename ...Z> void Core<Z...>::cool() noexcept {
+    if (warming.valid()) {
+        warming.wait();
+        warming = std::future<void>();
+    }
+}
+
+template <typename ...Z>
+Customisation::Error Core<Z...>::load(
+    std::function<Customisation::Error () noexcept> loader) noexcept {
+    auto &startup = Util::Task::Startup::instance();
+    return static_cast<Customisation::Error>(
+        startup.run(loading, this->name(), [loader]() noexcept {
+                        return static_cast<int>(loader()); }));
 }
 
 template <typename ...Z>
@@ -47,6 +137,11 @@ std::string Core<Z...>::label(const Zone &zone) const noexcept {
     return dataset.label(zone, threshold);
 }
 
+template <typename ...Z>
+void Core<Z...>::tag(Zone &zone) const noexcept {
+    dataset.tag(zone, threshold);
+}
+
 /* Create template implementations */
 template class Core<>;
 template class Core<Zone>;
@@ -16,16 +16,157 @@
  *
  **/
 
+#include <fstream>
+#include <map>
+#include <opencv2/imgcodecs.hpp>
+#include <tuple>
+
 #include "vpp/log.hpp"
 #include "vpp/dnn/ocv.hpp"
+#include "vpp/util/io/mapped.hpp"
 
 namespace VPP {
 namespace DNN {
+
+static bool ends(const std::string &path, const std::string &ext) noexcept {
+    return (path.size() >= ext.size()) &&
+           (path.compare(path.size() - ext.size(), ext.size(), ext) == 0);
+}
+
+/* Read the network from its memory-mapped files when its framework has a
+ * buffer reader, the files being only paged in whilst parsed, and from its
+ * files otherwise */
+static cv::dnn::Net read(const std::string &weights,
+                         const std::string &architecture) noexcept {
+#if (CV_VERSION_MAJOR > 4) || \
+    ((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR >= 2))
+    Util::IO::Mapped model, config;
+    if ( (model.open(weights) == 0) && (model.size() > 0) &&
+         ( (architecture.empty()) || (config.open(architecture) == 0) ) ) {
+        auto m = model.data();
+        auto n = model.size();
+        auto c = config.data();
+        auto k = config.size();
+        try {
+            if (ends(weights, ".onnx")) {
+                return cv::dnn::readNetFromONNX(m, n);
+            }
+            if (ends(weights, ".caffemodel")) {
+                return cv::dnn::readNetFromCaffe(c, k, m, n);
+            }
+            if (ends(weights, ".pb")) {
+                return cv::dnn::readNetFromTensorflow(m, n, c, k);
+            }
+            if (ends(weights, ".weights")) {
+                return cv::dnn::readNetFromDarknet(c, k, m, n);
+            }
+        } catch (const cv::Exception &e) {
+            LOGW("Network::read(): Cannot read the mapped network '%s': %s",
+                 weights.c_str(), e.what());
+        }
+    }
+#endif
+
+    return cv::dnn::readNet(weights, architecture, "");
+}
+
+std::shared_ptr<Network> Network::share(const std::string &architecture,
+                                        const std::string &weights,
+                                        int backend, int target,
+                                        int precision,
+                                        const Preparer &prepare) noexcept {
+    using Key = std::tuple<std::string, std::string, int, int, int>;
+    static std::mutex                            registry;
+    static std::map<Key, std::weak_ptr<Network>> networks;
+
+    std::lock_guard<std::mutex> lock(registry);
+    auto &known = networks[Key(architecture, weights, backend, target,
+                               precision)];
+    auto  found = known.lock();
+    if (found != nullptr) {
+        return found;
+    }
+
+    auto net = read(weights, architecture);
+    if (net.empty()) {
+        return nullptr;
+    }
+
+    prepare(net);
+    found = std::make_shared<Network>(std::move(net));
+    known = found;
+
+    return found;
+}
+
+static bool halved(int target) noexcept {
+    return (target == cv::dnn::DNN_TARGET_OPENCL_FP16)
+#if (CV_VERSION_MAJOR > 4) || \
+    ((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR >= 2))
+        || (target == cv::dnn::DNN_TARGET_CUDA_FP16)
+#endif
+        ;
+}
+
+int Network::precise(int target, int precision) noexcept {
+    if (precision != static_cast<int>(Setup::Precision::FP16)) {
+        return target;
+    }
+
+    if (target == cv::dnn::DNN_TARGET_OPENCL) {
+        return cv::dnn::DNN_TARGET_OPENCL_FP16;
+    }
+#if (CV_VERSION_MAJOR > 4) || \
+    ((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR >= 2))
+    if (target == cv::dnn::DNN_TARGET_CUDA) {
+        return cv::dnn::DNN_TARGET_CUDA_FP16;
+    }
+#endif
+
+    return target;
+}
+
+bool Network::quantise(cv::dnn::Net &net,
+                       const std::vector<cv::Mat> &calibration) noexcept {
+    /* The int8 ONNX models have their own (de)quantisation layers */
+    std::vector<cv::String> types;
+    net.getLayerTypes(types);
+    for (auto &t : types) {
+        if ( (t == "Quantize") || (t == "Dequantize") ) {
+            return true;
+        }
+    }
+
+#if (CV_VERSION_MAJOR > 4) || \
+    ((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR >= 6))
+    if (calibration.empty()) {
+        LOGW("Network::quantise(): Cannot quantise without any calibration "
+             "blob!");
+        return false;
+    }
+
+    try {
+        net = net.quantize(calibration, CV_32F, CV_32F);
+        return true;
+    } catch (const cv::Exception &e) {
+        LOGW("Network::quantise(): Cannot quantise the network: %s",
+             e.what());
+    }
+#else
+    (void)calibration;
+    LOGW("Network::quantise(): Quantising a network requires OpenCV 4.6 or "
+         "later!");
+#endif
+
+    return false;
+}
+
 namespace Engine {
 
 template <typename ...Z> OCV<Z...>::OCV() noexcept 
-    : Core<Z...>(), size(), RGB(false), mean(), scale(1.0f),
-      architecture(""), weights(""), net() {
+    : Core<Z...>(), size(), RGB(false), mean(), scale(1.0f), remote(),
+      architecture(""), weights(""), preference(), precision(0), shared(),
+      net() {
 
         size.denominate("size")
             .describe("The input size for the OCV DNN")
@@ -47,33 +188,67 @@ template <typename ...Z> OCV<Z...>::OCV() noexcept
               .describe("The input scaling factor for the OCV DNN")
               .characterise(Customisation::Trait::CONFIGURABLE);
         Customisation::Entity::expose(scale);
+
+        remote.denominate("remote")
+              .describe("The inference server of the OCV DNN")
+              .characterise(Customisation::Trait::CONFIGURABLE);
+        Customisation::Entity::expose(remote);
 }
 
 template <typename ...Z> Customisation::Error OCV<Z...>::setup() noexcept {
+    return OCV<Z...>::load([this]() noexcept { return instantiate(); });
+}
+
+template <typename ...Z>
+Customisation::Error OCV<Z...>::instantiate() noexcept {
     std::string net_architecture = OCV<Z...>::network.architecture;
     std::string net_weights      = OCV<Z...>::network.weights;
+    int         net_backend      = OCV<Z...>::network.backend;
+    int         net_target       = OCV<Z...>::network.target;
+    int         net_precision    = OCV<Z...>::network.precision;
 
-    if ( (architecture != net_architecture) || (weights != net_weights) ) {
-        terminate();
-        
-        auto offset_vec = static_cast<std::vector<float> >(mean);
-        if (offset_vec.size() > 0) {
-            if (offset_vec.size() == 1) {
-                offset = cv::Scalar(offset_vec[0]);
-            } else if (offset_vec.size() == 3) {
-                offset = cv::Scalar(offset_vec[0], offset_vec[1],
-                                    offset_vec[2]);
-            } else {
-                LOGE("%s[%s]::setup(): Wrong mean scalar provided: it shall "
-                     "be 0, 1 or 3 element vector!",
-                     OCV<Z...>::value_to_string().c_str(), 
-                     OCV<Z...>::name().c_str());
-                return Customisation::Error::INVALID_VALUE;
-            }
+    /* The input normalisation is applied without reloading the network, which
+     * is only reloaded when its files or its inference settings change */
+    auto offset_vec = static_cast<std::vector<float> >(mean);
+    if (offset_vec.size() > 0) {
+        if (offset_vec.size() == 1) {
+            offset = cv::Scalar(offset_vec[0]);
+        } else if (offset_vec.size() == 3) {
+            offset = cv::Scalar(offset_vec[0], offset_vec[1], offset_vec[2]);
+        } else {
+            LOGE("%s[%s]::setup(): Wrong mean scalar provided: it shall be 0, "
+                 "1 or 3 element vector!",
+                 OCV<Z...>::value_to_string().c_str(),
+                 OCV<Z...>::name().c_str());
+            return Customisation::Error::INVALID_VALUE;
         }
+    } else {
+        offset = cv::Scalar();
+    }
 
-        net = cv::dnn::readNet(net_weights, net_architecture, "");
-        if (net.empty()) {
+    if ( (architecture != net_architecture) || (weights != net_weights) ||
+         ( (!net.empty()) && 
+           ( (preference != std::make_pair(net_backend, net_target)) ||
+             (precision != net_precision) ) ) ) {
+        terminate();
+
+        /* Only the first engine loading the model applies the preferences */
+        shared = Network::share(net_architecture, net_weights, net_backend,
+                                net_target, net_precision,
+                                [this, net_backend, net_target, net_precision]
+                                (cv::dnn::Net &n) noexcept {
+                                    auto p = net_precision;
+                                    if ( (p == static_cast<int>(
+                                                Setup::Precision::INT8)) &&
+                                         (!Network::quantise(n,
+                                                             calibrate())) ) {
+                                        p = static_cast<int>(
+                                                Setup::Precision::FP32);
+                                    }
+                                    net = n;
+                                    prefer(net_backend, net_target, p);
+                                });
+        if (shared == nullptr) {
             LOGE("%s[%s]::setup(): Cannot load OpenCV DNN with config '%s' "
                  "and weights '%s'",
                  OCV<Z...>::value_to_string().c_str(),
@@ -82,27 +257,214 @@ template <typename ...Z> Customisation::Error OCV<Z...>::setup() noexcept {
             return Customisation::Error::INVALID_VALUE;
         }
 
+        net          = shared->net;
         architecture = std::move(net_architecture);
         weights      = std::move(net_weights);
+        preference   = std::make_pair(net_backend, net_target);
+        precision    = net_precision;
 
-        net.setPreferableBackend(cv::dnn::DNN_BACKEND_DEFAULT);
-        net.setPreferableTarget(cv::dnn::DNN_TARGET_OPENCL_FP16); 
+        /* Warm the network up at the input size and batch of the engine */
+        auto sz = static_cast<cv::Size>(size);
+        if (sz.area() > 0) {
+            int shape[] = { batching(), 3, sz.height, sz.width };
+            cv::Mat blob(4, shape, CV_32F, cv::Scalar::all(0));
+            OCV<Z...>::warm([this, blob]() noexcept {
+                try {
+                    auto lock = reserve();
+                    net.setInput(blob);
+                    net.forward();
+                } catch (const cv::Exception &e) {
+                    LOGW("%s[%s]::setup(): Cannot warm the network up: %s",
+                         OCV<Z...>::value_to_string().c_str(),
+                         OCV<Z...>::name().c_str(), e.what());
+                } });
+        }
     }
 
     return Customisation::Error::NONE;
 }
 
+template <typename ...Z>
+bool OCV<Z...>::offload(const cv::Mat &blob, std::vector<cv::Mat> &outputs,
+                        bool batchable) noexcept {
+    if (!remote.enabled()) {
+        return false;
+    }
+
+    Util::Timing timing(OCV<Z...>::inference);
+    return remote.infer(blob, outputs, batchable);
+}
+
+template <typename ...Z> 
+void OCV<Z...>::prefer(int backend, int target, int precision) noexcept {
+    /* The quantised networks only run on the CPU with the OpenCV backend */
+    if (precision == static_cast<int>(Setup::Precision::INT8)) {
+        backend = cv::dnn::DNN_BACKEND_OPENCV;
+        target  = cv::dnn::DNN_TARGET_CPU;
+    } else if (target != Setup::AUTO) {
+        target = Network::precise(target, precision);
+    }
+
+    if ( (backend != Setup::AUTO) && (target != Setup::AUTO) ) {
+        net.setPreferableBackend(backend);
+        net.setPreferableTarget(target); 
+        return;
+    }
+
+    std::pair<int, int> fastest(cv::dnn::DNN_BACKEND_DEFAULT,
+                                cv::dnn::DNN_TARGET_CPU);
+    auto sz = static_cast<cv::Size>(size);
+
+    /* A warm start reuses the pair timed as the fastest by a former one */
+    auto &network = OCV<Z...>::network;
+    auto key = static_cast<std::string>(network.weights) + " " +
+               static_cast<std::string>(network.architecture) + " " +
+               std::to_string(backend) + " " + std::to_string(target) + " " +
+               std::to_string(precision) + " " + std::to_string(sz.width) +
+               "x" + std::to_string(sz.height);
+    if (network.recall(key, fastest)) {
+        LOGI("%s[%s]::setup(): Recalling backend %d on target %d",
+             OCV<Z...>::value_to_string().c_str(), OCV<Z...>::name().c_str(),
+             fastest.first, fastest.second);
+        net.setPreferableBackend(fastest.first);
+        net.setPreferableTarget(fastest.second);
+        return;
+    }
+
+#if CV_VERSION_MAJOR >= 4
+    if (sz.area() > 0) {
+        cv::Mat sample(sz, CV_8UC3, offset), blob;
+        cv::dnn::blobFromImage(sample, blob, scale, sz, offset, RGB, false);
+        double best = -1;
+        bool   fp16 = (precision == static_cast<int>(Setup::Precision::FP16));
+
+        for (auto &bt : cv::dnn::getAvailableBackends()) {
+            if ( ((backend != Setup::AUTO) && (bt.first != backend)) ||
+                 ((target != Setup::AUTO) && (bt.second != target)) ) {
+                continue;
+            }
+
+            /* Only timing the targets inferring at the precision */
+            if ( (fp16 && (Network::precise(bt.second, precision) !=
+                           bt.second)) || ((!fp16) && halved(bt.second)) ) {
+                continue;
+            }
+
+            /* The first inference sets the backend up, so it is not timed */
+            try {
+                net.setPreferableBackend(bt.first);
+                net.setPreferableTarget(bt.second);
+                net.setInput(blob);
+                net.forward();
+
+                auto start = cv::getTickCount();
+                for (int i = 0; i < 3; ++i) {
+                    net.setInput(blob);
+                    net.forward();
+                }
+                double ms = static_cast<double>(cv::getTickCount() - start) *
+                            1000.0 / (3.0 * cv::getTickFrequency());
+
+                LOGI("%s[%s]::setup(): Backend %d on target %d infers in "
+                     "%.2fms", OCV<Z...>::value_to_string().c_str(),
+                     OCV<Z...>::name().c_str(), bt.first, bt.second, ms);
+
+                if ( (best < 0) || (ms < best) ) {
+                    best    = ms;
+                    fastest = std::make_pair(static_cast<int>(bt.first),
+                                             static_cast<int>(bt.second));
+                }
+            } catch (const cv::Exception &e) {
+                LOGW("%s[%s]::setup(): Backend %d on target %d is unusable: "
+                     "%s", OCV<Z...>::value_to_string().c_str(),
+                     OCV<Z...>::name().c_str(), bt.first, bt.second, e.what());
+            }
+        }
+
+        if (best >= 0) {
+            network.remember(key, fastest);
+        }
+    } else {
+        LOGW("%s[%s]::setup(): Cannot time the backends without an input "
+             "size, using the default ones!",
+             OCV<Z...>::value_to_string().c_str(), OCV<Z...>::name().c_str());
+    }
+#else
+    LOGW("%s[%s]::setup(): Automatic backend selection is not supported by "
+         "this OpenCV version, using the default ones!",
+         OCV<Z...>::value_to_string().c_str(), OCV<Z...>::name().c_str());
+#endif
+
+    net.setPreferableBackend(fastest.first);
+    net.setPreferableTarget(fastest.second);
+    LOGI("%s[%s]::setup(): Using backend %d on target %d",
+         OCV<Z...>::value_to_string().c_str(), OCV<Z...>::name().c_str(),
+         fastest.first, fastest.second);
+}
+
+template <typename ...Z>
+std::vector<cv::Mat> OCV<Z...>::calibrate() noexcept {
+    std::vector<cv::Mat> blobs;
+    auto sz = static_cast<cv::Size>(size);
+    if (sz.area() <= 0) {
+        LOGW("%s[%s]::setup(): Cannot calibrate without an input size!",
+             OCV<Z...>::value_to_string().c_str(), OCV<Z...>::name().c_str());
+        return blobs;
+    }
+
+    auto &calibration = OCV<Z...>::network.calibration;
+    if (!calibration.undefined()) {
+        std::ifstream ifs(static_cast<std::string>(calibration));
+        std::string path;
+        while (std::getline(ifs, path)) {
+            if (path.empty()) {
+                continue;
+            }
+            auto image = cv::imread(path, cv::IMREAD_COLOR);
+            if (image.empty()) {
+                LOGW("%s[%s]::setup(): Cannot read calibration image '%s'!",
+                     OCV<Z...>::value_to_string().c_str(),
+                     OCV<Z...>::name().c_str(), path.c_str());
+                continue;
+            }
+            blobs.emplace_back(cv::dnn::blobFromImage(image, scale, sz,
+                                                      offset, RGB, false));
+        }
+        return blobs;
+    }
+
+    /* Without any calibration image, the ranges are the ones of some noise
+     * which is a poor calibration but at least a working one */
+    LOGW("%s[%s]::setup(): Calibrating the quantisation on synthetic images!",
+         OCV<Z...>::value_to_string().c_str(), OCV<Z...>::name().c_str());
+    cv::RNG rng(1);
+    cv::Mat image(sz, CV_8UC3);
+    for (int i = 0; i < 8; ++i) {
+        rng.fill(image, cv::RNG::UNIFORM, cv::Scalar::all(0),
+                 cv::Scalar::all(256));
+        blobs.emplace_back(cv::dnn::blobFromImage(image, scale, sz, offset,
+                                                  RGB, false));
+    }
+
+    return blobs;
+}
+
 template <typename ...Z> void OCV<Z...>::terminate() noexcept {
+    OCV<Z...>::cool();
     if (! net.empty()) {
         net = cv::dnn::Net();
+        shared.reset();
         architecture.clear();
         weights.clear();        
+        preference = std::pair<int, int>();
+        precision  = 0;
     }
 }
 
 /* Create template implementations */
 template class OCV<>;
 template class OCV<Zone>;
+template class OCV<Zones>;
 
 }  // namespace Engine
 }  // namespace DNN
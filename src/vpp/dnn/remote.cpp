@@ -0,0 +1,759 @@
+/**
+ *
+ * @file      vpp/dnn/remote.cpp
+ *
+ * @brief     This is the VPP remote DNN inference implementation file
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <future>
+#include <map>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+
+#include "vpp/log.hpp"
+#include "vpp/dnn/remote.hpp"
+#include "vpp/util/io/socket.hpp"
+
+namespace VPP {
+namespace DNN {
+
+using Util::IO::Socket::dial;
+using Util::IO::Socket::get;
+using Util::IO::Socket::put;
+
+using Clock = std::chrono::steady_clock;
+
+/* The magic of the frames, i.e. 'VPPI' in the little-endian order */
+static const uint32_t MAGIC = 0x49505056;
+
+/* How long the receiver waits for a response before checking its status */
+static const int POLLING_MS = 100;
+
+/* How long an unreachable server is left alone before connecting again */
+static const int BACKOFF_MS = 1000;
+
+/* The limits of the tensors received, beyond which a response is invalid */
+static const uint32_t MAX_DIMS    = 8;
+static const uint32_t MAX_OUTPUTS = 64;
+static const size_t   MAX_FLOATS  = 1 << 28;
+
+static bool tensor(int fd, cv::Mat &t, int ms) noexcept {
+    uint32_t dims = 0;
+    int      shape[MAX_DIMS];
+    if ( (!get(fd, &dims, sizeof(dims), ms)) || (dims == 0) ||
+         (dims > MAX_DIMS) || (!get(fd, shape, dims * sizeof(int), ms)) ) {
+        return false;
+    }
+
+    std::size_t total = 1;
+    for (uint32_t i = 0; i < dims; ++i) {
+        if ( (shape[i] <= 0) ||
+             (total * static_cast<std::size_t>(shape[i]) > MAX_FLOATS) ) {
+            return false;
+        }
+        total *= static_cast<std::size_t>(shape[i]);
+    }
+
+    t.create(static_cast<int>(dims), shape, CV_32F);
+    return get(fd, t.data, total * sizeof(float), ms);
+}
+
+/* The connection to a server shared by all the engines using the same model
+ * on it. The sender thread coalesces and sends the requests, whereas the
+ * receiver thread reads the responses and is the only one closing the
+ * connection once it fails */
+class Remote::Client {
+    public:
+        using Outputs    = std::vector<cv::Mat>;
+        using Completion = Remote::Completion;
+
+        static std::shared_ptr<Client> share(
+            const std::string &server, const std::string &model) noexcept;
+
+        Client(std::string s, std::string m) noexcept;
+        ~Client() noexcept;
+
+        /* Clients cannot be copied nor moved */
+        Client(const Client& other) = delete;
+        Client(Client&& other) = delete;
+        Client& operator=(const Client& other) = delete;
+        Client& operator=(Client&& other) = delete;
+
+        void tune(int ms, int most, int us, int batch) noexcept;
+
+        /* Submitting a blob, whose outputs are empty if it failed */
+        void submit(const cv::Mat &blob, bool batchable,
+                    Completion done) noexcept;
+
+    private:
+        struct Request {
+            Request(const cv::Mat &b, bool batch, Completion d) noexcept
+                : blob(b), batchable(batch), arrival(Clock::now()),
+                  done(std::move(d)), settled(false) {}
+
+            /* Completing the request, only once as a late request is
+             * failed before its response is received */
+            inline void complete(Outputs &outputs) noexcept {
+                if (!settled.exchange(true, std::memory_order_acq_rel)) {
+                    done(outputs);
+                }
+            }
+
+            cv::Mat           blob;
+            bool              batchable;
+            Clock::time_point arrival;
+            Completion        done;
+            std::atomic<bool> settled;
+        };
+
+        using Requests = std::vector<std::shared_ptr<Request> >;
+
+        struct Batch {
+            Requests          requests;
+            Clock::time_point sent;
+        };
+
+        void send() noexcept;
+        void receive() noexcept;
+
+        /* Taking the next request and the ones coalesced with it */
+        Requests gather() noexcept;
+
+        /* Writing a request frame of some coalesced blobs */
+        bool write(int fd, uint32_t id, const Requests &requests) noexcept;
+
+        /* Reading a response, false once the connection is to be retired */
+        bool read(int fd, int ms) noexcept;
+
+        /* Stopping to use a failing connection, and closing it */
+        void drop(int fd) noexcept;
+        void retire(int fd) noexcept;
+
+        /* Failing the requests waited for longer than the timeout, their
+         * late responses being ignored */
+        void expire() noexcept;
+
+        static void fail(const Requests &requests) noexcept;
+        static void answer(Requests &requests, Outputs &outputs) noexcept;
+
+        const std::string                     server;
+        const std::string                     model;
+        std::mutex                            access;
+        std::mutex                            writing;
+        std::condition_variable               queued;
+        std::condition_variable               connected;
+        std::deque<std::shared_ptr<Request> > queue;
+        std::map<uint32_t, Batch>             flying;
+        int                                   fd;
+        bool                                  down;
+        bool                                  exiting;
+        uint32_t                              next;
+        Clock::time_point                     retry;
+        int                                   timeout;
+        int                                   inflight;
+        std::chrono::microseconds             window;
+        int                                   coalesce;
+        std::thread                           sender;
+        std::thread                           receiver;
+};
+
+std::shared_ptr<Remote::Client> Remote::Client::share(
+    const std::string &server, const std::string &model) noexcept {
+    using Key = std::pair<std::string, std::string>;
+    static std::mutex                           registry;
+    static std::map<Key, std::weak_ptr<Client>> clients;
+
+    std::lock_guard<std::mutex> lock(registry);
+    auto &known = clients[Key(server, model)];
+    auto  found = known.lock();
+    if (found == nullptr) {
+        found = std::make_shared<Client>(server, model);
+        known = found;
+    }
+    return found;
+}
+
+Remote::Client::Client(std::string s, std::string m) noexcept
+    : server(std::move(s)), model(std::move(m)), access(), writing(),
+      queued(), connected(), queue(), flying(), fd(-1), down(false),
+      exiting(false), next(0), retry(Clock::now()), timeout(200),
+      inflight(4), window(2000), coalesce(16), sender(), receiver() {
+    sender   = std::thread([this] { this->send(); });
+    receiver = std::thread([this] { this->receive(); });
+}
+
+Remote::Client::~Client() noexcept {
+    Requests failed;
+    {
+        /* Inside a lock_guard scoped block */
+        std::lock_guard<std::mutex> lock(access);
+        exiting = true;
+        for (auto &r : queue) {
+            failed.push_back(r);
+        }
+        queue.clear();
+        for (auto &b : flying) {
+            failed.insert(failed.end(), b.second.requests.begin(),
+                          b.second.requests.end());
+        }
+        flying.clear();
+    }
+    queued.notify_all();
+    connected.notify_all();
+    fail(failed);
+
+    sender.join();
+    receiver.join();
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+void Remote::Client::tune(int ms, int most, int us, int batch) noexcept {
+    {
+        /* Inside a lock_guard scoped block */
+        std::lock_guard<std::mutex> lock(access);
+        timeout  = std::max(1, ms);
+        inflight = std::max(1, most);
+        window   = std::chrono::microseconds(std::max(0, us));
+        coalesce = std::max(1, batch);
+    }
+    queued.notify_all();
+}
+
+void Remote::Client::submit(const cv::Mat &blob, bool batchable,
+                            Completion done) noexcept {
+    auto request = std::make_shared<Request>(blob, batchable,
+                                             std::move(done));
+
+    {
+        /* Inside a lock_guard scoped block */
+        std::lock_guard<std::mutex> lock(access);
+        if (!exiting) {
+            queue.push_back(std::move(request));
+            request = nullptr;
+        }
+    }
+
+    if (request != nullptr) {
+        Outputs none;
+        request->complete(none);
+        return;
+    }
+    queued.notify_one();
+}
+
+static bool compatible(const cv::Mat &a, const cv::Mat &b) noexcept {
+    if (a.dims != b.dims) {
+        return false;
+    }
+    for (int i = 1; i < a.dims; ++i) {
+        if (a.size[i] != b.size[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Remote::Client::Requests Remote::Client::gather() noexcept {
+    Requests requests(1, queue.front());
+    queue.pop_front();
+
+    auto first = requests.front();
+    if (!first->batchable) {
+        return requests;
+    }
+
+    for (auto r = queue.begin();
+         (r != queue.end()) &&
+         (static_cast<int>(requests.size()) < coalesce); ) {
+        if ( ((*r)->batchable) && (compatible((*r)->blob, first->blob)) ) {
+            requests.push_back(*r);
+            r = queue.erase(r);
+        } else {
+            ++r;
+        }
+    }
+
+    return requests;
+}
+
+void Remote::Client::send() noexcept {
+    std::unique_lock<std::mutex> lock(access);
+
+    while (true) {
+        queued.wait(lock, [this] {
+                    return (this->exiting) ||
+                           ( (!this->queue.empty()) &&
+                             (static_cast<int>(this->flying.size()) <
+                              this->inflight) ); });
+        if (exiting) {
+            return;
+        }
+
+        /* A batchable blob waits for others to coalesce with */
+        auto first = queue.front();
+        if ( (first->batchable) && (coalesce > 1) ) {
+            queued.wait_until(lock, first->arrival + window, [this] {
+                              return (this->exiting) ||
+                                     (static_cast<int>(this->queue.size()) >=
+                                      this->coalesce); });
+            if (exiting) {
+                return;
+            }
+        }
+
+        auto requests = gather();
+
+        /* Connecting to the server if needed, an unreachable server only
+         * being tried again after a while, the requests failing meanwhile */
+        if ( (fd < 0) && (Clock::now() >= retry) ) {
+            auto ms = timeout;
+            lock.unlock();
+            auto s = dial(server, ms);
+            lock.lock();
+
+            if (exiting) {
+                if (s >= 0) {
+                    close(s);
+                }
+                lock.unlock();
+                fail(requests);
+                return;
+            }
+
+            if (s >= 0) {
+                fd   = s;
+                down = false;
+                LOGI("Remote::Client(): Connected to '%s'", server.c_str());
+                connected.notify_all();
+            } else {
+                retry = Clock::now() + std::chrono::milliseconds(BACKOFF_MS);
+                if (!down) {
+                    down = true;
+                    LOGW("Remote::Client(): Cannot connect to '%s', "
+                         "inferring locally meanwhile!", server.c_str());
+                }
+            }
+        }
+
+        if (fd < 0) {
+            lock.unlock();
+            fail(requests);
+            lock.lock();
+            continue;
+        }
+
+        auto id = next++;
+        auto s  = fd;
+        flying[id] = Batch { requests, Clock::now() };
+        lock.unlock();
+
+        bool sent;
+        {
+            /* Inside a lock_guard scoped block */
+            std::lock_guard<std::mutex> guard(writing);
+            sent = write(s, id, requests);
+        }
+        if (!sent) {
+            drop(s);
+        }
+
+        lock.lock();
+    }
+}
+
+bool Remote::Client::write(int s, uint32_t id,
+                           const Requests &requests) noexcept {
+    const auto &first  = requests.front()->blob;
+    uint32_t    dims   = static_cast<uint32_t>(first.dims);
+    uint32_t    head[] = { MAGIC, id, static_cast<uint32_t>(model.size()) };
+    int         shape[MAX_DIMS];
+    for (int i = 0; i < first.dims; ++i) {
+        shape[i] = first.size[i];
+    }
+
+    /* The coalesced blobs are stacked along their first dimension */
+    shape[0] = 0;
+    for (auto &r : requests) {
+        shape[0] += r->blob.size[0];
+    }
+
+    if ( (!put(s, head, sizeof(head))) ||
+         (!put(s, model.data(), model.size())) ||
+         (!put(s, &dims, sizeof(dims))) ||
+         (!put(s, shape, dims * sizeof(int))) ) {
+        return false;
+    }
+    for (auto &r : requests) {
+        if (!put(s, r->blob.data, r->blob.total() * r->blob.elemSize())) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Remote::Client::receive() noexcept {
+    while (true) {
+        int s, ms;
+        {
+            std::unique_lock<std::mutex> lock(access);
+            connected.wait(lock, [this] {
+                           return (this->exiting) || (this->fd >= 0); });
+            if (exiting) {
+                return;
+            }
+            s  = fd;
+            ms = std::max(timeout, POLLING_MS);
+        }
+
+        while (read(s, ms)) {}
+        retire(s);
+    }
+}
+
+bool Remote::Client::read(int s, int ms) noexcept {
+    pollfd pfd = { s, POLLIN, 0 };
+    auto ready = poll(&pfd, 1, POLLING_MS);
+    if ( (ready < 0) && (errno == EINTR) ) {
+        return true;
+    }
+
+    if (ready == 0) {
+        expire();
+
+        /* Inside a lock_guard scoped block */
+        std::lock_guard<std::mutex> lock(access);
+        if ( (exiting) || (fd != s) ) {
+            return false;
+        }
+
+        /* A server sitting on its requests is reconnected to */
+        if ( (!flying.empty()) &&
+             (Clock::now() - flying.begin()->second.sent >
+              std::chrono::milliseconds(2 * timeout)) ) {
+            LOGW("Remote::Client(): '%s' stalls, reconnecting to it!",
+                 server.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    uint32_t head[4];
+    if ( (ready < 0) || (!get(s, head, sizeof(head), ms)) ) {
+        return false;
+    }
+    if ( (head[0] != MAGIC) || (head[3] > MAX_OUTPUTS) ) {
+        LOGE("Remote::Client(): Invalid response from '%s'!",
+             server.c_str());
+        return false;
+    }
+
+    Outputs outputs(head[3]);
+    for (auto &o : outputs) {
+        if (!tensor(s, o, ms)) {
+            LOGE("Remote::Client(): Invalid output from '%s'!",
+                 server.c_str());
+            return false;
+        }
+    }
+
+    Requests requests;
+    {
+        /* Inside a lock_guard scoped block */
+        std::lock_guard<std::mutex> lock(access);
+        auto found = flying.find(head[1]);
+        if (found == flying.end()) {
+            return true;
+        }
+        requests = std::move(found->second.requests);
+        flying.erase(found);
+    }
+    queued.notify_one();
+
+    int32_t status;
+    std::memcpy(&status, &head[2], sizeof(status));
+    if ( (status != 0) || (outputs.empty()) ) {
+        fail(requests);
+    } else {
+        answer(requests, outputs);
+    }
+    expire();
+
+    return true;
+}
+
+void Remote::Client::drop(int s) noexcept {
+    Requests failed;
+    {
+        /* Inside a lock_guard scoped block */
+        std::lock_guard<std::mutex> lock(access);
+        if (fd != s) {
+            return;
+        }
+        fd = -1;
+        for (auto &b : flying) {
+            failed.insert(failed.end(), b.second.requests.begin(),
+                          b.second.requests.end());
+        }
+        flying.clear();
+
+        /* The receiver is woken up for closing the connection */
+        shutdown(s, SHUT_RDWR);
+    }
+    queued.notify_all();
+    fail(failed);
+}
+
+void Remote::Client::retire(int s) noexcept {
+    drop(s);
+
+    /* Only closing the connection once it is not written anymore */
+    std::lock_guard<std::mutex> guard(writing);
+    close(s);
+}
+
+void Remote::Client::expire() noexcept {
+    Requests late;
+    {
+        /* Inside a lock_guard scoped block */
+        std::lock_guard<std::mutex> lock(access);
+        auto limit = Clock::now() - std::chrono::milliseconds(timeout);
+        for (auto r = queue.begin(); r != queue.end(); ) {
+            if ((*r)->arrival < limit) {
+                late.push_back(*r);
+                r = queue.erase(r);
+            } else {
+                ++r;
+            }
+        }
+
+        /* The requests in flight are kept until their responses */
+        for (auto &b : flying) {
+            for (auto &r : b.second.requests) {
+                if ( (r->arrival < limit) &&
+                     (!r->settled.load(std::memory_order_acquire)) ) {
+                    late.push_back(r);
+                }
+            }
+        }
+    }
+
+    fail(late);
+}
+
+void Remote::Client::fail(const Requests &requests) noexcept {
+    for (auto &r : requests) {
+        Outputs none;
+        r->complete(none);
+    }
+}
+
+void Remote::Client::answer(Requests &requests, Outputs &outputs) noexcept {
+    if (requests.size() == 1) {
+        requests.front()->complete(outputs);
+        return;
+    }
+
+    /* The outputs of coalesced blobs are split along their first dimension */
+    int total = 0;
+    for (auto &r : requests) {
+        total += r->blob.size[0];
+    }
+    for (auto &o : outputs) {
+        if (o.size[0] != total) {
+            LOGE("Remote::Client(): Cannot split outputs of %d rows for a "
+                 "batch of %d!", o.size[0], total);
+            fail(requests);
+            return;
+        }
+    }
+
+    int first = 0;
+    for (auto &r : requests) {
+        auto    n = r->blob.size[0];
+        Outputs split;
+        for (auto &o : outputs) {
+            std::vector<cv::Range> ranges(o.dims, cv::Range::all());
+            ranges[0] = cv::Range(first, first + n);
+            split.emplace_back(o(ranges.data()));
+        }
+        r->complete(split);
+        first += n;
+    }
+}
+
+Remote::Remote() noexcept
+    : Customisation::Entity("Remote"), fallbacks(0), access(), client() {
+        server.denominate("server")
+              .describe("The inference server as host:port, or empty for "
+                        "inferring locally")
+              .characterise(Customisation::Trait::CONFIGURABLE);
+        expose(server);
+        server = "";
+
+        model.denominate("model")
+             .describe("The name of the model on the inference server, or "
+                       "empty for its default one")
+             .characterise(Customisation::Trait::CONFIGURABLE);
+        expose(model);
+        model = "";
+
+        timeout.denominate("timeout")
+               .describe("The time in milliseconds a request is waited for, "
+                         "before inferring it locally")
+               .characterise(Customisation::Trait::CONFIGURABLE);
+        timeout.range(1, 60000);
+        expose(timeout);
+        timeout = 200;
+
+        inflight.denominate("inflight")
+                .describe("The maximal number of requests in flight on the "
+                          "connection to the server")
+                .characterise(Customisation::Trait::CONFIGURABLE);
+        inflight.range(1, 64);
+        expose(inflight);
+        inflight = 4;
+
+        window.denominate("window")
+              .describe("The time in microseconds a batchable blob waits for "
+                        "others to be sent with")
+              .characterise(Customisation::Trait::CONFIGURABLE);
+        window.range(0, 100000);
+        expose(window);
+        window = 2000;
+
+        coalesce.denominate("coalesce")
+                .describe("The maximal number of batchable blobs sent in a "
+                          "single request")
+                .characterise(Customisation::Trait::CONFIGURABLE);
+        coalesce.range(1, 256);
+        expose(coalesce);
+        coalesce = 16;
+}
+
+Remote::~Remote() noexcept = default;
+
+Customisation::Error Remote::setup() noexcept {
+    std::string             s = server;
+    std::shared_ptr<Client> c;
+
+    if (!s.empty()) {
+        auto colon = s.rfind(':');
+        if ( (colon == std::string::npos) || (colon == 0) ||
+             (colon + 1 == s.size()) ) {
+            LOGE("%s[%s]::setup(): Invalid server '%s', expecting "
+                 "host:port!", value_to_string().c_str(), name().c_str(),
+                 s.c_str());
+            return Customisation::Error::INVALID_VALUE;
+        }
+        c = Client::share(s, model);
+        c->tune(timeout, inflight, window, coalesce);
+    }
+
+    /* Inside a lock_guard scoped block */
+    std::lock_guard<std::mutex> lock(access);
+    client = std::move(c);
+
+    return Customisation::Error::NONE;
+}
+
+bool Remote::enabled() const noexcept {
+    return !static_cast<std::string>(server).empty();
+}
+
+std::shared_ptr<Remote::Client> Remote::connection(
+    const cv::Mat &blob) noexcept {
+    std::shared_ptr<Client> c;
+    {
+        /* Inside a lock_guard scoped block */
+        std::lock_guard<std::mutex> lock(access);
+        c = client;
+    }
+
+    if ( (c == nullptr) || (blob.type() != CV_32F) || (blob.empty()) ||
+         (blob.dims > static_cast<int>(MAX_DIMS)) ) {
+        return nullptr;
+    }
+    return c;
+}
+
+void Remote::miss() noexcept {
+    if (fallbacks.fetch_add(1, std::memory_order_relaxed) == 0) {
+        LOGW("%s[%s]::infer(): Inferring locally for the lack of a response "
+             "from '%s'", value_to_string().c_str(), name().c_str(),
+             static_cast<std::string>(server).c_str());
+    }
+}
+
+bool Remote::infer(const cv::Mat &blob, std::vector<cv::Mat> &outputs,
+                   bool batchable) noexcept {
+    auto c = connection(blob);
+    if (c == nullptr) {
+        return false;
+    }
+
+    /* The request keeps its blob until it is sent, even once given up, and
+     * its completion its promise */
+    using Outputs = Client::Outputs;
+    auto promised = std::make_shared<std::promise<Outputs>>();
+    auto sent     = promised->get_future();
+    c->submit(blob.isContinuous() ? blob : blob.clone(), batchable,
+              [promised](Outputs &o) {
+                  promised->set_value(std::move(o)); });
+
+    auto waited = std::chrono::milliseconds(static_cast<int>(timeout));
+    if (sent.wait_for(waited) == std::future_status::ready) {
+        outputs = sent.get();
+        if (!outputs.empty()) {
+            return true;
+        }
+    }
+
+    miss();
+    return false;
+}
+
+void Remote::infer(const cv::Mat &blob, bool batchable,
+                   Completion done) noexcept {
+    auto c = connection(blob);
+    if (c == nullptr) {
+        std::vector<cv::Mat> none;
+        done(none);
+        return;
+    }
+
+    c->submit(blob.isContinuous() ? blob : blob.clone(), batchable,
+              [this, done](std::vector<cv::Mat> &outputs) {
+                  if (outputs.empty()) {
+                      this->miss();
+                  }
+                  done(outputs); });
+}
+
+}  // namespace DNN
+}  // namespace VPP
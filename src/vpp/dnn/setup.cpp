@@ -16,14 +16,27 @@
  *
  **/
 
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+#include "vpp/config.hpp"
+#ifdef VPP_HAS_OPENCV_DNN_SUPPORT
+#include <opencv2/dnn.hpp>
+#endif
+
 #include "vpp/log.hpp"
 #include "vpp/dnn/setup.hpp"
 
 namespace VPP {
 namespace DNN {
 
+/* The cache files are shared by all the setups of the process */
+static std::mutex caching;
+
 Setup::Setup() noexcept
-    : Customisation::Entity("Setup"), architecture(""), weights("") {
+    : Customisation::Entity("Setup"), architecture(""), weights(""),
+      calibration(""), cache("") {
         architecture.denominate("architecture")
                     .describe("The network architecture configuration file")
                     .characterise(Customisation::Trait::CONFIGURABLE);
@@ -33,6 +46,82 @@ Setup::Setup() noexcept
                .describe("The network weights configuration file")
                .characterise(Customisation::Trait::CONFIGURABLE);
         expose(weights);
+
+        backend.denominate("backend")
+               .describe("The preferred inference backend, or auto for "
+                         "timing all available ones at setup and keeping the "
+                         "fastest")
+               .characterise(Customisation::Trait::CONFIGURABLE);
+        target.denominate("target")
+              .describe("The preferred inference target, or auto for timing "
+                        "all available ones at setup and keeping the fastest")
+              .characterise(Customisation::Trait::CONFIGURABLE);
+#ifdef VPP_HAS_OPENCV_DNN_SUPPORT
+        backend.define(
+            { { "auto",     AUTO },
+              { "default",  cv::dnn::DNN_BACKEND_DEFAULT },
+              { "halide",   cv::dnn::DNN_BACKEND_HALIDE },
+              { "openvino", cv::dnn::DNN_BACKEND_INFERENCE_ENGINE },
+              { "opencv",   cv::dnn::DNN_BACKEND_OPENCV },
+#if (CV_VERSION_MAJOR > 4) || \
+    ((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR >= 2))
+              { "cuda",     cv::dnn::DNN_BACKEND_CUDA },
+#endif
+            });
+        target.define(
+            { { "auto",        AUTO },
+              { "cpu",         cv::dnn::DNN_TARGET_CPU },
+              { "opencl",      cv::dnn::DNN_TARGET_OPENCL },
+              { "opencl_fp16", cv::dnn::DNN_TARGET_OPENCL_FP16 },
+              { "myriad",      cv::dnn::DNN_TARGET_MYRIAD },
+#if (CV_VERSION_MAJOR > 4) || \
+    ((CV_VERSION_MAJOR == 4) && (CV_VERSION_MINOR >= 2))
+              { "cuda",        cv::dnn::DNN_TARGET_CUDA },
+              { "cuda_fp16",   cv::dnn::DNN_TARGET_CUDA_FP16 },
+#endif
+            });
+#else
+        backend.define({ { "auto", AUTO }, { "default", 0 } });
+        target.define({ { "auto", AUTO }, { "default", 0 } });
+#endif
+        expose(backend);
+        expose(target);
+
+        precision.denominate("precision")
+                 .describe("The precision of the inferences: fp32, fp16 on "
+                           "the OpenCL and CUDA targets, or int8 on the CPU "
+                           "for a quantised network or a one quantised at "
+                           "setup")
+                 .characterise(Customisation::Trait::CONFIGURABLE);
+        precision.define(
+            { { "fp32", static_cast<int>(Precision::FP32) },
+              { "fp16", static_cast<int>(Precision::FP16) },
+              { "int8", static_cast<int>(Precision::INT8) } });
+        expose(precision);
+
+        calibration.denominate("calibration")
+                   .describe("The file listing the images, one path per line, "
+                             "calibrating the int8 quantisation of a "
+                             "floating-point network, synthetic images being "
+                             "used if undefined")
+                   .characterise(Customisation::Trait::CONFIGURABLE);
+        expose(calibration);
+
+        cache.denominate("cache")
+             .describe("The file keeping the backends and targets timed as "
+                       "the fastest ones in auto mode, for the next setups "
+                       "not to time them again, unused if undefined")
+             .characterise(Customisation::Trait::CONFIGURABLE);
+        expose(cache);
+
+#ifdef VPP_HAS_OPENCV_DNN_SUPPORT
+        backend = cv::dnn::DNN_BACKEND_DEFAULT;
+        target  = cv::dnn::DNN_TARGET_OPENCL_FP16;
+#else
+        backend = 0;
+        target  = 0;
+#endif
+        precision = static_cast<int>(Precision::FP32);
 }
 
 Setup::~Setup() noexcept = default;
@@ -54,8 +143,56 @@ Customisation::Error Setup::setup() noexcept {
         return Customisation::Error::NOT_EXISTING;
     }
 
+    if ( (static_cast<int>(precision) == static_cast<int>(Precision::INT8)) &&
+         (!calibration.undefined()) && (!calibration.exists()) ) {
+        LOGE("%s[%s]::setup(): Cannot find calibration file '%s'!",
+             value_to_string().c_str(), name().c_str(),
+             static_cast<std::string>(calibration).c_str());
+        return Customisation::Error::NOT_EXISTING;
+    }
+
     return Customisation::Error::NONE;
 }
 
+/* Every line of a cache file is the backend, the target and the key */
+bool Setup::recall(const std::string &key,
+                   std::pair<int, int> &fastest) noexcept {
+    if ( (cache.undefined()) || (!cache.exists()) ) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(caching);
+    std::ifstream ifs(static_cast<std::string>(cache));
+    std::string line;
+    while (std::getline(ifs, line)) {
+        std::istringstream entry(line);
+        std::pair<int, int> pair;
+        std::string k;
+        if ( (entry >> pair.first >> pair.second) &&
+             (std::getline(entry >> std::ws, k)) && (k == key) ) {
+            fastest = pair;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Setup::remember(const std::string &key,
+                     const std::pair<int, int> &fastest) noexcept {
+    if (cache.undefined()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(caching);
+    std::ofstream ofs(static_cast<std::string>(cache), std::ios::app);
+    ofs << fastest.first << " " << fastest.second << " " << key << "\n";
+    if (!ofs) {
+        LOGW("%s[%s]::remember(): Cannot write the cache file '%s'!",
+             value_to_string().c_str(), name().c_str(),
+             static_cast<std::string>(cache).c_str());
+    }
+}
+
 }  // namespace DNN
 }  // namespace VPP
@@ -0,0 +1,492 @@
+/**
+ *
+ * @file      vpp/dnn/tflite.cpp
+ *
+ * @brief     This is the generic VPP TFLite DNN engine implementation file
+ *
+ * @details   This is the implementation of a generic VPP TensorFlow Lite DNN
+ *            engine and of its shared interpreters.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <map>
+#include <opencv2/imgproc.hpp>
+#include <tuple>
+
+#include "vpp/dnn/tflite.hpp"
+#include "vpp/log.hpp"
+
+#ifdef VPP_HAS_NNAPI_SUPPORT
+#include "tensorflow/lite/delegates/nnapi/nnapi_delegate_c_api.h"
+#endif
+#ifdef VPP_HAS_TFLITE_GPU_SUPPORT
+#include "tensorflow/lite/delegates/gpu/delegate.h"
+#endif
+#ifdef VPP_HAS_EDGETPU_SUPPORT
+#include "edgetpu_c.h"
+#endif
+
+namespace VPP {
+namespace DNN {
+
+/* Creating a delegate, or none if it is not available */
+static TfLiteDelegate *delegation(int kind, bool halved) noexcept {
+    switch (static_cast<Interpreter::Delegate>(kind)) {
+        case Interpreter::Delegate::NNAPI: {
+#ifdef VPP_HAS_NNAPI_SUPPORT
+            auto o = TfLiteNnapiDelegateOptionsDefault();
+            o.execution_preference =
+                TfLiteNnapiDelegateOptions::kSustainedSpeed;
+            o.allow_fp16 = halved;
+            return TfLiteNnapiDelegateCreate(&o);
+#else
+            break;
+#endif
+        }
+
+        case Interpreter::Delegate::GPU: {
+#ifdef VPP_HAS_TFLITE_GPU_SUPPORT
+            auto o = TfLiteGpuDelegateOptionsV2Default();
+            o.is_precision_loss_allowed = (halved) ? 1 : 0;
+            o.inference_preference =
+                TFLITE_GPU_INFERENCE_PREFERENCE_SUSTAINED_SPEED;
+            return TfLiteGpuDelegateV2Create(&o);
+#else
+            break;
+#endif
+        }
+
+        case Interpreter::Delegate::EDGETPU: {
+#ifdef VPP_HAS_EDGETPU_SUPPORT
+            std::size_t     n       = 0;
+            TfLiteDelegate *d       = nullptr;
+            auto            devices = edgetpu_list_devices(&n);
+            if (n > 0) {
+                d = edgetpu_create_delegate(devices[0].type,
+                                            devices[0].path, nullptr, 0);
+            }
+            edgetpu_free_devices(devices);
+            return d;
+#else
+            break;
+#endif
+        }
+
+        default:
+            break;
+    }
+
+    (void)halved;
+    return nullptr;
+}
+
+static void release(int kind, TfLiteDelegate *d) noexcept {
+    if (d == nullptr) {
+        return;
+    }
+
+    switch (static_cast<Interpreter::Delegate>(kind)) {
+#ifdef VPP_HAS_NNAPI_SUPPORT
+        case Interpreter::Delegate::NNAPI:
+            TfLiteNnapiDelegateDelete(d);
+            break;
+#endif
+#ifdef VPP_HAS_TFLITE_GPU_SUPPORT
+        case Interpreter::Delegate::GPU:
+            TfLiteGpuDelegateV2Delete(d);
+            break;
+#endif
+#ifdef VPP_HAS_EDGETPU_SUPPORT
+        case Interpreter::Delegate::EDGETPU:
+            edgetpu_free_delegate(d);
+            break;
+#endif
+        default:
+            break;
+    }
+}
+
+std::shared_ptr<Interpreter> Interpreter::share(const std::string &model,
+                                                int delegate, int threads,
+                                                int precision) noexcept {
+    using Key = std::tuple<std::string, int, int, int>;
+    static std::mutex                                registry;
+    static std::map<Key, std::weak_ptr<Interpreter>> interpreters;
+
+    std::lock_guard<std::mutex> lock(registry);
+    auto &known = interpreters[Key(model, delegate, threads, precision)];
+    auto  found = known.lock();
+    if (found != nullptr) {
+        return found;
+    }
+
+    auto m = TfLiteModelCreateFromFile(model.c_str());
+    if (m == nullptr) {
+        return nullptr;
+    }
+
+    /* Falling back on the CPU whenever the delegate cannot run the model */
+    const bool       halved = (precision ==
+                               static_cast<int>(Setup::Precision::FP16));
+    const int        cpu    = static_cast<int>(Delegate::CPU);
+    std::vector<int> kinds  = { delegate };
+    if (delegate != cpu) {
+        kinds.push_back(cpu);
+    }
+
+    for (auto kind : kinds) {
+        auto d = delegation(kind, halved);
+        if ( (kind != cpu) && (d == nullptr) ) {
+            LOGW("Interpreter::share(): Delegate %d is not available for "
+                 "'%s', falling back on the CPU!", kind, model.c_str());
+            continue;
+        }
+
+        auto o = TfLiteInterpreterOptionsCreate();
+        TfLiteInterpreterOptionsSetNumThreads(o, threads);
+        if (d != nullptr) {
+            TfLiteInterpreterOptionsAddDelegate(o, d);
+        }
+
+        auto i = TfLiteInterpreterCreate(m, o);
+        if ( (i != nullptr) &&
+             (TfLiteInterpreterAllocateTensors(i) == kTfLiteOk) ) {
+            found = std::make_shared<Interpreter>(m, o, d, kind, i);
+            known = found;
+            return found;
+        }
+
+        if (i != nullptr) {
+            TfLiteInterpreterDelete(i);
+        }
+        TfLiteInterpreterOptionsDelete(o);
+        release(kind, d);
+
+        if (kind != cpu) {
+            LOGW("Interpreter::share(): Delegate %d cannot run '%s', falling "
+                 "back on the CPU!", kind, model.c_str());
+        }
+    }
+
+    TfLiteModelDelete(m);
+    return nullptr;
+}
+
+Interpreter::Interpreter(TfLiteModel *m, TfLiteInterpreterOptions *o,
+                         TfLiteDelegate *d, int kind,
+                         TfLiteInterpreter *i) noexcept
+    : interpreter(i), delegated(kind), access(), model(m), options(o),
+      delegate(d) {}
+
+Interpreter::~Interpreter() noexcept {
+    /* The delegate shall outlive the interpreter using it */
+    TfLiteInterpreterDelete(interpreter);
+    release(delegated, delegate);
+    TfLiteInterpreterOptionsDelete(options);
+    TfLiteModelDelete(model);
+}
+
+namespace Engine {
+
+template <typename ...Z> TFLite<Z...>::TFLite() noexcept
+    : Core<Z...>(), RGB(true), mean(), scale(1.0f / 127.5f), model(""),
+      delegated(-1), threaded(0), precision(0), shared(), shape(),
+      offset(), staged(), luma(), chroma() {
+
+        delegate.denominate("delegate")
+                .describe("The delegate of the inferences, falling back on "
+                          "the CPU if it cannot run the model")
+                .characterise(Customisation::Trait::CONFIGURABLE);
+        delegate.define(
+            { { "cpu",     static_cast<int>(Interpreter::Delegate::CPU) },
+              { "nnapi",   static_cast<int>(Interpreter::Delegate::NNAPI) },
+              { "gpu",     static_cast<int>(Interpreter::Delegate::GPU) },
+              { "edgetpu", static_cast<int>(Interpreter::Delegate::EDGETPU) }
+            });
+        Customisation::Entity::expose(delegate);
+
+        threads.denominate("threads")
+               .describe("The number of threads of the CPU kernels")
+               .characterise(Customisation::Trait::CONFIGURABLE);
+        threads.range(1, 16);
+        Customisation::Entity::expose(threads);
+
+        RGB.denominate("RGB")
+           .describe("Are the TFLite DNN inputs in RGB mode?")
+           .characterise(Customisation::Trait::CONFIGURABLE);
+        RGB.use(Customisation::Translator::BoolFormat::NO_YES);
+        Customisation::Entity::expose(RGB);
+
+        mean.denominate("mean")
+            .describe("The mean vector to substract to the floating-point "
+                      "inputs of the TFLite DNN")
+            .characterise(Customisation::Trait::CONFIGURABLE);
+        Customisation::Entity::expose(mean);
+
+        scale.denominate("scale")
+             .describe("The scaling factor of the floating-point inputs of "
+                       "the TFLite DNN")
+             .characterise(Customisation::Trait::CONFIGURABLE);
+        Customisation::Entity::expose(scale);
+
+        delegate = static_cast<int>(Interpreter::Delegate::CPU);
+        threads  = 2;
+        mean     = std::vector<float>({ 127.5f });
+}
+
+template <typename ...Z> Customisation::Error TFLite<Z...>::setup() noexcept {
+    return TFLite<Z...>::load([this]() noexcept { return instantiate(); });
+}
+
+template <typename ...Z>
+Customisation::Error TFLite<Z...>::instantiate() noexcept {
+    std::string net_model     = TFLite<Z...>::network.weights;
+    int         net_delegate  = delegate;
+    int         net_threads   = threads;
+    int         net_precision = TFLite<Z...>::network.precision;
+
+    auto offset_vec = static_cast<std::vector<float> >(mean);
+    if (offset_vec.size() > 0) {
+        if (offset_vec.size() == 1) {
+            offset = cv::Scalar::all(offset_vec[0]);
+        } else if (offset_vec.size() == 3) {
+            offset = cv::Scalar(offset_vec[0], offset_vec[1], offset_vec[2]);
+        } else {
+            LOGE("%s[%s]::setup(): Wrong mean scalar provided: it shall be 0, "
+                 "1 or 3 element vector!",
+                 TFLite<Z...>::value_to_string().c_str(),
+                 TFLite<Z...>::name().c_str());
+            return Customisation::Error::INVALID_VALUE;
+        }
+    } else {
+        offset = cv::Scalar();
+    }
+
+    if ( (model == net_model) && (delegated == net_delegate) &&
+         (threaded == net_threads) && (precision == net_precision) ) {
+        return Customisation::Error::NONE;
+    }
+
+    terminate();
+    shared = Interpreter::share(net_model, net_delegate, net_threads,
+                                net_precision);
+    if (shared == nullptr) {
+        LOGE("%s[%s]::setup(): Cannot load the TFLite model '%s'",
+             TFLite<Z...>::value_to_string().c_str(),
+             TFLite<Z...>::name().c_str(), net_model.c_str());
+        return Customisation::Error::INVALID_VALUE;
+    }
+
+    /* The networks take a single NHWC colour image */
+    auto t = TfLiteInterpreterGetInputTensor(shared->interpreter, 0);
+    if ( (t == nullptr) || (TfLiteTensorNumDims(t) != 4) ||
+         (TfLiteTensorDim(t, 0) != 1) || (TfLiteTensorDim(t, 3) != 3) ||
+         (tensor().empty()) ) {
+        LOGE("%s[%s]::setup(): The TFLite model '%s' does not take a single "
+             "8-bit or floating-point NHWC colour image!",
+             TFLite<Z...>::value_to_string().c_str(),
+             TFLite<Z...>::name().c_str(), net_model.c_str());
+        shared.reset();
+        return Customisation::Error::INVALID_VALUE;
+    }
+    shape = cv::Size(TfLiteTensorDim(t, 2), TfLiteTensorDim(t, 1));
+
+    if ( (net_precision == static_cast<int>(Setup::Precision::INT8)) &&
+         (TfLiteTensorType(t) == kTfLiteFloat32) ) {
+        LOGW("%s[%s]::setup(): The TFLite model '%s' is not quantised, so it "
+             "infers in floating-point!",
+             TFLite<Z...>::value_to_string().c_str(),
+             TFLite<Z...>::name().c_str(), net_model.c_str());
+    }
+
+    LOGI("%s[%s]::setup(): Using delegate %d for a %dx%d input",
+         TFLite<Z...>::value_to_string().c_str(),
+         TFLite<Z...>::name().c_str(), shared->delegated, shape.width,
+         shape.height);
+
+    model     = std::move(net_model);
+    delegated = net_delegate;
+    threaded  = net_threads;
+    precision = net_precision;
+
+    /* Warm the interpreter up with a mean image */
+    TFLite<Z...>::warm([this]() noexcept {
+        cv::Mat image(shape, CV_8UC3, offset);
+        auto lock = reserve();
+        fill(image);
+        invoke(); });
+
+    return Customisation::Error::NONE;
+}
+
+template <typename ...Z> cv::Mat TFLite<Z...>::tensor() const noexcept {
+    auto t = TfLiteInterpreterGetInputTensor(shared->interpreter, 0);
+    int  type;
+    switch (TfLiteTensorType(t)) {
+        case kTfLiteUInt8:
+            type = CV_8UC3;
+            break;
+        case kTfLiteInt8:
+            type = CV_8SC3;
+            break;
+        case kTfLiteFloat32:
+            type = CV_32FC3;
+            break;
+        default:
+            return cv::Mat();
+    }
+
+    return cv::Mat(TfLiteTensorDim(t, 1), TfLiteTensorDim(t, 2), type,
+                   TfLiteTensorData(t));
+}
+
+template <typename ...Z> void TFLite<Z...>::store(cv::Mat &input) noexcept {
+    /* The quantised INT8 inputs are the pixels shifted around 0 */
+    if (input.depth() == CV_8S) {
+        staged.convertTo(input, CV_8S, 1.0, -128.0);
+    } else if (input.depth() == CV_32F) {
+        staged.convertTo(input, CV_32F);
+        cv::subtract(input, offset, input);
+        cv::multiply(input, cv::Scalar::all(scale), input);
+    }
+}
+
+template <typename ...Z> void TFLite<Z...>::fill(View &view) noexcept {
+    const Image *native = view.cached(Image::Mode::NV21);
+    int          code   = (RGB) ? cv::COLOR_YUV2RGB_NV21 :
+                                  cv::COLOR_YUV2BGR_NV21;
+    if (native == nullptr) {
+        native = view.cached(Image::Mode::NV12);
+        code   = (RGB) ? cv::COLOR_YUV2RGB_NV12 : cv::COLOR_YUV2BGR_NV12;
+    }
+
+    /* Without any semi-planar image, the network reads the shared BGR
+     * pyramid of the view */
+    if ( (native == nullptr) || (shape.width % 2 != 0) ||
+         (shape.height % 2 != 0) ) {
+        fill(view.pyramid(Image::Mode::BGR).fitting(shape));
+        return;
+    }
+
+    auto input = tensor();
+    if (input.empty()) {
+        return;
+    }
+
+    /* The luma and interleaved chroma planes are resized to the network
+     * input, and then converted right into the 8-bit inputs */
+    const cv::Mat &yuv = native->input();
+    const int      h   = (yuv.rows * 2) / 3;
+    const int      w   = yuv.cols;
+    const cv::Mat  uv(h / 2, w / 2, CV_8UC2,
+                      const_cast<uchar *>(yuv.ptr(h)), yuv.step);
+    cv::resize(yuv.rowRange(0, h), luma, shape, 0, 0, cv::INTER_AREA);
+    cv::resize(uv, chroma, shape / 2, 0, 0, cv::INTER_AREA);
+
+    if (input.depth() == CV_8U) {
+        cv::cvtColorTwoPlane(luma, chroma, input, code);
+        return;
+    }
+    cv::cvtColorTwoPlane(luma, chroma, staged, code);
+    store(input);
+}
+
+template <typename ...Z>
+void TFLite<Z...>::fill(const cv::Mat &bgr) noexcept {
+    auto input = tensor();
+    if (input.empty()) {
+        return;
+    }
+
+    /* The 8-bit inputs are filled in place, the others through the staging
+     * image */
+    cv::Mat &target = (input.depth() == CV_8U) ? input : staged;
+    if (bgr.size() != shape) {
+        cv::resize(bgr, target, shape, 0, 0, cv::INTER_LINEAR);
+        if (RGB) {
+            cv::cvtColor(target, target, cv::COLOR_BGR2RGB);
+        }
+    } else if (RGB) {
+        cv::cvtColor(bgr, target, cv::COLOR_BGR2RGB);
+    } else {
+        bgr.copyTo(target);
+    }
+
+    store(input);
+}
+
+template <typename ...Z> bool TFLite<Z...>::invoke() noexcept {
+    Util::Timing timing(TFLite<Z...>::inference);
+    return (TfLiteInterpreterInvoke(shared->interpreter) == kTfLiteOk);
+}
+
+template <typename ...Z> int TFLite<Z...>::outputs() const noexcept {
+    return TfLiteInterpreterGetOutputTensorCount(shared->interpreter);
+}
+
+template <typename ...Z>
+cv::Mat TFLite<Z...>::output(int index) const noexcept {
+    auto t = TfLiteInterpreterGetOutputTensor(shared->interpreter, index);
+    if (t == nullptr) {
+        return cv::Mat();
+    }
+
+    int n = 1;
+    for (int i = 0; i < TfLiteTensorNumDims(t); ++i) {
+        n *= TfLiteTensorDim(t, i);
+    }
+
+    /* The quantised outputs are dequantised with their own parameters */
+    auto    data = TfLiteTensorData(t);
+    auto    q    = TfLiteTensorQuantizationParams(t);
+    cv::Mat out;
+    switch (TfLiteTensorType(t)) {
+        case kTfLiteFloat32:
+            cv::Mat(1, n, CV_32F, data).copyTo(out);
+            break;
+        case kTfLiteUInt8:
+            cv::Mat(1, n, CV_8U, data).convertTo(out, CV_32F, q.scale,
+                                                 -q.scale * q.zero_point);
+            break;
+        case kTfLiteInt8:
+            cv::Mat(1, n, CV_8S, data).convertTo(out, CV_32F, q.scale,
+                                                 -q.scale * q.zero_point);
+            break;
+        default:
+            break;
+    }
+
+    return out;
+}
+
+template <typename ...Z> void TFLite<Z...>::terminate() noexcept {
+    TFLite<Z...>::cool();
+    if (shared != nullptr) {
+        shared.reset();
+        model.clear();
+        delegated = -1;
+        threaded  = 0;
+        precision = 0;
+        shape     = cv::Size();
+        staged    = cv::Mat();
+        luma      = cv::Mat();
+        chroma    = cv::Mat();
+    }
+}
+
+/* Create template implementations */
+template class TFLite<>;
+template class TFLite<Zone>;
+template class TFLite<Zones>;
+
+}  // namespace Engine
+}  // namespace DNN
+}  // namespace VPP
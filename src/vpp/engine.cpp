@@ -16,16 +16,99 @@
  *
  **/
 
+#include <utility>
+
 #include "core/engine.tpl.hpp"
 #include "vpp/engine.hpp"
+#include "vpp/util/task.hpp"
 
 namespace VPP {
 namespace Core {
 
+Operation::State::State() noexcept
+    : access(), completed(), done(false), error(Error::OK), next() {}
+
+Operation::Operation() noexcept
+    : state(std::make_shared<State>()), error(Error::OK) {}
+
+Operation::Operation(Error::Type e) noexcept : state(), error(e) {}
+
+void Operation::complete(Error::Type e) noexcept {
+    /* An operation completed right away cannot be completed again */
+    if (state == nullptr) {
+        return;
+    }
+
+    Continuation next;
+    {
+        /* Inside a lock_guard scoped block */
+        std::lock_guard<std::mutex> lock(state->access);
+        if (state->done) {
+            return;
+        }
+        state->done  = true;
+        state->error = e;
+        std::swap(next, state->next);
+    }
+    state->completed.notify_all();
+
+    /* The continuation is run out of the lock as it may chain operations */
+    if (next) {
+        next(e);
+    }
+}
+
+bool Operation::ready() const noexcept {
+    if (state == nullptr) {
+        return true;
+    }
+
+    /* Inside a lock_guard scoped block */
+    std::lock_guard<std::mutex> lock(state->access);
+    return state->done;
+}
+
+void Operation::then(Continuation next) noexcept {
+    if (state == nullptr) {
+        next(error);
+        return;
+    }
+
+    {
+        /* Inside a lock_guard scoped block */
+        std::lock_guard<std::mutex> lock(state->access);
+        if (!state->done) {
+            state->next = std::move(next);
+            return;
+        }
+    }
+
+    next(state->error);
+}
+
+Error::Type Operation::wait() const noexcept {
+    if (state == nullptr) {
+        return error;
+    }
+
+    /* Help the pool as long as the operation is pending, as it may be
+     * completed by a pending task, and only block once there is none */
+    auto &pool = Util::Task::Pool::instance();
+    while ( (!ready()) && (pool.help()) ) {}
+
+    std::unique_lock<std::mutex> lock(state->access);
+    auto &shared = *state;
+    state->completed.wait(lock, [&shared] { return shared.done; });
+    return state->error;
+}
+
 /* Create template implementations */
 template class Engine<>;
 template class Engine<Zone>;
 template class Engine<Zones>;
+template class AsyncEngine<>;
+template class AsyncEngine<Zone>;
+template class AsyncEngine<Zones>;
 
 }  // namespace Core
 }  // namespace VPP
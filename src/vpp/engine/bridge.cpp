@@ -20,147 +20,413 @@
  *
  **/
 
+#include <algorithm>
+#include <type_traits>
+#include <unordered_set>
+
 #include "vpp/log.hpp"
 #include "vpp/engine/bridge.hpp"
+#include "vpp/util/trace.hpp"
 
 namespace VPP {
 namespace Engine {
 
-template <typename ...Z> Bridge<Z...>::Bridge() noexcept : 
-    Core::Engine<Z...>(), access(), rd(0), wr(0) {}
+BridgeSlots::BridgeSlots() noexcept 
+    : forwarded(0), dropped(0), access("bridge"), released(), slots(), queued(),
+      spares(), rd(-1), wr(-1), discarding(false) {
+    reset(2);
+}
 
-template <typename ...Z> void Bridge<Z...>::forward(Scene scn) noexcept {
+void BridgeSlots::reset(int depth) noexcept {
     /* Inside a lock_guard scoped block, as we need to access bridge storage
      * variables */
-    std::lock_guard<std::mutex> lock(access);
+    {
+        std::lock_guard<Util::Mutex> lock(access);
+        depth = std::max(2, depth);
+
+        slots.clear();
+        slots.resize(depth);
+        queued.clear();
+        queued.reserve(depth);
+        spares.clear();
+        spares.reserve(depth);
+        for (int i = depth - 1; i >= 0; --i) {
+            spares.push_back(i);
+        }
+        rd         = -1;
+        wr         = -1;
+        discarding = false;
+    }
+
+    /* Blocked producers are woken up and forward into the emptied bridge */
+    released.notify_all();
+}
 
-    if (rd == wr) {
-        wr = (wr+1)%2;
+void BridgeSlots::release(int slot) noexcept {
+    slots[slot].scene.clear();
+    slots[slot].zones.clear();
+    slots[slot].served = 0;
+    spares.push_back(slot);
+}
+
+int BridgeSlots::acquire(std::unique_lock<std::mutex> &lock, const Scene &scn,
+                         Policy policy) noexcept {
+    if (policy == Policy::KEEP_LATEST) {
+        /* The waiting zones superseded by the forwarded scene are dropped,
+         * as well as the waiting scenes left without any zone */
+        std::unordered_set<uint64_t> latest;
+        for (auto const &z : scn.zones()) {
+            if (z.get().uuid != 0) {
+                latest.insert(z.get().uuid);
+            }
+        }
+        auto superseded = [&latest](const Zone &z) {
+            return latest.count(z.uuid) > 0; };
+
+        for (auto q = queued.begin(); (!latest.empty()) && 
+                                      (q != queued.end()); ) {
+            auto &slot = slots[*q];
+            bool drop;
+            if (!slot.zones.empty()) {
+                slot.zones.erase(std::remove_if(slot.zones.begin(),
+                                                slot.zones.end(),
+                                                superseded),
+                                 slot.zones.end());
+                drop = slot.zones.empty();
+            } else {
+                auto zs = static_cast<const Scene &>(slot.scene).zones();
+                drop = ( (!zs.empty()) && 
+                         (std::all_of(zs.begin(), zs.end(), superseded)) );
+            }
+
+            if (drop) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                release(*q);
+                q = queued.erase(q);
+            } else {
+                ++q;
+            }
+        }
+    }
+
+    if (spares.empty()) {
+        switch (policy) {
+            case Policy::DROP_NEWEST:
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return -1;
+
+            case Policy::BLOCK:
+                released.wait(lock, [this]() { return !spares.empty(); });
+                break;
+
+            default:
+                /* At least one scene is queued, as only the consumed slot
+                 * is neither queued nor spare */
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                release(queued.front());
+                queued.erase(queued.begin());
+                break;
+        }
     }
 
-    scenes[wr] = std::move(scn);
+    auto slot = spares.back();
+    spares.pop_back();
+    return slot;
 }
 
-template <typename ...Z> void Bridge<Z...>::forward(Zones zs) noexcept {
-        
+void BridgeSlots::forward(Scene scn, Policy policy) noexcept {
+    Util::Trace::Span span("bridge", "forward");
+    std::unique_lock<Util::Mutex> lock(access);
+
+    forwarded.fetch_add(1, std::memory_order_relaxed);
+    auto slot = acquire(lock, scn, policy);
+
+    /* The zones of a dropped scene shall be dropped as well */
+    discarding = (slot < 0);
+    if (discarding) {
+        return;
+    }
+
+    slots[slot].scene  = std::move(scn);
+    slots[slot].zones.clear();
+    slots[slot].served = 0;
+    queued.push_back(slot);
+    wr = slot;
+}
+
+void BridgeSlots::forward(Zones zs) noexcept {
     /* Inside a lock_guard scoped block, as we need to access bridge storage
      * variables */
-    std::lock_guard<std::mutex> lock(access);
+    std::lock_guard<Util::Mutex> lock(access);
 
-    zones[wr] = std::move(zs);
+    if ( (!discarding) && (wr >= 0) ) {
+        slots[wr].zones  = std::move(zs);
+        slots[wr].served = 0;
+    }
 }
 
-template <typename ...Z> void Bridge<Z...>::forward(Zone &z) noexcept {
-        
+void BridgeSlots::forward(Zone &z) noexcept {
     /* Inside a lock_guard scoped block, as we need to access bridge storage
      * variables */
-    std::lock_guard<std::mutex> lock(access);
+    std::lock_guard<Util::Mutex> lock(access);
 
-    zones[wr].emplace_back(z);
+    if ( (!discarding) && (wr >= 0) ) {
+        slots[wr].zones.emplace_back(z);
+    }
 }
 
-template <typename ...Z> Scene& Bridge<Z...>::scene() noexcept {
-    std::lock_guard<std::mutex> lock(access);
-    return scenes[wr];
+Scene &BridgeSlots::newest() noexcept {
+    std::lock_guard<Util::Mutex> lock(access);
+    return slots[std::max(0, wr)].scene;
 }
 
-template <typename ...Z> bool Bridge<Z...>::empty() noexcept {
-    std::lock_guard<std::mutex> lock(access);
-    return ( (rd == wr) && (zones[rd].empty()) );
+bool BridgeSlots::empty(bool zoned) noexcept {
+    std::lock_guard<Util::Mutex> lock(access);
+    return ( (queued.empty()) && 
+             ((!zoned) || (rd < 0) || (slots[rd].drained())) );
 }
 
-template <typename ...Z> Customisation::Error Bridge<Z...>::setup() noexcept {
+Scene *BridgeSlots::next() noexcept {
+    Util::Trace::Span span("bridge", "prepare");
+
     /* Inside a lock_guard scoped block, as we need to access bridge storage
      * variables */
-    std::lock_guard<std::mutex> lock(access);
-    rd = 0;
-    wr = 0;
-    scenes[0] = Scene();
-    scenes[1] = Scene();
-    zones[0].clear();
-    zones[1].clear();
+    {
+        std::lock_guard<Util::Mutex> lock(access);
+
+        if (queued.empty()) {
+            return nullptr;
+        }
+
+        if (rd >= 0) {
+            release(rd);
+        }
+        rd = queued.front();
+        queued.erase(queued.begin());
+    }
 
-    return Customisation::Error::NONE;
+    released.notify_one();
+    return &slots[rd].scene;
 }
 
-template <typename ...Z> void Bridge<Z...>::terminate() noexcept {
-    setup();
+bool BridgeSlots::advance() noexcept {
+    if ( ((rd >= 0) && (!slots[rd].drained())) || (queued.empty()) ) {
+        return false;
+    }
+
+    bool freed = (rd >= 0);
+    if (freed) {
+        release(rd);
+    }
+    rd = queued.front();
+    queued.erase(queued.begin());
+
+    return freed;
 }
 
-template<>
-Error::Type Bridge<Zone>::prepare(Scene*& scn, Zone*& z) noexcept {
+Error::Type BridgeSlots::next(Scene*& scn, Zone*& z) noexcept {
+    Util::Trace::Span span("bridge", "prepare");
+    bool freed;
+
     /* Inside a lock_guard scoped block, as we need to access bridge storage
      * variables */
-     std::lock_guard<std::mutex> lock(access);
-
-    if (rd != wr) {
-        scenes[rd] = Scene();
-        zones[rd].clear();
-        rd = wr;
+    {
+        std::lock_guard<Util::Mutex> lock(access);
+
+        freed = advance();
+        if ( (rd >= 0) && (!slots[rd].drained()) ) {
+            auto &slot = slots[rd];
+            scn = &slot.scene;
+            z   = &slot.zones[slot.served++].get();
+        } else {
+            scn = nullptr;
+        }
     }
 
-    if  (zones[rd].empty()) {
-        return Error::NOT_READY;
+    if (freed) {
+        released.notify_one();
     }
 
-    scn = &scenes[rd];
-    z   = &zones[rd].front().get();
-    zones[rd].erase(zones[rd].begin());
-        
-    return Error::NONE;
+    return (scn != nullptr) ? Error::NONE : Error::NOT_READY;
 }
 
-template<>
-Error::Type Bridge<Zones>::prepare(Scene*& scn, Zones*& zs) noexcept {
+Error::Type BridgeSlots::next(Scene*& scn, Zones*& zs, 
+                              std::size_t count) noexcept {
+    Util::Trace::Span span("bridge", "prepare");
+    bool freed;
+
     /* Inside a lock_guard scoped block, as we need to access bridge storage
      * variables */
-     std::lock_guard<std::mutex> lock(access);
-
-    if (rd != wr) {
-        scenes[rd] = Scene();
-        zones[rd].clear();
-        rd = wr;
+    {
+        std::lock_guard<Util::Mutex> lock(access);
+
+        freed = advance();
+        if ( (rd >= 0) && (!slots[rd].drained()) ) {
+            auto &slot = slots[rd];
+            scn = &slot.scene;
+            auto left = slot.zones.size() - slot.served;
+            if ( (count == 0) || (count > left) ) {
+                count = left;
+            }
+            if ( (slot.served == 0) && (count == left) ) {
+                /* Handing all the zones over without copying them */
+                *zs = std::move(slot.zones);
+                slot.zones.clear();
+                slot.served = 0;
+            } else {
+                auto first = slot.zones.begin() + slot.served;
+                zs->assign(first, first + count);
+                slot.served += zs->size();
+            }
+        } else {
+            scn = nullptr;
+        }
     }
 
-     if  (zones[rd].empty()) {
-        return Error::NOT_READY;
+    if (freed) {
+        released.notify_one();
     }
 
-    scn = &scenes[rd];
-    /* After this the zones[rd] is empty! */
-    *zs  = std::move(zones[rd]);
- 
-    return Error::NONE;
+    return (scn != nullptr) ? Error::NONE : Error::NOT_READY;
 }
 
-/* Fully specialised bridge for full scenes */
-Bridge<>::Bridge() noexcept : Core::Engine<>(), access(), rd(0), wr(0) {}
+/* Both bridges share the same parameters */
+template <typename B> static void parametrise(B &bridge) noexcept {
+    bridge.depth.denominate("depth")
+                .describe("The number of scenes the bridge holds, including "
+                          "the one being processed")
+                .characterise(Customisation::Trait::CONFIGURABLE);
+    bridge.depth.range(2, 64);
+    bridge.depth = 2;
+
+    bridge.policy.denominate("policy")
+                 .describe("What to do with a scene forwarded to a full "
+                           "bridge: either drop-oldest, drop-newest, block "
+                           "until a scene is processed, or keep-latest for "
+                           "dropping the waiting zones with the same UUID")
+                 .characterise(Customisation::Trait::SETTABLE);
+    bridge.policy.define(
+        { { "drop-oldest", 
+            static_cast<int>(BridgeSlots::Policy::DROP_OLDEST) },
+          { "drop-newest", 
+            static_cast<int>(BridgeSlots::Policy::DROP_NEWEST) },
+          { "block",       
+            static_cast<int>(BridgeSlots::Policy::BLOCK) },
+          { "keep-latest", 
+            static_cast<int>(BridgeSlots::Policy::KEEP_LATEST) } });
+    bridge.policy = static_cast<int>(BridgeSlots::Policy::DROP_OLDEST);
+}
 
-void Bridge<>::forward(Scene scn) noexcept {
-    /* Inside a lock_guard scoped block, as we need to access bridge storage
-     * variables */
-    std::lock_guard<std::mutex> lock(access);
+/* Both bridges export the same metrics, the identifier telling apart the
+ * bridges sharing a same name */
+static void collect(Util::Metrics::Exposition &e, const std::string &name,
+                    uint64_t id, const BridgeSlots &slots) noexcept {
+    auto labels = "bridge=" + Util::Metrics::Exposition::quote(name) +
+                  ",id=\"" + std::to_string(id) + "\"";
+    e.counter("vpp_bridge_forwarded_total", 
+              "Scenes forwarded to the bridges", labels,
+              slots.forwarded.load(std::memory_order_relaxed));
+    e.counter("vpp_bridge_dropped_total", 
+              "Scenes dropped by the full bridges", labels,
+              slots.dropped.load(std::memory_order_relaxed));
+}
 
-    if (rd == wr) {
-        wr = (wr+1)%2;
+template <typename ...Z> Bridge<Z...>::Bridge() noexcept : 
+    Core::Engine<Z...>(), slots(), exported(0) {
+    parametrise(*this);
+    this->expose(depth);
+    this->expose(policy);
+
+    batch.denominate("batch")
+         .describe("The maximal number of zones handed over at once, or 0 "
+                   "for all the zones of a scene")
+         .characterise(Customisation::Trait::SETTABLE);
+    batch.range(0, 1024);
+    batch = 0;
+
+    /* Only the bridges for multiple zones hand batches over */
+    if (std::is_same<Bridge<Z...>, Bridge<Zones>>::value) {
+        this->expose(batch);
     }
 
-    scenes[wr] = std::move(scn); 
+    auto &registry = Util::Metrics::Registry::instance();
+    auto id  = registry.identify();
+    exported = registry.attach([this, id](Util::Metrics::Exposition &e) {
+                                   collect(e, this->name(), id, slots); });
+}
+
+template <typename ...Z> Bridge<Z...>::~Bridge() noexcept {
+    Util::Metrics::Registry::instance().detach(exported);
+}
+
+template <typename ...Z> void Bridge<Z...>::forward(Scene scn) noexcept {
+    slots.forward(std::move(scn), 
+                  static_cast<Policy>(static_cast<int>(policy)));
+}
+
+template <typename ...Z> void Bridge<Z...>::forward(Zones zs) noexcept {
+    slots.forward(std::move(zs));
+}
+
+template <typename ...Z> void Bridge<Z...>::forward(Zone &z) noexcept {
+    slots.forward(z);
+}
+
+template <typename ...Z> Scene& Bridge<Z...>::scene() noexcept {
+    return slots.newest();
+}
+
+template <typename ...Z> bool Bridge<Z...>::empty() noexcept {
+    return slots.empty(true);
+}
+
+template <typename ...Z> Customisation::Error Bridge<Z...>::setup() noexcept {
+    slots.reset(depth);
+
+    return Customisation::Error::NONE;
+}
+
+template <typename ...Z> void Bridge<Z...>::terminate() noexcept {
+    setup();
+}
+
+template<>
+Error::Type Bridge<Zone>::prepare(Scene*& scn, Zone*& z) noexcept {
+    return slots.next(scn, z);
+}
+
+template<>
+Error::Type Bridge<Zones>::prepare(Scene*& scn, Zones*& zs) noexcept {
+    return slots.next(scn, zs, static_cast<std::size_t>(batch));
+}
+
+/* Fully specialised bridge for full scenes */
+Bridge<>::Bridge() noexcept : Core::Engine<>(), slots(), exported(0) {
+    parametrise(*this);
+    expose(depth);
+    expose(policy);
+
+    auto &registry = Util::Metrics::Registry::instance();
+    auto id  = registry.identify();
+    exported = registry.attach([this, id](Util::Metrics::Exposition &e) {
+                                   collect(e, name(), id, slots); });
+}
+
+Bridge<>::~Bridge() noexcept {
+    Util::Metrics::Registry::instance().detach(exported);
+}
+
+void Bridge<>::forward(Scene scn) noexcept {
+    slots.forward(std::move(scn), 
+                  static_cast<Policy>(static_cast<int>(policy)));
 }
 
 bool Bridge<>::empty() noexcept {
-    std::lock_guard<std::mutex> lock(access);
-    return (rd == wr);
+    return slots.empty(false);
 }
 
 Customisation::Error Bridge<>::setup() noexcept {
-    /* Inside a lock_guard scoped block, as we need to access bridge storage
-     * variables */
-    std::lock_guard<std::mutex> lock(access);
-    rd = 0;
-    wr = 0;
-    scenes[0] = Scene();
-    scenes[1] = Scene();
+    slots.reset(depth);
 
     return Customisation::Error::NONE;
 }
@@ -170,17 +436,12 @@ void Bridge<>::terminate() noexcept {
 }
 
 Error::Type Bridge<>::prepare(Scene*& scn) noexcept {
-    /* Inside a lock_guard scoped block, as we need to access bridge storage
-     * variables */
-     std::lock_guard<std::mutex> lock(access);
-
-    if (rd == wr) {
+    auto next = slots.next();
+    if (next == nullptr) {
         return Error::NOT_READY;
     }
-        
-    scenes[rd] = Scene();    
-    rd  = wr;
-    scn = &scenes[rd];
+
+    scn = next;
         
     return Error::NONE;
 }
@@ -191,4 +452,3 @@ template class Bridge<Zones>;
 
 }  // namespace Engine
 }  // namespace VPP
-
@@ -0,0 +1,203 @@
+/**
+ *
+ * @file      vpp/engine/cache.cpp
+ *
+ * @brief     These are the VPP classification cache engines
+ *
+ * @details   These engines keep the classification results of the tracked
+ *            zones by UUID, so that zones seen again with fresh enough results
+ *            can skip the classification stages altogether
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "vpp/engine/cache.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Cache {
+
+Store::Store() noexcept 
+    : Customisation::Entity("Cache"), access(), entries(),
+      recency() {
+    lifetime.denominate("lifetime")
+            .describe("The maximal age in seconds of the cached results of a "
+                      "zone before it is classified again")
+            .characterise(Customisation::Trait::SETTABLE);
+    lifetime.range(0.0f, 3600.0f);
+    expose(lifetime);
+
+    overlap.denominate("overlap")
+           .describe("The minimal intersection over union between a zone "
+                     "and its cached bounding box for using its cached "
+                     "results")
+           .characterise(Customisation::Trait::SETTABLE);
+    overlap.range(0.0f, 1.0f);
+    expose(overlap);
+
+    threshold.denominate("threshold")
+             .describe("The minimal best cached score for using the cached "
+                       "results of a zone")
+             .characterise(Customisation::Trait::SETTABLE);
+    threshold.range(0.0f, 1.0f);
+    expose(threshold);
+
+    recall.denominate("recall")
+          .describe("The factor to apply to the cached scores each time they "
+                    "are used")
+          .characterise(Customisation::Trait::SETTABLE);
+    recall.range(0.0f, 1.0f);
+    expose(recall);
+
+    capacity.denominate("capacity")
+            .describe("The maximal number of cached zones, the expired "
+                      "entries being purged first, then the least recently "
+                      "recorded or served ones")
+            .characterise(Customisation::Trait::CONFIGURABLE);
+    capacity.range(1, 1 << 20);
+    expose(capacity);
+
+    lifetime  = 10.0f;
+    overlap   = 0.5f;
+    threshold = 0.2f;
+    recall    = Zone::recall;
+    capacity  = 4096;
+}
+
+Customisation::Error Store::clear() noexcept {
+    std::lock_guard<std::mutex> lock(access);
+    entries.clear();
+    recency.clear();
+    return Customisation::Error::NONE;
+}
+
+bool Store::restore(Zone &zone) noexcept {
+    if (zone.invalid()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(access);
+    auto found = entries.find(zone.uuid);
+    if (found == entries.end()) {
+        return false;
+    }
+
+    /* Apply all the refresh rules and drop the stale entries */
+    auto &e   = found->second;
+    auto  age = std::chrono::duration<float>(Clock::now() - e.stamp).count();
+    float best = 0.0f;
+    for (auto &p : e.predictions) {
+        p.score *= recall;
+        best = std::max(best, p.score);
+    }
+
+    if ( (age > lifetime) || (e.bbox.iou(zone) < overlap) ||
+         (e.predictions.empty()) || (best < threshold) ) {
+        drop(found);
+        return false;
+    }
+
+    /* The served entries are the most recently used ones */
+    recency.splice(recency.begin(), recency, e.recent);
+
+    zone.predictions = e.predictions;
+    zone.labels      = e.labels;
+    zone.description = e.description;
+    e.served = true;
+
+    return true;
+}
+
+void Store::record(const Zone &zone) noexcept {
+    if (zone.invalid()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(access);
+    auto now   = Clock::now();
+    auto found = entries.find(zone.uuid);
+
+    /* Served zones keep their original results and time stamp */
+    if (found != entries.end()) {
+        if (found->second.served) {
+            found->second.served = false;
+            return;
+        }
+        recency.splice(recency.begin(), recency, found->second.recent);
+    } else {
+        if (static_cast<int>(entries.size()) >= capacity) {
+            purge(now);
+        }
+        recency.push_front(zone.uuid);
+        found = entries.emplace(zone.uuid, Entry()).first;
+        found->second.recent = recency.begin();
+    }
+
+    auto &e       = found->second;
+    e.bbox        = zone;
+    e.predictions = zone.predictions;
+    e.labels      = zone.labels;
+    e.description = zone.description;
+    e.stamp       = now;
+    e.served      = false;
+}
+
+bool Store::served(const Zone &zone) const noexcept {
+    std::lock_guard<std::mutex> lock(access);
+    auto found = entries.find(zone.uuid);
+    return (found != entries.end()) && (found->second.served);
+}
+
+void Store::drop(std::unordered_map<uint64_t, Entry>::iterator it) noexcept {
+    recency.erase(it->second.recent);
+    entries.erase(it);
+}
+
+void Store::purge(Clock::time_point now) noexcept {
+    for (auto it = entries.begin(); it != entries.end(); ) {
+        auto age = std::chrono::duration<float>(now - it->second.stamp);
+        if (age.count() > lifetime) {
+            recency.erase(it->second.recent);
+            it = entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    /* Evicting the least recently recorded or served entries until there is
+     * room for a new one */
+    while ( (!recency.empty()) &&
+            (static_cast<int>(entries.size()) >= capacity) ) {
+        entries.erase(recency.back());
+        recency.pop_back();
+    }
+}
+
+Lookup::Lookup(Store &s) noexcept : VPP::Engine::ForZone(), store(s) {}
+
+Lookup::~Lookup() noexcept = default;
+
+Error::Type Lookup::process(Scene &/*scene*/, Zone &zone) noexcept {
+    store.restore(zone);
+    return Error::NONE;
+}
+
+Record::Record(Store &s) noexcept : VPP::Engine::ForZone(), store(s) {}
+
+Record::~Record() noexcept = default;
+
+Error::Type Record::process(Scene &/*scene*/, Zone &zone) noexcept {
+    store.record(zone);
+    return Error::NONE;
+}
+
+}  // namespace Cache
+}  // namespace Engine
+}  // namespace VPP
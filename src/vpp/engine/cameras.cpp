@@ -0,0 +1,239 @@
+/**
+ *
+ * @file      vpp/engine/cameras.cpp
+ *
+ * @brief     This is the VPP multi-camera capture engine implementation
+ *
+ * @details   This engine captures several video sources at once, aligns
+ *            their frames in time and combines them in a single scene.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <future>
+#include <opencv2/imgproc.hpp>
+#include <string>
+
+#include "vpp/log.hpp"
+#include "vpp/engine/cameras.hpp"
+
+namespace VPP {
+namespace Engine {
+
+static const char *names[Cameras::MAX] = { "camera0", "camera1", "camera2",
+                                           "camera3" };
+
+Cameras::Cameras() noexcept : camera(), used(), frames(), areas(), masks(),
+                              composed() {
+
+    /* Define the tolerance parameter */
+    tolerance.denominate("tolerance")
+             .describe("Maximal time difference in milliseconds between the "
+                       "frames of the cameras")
+             .characterise(Customisation::Trait::SETTABLE);
+    tolerance.range(0, 1000);
+    tolerance = 20;
+    expose(tolerance);
+
+    /* Define the retries parameter */
+    retries.denominate("retries")
+           .describe("Number of new captures for a late camera to catch up "
+                     "with the others")
+           .characterise(Customisation::Trait::SETTABLE);
+    retries.range(0, 10);
+    retries = 2;
+    expose(retries);
+
+    /* Define the columns parameter */
+    columns.denominate("columns")
+           .describe("Number of cameras per row of the combined scene (0 for "
+                     "all of them)")
+           .characterise(Customisation::Trait::CONFIGURABLE);
+    columns.range(0, MAX);
+    columns = 0;
+    expose(columns);
+
+    for (int i = 0; i < MAX; ++i) {
+        camera[i].denominate(names[i]);
+        expose(camera[i]);
+    }
+}
+
+Customisation::Error Cameras::setup() noexcept {
+    terminate();
+
+    /* Use all the cameras with a protocol set */
+    for (int i = 0; i < MAX; ++i) {
+        if (static_cast<std::string>(camera[i].protocol).empty()) {
+            continue;
+        }
+
+        auto error = camera[i].setup();
+        if (error != Customisation::Error::NONE) {
+            LOGE("%s[%s]::setup(): Cannot setup camera %d!",
+                 value_to_string().c_str(), name().c_str(), i);
+            terminate();
+            return error;
+        }
+        used.push_back(i);
+    }
+
+    if (used.empty()) {
+        return Customisation::Error::NOT_EXISTING;
+    }
+
+    return Customisation::Error::NONE;
+}
+
+const cv::Rect &Cameras::area(int c) const noexcept {
+    ASSERT((c >= 0) && (c < MAX), "%s[%s]::area(): Invalid camera %d!",
+           value_to_string().c_str(), name().c_str(), c);
+    return areas[c];
+}
+
+Error::Type Cameras::capture(const std::vector<int> &which) noexcept {
+    std::vector<std::future<Error::Type>> reading;
+    reading.reserve(which.size());
+
+    for (auto c : which) {
+        frames[c] = Scene();
+        reading.emplace_back(std::async(std::launch::async, [this, c]() {
+                                 return camera[c].process(frames[c]); }));
+    }
+
+    Error::Type error = Error::NONE;
+    for (auto &r : reading) {
+        auto e = r.get();
+        if (e != Error::NONE) {
+            error = e;
+        }
+    }
+
+    return error;
+}
+
+cv::Mat Cameras::combine() noexcept {
+    const int n    = static_cast<int>(used.size());
+    const int cols = ((columns > 0) && (columns < n)) ? 
+                     static_cast<int>(columns) : n;
+    const int rows = (n + cols - 1) / cols;
+
+    /* All the frames are combined at the size of the first camera */
+    const cv::Size cell = frames[used.front()].view.frame().size();
+    cv::Mat combined(rows * cell.height, cols * cell.width, CV_8UC3, 
+                     cv::Scalar(0, 0, 0));
+
+    for (int i = 0; i < n; ++i) {
+        const int c = used[i];
+        areas[c] = cv::Rect((i % cols) * cell.width, (i / cols) * cell.height,
+                            cell.width, cell.height);
+
+        const cv::Mat &bgr = frames[c].view.bgr().input();
+        cv::Mat        out = combined(areas[c]);
+        if (bgr.size() == cell) {
+            bgr.copyTo(out);
+        } else {
+            cv::resize(bgr, out, cell, 0, 0, cv::INTER_AREA);
+        }
+    }
+
+    return combined;
+}
+
+Error::Type Cameras::process(Scene &scene) noexcept {
+    if (used.empty()) {
+        return Error::NOT_EXISTING;
+    }
+
+    auto error = capture(used);
+    if (error != Error::NONE) {
+        return error;
+    }
+
+    /* Capture the cameras lagging behind the latest frame again, for all the
+     * frames of the slot to be within the tolerance */
+    for (int attempt = 0; attempt < retries; ++attempt) {
+        uint64_t latest = 0;
+        for (auto c : used) {
+            latest = std::max(latest, frames[c].ts_ms());
+        }
+
+        std::vector<int> late;
+        for (auto c : used) {
+            if (frames[c].ts_ms() + static_cast<int>(tolerance) < latest) {
+                late.push_back(c);
+            }
+        }
+
+        if (late.empty()) {
+            break;
+        }
+
+        error = capture(late);
+        if (error != Error::NONE) {
+            return error;
+        }
+    }
+
+    auto combined = combine();
+    scene.view.mask = mosaic(combined.size());
+    return scene.view.use(std::move(combined), Image::Mode::BGR);
+}
+
+std::shared_ptr<const Util::OCV::Mask> Cameras::mosaic(const cv::Size &size)
+    noexcept {
+    bool changed = false;
+    bool masked  = false;
+    for (auto c : used) {
+        changed  = changed || (frames[c].view.mask != masks[c]);
+        masked   = masked || (frames[c].view.mask != nullptr);
+        masks[c] = frames[c].view.mask;
+    }
+
+    if (!masked) {
+        composed.reset();
+    } else if ( (changed) || (composed == nullptr) ) {
+        /* A new mask is composed, as the scenes in flight keep the former */
+        std::vector<const Util::OCV::Mask *> parts;
+        std::vector<cv::Rect_<float>>        cells;
+        for (auto c : used) {
+            parts.push_back(masks[c].get());
+            cells.emplace_back(areas[c].x / static_cast<float>(size.width),
+                               areas[c].y / static_cast<float>(size.height),
+                               areas[c].width / static_cast<float>(size.width),
+                               areas[c].height /
+                               static_cast<float>(size.height));
+        }
+        auto m = std::make_shared<Util::OCV::Mask>();
+        m->compose(parts, cells);
+        composed = std::move(m);
+    }
+
+    return composed;
+}
+
+void Cameras::terminate() noexcept {
+    for (auto c : used) {
+        camera[c].terminate();
+    }
+    used.clear();
+
+    for (auto &a : areas) {
+        a = cv::Rect();
+    }
+    for (auto &m : masks) {
+        m.reset();
+    }
+    composed.reset();
+}
+
+}  // namespace Engine
+}  // namespace VPP
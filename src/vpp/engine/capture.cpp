@@ -16,7 +16,9 @@
  *
  **/
 
+#include <fstream>
 #include <sstream>
+#include <unordered_map>
 
 #include "vpp/config.hpp"
 #include "vpp/log.hpp"
@@ -24,10 +26,18 @@
 #ifdef __ANDROID__
 #include "vpp/util/io/android_camera.hpp"
 #endif
+#ifdef VPP_HAS_GSTREAMER_CAPTURE_SUPPORT
+#include "vpp/util/io/gstreamer.hpp"
+#endif
 #include "vpp/util/io/image.hpp"
+#include "vpp/util/io/recording.hpp"
+#include "vpp/util/io/synthetic.hpp"
 #ifdef VPP_HAS_REALSENSE_CAPTURE_SUPPORT
 #include "vpp/util/io/realsense.hpp"
 #endif
+#ifdef VPP_HAS_V4L2_CAPTURE_SUPPORT
+#include "vpp/util/io/v4l2.hpp"
+#endif
 #ifdef VPP_HAS_OPENCV_VIDEO_IO_SUPPORT
 #include "vpp/util/ocv/capture.hpp"
 #endif
@@ -51,7 +61,124 @@ static bool string2mode(const std::string &m, int &w, int &h, int &r) noexcept {
     return (stream.eof() && (!stream.fail()));
 }
 
-Capture::Capture() noexcept : sources(), current(nullptr), next(nullptr) {
+/* Helper functions to load and save the cache of the probed modes, as
+ * lines of tab-separated device keys and modes */
+using Probed = std::unordered_map<std::string, std::vector<std::string>>;
+
+static Probed load(const std::string &path) noexcept {
+    Probed        probed;
+    std::ifstream file(path);
+    std::string   line;
+
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string        key, m;
+        if (!std::getline(fields, key, '\t')) {
+            continue;
+        }
+        auto &modes = probed[key];
+        while (std::getline(fields, m, '\t')) {
+            modes.emplace_back(std::move(m));
+        }
+    }
+
+    return probed;
+}
+
+static void save(const std::string &path, const Probed &probed) noexcept {
+    std::ofstream file(path, std::ios::trunc);
+
+    for (auto &p : probed) {
+        file << p.first;
+        for (auto &m : p.second) {
+            file << '\t' << m;
+        }
+        file << '\n';
+    }
+}
+
+Capture::Prefetcher::Prefetcher(Util::IO::Input &in, int depth) noexcept
+    : input(in), slots(static_cast<std::size_t>(depth) + 1), head(0),
+      count(0), dropped(false), exiting(false), access(), ready(), served(),
+      worker(&Prefetcher::run, this) {}
+
+Capture::Prefetcher::~Prefetcher() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(access);
+        exiting = true;
+    }
+    served.notify_all();
+    ready.notify_all();
+    worker.join();
+}
+
+Error::Type Capture::Prefetcher::read(cv::Mat &image, Image::Mode &mode,
+                                      bool dropping) noexcept {
+    const std::size_t depth = slots.size() - 1;
+    std::unique_lock<std::mutex> lock(access);
+
+    ready.wait(lock, [this]() { return exiting || (count > 0); });
+    if (count == 0) {
+        return Error::NOT_EXISTING;
+    }
+
+    /* Only the latest frame is kept when dropping the others */
+    dropped = dropping;
+    if (dropping) {
+        head  = (head + count - 1) % depth;
+        count = 1;
+    }
+
+    auto &slot = slots[head];
+    std::swap(image, slot.image);
+    mode  = slot.mode;
+    head  = (head + 1) % depth;
+    count--;
+
+    Error::Type error = slot.error;
+    lock.unlock();
+    served.notify_one();
+
+    return error;
+}
+
+void Capture::Prefetcher::run() noexcept {
+    /* The last slot is a spare one read outside of the lock and swapped in the
+     * ring, so that the ring buffers are reused from one frame to another */
+    const std::size_t depth = slots.size() - 1;
+    auto &spare = slots[depth];
+
+    do {
+        spare.error = input.read(spare.image, spare.mode);
+
+        std::unique_lock<std::mutex> lock(access);
+        served.wait(lock, [this, depth]() {
+                        return exiting || dropped || (count < depth); });
+        if (exiting) {
+            break;
+        }
+
+        /* Overwrite the oldest frame when the ring is full */
+        if (count == depth) {
+            head = (head + 1) % depth;
+            count--;
+        }
+        std::swap(spare, slots[(head + count) % depth]);
+        count++;
+
+        /* Stop reading after an error, once delivered to the pipeline */
+        exiting = (slots[(head + count - 1) % depth].error != Error::NONE);
+        lock.unlock();
+        ready.notify_one();
+    } while (!exiting);
+}
+
+Capture::Capture() noexcept : sources(), current(nullptr), next(nullptr),
+                              prefetcher(), publishing(), converted(),
+                              opened(), wired({ 0, "" }), mask(),
+                              intervals(),
+                              captured(0), failures(0), last(0),
+                              exported(0) {
     /* When seeking a source, seek first for native cameras, then WIFI P2P and
      * fall back to OpenCV VideoCapture in last resort */
 #ifdef __ANDROID__
@@ -62,10 +189,22 @@ Capture::Capture() noexcept : sources(), current(nullptr), next(nullptr) {
     sources.emplace_back(std::unique_ptr<Util::IO::Input>(std::move(new 
                                                     Util::IO::Realsense())));
 #endif
+#ifdef VPP_HAS_V4L2_CAPTURE_SUPPORT
+    sources.emplace_back(std::unique_ptr<Util::IO::Input>(std::move(new 
+                                                    Util::IO::V4L2())));
+#endif
+#ifdef VPP_HAS_GSTREAMER_CAPTURE_SUPPORT
+    sources.emplace_back(std::unique_ptr<Util::IO::Input>(std::move(new 
+                                                    Util::IO::GStreamer())));
+#endif
 #ifdef CUSTOMISATION_HAS_SOCKET
     sources.emplace_back(std::unique_ptr<Util::IO::Input>(std::move(new 
                                                     Util::IO::Image())));
 #endif
+    sources.emplace_back(std::unique_ptr<Util::IO::Input>(std::move(new 
+                                                    Util::IO::Replay())));
+    sources.emplace_back(std::unique_ptr<Util::IO::Input>(std::move(new 
+                                                    Util::IO::Synthetic())));
 #ifdef VPP_HAS_OPENCV_VIDEO_IO_SUPPORT
     sources.emplace_back(std::unique_ptr<Util::IO::Input>(std::move(new 
                                                     Util::OCV::Capture())));
@@ -128,18 +267,148 @@ Capture::Capture() noexcept : sources(), current(nullptr), next(nullptr) {
     mode = "640x480";
     expose(mode);
 
+    /* Define the modes cache parameter */
+    modes_cache.denominate("modes-cache")
+               .describe("File caching the modes probed for the sources (set "
+                         "it before the source, empty for no cache)")
+               .characterise(Customisation::Trait::CONFIGURABLE);
+    expose(modes_cache);
+
+    /* Define the backend parameter */
+    backend.denominate("backend")
+           .describe("Preferred decoding backend for the video source")
+           .characterise(Customisation::Trait::CONFIGURABLE);
+    backend.allow(std::set<std::string>({ "auto", "ffmpeg", "gstreamer",
+                                          "v4l2" }));
+    backend = "auto";
+    expose(backend);
+
+    /* Define the acceleration parameter */
+    acceleration.denominate("acceleration")
+                .describe("Preferred hardware decoding acceleration for the "
+                          "video source")
+                .characterise(Customisation::Trait::CONFIGURABLE);
+    acceleration.allow(std::set<std::string>({ "none", "any", "vaapi",
+                                               "d3d11", "mfx" }));
+    acceleration = "none";
+    expose(acceleration);
+
+    /* Define the prefetch parameter */
+    prefetch.denominate("prefetch")
+            .describe("Number of frames read ahead by a capture thread (0 "
+                      "for reading them synchronously)")
+            .characterise(Customisation::Trait::CONFIGURABLE);
+    prefetch.range(0, 16);
+    prefetch = 0;
+    expose(prefetch);
+
+    /* Define the dropping parameter */
+    dropping.denominate("dropping")
+            .describe("Are the prefetched frames dropped to process the "
+                      "latest one?")
+            .characterise(Customisation::Trait::SETTABLE);
+    dropping.use(Customisation::Translator::BoolFormat::NO_YES);
+    dropping = true;
+    expose(dropping);
+
+    /* Define the conversions parameter */
+    conversions.denominate("conversions")
+               .describe("Colour modes converted at once on every frame for "
+                         "the next stages (bgr, hsv, yuv, ycc or gray)")
+               .characterise(Customisation::Trait::CONFIGURABLE);
+    conversions.trigger([this](const std::string &c) 
+                        { return onConversionsUpdate(c);});
+    expose(conversions);
+
+    /* Define the channel parameter */
+    channel.denominate("channel")
+           .describe("Name of the channel publishing the captured frames to "
+                     "the subscriptions of other pipelines (empty for none)")
+           .characterise(Customisation::Trait::CONFIGURABLE);
+    channel = "";
+    expose(channel);
+
+    /* Define the mask parameters */
+    inclusions.denominate("inclusions")
+              .describe("Polygons of the only areas of the frames to process, "
+                        "as lists of points 'x,y x,y x,y' normalised to the "
+                        "frame size and separated by ';' (empty for the whole "
+                        "frame)")
+              .characterise(Customisation::Trait::CONFIGURABLE);
+    inclusions = "";
+    expose(inclusions);
+
+    exclusions.denominate("exclusions")
+              .describe("Polygons of the areas of the frames never to process, "
+                        "as lists of points 'x,y x,y x,y' normalised to the "
+                        "frame size and separated by ';'")
+              .characterise(Customisation::Trait::CONFIGURABLE);
+    exclusions = "";
+    expose(exclusions);
+
+    masking.denominate("masking")
+           .describe("The masked ratio above which the tiles are skipped and "
+                     "the zones dropped")
+           .characterise(Customisation::Trait::CONFIGURABLE);
+    masking.range(0.0f, 1.0f);
+    masking = 0.5f;
+    expose(masking);
+
     /* Set the protocol whitelist */
     for (auto &s : sources) {
         protocol.allow(s->protocols());
     }
+
+    /* Export the capture metrics whenever the registry is collected */
+    exported = Util::Metrics::Registry::instance().attach(
+        [this](Util::Metrics::Exposition &e) {
+            auto labels = "capture=" + 
+                          Util::Metrics::Exposition::quote(name());
+            e.summary("vpp_capture_interval_seconds",
+                      "Intervals between the captured frames", labels,
+                      intervals);
+            e.counter("vpp_capture_frames_total", "Frames captured", labels,
+                      captured.load(std::memory_order_relaxed));
+            e.counter("vpp_capture_errors_total", "Frames not captured",
+                      labels, failures.load(std::memory_order_relaxed)); });
+}
+
+Capture::~Capture() noexcept {
+    Util::Metrics::Registry::instance().detach(exported);
+}
+
+bool Capture::Settings::operator == (const Settings &other) const noexcept {
+    return (protocol == other.protocol) && (source == other.source) &&
+           (user == other.user) && (password == other.password) &&
+           (backend == other.backend) &&
+           (acceleration == other.acceleration) && (width == other.width) &&
+           (height == other.height) && (rotation == other.rotation);
+}
+
+Capture::Settings Capture::snapshot() const noexcept {
+    return { protocol, source, user, password, backend, acceleration,
+             width, height, rotation };
 }
 
 Customisation::Error Capture::setup() noexcept {
-    Customisation::Error error;
+    Customisation::Error error = remask();
+    if (error != Customisation::Error::NONE) return error;
+
+    /* An open source is only reopened when its own settings have changed */
+    if ( (current != nullptr) && (current == next) &&
+         (snapshot() == opened) ) {
+        rewire();
+        return Customisation::Error::NONE;
+    }
+
     terminate();
     
     if (next == nullptr) return Customisation::Error::NOT_EXISTING;
 
+    if (next->prefer(backend, acceleration)) {
+        return Customisation::Error::INVALID_VALUE;
+    }
+
     error = static_cast<Customisation::Error>(next->open(protocol, source));
     if (error != Customisation::Error::NONE) return error;
     
@@ -162,17 +431,63 @@ Customisation::Error Capture::setup() noexcept {
     width    = w;
     height   = h;
     rotation = r;
+    opened   = snapshot();
+
+    rewire();
 
     return error;
 }
 
+Customisation::Error Capture::remask() noexcept {
+    const std::string &in  = inclusions;
+    const std::string &out = exclusions;
+    if ( (in.empty()) && (out.empty()) ) {
+        mask.reset();
+        return Customisation::Error::NONE;
+    }
+
+    auto m = std::make_shared<Util::OCV::Mask>();
+    if (!m->define(in, out, masking)) {
+        LOGE("%s[%s]::setup(): Invalid mask polygons!",
+             value_to_string().c_str(), name().c_str());
+        return Customisation::Error::INVALID_VALUE;
+    }
+    mask = std::move(m);
+
+    return Customisation::Error::NONE;
+}
+
+void Capture::rewire() noexcept {
+    int         depth = prefetch;
+    std::string c     = channel;
+
+    if ( (depth != wired.prefetch) ||
+         ((prefetcher == nullptr) && (depth > 0)) ) {
+        prefetcher.reset();
+        if (depth > 0) {
+            prefetcher.reset(new Prefetcher(*current, depth));
+        }
+        wired.prefetch = depth;
+    }
+
+    if ( (c != wired.channel) || ((publishing == nullptr) && (!c.empty())) ) {
+        publishing.reset();
+        if (!c.empty()) {
+            publishing = Channel::share(c);
+        }
+        wired.channel = std::move(c);
+    }
+}
+
 Error::Type Capture::process(Scene &orig) noexcept {
     Error::Type error = Error::NOT_EXISTING;
 
     if (current != nullptr) {
         cv::Mat     image;
         Image::Mode mode;
-        error = current->read(image, mode);
+        error = (prefetcher != nullptr) ?
+                    prefetcher->read(image, mode, dropping) :
+                    current->read(image, mode);
         if (! error) {
             if ( (current->projecter() != nullptr) && (mode.is_depth()) ) {
                 orig.view.use(std::move(image), std::move(mode),
@@ -180,6 +495,26 @@ Error::Type Capture::process(Scene &orig) noexcept {
             } else {
                 orig.view.use(std::move(image), std::move(mode));
             }
+            error = current->attach(orig.view);
+            orig.view.mask = mask;
+        }
+        if ( (! error) && (publishing != nullptr) ) {
+            publishing->publish(orig.view);
+        }
+        if ( (! error) && (!converted.empty()) ) {
+            error = orig.view.prefetch(converted);
+        }
+
+        /* Only a single thread processes the captures */
+        if (! error) {
+            auto now = Util::Histogram::now();
+            if (last != 0) {
+                intervals.record(now - last);
+            }
+            last = now;
+            captured.fetch_add(1, std::memory_order_relaxed);
+        } else if (error < 0) {
+            failures.fetch_add(1, std::memory_order_relaxed);
         }
     }
 
@@ -187,10 +522,17 @@ Error::Type Capture::process(Scene &orig) noexcept {
 }
 
 void Capture::terminate() noexcept {
+    /* Stop the capture thread before closing its input */
+    prefetcher.reset();
+    publishing.reset();
+
     if (current != nullptr) {
         current->close();
         current = nullptr;
     }
+
+    /* The next source does not follow the frames of this one */
+    last = 0;
 }
 
 Customisation::Error Capture::onProtocolUpdate(const std::string &p) noexcept {
@@ -233,7 +575,7 @@ Customisation::Error
     rotation = 0;
 
     if (!error) {
-        auto new_modes = next->modes();
+        auto new_modes = probe(s);
         if (!new_modes.empty()) {
             bool default_mode_set = false;
             for (auto &m : new_modes) { 
@@ -258,6 +600,30 @@ Customisation::Error
     return static_cast<Customisation::Error>(error);
 }
 
+std::vector<std::string> Capture::probe(const std::string &s) noexcept {
+    const std::string &path = modes_cache;
+    const auto         id   = next->identity();
+
+    /* Probe the modes of the sources which cannot be identified */
+    if (path.empty() || id.empty()) {
+        return next->modes();
+    }
+
+    const std::string key(static_cast<std::string>(protocol) + " " + s + " " +
+                          id);
+    auto probed = load(path);
+    auto found  = probed.find(key);
+    if (found != probed.end()) {
+        return found->second;
+    }
+
+    auto modes = next->modes();
+    probed[key] = modes;
+    save(path, probed);
+
+    return modes;
+}
+
 Customisation::Error Capture::onUserUpdate(const std::string &u) noexcept {
     if (u.empty()) {
         static_cast<std::string>(password).clear();
@@ -265,6 +631,38 @@ Customisation::Error Capture::onUserUpdate(const std::string &u) noexcept {
     return Customisation::Error::NONE;
 }
 
+Customisation::Error 
+    Capture::onConversionsUpdate(const std::string &c) noexcept {
+    static const std::unordered_map<std::string, int> names = {
+        { "bgr",  Image::Mode::BGR   }, { "hsv",  Image::Mode::HSV   },
+        { "yuv",  Image::Mode::YUV   }, { "ycc",  Image::Mode::YCrCb },
+        { "gray", Image::Mode::GRAY  } };
+    std::vector<Image::Mode> modes;
+    std::istringstream       stream(c);
+    std::string              m;
+
+    while (std::getline(stream, m, ',')) {
+        std::istringstream word(m);
+        word >> m;
+        if (m.empty() || (!word)) {
+            continue;
+        }
+        auto found = names.find(m);
+        if (found == names.end()) {
+            ASSERT((false),
+                   "%s::Capture[%s]::onConversionsUpdate(): Invalid mode "
+                   "provided %s!",
+                   value_to_string().c_str(), name().c_str(), m.c_str());
+            return Customisation::Error::INVALID_VALUE;
+        }
+        modes.emplace_back(found->second);
+    }
+
+    converted = std::move(modes);
+
+    return Customisation::Error::NONE;
+}
+
 Customisation::Error Capture::onModeUpdate(const std::string &m) noexcept {
     int w, h, r;
     
@@ -14,79 +14,168 @@
  *
  **/
 
+#include <algorithm>
+#include <vector>
 #include <opencv2/opencv.hpp>
 
 #include "vpp/log.hpp"
 #include "vpp/engine/classifier/ocv.hpp"
+#include "vpp/util/task.hpp"
 
 namespace VPP {
 namespace Engine {
 namespace Classifier {
 
-OCV::OCV() noexcept = default;
-OCV::~OCV() noexcept = default;
-
-Error::Type OCV::process(Scene &scene, Zone &zone) noexcept {
-    cv::Mat  blob, area, output, predictions, indexes;
-    cv::Mat  background(static_cast<cv::Size>(size), CV_8UC3, offset);
-    const cv::Mat &input = scene.view.bgr().input();
-    cv::Size scaled;
-    cv::Point at(0,0);
-    int zonew = zone.width;
-    int zoneh = zone.height;
-    int centrex = zone.x+zone.width/2;
-    int centrey = zone.y+zone.height/2;
-    float xscale, yscale, scale;
-    int inputw, inputh, origw, origh;
-
-    // Get the scaling factor (no more than 4 !)
-    xscale = (static_cast<float>(size.width))/(static_cast<float>(zonew));
-    yscale = (static_cast<float>(size.height))/(static_cast<float>(zoneh));
-    scale = std::min(std::min(xscale, yscale), 4.0f);
-   
-    // Compute the actual BB size for classification 
-    inputw = static_cast<int>(static_cast<float>(size.width)/scale);
-    inputh = static_cast<int>(static_cast<float>(size.height)/scale);
-    origw=std::min(std::min(inputw/2, centrex), input.cols-centrex);
-    origh=std::min(std::min(inputh/2, centrey), input.rows-centrey);
-
-    scaled.width = static_cast<int>(scale*2*origw);
-    scaled.height = static_cast<int>(scale*2*origh);
-    at.x=(static_cast<int>(size.width)-scaled.width)/2;
-    at.y=(static_cast<int>(size.height)-scaled.height)/2;
-  
-    // Crop the region of interest
-    cv::Rect ROI(centrex-origw, centrey-origh, 2*origw, 2*origh);
-    cv::resize(cv::Mat(input, ROI), area, scaled, 0, 0, cv::INTER_NEAREST);
-    area.copyTo(background(cv::Rect(at, scaled)));
-
-    // Create the 4D blob corresponding to the cropped image 
-    cv::dnn::blobFromImage(background, blob, scale, size, offset, RGB,
+/* Build the 4D blob of a letterboxed crop, possibly straight in a batch */
+static void blob(const View::Crops::Crop &crop, const cv::Size &size,
+                 const cv::Scalar &offset, bool RGB, cv::Mat &out) noexcept {
+    cv::dnn::blobFromImage(crop.image, out, crop.scale, size, offset, RGB,
                            false);
+}
 
-    // Place the image-based blob at the input of the network
-    net.setInput(blob);
-
-    // Infer !
-    output = net.forward();
+/* Keep the top predictions of a row of scores for the zone */
+template <typename E>
+static void annotate(E &engine, Zone &zone, 
+                     const cv::Mat &predictions) noexcept {
+    cv::Mat indexes;
 
     // Get the classes with the highest scores
-    predictions = output.reshape(1, 1); 
     cv::sortIdx(predictions, indexes, cv::SORT_EVERY_ROW | cv::SORT_DESCENDING);
 
-    for (int idx=0; idx < 5; idx++) {
+    for (int idx=0; idx < std::min(5, predictions.cols); idx++) {
         auto cid = static_cast<int16_t>(indexes.at<int>(idx));
         auto score = predictions.at<float>(cid);
-        if (score > threshold) {
-            zone.predictions.emplace_back(Prediction(score, dataset.ID(), cid));
+        if (score > engine.threshold) {
+            zone.predictions.insert(Prediction(score, engine.dataset.ID(), 
+                                               cid));
+        }
+    }
+
+    engine.tag(zone);
+}
+
+OCV::OCV() noexcept = default;
+OCV::~OCV() noexcept = default;
+
+VPP::Core::Operation OCV::launch(Scene &scene, Zone &zone) noexcept {
+    cv::Mat input;
+    auto    sz    = static_cast<cv::Size>(size);
+    auto    crops = scene.view.crops(Image::Mode::BGR, sz, offset).of({ zone });
+
+    blob(crops.front(), sz, offset, RGB, input);
+
+    if (!remote.enabled()) {
+        classify(zone, input);
+        return VPP::Core::Operation(Error::NONE);
+    }
+
+    /* Infer the blob on the server, batched with the other zones in flight,
+     * the zone being annotated in the thread receiving its response, or
+     * classified locally on the task pool for the lack of a response */
+    VPP::Core::Operation done;
+    auto started  = Util::Histogram::now();
+    auto priority = Util::Task::Priority::current();
+    remote.infer(input, true,
+                 [this, &zone, input, done, started, priority]
+                 (std::vector<cv::Mat> &outputs) mutable {
+        inference.record(Util::Histogram::now() - started);
+        if (!outputs.empty()) {
+            annotate(*this, zone, outputs.front().reshape(1, 1));
+            done.complete(Error::NONE);
+            return;
         }
+
+        auto &pool = Util::Task::Pool::instance();
+        if (pool.size() == 0) {
+            classify(zone, input);
+            done.complete(Error::NONE);
+            return;
+        }
+
+        Util::Task::Core::Work work = [this, &zone, input, done]()
+            mutable noexcept {
+                classify(zone, input);
+                done.complete(Error::NONE);
+                return 0; };
+        pool.submit(work, priority); });
+
+    return done;
+}
+
+void OCV::classify(Zone &zone, const cv::Mat &input) noexcept {
+    cv::Mat output;
+    {
+        /* Place the image-based blob at the input of the (shared) network */
+        auto lock = reserve();
+        net.setInput(input);
+
+        // Infer !
+        Util::Timing timing(inference);
+        output = net.forward();
+    }
+
+    annotate(*this, zone, output.reshape(1, 1));
+}
+
+Batch::Batch() noexcept : batch(16) {
+    batch.denominate("batch")
+         .describe("The maximal number of zones classified in a single "
+                   "forward pass")
+         .characterise(Customisation::Trait::CONFIGURABLE);
+    batch.range(1, 256);
+    Customisation::Entity::expose(batch);
+}
+
+Batch::~Batch() noexcept = default;
+
+int Batch::batching() noexcept {
+    return batch;
+}
+
+Error::Type Batch::process(Scene &scene, Zones &zones) noexcept {
+    auto sz    = static_cast<cv::Size>(size);
+    int  total = static_cast<int>(zones.size());
+    int  most  = batch;
+
+    // Letterbox all the zones at once, sharing the crops of the scene
+    std::vector<cv::Rect> areas;
+    areas.reserve(zones.size());
+    for (auto &z : zones) {
+        areas.push_back(z.get());
     }
+    auto crops = scene.view.crops(Image::Mode::BGR, sz, offset).of(areas);
+
+    for (int first = 0; first < total; first += most) {
+        int n = std::min(most, total - first);
+        int shape[] = { n, 3, sz.height, sz.width };
+        int one[]   = { 1, 3, sz.height, sz.width };
+        cv::Mat input(4, shape, CV_32F);
+        cv::Mat output;
 
-    auto desc = label(zone);
-    if (!desc.empty()) {
-        zone.description += "(";
-        zone.description += desc;
-        zone.description += ")";
+        // Build the blobs of the letterboxed zones straight in the batch
+        for (int i = 0; i < n; ++i) {
+            cv::Mat row(4, one, CV_32F, input.ptr<float>(i));
+            blob(crops[first+i], sz, offset, RGB, row);
+        }
+
+        // Infer the whole batch at once on the server or on the (shared)
+        // network !
+        std::vector<cv::Mat> outputs;
+        if (offload(input, outputs, true)) {
+            output = outputs.front();
+        } else {
+            auto lock = reserve();
+            net.setInput(input);
+            Util::Timing timing(inference);
+            output = net.forward();
+        }
+
+        // Scatter one row of scores per zone
+        int classes = static_cast<int>(output.total())/n;
+        cv::Mat predictions(n, classes, CV_32F, output.ptr<float>());
+        for (int i = 0; i < n; ++i) {
+            annotate(*this, zones[first+i], predictions.row(i));
+        }
     }
 
     return Error::NONE;
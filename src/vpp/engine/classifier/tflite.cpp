@@ -0,0 +1,69 @@
+/**
+ *
+ * @file      vpp/engine/classifier/tflite.cpp
+ *
+ * @brief     This is the VPP TFLite DNN classifier implementation file
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <vector>
+
+#include "vpp/log.hpp"
+#include "vpp/engine/classifier/tflite.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Classifier {
+
+TFLite::TFLite() noexcept = default;
+TFLite::~TFLite() noexcept = default;
+
+Error::Type TFLite::process(Scene &scene, Zone &zone) noexcept {
+    cv::Mat predictions, indexes;
+    auto    crops = scene.view.crops(Image::Mode::BGR, shape, offset)
+                              .of({ zone });
+
+    /* The letterboxed crop is copied right into the input tensor */
+    {
+        auto lock = reserve();
+        fill(crops.front().image);
+        if (!invoke()) {
+            LOGE("%s[%s]::process(): Cannot infer the TFLite model!",
+                 value_to_string().c_str(), name().c_str());
+            return Error::INVALID_VALUE;
+        }
+        predictions = output(0);
+    }
+
+    if (predictions.empty()) {
+        return Error::NONE;
+    }
+
+    // Get the classes with the highest scores
+    cv::sortIdx(predictions, indexes, cv::SORT_EVERY_ROW | cv::SORT_DESCENDING);
+
+    for (int idx=0; idx < std::min(5, predictions.cols); idx++) {
+        auto cid = static_cast<int16_t>(indexes.at<int>(idx));
+        auto score = predictions.at<float>(cid);
+        if (score > threshold) {
+            zone.predictions.insert(Prediction(score, dataset.ID(), cid));
+        }
+    }
+
+    tag(zone);
+
+    return Error::NONE;
+}
+
+}  // namespace Classifier
+}  // namespace Engine
+}  // namespace VPP
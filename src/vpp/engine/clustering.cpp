@@ -23,7 +23,8 @@ namespace Engine {
 Clustering::Clustering() noexcept
     : dnj(Util::Task::Core::Mode::Sync)
 #ifdef VPP_HAS_SIMILARITY_CLUSTERING_SUPPORT
-      , similarity(Util::Task::Core::Mode::Sync)
+      , similarity(Util::Task::Core::Mode::Sync),
+      classwise(Util::Task::Core::Mode::Async*8)
 #endif
       {
 #ifdef VPP_HAS_SIMILARITY_CLUSTERING_SUPPORT
@@ -32,6 +33,12 @@ Clustering::Clustering() noexcept
 
     similarity.filter = ([](const Zone &){ return false; });
     similarity.threshold = 1.0f;
+
+    classwise.denominate("classwise");
+    expose(classwise);
+
+    classwise.filter = ([](const Zone &){ return false; });
+    classwise.threshold = 1.0f;
 #endif
 
     dnj.denominate("dnj");
@@ -48,6 +55,9 @@ Error::Type Clustering::process(Scene &scene) noexcept {
     if (err_sim != Error::NONE) return err_sim;
     err_sim = similarity.wait();
     if (err_sim != Error::NONE) return err_sim;
+
+    err_sim = classwise.cluster(scene);
+    if (err_sim != Error::NONE) return err_sim;
 #endif
 
     auto err_dnj = dnj.start(scene);
@@ -0,0 +1,117 @@
+/**
+ *
+ * @file      vpp/engine/culling.cpp
+ *
+ * @brief     These are the VPP engines culling the zones out of range
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <cmath>
+
+#include "vpp/log.hpp"
+#include "vpp/engine/culling.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Culling {
+
+Depth::Depth() noexcept : culled(0), exported(0) {
+    nearest.denominate("nearest")
+           .describe("The depth in metres below which a zone is culled")
+           .characterise(Customisation::Trait::SETTABLE);
+    nearest.range(0.0f, 100.0f);
+    expose(nearest);
+    nearest = 0.0f;
+
+    farthest.denominate("farthest")
+            .describe("The depth in metres above which a zone is culled")
+            .characterise(Customisation::Trait::SETTABLE);
+    farthest.range(0.0f, 100.0f);
+    expose(farthest);
+    farthest = 10.0f;
+
+    smallest.denominate("smallest")
+            .describe("The size in metres of the largest side of a zone "
+                      "below which it is culled")
+            .characterise(Customisation::Trait::SETTABLE);
+    smallest.range(0.0f, 100.0f);
+    expose(smallest);
+    smallest = 0.0f;
+
+    largest.denominate("largest")
+           .describe("The size in metres of the largest side of a zone "
+                     "above which it is culled")
+           .characterise(Customisation::Trait::SETTABLE);
+    largest.range(0.0f, 100.0f);
+    expose(largest);
+    largest = 100.0f;
+
+    unknown.denominate("unknown")
+           .describe("Are the zones without any valid depth kept?")
+           .characterise(Customisation::Trait::SETTABLE);
+    unknown.use(Customisation::Translator::BoolFormat::NO_YES);
+    expose(unknown);
+    unknown = true;
+
+    exported = Util::Metrics::Registry::instance().attach(
+        [this](Util::Metrics::Exposition &e) {
+            e.counter("vpp_culled_zones_total",
+                      "Zones out of the depth and size windows",
+                      "engine=" + Util::Metrics::Exposition::quote(name()),
+                      culled.load(std::memory_order_relaxed)); });
+}
+
+Depth::~Depth() noexcept {
+    Util::Metrics::Registry::instance().detach(exported);
+}
+
+Error::Type Depth::process(Scene &scene) noexcept {
+    /* Nothing to cull without any depth */
+    if ( (!scene.view.depth.available()) || (scene.empty()) ) {
+        return Error::NONE;
+    }
+
+    /* The metric sizes are those of the states, deprojected all at once */
+    scene.deproject();
+
+    const float closest  = nearest;
+    const float furthest = farthest;
+    const float tiniest  = smallest;
+    const float biggest  = largest;
+    const bool  keep     = unknown;
+    const auto &depth    = scene.view.depth;
+    auto out = scene.extract([&](const Zone &z) noexcept {
+                   auto d = depth.at(static_cast<const cv::Rect &>(z));
+                   if (d <= 0) {
+                       return !keep;
+                   }
+                   if ( (d < closest) || (d > furthest) ) {
+                       return true;
+                   }
+                   if ( (!z.deprojected) || (z.state.centre.z <= 0) ) {
+                       return false;
+                   }
+                   auto side = std::max(std::abs(z.state.size.x),
+                                        std::abs(z.state.size.y));
+                   return (side < tiniest) || (side > biggest); });
+
+    if (!out.empty()) {
+        culled.fetch_add(out.size(), std::memory_order_relaxed);
+        scene.recycle(out);
+    }
+
+    return Error::NONE;
+}
+
+}  // namespace Culling
+}  // namespace Engine
+}  // namespace VPP
@@ -0,0 +1,193 @@
+/**
+ *
+ * @file      vpp/engine/detector/background.cpp
+ *
+ * @brief     This is the VPP background subtraction detector implementation
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+
+#include "vpp/log.hpp"
+#include "vpp/engine/detector/background.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Detector {
+
+Background::Background() noexcept 
+    : Engine::ForScene(), subtractor(), mask(), labels(), stats(), 
+      centroids(), stamp(0), share(-1.0f) {
+    model.denominate("model")
+         .describe("The background subtraction model, either mog2 for a "
+                   "mixture of gaussians or knn for the k nearest neighbours")
+         .characterise(Customisation::Trait::CONFIGURABLE);
+    model.define({ { "mog2", static_cast<int>(Model::MOG2) },
+                   { "knn",  static_cast<int>(Model::KNN) } });
+    expose(model);
+    model = static_cast<int>(Model::MOG2);
+
+    level.denominate("level")
+         .describe("The pyramid level of the gray frame the background model "
+                   "is built upon, every level halving the frame size")
+         .characterise(Customisation::Trait::CONFIGURABLE);
+    level.range(0, 4);
+    expose(level);
+    level = 2;
+
+    history.denominate("history")
+           .describe("The number of frames the background model is built "
+                     "upon")
+           .characterise(Customisation::Trait::CONFIGURABLE);
+    history.range(1, 10000);
+    expose(history);
+    history = 500;
+
+    distance.denominate("distance")
+            .describe("The squared distance of a pixel to the background "
+                      "model above which it belongs to the foreground")
+            .characterise(Customisation::Trait::CONFIGURABLE);
+    distance.range(1.0, 10000.0);
+    expose(distance);
+    distance = 16.0;
+
+    learning.denominate("learning")
+            .describe("The learning rate of the background model, between 0 "
+                      "and 1 (or negative for an automatic rate)")
+            .characterise(Customisation::Trait::SETTABLE);
+    learning.range(-1.0, 1.0);
+    expose(learning);
+    learning = -1.0;
+
+    dilation.denominate("dilation")
+            .describe("The dilation in pixels to apply to the foreground "
+                      "pixels before grouping them into zones")
+            .characterise(Customisation::Trait::SETTABLE);
+    dilation.range(0, 64);
+    expose(dilation);
+    dilation = 2;
+
+    area.denominate("area")
+        .describe("The minimal area in frame pixels of a foreground zone")
+        .characterise(Customisation::Trait::SETTABLE);
+    area.range(0, 1 << 24);
+    expose(area);
+    area = 256;
+}
+
+Customisation::Error Background::setup() noexcept {
+    /* Shadows are only wasting cycles, as they are foreground pixels */
+    auto h = static_cast<int>(history);
+    auto d = static_cast<double>(distance);
+    if (static_cast<int>(model) == static_cast<int>(Model::KNN)) {
+        subtractor = cv::createBackgroundSubtractorKNN(h, d, false);
+    } else {
+        subtractor = cv::createBackgroundSubtractorMOG2(h, d, false);
+    }
+
+    if (subtractor.empty()) {
+        LOGE("%s[%s]::setup(): Cannot create the background model!",
+             value_to_string().c_str(), name().c_str());
+        return Customisation::Error::INVALID_VALUE;
+    }
+
+    stamp = 0;
+    share = -1.0f;
+
+    return Customisation::Error::NONE;
+}
+
+Error::Type Background::measure(Scene &scene) noexcept {
+    /* The model is lazily created when only used as a gate */
+    if ( (subtractor.empty()) && 
+         (setup() != Customisation::Error::NONE) ) {
+        return Error::NOT_READY;
+    }
+
+    /* Measuring the same scene twice would learn it twice */
+    if ( (stamp != 0) && (stamp == scene.ts_ms()) ) {
+        return Error::NONE;
+    }
+
+    scene.view.cache(VPP::Image::Mode::GRAY);
+    const auto &gray = scene.view.pyramid(VPP::Image::Mode::GRAY)
+                                 .level(static_cast<int>(level));
+    subtractor->apply(gray, mask, static_cast<double>(learning));
+
+    stamp = scene.ts_ms();
+    share = static_cast<float>(cv::countNonZero(mask)) / 
+            static_cast<float>(std::max(1, static_cast<int>(mask.total())));
+
+    return Error::NONE;
+}
+
+Error::Type Background::process(Scene &scene) noexcept {
+    auto e = measure(scene);
+    if ( (e != Error::NONE) || (share <= 0.0f) ) {
+        return e;
+    }
+
+    if (dilation > 0) {
+        auto d = 2 * static_cast<int>(dilation) + 1;
+        cv::dilate(mask, mask, 
+                   cv::getStructuringElement(cv::MORPH_RECT, cv::Size(d, d)));
+    }
+
+    auto n = cv::connectedComponentsWithStats(mask, labels, stats, centroids,
+                                              8, CV_32S);
+
+    /* The model may be built at a lower resolution than the frame */
+    const auto &frame = scene.view.frame();
+    auto sx = static_cast<float>(frame.width) / mask.cols;
+    auto sy = static_cast<float>(frame.height) / mask.rows;
+    auto minimum = area / (sx * sy);
+
+    /* The label 0 is the background itself */
+    for (int i = 1; i < n; ++i) {
+        const int *s = stats.ptr<int>(i);
+        if (s[cv::CC_STAT_AREA] < minimum) {
+            continue;
+        }
+        cv::Rect zone(static_cast<int>(s[cv::CC_STAT_LEFT] * sx),
+                      static_cast<int>(s[cv::CC_STAT_TOP] * sy),
+                      static_cast<int>(s[cv::CC_STAT_WIDTH] * sx),
+                      static_cast<int>(s[cv::CC_STAT_HEIGHT] * sy));
+        zone &= frame;
+        if (zone.area() > 0) {
+            scene.mark(zone);
+        }
+    }
+
+    return Error::NONE;
+}
+
+float Background::foreground(const Scene &scene) const noexcept {
+    if ( (stamp == 0) || (stamp != scene.ts_ms()) ) {
+        return -1.0f;
+    }
+
+    return share;
+}
+
+void Background::terminate() noexcept {
+    subtractor.release();
+    mask.release();
+    labels.release();
+    stats.release();
+    centroids.release();
+    stamp = 0;
+    share = -1.0f;
+}
+
+}  // namespace Detector
+}  // namespace Engine
+}  // namespace VPP
@@ -0,0 +1,242 @@
+/**
+ *
+ * @file      vpp/engine/detector/cascade.cpp
+ *
+ * @brief     This is the VPP cascade detector implementation file
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <opencv2/core/core.hpp>
+
+#include "vpp/log.hpp"
+#include "vpp/engine/detector/cascade.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Detector {
+
+Cascade::Level::Level() noexcept : latency(), scenes(0), zones(0) {}
+
+Cascade::Cascade() noexcept
+    : ForScene(), fast(), accurate(), first(), second(), confident(0),
+      uncertain(0), rejected(0), merger(), found(), boxes(), scores(),
+      classIds(), indices(), exported(0) {
+    low.denominate("low")
+       .describe("The score below which the zones of the fast detector are "
+                 "rejected")
+       .characterise(Customisation::Trait::SETTABLE);
+    low.range(0.0f, 1.0f);
+    expose(low);
+    low = 0.3f;
+
+    high.denominate("high")
+        .describe("The score from which the zones of the fast detector are "
+                  "kept without running the accurate detector")
+        .characterise(Customisation::Trait::SETTABLE);
+    high.range(0.0f, 1.0f);
+    expose(high);
+    high = 0.7f;
+
+    routing.denominate("routing")
+           .describe("The handling of the uncertain zones: either frame for "
+                     "detecting again the full frame with the accurate "
+                     "detector, or regions for only detecting again around "
+                     "the uncertain zones")
+           .characterise(Customisation::Trait::SETTABLE);
+    routing.define({ { "frame",   static_cast<int>(Routing::FRAME) },
+                     { "regions", static_cast<int>(Routing::REGIONS) } });
+    expose(routing);
+    routing = static_cast<int>(Routing::REGIONS);
+
+    margin.denominate("margin")
+          .describe("The share of their size by which the regions of the "
+                    "uncertain zones are grown on each side")
+          .characterise(Customisation::Trait::SETTABLE);
+    margin.range(0.0f, 1.0f);
+    expose(margin);
+    margin = 0.25f;
+
+    fast.denominate("fast");
+    expose(fast);
+
+    accurate.denominate("accurate");
+    expose(accurate);
+
+    exported = Util::Metrics::Registry::instance().attach(
+        [this](Util::Metrics::Exposition &e) {
+            using Util::Metrics::Exposition;
+            auto labels = "engine=" + Exposition::quote(name());
+            auto l1     = labels + ",level=" + Exposition::quote("fast");
+            auto l2     = labels + ",level=" + Exposition::quote("accurate");
+
+            e.summary("vpp_cascade_latency_seconds",
+                      "Detection latency of the cascade levels", l1,
+                      first.latency);
+            e.summary("vpp_cascade_latency_seconds",
+                      "Detection latency of the cascade levels", l2,
+                      second.latency);
+            e.counter("vpp_cascade_scenes_total",
+                      "Scenes detected by the cascade levels", l1,
+                      first.scenes.load(std::memory_order_relaxed));
+            e.counter("vpp_cascade_scenes_total",
+                      "Scenes detected by the cascade levels", l2,
+                      second.scenes.load(std::memory_order_relaxed));
+            e.counter("vpp_cascade_zones_total",
+                      "Zones detected by the cascade levels", l1,
+                      first.zones.load(std::memory_order_relaxed));
+            e.counter("vpp_cascade_zones_total",
+                      "Zones detected by the cascade levels", l2,
+                      second.zones.load(std::memory_order_relaxed));
+
+            auto outcome = labels + ",outcome=";
+            e.counter("vpp_cascade_outcomes_total",
+                      "Zones of the fast level by score band",
+                      outcome + Exposition::quote("confident"),
+                      confident.load(std::memory_order_relaxed));
+            e.counter("vpp_cascade_outcomes_total",
+                      "Zones of the fast level by score band",
+                      outcome + Exposition::quote("uncertain"),
+                      uncertain.load(std::memory_order_relaxed));
+            e.counter("vpp_cascade_outcomes_total",
+                      "Zones of the fast level by score band",
+                      outcome + Exposition::quote("rejected"),
+                      rejected.load(std::memory_order_relaxed)); });
+}
+
+Cascade::~Cascade() noexcept {
+    Util::Metrics::Registry::instance().detach(exported);
+}
+
+Error::Type Cascade::process(Scene &scene) noexcept {
+    Error::Type error;
+    {
+        Util::Timing timing(first.latency);
+        error = fast.process(scene);
+    }
+    if (error != Error::NONE) {
+        return error;
+    }
+
+    /* Sort the fast detector zones out by their top score */
+    const float lowest  = low;
+    const float highest = high;
+    auto dropped = scene.extract([lowest](const Zone &z) noexcept {
+                                     return z.context.score < lowest; });
+    auto doubts  = scene.extract([highest](const Zone &z) noexcept {
+                                     return z.context.score < highest; });
+    auto kept    = scene.zones().size();
+
+    first.scenes.fetch_add(1, std::memory_order_relaxed);
+    first.zones.fetch_add(kept + doubts.size() + dropped.size(),
+                          std::memory_order_relaxed);
+    confident.fetch_add(kept, std::memory_order_relaxed);
+    uncertain.fetch_add(doubts.size(), std::memory_order_relaxed);
+    rejected.fetch_add(dropped.size(), std::memory_order_relaxed);
+    scene.recycle(dropped);
+
+    if (!doubts.empty()) {
+        Util::Timing timing(second.latency);
+        second.scenes.fetch_add(1, std::memory_order_relaxed);
+        error = refine(scene, doubts);
+    }
+    scene.recycle(doubts);
+
+    return error;
+}
+
+Error::Type Cascade::refine(Scene &scene,
+                            std::list<Zone> &doubts) noexcept {
+    if (static_cast<Routing>(static_cast<int>(routing)) == Routing::FRAME) {
+        /* The accurate detector is authoritative on the full frame */
+        auto confidents = scene.extract([](const Zone &) noexcept {
+                                            return true; });
+        scene.recycle(confidents);
+
+        auto error = accurate.process(scene);
+        second.zones.fetch_add(scene.zones().size(),
+                               std::memory_order_relaxed);
+        return error;
+    }
+
+    const cv::Mat &frame = scene.view.bgr().input();
+    const cv::Rect bounds(0, 0, frame.cols, frame.rows);
+    const float    grown = margin;
+
+    found.clear();
+    boxes.clear();
+    scores.clear();
+    classIds.clear();
+
+    for (auto &d : doubts) {
+        cv::Rect r = d;
+        auto dx = static_cast<int>(r.width * grown);
+        auto dy = static_cast<int>(r.height * grown);
+        r.x      -= dx;
+        r.y      -= dy;
+        r.width  += 2 * dx;
+        r.height += 2 * dy;
+        r        &= bounds;
+        if (r.area() <= 0) {
+            continue;
+        }
+
+        /* Detect within a scene viewing the region only */
+        Scene crop;
+        crop.view.stamp(scene.ts_ms());
+        crop.keyframe(true);
+        crop.view.use(frame(r), VPP::Image::Mode::BGR);
+        auto error = accurate.process(crop);
+        if (error != Error::NONE) {
+            LOGE("%s[%s]::refine(): Accurate detection failed with error %d",
+                 value_to_string().c_str(), name().c_str(), error);
+            return error;
+        }
+
+        /* And map the detected zones back to the frame coordinates */
+        for (auto &z : crop.zones()) {
+            Zone zone(z.get());
+            zone.x += r.x;
+            zone.y += r.y;
+            boxes.emplace_back(zone);
+            scores.emplace_back(zone.context.score);
+            classIds.emplace_back(zone.context.id);
+            found.emplace_back(std::move(zone));
+        }
+    }
+
+    /* The overlapping regions may detect the same objects, which are merged
+     * into the best scoring zone grown to all of them */
+    const float overlap = accurate.nms;
+    if (overlap >= 0) {
+        merger.threshold = overlap;
+        merger.classwise = accurate.classwise;
+        merger.merging   = true;
+        merger.apply(boxes, scores, classIds, indices);
+    } else {
+        indices.clear();
+        for (std::size_t i = 0; i < found.size(); ++i) {
+            indices.emplace_back(static_cast<int>(i));
+        }
+    }
+
+    for (auto k : indices) {
+        auto &zone = found[k];
+        static_cast<cv::Rect &>(zone) = boxes[k];
+        scene.mark(std::move(zone));
+        second.zones.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return Error::NONE;
+}
+
+}  // namespace Detector
+}  // namespace Engine
+}  // namespace VPP
@@ -17,14 +17,26 @@
  *
  **/
 
+#include <algorithm>
+#include <map>
+#include <opencv2/imgproc.hpp>
+#include <tuple>
+
 #include "vpp/log.hpp"
 #include "vpp/engine/detector/darknet.hpp"
+#include "vpp/util/ocv/functions.hpp"
+#include "vpp/util/task.hpp"
 
 /* This is missing from the standard YOLO source code includes */
 extern "C" {
 void fill_image(image m, float s);
 void letterbox_image_into(image im, int w, int h, image boxed);
 void set_batch_network(network *net, int b);
+detection *make_network_boxes_batch(network *net, float thresh, int *num,
+                                    int batch);
+void fill_network_boxes_batch(network *net, int w, int h, float thresh,
+                              float hier, int *map, int relative,
+                              detection *dets, int letter, int batch);
 }
 
 namespace VPP {
@@ -33,8 +45,11 @@ namespace Detector {
 
 Darknet::Darknet() noexcept 
     : VPP::DNN::Engine::ForScene(), hierarchy(0.4), nms(0.4),
-      architecture(""), weights(""), net(nullptr), input_w(-1), input_h(-1), 
-      input_f(), input_p(), img_input({ }), img_yolo({ }) {
+      classwise(false), soft(0.0f), latency(0), fused(true), batch(1),
+      window(5.0), pending(), detected(nullptr), detections(0), service(),
+      batched(1), architecture(""), weights(""), net(nullptr), input_w(-1),
+      input_h(-1), input_f(), input_p(), resized(), img_input({ }),
+      img_yolo({ }), suppression(), boxes(), scores(), classIds(), indices() {
     hierarchy.denominate("hierarchy")
              .describe("The minimal YOLO hierarchy threshold")
              .characterise(Customisation::Trait::SETTABLE);
@@ -46,51 +61,147 @@ Darknet::Darknet() noexcept
        .characterise(Customisation::Trait::SETTABLE);
     nms.range(-1.0f, 1.0f);
     Customisation::Entity::expose(nms);
+
+    classwise.denominate("classwise")
+             .describe("Are the boxes only suppressed by the boxes of their "
+                       "class?")
+             .characterise(Customisation::Trait::SETTABLE);
+    classwise.use(Customisation::Translator::BoolFormat::NO_YES);
+    Customisation::Entity::expose(classwise);
+
+    soft.denominate("soft")
+        .describe("The spread of the Gaussian soft NMS decaying the scores "
+                  "of the overlapping boxes (0 for a hard NMS)")
+        .characterise(Customisation::Trait::SETTABLE);
+    soft.range(0.0f, 10.0f);
+    Customisation::Entity::expose(soft);
+
+    latency.denominate("latency")
+           .describe("The number of frames the detections are deferred by, "
+                     "for overlapping the inference with the post-processing "
+                     "(0 for a synchronous detection)")
+           .characterise(Customisation::Trait::SETTABLE);
+    latency.range(0, 1);
+    Customisation::Entity::expose(latency);
+
+    fused.denominate("fused")
+         .describe("Letterbox the 8-bit frames straight into the network "
+                   "input in a single pass")
+         .characterise(Customisation::Trait::SETTABLE);
+    fused.use(Customisation::Translator::BoolFormat::NO_YES);
+    Customisation::Entity::expose(fused);
+
+    batch.denominate("batch")
+         .describe("The batch size of the inference service shared by all "
+                   "the detectors running the same network (1 for no "
+                   "batching)")
+         .characterise(Customisation::Trait::CONFIGURABLE);
+    batch.range(1, 64);
+    Customisation::Entity::expose(batch);
+
+    window.denominate("window")
+          .describe("The maximal time in ms to wait for other detectors to "
+                    "fill in an inference batch")
+          .characterise(Customisation::Trait::SETTABLE);
+    window.range(0.0f, 1000.0f);
+    Customisation::Entity::expose(window);
 }
 
 Darknet::~Darknet() noexcept = default;
 
 Customisation::Error Darknet::setup() noexcept {
+    return load([this]() noexcept { return instantiate(); });
+}
+
+Customisation::Error Darknet::instantiate() noexcept {
+    cool();
+    settle();
     srand(2222222);
+    bool loaded = false;
+
+    std::string net_architecture = network.architecture;
+    std::string net_weights      = network.weights;
+    int         net_batch        = batch;
 
-    if ( (architecture != static_cast<std::string>(network.architecture)) || 
-         (weights != static_cast<std::string>(network.weights)) ) {
+    if ( (architecture != net_architecture) || (weights != net_weights) ||
+         (batched != net_batch) ) {
         terminate();
 
-        net = load_network_custom(const_cast<char *>(static_cast<std::string>(
-                                  network.architecture).c_str()),
-                                  const_cast<char *>(static_cast<std::string>(
-                                  network.weights).c_str()), 1, 1);
+        service = Service::share(net_architecture, net_weights, net_batch);
+        if (service != nullptr) {
+            net = service->net;
+        }
 
         if (net == nullptr) {
             LOGE("%s[%s]::setup(): Cannot load Darknet DNN with config '%s' "
                  "and weights '%s'",
                  value_to_string().c_str(), name().c_str(),
-                 static_cast<std::string>(network.architecture).c_str(),
-                 static_cast<std::string>(network.weights).c_str());
+                 net_architecture.c_str(), net_weights.c_str());
             return Customisation::Error::INVALID_VALUE;
         }
 
-        fuse_conv_batchnorm(*net);
-        calculate_binary_weights(*net);
-
-        architecture = network.architecture;
-        weights      = network.weights;
-
-        // Do this preventively rather than in the first inference
-        set_batch_network(net, 1);
-        img_yolo = make_image(net->w, net->h, 3);
+        architecture = std::move(net_architecture);
+        weights      = std::move(net_weights);
+        batched      = net_batch;
+        img_yolo     = make_image(net->w, net->h, 3);
+        loaded       = true;
     }
 
     /* Always restart from a default image */    
     fill_image(img_yolo, .5);
 
+    /* Warm the newly loaded network up with the default image, in a full
+     * batch of the shared service */
+    if (loaded) {
+        warm([this]() noexcept {
+            int nboxes = 0;
+            auto dets  = infer(cv::Size(net->w, net->h), snapshot(), nboxes);
+            if (dets != nullptr) {
+                free_detections(dets, nboxes);
+            }
+        });
+    }
+
     return Customisation::Error::NONE;
 }
 
-Error::Type Darknet::process(Scene &scene) noexcept {
-    int            nboxes = 0;
-    const cv::Mat &input = scene.view.bgr().input();
+bool Darknet::settle() noexcept {
+    if (!pending.valid()) {
+        return false;
+    }
+
+    // Help the pool until the inference is done, as it may be waiting for
+    // this very thread to be available
+    while ( (pending.wait_for(std::chrono::seconds(0)) !=
+             std::future_status::ready) &&
+            (Util::Task::Pool::instance().help()) ) {}
+    pending.get();
+    return true;
+}
+
+void Darknet::prepare(const cv::Mat &input) noexcept {
+    if ( (fused) && (input.type() == CV_8UC3) ) {
+        // Same letterbox geometry as letterbox_image_into()
+        int w = net->w;
+        int h = net->h;
+        int new_w, new_h;
+        if ((static_cast<float>(w) / input.cols) < 
+            (static_cast<float>(h) / input.rows)) {
+            new_w = w;
+            new_h = (input.rows * w) / input.cols;
+        } else {
+            new_h = h;
+            new_w = (input.cols * h) / input.rows;
+        }
+
+        // Resize the 8-bit frame and spread it in the network R, G, B planes
+        cv::resize(input, resized, cv::Size(new_w, new_h), 0, 0,
+                   cv::INTER_LINEAR);
+        Util::OCV::planarise(resized, img_yolo.data, w, h,
+                             cv::Point((w - new_w) / 2, (h - new_h) / 2),
+                             1.0f/255.0f);
+        return;
+    }
 
     /* Prepare the input buffer if not ready or inappropriate */
     if ((input_w != input.cols) || (input_h != input.rows)) {
@@ -109,30 +220,106 @@ Error::Type Darknet::process(Scene &scene) noexcept {
     // Extract R, G and B planes and swap R and B
     cv::split(input_f, input_p);
     letterbox_image_into(img_input, net->w, net->h, img_yolo);
+}
 
-    // Infer!
-    network_predict_ptr(net, img_yolo.data);
-    
-    // Get the boxes
-    detection *dets = get_network_boxes(net, input_w, input_h,
-                                        static_cast<float>(threshold),
-                                        static_cast<float>(hierarchy),
-                                        0, 1, &nboxes, 1);
+Darknet::Settings Darknet::snapshot() const noexcept {
+    auto span = std::chrono::duration<float, std::milli>(
+                    static_cast<float>(window));
+    return { static_cast<float>(threshold), static_cast<float>(hierarchy),
+             static_cast<float>(nms), static_cast<bool>(classwise),
+             static_cast<float>(soft),
+             std::chrono::duration_cast<Service::Clock::duration>(span) };
+}
+
+detection *Darknet::infer(const cv::Size &frame, const Settings &settings,
+                          int &nboxes) noexcept {
+    return service->infer(img_yolo.data, frame, settings.threshold,
+                          settings.hierarchy, settings.window, nboxes);
+}
+
+Error::Type Darknet::process(Scene &scene) noexcept {
+    int            nboxes   = 0;
+    const cv::Mat &input    = scene.view.bgr().input();
+    const auto     settings = snapshot();
+
+    if (latency == 0) {
+        settle();
+        prepare(input);
+        capture(scene, infer(input.size(), settings, nboxes), nboxes,
+                settings);
+
+        return Error::NONE;
+    }
+
+    // Collect the detections of the previous frame (if any)
+    detection *dets = nullptr;
+    if (settle()) {
+        dets       = detected;
+        nboxes     = detections;
+        detected   = nullptr;
+        detections = 0;
+    }
+
+    // Infer the current frame in the background, with its own snapshot
+    prepare(input);
+    auto frame = input.size();
+    auto &pool = Util::Task::Pool::instance();
+    pending    = pool.submit([this, frame, settings]() noexcept {
+                                 detected = infer(frame, settings,
+                                                  detections);
+                                 return 0;
+                             });
 
-    // Filter out the boxes
-    if (static_cast<float>(nms) >= 0) {
-        do_nms_obj(dets, nboxes, dataset.size(), static_cast<float>(nms));
+    if (dets != nullptr) {
+        capture(scene, dets, nboxes, settings);
     }
 
-    // Capture them on the scene
+    return Error::NONE;
+}
+
+void Darknet::capture(Scene &scene, detection *dets, int nboxes,
+                      const Settings &settings) noexcept {
+    const auto classes = static_cast<int>(dataset.size());
+
+    // Filter out the boxes by their objectness, as classified by their best
+    // class for a class-aware NMS
+    boxes.clear();
+    scores.clear();
+    classIds.clear();
+    indices.clear();
     for (int i = 0; i < nboxes; ++i) {
-        std::list<Prediction> predictions;
+        const box &b = dets[i].bbox;
+        float best   = 0.0f;
+        boxes.emplace_back(cvRound(b.x - b.w/2), cvRound(b.y - b.h/2),
+                           cvRound(b.w), cvRound(b.h));
+        scores.push_back(dets[i].objectness);
+        classIds.push_back((classes > 0) ?
+                           Util::OCV::argmax(dets[i].prob, classes, best) : 0);
+    }
+
+    if (settings.nms >= 0) {
+        suppression.threshold = settings.nms;
+        suppression.minimal   = 0.0f;
+        suppression.classwise = settings.classwise;
+        suppression.sigma     = settings.soft;
+        suppression.apply(boxes, scores, classIds, indices);
+    } else {
+        for (int i = 0; i < nboxes; ++i) {
+            indices.push_back(i);
+        }
+    }
 
-        for (int j = 0; j < (int) dataset.size(); j++) {
-            auto cur_thres = dets[i].prob[j];
-            if (cur_thres >= static_cast<float>(threshold)) {
-                predictions.emplace_back(Prediction(cur_thres, dataset.ID(),
-                                         j));
+    // Capture them on the scene, with their class probabilities decayed as
+    // their objectness by a soft NMS
+    for (auto i : indices) {
+        Predictions predictions;
+
+        auto objectness = dets[i].objectness;
+        auto decay      = (objectness > 0) ? scores[i] / objectness : 1.0f;
+        for (int j = 0; j < classes; j++) {
+            auto cur_thres = dets[i].prob[j] * decay;
+            if (cur_thres >= settings.threshold) {
+                predictions.insert(Prediction(cur_thres, dataset.ID(), j));
             }
         }
         
@@ -142,23 +329,31 @@ Error::Type Darknet::process(Scene &scene) noexcept {
         box b = dets[i].bbox;
         auto &zone = scene.mark(cv::Rect_<float>(b.x-b.w/2.l, b.y-b.h/2.l,
                                 b.w, b.h)).predict(predictions);
-        zone.description = label(zone);
+        tag(zone);
     }
     
     free_detections(dets, nboxes);
-
-    return Error::NONE;
 }
 
 void Darknet::terminate() noexcept {
+    cool();
+    settle();
+    if (detected != nullptr) {
+        free_detections(detected, detections);
+        detected   = nullptr;
+        detections = 0;
+    }
+
     if (net != nullptr) {
         architecture.clear();
         weights.clear();
 
-        free_network(*net);
+        /* The shared network is released with its last user */
+        service.reset();
         net = nullptr;
 
         input_f = cv::Mat();
+        resized = cv::Mat();
         for (auto &p : input_p) {
             p = cv::Mat();
         }
@@ -175,6 +370,116 @@ void Darknet::terminate() noexcept {
     }
 }
 
+std::shared_ptr<Darknet::Service> 
+    Darknet::Service::share(const std::string &architecture,
+                            const std::string &weights, int batch) noexcept {
+    using Key = std::tuple<std::string, std::string, int>;
+    static std::mutex                            registry;
+    static std::map<Key, std::weak_ptr<Service>> services;
+
+    std::lock_guard<std::mutex> lock(registry);
+    auto &shared = services[Key(architecture, weights, batch)];
+    auto  found  = shared.lock();
+    if (found != nullptr) {
+        return found;
+    }
+
+    auto n = load_network_custom(const_cast<char *>(architecture.c_str()),
+                                 const_cast<char *>(weights.c_str()), 1, batch);
+    if (n == nullptr) {
+        return nullptr;
+    }
+
+    fuse_conv_batchnorm(*n);
+    calculate_binary_weights(*n);
+    set_batch_network(n, batch);
+
+    found  = std::make_shared<Service>(n, batch);
+    shared = found;
+
+    return found;
+}
+
+Darknet::Service::Service(::network *n, int b) noexcept
+    : net(n), batch(b), 
+      buffer(static_cast<std::size_t>(b) * n->w * n->h * 3, 0.5f), access(),
+      ready(), served(), requests(), exiting(false),
+      worker(&Service::run, this) {}
+
+Darknet::Service::~Service() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(access);
+        exiting = true;
+    }
+    ready.notify_all();
+    worker.join();
+
+    free_network(*net);
+}
+
+detection *Darknet::Service::infer(const float *input, const cv::Size &frame,
+                                   float threshold, float hierarchy,
+                                   Clock::duration window,
+                                   int &nboxes) noexcept {
+    Request r = { input, frame, threshold, hierarchy, Clock::now() + window,
+                  nullptr, 0, false };
+
+    std::unique_lock<std::mutex> lock(access);
+    requests.push_back(&r);
+    ready.notify_one();
+    served.wait(lock, [&r]() { return r.done; });
+
+    nboxes = r.nboxes;
+    return r.dets;
+}
+
+void Darknet::Service::run() noexcept {
+    auto plane = static_cast<std::size_t>(net->w) * net->h * 3;
+    std::vector<Request *> taken;
+
+    std::unique_lock<std::mutex> lock(access);
+    while (true) {
+        ready.wait(lock, [this]() { return exiting || (!requests.empty()); });
+
+        /* Wait for a full batch, but not beyond the oldest request deadline */
+        auto deadline = requests.empty() ? Clock::now() : 
+                                           requests.front()->deadline;
+        ready.wait_until(lock, deadline, [this]() {
+                         return exiting || 
+                                (static_cast<int>(requests.size()) >= batch);
+                         });
+        if (exiting) {
+            break;
+        }
+
+        auto n = std::min(static_cast<int>(requests.size()), batch);
+        taken.assign(requests.begin(), requests.begin() + n);
+        requests.erase(requests.begin(), requests.begin() + n);
+        lock.unlock();
+
+        /* Infer all the inputs at once and get the boxes of each frame */
+        for (int i = 0; i < n; ++i) {
+            std::copy(taken[i]->input, taken[i]->input + plane,
+                      buffer.begin() + i * plane);
+        }
+        network_predict_ptr(net, buffer.data());
+        for (int i = 0; i < n; ++i) {
+            auto r  = taken[i];
+            r->dets = make_network_boxes_batch(net, r->threshold, &r->nboxes,
+                                               i);
+            fill_network_boxes_batch(net, r->frame.width, r->frame.height,
+                                     r->threshold, r->hierarchy, nullptr, 1,
+                                     r->dets, 1, i);
+        }
+
+        lock.lock();
+        for (auto r : taken) {
+            r->done = true;
+        }
+        served.notify_all();
+    }
+}
+
 }  // namespace Detector
 }  // namespace Engine
 }  // namespace VPP
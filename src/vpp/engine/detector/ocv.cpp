@@ -14,31 +14,77 @@
  *
  **/
 
+#include <algorithm>
+#include <chrono>
 #include <opencv2/opencv.hpp>
 
 #include "vpp/log.hpp"
 #include "vpp/engine/detector/ocv.hpp"
+#include "vpp/util/ocv/functions.hpp"
+#include "vpp/util/task.hpp"
 
 namespace VPP {
 namespace Engine {
 namespace Detector {
 
 OCV::OCV() noexcept 
-    : VPP::DNN::Engine::OCV<>(), nms(0.4), names(), outLayers(),
-      outLayerType(""), needsResizing(false), imInfo() {
+    : VPP::DNN::Engine::OCV<>(), nms(0.4), classwise(false), soft(0.0f),
+      latency(0), tiled(false), 
+      overlap(0.2f), pending(), outputs(),
+      inferred(), names(), outLayers(),
+      outLayerType(""), needsResizing(false), imInfo(), factor(1.0f),
+      settings() {
     nms.denominate("nms")
        .describe("The minimal threshold to perform NMS (-1 to disable)")
        .characterise(Customisation::Trait::SETTABLE);
     nms.range(-1.0f, 1.0f);
     Customisation::Entity::expose(nms);
+
+    classwise.denominate("classwise")
+             .describe("Are the boxes only suppressed by the boxes of their "
+                       "class?")
+             .characterise(Customisation::Trait::SETTABLE);
+    classwise.use(Customisation::Translator::BoolFormat::NO_YES);
+    Customisation::Entity::expose(classwise);
+
+    soft.denominate("soft")
+        .describe("The spread of the Gaussian soft NMS decaying the scores "
+                  "of the overlapping boxes (0 for a hard NMS)")
+        .characterise(Customisation::Trait::SETTABLE);
+    soft.range(0.0f, 10.0f);
+    Customisation::Entity::expose(soft);
+
+    latency.denominate("latency")
+           .describe("The number of frames the detections are deferred by, "
+                     "for overlapping the inference with the post-processing "
+                     "(0 for a synchronous detection)")
+           .characterise(Customisation::Trait::SETTABLE);
+    latency.range(0, 1);
+    Customisation::Entity::expose(latency);
+
+    tiled.denominate("tiled")
+         .describe("Are the frames larger than the network input split into "
+                   "overlapping tiles inferred in a single batch ?")
+         .characterise(Customisation::Trait::SETTABLE);
+    tiled.use(Customisation::Translator::BoolFormat::NO_YES);
+    Customisation::Entity::expose(tiled);
+
+    overlap.denominate("overlap")
+           .describe("The minimal overlap ratio between two adjacent tiles")
+           .characterise(Customisation::Trait::SETTABLE);
+    overlap.range(0.0f, 0.9f);
+    Customisation::Entity::expose(overlap);
 }
 
 OCV::~OCV() noexcept = default;
 
-Customisation::Error OCV::setup() noexcept {
-    auto error = VPP::DNN::Engine::OCV<>::setup();
+Customisation::Error OCV::instantiate() noexcept {
+    settle();
+    auto error = VPP::DNN::Engine::OCV<>::instantiate();
 
     if (error == Customisation::Error::NONE) {
+        auto lock = reserve();
+
         // If the network misses im_info (Faster-RCNN & R-FCN), then recreate it
         needsResizing=(net.getLayer(0)->outputNameToIndex("im_info") != -1);
         if (needsResizing) {
@@ -59,27 +105,179 @@ Customisation::Error OCV::setup() noexcept {
     return error;
 }
 
+/* Network outputs may use the network buffers which are overwritten by the
+ * next inference of any engine sharing it */
+static void detach(std::vector<cv::Mat> &outputs) noexcept {
+    for (auto &o : outputs) {
+        o = o.clone();
+    }
+}
+
+/* Get the origins of tiles of the given length evenly covering a length, each
+ * tile overlapping the next one by at least the overlap ratio */
+static std::vector<int> origins(int length, int tile, float overlap) noexcept {
+    if (length <= tile) {
+        return std::vector<int>(1, 0);
+    }
+
+    auto stride = std::max(1, static_cast<int>(tile * (1.0f - overlap)));
+    auto count  = (length - tile + stride - 1) / stride + 1;
+    std::vector<int> o(count);
+    for (int i = 0; i < count; ++i) {
+        o[i] = (i * (length - tile)) / (count - 1);
+    }
+
+    return o;
+}
+
+static std::vector<cv::Rect> tiling(const cv::Size &frame, 
+                                    const cv::Size &tile,
+                                    float overlap) noexcept {
+    std::vector<cv::Rect> tiles;
+    auto xs = origins(frame.width, tile.width, overlap);
+    auto ys = origins(frame.height, tile.height, overlap);
+    auto w  = std::min(frame.width, tile.width);
+    auto h  = std::min(frame.height, tile.height);
+
+    tiles.reserve(xs.size() * ys.size());
+    for (auto y : ys) {
+        for (auto x : xs) {
+            tiles.emplace_back(x, y, w, h);
+        }
+    }
+
+    return tiles;
+}
+
+OCV::Settings OCV::snapshot() const noexcept {
+    return { static_cast<float>(threshold), static_cast<float>(nms),
+             static_cast<bool>(classwise), static_cast<float>(soft) };
+}
+
+void OCV::rescale(float f) noexcept {
+    factor.store(f, std::memory_order_relaxed);
+}
+
+cv::Size OCV::resolution() const noexcept {
+    // Networks with an im_info input are always fed at their own size
+    auto sz = static_cast<cv::Size>(size);
+    auto f  = factor.load(std::memory_order_relaxed);
+    if ( (needsResizing) || (f == 1.0f) ) {
+        return sz;
+    }
+
+    // Fully convolutional detectors downsample their input by 32
+    auto scaled = [f](int length) {
+        return std::max(32, static_cast<int>(length * f / 32.0f + 0.5f) * 32);
+    };
+    return cv::Size(scaled(sz.width), scaled(sz.height));
+}
+
+bool OCV::settle() noexcept {
+    if (!pending.valid()) {
+        return false;
+    }
+
+    // Help the pool until the inference is done, as it may be waiting for
+    // this very thread to be available
+    while ( (pending.wait_for(std::chrono::seconds(0)) !=
+             std::future_status::ready) &&
+            (Util::Task::Pool::instance().help()) ) {}
+    pending.get();
+    return true;
+}
+
 Error::Type OCV::process(Scene &scene) noexcept {
     cv::Mat              blob;
-    std::vector<cv::Mat> outputs;
     const cv::Mat &      input = scene.view.bgr().input();
+    settings = snapshot();
+
+    // Split large frames in tiles, unless the network is to be resized
+    if ( (tiled) && (!needsResizing) ) {
+        auto tiles = tiling(input.size(), static_cast<cv::Size>(size),
+                            overlap);
+        if (tiles.size() > 1) {
+            unmasked(scene, input.size(), tiles);
+            if (tiles.empty()) {
+                return Error::NONE;
+            }
 
-    // Create the 4D blob corresponding to the input image without cropping it 
-    cv::dnn::blobFromImage(input, blob, scale, static_cast<cv::Size>(size), 
-                           offset, static_cast<bool>(RGB), false);
+            settle();
+            return tile(scene, input, tiles);
+        }
+    }
 
-    // Place the image-based blob at the input of the network
-    net.setInput(blob);
+    // Create the 4D blob corresponding to the input image without cropping it,
+    // starting from the smallest shared downscaled image that is large enough,
+    // or share it with the networks of the view having the same pre-processing
+    const auto sz = resolution();
+    blob = scene.view.blob(Image::Mode::BGR, sz, scale, offset,
+                           static_cast<bool>(RGB));
 
     // Resize the input if it needs to be resized
     if (needsResizing) {
         cv::resize(input, input, static_cast<cv::Size>(size));
-        net.setInput(imInfo, "im_info");
     }
 
-    // Run the network
-    net.forward(outputs, names);
+    if (latency == 0) {
+        settle();
+
+        // Infer the blob on the server (if any) unless it needs its im_info
+        if ( (needsResizing) || (!offload(blob, outputs, false)) ) {
+            // Place the image-based blob at the input of the shared network
+            auto lock = reserve();
+            net.setInput(blob);
+            if (needsResizing) {
+                net.setInput(imInfo, "im_info");
+            }
+
+            // Run the network and keep its outputs away from the others
+            Util::Timing timing(inference);
+            net.forward(outputs, names);
+            detach(outputs);
+        }
+
+        return extract(scene, outputs, input.size());
+    }
+
+    // Collect the detections of the previous frame (if any) and infer the
+    // current frame in the background while post-processing them
+    std::vector<cv::Mat> results;
+    cv::Size             frame = inferred;
+    bool                 ready = settle();
+    if (ready) {
+        results = std::move(outputs);
+    }
+
+    inferred = input.size();
+    auto &pool = Util::Task::Pool::instance();
+    pending    = pool.submit([this, blob]() noexcept {
+                                 if ( (!needsResizing) &&
+                                      (offload(blob, outputs, false)) ) {
+                                     return 0;
+                                 }
+                                 auto lock = reserve();
+                                 net.setInput(blob);
+                                 if (needsResizing) {
+                                     net.setInput(imInfo, "im_info");
+                                 }
+                                 {
+                                     Util::Timing timing(inference);
+                                     net.forward(outputs, names);
+                                 }
+                                 detach(outputs);
+                                 return 0;
+                             });
+    
+    if (!ready) {
+        return Error::NONE;
+    }
+
+    return extract(scene, results, frame);
+}
 
+Error::Type OCV::extract(Scene &scene, std::vector<cv::Mat> &outputs,
+                         const cv::Size &frame) noexcept {
     // Extract and display the information
     if ( (needsResizing) || (outLayerType == "DetectionOutput") ) {
         ASSERT(outputs.size() == 1, "%s[%s]::process(): "
@@ -89,81 +287,225 @@ Error::Type OCV::process(Scene &scene) noexcept {
         for (size_t i = 0; i < outputs[0].total(); i += 7)
         {
             float confidence = data[i + 2];
-            if (confidence > threshold)
+            if (confidence > settings.threshold)
             {
                 int classId = (int)(data[i + 1]) - 1; 
                 auto &zone = scene.mark(cv::Rect_<float>(data[i+3], data[i+4],
                                                          data[i+5], data[i+6]));
                 zone.predict(std::move(Prediction(confidence, dataset.ID(),
                                                   classId)));
-                zone.description = label(zone);
+                tag(zone);
             }
         }
     } else if (outLayerType == "Region") {
-        std::vector<int> classIds;
-        std::vector<float> confidences;
-        std::vector<cv::Rect> boxes;
-        for (size_t i = 0; i < outputs.size(); ++i)
-        {
-            float* data = (float*)outputs[i].data;
-            for (int j = 0; j < outputs[i].rows; ++j, data += outputs[i].cols)
-            {
-                cv::Mat scores = outputs[i].row(j).colRange(5, outputs[i].cols);
-                cv::Point classIdPoint;
-                double confidence;
-                cv::minMaxLoc(scores, 0, &confidence, 0, &classIdPoint);
-                if (confidence > threshold)
-                {
-                    int centerX = (int)(data[0] * input.cols);
-                    int centerY = (int)(data[1] * input.rows);
-                    int width = (int)(data[2] * input.cols);
-                    int height = (int)(data[3] * input.rows);
-                    int left = centerX - width / 2;
-                    int top = centerY - height / 2;
-
-                    classIds.push_back(classIdPoint.x);
-                    confidences.push_back((float)confidence);
-                    boxes.push_back(cv::Rect(left, top, width, height));
-                }
-            }
+        candidates.clear();
+        cv::Rect area(cv::Point(0, 0), frame);
+        for (auto &o : outputs) {
+            decode(o, 0, o.rows, area);
+        }
+        attach(scene, false);
+    } else {
+        LOGE("%s[%s]::process(): Unknown output layer type '%s'",
+             value_to_string().c_str(), name().c_str(), outLayerType.c_str());
+        return Error::NOT_EXISTING;
+    }   
+
+    return Error::NONE;
+}
+
+Error::Type OCV::process(Scene &scene,
+                         const std::vector<cv::Rect> &rois) noexcept {
+    // Networks to be resized cannot be batched, so process the full frame
+    if (needsResizing) {
+        return process(scene);
+    }
+
+    const cv::Mat & input = scene.view.bgr().input();
+    const cv::Rect  frame(0, 0, input.cols, input.rows);
+    const auto      sz    = static_cast<cv::Size>(size);
+    settings = snapshot();
+
+    // Pad the regions to the network aspect ratio not to distort them
+    std::vector<cv::Rect> crops;
+    crops.reserve(rois.size());
+    for (auto r : rois) {
+        if (r.width * sz.height < r.height * sz.width) {
+            auto w   = (r.height * sz.width) / sz.height;
+            r.x     -= (w - r.width) / 2;
+            r.width  = w;
+        } else {
+            auto h   = (r.width * sz.height) / sz.width;
+            r.y     -= (h - r.height) / 2;
+            r.height = h;
+        }
+        r &= frame;
+        if (r.area() > 0) {
+            crops.emplace_back(std::move(r));
         }
+    }
 
-        if (static_cast<float>(nms) >= 0) {
-            std::vector<int> indices;
-            cv::dnn::NMSBoxes(boxes, confidences, threshold, nms, indices);
-            for (size_t i = 0; i < indices.size(); ++i) {
-                int idx = indices[i];
-                cv::Rect box = boxes[idx];
-                
-                auto &zone = 
-                    scene.mark(box)
-                         .predict(std::move(Prediction(confidences[idx], 
-                                                       dataset.ID(), 
-                                                       classIds[idx])));
-                zone.description = label(zone);
+    unmasked(scene, input.size(), crops);
+    if (crops.empty()) {
+        return Error::NONE;
+    }
+
+    settle();
+    return tile(scene, input, crops);
+}
+
+Error::Type OCV::tile(Scene &scene, const cv::Mat &input,
+                      const std::vector<cv::Rect> &tiles) noexcept {
+    std::vector<cv::Mat> crops;
+    crops.reserve(tiles.size());
+    for (auto &t : tiles) {
+        crops.emplace_back(input(t));
+    }
+
+    // Batch all the tiles in a single 4D blob and infer them at once
+    cv::Mat              blob;
+    std::vector<cv::Mat> results;
+    cv::dnn::blobFromImages(crops, blob, scale, static_cast<cv::Size>(size),
+                            offset, static_cast<bool>(RGB), false);
+    if (!offload(blob, results, false)) {
+        auto lock = reserve();
+        net.setInput(blob);
+        Util::Timing timing(inference);
+        net.forward(results, names);
+        detach(results);
+    }
+
+    // Collect the detections of all tiles in the frame coordinates
+    auto count   = static_cast<int>(tiles.size());
+    auto minimal = settings.threshold;
+    candidates.clear();
+    if (outLayerType == "DetectionOutput") {
+        for (auto &o : results) {
+            float* data = (float*) o.data;
+            for (size_t i = 0; i < o.total(); i += 7) {
+                int   n          = static_cast<int>(data[i]);
+                float confidence = data[i + 2];
+                if ( (confidence <= minimal) || (n < 0) || (n >= count) ) {
+                    continue;
+                }
+                const auto &t = tiles[n];
+                BBox box(data[i + 3], data[i + 4], data[i + 5], data[i + 6],
+                         t.width, t.height);
+                candidates.classIds.push_back(static_cast<int>(data[i + 1]) 
+                                              - 1);
+                candidates.confidences.push_back(confidence);
+                candidates.boxes.push_back(box + t.tl());
             }
-        } else {
-            for (size_t idx = 0; idx < boxes.size(); ++idx) {
-                cv::Rect box = boxes[idx];
-                
-                auto &zone = 
-                    scene.mark(box)
-                         .predict(std::move(Prediction(confidences[idx], 
-                                                       dataset.ID(), 
-                                                       classIds[idx])));
-                zone.description = label(zone);
+        }
+    } else if (outLayerType == "Region") {
+        for (auto &o : results) {
+            // Region outputs stack the rows of all the batched tiles
+            auto rows = std::max(1, o.rows / count);
+            for (int n = 0; n < count; ++n) {
+                auto last = (n == count - 1) ? o.rows : (n + 1) * rows;
+                decode(o, std::min(n * rows, o.rows), last, tiles[n]);
             }
         }
     } else {
-        LOGE("%s[%s]::process(): Unknown output layer type '%s'",
+        LOGE("%s[%s]::tile(): Unknown output layer type '%s'",
              value_to_string().c_str(), name().c_str(), outLayerType.c_str());
         return Error::NOT_EXISTING;
-    }   
+    }
+
+    // Suppress the duplicates found in the overlapping parts of the tiles
+    attach(scene, true);
 
     return Error::NONE;
 }
 
+void OCV::decode(const cv::Mat &output, int first, int last,
+                 const cv::Rect &area) noexcept {
+    const int   classes = output.cols - 5;
+    const float minimal = settings.threshold;
+    if (classes <= 0) {
+        return;
+    }
+
+    // Scan the raw rows: the class scores being scaled by the objectness, the
+    // rows whose objectness is below the threshold cannot be detections
+    for (int j = first; j < last; ++j) {
+        auto data = output.ptr<float>(j);
+        if (data[4] <= minimal) {
+            continue;
+        }
+
+        float confidence;
+        int   classId = Util::OCV::argmax(data + 5, classes, confidence);
+        if (confidence > minimal) {
+            int width  = static_cast<int>(data[2] * area.width);
+            int height = static_cast<int>(data[3] * area.height);
+            int left   = static_cast<int>(data[0] * area.width) - width / 2 +
+                         area.x;
+            int top    = static_cast<int>(data[1] * area.height) - 
+                         height / 2 + area.y;
+
+            candidates.classIds.push_back(classId);
+            candidates.confidences.push_back(confidence);
+            candidates.boxes.emplace_back(left, top, width, height);
+        }
+    }
+}
+
+void OCV::unmasked(const Scene &scene, const cv::Size &frame,
+                   std::vector<cv::Rect> &regions) noexcept {
+    if (scene.view.mask == nullptr) {
+        return;
+    }
+
+    auto const &masking = scene.view.mask->raster(frame);
+    regions.erase(std::remove_if(regions.begin(), regions.end(),
+                                 [&masking](const cv::Rect &r) noexcept {
+                                     return masking.excluded(r); }),
+                  regions.end());
+}
+
+void OCV::attach(Scene &scene, bool merging) noexcept {
+    // Discard the candidates mostly in the masked areas before the NMS
+    if (scene.view.mask != nullptr) {
+        auto const &masking =
+            scene.view.mask->raster(scene.view.bgr().input().size());
+        for (size_t i = 0; i < candidates.boxes.size(); ++i) {
+            if (masking.excluded(candidates.boxes[i])) {
+                candidates.confidences[i] = 0.0f;
+            }
+        }
+    }
+
+    indices.clear();
+    if (settings.nms >= 0) {
+        suppression.threshold = settings.nms;
+        suppression.minimal   = settings.threshold;
+        suppression.classwise = settings.classwise;
+        suppression.sigma     = settings.soft;
+        suppression.merging   = merging;
+        suppression.apply(candidates.boxes, candidates.confidences,
+                          candidates.classIds, indices);
+    } else {
+        indices.reserve(candidates.boxes.size());
+        for (size_t i = 0; i < candidates.boxes.size(); ++i) {
+            if (candidates.confidences[i] > 0.0f) {
+                indices.push_back(static_cast<int>(i));
+            }
+        }
+    }
+
+    for (auto idx : indices) {
+        auto &zone = 
+            scene.mark(candidates.boxes[idx])
+                 .predict(std::move(Prediction(candidates.confidences[idx],
+                                               dataset.ID(), 
+                                               candidates.classIds[idx])));
+        tag(zone);
+    }
+}
+
 void OCV::terminate() noexcept {
+    settle();
+    outputs.clear();
     VPP::DNN::Engine::OCV<>::terminate();
     names.clear();
     outLayers.clear();
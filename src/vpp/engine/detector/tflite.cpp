@@ -0,0 +1,96 @@
+/**
+ *
+ * @file      vpp/engine/detector/tflite.cpp
+ *
+ * @brief     This is the VPP TFLite DNN detector implementation file
+ *
+ * @details   This is an engine for running any TensorFlow Lite (TFLite) SSD
+ *            detector
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+
+#include "vpp/log.hpp"
+#include "vpp/engine/detector/tflite.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Detector {
+
+TFLite::TFLite() noexcept = default;
+TFLite::~TFLite() noexcept = default;
+
+Error::Type TFLite::process(Scene &scene) noexcept {
+    cv::Mat boxes, classes, scores, count;
+
+    /* The input is filled right from the view, and the outputs are read
+     * before any other engine uses the shared interpreter */
+    {
+        auto lock = reserve();
+        fill(scene.view);
+        if (!invoke()) {
+            LOGE("%s[%s]::process(): Cannot infer the TFLite model!",
+                 value_to_string().c_str(), name().c_str());
+            return Error::INVALID_VALUE;
+        }
+
+        if (outputs() < 4) {
+            LOGE("%s[%s]::process(): Expecting the boxes, classes, scores "
+                 "and count outputs of a TFLite SSD detector!",
+                 value_to_string().c_str(), name().c_str());
+            return Error::INVALID_VALUE;
+        }
+        boxes   = output(0);
+        classes = output(1);
+        scores  = output(2);
+        count   = output(3);
+    }
+
+    if (count.empty()) {
+        return Error::NONE;
+    }
+    int n = std::min({ static_cast<int>(count.at<float>(0)), scores.cols,
+                       classes.cols, boxes.cols / 4 });
+
+    /* The boxes are normalised as (ymin, xmin, ymax, xmax), and already
+     * suppressed by the post-processing of the network */
+    const float t = threshold;
+    for (int i = 0; i < n; ++i) {
+        auto score = scores.at<float>(i);
+        if (score < t) {
+            continue;
+        }
+
+        const float *b  = boxes.ptr<float>() + 4 * i;
+        const float  y0 = std::max(0.0f, b[0]);
+        const float  x0 = std::max(0.0f, b[1]);
+        const float  y1 = std::min(1.0f, b[2]);
+        const float  x1 = std::min(1.0f, b[3]);
+        if ( (x1 <= x0) || (y1 <= y0) ) {
+            continue;
+        }
+
+        Predictions predictions;
+        predictions.insert(Prediction(score, dataset.ID(),
+                                      static_cast<int16_t>(
+                                          classes.at<float>(i))));
+        auto &zone = scene.mark(cv::Rect_<float>(x0, y0, x1 - x0, y1 - y0))
+                          .predict(predictions);
+        tag(zone);
+    }
+
+    return Error::NONE;
+}
+
+}  // namespace Detector
+}  // namespace Engine
+}  // namespace VPP
@@ -0,0 +1,721 @@
+/**
+ *
+ * @file      vpp/engine/link.cpp
+ *
+ * @brief     These are the VPP network link engines implementation
+ *
+ * @details   These engines bridge the pipelines of different hosts over TCP,
+ *            with the scenes metadata in the VPP wire format and the crops of
+ *            their zones.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "vpp/config.hpp"
+#ifdef VPP_HAS_IMAGE_CODEC_SUPPORT
+#include <opencv2/imgcodecs.hpp>
+#endif
+#include "vpp/log.hpp"
+#include "vpp/engine/link.hpp"
+#include "vpp/util/io/socket.hpp"
+
+namespace VPP {
+namespace Engine {
+
+/* How long the threads wait for an event before checking their status */
+static const int POLLING_MS = 200;
+
+/* How long the uplink waits before connecting again to a failed downlink */
+static const int BACKOFF_MS = 1000;
+
+/* How long a started message may take to be fully received */
+static const int RECEIVING_MS = 2000;
+
+/* The largest message accepted, as a corrupted header shall never allocate
+ * much memory */
+static const uint32_t LARGEST = 64u << 20;
+
+/* The salt of the UUIDs of a link takes their upper 16 bits */
+static const int      SALTING = 48;
+static const uint64_t SALTED  = (1ull << SALTING) - 1;
+
+static inline std::size_t padded(std::size_t size) noexcept {
+    return (size + 7) & ~static_cast<std::size_t>(7);
+}
+
+/* Appending some data to a message, padded to 8 bytes with zeroes */
+static void append(std::vector<uint8_t> &message, const void *data,
+                   std::size_t size) noexcept {
+    auto at = message.size();
+    message.resize(at + padded(size), 0);
+    std::memcpy(message.data() + at, data, size);
+}
+
+Uplink::Uplink() noexcept
+    : cropping(), sent(0), dropped(0), reconnections(0), writer(),
+      encoded(), access(), queued(), released(), messages(), spares(),
+      exiting(true), sender(), exported(0) {
+    server.denominate("server")
+          .describe("The host:port of the downlink to send the scenes to, "
+                    "if any")
+          .characterise(Customisation::Trait::CONFIGURABLE);
+    expose(server);
+
+    depth.denominate("depth")
+         .describe("The number of scenes waiting to be sent")
+         .characterise(Customisation::Trait::CONFIGURABLE);
+    depth.range(1, 256);
+    expose(depth);
+    depth = 8;
+
+    policy.denominate("policy")
+          .describe("What to do with a scene when too many are waiting: "
+                    "either drop-oldest, drop-newest or block until a scene "
+                    "is sent")
+          .characterise(Customisation::Trait::SETTABLE);
+    policy.define({ { "drop-oldest", static_cast<int>(Policy::DROP_OLDEST) },
+                    { "drop-newest", static_cast<int>(Policy::DROP_NEWEST) },
+                    { "block",       static_cast<int>(Policy::BLOCK) } });
+    expose(policy);
+    policy = static_cast<int>(Policy::DROP_OLDEST);
+
+    batch.denominate("batch")
+         .describe("The maximal number of scenes sent at once")
+         .characterise(Customisation::Trait::SETTABLE);
+    batch.range(1, 64);
+    expose(batch);
+    batch = 4;
+
+    linger.denominate("linger")
+          .describe("How long in milliseconds a batch may wait to be filled, "
+                    "or 0 for sending the waiting scenes at once")
+          .characterise(Customisation::Trait::SETTABLE);
+    linger.range(0, 1000);
+    expose(linger);
+    linger = 0;
+
+    quality.denominate("quality")
+           .describe("The JPEG quality of the zone crops, or 0 for sending "
+                     "their raw pixels")
+           .characterise(Customisation::Trait::SETTABLE);
+    quality.range(0, 100);
+    expose(quality);
+    quality = 90;
+
+    timeout.denominate("timeout")
+           .describe("How long in milliseconds connecting or sending may "
+                     "take before the link is deemed failed")
+           .characterise(Customisation::Trait::SETTABLE);
+    timeout.range(10, 60000);
+    expose(timeout);
+    timeout = 1000;
+
+    contours.denominate("contours")
+            .describe("Whether the zone contours are sent")
+            .characterise(Customisation::Trait::SETTABLE);
+    contours.use(Customisation::Translator::BoolFormat::NO_YES);
+    expose(contours);
+    contours = false;
+
+    descriptions.denominate("descriptions")
+                .describe("Whether the zone descriptions are sent")
+                .characterise(Customisation::Trait::SETTABLE);
+    descriptions.use(Customisation::Translator::BoolFormat::NO_YES);
+    expose(descriptions);
+    descriptions = true;
+
+    exported = Util::Metrics::Registry::instance().attach(
+        [this](Util::Metrics::Exposition &e) {
+            auto labels = "engine=" +
+                          Util::Metrics::Exposition::quote(name());
+            e.counter("vpp_uplink_sent_total", "Scenes sent by the uplinks",
+                      labels, sent.load(std::memory_order_relaxed));
+            e.counter("vpp_uplink_dropped_total",
+                      "Scenes dropped by the uplinks", labels,
+                      dropped.load(std::memory_order_relaxed));
+            e.counter("vpp_uplink_reconnections_total",
+                      "Reconnections of the uplinks", labels,
+                      reconnections.load(std::memory_order_relaxed)); });
+}
+
+Uplink::~Uplink() noexcept {
+    stop();
+    Util::Metrics::Registry::instance().detach(exported);
+}
+
+Customisation::Error Uplink::setup() noexcept {
+    stop();
+
+    const std::string &target = server;
+    if (target.empty()) {
+        return Customisation::Error::NONE;
+    }
+
+    if (target.rfind(':') == std::string::npos) {
+        LOGE("%s[%s]::setup(): Invalid server '%s', expecting host:port!",
+             value_to_string().c_str(), name().c_str(), target.c_str());
+        return Customisation::Error::INVALID_VALUE;
+    }
+
+    exiting = false;
+    sender  = std::thread([this]() { run(); });
+
+    return Customisation::Error::NONE;
+}
+
+void Uplink::encode(Scene &scene, std::vector<uint8_t> &message) noexcept {
+    uint16_t fields = 0;
+    if (contours) {
+        fields |= Wire::Field::CONTOURS;
+    }
+    if (descriptions) {
+        fields |= Wire::Field::DESCRIPTIONS;
+    }
+
+    /* The records carry the metric states, deprojected all at once */
+    scene.deproject();
+    writer.write(scene, fields);
+
+    message.clear();
+    message.resize(sizeof(Link::Header), 0);
+    append(message, writer.data(), writer.size());
+
+    /* Only the crops of the zones are sent, never the full frame */
+    cv::Mat frame;
+    auto bgr = static_cast<const Scene &>(scene).view.cached(
+                   VPP::Image::Mode::BGR);
+    if (bgr != nullptr) {
+        frame = bgr->input();
+    }
+    const cv::Rect bounds = (frame.empty()) ? scene.view.frame() :
+                            cv::Rect(0, 0, frame.cols, frame.rows);
+
+    /* Without any image codec, the crops are always sent raw */
+#ifdef VPP_HAS_IMAGE_CODEC_SUPPORT
+    const int q     = quality;
+#endif
+    uint16_t  crops = 0;
+    for (auto const &zr : static_cast<const Scene &>(scene).zones()) {
+        auto const &z = zr.get();
+        cv::Rect at = static_cast<const cv::Rect &>(z) & bounds;
+        if ( (frame.empty()) || (at.area() == 0) || (crops == UINT16_MAX) ||
+             ( (cropping != nullptr) && (!cropping(scene, z)) ) ) {
+            continue;
+        }
+
+        Link::Crop crop;
+        crop.x      = at.x;
+        crop.y      = at.y;
+        crop.width  = at.width;
+        crop.height = at.height;
+
+        auto pixels = frame(at);
+#ifdef VPP_HAS_IMAGE_CODEC_SUPPORT
+        if (q > 0) {
+            encoded.clear();
+            if (!cv::imencode(".jpg", pixels, encoded,
+                              { cv::IMWRITE_JPEG_QUALITY, q })) {
+                continue;
+            }
+            crop.bytes    = static_cast<uint32_t>(encoded.size());
+            crop.encoding = Link::JPEG;
+            append(message, &crop, sizeof(crop));
+            append(message, encoded.data(), encoded.size());
+        } else
+#endif
+        {
+            const std::size_t row = at.width * pixels.elemSize();
+            crop.bytes    = static_cast<uint32_t>(row * at.height);
+            crop.encoding = Link::RAW;
+            append(message, &crop, sizeof(crop));
+            auto to = message.size();
+            message.resize(to + padded(crop.bytes), 0);
+            for (int y = 0; y < at.height; ++y, to += row) {
+                std::memcpy(message.data() + to, pixels.ptr(y), row);
+            }
+        }
+        ++crops;
+    }
+
+    Link::Header header;
+    header.magic   = Link::MAGIC;
+    header.version = Link::VERSION;
+    header.crops   = crops;
+    header.width   = bounds.width;
+    header.height  = bounds.height;
+    header.wire    = static_cast<uint32_t>(writer.size());
+    header.size    = static_cast<uint32_t>(message.size());
+    std::memcpy(message.data(), &header, sizeof(header));
+}
+
+Error::Type Uplink::process(Scene &scene) noexcept {
+    std::vector<uint8_t> message;
+
+    /* Inside a lock_guard scoped block, for reusing a spare buffer */
+    {
+        std::lock_guard<std::mutex> lock(access);
+        if (exiting) {
+            return Error::NONE;
+        }
+        if (!spares.empty()) {
+            message = std::move(spares.back());
+            spares.pop_back();
+        }
+    }
+
+    encode(scene, message);
+    if (message.size() > LARGEST) {
+        LOGW("%s[%s]::process(): Dropping a scene of %zu bytes!",
+             value_to_string().c_str(), name().c_str(), message.size());
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return Error::NONE;
+    }
+
+    /* Inside a unique_lock scoped block, as a full queue may block */
+    {
+        std::unique_lock<std::mutex> lock(access);
+        const std::size_t most = static_cast<int>(depth);
+        if (messages.size() >= most) {
+            switch (static_cast<Policy>(static_cast<int>(policy))) {
+                case Policy::DROP_NEWEST:
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    spares.emplace_back(std::move(message));
+                    return Error::NONE;
+
+                case Policy::BLOCK:
+                    released.wait(lock, [this, most]() {
+                        return (exiting) || (messages.size() < most); });
+                    if (exiting) {
+                        return Error::NONE;
+                    }
+                    break;
+
+                default:
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    spares.emplace_back(std::move(messages.front()));
+                    messages.pop_front();
+                    break;
+            }
+        }
+        messages.emplace_back(std::move(message));
+    }
+    queued.notify_one();
+
+    return Error::NONE;
+}
+
+void Uplink::terminate() noexcept {
+    stop();
+}
+
+void Uplink::stop() noexcept {
+    /* Inside a lock_guard scoped block */
+    {
+        std::lock_guard<std::mutex> lock(access);
+        exiting = true;
+    }
+    queued.notify_all();
+    released.notify_all();
+
+    if (sender.joinable()) {
+        sender.join();
+    }
+
+    /* Inside a lock_guard scoped block */
+    std::lock_guard<std::mutex> lock(access);
+    messages.clear();
+}
+
+void Uplink::run() noexcept {
+    const std::string target = server;
+    std::vector<std::vector<uint8_t>> sending;
+    std::vector<uint8_t>              outgoing;
+    int  fd     = -1;
+    bool failed = false;
+
+    while (true) {
+        /* The messages stay queued while disconnected, for the policy of the
+         * queue to apply to the pipeline */
+        if (fd < 0) {
+            fd = Util::IO::Socket::dial(target, timeout);
+            if (fd < 0) {
+                if (!failed) {
+                    LOGW("%s[%s]::run(): Cannot connect to '%s'!",
+                         value_to_string().c_str(), name().c_str(),
+                         target.c_str());
+                    failed = true;
+                }
+                std::unique_lock<std::mutex> lock(access);
+                queued.wait_for(lock, std::chrono::milliseconds(BACKOFF_MS),
+                                [this]() { return exiting; });
+                if (exiting) {
+                    break;
+                }
+                continue;
+            }
+            LOGI("%s[%s]::run(): Connected to '%s'",
+                 value_to_string().c_str(), name().c_str(), target.c_str());
+            if (failed) {
+                reconnections.fetch_add(1, std::memory_order_relaxed);
+                failed = false;
+            }
+        }
+
+        /* Inside a unique_lock scoped block, for taking a batch */
+        {
+            std::unique_lock<std::mutex> lock(access);
+            queued.wait_for(lock, std::chrono::milliseconds(POLLING_MS),
+                            [this]() {
+                                return (exiting) || (!messages.empty()); });
+            if (exiting) {
+                break;
+            }
+            if (messages.empty()) {
+                continue;
+            }
+
+            const std::size_t most = static_cast<int>(batch);
+            const int         wait = linger;
+            if ( (messages.size() < most) && (wait > 0) ) {
+                queued.wait_for(lock, std::chrono::milliseconds(wait),
+                                [this, most]() {
+                                    return (exiting) ||
+                                           (messages.size() >= most); });
+            }
+            while ( (!messages.empty()) && (sending.size() < most) ) {
+                sending.emplace_back(std::move(messages.front()));
+                messages.pop_front();
+            }
+        }
+        released.notify_all();
+
+        /* A batch is sent at once, for a single system call */
+        outgoing.clear();
+        for (auto const &m : sending) {
+            outgoing.insert(outgoing.end(), m.begin(), m.end());
+        }
+
+        if (Util::IO::Socket::put(fd, outgoing.data(), outgoing.size())) {
+            sent.fetch_add(sending.size(), std::memory_order_relaxed);
+        } else {
+            /* The batch may have been partially received, so neither it nor
+             * the link can be trusted any longer */
+            LOGW("%s[%s]::run(): Lost the link to '%s'!",
+                 value_to_string().c_str(), name().c_str(), target.c_str());
+            dropped.fetch_add(sending.size(), std::memory_order_relaxed);
+            close(fd);
+            fd     = -1;
+            failed = true;
+        }
+
+        /* Inside a lock_guard scoped block, for recycling the buffers */
+        {
+            std::lock_guard<std::mutex> lock(access);
+            for (auto &m : sending) {
+                if (static_cast<int>(spares.size()) <
+                    static_cast<int>(depth) + static_cast<int>(batch)) {
+                    spares.emplace_back(std::move(m));
+                }
+            }
+        }
+        sending.clear();
+    }
+
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+template <typename ...Z> Downlink<Z...>::Downlink() noexcept
+    : Core::Engine<Z...>(), bridge(), received(0), rejected(0), listener(-1),
+      uplinks(), salts(), accepted(0), storage(), serving(false), server(),
+      exported(0) {
+    port.denominate("port")
+        .describe("The TCP port the uplinks connect to, or 0 for not "
+                  "listening")
+        .characterise(Customisation::Trait::CONFIGURABLE);
+    port.range(0, 65535);
+    this->expose(port);
+    port = 0;
+
+    links.denominate("links")
+         .describe("The maximal number of uplinks connected at once")
+         .characterise(Customisation::Trait::CONFIGURABLE);
+    links.range(1, 64);
+    this->expose(links);
+    links = 4;
+
+    bridge.denominate("bridge");
+    this->expose(bridge);
+
+    exported = Util::Metrics::Registry::instance().attach(
+        [this](Util::Metrics::Exposition &e) {
+            auto labels = "engine=" +
+                          Util::Metrics::Exposition::quote(this->name());
+            e.counter("vpp_downlink_received_total",
+                      "Scenes received by the downlinks", labels,
+                      received.load(std::memory_order_relaxed));
+            e.counter("vpp_downlink_rejected_total",
+                      "Invalid scenes rejected by the downlinks", labels,
+                      rejected.load(std::memory_order_relaxed)); });
+}
+
+template <typename ...Z> Downlink<Z...>::~Downlink() noexcept {
+    stop();
+    Util::Metrics::Registry::instance().detach(exported);
+}
+
+template <typename ...Z>
+Customisation::Error Downlink<Z...>::setup() noexcept {
+    stop();
+
+    auto error = bridge.setup();
+    if (error != Customisation::Error::NONE) {
+        return error;
+    }
+
+    const int p = port;
+    if (p == 0) {
+        return Customisation::Error::NONE;
+    }
+
+    listener = Util::IO::Socket::listening(p, links);
+    if (listener < 0) {
+        LOGE("%s[%s]::setup(): Cannot listen on port %d: %s!",
+             this->value_to_string().c_str(), this->name().c_str(), p,
+             strerror(errno));
+        return Customisation::Error::INVALID_VALUE;
+    }
+
+    serving = true;
+    server  = std::thread([this]() { serve(); });
+
+    return Customisation::Error::NONE;
+}
+
+template <typename ...Z>
+Error::Type Downlink<Z...>::prepare(Scene*& s, Z*&... z) noexcept {
+    return bridge.prepare(s, z...);
+}
+
+template <typename ...Z> void Downlink<Z...>::terminate() noexcept {
+    stop();
+}
+
+template <typename ...Z> void Downlink<Z...>::stop() noexcept {
+    /* Emptying the bridge releases the server if blocked in forwarding */
+    serving = false;
+    bridge.terminate();
+    if (server.joinable()) {
+        server.join();
+    }
+
+    for (auto u : uplinks) {
+        close(u);
+    }
+    uplinks.clear();
+    salts.clear();
+
+    if (listener >= 0) {
+        close(listener);
+        listener = -1;
+    }
+}
+
+template <typename ...Z> void Downlink<Z...>::serve() noexcept {
+    std::vector<struct pollfd> waiting;
+
+    while (serving) {
+        waiting.resize(1 + uplinks.size());
+        waiting[0].fd     = listener;
+        waiting[0].events = POLLIN;
+        for (std::size_t i = 0; i < uplinks.size(); ++i) {
+            waiting[1 + i].fd     = uplinks[i];
+            waiting[1 + i].events = POLLIN;
+        }
+        for (auto &w : waiting) {
+            w.revents = 0;
+        }
+
+        if (poll(waiting.data(), waiting.size(), POLLING_MS) <= 0) {
+            continue;
+        }
+
+        /* Receiving a message per ready uplink, for none to starve the
+         * others, and dropping the failed ones */
+        for (std::size_t i = uplinks.size(); (serving) && (i > 0); --i) {
+            if ( (waiting[i].revents != 0) &&
+                 (!receive(uplinks[i - 1], salts[i - 1])) ) {
+                close(uplinks[i - 1]);
+                uplinks.erase(uplinks.begin() + (i - 1));
+                salts.erase(salts.begin() + (i - 1));
+            }
+        }
+
+        if ((waiting[0].revents & POLLIN) != 0) {
+            auto uplink = accept(listener, nullptr, nullptr);
+            if (uplink < 0) {
+                continue;
+            }
+            if (static_cast<int>(uplinks.size()) >= static_cast<int>(links)) {
+                LOGW("%s[%s]::serve(): Refusing an uplink, as %d already "
+                     "are connected", this->value_to_string().c_str(),
+                     this->name().c_str(), static_cast<int>(links));
+                close(uplink);
+                continue;
+            }
+
+            /* The UUIDs of every link are salted apart, as the uplinks
+             * number their zones independently */
+            accepted = (accepted % 0xffff) + 1;
+            uplinks.emplace_back(uplink);
+            salts.emplace_back(accepted);
+        }
+    }
+}
+
+template <typename ...Z>
+bool Downlink<Z...>::receive(int fd, uint64_t salt) noexcept {
+    Link::Header header;
+    if (!Util::IO::Socket::get(fd, &header, sizeof(header), RECEIVING_MS)) {
+        return false;
+    }
+
+    /* The framing is lost with an invalid header, and so is the link */
+    if ( (header.magic != Link::MAGIC) || (header.version != Link::VERSION) ||
+         (header.size < sizeof(header)) || (header.size > LARGEST) ) {
+        LOGW("%s[%s]::receive(): Dropping an uplink sending invalid scenes!",
+             this->value_to_string().c_str(), this->name().c_str());
+        rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /* The messages are stored on 8 bytes for the wire reader */
+    storage.resize(padded(header.size) / sizeof(uint64_t));
+    auto message = reinterpret_cast<uint8_t *>(storage.data());
+    std::memcpy(message, &header, sizeof(header));
+    if (!Util::IO::Socket::get(fd, message + sizeof(header),
+                               header.size - sizeof(header), RECEIVING_MS)) {
+        return false;
+    }
+    received.fetch_add(1, std::memory_order_relaxed);
+
+    Scene scn;
+    if (!decode(message, header.size, salt, scn)) {
+        rejected.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bridge.forward(std::move(scn));
+    bridge.forward(std::move(bridge.scene().zones()));
+
+    return true;
+}
+
+template <typename ...Z>
+bool Downlink<Z...>::decode(const uint8_t *message, std::size_t size,
+                            uint64_t salt, Scene &scene) noexcept {
+    auto header = reinterpret_cast<const Link::Header *>(message);
+    auto offset = sizeof(Link::Header);
+    if ( (header->width < 0) || (header->height < 0) ||
+         (offset + padded(header->wire) > size) ) {
+        return false;
+    }
+
+    Wire::Reader reader(message + offset, header->wire);
+    if (!reader.valid()) {
+        return false;
+    }
+    offset += padded(header->wire);
+
+    /* The frame is only made of the crops, at their place */
+    const cv::Rect bounds(0, 0, header->width, header->height);
+    cv::Mat frame(bounds.size(), CV_8UC3, cv::Scalar::all(0));
+    for (int c = 0; c < header->crops; ++c) {
+        if (offset + sizeof(Link::Crop) > size) {
+            return false;
+        }
+        auto crop = reinterpret_cast<const Link::Crop *>(message + offset);
+        offset += sizeof(Link::Crop);
+
+        cv::Rect at(crop->x, crop->y, crop->width, crop->height);
+        if ( (offset + padded(crop->bytes) > size) || (at.area() <= 0) ||
+             ((at & bounds) != at) ) {
+            return false;
+        }
+
+        auto data = const_cast<uint8_t *>(message + offset);
+        cv::Mat pixels;
+        if (crop->encoding == Link::RAW) {
+            if (crop->bytes != static_cast<uint32_t>(at.area() * 3)) {
+                return false;
+            }
+            pixels = cv::Mat(at.size(), CV_8UC3, data);
+        }
+#ifdef VPP_HAS_IMAGE_CODEC_SUPPORT
+        else if (crop->encoding == Link::JPEG) {
+            pixels = cv::imdecode(cv::Mat(1, static_cast<int>(crop->bytes),
+                                          CV_8U, data), cv::IMREAD_COLOR);
+            if (pixels.size() != at.size()) {
+                return false;
+            }
+        }
+#endif
+        else {
+            return false;
+        }
+        pixels.copyTo(frame(at));
+        offset += padded(crop->bytes);
+    }
+
+    /* The latencies of the far side are measured from the reception */
+    scene.view.stamp(reader.ts());
+    scene.view.clock(View::now_us());
+    if (bounds.area() > 0) {
+        scene.view.use(frame, VPP::Image::Mode::BGR);
+    }
+
+    for (int i = 0; i < reader.size(); ++i) {
+        auto r = reader.zone(i);
+        Zone z(BBox(r.bbox()));
+        if (r.uuid() != 0) {
+            z.uuid = (r.uuid() & SALTED) | (salt << SALTING);
+        }
+        std::memcpy(z.state.data(), r.state(),
+                    Zone::State::length * sizeof(float));
+        z.context = r.context();
+        for (int k = 0; k < r.ranked(); ++k) {
+            z.predictions.insert(r.prediction(k));
+        }
+        if (r.points() > 0) {
+            z.contour = scene.contours.store(r.contour(), r.points());
+        }
+        if (r.length() > 0) {
+            z.description.assign(r.description(), r.length());
+        }
+        scene.mark(std::move(z));
+    }
+
+    return true;
+}
+
+/* Create template implementations */
+template class Downlink<Zone>;
+template class Downlink<Zones>;
+
+}  // namespace Engine
+}  // namespace VPP
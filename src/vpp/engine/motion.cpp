@@ -0,0 +1,151 @@
+/**
+ *
+ * @file      vpp/engine/motion.cpp
+ *
+ * @brief     These are various engines to manage motion within scenes
+ *
+ * @details   This is a collection of engines for finding the regions of the
+ *            scenes with some motion, so that the static parts of the frames
+ *            are not processed again
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+
+#include "vpp/log.hpp"
+#include "vpp/engine/motion.hpp"
+#include "vpp/util/ocv/functions.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Motion {
+
+Proposal::Proposal() noexcept 
+    : latest(), task(latest), access(), stamp(0), proposed() {
+    speed.denominate("speed")
+         .describe("The minimal flow magnitude in pixels for a pixel to be "
+                   "considered as moving")
+         .characterise(Customisation::Trait::SETTABLE);
+    speed.range(0.0f, 100.0f);
+    expose(speed);
+    speed = 1.0f;
+
+    dilation.denominate("dilation")
+            .describe("The dilation in pixels to apply to the moving pixels "
+                      "before merging them into regions")
+            .characterise(Customisation::Trait::SETTABLE);
+    dilation.range(0, 64);
+    expose(dilation);
+    dilation = 8;
+
+    margin.denominate("margin")
+          .describe("The margin in pixels to add around each proposed region")
+          .characterise(Customisation::Trait::SETTABLE);
+    margin.range(0, 256);
+    expose(margin);
+    margin = 16;
+
+    area.denominate("area")
+        .describe("The minimal area in pixels of a proposed region")
+        .characterise(Customisation::Trait::SETTABLE);
+    area.range(0, 1 << 24);
+    expose(area);
+    area = 256;
+
+    task.denominate("flow");
+    expose(task);
+}
+
+Customisation::Error Proposal::setup() noexcept {
+    latest = std::move(Scene());
+
+    std::lock_guard<std::mutex> lock(access);
+    stamp = 0;
+    proposed.clear();
+
+    return Customisation::Error::NONE;
+}
+
+Error::Type Proposal::process(Scene &scene) noexcept {
+    bool first = latest.view.empty();
+    if (scene.view.cached_motion() == nullptr) {
+        auto e = task.estimate(scene);
+        if (e != Error::NONE) {
+            return e;
+        }
+    }
+    scene.remember(latest, Zone::Copy::BBoxOnly);
+
+    /* Without any history, there is no motion to rely upon */
+    auto flow = scene.view.cached_motion();
+    if ( (first) || (flow == nullptr) ) {
+        return Error::NONE;
+    }
+
+    /* Threshold the flow magnitude and dilate the moving pixels */
+    cv::Mat xy[2], magnitude, mask;
+    cv::split(flow->input(), xy);
+    cv::magnitude(xy[0], xy[1], magnitude);
+    cv::compare(magnitude, static_cast<double>(speed), mask, cv::CMP_GT);
+    if (dilation > 0) {
+        auto d = 2 * static_cast<int>(dilation) + 1;
+        cv::dilate(mask, mask, 
+                   cv::getStructuringElement(cv::MORPH_RECT, cv::Size(d, d)));
+    }
+
+    std::vector<std::vector<cv::Point>> contours;
+    cv::findContours(mask, contours, cv::RETR_EXTERNAL, 
+                     cv::CHAIN_APPROX_SIMPLE);
+
+    /* The flow may be estimated at a lower resolution than the frame */
+    const auto &frame = scene.view.frame();
+    auto sx = static_cast<float>(frame.width) / mask.cols;
+    auto sy = static_cast<float>(frame.height) / mask.rows;
+    int  m  = margin;
+
+    std::vector<cv::Rect> rois;
+    rois.reserve(contours.size());
+    for (auto &c : contours) {
+        auto r = cv::boundingRect(c);
+        cv::Rect roi(static_cast<int>(r.x * sx) - m, 
+                     static_cast<int>(r.y * sy) - m,
+                     static_cast<int>(r.width * sx) + 2 * m,
+                     static_cast<int>(r.height * sy) + 2 * m);
+        rois.emplace_back(roi & frame);
+    }
+    Util::OCV::merge(rois);
+    rois.erase(std::remove_if(rois.begin(), rois.end(),
+                              [this](const cv::Rect &r) {
+                                  return r.area() < area; }),
+               rois.end());
+
+    std::lock_guard<std::mutex> lock(access);
+    stamp    = scene.ts_ms();
+    proposed = std::move(rois);
+
+    return Error::NONE;
+}
+
+bool Proposal::regions(const Scene &scene, 
+                       std::vector<cv::Rect> &rois) const noexcept {
+    std::lock_guard<std::mutex> lock(access);
+    if ( (stamp == 0) || (stamp != scene.ts_ms()) ) {
+        return false;
+    }
+
+    rois = proposed;
+    return true;
+}
+
+}  // namespace Motion
+}  // namespace Engine
+}  // namespace VPP
@@ -0,0 +1,142 @@
+/**
+ *
+ * @file      vpp/engine/ocr/cache.cpp
+ *
+ * @brief     This is a cache of OCR results keyed by the look of the crops
+ *
+ * @details   The crops are identified by their size and a difference hash of
+ *            their content, so that the unchanged text regions are not read
+ *            again from one frame to another
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <cstdlib>
+#include <opencv2/imgproc.hpp>
+
+#include "vpp/engine/ocr/cache.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace OCR {
+
+/* Number of bits set in a 64-bit word */
+static inline int bits(uint64_t x) noexcept {
+    int n = 0;
+    for (; x != 0; x &= x - 1) {
+        ++n;
+    }
+    return n;
+}
+
+/* Sizes within an eighth of each other are considered alike */
+static inline bool alike(const cv::Size &a, const cv::Size &b) noexcept {
+    return (std::abs(a.width - b.width) * 8 <= a.width) &&
+           (std::abs(a.height - b.height) * 8 <= a.height);
+}
+
+Cache::Cache() noexcept 
+    : Customisation::Entity("Cache"), access(), entries() {
+    capacity.denominate("capacity")
+            .describe("The maximal number of cached crops (0 for disabling "
+                      "the cache)")
+            .characterise(Customisation::Trait::SETTABLE);
+    capacity.range(0, 4096);
+    expose(capacity);
+    capacity = 64;
+
+    distance.denominate("distance")
+            .describe("The maximal number of different hash bits between two "
+                      "crops having the same text")
+            .characterise(Customisation::Trait::SETTABLE);
+    distance.range(0, 64);
+    expose(distance);
+    distance = 4;
+}
+
+Customisation::Error Cache::clear() noexcept {
+    std::lock_guard<std::mutex> lock(access);
+    entries.clear();
+    return Customisation::Error::NONE;
+}
+
+uint64_t Cache::hash(const cv::Mat &crop) noexcept {
+    /* Compare the horizontally adjacent pixels of a 9x8 thumbnail of the
+     * binarised crop, which makes the hash insensitive to lighting */
+    cv::Mat gray, binary, thumb;
+    if (crop.channels() == 3) {
+        cv::cvtColor(crop, gray, cv::COLOR_BGR2GRAY);
+    } else {
+        gray = crop;
+    }
+    cv::threshold(gray, binary, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+    cv::resize(binary, thumb, cv::Size(9, 8), 0, 0, cv::INTER_AREA);
+
+    uint64_t h = 0;
+    for (int y = 0; y < 8; ++y) {
+        auto p = thumb.ptr<uchar>(y);
+        for (int x = 0; x < 8; ++x) {
+            h = (h << 1) | static_cast<uint64_t>(p[x] < p[x + 1]);
+        }
+    }
+
+    return h;
+}
+
+std::list<Cache::Entry>::iterator Cache::find(const cv::Size &size,
+                                              uint64_t h) noexcept {
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if ( (alike(it->size, size)) && (bits(it->hash ^ h) <= distance) ) {
+            return it;
+        }
+    }
+
+    return entries.end();
+}
+
+bool Cache::recall(const cv::Mat &crop, uint64_t h, 
+                   std::string &text) noexcept {
+    std::lock_guard<std::mutex> lock(access);
+    auto found = find(crop.size(), h);
+    if (found == entries.end()) {
+        return false;
+    }
+
+    text = found->text;
+    entries.splice(entries.begin(), entries, found);
+    return true;
+}
+
+void Cache::store(const cv::Mat &crop, uint64_t h, 
+                  const std::string &text) noexcept {
+    std::lock_guard<std::mutex> lock(access);
+    if (capacity <= 0) {
+        entries.clear();
+        return;
+    }
+
+    auto found = find(crop.size(), h);
+    if (found != entries.end()) {
+        found->size = crop.size();
+        found->hash = h;
+        found->text = text;
+        entries.splice(entries.begin(), entries, found);
+        return;
+    }
+
+    entries.push_front(Entry{crop.size(), h, text});
+    while (static_cast<int>(entries.size()) > capacity) {
+        entries.pop_back();
+    }
+}
+
+}  // namespace OCR
+}  // namespace Engine
+}  // namespace VPP
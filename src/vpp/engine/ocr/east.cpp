@@ -0,0 +1,169 @@
+/**
+ *
+ * @file      vpp/engine/ocr/east.cpp
+ *
+ * @brief     This is an EAST DNN engine aimed at detecting areas for OCR
+ *
+ * @details   This is an engine for running an EAST text detector with the
+ *            OpenCV (OCV) DNN module, and marking its rotated text boxes as
+ *            text zones to be read
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <cmath>
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/opencv.hpp>
+
+#include "vpp/log.hpp"
+#include "vpp/engine/ocr/east.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace OCR {
+
+/* The EAST score and geometry output layers */
+static const std::vector<cv::String> layers = {
+    "feature_fusion/Conv_7/Sigmoid", "feature_fusion/concat_3" };
+
+/* The EAST maps have one cell every 4 input pixels */
+static const float stride = 4.0f;
+
+EAST::EAST() noexcept
+    : VPP::DNN::Engine::OCV<>(), nms(0.4f), outputs(), boxes(),
+      confidences(), indices() {
+    nms.denominate("nms")
+       .describe("The minimal threshold to perform NMS (-1 to disable)")
+       .characterise(Customisation::Trait::SETTABLE);
+    nms.range(-1.0f, 1.0f);
+    Customisation::Entity::expose(nms);
+}
+
+EAST::~EAST() noexcept = default;
+
+void EAST::decode(const cv::Mat &scores, const cv::Mat &geometry) noexcept {
+    const int   height  = scores.size[2];
+    const int   width   = scores.size[3];
+    const float minimal = threshold;
+
+    for (int y = 0; y < height; ++y) {
+        const float *score = scores.ptr<float>(0, 0, y);
+        const float *top   = geometry.ptr<float>(0, 0, y);
+        const float *right = geometry.ptr<float>(0, 1, y);
+        const float *bot   = geometry.ptr<float>(0, 2, y);
+        const float *left  = geometry.ptr<float>(0, 3, y);
+        const float *angle = geometry.ptr<float>(0, 4, y);
+        int x = 0;
+
+        while (x < width) {
+#if CV_SIMD128
+            /* Skip 4 cells at once when none of them is above the threshold,
+             * most of the cells of a frame not being text */
+            const cv::v_float32x4 vmin = cv::v_setall_f32(minimal);
+            while ( (x + 4 <= width) && 
+                    (!cv::v_check_any(cv::v_load(score + x) > vmin)) ) {
+                x += 4;
+            }
+            if (x >= width) {
+                break;
+            }
+#endif /*CV_SIMD128*/
+            if (score[x] <= minimal) {
+                ++x;
+                continue;
+            }
+
+            /* Rebuild the rotated box from the distances to its edges */
+            const float cosA = std::cos(angle[x]);
+            const float sinA = std::sin(angle[x]);
+            const float h    = top[x] + bot[x];
+            const float w    = right[x] + left[x];
+
+            cv::Point2f offset(x * stride + cosA * right[x] + sinA * bot[x],
+                               y * stride - sinA * right[x] + cosA * bot[x]);
+            cv::Point2f p1 = cv::Point2f(-sinA * h, -cosA * h) + offset;
+            cv::Point2f p3 = cv::Point2f(-cosA * w,  sinA * w) + offset;
+
+            boxes.emplace_back(0.5f * (p1 + p3), cv::Size2f(w, h),
+                               -angle[x] * 180.0f / static_cast<float>(CV_PI));
+            confidences.push_back(score[x]);
+            ++x;
+        }
+    }
+}
+
+Error::Type EAST::process(Scene &scene) noexcept {
+    const cv::Mat &input = scene.view.bgr().input();
+    const cv::Size sz    = static_cast<cv::Size>(size);
+    cv::Mat        blob  = scene.view.blob(Image::Mode::BGR, sz, scale, offset,
+                                           static_cast<bool>(RGB));
+    {
+        // Infer on the (shared) network and keep the maps away from it
+        auto lock = reserve();
+        net.setInput(blob);
+        Util::Timing timing(inference);
+        net.forward(outputs, layers);
+        for (auto &o : outputs) {
+            o = o.clone();
+        }
+    }
+
+    if (outputs.size() != 2) {
+        LOGE("%s[%s]::process(): Expecting the score and geometry outputs of "
+             "an EAST network!", value_to_string().c_str(), name().c_str());
+        return Error::INVALID_VALUE;
+    }
+
+    boxes.clear();
+    confidences.clear();
+    decode(outputs[0], outputs[1]);
+
+    indices.clear();
+    if (static_cast<float>(nms) >= 0) {
+        cv::dnn::NMSBoxes(boxes, confidences, threshold, nms, indices);
+    } else {
+        indices.resize(boxes.size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            indices[i] = static_cast<int>(i);
+        }
+    }
+
+    // Map the rotated boxes back to the frame and mark them as text zones
+    const float rx = static_cast<float>(input.cols) / sz.width;
+    const float ry = static_cast<float>(input.rows) / sz.height;
+    const cv::Rect frame(0, 0, input.cols, input.rows);
+    for (auto idx : indices) {
+        cv::Point2f corners[4];
+        boxes[idx].points(corners);
+
+        std::vector<cv::Point> contour(4);
+        for (int i = 0; i < 4; ++i) {
+            contour[i] = cv::Point(static_cast<int>(corners[i].x * rx),
+                                   static_cast<int>(corners[i].y * ry));
+        }
+
+        Zone zone(scene.contours.store(contour));
+        static_cast<cv::Rect &>(zone) &= frame;
+        if (zone.area() <= 0) {
+            continue;
+        }
+
+        Prediction text(confidences[idx], dataset.ID(), dataset.textID());
+        zone.predict(text);
+        zone.context = std::move(text);
+        scene.mark(std::move(zone));
+    }
+
+    return Error::NONE;
+}
+
+}  // namespace OCR
+}  // namespace Engine
+}  // namespace VPP
@@ -2,7 +2,7 @@
  *
  * @file      vpp/engine/ocr/tesseract.cpp
  *
- * @brief     This is the Tesseract OCR engine
+ * @brief     These are the Tesseract OCR engines
  *
  *            This file is part of the VPP framework (see link).
  *
@@ -15,8 +15,10 @@
  **/
 
 #include <locale>
+#include <memory>
 #include <string>
 #include <tesseract/baseapi.h>
+#include <tesseract/resultiterator.h>
 #include <leptonica/allheaders.h>
 #include <opencv2/opencv.hpp>
 
@@ -27,102 +29,244 @@ namespace VPP {
 namespace Engine {
 namespace OCR {
 
-/* Helper function to clean what has been OCR'ed */
-static void insertUTF8Text(Zone &zone, const char *info) {
-    zone.description.clear();
-
-    if (strlen(info) > 0) {
-        zone.description.resize(strlen(info)+1);
-        // From (f) and To (t) pointers
-        auto f = (uint8_t *) (info);
-        auto s = (uint8_t *) (zone.description.data());
-        auto t = s;
- 
-        // Start of text (sot) and was separator (sep) tags
-        bool sot=true;
-        bool sep=false;
-
-        while (true) {
-
-            /* Keep letters, numbers and punctuation */
-            if ( ((*f >= '!') && (*f <= 'Z')) ||
-                 ((*f >= 'a') && (*f <= 'z')) ) {
-                if ((!sot)  && (sep)) ++t;
-                *t = *f;
-                ++f; ++t;
-                sot=false; sep=false;
-                continue;
+/* Helper function to clean what has been OCR'ed: letters, numbers,
+ * punctuation, accentuated characters and money signs are appended to the
+ * text, and the separators are kept pending until the next kept character so
+ * that there are neither leading, trailing nor multiple separators */
+static void appendUTF8Text(std::string &text, const char *info,
+                           char &pending) noexcept {
+    auto f = reinterpret_cast<const uint8_t *>(info);
+
+    while (*f != '\0') {
+
+        /* Keep letters, numbers and punctuation */
+        if ( ((*f >= '!') && (*f <= 'Z')) ||
+             ((*f >= 'a') && (*f <= 'z')) ) {
+            if ((pending != '\0') && (!text.empty())) {
+                text.push_back(pending);
             }
+            text.push_back(static_cast<char>(*f));
+            pending = '\0';
+            ++f;
+            continue;
+        }
 
-            /* Manage the space (and avoid multiple spaces) */
-            if (*f == ' ') {
-                ++f;
-                if ((!sot) && (!sep)) {
-                    *t = ' ';
-                }
-                sep=true;
-                continue;
+        /* Manage the space (and avoid multiple spaces) */
+        if (*f == ' ') {
+            if (pending == '\0') {
+                pending = ' ';
             }
+            ++f;
+            continue;
+        }
 
-            /* Manage carriage returns */
-            if (*f == '\n') {
-                ++f;
-                if (!sot) {
-                    *t='\n';
-                }
-                sep=true;
-                continue;
-            }
+        /* Manage carriage returns */
+        if (*f == '\n') {
+            pending = '\n';
+            ++f;
+            continue;
+        }
 
-            /* Exit if '\0' */
-            if (*f == '\0') {
-                *t='\0';
-                break;
+        /* UTF-8 extensions keep all accentued characters and money signs */
+        bool keep = false;
+        if ( (*f == 0xc3) && (*(f+1) != '\0') ) {
+            keep = true;
+        } else if ( (*f == 0xc2) && (*(f+1) != '\0') ) {
+            switch (*(f+1)) {
+                /* Keep the following characters */
+                case 0xa2: // ¢
+                case 0xa3: // £
+                case 0xa5: // ¥
+                case 0xaa: // «
+                case 0xbb: // »
+                    keep = true;
+                    break;
+                /* Skip other characters */
+                default:
+                    f+=2;
+                    continue;
             }
+        }
 
-            /* UTF-8 extensions keep all accentued characters and money signs */
-            if (*f == 0xc3) {
-                if ((!sot)  && (sep)) ++t;
-                *t=*f; ++f; ++t;
-                *t=*f; ++f; ++t;
-                sot=false; sep=false;
-                continue;
+        if (keep) {
+            if ((pending != '\0') && (!text.empty())) {
+                text.push_back(pending);
             }
+            text.push_back(static_cast<char>(*f));
+            text.push_back(static_cast<char>(*(f+1)));
+            pending = '\0';
+            f+=2;
+            continue;
+        }
+
+        /* Skip any other character */
+        ++f;
+    }
+}
+
+/* Helper function to read a crop word by word, only keeping the words with a
+ * confidence above the minimal one. The text is overwritten in place, so that
+ * its storage is reused from one reading to another */
+static void readUTF8Text(tesseract::TessBaseAPI &tess, const cv::Mat &crop,
+                         float minimal, std::string &text) noexcept {
+    text.clear();
+
+    tess.SetImage(crop.data, crop.cols, crop.rows, crop.channels(),
+                  crop.step);
+    if (tess.Recognize(nullptr) != 0) {
+        return;
+    }
+
+    std::unique_ptr<tesseract::ResultIterator> it(tess.GetIterator());
+    if (!it) {
+        return;
+    }
+
+    const auto word = tesseract::RIL_WORD;
+    char pending    = '\0';
+    do {
+        if (it->Empty(word)) {
+            continue;
+        }
 
-            if (*f == 0xc2) {
-                switch (*(f+1)) {
-                    /* Keep the following characters */
-                    case 0xa2: // ¢
-                    case 0xa3: // £
-                    case 0xa5: // ¥
-                    case 0xaa: // «
-                    case 0xbb: // »
-                        if ((!sot)  && (sep)) ++t;
-                        *t=*f; ++f; ++t;
-                        *t=*f; ++f; ++t;
-                        sot=false; sep=false;
-                        break;
-                    /* Skip other characters */
-                    default:
-                        f+=2;
-                }
-                continue;
+        if (it->Confidence(word) >= minimal) {
+            std::unique_ptr<char[]> info(it->GetUTF8Text(word));
+            if (info) {
+                appendUTF8Text(text, info.get(), pending);
             }
+        }
 
-            /* Skip any other character */
-            ++f;
+        if (it->IsAtFinalElement(tesseract::RIL_TEXTLINE, word)) {
+            pending = '\n';
+        } else if (pending != '\n') {
+            pending = ' ';
+        }
+    } while (it->Next(word));
+}
+
+Frontend::Frontend() noexcept
+    : Customisation::Entity("Frontend"), access(), source(), area(),
+      prepared() {
+        binarisation.denominate("binarisation")
+                    .describe("The binarisation of the gray crops to read: "
+                              "either none, adaptive (mean threshold) or "
+                              "sauvola (mean and deviation threshold)")
+                    .characterise(Customisation::Trait::SETTABLE);
+        binarisation.define(
+            { { "none",     static_cast<int>(Binarisation::NONE) },
+              { "adaptive", static_cast<int>(Binarisation::ADAPTIVE) },
+              { "sauvola",  static_cast<int>(Binarisation::SAUVOLA) } });
+        expose(binarisation);
+        binarisation = static_cast<int>(Binarisation::NONE);
+
+        window.denominate("window")
+              .describe("The side of the binarisation windows, in pixels")
+              .characterise(Customisation::Trait::SETTABLE);
+        window.range(3, 255);
+        expose(window);
+        window = 31;
+
+        offset.denominate("offset")
+              .describe("The offset of the adaptive thresholds below the "
+                        "window means, in gray levels")
+              .characterise(Customisation::Trait::SETTABLE);
+        offset.range(-255.0f, 255.0f);
+        expose(offset);
+        offset = 10.0f;
+
+        sensitivity.denominate("sensitivity")
+                   .describe("The sensitivity of the Sauvola thresholds to the "
+                             "deviation of the windows")
+                   .characterise(Customisation::Trait::SETTABLE);
+        sensitivity.range(0.0f, 1.0f);
+        expose(sensitivity);
+        sensitivity = 0.2f;
+
+        height.denominate("height")
+              .describe("The minimal height of the crops to read, the smaller "
+                        "ones being upscaled to it, or 0 for never upscaling "
+                        "them")
+              .characterise(Customisation::Trait::SETTABLE);
+        height.range(0, 256);
+        expose(height);
+        height = 0;
+}
+
+void Frontend::prepare(Scene &scene, const cv::Rect &zones) noexcept {
+    const cv::Mat &gray = scene.view.gray().input();
+    auto within = zones & cv::Rect(0, 0, gray.cols, gray.rows);
+
+    /* The source is held, so its buffer cannot be the one of another frame */
+    std::lock_guard<std::mutex> lock(access);
+    if ( (source.data == gray.data) && ((within & area) == within) ) {
+        return;
+    }
+
+    source = gray;
+    area   = within;
+
+    /* The windows of a region of interest lie on the whole frame */
+    cv::Mat g = source(area);
+    int w = static_cast<int>(window) | 1;
+    switch (static_cast<int>(binarisation)) {
+        case static_cast<int>(Binarisation::ADAPTIVE):
+            cv::adaptiveThreshold(g, prepared, 255, cv::ADAPTIVE_THRESH_MEAN_C,
+                                  cv::THRESH_BINARY, w,
+                                  static_cast<float>(offset));
+            break;
+
+        case static_cast<int>(Binarisation::SAUVOLA): {
+            /* T = m * (1 + k * (s / 128 - 1)) for a mean m and a deviation s
+             * of the window */
+            cv::Mat mean, squares, variance, deviation, threshold;
+            cv::boxFilter(g, mean, CV_32F, cv::Size(w, w));
+            cv::sqrBoxFilter(g, squares, CV_32F, cv::Size(w, w));
+            variance = squares - mean.mul(mean);
+            cv::sqrt(cv::max(variance, 0.0), deviation);
+            auto k = static_cast<float>(sensitivity);
+            threshold = mean.mul(deviation * (k / 128.0f) + (1.0f - k));
+            g.convertTo(squares, CV_32F);
+            cv::compare(squares, threshold, prepared, cv::CMP_GT);
+            break;
         }
 
-        zone.description.resize(t-s);
-    } else {
-        zone.description = "";
+        default:
+            prepared = g;
+            break;
     }
 }
 
+cv::Mat Frontend::crop(const cv::Rect &zone) noexcept {
+    cv::Mat image;
+    bool binary;
+    {
+        std::lock_guard<std::mutex> lock(access);
+        image  = prepared((zone & area) - area.tl());
+        binary = (static_cast<int>(binarisation) !=
+                  static_cast<int>(Binarisation::NONE));
+    }
+
+    /* Small texts are upscaled, the binarised ones being thresholded again */
+    int h = height;
+    if ( (h > 0) && (image.rows > 0) && (image.rows < h) ) {
+        cv::Mat upscaled;
+        double f = static_cast<double>(h) / image.rows;
+        cv::resize(image, upscaled, cv::Size(), f, f,
+                   binary ? cv::INTER_LINEAR : cv::INTER_CUBIC);
+        if (binary) {
+            cv::threshold(upscaled, upscaled, 127, 255, cv::THRESH_BINARY);
+        }
+        return upscaled;
+    }
+
+    return image;
+}
+
 Tesseract::Tesseract() noexcept
-    : path(""), language(""), current_path(""), current_language(""), 
-      current_oem(tesseract::OEM_COUNT),
-      current_psm(tesseract::PSM_COUNT), tess() {
+    : path(""), language(""), cache(), preprocessing(), loading(),
+      current_path(""), current_language(""),
+      current_oem(tesseract::OEM_COUNT), current_psm(tesseract::PSM_COUNT),
+      tess() {
 
         path.denominate("path")
             .describe("The path for all Tesseract OCR configuration files")
@@ -147,9 +291,34 @@ Tesseract::Tesseract() noexcept
         psm.range(0, tesseract::PSM_COUNT-1);
         expose(psm);
         psm = static_cast<int>(tesseract::PSM_AUTO_OSD);
+
+        confidence.denominate("confidence")
+                  .describe("The minimal confidence of the words to keep")
+                  .characterise(Customisation::Trait::SETTABLE);
+        confidence.range(0.0f, 100.0f);
+        expose(confidence);
+        confidence = 0.0f;
+
+        cache.denominate("cache");
+        expose(cache);
+
+        preprocessing.denominate("preprocessing");
+        expose(preprocessing);
+}
+
+Tesseract::~Tesseract() noexcept {
+    loading.wait();
 }
 
 Customisation::Error Tesseract::setup() noexcept {
+    /* Loading the language data concurrently with the other engines */
+    auto &startup = Util::Task::Startup::instance();
+    return static_cast<Customisation::Error>(
+        startup.run(loading, name(), [this]() noexcept {
+                        return static_cast<int>(instantiate()); }));
+}
+
+Customisation::Error Tesseract::instantiate() noexcept {
     auto req_oem = static_cast<tesseract::OcrEngineMode>(static_cast<int>(oem));
     auto req_psm = static_cast<tesseract::PageSegMode>(static_cast<int>(psm));
 
@@ -189,14 +358,20 @@ Error::Type Tesseract::process(Scene &scene, Zone &zone) noexcept {
             value_to_string().c_str(), name().c_str(),
             zone.width, zone.height, zone.x, zone.y);
 
-    const cv::Mat &input = scene.view.bgr().input();
-    cv::Mat text = input(zone);
+    /* The whole frame is prepared at once for all the zones to read */
+    preprocessing.prepare(scene, scene.view.frame());
+    cv::Mat text = scene.view.gray().input()(zone);
+
+    /* Reuse the text of a similar crop if any */
+    auto h = Cache::hash(text);
+    if (cache.recall(text, h, zone.description)) {
+        return Error::NONE;
+    }
 
-    tess.SetImage(text.data, text.cols, text.rows, 3, text.step);
+    readUTF8Text(tess, preprocessing.crop(zone),
+                 static_cast<float>(confidence), zone.description);
 
-    auto info = tess.GetUTF8Text();
-    insertUTF8Text(zone, info);
-    delete[] info;
+    cache.store(text, h, zone.description);
 
     return Error::NONE;
 }
@@ -209,6 +384,237 @@ void Tesseract::terminate() noexcept {
     }
 }
 
+Pool::Pool() noexcept 
+    : access(), path(""), language(""), oem(tesseract::OEM_COUNT),
+      psm(tesseract::PSM_COUNT), apis(), idle() {}
+
+Pool::~Pool() noexcept {
+    end();
+}
+
+std::unique_ptr<tesseract::TessBaseAPI> Pool::create(int &error) noexcept {
+    std::unique_ptr<tesseract::TessBaseAPI> api(new tesseract::TessBaseAPI());
+    error = api->Init(path.c_str(), language.c_str(), oem);
+    if (error) {
+        return nullptr;
+    }
+
+    api->SetVariable("debug_file", "/dev/null");
+    api->SetPageSegMode(psm);
+
+    return api;
+}
+
+int Pool::init(const std::string &path, const std::string &language,
+               tesseract::OcrEngineMode oem,
+               tesseract::PageSegMode psm) noexcept {
+    end();
+
+    std::lock_guard<std::mutex> lock(access);
+    this->path     = path;
+    this->language = language;
+    this->oem      = oem;
+    this->psm      = psm;
+
+    int  error = 0;
+    auto api   = create(error);
+    if (api) {
+        idle.push_back(api.get());
+        apis.emplace_back(std::move(api));
+    }
+
+    return error;
+}
+
+void Pool::end() noexcept {
+    std::lock_guard<std::mutex> lock(access);
+    for (auto &api : apis) {
+        api->End();
+    }
+    idle.clear();
+    apis.clear();
+}
+
+tesseract::TessBaseAPI *Pool::acquire() noexcept {
+    std::unique_lock<std::mutex> lock(access);
+    if (apis.empty()) {
+        return nullptr;
+    }
+
+    if (!idle.empty()) {
+        auto api = idle.back();
+        idle.pop_back();
+        return api;
+    }
+
+    /* All APIs are busy: create another one with the same settings, which
+     * takes long enough for not holding the lock meanwhile */
+    lock.unlock();
+    int  error = 0;
+    auto api   = create(error);
+    if (!api) {
+        return nullptr;
+    }
+
+    lock.lock();
+    auto borrowed = api.get();
+    apis.emplace_back(std::move(api));
+
+    return borrowed;
+}
+
+void Pool::release(tesseract::TessBaseAPI *api) noexcept {
+    std::lock_guard<std::mutex> lock(access);
+    idle.push_back(api);
+}
+
+Tesseracts::Reading::Reading(const int mode, Pool &p, Cache &c,
+                             Frontend &f) noexcept 
+    : Parent(mode), minimal(0.0f), pool(p), cache(c), frontend(f) {}
+
+Error::Type Tesseracts::Reading::process(Zone &zone, Scene &scene) noexcept {
+    cv::Mat text = scene.view.gray().input()(zone);
+
+    /* Reuse the text of a similar crop if any */
+    auto h = Cache::hash(text);
+    if (cache.recall(text, h, zone.description)) {
+        return Error::NONE;
+    }
+
+    auto tess = pool.acquire();
+    if (tess == nullptr) {
+        LOGE("%s[%s]::process(): No Tesseract OCR available",
+             value_to_string().c_str(), name().c_str());
+        return Error::NOT_READY;
+    }
+
+    readUTF8Text(*tess, frontend.crop(zone), minimal, zone.description);
+
+    pool.release(tess);
+    cache.store(text, h, zone.description);
+
+    return Error::NONE;
+}
+
+Tesseracts::Tesseracts() noexcept
+    : path(""), language(""), 
+      selection([](const Zone &) noexcept { return true; }), cache(),
+      preprocessing(), apis(),
+      reading(Reading::Mode::Async*8, apis, cache, preprocessing),
+      loading(), current_path(""),
+      current_language(""), current_oem(tesseract::OEM_COUNT),
+      current_psm(tesseract::PSM_COUNT) {
+
+        path.denominate("path")
+            .describe("The path for all Tesseract OCR configuration files")
+            .characterise(Customisation::Trait::CONFIGURABLE);
+        expose(path);
+
+        language.denominate("language")
+                .describe("The language for the Tesseract OCR")
+                .characterise(Customisation::Trait::CONFIGURABLE);
+        expose(language);
+
+        oem.denominate("oem")
+           .describe("Tesseract OCR Engine Mode")
+           .characterise(Customisation::Trait::CONFIGURABLE);
+        oem.range(0, tesseract::OEM_COUNT-1);
+        expose(oem);
+        oem = static_cast<int>(tesseract::OEM_LSTM_ONLY);
+
+        psm.denominate("psm")
+           .describe("Tesseract Page Segmentation Mode")
+           .characterise(Customisation::Trait::CONFIGURABLE);
+        psm.range(0, tesseract::PSM_COUNT-1);
+        expose(psm);
+        psm = static_cast<int>(tesseract::PSM_AUTO_OSD);
+
+        confidence.denominate("confidence")
+                  .describe("The minimal confidence of the words to keep")
+                  .characterise(Customisation::Trait::SETTABLE);
+        confidence.range(0.0f, 100.0f);
+        expose(confidence);
+        confidence = 0.0f;
+
+        cache.denominate("cache");
+        expose(cache);
+
+        preprocessing.denominate("preprocessing");
+        expose(preprocessing);
+
+        reading.denominate("reading");
+        expose(reading);
+}
+
+Tesseracts::~Tesseracts() noexcept {
+    loading.wait();
+}
+
+Customisation::Error Tesseracts::setup() noexcept {
+    /* Loading the language data concurrently with the other engines */
+    auto &startup = Util::Task::Startup::instance();
+    return static_cast<Customisation::Error>(
+        startup.run(loading, name(), [this]() noexcept {
+                        return static_cast<int>(instantiate()); }));
+}
+
+Customisation::Error Tesseracts::instantiate() noexcept {
+    auto req_oem = static_cast<tesseract::OcrEngineMode>(static_cast<int>(oem));
+    auto req_psm = static_cast<tesseract::PageSegMode>(static_cast<int>(psm));
+
+    if ( (!static_cast<std::string>(language).empty()) &&
+         (static_cast<std::string>(path) == current_path) &&
+         (static_cast<std::string>(language) == current_language) &&
+         (req_oem == current_oem) &&
+         (req_psm == current_psm) ) {
+        return Customisation::Error::NONE;
+    }
+
+    terminate();
+    auto error = apis.init(path, language, req_oem, req_psm);
+
+    if (error) {
+        LOGE("%s[%s]::setup(): Tesseract initialisation error %d",
+             value_to_string().c_str(), name().c_str(), error);
+        return Customisation::Error::INVALID_VALUE;
+    }
+
+    current_path     = path;
+    current_language = language;
+    current_oem      = req_oem;
+    current_psm      = req_psm;
+
+    return Customisation::Error::NONE;
+}
+
+Error::Type Tesseracts::process(Scene &scene, Zones &zones) noexcept {
+    Zones texts;
+    cv::Rect area;
+    for (auto &z : zones) {
+        if (selection(z)) {
+            texts.emplace_back(z);
+            area |= static_cast<const cv::Rect &>(z.get());
+        }
+    }
+
+    /* The zones to read are prepared at once, before reading them */
+    if (!texts.empty()) {
+        preprocessing.prepare(scene, area);
+    }
+
+    reading.minimal = static_cast<float>(confidence);
+    reading.start(texts, scene);
+    return reading.wait();
+}
+
+void Tesseracts::terminate() noexcept {
+    if (!current_language.empty()) {
+        current_language.clear();
+        current_path.clear();
+        apis.end();
+    }
+}
+
 }  // namespace OCR
 }  // namespace Engine
 }  // namespace VPP
@@ -22,12 +22,16 @@ namespace VPP {
 namespace Engine {
 namespace Overlay {
 
+/* The number of scenes whose deferred drawings are kept */
+static constexpr std::size_t BACKLOG = 8;
+
 static VPP::UI::Overlay::ZoneStyle 
     default_style(const VPP::Zone & /*zone*/, const ZoneStyle &base) noexcept {
     return base;
 }
 
-Logo::Logo() noexcept : Entity("Logo"), layer(), show(false), at() {
+Logo::Logo() noexcept
+    : Entity("Logo"), layer(), show(false), at(), reference(0) {
     /* Use the default VPP logo */
     layer.set({ VPP::Logo::width, VPP::Logo::height },
                 VPP::Logo::bgr, VPP::Logo::alpha);
@@ -41,10 +45,25 @@ Logo::Logo() noexcept : Entity("Logo"), layer(), show(false), at() {
     at.denominate("at")
       .describe("The relative location for the logo");
     expose(at);
+
+    reference.denominate("reference")
+             .describe("The frame height the logo is sized for, the logo "
+                       "being scaled to the frame height, or 0 for never "
+                       "scaling it")
+             .characterise(Customisation::Trait::CONFIGURABLE);
+    reference.range(0, 8192);
+    expose(reference);
+}
+
+LayerStyle Logo::style(const VPP::UI::Overlay &overlay) const noexcept {
+    auto s      = overlay.defaultLayerStyle;
+    s.reference = reference;
+    return s;
 }
 
 template <typename ...Z> Core<Z...>::Core() noexcept
-    : overlay(), style(), logo(), stylist(nullptr), styles() {
+    : overlay(), style(), logo(), stylist(nullptr), memoised(false),
+      styles(), classwise(), access(), drawings() {
     style.denominate("style")
          .describe("The style for displaying zone informations")
          .characterise(Customisation::Trait::CONFIGURABLE);
@@ -52,29 +71,131 @@ template <typename ...Z> Core<Z...>::Core() noexcept
                      return onStyleUpdate(s); });
     Customisation::Entity::expose(style);
 
-    define("default", default_style);
+    define("default", default_style, true);
     style = "default";
 
+    rendering.denominate("rendering")
+             .describe("The rendering of the overlay: either inline for "
+                       "drawing in the pipeline, deferred for letting the "
+                       "consumers render the captured drawings into their "
+                       "frames, or none for never drawing")
+             .characterise(Customisation::Trait::SETTABLE);
+    rendering.define({ { "inline",   static_cast<int>(Rendering::INLINE) },
+                       { "deferred", static_cast<int>(Rendering::DEFERRED) },
+                       { "none",     static_cast<int>(Rendering::NONE) } });
+    Customisation::Entity::expose(rendering);
+    rendering = static_cast<int>(Rendering::INLINE);
+
     logo.denominate("logo");
     Customisation::Entity::expose(logo);
 }
 
 template <typename ...Z> 
 Error::Type Core<Z...>::process(Scene &scene, Z&... /*z*/) noexcept {
+    switch (static_cast<Rendering>(static_cast<int>(rendering))) {
+        case Rendering::NONE:
+            return Error::NONE;
+        case Rendering::DEFERRED:
+            defer(scene);
+            return Error::NONE;
+        case Rendering::INLINE:
+        default:
+            break;
+    }
+
     /* Draw the scene */
     auto &bgr = scene.view.bgr();
     bgr.flush();
-    overlay.draw(bgr.drawable(), scene, *stylist);
+
+    /* Only copy the tiles of the drawable that are drawn in */
+    auto &frame = bgr.drawable(cv::Rect());
+    if (memoised) {
+        VPP::UI::Overlay::Styles memo(*stylist, overlay.defaultZoneStyle);
+        for (auto const &zone : scene.zones()) {
+            bgr.drawable(overlay.area(zone.get(), memo));
+        }
+        overlay.draw(frame, scene, memo);
+    } else {
+        for (auto const &zone : scene.zones()) {
+            bgr.drawable(overlay.area(zone.get(), *stylist));
+        }
+        overlay.draw(frame, scene, *stylist);
+    }
 
     if ( (!logo.layer.empty()) && (logo.show) ) {
-        overlay.draw(bgr.drawable(), logo.layer, logo.at);
+        auto ls = logo.style(overlay);
+        cv::Rect at(logo.at, logo.layer.size(frame.size(), ls));
+        if (at.x < 0) {
+            at.x += frame.cols - at.width;
+        }
+        if (at.y < 0) {
+            at.y += frame.rows - at.height;
+        }
+        overlay.draw(bgr.drawable(at), logo.layer, logo.at, ls);
     }
 
     return Error::NONE;
 }
 
 template <typename ...Z> 
-void Core<Z...>::define(std::string sname, ZoneStylist s) noexcept {
+Frame Core<Z...>::capture(const Scene &scene) const noexcept {
+    Frame f;
+    f.image = scene.view.cached(VPP::Image::Mode::BGR)->output().clone();
+
+    if (static_cast<int>(rendering) == static_cast<int>(Rendering::DEFERRED)) {
+        std::lock_guard<std::mutex> lock(access);
+        for (auto &d : drawings) {
+            if (d->ts == scene.ts_ms()) {
+                f.drawings = d;
+                break;
+            }
+        }
+    }
+
+    return f;
+}
+
+template <typename ...Z> 
+void Core<Z...>::render(Frame &frame) const noexcept {
+    if ( (frame.drawings == nullptr) || (frame.image.empty()) ) {
+        return;
+    }
+
+    overlay.draw(frame.image, frame.drawings->batch);
+    if (frame.drawings->logo) {
+        overlay.draw(frame.image, logo.layer, logo.at, logo.style(overlay));
+    }
+}
+
+template <typename ...Z> 
+void Core<Z...>::defer(const Scene &scene) noexcept {
+    auto d  = std::make_shared<Drawing>();
+    d->ts   = scene.ts_ms();
+    d->logo = (!logo.layer.empty()) && (logo.show);
+    if (memoised) {
+        VPP::UI::Overlay::Styles memo(*stylist, overlay.defaultZoneStyle);
+        overlay.collect(d->batch, scene, memo);
+    } else {
+        overlay.collect(d->batch, scene, *stylist);
+    }
+
+    /* The zone engines capture the same scene once per zone */
+    std::lock_guard<std::mutex> lock(access);
+    for (auto &k : drawings) {
+        if (k->ts == d->ts) {
+            k = std::move(d);
+            return;
+        }
+    }
+    drawings.emplace_back(std::move(d));
+    if (drawings.size() > BACKLOG) {
+        drawings.pop_front();
+    }
+}
+
+template <typename ...Z> 
+void Core<Z...>::define(std::string sname, ZoneStylist s,
+                        bool by_class) noexcept {
     auto found = styles.find(sname);
 
     if (found != styles.end()) {
@@ -86,6 +207,7 @@ void Core<Z...>::define(std::string sname, ZoneStylist s) noexcept {
     }
 
     styles.emplace(sname, std::move(s));
+    classwise[sname] = by_class;
     style.allow(std::move(sname));
 }
 
@@ -95,7 +217,8 @@ Customisation::Error Core<Z...>::onStyleUpdate(const std::string &s) noexcept {
            "%s[%s]::OnStyleUpdate(): Style '%s' is unknown!",
            Customisation::Entity::value_to_string().c_str(),
            Customisation::Entity::name().c_str(), s.c_str());
-    stylist = &styles[s];
+    stylist  = &styles[s];
+    memoised = classwise[s];
 
     return Customisation::Error::NONE;
 }
@@ -0,0 +1,107 @@
+/**
+ *
+ * @file      vpp/engine/publisher.cpp
+ *
+ * @brief     This is the VPP publisher engine implementation
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "vpp/log.hpp"
+#include "vpp/engine/publisher.hpp"
+
+namespace VPP {
+namespace Engine {
+
+Publisher::Publisher() noexcept : sink(), writer(), file() {
+    path.denominate("path")
+        .describe("The file or named pipe to append the scene messages to, "
+                  "if any")
+        .characterise(Customisation::Trait::CONFIGURABLE);
+    expose(path);
+
+    contours.denominate("contours")
+            .describe("Whether the zone contours are published")
+            .characterise(Customisation::Trait::SETTABLE);
+    contours.use(Customisation::Translator::BoolFormat::NO_YES);
+    expose(contours);
+    contours = false;
+
+    descriptions.denominate("descriptions")
+                .describe("Whether the zone descriptions are published")
+                .characterise(Customisation::Trait::SETTABLE);
+    descriptions.use(Customisation::Translator::BoolFormat::NO_YES);
+    expose(descriptions);
+    descriptions = true;
+}
+
+Customisation::Error Publisher::setup() noexcept {
+    terminate();
+
+    const std::string &target = path;
+    if (target.empty()) {
+        return Customisation::Error::NONE;
+    }
+
+    file.open(target, std::ios::binary | std::ios::app);
+    if (!file.is_open()) {
+        LOGE("%s[%s]::setup(): Cannot open '%s'!",
+             value_to_string().c_str(), name().c_str(), target.c_str());
+        return Customisation::Error::INVALID_VALUE;
+    }
+
+    return Customisation::Error::NONE;
+}
+
+Error::Type Publisher::process(Scene &scene) noexcept {
+    /* Nothing to serialise without anyone to publish to */
+    if ( (!file.is_open()) && (sink == nullptr) ) {
+        return Error::NONE;
+    }
+
+    uint16_t fields = 0;
+    if (contours) {
+        fields |= Wire::Field::CONTOURS;
+    }
+    if (descriptions) {
+        fields |= Wire::Field::DESCRIPTIONS;
+    }
+
+    /* The records carry the metric states, deprojected all at once */
+    scene.deproject();
+    writer.write(scene, fields);
+
+    if (sink != nullptr) {
+        sink(writer.data(), writer.size());
+    }
+
+    if (file.is_open()) {
+        file.write(reinterpret_cast<const char *>(writer.data()),
+                   writer.size());
+        file.flush();
+        if (!file.good()) {
+            LOGE("%s[%s]::process(): Cannot publish the scene!",
+                 value_to_string().c_str(), name().c_str());
+            return Error::INVALID_REQUEST;
+        }
+    }
+
+    return Error::NONE;
+}
+
+void Publisher::terminate() noexcept {
+    if (file.is_open()) {
+        file.close();
+    }
+    file.clear();
+}
+
+}  // namespace Engine
+}  // namespace VPP
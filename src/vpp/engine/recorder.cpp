@@ -0,0 +1,67 @@
+/**
+ *
+ * @file      vpp/engine/recorder.cpp
+ *
+ * @brief     This is the VPP recorder engine implementation
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "vpp/log.hpp"
+#include "vpp/engine/recorder.hpp"
+
+namespace VPP {
+namespace Engine {
+
+Recorder::Recorder() noexcept : recorder() {
+    path.denominate("path")
+        .describe("The recording to append the scenes to")
+        .characterise(Customisation::Trait::CONFIGURABLE);
+    expose(path);
+}
+
+Customisation::Error Recorder::setup() noexcept {
+    terminate();
+
+    const std::string &file = path;
+    if (file.empty()) {
+        return Customisation::Error::NONE;
+    }
+
+    if (recorder.open(file)) {
+        LOGE("%s[%s]::setup(): Cannot open recording '%s'!",
+             value_to_string().c_str(), name().c_str(), file.c_str());
+        return Customisation::Error::INVALID_VALUE;
+    }
+
+    return Customisation::Error::NONE;
+}
+
+Error::Type Recorder::process(Scene &scene) noexcept {
+    /* Nothing to record without any recording */
+    if (!recorder.opened()) {
+        return Error::NONE;
+    }
+
+    if (recorder.write(scene.view)) {
+        LOGE("%s[%s]::process(): Cannot record the scene!",
+             value_to_string().c_str(), name().c_str());
+        return Error::INVALID_REQUEST;
+    }
+
+    return Error::NONE;
+}
+
+void Recorder::terminate() noexcept {
+    recorder.close();
+}
+
+}  // namespace Engine
+}  // namespace VPP
@@ -0,0 +1,155 @@
+/**
+ *
+ * @file      vpp/engine/reid/gallery.cpp
+ *
+ * @brief     This is the VPP re-identification gallery implementation file
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+
+#include "vpp/engine/reid/gallery.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Reid {
+
+Gallery::Gallery() noexcept
+    : Customisation::Entity("Gallery"), access(), rows(), owners(), stamps(),
+      index(), staged(), probes(), a(), b() {
+    capacity.denominate("capacity")
+            .describe("The number of UUIDs whose embeddings are kept")
+            .characterise(Customisation::Trait::CONFIGURABLE);
+    capacity.range(16, 65536);
+    expose(capacity);
+    capacity = 1024;
+
+    momentum.denominate("momentum")
+            .describe("The weight of the former embedding of a UUID when "
+                      "folding a new one into it")
+            .characterise(Customisation::Trait::SETTABLE);
+    momentum.range(0.0f, 1.0f);
+    expose(momentum);
+    momentum = 0.9f;
+}
+
+Customisation::Error Gallery::setup() noexcept {
+    std::lock_guard<std::mutex> lock(access);
+    rows.release();
+    owners.clear();
+    stamps.clear();
+    index.clear();
+    staged.release();
+    probes.clear();
+
+    return Customisation::Error::NONE;
+}
+
+void Gallery::stage(const std::vector<const Zone *> &zones,
+                    const cv::Mat &embeddings) noexcept {
+    std::lock_guard<std::mutex> lock(access);
+    probes.clear();
+    if (embeddings.empty()) {
+        return;
+    }
+
+    /* The gallery is (re)allocated as soon as the embedding size is known */
+    if (rows.cols != embeddings.cols) {
+        rows.create(capacity, embeddings.cols, CV_32F);
+        owners.assign(rows.rows, 0);
+        stamps.assign(rows.rows, 0);
+        index.clear();
+    }
+
+    embeddings.copyTo(staged);
+    for (std::size_t i = 0; i < zones.size(); ++i) {
+        probes.emplace(zones[i], static_cast<int>(i));
+    }
+}
+
+void Gallery::commit(const Scene &scene) noexcept {
+    std::lock_guard<std::mutex> lock(access);
+    if (probes.empty()) {
+        return;
+    }
+
+    const float kept = momentum;
+    for (auto &z : scene.zones()) {
+        const Zone &zone = z.get();
+        auto probe = probes.find(&zone);
+        if ( (probe == probes.end()) || (zone.uuid == 0) ) {
+            continue;
+        }
+
+        auto fresh = staged.row(probe->second);
+        auto found = index.find(zone.uuid);
+        if (found != index.end()) {
+            /* Fold the new embedding into the former one */
+            auto row = rows.row(found->second);
+            cv::addWeighted(row, kept, fresh, 1.0f - kept, 0.0, row);
+            cv::normalize(row, row);
+            stamps[found->second] = scene.ts_ms();
+            continue;
+        }
+
+        /* Otherwise replace the least recently seen UUID */
+        auto oldest = static_cast<int>(std::min_element(stamps.begin(),
+                                                        stamps.end()) -
+                                       stamps.begin());
+        if (owners[oldest] != 0) {
+            index.erase(owners[oldest]);
+        }
+        fresh.copyTo(rows.row(oldest));
+        owners[oldest] = zone.uuid;
+        stamps[oldest] = std::max<uint64_t>(scene.ts_ms(), 1);
+        index.emplace(zone.uuid, oldest);
+    }
+
+    /* The staged zones are about to be recycled */
+    probes.clear();
+}
+
+float Gallery::similarity(const VPP::Tracker::Context &one,
+                          const VPP::Tracker::Context &other) noexcept {
+    std::lock_guard<std::mutex> lock(access);
+    auto e1 = embedding(one);
+    auto e2 = embedding(other);
+    if ( (e1 == nullptr) || (e2 == nullptr) ) {
+        return 0.0f;
+    }
+
+    float dot = 0.0f;
+    for (int i = 0; i < rows.cols; ++i) {
+        dot += e1[i] * e2[i];
+    }
+    return dot;
+}
+
+const float *Gallery::embedding(const VPP::Tracker::Context &c)
+    const noexcept {
+    if (c.original != nullptr) {
+        auto probe = probes.find(c.original);
+        if (probe != probes.end()) {
+            return staged.ptr<float>(probe->second);
+        }
+    }
+
+    auto found = index.find(c.uuid);
+    if (found != index.end()) {
+        return rows.ptr<float>(found->second);
+    }
+
+    return nullptr;
+}
+
+}  // namespace Reid
+}  // namespace Engine
+}  // namespace VPP
@@ -0,0 +1,90 @@
+/**
+ *
+ * @file      vpp/engine/reid/ocv.cpp
+ *
+ * @brief     This is the VPP OCV DNN re-identification implementation file
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+
+#include "vpp/log.hpp"
+#include "vpp/engine/reid/ocv.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Reid {
+
+OCV::OCV(Gallery &g) noexcept : batch(32), gallery(g) {
+    batch.denominate("batch")
+         .describe("The maximal number of zones embedded in a single "
+                   "forward pass")
+         .characterise(Customisation::Trait::CONFIGURABLE);
+    batch.range(1, 256);
+    Customisation::Entity::expose(batch);
+}
+
+OCV::~OCV() noexcept = default;
+
+Error::Type OCV::process(Scene &scene) noexcept {
+    const cv::Mat &input = scene.view.bgr().input();
+    const cv::Rect frame(0, 0, input.cols, input.rows);
+    auto sz = static_cast<cv::Size>(size);
+
+    /* Only the zones lying (partly) within the frame can be embedded */
+    std::vector<const Zone *> zones;
+    std::vector<cv::Mat>      crops;
+    for (auto &z : scene.zones()) {
+        const Zone &zone = z.get();
+        cv::Rect roi = zone;
+        roi &= frame;
+        if (roi.area() > 0) {
+            zones.push_back(&zone);
+            crops.emplace_back(input(roi));
+        }
+    }
+
+    const int total = static_cast<int>(crops.size());
+    const int most  = batch;
+    cv::Mat embeddings;
+    for (int first = 0; first < total; first += most) {
+        int n = std::min(most, total - first);
+        std::vector<cv::Mat> some(crops.begin() + first,
+                                  crops.begin() + first + n);
+        cv::Mat blob, output;
+        cv::dnn::blobFromImages(some, blob, scale, sz, offset, RGB, false);
+
+        /* Infer the whole batch at once on the (shared) network */
+        {
+            auto lock = reserve();
+            net.setInput(blob);
+            Util::Timing timing(inference);
+            output = net.forward();
+        }
+
+        /* One L2-normalised embedding per zone */
+        cv::Mat rows = output.reshape(1, n);
+        for (int i = 0; i < n; ++i) {
+            auto row = rows.row(i);
+            cv::normalize(row, row);
+        }
+        embeddings.push_back(rows);
+    }
+
+    gallery.stage(zones, embeddings);
+
+    return Error::NONE;
+}
+
+}  // namespace Reid
+}  // namespace Engine
+}  // namespace VPP
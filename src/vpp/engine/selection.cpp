@@ -0,0 +1,182 @@
+/**
+ *
+ * @file      vpp/engine/selection.cpp
+ *
+ * @brief     These are the VPP engines selecting the zones to process
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <cmath>
+
+#include "vpp/log.hpp"
+#include "vpp/engine/selection.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Selection {
+
+Utility::Utility() noexcept 
+    : costing(), deferred(0), selected(), ranks(), kept(), exported(0) {
+    size.denominate("size")
+        .describe("The weight of the zone size relative to the frame")
+        .characterise(Customisation::Trait::SETTABLE);
+    size.range(0.0f, 10.0f);
+    expose(size);
+    size = 1.0f;
+
+    score.denominate("score")
+         .describe("The weight of the zone detection score")
+         .characterise(Customisation::Trait::SETTABLE);
+    score.range(0.0f, 10.0f);
+    expose(score);
+    score = 1.0f;
+
+    staleness.denominate("staleness")
+             .describe("The weight of the time since the zone was last "
+                       "selected")
+             .characterise(Customisation::Trait::SETTABLE);
+    staleness.range(0.0f, 10.0f);
+    expose(staleness);
+    staleness = 2.0f;
+
+    centrality.denominate("centrality")
+              .describe("The weight of the zone closeness to the frame "
+                        "centre")
+              .characterise(Customisation::Trait::SETTABLE);
+    centrality.range(0.0f, 10.0f);
+    expose(centrality);
+    centrality = 0.5f;
+
+    horizon.denominate("horizon")
+           .describe("The time in milliseconds after which a zone not "
+                     "selected is fully stale")
+           .characterise(Customisation::Trait::SETTABLE);
+    horizon.range(1, 60000);
+    expose(horizon);
+    horizon = 2000;
+
+    most.denominate("most")
+        .describe("The maximal number of zones kept (0 for no limit)")
+        .characterise(Customisation::Trait::SETTABLE);
+    most.range(0, 1024);
+    expose(most);
+    most = 8;
+
+    budget.denominate("budget")
+          .describe("The time budget in milliseconds the kept zones shall "
+                    "be processed in (0 for no budget)")
+          .characterise(Customisation::Trait::SETTABLE);
+    budget.range(0, 10000);
+    expose(budget);
+    budget = 0;
+
+    exported = Util::Metrics::Registry::instance().attach(
+        [this](Util::Metrics::Exposition &e) {
+            e.counter("vpp_selection_deferred_total",
+                      "Zones deferred to the next scenes",
+                      "engine=" + Util::Metrics::Exposition::quote(name()),
+                      deferred.load(std::memory_order_relaxed)); });
+}
+
+Utility::~Utility() noexcept {
+    Util::Metrics::Registry::instance().detach(exported);
+}
+
+Customisation::Error Utility::setup() noexcept {
+    selected.clear();
+
+    return Customisation::Error::NONE;
+}
+
+float Utility::utility(const Scene &scene, const Zone &z) const noexcept {
+    const auto &frame = scene.view.frame();
+    auto area = static_cast<float>(std::max(1, frame.area()));
+
+    /* All the terms are in [0, 1] */
+    auto coverage = std::sqrt(std::min(1.0f, z.area() / area));
+    auto detected = std::min(1.0f, std::max(0.0f, z.context.score));
+
+    auto stale = 1.0f;
+    auto found = selected.find(z.uuid);
+    if (found != selected.end()) {
+        auto age = (scene.ts_ms() > found->second) ? 
+                       scene.ts_ms() - found->second : 0;
+        stale = std::min(1.0f, static_cast<float>(age) / horizon);
+    }
+
+    auto dx = (z.x + z.width * 0.5f) - (frame.x + frame.width * 0.5f);
+    auto dy = (z.y + z.height * 0.5f) - (frame.y + frame.height * 0.5f);
+    auto half = 0.5f * std::sqrt(static_cast<float>(frame.width) * frame.width
+                                 + static_cast<float>(frame.height) * 
+                                   frame.height);
+    auto central = (half > 0.0f) ? 
+                       std::max(0.0f, 1.0f - std::sqrt(dx*dx + dy*dy) / half) :
+                       1.0f;
+
+    return size * coverage + score * detected + staleness * stale +
+           centrality * central;
+}
+
+Error::Type Utility::process(Scene &scene, Zones &zones) noexcept {
+    /* As many zones as fit in the budget, if their cost is known */
+    std::size_t count = zones.size();
+    int limit = most;
+    if (limit > 0) {
+        count = std::min(count, static_cast<std::size_t>(limit));
+    }
+    int allowed = budget;
+    auto cost   = ( (allowed > 0) && (costing) ) ? costing() : 0;
+    if (cost > 0) {
+        auto fit = static_cast<std::size_t>(allowed * 1000000ull / cost);
+        count = std::min(count, std::max<std::size_t>(1, fit));
+    }
+
+    if (count < zones.size()) {
+        ranks.clear();
+        for (std::size_t i = 0; i < zones.size(); ++i) {
+            ranks.emplace_back(utility(scene, zones[i]), i);
+        }
+        std::partial_sort(ranks.begin(), ranks.begin() + count, ranks.end(),
+                          [](const std::pair<float, std::size_t> &a,
+                             const std::pair<float, std::size_t> &b) {
+                              return a.first > b.first; });
+
+        kept.clear();
+        for (std::size_t i = 0; i < count; ++i) {
+            kept.emplace_back(zones[ranks[i].second]);
+        }
+        deferred.fetch_add(zones.size() - count, std::memory_order_relaxed);
+        zones.swap(kept);
+    }
+
+    for (auto &z : zones) {
+        selected[z.get().uuid] = scene.ts_ms();
+    }
+
+    /* Forgetting the zones gone for long */
+    if (selected.size() > 4 * zones.size() + 256) {
+        auto oldest = static_cast<uint64_t>(static_cast<int>(horizon)) * 4;
+        for (auto s = selected.begin(); s != selected.end(); ) {
+            if (scene.ts_ms() > s->second + oldest) {
+                s = selected.erase(s);
+            } else {
+                ++s;
+            }
+        }
+    }
+
+    return Error::NONE;
+}
+
+}  // namespace Selection
+}  // namespace Engine
+}  // namespace VPP
@@ -0,0 +1,123 @@
+/**
+ *
+ * @file      vpp/engine/sharing.cpp
+ *
+ * @brief     This is the VPP sharing engine implementation
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "vpp/log.hpp"
+#include "vpp/engine/sharing.hpp"
+
+namespace VPP {
+namespace Engine {
+
+Sharing::Sharing() noexcept : ring(), writer(), oversized(false) {
+    path.denominate("path")
+        .describe("The shared-memory ring file, e.g. in /dev/shm, or empty "
+                  "for not sharing the scenes")
+        .characterise(Customisation::Trait::CONFIGURABLE);
+    expose(path);
+
+    slots.denominate("slots")
+         .describe("The number of frames kept in the ring, i.e. how late the "
+                   "taps may be before their frames get recycled")
+         .characterise(Customisation::Trait::CONFIGURABLE);
+    slots.range(2, 64);
+    expose(slots);
+    slots = 4;
+
+    size.denominate("size")
+        .describe("The size of a ring slot in megabytes, the larger frames "
+                  "being not shared")
+        .characterise(Customisation::Trait::CONFIGURABLE);
+    size.range(1, 256);
+    expose(size);
+    size = 8;
+
+    contours.denominate("contours")
+            .describe("Whether the zone contours are shared")
+            .characterise(Customisation::Trait::SETTABLE);
+    contours.use(Customisation::Translator::BoolFormat::NO_YES);
+    expose(contours);
+    contours = false;
+
+    descriptions.denominate("descriptions")
+                .describe("Whether the zone descriptions are shared")
+                .characterise(Customisation::Trait::SETTABLE);
+    descriptions.use(Customisation::Translator::BoolFormat::NO_YES);
+    expose(descriptions);
+    descriptions = true;
+}
+
+Customisation::Error Sharing::setup() noexcept {
+    terminate();
+
+    const std::string &file = path;
+    if (file.empty()) {
+        return Customisation::Error::NONE;
+    }
+
+    const std::size_t bytes = static_cast<std::size_t>(size) << 20;
+    if (ring.open(file, slots, bytes)) {
+        LOGE("%s[%s]::setup(): Cannot create the ring '%s'!",
+             value_to_string().c_str(), name().c_str(), file.c_str());
+        return Customisation::Error::INVALID_VALUE;
+    }
+
+    return Customisation::Error::NONE;
+}
+
+Error::Type Sharing::process(Scene &scene) noexcept {
+    /* Nothing to share without any ring */
+    if (!ring.opened()) {
+        return Error::NONE;
+    }
+
+    uint16_t fields = 0;
+    if (contours) {
+        fields |= Wire::Field::CONTOURS;
+    }
+    if (descriptions) {
+        fields |= Wire::Field::DESCRIPTIONS;
+    }
+
+    /* The records carry the metric states, deprojected all at once */
+    scene.deproject();
+    writer.write(scene, fields);
+
+    auto bgr = scene.view.cached(VPP::Image::Mode::BGR);
+    cv::Mat frame;
+    if (bgr != nullptr) {
+        frame = bgr->output();
+    }
+
+    if (ring.write(scene.ts_ms(), frame, writer.data(), writer.size())) {
+        /* Only complain once about the frames not fitting in the slots */
+        if (!oversized) {
+            LOGE("%s[%s]::process(): The %dx%d frames do not fit in the "
+                 "ring slots!", value_to_string().c_str(), name().c_str(),
+                 frame.cols, frame.rows);
+            oversized = true;
+        }
+        return Error::NONE;
+    }
+
+    return Error::NONE;
+}
+
+void Sharing::terminate() noexcept {
+    ring.close();
+    oversized = false;
+}
+
+}  // namespace Engine
+}  // namespace VPP
@@ -0,0 +1,144 @@
+/**
+ *
+ * @file      vpp/engine/stillness.cpp
+ *
+ * @brief     These are the VPP engines detecting the still scenes
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <opencv2/imgproc.hpp>
+
+#include "vpp/log.hpp"
+#include "vpp/engine/stillness.hpp"
+
+namespace VPP {
+namespace Engine {
+namespace Stillness {
+
+/* The 9x8 thumbnail of a difference hash gives 8 bits per row */
+static const cv::Size HASHED(9, 8);
+
+static uint64_t dhash(const cv::Mat &thumbnail) noexcept {
+    uint64_t h = 0;
+    for (int y = 0; y < thumbnail.rows; ++y) {
+        auto row = thumbnail.ptr<uchar>(y);
+        for (int x = 0; x + 1 < thumbnail.cols; ++x) {
+            h = (h << 1) | ((row[x] < row[x+1]) ? 1 : 0);
+        }
+    }
+    return h;
+}
+
+static int popcount(uint64_t v) noexcept {
+    int n = 0;
+    for (; v != 0; v &= v - 1) {
+        ++n;
+    }
+    return n;
+}
+
+Difference::Difference() noexcept 
+    : skipped(0), reference(), hash(0), successive(0), exported(0) {
+    method.denominate("method")
+          .describe("The comparison of the thumbnails: either sad for their "
+                    "mean absolute difference, or hash for their difference "
+                    "hashes")
+          .characterise(Customisation::Trait::SETTABLE);
+    method.define({ { "sad",  static_cast<int>(Method::SAD) },
+                    { "hash", static_cast<int>(Method::HASH) } });
+    expose(method);
+    method = static_cast<int>(Method::SAD);
+
+    side.denominate("side")
+        .describe("The side in pixels of the gray thumbnails compared by the "
+                  "sad method")
+        .characterise(Customisation::Trait::SETTABLE);
+    side.range(8, 128);
+    expose(side);
+    side = 32;
+
+    threshold.denominate("threshold")
+             .describe("The change between two thumbnails, in [0, 1], below "
+                       "which a scene is still")
+             .characterise(Customisation::Trait::SETTABLE);
+    threshold.range(0.0f, 1.0f);
+    expose(threshold);
+    threshold = 0.01f;
+
+    longest.denominate("longest")
+           .describe("The maximal number of successive still scenes, before "
+                     "processing a scene again")
+           .characterise(Customisation::Trait::SETTABLE);
+    longest.range(1, 10000);
+    expose(longest);
+    longest = 30;
+
+    exported = Util::Metrics::Registry::instance().attach(
+        [this](Util::Metrics::Exposition &e) {
+            e.counter("vpp_still_scenes_total",
+                      "Scenes reusing the results of the previous ones",
+                      "engine=" + Util::Metrics::Exposition::quote(name()),
+                      skipped.load(std::memory_order_relaxed)); });
+}
+
+Difference::~Difference() noexcept {
+    Util::Metrics::Registry::instance().detach(exported);
+}
+
+Customisation::Error Difference::setup() noexcept {
+    reference  = cv::Mat();
+    hash       = 0;
+    successive = 0;
+
+    return Customisation::Error::NONE;
+}
+
+Error::Type Difference::process(Scene &scene) noexcept {
+    /* Starting from the smallest shared downscaled gray image */
+    bool hashing = (static_cast<Method>(static_cast<int>(method)) == 
+                    Method::HASH);
+    cv::Size thumb = hashing ? HASHED : cv::Size(side, side);
+    const auto &gray = scene.view.pyramid(Image::Mode::GRAY).fitting(thumb);
+    if (gray.empty()) {
+        return Error::NONE;
+    }
+
+    cv::Mat thumbnail;
+    cv::resize(gray, thumbnail, thumb, 0, 0, cv::INTER_AREA);
+    uint64_t h = hashing ? dhash(thumbnail) : 0;
+
+    float change = 1.0f;
+    if ( (!reference.empty()) && (reference.size() == thumbnail.size()) ) {
+        change = hashing ? 
+            popcount(h ^ hash) / 64.0f :
+            static_cast<float>(cv::norm(thumbnail, reference, cv::NORM_L1) /
+                               (thumbnail.total() * 255.0));
+    }
+
+    /* Still scenes are compared with the last processed one, for a slow
+     * drift not to go unnoticed */
+    bool still = (change < threshold) && (successive < longest);
+    if (still) {
+        ++successive;
+        skipped.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        successive = 0;
+        reference  = thumbnail;
+        hash       = h;
+    }
+    scene.still(still);
+
+    return Error::NONE;
+}
+
+}  // namespace Stillness
+}  // namespace Engine
+}  // namespace VPP
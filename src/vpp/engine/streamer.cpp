@@ -0,0 +1,377 @@
+/**
+ *
+ * @file      vpp/engine/streamer.cpp
+ *
+ * @brief     This is the VPP streamer engine implementation
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "vpp/log.hpp"
+#include "vpp/engine/streamer.hpp"
+#include "vpp/util/io/socket.hpp"
+
+namespace VPP {
+namespace Engine {
+
+/* How long the server waits for an event before checking its status */
+static const int POLLING_MS = 200;
+
+/* How long a client may block the stream before being dropped */
+static const int SENDING_MS = 500;
+
+static const char BOUNDARY[] = "vppframe";
+
+static bool send_all(int client, const void *data, std::size_t size) noexcept {
+    auto p = static_cast<const char *>(data);
+    while (size > 0) {
+        auto sent = send(client, p, size, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        p    += sent;
+        size -= static_cast<std::size_t>(sent);
+    }
+    return true;
+}
+
+static Streamer::Renderer copy_output(const Scene &scene) noexcept {
+    auto bgr = scene.view.cached(VPP::Image::Mode::BGR);
+    cv::Mat frame;
+    if (bgr != nullptr) {
+        frame = bgr->output().clone();
+    }
+    return [frame]() noexcept { return frame; };
+}
+
+Streamer::Streamer() noexcept
+    : capture(copy_output), encoding(), frames(0), serving(false), server(),
+      listener(-1), wakeup{-1, -1}, access(), pending(), latest(0),
+      viewers(), connected(0), exported(0) {
+    port.denominate("port")
+        .describe("The TCP port serving the Motion JPEG stream on "
+                  "'GET /stream', or 0 for not serving it")
+        .characterise(Customisation::Trait::CONFIGURABLE);
+    port.range(0, 65535);
+    expose(port);
+    port = 0;
+
+    quality.denominate("quality")
+           .describe("The JPEG quality of the streamed frames")
+           .characterise(Customisation::Trait::SETTABLE);
+    quality.range(1, 100);
+    expose(quality);
+    quality = 75;
+
+    fps.denominate("fps")
+       .describe("The maximal frame rate of the stream, or 0 for streaming "
+                 "all the frames")
+       .characterise(Customisation::Trait::SETTABLE);
+    fps.range(0.0f, 120.0f);
+    expose(fps);
+    fps = 15.0f;
+
+    width.denominate("width")
+         .describe("The maximal width of the streamed frames, the wider "
+                   "ones being scaled down, or 0 for never scaling them")
+         .characterise(Customisation::Trait::SETTABLE);
+    width.range(0, 8192);
+    expose(width);
+    width = 1280;
+
+    clients.denominate("clients")
+           .describe("The maximal number of clients of the stream")
+           .characterise(Customisation::Trait::CONFIGURABLE);
+    clients.range(1, 64);
+    expose(clients);
+    clients = 8;
+
+    exported = Util::Metrics::Registry::instance().attach(
+        [this](Util::Metrics::Exposition &e) {
+            auto labels = "engine=" +
+                          Util::Metrics::Exposition::quote(name());
+            e.gauge("vpp_streamer_clients", "Clients of the stream", labels,
+                    connected.load(std::memory_order_relaxed));
+            e.counter("vpp_streamer_frames_total", "Frames streamed",
+                      labels, frames.load(std::memory_order_relaxed));
+            e.summary("vpp_streamer_encoding_seconds",
+                      "Rendering and encoding latency of the frames",
+                      labels, encoding); });
+}
+
+Streamer::~Streamer() noexcept {
+    stop();
+    Util::Metrics::Registry::instance().detach(exported);
+}
+
+Customisation::Error Streamer::setup() noexcept {
+    stop();
+
+    const int p = port;
+    if (p == 0) {
+        return Customisation::Error::NONE;
+    }
+
+    if (pipe(wakeup) < 0) {
+        LOGE("%s[%s]::setup(): Cannot create a pipe: %s!",
+             value_to_string().c_str(), name().c_str(), strerror(errno));
+        stop();
+        return Customisation::Error::INVALID_VALUE;
+    }
+    fcntl(wakeup[1], F_SETFL, fcntl(wakeup[1], F_GETFL) | O_NONBLOCK);
+
+    listener = Util::IO::Socket::listening(p, 4);
+    if (listener < 0) {
+        LOGE("%s[%s]::setup(): Cannot listen on port %d: %s!",
+             value_to_string().c_str(), name().c_str(), p, strerror(errno));
+        stop();
+        return Customisation::Error::INVALID_VALUE;
+    }
+
+    serving = true;
+    server  = std::thread([this]() { serve(); });
+
+    return Customisation::Error::NONE;
+}
+
+Error::Type Streamer::process(Scene &scene) noexcept {
+    /* Nothing is captured without any client */
+    if (connected.load(std::memory_order_relaxed) == 0) {
+        return Error::NONE;
+    }
+
+    /* Only capture the frames within the frame rate cap */
+    const float rate = fps;
+    if ( (rate > 0.0f) && (latest != 0) &&
+         (scene.ts_ms() < latest + static_cast<uint64_t>(1000.0f / rate)) ) {
+        return Error::NONE;
+    }
+
+    auto renderer = capture(scene);
+    {
+        std::lock_guard<std::mutex> lock(access);
+        pending = std::move(renderer);
+        latest  = scene.ts_ms();
+    }
+
+    /* Wake the server up, a full pipe meaning that it is already awake */
+    const char frame = 1;
+    if (write(wakeup[1], &frame, 1) < 0) {
+        return Error::NONE;
+    }
+
+    return Error::NONE;
+}
+
+void Streamer::terminate() noexcept {
+    stop();
+}
+
+void Streamer::stop() noexcept {
+    serving = false;
+    if (server.joinable()) {
+        server.join();
+    }
+
+    for (auto v : viewers) {
+        close(v);
+    }
+    viewers.clear();
+    connected = 0;
+
+    for (auto &fd : wakeup) {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (listener >= 0) {
+        close(listener);
+        listener = -1;
+    }
+
+    std::lock_guard<std::mutex> lock(access);
+    pending = nullptr;
+    latest  = 0;
+}
+
+void Streamer::admit(int client) noexcept {
+    auto request = Util::IO::Socket::requested(client, POLLING_MS * 5);
+    if (request.empty()) {
+        close(client);
+        return;
+    }
+
+    if (request != "GET /stream") {
+        static const char missing[] = "HTTP/1.0 404 Not Found\r\n"
+                                      "Content-Type: text/plain\r\n"
+                                      "Connection: close\r\n\r\n"
+                                      "Not found\n";
+        send_all(client, missing, sizeof(missing) - 1);
+        close(client);
+        return;
+    }
+
+    if (static_cast<int>(viewers.size()) >= static_cast<int>(clients)) {
+        static const char busy[] = "HTTP/1.0 503 Service Unavailable\r\n"
+                                   "Content-Type: text/plain\r\n"
+                                   "Connection: close\r\n\r\n"
+                                   "Too many clients\n";
+        send_all(client, busy, sizeof(busy) - 1);
+        close(client);
+        return;
+    }
+
+    /* A stalled client shall never stall the stream for long */
+    struct timeval timeout;
+    timeout.tv_sec  = SENDING_MS / 1000;
+    timeout.tv_usec = (SENDING_MS % 1000) * 1000;
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string header("HTTP/1.0 200 OK\r\n"
+                       "Cache-Control: no-cache\r\n"
+                       "Pragma: no-cache\r\n"
+                       "Connection: close\r\n"
+                       "Content-Type: multipart/x-mixed-replace; boundary=");
+    header += BOUNDARY;
+    header += "\r\n\r\n";
+    if (!send_all(client, header.data(), header.size())) {
+        close(client);
+        return;
+    }
+
+    viewers.push_back(client);
+    connected = static_cast<int>(viewers.size());
+}
+
+void Streamer::broadcast(const std::vector<uint8_t> &jpeg) noexcept {
+    std::string part("--");
+    part += BOUNDARY;
+    part += "\r\nContent-Type: image/jpeg\r\nContent-Length: ";
+    part += std::to_string(jpeg.size());
+    part += "\r\n\r\n";
+
+    for (auto v = viewers.begin(); v != viewers.end(); ) {
+        if ( (send_all(*v, part.data(), part.size())) &&
+             (send_all(*v, jpeg.data(), jpeg.size())) &&
+             (send_all(*v, "\r\n", 2)) ) {
+            ++v;
+        } else {
+            close(*v);
+            v = viewers.erase(v);
+        }
+    }
+    connected = static_cast<int>(viewers.size());
+}
+
+void Streamer::serve() noexcept {
+    std::vector<struct pollfd> waiting;
+    std::vector<uint8_t>       jpeg;
+    cv::Mat                    scaled;
+
+    while (serving) {
+        waiting.resize(2 + viewers.size());
+        waiting[0].fd     = listener;
+        waiting[0].events = POLLIN;
+        waiting[1].fd     = wakeup[0];
+        waiting[1].events = POLLIN;
+        for (std::size_t i = 0; i < viewers.size(); ++i) {
+            waiting[2 + i].fd     = viewers[i];
+            waiting[2 + i].events = POLLIN;
+        }
+        for (auto &w : waiting) {
+            w.revents = 0;
+        }
+
+        if (poll(waiting.data(), waiting.size(), POLLING_MS) <= 0) {
+            continue;
+        }
+
+        /* Drop the clients hanging up, their requests being ignored */
+        for (std::size_t i = viewers.size(); i > 0; --i) {
+            auto &w = waiting[1 + i];
+            if (w.revents == 0) {
+                continue;
+            }
+            char ignored[256];
+            if ( ((w.revents & POLLIN) == 0) ||
+                 (recv(w.fd, ignored, sizeof(ignored), 0) <= 0) ) {
+                close(w.fd);
+                viewers.erase(viewers.begin() + (i - 1));
+            }
+        }
+        connected = static_cast<int>(viewers.size());
+
+        if (waiting[0].revents & POLLIN) {
+            auto client = accept(listener, nullptr, nullptr);
+            if (client >= 0) {
+                admit(client);
+            }
+        }
+
+        if ((waiting[1].revents & POLLIN) == 0) {
+            continue;
+        }
+        char drained[64];
+        if (read(wakeup[0], drained, sizeof(drained)) < 0) {
+            continue;
+        }
+
+        Renderer renderer;
+        {
+            std::lock_guard<std::mutex> lock(access);
+            renderer = std::move(pending);
+            pending  = nullptr;
+        }
+        if ( (renderer == nullptr) || (viewers.empty()) ) {
+            continue;
+        }
+
+        /* Render, scale down and encode the frame once for all the clients */
+        {
+            Util::Timing timing(encoding);
+            cv::Mat frame = renderer();
+            if (frame.empty()) {
+                continue;
+            }
+
+            const int most = width;
+            if ( (most > 0) && (frame.cols > most) ) {
+                cv::resize(frame, scaled,
+                           cv::Size(most, (frame.rows * most) / frame.cols),
+                           0, 0, cv::INTER_AREA);
+                frame = scaled;
+            }
+
+            const std::vector<int> options = { cv::IMWRITE_JPEG_QUALITY,
+                                               static_cast<int>(quality) };
+            if (!cv::imencode(".jpg", frame, jpeg, options)) {
+                continue;
+            }
+        }
+
+        broadcast(jpeg);
+        frames.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+}  // namespace Engine
+}  // namespace VPP
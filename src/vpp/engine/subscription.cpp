@@ -0,0 +1,234 @@
+/**
+ *
+ * @file      vpp/engine/subscription.cpp
+ *
+ * @brief     This is the VPP subscription engine implementation
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+
+#include "vpp/engine/subscription.hpp"
+
+namespace VPP {
+namespace Engine {
+
+/* The time in milliseconds a subscription waits for a frame, before letting
+ * its pipeline retry */
+static constexpr int WAITING = 100;
+
+Channel::Queue::Queue() noexcept
+    : received(0), dropped(0), depth(1), policy(Policy::DROP_OLDEST),
+      frames(), closed(true), access(), pushed(), popped() {}
+
+void Channel::Queue::reset(int d, Policy p) noexcept {
+    /* Inside a lock_guard scoped block */
+    {
+        std::lock_guard<std::mutex> lock(access);
+        frames.clear();
+        depth  = static_cast<std::size_t>(std::max(d, 1));
+        policy = p;
+        closed = false;
+    }
+    popped.notify_all();
+}
+
+void Channel::Queue::push(const Frame &frame) noexcept {
+    std::unique_lock<std::mutex> lock(access);
+    if (policy == Policy::BLOCK) {
+        popped.wait(lock, [this]() {
+                        return closed || (frames.size() < depth); });
+    }
+    if (closed) {
+        return;
+    }
+
+    if (frames.size() >= depth) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        if (policy == Policy::DROP_NEWEST) {
+            return;
+        }
+        frames.pop_front();
+    }
+    frames.push_back(frame);
+    received.fetch_add(1, std::memory_order_relaxed);
+    lock.unlock();
+    pushed.notify_one();
+}
+
+Channel::Frame Channel::Queue::pop(int ms) noexcept {
+    std::unique_lock<std::mutex> lock(access);
+    pushed.wait_for(lock, std::chrono::milliseconds(ms), [this]() {
+                        return closed || (!frames.empty()); });
+    if (frames.empty()) {
+        return nullptr;
+    }
+
+    Frame frame(std::move(frames.front()));
+    frames.pop_front();
+    lock.unlock();
+    popped.notify_one();
+
+    return frame;
+}
+
+void Channel::Queue::close() noexcept {
+    /* Inside a lock_guard scoped block */
+    {
+        std::lock_guard<std::mutex> lock(access);
+        frames.clear();
+        closed = true;
+    }
+    pushed.notify_all();
+    popped.notify_all();
+}
+
+Channel::Channel() noexcept : access(), queues() {}
+
+std::shared_ptr<Channel> Channel::share(const std::string &name) noexcept {
+    static std::mutex                                     registry;
+    static std::map<std::string, std::weak_ptr<Channel>> channels;
+
+    std::lock_guard<std::mutex> lock(registry);
+    auto &known = channels[name];
+    auto  found = known.lock();
+    if (found == nullptr) {
+        found = std::make_shared<Channel>();
+        known = found;
+    }
+
+    return found;
+}
+
+void Channel::publish(const View &view) noexcept {
+    std::vector<std::shared_ptr<Queue>> subscribed;
+
+    /* Inside a lock_guard scoped block */
+    {
+        std::lock_guard<std::mutex> lock(access);
+        subscribed = queues;
+    }
+
+    if (subscribed.empty()) {
+        return;
+    }
+
+    /* The frame only copies the image headers of the view, once for all the
+     * subscriptions, and the blocking ones are waited outside of the lock */
+    Frame frame = std::make_shared<const View>(view);
+    for (auto &q : subscribed) {
+        q->push(frame);
+    }
+}
+
+void Channel::subscribe(const std::shared_ptr<Queue> &queue) noexcept {
+    std::lock_guard<std::mutex> lock(access);
+    if (std::find(queues.begin(), queues.end(), queue) == queues.end()) {
+        queues.push_back(queue);
+    }
+}
+
+void Channel::unsubscribe(const std::shared_ptr<Queue> &queue) noexcept {
+    std::lock_guard<std::mutex> lock(access);
+    queues.erase(std::remove(queues.begin(), queues.end(), queue),
+                 queues.end());
+}
+
+Subscription::Subscription() noexcept
+    : joined(), queue(std::make_shared<Channel::Queue>()), exported(0) {
+    /* Define the channel parameter */
+    channel.denominate("channel")
+           .describe("The name of the channel published by the capture "
+                     "engine of another pipeline")
+           .characterise(Customisation::Trait::CONFIGURABLE);
+    channel = "";
+    expose(channel);
+
+    /* Define the depth parameter */
+    depth.denominate("depth")
+         .describe("The number of published frames waiting to be processed")
+         .characterise(Customisation::Trait::CONFIGURABLE);
+    depth.range(1, 64);
+    depth = 1;
+    expose(depth);
+
+    /* Define the policy parameter */
+    policy.denominate("policy")
+          .describe("What to do with a frame published to a full queue: "
+                    "either drop-oldest, drop-newest, or block the capture "
+                    "until a frame is processed")
+          .characterise(Customisation::Trait::SETTABLE);
+    policy.define(
+        { { "drop-oldest", static_cast<int>(Policy::DROP_OLDEST) },
+          { "drop-newest", static_cast<int>(Policy::DROP_NEWEST) },
+          { "block",       static_cast<int>(Policy::BLOCK) } });
+    policy = static_cast<int>(Policy::DROP_OLDEST);
+    expose(policy);
+
+    /* Export the subscription metrics whenever the registry is collected */
+    exported = Util::Metrics::Registry::instance().attach(
+        [this](Util::Metrics::Exposition &e) {
+            auto labels = "subscription=" +
+                          Util::Metrics::Exposition::quote(name());
+            e.counter("vpp_subscription_frames_total",
+                      "Frames received by the subscription", labels,
+                      queue->received.load(std::memory_order_relaxed));
+            e.counter("vpp_subscription_dropped_total",
+                      "Frames dropped by the full subscription", labels,
+                      queue->dropped.load(std::memory_order_relaxed)); });
+}
+
+Subscription::~Subscription() noexcept {
+    Util::Metrics::Registry::instance().detach(exported);
+    terminate();
+}
+
+Customisation::Error Subscription::setup() noexcept {
+    terminate();
+
+    std::string c = channel;
+    if (c.empty()) {
+        return Customisation::Error::NOT_EXISTING;
+    }
+
+    queue->reset(depth, static_cast<Policy>(static_cast<int>(policy)));
+    joined = Channel::share(c);
+    joined->subscribe(queue);
+
+    return Customisation::Error::NONE;
+}
+
+Error::Type Subscription::process(Scene &scene) noexcept {
+    auto frame = queue->pop(WAITING);
+    if (frame == nullptr) {
+        return Error::RETRY;
+    }
+
+    /* The view shares the image buffers of the frame */
+    scene.view = *frame;
+
+    return Error::NONE;
+}
+
+void Subscription::terminate() noexcept {
+    if (joined != nullptr) {
+        joined->unsubscribe(queue);
+        joined.reset();
+    }
+
+    /* Release the capture if blocked on this subscription */
+    queue->close();
+}
+
+}  // namespace Engine
+}  // namespace VPP
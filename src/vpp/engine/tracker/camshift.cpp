@@ -15,13 +15,16 @@
  *
  **/
 
+#include <initializer_list>
+#include <utility>
+
 #include "vpp/engine/tracker/camshift.hpp"
 
 namespace VPP {
 namespace Engine {
 namespace Tracker {
 
-CamShift::CamShift(Scene &history, std::mutex &synchro, 
+CamShift::CamShift(Scene &history, Util::Mutex &synchro, 
                    std::vector<Zone> *added,
                    std::vector<Zone> *removed) noexcept
     : ForScene(), engine(Zone::Copy::Geometry, 3),
@@ -30,7 +33,7 @@ CamShift::CamShift(Scene &history, std::mutex &synchro,
       matcher(Matcher::Mode::Sync, Matcher::Mode::Async*8,
               Matcher::Mode::Async*8),
       update(synchro), latest(history), entering(added), 
-      leaving(removed) {
+      leaving(removed), zones() {
     
     engine.denominate("engine");
     expose(engine);
@@ -43,6 +46,26 @@ CamShift::CamShift(Scene &history, std::mutex &synchro,
 
     matcher.denominate("matcher");
     expose(matcher);
+
+    /* Define the histogram similarity measures, scored in batch */
+    using VPP::Tracker::Histogram::Context;
+    using VPP::Tracker::Histogram::Contexts;
+    for (auto &m : { std::make_pair("bhattacharyya",
+                                    cv::HISTCMP_BHATTACHARYYA),
+                     std::make_pair("correlation", cv::HISTCMP_CORREL),
+                     std::make_pair("chi_square", cv::HISTCMP_CHISQR_ALT) }) {
+        auto method = m.second;
+        matcher.define(m.first,
+                       [method](Context &s, Context &d) noexcept {
+                           return VPP::Tracker::Histogram::similarity(s, d,
+                                                                      method);
+                       },
+                       [method](Contexts &ss, Contexts &ds,
+                                cv::Mat &results) noexcept {
+                           VPP::Tracker::Histogram::similarities(ss, ds, method,
+                                                                 results);
+                           return Error::NONE; });
+    }
 }
 
 Error::Type CamShift::process(Scene &scene) noexcept {
@@ -54,7 +77,7 @@ Error::Type CamShift::process(Scene &scene) noexcept {
     
     /* Initialise the new zones histograms (and new contexts) in parallel 
      * tasks */
-    auto zones = std::move(scene.zones());
+    scene.zones(zones);
     initialisation.start(scene, zones, new_contexts);
     auto e = initialisation.wait();
     if (e != Error::NONE) {
@@ -92,9 +115,9 @@ Error::Type CamShift::process(Scene &scene) noexcept {
     }
 
     /* Keep track of the changes! */
-    std::lock_guard<std::mutex> lock(update);
+    std::lock_guard<Util::Mutex> lock(update);
     engine.cleanup(scene, entering, leaving);
-    latest = std::move(scene.remember());
+    scene.remember(latest);
     
     return Error::NONE;
 }
@@ -20,7 +20,7 @@ namespace VPP {
 namespace Engine {
 namespace Tracker {
 
-History::History(Scene &history, std::mutex &synchro) noexcept 
+History::History(Scene &history, Util::Mutex &synchro) noexcept 
     : VPP::Engine::ForScene(), latest(history), update(synchro) {}
         
 History::~History() noexcept = default;
@@ -32,8 +32,8 @@ Customisation::Error History::setup() noexcept {
 }
         
 Error::Type History::process(Scene &scene) noexcept {
-    std::lock_guard<std::mutex> lock(update);
-    latest = std::move(scene.remember());
+    std::lock_guard<Util::Mutex> lock(update);
+    scene.remember(latest);
     return Error::NONE;
 }
 
@@ -14,6 +14,8 @@
  *
  **/
 
+#include <algorithm>
+#include <cmath>
 #include <opencv2/core/mat.hpp>
 
 #include "vpp/engine/tracker/kalman.hpp"
@@ -22,15 +24,17 @@ namespace VPP {
 namespace Engine {
 namespace Tracker {
 
-Kalman::Kalman(Scene &history, std::mutex &synchro, std::vector<Zone> *added,
+Kalman::Kalman(Scene &history, Util::Mutex &synchro, std::vector<Zone> *added,
                std::vector<Zone> *removed) noexcept
     : ForScene(), engine(Zone::Copy::Geometry, 3),
       prediction(VPP::Task::Tracker::Kalman::Prediction::Mode::Async*8, engine), 
       correction(VPP::Task::Tracker::Kalman::Correction::Mode::Async*8, engine),
       matcher(Matcher::Mode::Sync, Matcher::Mode::Async*8,
               Matcher::Mode::Async*8),
+      recovery(Matcher::Mode::Sync, Matcher::Mode::Async*8,
+               Matcher::Mode::Async*8),
       update(synchro), latest(history), entering(added), 
-      leaving(removed) {
+      leaving(removed), zones(), seeds(), seeded(0) {
     engine.denominate("engine");
     expose(engine);
 
@@ -42,61 +46,279 @@ Kalman::Kalman(Scene &history, std::mutex &synchro, std::vector<Zone> *added,
 
     matcher.denominate("matcher");
     expose(matcher);
+
+    association.denominate("association")
+               .describe("The association of the new zones with the tracked "
+                         "ones: either single for matching them all at once, "
+                         "or byte for matching the confident ones first and "
+                         "only continuing the unmatched tracks with the "
+                         "others")
+               .characterise(Customisation::Trait::SETTABLE);
+    association.define({ { "single", static_cast<int>(Association::SINGLE) },
+                         { "byte",   static_cast<int>(Association::BYTE) } });
+    expose(association);
+    association = static_cast<int>(Association::SINGLE);
+
+    confidence.denominate("confidence")
+              .describe("The score from which a new zone is confident enough "
+                        "for starting a track when associated with byte")
+              .characterise(Customisation::Trait::SETTABLE);
+    confidence.range(0.0f, 1.0f);
+    expose(confidence);
+    confidence = 0.6f;
+
+    recovery.denominate("recovery");
+    expose(recovery);
+
+    depth.denominate("depth")
+         .describe("Whether the zones are tracked in metres when the view "
+                   "has depth, rather than in pixels")
+         .characterise(Customisation::Trait::CONFIGURABLE);
+    depth.use(Customisation::Translator::BoolFormat::NO_YES);
+    expose(depth);
+    depth = true;
+
+    gate.denominate("gate")
+        .describe("The squared Mahalanobis distance beyond which a new zone "
+                  "cannot be a tracked one for the mahalanobis measures, "
+                  "11.07 being the 95% chi-square quantile of a 5-value "
+                  "measure")
+        .characterise(Customisation::Trait::SETTABLE);
+    gate.range(0.0f, 1000.0f);
+    expose(gate);
+    gate = 11.07f;
+
+    serve(matcher);
+    serve(recovery);
+}
+
+void Kalman::serve(Matcher &m) noexcept {
+    using VPP::Tracker::Kalman::Context;
+    using VPP::Tracker::Kalman::Contexts;
+    using VPP::Tracker::Kalman::mahalanobis;
+
+    /* The likeliness decreases from 1 for the predicted measure down to 0 at
+     * the gate */
+    m.define("mahalanobis",
+             [this](Context &s, Context &d) noexcept {
+                 const float g = gate;
+                 auto d2 = mahalanobis(s, d);
+                 return (d2 < g) ? 1.0f - d2 / g : 0.0f; },
+             [this](Contexts &ss, Contexts &ds, cv::Mat &results) noexcept {
+                 const float g = gate;
+                 mahalanobis(ss, ds, results);
+                 for (int i = 0; i < results.rows; ++i) {
+                     auto r = results.ptr<float>(i);
+                     for (int j = 0; j < results.cols; ++j) {
+                         r[j] = (r[j] < g) ? 1.0f - r[j] / g : 0.0f;
+                     }
+                 }
+                 return Error::NONE; });
+
+    /* The IoU of the pairs within the gate only */
+    m.define("iou_mahalanobis",
+             [this](Context &s, Context &d) noexcept {
+                 const float g = gate;
+                 return (mahalanobis(s, d) < g) ? Matcher::iou_image(s, d) :
+                                                  0.0f; },
+             [this](Contexts &ss, Contexts &ds, cv::Mat &results) noexcept {
+                 const float g = gate;
+                 cv::Mat d2;
+                 mahalanobis(ss, ds, d2);
+                 Matcher::iou_images(ss, ds, results);
+                 for (int i = 0; i < results.rows; ++i) {
+                     auto r = results.ptr<float>(i);
+                     auto l = d2.ptr<float>(i);
+                     for (int j = 0; j < results.cols; ++j) {
+                         r[j] = (l[j] < g) ? r[j] : 0.0f;
+                     }
+                 }
+                 return Error::NONE; });
 }
 
 Customisation::Error Kalman::setup() noexcept {
     latest = std::move(Scene());
+    seeds.clear();
 
     return Customisation::Error::NONE;
 }
 
 Error::Type Kalman::process(Scene &scene) noexcept {
+    /* The zones are marked flat, and only deprojected when tracked in
+     * metres, the ones tracked in pixels being only flattened back if an
+     * earlier consumer of their metric states deprojected them */
+    if (depth) {
+        scene.deproject();
+    } else {
+        scene.flatten();
+    }
 
     /* Add the new zones to the kalam trackers */
-    auto zones = std::move(scene.zones());
+    scene.zones(zones);
     engine.prepare(zones);
 
     /* Compute the delta time in seconds */
     auto dt_ms = scene.ts_ms() - latest.ts_ms();
     float dt_s = static_cast<float>(dt_ms) / 1000.0f;
     
-    /* Perform the predictions as parallel tasks */
+    /* Perform the predictions in a single loop over the filters of the
+     * contexts with the batched backend, and as parallel tasks otherwise */
+    const bool batched = engine.parameters().batched;
     auto historic_contexts = 
         std::move(engine.contexts(engine.history_contexts));
-    prediction.start(scene, dt_s, historic_contexts);
-    auto e = prediction.wait();
-    if (e != Error::NONE) {
-        return e;
+    auto e = Error::NONE;
+    if (batched) {
+        if (dt_s > 0) {
+            engine.predict(scene.view, dt_s, historic_contexts);
+        }
+    } else {
+        prediction.start(scene, dt_s, historic_contexts);
+        e = prediction.wait();
+        if (e != Error::NONE) {
+            return e;
+        }
     }
     
     /* Do some new to old context mapping and merge ... */
     auto new_contexts = engine.contexts(engine.original_contexts);
-    e=matcher.estimate(new_contexts, historic_contexts);
-    if (e != Error::NONE) {
-        return e;
-    }
+    if (static_cast<Association>(static_cast<int>(association)) == 
+        Association::SINGLE) {
+        e = associate(matcher, new_contexts, historic_contexts);
+        if (e != Error::NONE) {
+            return e;
+        }
+    } else {
+        /* Split the new contexts by the score of their zones */
+        const float confident = confidence;
+        VPP::Tracker::Kalman::Contexts high, low;
+        for (auto &c : new_contexts) {
+            if (c.get().original->context.score >= confident) {
+                high.emplace_back(c);
+            } else {
+                low.emplace_back(c);
+            }
+        }
 
-    /* Get the matches */
-    auto matches = matcher.extract(true, true);
-    for (auto &m : matches) {
-        matcher.destination(m).merge(matcher.source(m));
+        std::vector<bool> matched(historic_contexts.size(), false);
+        e = associate(matcher, high, historic_contexts, &matched);
+        if (e != Error::NONE) {
+            return e;
+        }
+
+        VPP::Tracker::Kalman::Contexts unmatched;
+        for (std::size_t i = 0; i < historic_contexts.size(); ++i) {
+            if (!matched[i]) {
+                unmatched.emplace_back(historic_contexts[i]);
+            }
+        }
+
+        e = associate(recovery, low, unmatched);
+        if (e != Error::NONE) {
+            return e;
+        }
+
+        /* The remaining unconfident zones never start a track */
+        for (auto &c : low) {
+            auto &context = c.get();
+            if (context.valid()) {
+                context.original->invalidate();
+                context.invalidate();
+            }
+        }
     }
     
-    /* Correct Kalman predictions as parallel tasks */
-    correction.start(scene, historic_contexts);
-    e = correction.wait();
-    if (e != Error::NONE) {
-        return e;
+    /* Correct Kalman predictions likewise */
+    if (batched) {
+        engine.correct(historic_contexts);
+    } else {
+        correction.start(scene, historic_contexts);
+        e = correction.wait();
+        if (e != Error::NONE) {
+            return e;
+        }
     }
 
     /* Keep track of the changes! */
-    std::lock_guard<std::mutex> lock(update);
+    std::lock_guard<Util::Mutex> lock(update);
     engine.cleanup(scene, entering, leaving);
-    latest = std::move(scene.remember());
+    scene.remember(latest);
+
+    /* Keep the estimates for forecasting the next regions */
+    seeds.clear();
+    for (auto &c : engine.contexts(engine.valid_contexts)) {
+        Seed seed;
+        c.get().posterior(seed.x, seed.p);
+        seeds.emplace_back(std::move(seed));
+    }
+    seeded = scene.ts_ms();
     
     return Error::NONE;
 }
 
+Error::Type Kalman::associate(Matcher &m, 
+                              VPP::Tracker::Kalman::Contexts &src,
+                              VPP::Tracker::Kalman::Contexts &dst,
+                              std::vector<bool> *matched) noexcept {
+    if ( (src.empty()) || (dst.empty()) ) {
+        return Error::NONE;
+    }
+
+    auto e = m.estimate(src, dst);
+    if (e != Error::NONE) {
+        return e;
+    }
+
+    /* Get the matches */
+    auto matches = m.extract(true, true);
+    for (auto &match : matches) {
+        m.destination(match).merge(m.source(match));
+        if (matched != nullptr) {
+            (*matched)[match.dst] = true;
+        }
+    }
+
+    return Error::NONE;
+}
+
+bool Kalman::regions(const Scene &scene, float sigmas,
+                     std::vector<cv::Rect> &rois) noexcept {
+    std::lock_guard<Util::Mutex> lock(update);
+    rois.clear();
+    if (seeds.empty()) {
+        return false;
+    }
+
+    /* Only the dt terms of F change from one frame to another */
+    const auto &model = engine.parameters();
+    auto dt_ms = static_cast<int64_t>(scene.ts_ms() - seeded);
+    auto F     = model.transition;
+    F(0, 5) = F(1, 6) = F(2, 7) = static_cast<float>(dt_ms) / 1000.0f;
+
+    rois.reserve(seeds.size());
+    for (auto &seed : seeds) {
+        auto p = F * seed.p * F.t() + model.process;
+
+        /* Grow the forecast zone by the uncertainty of both its centre (on
+         * both sides) and of its size */
+        Zone zone;
+        zone.state       = F * seed.x;
+        zone.deprojected = depth && scene.view.depth.available();
+        zone.state.size.x += sigmas * (2 * std::sqrt(std::max(p(0, 0), 0.0f))
+                                         + std::sqrt(std::max(p(3, 3), 0.0f)));
+        zone.state.size.y += sigmas * (2 * std::sqrt(std::max(p(1, 1), 0.0f))
+                                         + std::sqrt(std::max(p(4, 4), 0.0f)));
+        zone.project(scene.view);
+
+        cv::Rect roi = zone;
+        roi &= scene.view.frame();
+        if (roi.area() > 0) {
+            rois.emplace_back(std::move(roi));
+        }
+    }
+
+    return !rois.empty();
+}
+
 }  // namespace Tracker
 }  // namespace Engine
 }  // namespace VPP
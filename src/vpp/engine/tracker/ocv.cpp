@@ -20,7 +20,7 @@ namespace VPP {
 namespace Engine {
 namespace Tracker {
 
-OCV::OCV(Scene &history, std::mutex &synchro, std::vector<Zone> *added,
+OCV::OCV(Scene &history, Util::Mutex &synchro, std::vector<Zone> *added,
          std::vector<Zone> *removed) noexcept
     : ForScene(), engine(Zone::Copy::Geometry, 3),
       initialisation(Util::Task::Core::Mode::Async*8, engine), 
@@ -28,7 +28,7 @@ OCV::OCV(Scene &history, std::mutex &synchro, std::vector<Zone> *added,
       matcher(Matcher::Mode::Sync, Matcher::Mode::Async*8,
               Matcher::Mode::Async*8),
       update(synchro), latest(history), entering(added), 
-      leaving(removed) {
+      leaving(removed), zones() {
     
     engine.denominate("engine");
     expose(engine);
@@ -52,7 +52,7 @@ Error::Type OCV::process(Scene &scene) noexcept {
     
     /* Initialise the new zones histograms (and new contexts) in parallel 
      * tasks */
-    auto zones = std::move(scene.zones());
+    scene.zones(zones);
     initialisation.start(scene, zones, new_contexts);
     auto e = initialisation.wait();
     if (e != Error::NONE) {
@@ -81,9 +81,9 @@ Error::Type OCV::process(Scene &scene) noexcept {
     }
 
     /* Keep track of the changes! */
-    std::lock_guard<std::mutex> lock(update);
+    std::lock_guard<Util::Mutex> lock(update);
     engine.cleanup(scene, entering, leaving);
-    latest = std::move(scene.remember());
+    scene.remember(latest);
     
     return Error::NONE;
 }
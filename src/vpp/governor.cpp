@@ -0,0 +1,385 @@
+/**
+ *
+ * @file      vpp/governor.cpp
+ *
+ * @brief     This is the VPP resolution governor implementation file
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "vpp/governor.hpp"
+#include "vpp/log.hpp"
+
+namespace VPP {
+
+Governor::Governor() noexcept 
+    : Customisation::Entity("Governor"), actuators(), decimators(),
+      latencies(), evaluated(0), busy(0), total(0), warmth(-1.0f) {
+    target.denominate("target")
+          .describe("The 90th percentile of the end to end latency targeted "
+                    "in milliseconds (0 for keeping the scale fixed)")
+          .characterise(Customisation::Trait::SETTABLE);
+    target.range(0, 10000);
+    Customisation::Entity::expose(target);
+    target = 0;
+
+    minimum.denominate("minimum")
+           .describe("The minimal processing scale")
+           .characterise(Customisation::Trait::SETTABLE);
+    minimum.range(0.1f, 4.0f);
+    Customisation::Entity::expose(minimum);
+    minimum = 0.5f;
+
+    maximum.denominate("maximum")
+           .describe("The maximal processing scale")
+           .characterise(Customisation::Trait::SETTABLE);
+    maximum.range(0.1f, 4.0f);
+    Customisation::Entity::expose(maximum);
+    maximum = 1.0f;
+
+    step.denominate("step")
+        .describe("The ratio between two successive processing scales")
+        .characterise(Customisation::Trait::SETTABLE);
+    step.range(1.05f, 2.0f);
+    Customisation::Entity::expose(step);
+    step = 1.25f;
+
+    hysteresis.denominate("hysteresis")
+              .describe("The margin below the target and the ceiling for "
+                        "stepping the scale up again")
+              .characterise(Customisation::Trait::SETTABLE);
+    hysteresis.range(0.0f, 0.9f);
+    Customisation::Entity::expose(hysteresis);
+    hysteresis = 0.3f;
+
+    period.denominate("period")
+          .describe("The period in milliseconds between two evaluations")
+          .characterise(Customisation::Trait::SETTABLE);
+    period.range(100, 60000);
+    Customisation::Entity::expose(period);
+    period = 2000;
+
+    ceiling.denominate("ceiling")
+           .describe("The CPU and GPU utilisation above which the scale is "
+                     "stepped down")
+           .characterise(Customisation::Trait::SETTABLE);
+    ceiling.range(0.1f, 1.0f);
+    Customisation::Entity::expose(ceiling);
+    ceiling = 0.95f;
+
+    gpu.denominate("gpu")
+       .describe("The file reporting the GPU load in per mille, such as "
+                 "/sys/devices/gpu.0/load on Jetson boards (none if empty)")
+       .characterise(Customisation::Trait::CONFIGURABLE);
+    Customisation::Entity::expose(gpu);
+
+    thermal.denominate("thermal")
+           .describe("The files reporting the temperatures in millidegrees, "
+                     "separated by commas, such as "
+                     "/sys/class/thermal/thermal_zone0/temp (none if empty)")
+           .characterise(Customisation::Trait::CONFIGURABLE);
+    Customisation::Entity::expose(thermal);
+
+    hot.denominate("hot")
+       .describe("The temperature in degrees above which the work is reduced, "
+                 "below the throttling point of the device")
+       .characterise(Customisation::Trait::SETTABLE);
+    hot.range(30.0f, 120.0f);
+    Customisation::Entity::expose(hot);
+    hot = 80.0f;
+
+    cooling.denominate("cooling")
+           .describe("The margin in degrees below the hot temperature for "
+                     "restoring the work")
+           .characterise(Customisation::Trait::SETTABLE);
+    cooling.range(0.0f, 30.0f);
+    Customisation::Entity::expose(cooling);
+    cooling = 5.0f;
+
+    clocks.denominate("clocks")
+          .describe("The cpufreq or devfreq directories of the CPU and GPU, "
+                    "separated by commas, such as "
+                    "/sys/devices/system/cpu/cpu0/cpufreq (none if empty)")
+          .characterise(Customisation::Trait::CONFIGURABLE);
+    Customisation::Entity::expose(clocks);
+
+    throttled.denominate("throttled")
+             .describe("The ratio of the maximal frequency below which a busy "
+                       "device is deemed throttled")
+             .characterise(Customisation::Trait::SETTABLE);
+    throttled.range(0.1f, 1.0f);
+    Customisation::Entity::expose(throttled);
+    throttled = 0.9f;
+
+    largest.denominate("largest")
+           .describe("The largest decimation once at the minimal scale (1 for "
+                     "never decimating)")
+           .characterise(Customisation::Trait::SETTABLE);
+    largest.range(1, 100);
+    Customisation::Entity::expose(largest);
+    largest = 1;
+
+    scale.denominate("scale")
+         .describe("The actual processing scale")
+         .characterise(Customisation::Trait::SETTABLE);
+    scale.range(0.1f, 4.0f);
+    scale.trigger([this](const float &s) { return onScaleUpdate(s); });
+    Customisation::Entity::expose(scale);
+    scale = 1.0f;
+
+    decimation.denominate("decimation")
+              .describe("The actual decimation")
+              .characterise(Customisation::Trait::SETTABLE);
+    decimation.range(1, 100);
+    decimation.trigger([this](const int &every) {
+                           return onDecimationUpdate(every); });
+    Customisation::Entity::expose(decimation);
+    decimation = 1;
+}
+
+void Governor::actuate(Actuator a) noexcept {
+    actuators.emplace_back(std::move(a));
+}
+
+void Governor::decimate(Decimator d) noexcept {
+    decimators.emplace_back(std::move(d));
+}
+
+Customisation::Error Governor::onDecimationUpdate(const int &every) noexcept {
+    for (auto &d : decimators) {
+        d(every);
+    }
+
+    return Customisation::Error::NONE;
+}
+
+Customisation::Error Governor::onScaleUpdate(const float &s) noexcept {
+    for (auto &a : actuators) {
+        a(s);
+    }
+
+    return Customisation::Error::NONE;
+}
+
+float Governor::cpu() noexcept {
+    auto file = fopen("/proc/stat", "r");
+    if (file == nullptr) {
+        return -1.0f;
+    }
+
+    unsigned long long user = 0, nice = 0, system = 0, idle = 0, iowait = 0,
+                       irq = 0, softirq = 0, steal = 0;
+    auto n = fscanf(file, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+                    &user, &nice, &system, &idle, &iowait, &irq, &softirq,
+                    &steal);
+    fclose(file);
+    if (n < 4) {
+        return -1.0f;
+    }
+
+    uint64_t b = user + nice + system + irq + softirq + steal;
+    uint64_t t = b + idle + iowait;
+    float utilisation = -1.0f;
+    if ( (total != 0) && (t > total) ) {
+        utilisation = static_cast<float>(b - busy) / 
+                      static_cast<float>(t - total);
+    }
+    busy  = b;
+    total = t;
+
+    return utilisation;
+}
+
+float Governor::load() noexcept {
+    const std::string &path = gpu;
+    if (path.empty()) {
+        return -1.0f;
+    }
+
+    auto file = fopen(path.c_str(), "r");
+    if (file == nullptr) {
+        return -1.0f;
+    }
+
+    int permille = -1;
+    auto n = fscanf(file, "%d", &permille);
+    fclose(file);
+
+    return ( (n == 1) && (permille >= 0) ) ? permille / 1000.0f : -1.0f;
+}
+
+/* Reading the numbers of the files of a comma separated list */
+static std::vector<double> numbers(const std::string &list,
+                                   const char *suffix = "") noexcept {
+    std::vector<double> values;
+    std::size_t from = 0;
+    while (from < list.size()) {
+        auto to = list.find(',', from);
+        if (to == std::string::npos) {
+            to = list.size();
+        }
+        auto path = list.substr(from, to - from) + suffix;
+        from      = to + 1;
+
+        auto file = fopen(path.c_str(), "r");
+        if (file == nullptr) {
+            values.push_back(-1.0);
+            continue;
+        }
+        double value = -1.0;
+        if (fscanf(file, "%lf", &value) != 1) {
+            value = -1.0;
+        }
+        fclose(file);
+        values.push_back(value);
+    }
+
+    return values;
+}
+
+float Governor::temperature() noexcept {
+    float hottest = -1.0f;
+    for (auto millidegrees : numbers(thermal)) {
+        hottest = std::max(hottest, static_cast<float>(millidegrees / 1000.0));
+    }
+
+    return hottest;
+}
+
+float Governor::clocking() noexcept {
+    /* The cpufreq directories report their frequencies in scaling_cur_freq
+     * and scaling_max_freq, and the devfreq ones in cur_freq and max_freq */
+    const std::string &list = clocks;
+    auto actual  = numbers(list, "/scaling_cur_freq");
+    auto highest = numbers(list, "/scaling_max_freq");
+    auto devcur  = numbers(list, "/cur_freq");
+    auto devmax  = numbers(list, "/max_freq");
+
+    float lowest = -1.0f;
+    for (std::size_t i = 0; i < actual.size(); ++i) {
+        auto cur = (actual[i] > 0) ? actual[i] : devcur[i];
+        auto top = (highest[i] > 0) ? highest[i] : devmax[i];
+        if ( (cur > 0) && (top > 0) ) {
+            auto ratio = static_cast<float>(cur / top);
+            lowest = (lowest < 0) ? ratio : std::min(lowest, ratio);
+        }
+    }
+
+    return lowest;
+}
+
+bool Governor::reduce() noexcept {
+    float lower  = minimum, upper = maximum;
+    float actual = std::min(upper, std::max(lower, static_cast<float>(scale)));
+    int   every  = decimation;
+
+    /* Scaling down first, then decimating */
+    if (actual > lower) {
+        scale = std::max(lower, actual / static_cast<float>(step));
+    } else if (every < static_cast<int>(largest)) {
+        decimation = every + 1;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+bool Governor::restore() noexcept {
+    float lower  = minimum, upper = maximum;
+    float actual = std::min(upper, std::max(lower, static_cast<float>(scale)));
+    int   every  = decimation;
+
+    /* Restoring in the reverse order of the reduction */
+    if (every > 1) {
+        decimation = every - 1;
+    } else if (actual < upper) {
+        scale = std::min(upper, actual * static_cast<float>(step));
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+void Governor::measure(uint64_t latency) noexcept {
+    int  goal     = target;
+    bool watching = (!static_cast<const std::string &>(thermal).empty()) ||
+                    (!static_cast<const std::string &>(clocks).empty());
+    if ( (goal == 0) && (!watching) ) {
+        return;
+    }
+
+    latencies.record(latency);
+    auto now = Util::Histogram::now();
+    if (evaluated == 0) {
+        evaluated = now;
+        cpu();
+        return;
+    }
+    if (now - evaluated < static_cast<uint64_t>(static_cast<int>(period)) *
+                          1000000ull) {
+        return;
+    }
+    evaluated = now;
+
+    auto p90         = latencies.percentile(0.9) / 1e6f;
+    auto utilisation = std::max(cpu(), load());
+    auto celsius     = temperature();
+    auto clocked     = clocking();
+    latencies.reset();
+
+    float margin = 1.0f - static_cast<float>(hysteresis);
+    float top    = ceiling;
+    float limit  = hot;
+
+    /* The temperature expected at the next evaluation anticipates the
+     * throttling, and a busy device running below its maximal frequency is
+     * already throttled */
+    float expected = celsius;
+    if ( (celsius >= 0) && (warmth >= 0) ) {
+        expected = celsius + std::max(0.0f, celsius - warmth);
+    }
+    warmth = celsius;
+    float slowest = throttled;
+    bool  heating = (expected >= limit) ||
+                    ( (clocked >= 0) && (clocked < slowest) &&
+                      (utilisation > top * margin) );
+    bool  cool    = (!heating) &&
+                    (celsius < limit - static_cast<float>(cooling));
+
+    /* Reducing the work as soon as the latency, the utilisation or the heat
+     * is too high, but only restoring it when all are well below their
+     * limits */
+    bool over    = heating ||
+                   ( (goal > 0) && ( (p90 > goal) || (utilisation > top) ) );
+    bool relaxed = cool &&
+                   ( (goal == 0) ||
+                     ( (p90 < goal * margin) &&
+                       (utilisation < top * margin) ) );
+
+    float before = scale;
+    int   every  = decimation;
+    if ( ( (over) && (reduce()) ) || ( (relaxed) && (restore()) ) ) {
+        LOGI("%s[%s]::measure(): Scaling from %.2f to %.2f and decimating "
+             "from %d to %d (latency %.1fms, utilisation %.0f%%, "
+             "temperature %.1f, clock %.0f%%)", value_to_string().c_str(),
+             name().c_str(), before, static_cast<float>(scale), every,
+             static_cast<int>(decimation), p90, utilisation * 100.0f,
+             celsius, clocked * 100.0f);
+    }
+}
+
+}  // namespace VPP
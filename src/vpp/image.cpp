@@ -14,17 +14,20 @@
  *
  **/
 
+#include <algorithm>
 #include <opencv2/imgproc.hpp>
 #include <unordered_map>
 
 #include "vpp/image.hpp"
+#include "vpp/util/ocv/pool.hpp"
 
 namespace VPP {
 
 Image Image::INVALID;
 
 Image::Image() noexcept 
-    : m(), boundaries(), original(), copy() {
+    : m(), boundaries(), original(), copy(), drawn(), tiling(0),
+      touched(0), mirror() {
 }
 
 #ifdef NDEBUG
@@ -44,27 +47,37 @@ static void check_validity(const cv::Mat &data,
 Image::Image(cv::Mat data, Image::Mode mode) noexcept
     : m(std::move(mode)),
       boundaries(std::move(cv::Rect(0, 0, data.cols, data.rows))), 
-      original(std::move(data)), copy() {
+      original(std::move(data)), copy(), drawn(), tiling(0), touched(0),
+      mirror() {
     check_validity(original, m);
+
+    /* Native images have their chroma planes below the luma one */
+    if (m.is_native()) {
+        boundaries.height = (boundaries.height * 2) / 3;
+    }
 }
 
 Image::Image(const Image &i, Image::Mode mode, const cv::Rect &roi,
              float scale, float offset) noexcept
     : m(std::move(mode)), 
-      original(std::move(i.to(m, roi, scale, offset))), copy() {
+      original(std::move(i.to(m, roi, scale, offset))), copy(), drawn(),
+      tiling(0), touched(0), mirror() {
     check_validity(original, m);
     boundaries = std::move(cv::Rect(0, 0, original.cols, original.rows));
 }
 
 Image::Image(const Image &i, Image::Mode mode, float scale, float offset)
     noexcept : m(std::move(mode)), boundaries(i.boundaries),
-               original(std::move(i.to(m, scale, offset))), copy() {
+               original(std::move(i.to(m, scale, offset))), copy(),
+               drawn(), tiling(0), touched(0), mirror() {
     check_validity(original, m);
 }
 
 Image::Image(const Image& other) noexcept 
 : m(other.m), boundaries(other.boundaries), original(other.original), 
-  copy() { }
+  copy(), drawn(), tiling(0), touched(0), mirror() {
+    redraw(other);
+}
 
 Image& Image::operator=(const Image& other) noexcept {
     if (&other != this) {
@@ -72,6 +85,11 @@ Image& Image::operator=(const Image& other) noexcept {
         boundaries = other.boundaries;
         original   = other.original;
         copy       = cv::Mat();
+        drawn.clear();
+        tiling     = 0;
+        touched    = 0;
+        mirror     = cv::UMat();
+        redraw(other);
     }
 
     return *this;
@@ -80,25 +98,94 @@ Image& Image::operator=(const Image& other) noexcept {
 Image::~Image() noexcept = default;
 
 Image Image::operator()(const cv::Rect &roi) const noexcept {
+    /* Native images cannot be cropped, so crop their BGR version */
+    if (m.is_native()) {
+        return Image(*this, Mode::BGR, roi);
+    }
+
     return Image(original(roi & boundaries), m); 
 }
 
-const cv::Mat &Image::output() const noexcept {
+/* Size of the tiles of the drawables copied from the original images */
+static const int tile_size = 64;
+
+void Image::touch(const cv::Rect &area) const noexcept {
+    const cv::Rect full(0, 0, original.cols, original.rows);
+
+    /* The drawable buffer is only allocated, and its tiles are only copied
+     * from the original once touched */
     if (copy.empty()) {
+        copy    = Util::OCV::Pool::mat(original.size(), original.type());
+        tiling  = (original.cols + tile_size - 1) / tile_size;
+        drawn.assign(static_cast<std::size_t>(tiling) * 
+                     ((original.rows + tile_size - 1) / tile_size), 0);
+        touched = 0;
+    }
+
+    const auto a = area & full;
+    if ( (a.empty()) || (touched == drawn.size()) ) {
+        return;
+    }
+
+    for (int ty = a.y / tile_size; ty <= (a.br().y - 1) / tile_size; ++ty) {
+        for (int tx = a.x / tile_size; tx <= (a.br().x - 1) / tile_size;
+             ++tx) {
+            auto &d = drawn[ty * tiling + tx];
+            if (d == 0) {
+                const auto t = cv::Rect(tx * tile_size, ty * tile_size,
+                                        tile_size, tile_size) & full;
+                original(t).copyTo(copy(t));
+                d = 1;
+                ++touched;
+            }
+        }
+    }
+}
+
+void Image::redraw(const Image &other) noexcept {
+    /* Only copy the tiles drawn in the other image */
+    if ( (other.touched == 0) || (other.original.data != original.data) ) {
+        return;
+    }
+
+    touch(cv::Rect());
+    drawn   = other.drawn;
+    touched = other.touched;
+    for (std::size_t i = 0; i < drawn.size(); ++i) {
+        if (drawn[i] != 0) {
+            const int  ty = static_cast<int>(i) / tiling;
+            const int  tx = static_cast<int>(i) % tiling;
+            const auto t  = cv::Rect(tx * tile_size, ty * tile_size,
+                                     tile_size, tile_size) &
+                            cv::Rect(0, 0, original.cols, original.rows);
+            other.copy(t).copyTo(copy(t));
+        }
+    }
+}
+
+const cv::Mat &Image::output() const noexcept {
+    if (touched == 0) {
         return original;
     }
+
+    /* Compose the drawn tiles with the original ones */
+    touch(cv::Rect(0, 0, original.cols, original.rows));
     return copy;
 }
 
 cv::Mat &Image::drawable() noexcept {
-    if (copy.empty()) {
-        flush();
-    }
+    return drawable(cv::Rect(0, 0, original.cols, original.rows));
+}
+
+cv::Mat &Image::drawable(const cv::Rect &area) noexcept {
+    touch(area);
     return copy;
 }
 
 void Image::flush() noexcept {
-    original.copyTo(copy);
+    /* Forget all the drawn tiles, which will be copied again once touched */
+    std::fill(drawn.begin(), drawn.end(), 0);
+    touched = 0;
 }
 
 static bool extract_is_valid(const Image::Channel &c,
@@ -112,28 +199,77 @@ static bool extract_is_valid(const Image::Channel &c,
     return true;
 }
 
-cv::Mat Image::extract(const Image::Channel &c,
-                       const cv::Rect &roi) const noexcept {
-    cv::Mat plane;
+cv::Mat Image::Strided::mat() const noexcept {
+    if (contiguous()) {
+        return base;
+    }
+
+    cv::Mat out;
+    cv::extractChannel(base, out, offset);
+    return out;
+}
+
+Image::Strided Image::plane(int id, const cv::Rect &area) const noexcept {
+    /* The luma plane is the top of the buffer */
+    if (id == 0) {
+        return Strided(original(area), 0);
+    }
+
+    const int w = boundaries.width;
+    const int h = boundaries.height;
+    const cv::Rect chroma = cv::Rect(area.x / 2, area.y / 2,
+                                     (area.width + 1) / 2,
+                                     (area.height + 1) / 2) &
+                            cv::Rect(0, 0, w / 2, h / 2);
+
+    /* The U and V quarter planes of I420 images are stacked below the luma
+     * one, and viewed as is whenever they span whole rows of the buffer */
+    if (m == Mode::I420) {
+        if ( (original.isContinuous()) && (h % 4 == 0) ) {
+            const int rows = h / 4;
+            return Strided(original.rowRange(h + (id - 1) * rows,
+                                             h + id * rows)
+                                   .reshape(1, h / 2)(chroma), 0);
+        }
 
-    if (extract_is_valid(c, m)) {
-        cv::extractChannel(original(roi & boundaries), plane, c.id());
-    } else {
-        LOGD("Image::extract(): cannot extract channel %d from an image "
-             "of mode %d!", c.id(), static_cast<int>(m));
+        const uchar *data = original.ptr() + w * h + (id - 1) * (w * h / 4);
+        return Strided(cv::Mat(h / 2, w / 2, CV_8UC1,
+                               const_cast<uchar *>(data))(chroma).clone(), 0);
     }
 
-    return plane;
+    /* The chroma plane of semi-planar images is interleaved, U first for NV12
+     * and V first for NV21, and strided over in place */
+    const cv::Mat uv = original.rowRange(h, h + h / 2);
+    cv::Mat pairs(h / 2, w / 2, CV_8UC2, const_cast<uchar *>(uv.ptr()),
+                  uv.step);
+
+    return Strided(pairs(chroma), ((m == Mode::NV12) == (id == 1)) ? 0 : 1);
 }
 
-cv::Mat Image::extract(const Image::Channel &c) const noexcept {
-    cv::Mat plane;
+Image::Strided Image::channel(const Image::Channel &c,
+                              const cv::Rect &roi) const noexcept {
+    if (!extract_is_valid(c, m)) {
+        return Strided();
+    }
 
-    if (extract_is_valid(c, m)) {
-        cv::extractChannel(original, plane, c.id());
+    if (m.is_native()) {
+        return plane(c.id(), roi & boundaries);
     }
-        
-    return plane;
+
+    return Strided(original(roi & boundaries), c.id());
+}
+
+Image::Strided Image::channel(const Image::Channel &c) const noexcept {
+    return channel(c, boundaries);
+}
+
+cv::Mat Image::extract(const Image::Channel &c,
+                       const cv::Rect &roi) const noexcept {
+    return channel(c, roi).mat();
+}
+
+cv::Mat Image::extract(const Image::Channel &c) const noexcept {
+    return channel(c).mat();
 }
 
 bool Image::translatable(const Image::Mode &mode) const noexcept {
@@ -147,6 +283,14 @@ bool Image::translatable(const Image::Mode &mode) const noexcept {
         return true;
     }
 
+    /* Native images are only translated to BGR and gray images */
+    if (m.is_native()) {
+        return (mode == Mode::BGR) || (mode == Mode::GRAY);
+    }
+    if (mode.is_native()) {
+        return false;
+    }
+
     /* If one is depth and the other is normal image, then we are screwed */
     if (mode.is_depth() != m.is_depth()) {
         return false;
@@ -176,6 +320,20 @@ cv::Mat Image::to(const Image::Mode &mode, const cv::Rect &roi, float scale,
         return out;
     }
 
+    /* The luma plane of a native image is its gray image, so that it is
+     * used as is without any copy, and the BGR conversion needs all planes */
+    if ((m.is_native()) && (m != mode)) {
+        const auto area = roi & boundaries;
+        if (mode == Mode::GRAY) {
+            return plane(0, area).mat();
+        }
+
+        out = Util::OCV::Pool::mat(cv::Size(original.cols,
+                                            original.rows * 2 / 3), CV_8UC3);
+        cv::cvtColor(original, out, conversion(m, mode), 3);
+        return out(area);
+    }
+
     /* Do the cropping carefully not to go beyond the limits */
     cv::Mat in(std::move(original(roi & boundaries)));
 
@@ -188,6 +346,8 @@ cv::Mat Image::to(const Image::Mode &mode, const cv::Rect &roi, float scale,
 
     /* If depth mode, then change type and scale */
     if (m.is_depth()) {
+        out = Util::OCV::Pool::mat(in.size(), (mode == Mode::DEPTHF) ?
+                                              CV_32F : CV_16U);
         if (mode == Mode::DEPTHF) {
             in.convertTo(out, CV_32F, scale, offset);
         } else {
@@ -198,51 +358,107 @@ cv::Mat Image::to(const Image::Mode &mode, const cv::Rect &roi, float scale,
 
     /* The two modes are standard image modes, and hence, either the source
      * or the destination is BGR */
-    int conversion;
-    if (m == Mode::BGR) {
-        switch(mode) {
+    const int code = conversion(m, mode);
+    if (code < 0) {
+        ASSERT(false, "Image::to(): Cannot convert from mode %d to mode %d. "
+                      "This shall never happen!",
+               static_cast<int>(m), static_cast<int>(mode));
+        return out;
+    }
+   
+    /* Perform the right colour conversion in a pooled buffer */
+    out = Util::OCV::Pool::mat(in.size(), CV_8UC(Mode::channels(mode)));
+    cv::cvtColor(in, out, code, 0);
+
+    return out;
+}
+
+std::size_t Image::footprint(Util::OCV::Footprint &f) const noexcept {
+    return f.add(original) + f.add(copy) + drawn.capacity();
+}
+
+int Image::conversion(const Image::Mode &from, const Image::Mode &to)
+    noexcept {
+    if (to == Mode::BGR) {
+        switch(from) {
+            case Mode::NV12:
+                return cv::COLOR_YUV2BGR_NV12;
+            case Mode::NV21:
+                return cv::COLOR_YUV2BGR_NV21;
+            case Mode::I420:
+                return cv::COLOR_YUV2BGR_I420;
             case Mode::HSV:
-                conversion=cv::COLOR_BGR2HSV;
-                break;
+                return cv::COLOR_HSV2BGR;
             case Mode::YUV:
-                conversion=cv::COLOR_BGR2YUV;
-                break;
+                return cv::COLOR_YUV2BGR;
             case Mode::YCrCb:
-                conversion=cv::COLOR_BGR2YCrCb;
-                break;
+                return cv::COLOR_YCrCb2BGR;
             case Mode::GRAY:
-                conversion=cv::COLOR_BGR2GRAY;
-                break;
+                return cv::COLOR_GRAY2BGR;
             default:
-                ASSERT(false, "Image::to(): Cannot convert from BGR. "
-                              "This shall never happen!");
-                return out;
+                return -1;
         }
-    } else {
-        switch(m) {
+    }
+
+    if (from == Mode::BGR) {
+        switch(to) {
             case Mode::HSV:
-                conversion=cv::COLOR_HSV2BGR;
-                break;
+                return cv::COLOR_BGR2HSV;
             case Mode::YUV:
-                conversion=cv::COLOR_YUV2BGR;
-                break;
+                return cv::COLOR_BGR2YUV;
             case Mode::YCrCb:
-                conversion=cv::COLOR_YCrCb2BGR;
-                break;
+                return cv::COLOR_BGR2YCrCb;
             case Mode::GRAY:
-                conversion=cv::COLOR_GRAY2BGR;
-                break;
+                return cv::COLOR_BGR2GRAY;
             default:
-                ASSERT(false, "Image::to(): Cannot convert to BGR. "
-                              "This shall never happen!");
-                return out;
+                return -1;
         }
     }
-   
-    /* Perform the right colour conversion */
-    cv::cvtColor(in, out, conversion, 0);
 
-    return out;
+    return -1;
+}
+
+const cv::UMat &Image::device() noexcept {
+    /* The image is uploaded to the device on first use only */
+    if (mirror.empty() && (!original.empty())) {
+        original.copyTo(mirror);
+    }
+
+    return mirror;
+}
+
+void Image::to(const Image::Mode &mode, cv::UMat &out, float scale,
+               float offset) noexcept {
+    ASSERT(translatable(mode),
+           "Image::to(): Cannot translate an image of type %d to an image "
+           "of type %d on the device!", static_cast<int>(m),
+           static_cast<int>(mode));
+
+    if (!translatable(mode)) {
+        out.release();
+        return;
+    }
+
+    const auto &in = device();
+
+    /* The gray image of a native image is its luma plane */
+    if ( (m.is_native()) && (mode == Mode::GRAY) ) {
+        in.rowRange(0, boundaries.height).copyTo(out);
+        return;
+    }
+
+    if (m == mode) {
+        in.copyTo(out);
+        return;
+    }
+
+    if (m.is_depth()) {
+        in.convertTo(out, (mode == Mode::DEPTHF) ? CV_32F : CV_16U, scale,
+                     offset);
+        return;
+    }
+
+    cv::cvtColor(in, out, conversion(m, mode), m.is_native() ? 3 : 0);
 }
 
 cv::Mat Image::to(const Image::Mode &mode, float scale,
@@ -3,7 +3,7 @@
  * @file      log.cpp
  *
  * @brief     These are the definitions for the STDE, STDW and STDO file
- *            descriptors
+ *            descriptors, and for the asynchronous logging backend
  *
  *            This file is part of the VPP framework (see link).
  *
@@ -21,3 +21,264 @@
 FILE *STDE = stderr;
 FILE *STDW = stdout;
 FILE *STDO = stdout;
+
+#ifndef __ANDROID__
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace VPP {
+namespace Log {
+
+/* The longest message, longer ones being truncated */
+static constexpr std::size_t LENGTH = 256;
+
+/* The number of messages queued per thread, further ones being dropped */
+static constexpr std::size_t CAPACITY = 256;
+
+/* The number of messages of a same format printed per second */
+static constexpr uint32_t BURST = 16;
+
+/* The number of format rate limiters, formats sharing them when colliding */
+static constexpr std::size_t LIMITERS = 256;
+
+struct Message {
+    uint64_t ns;
+    FILE     *file;
+    uint32_t length;
+    char     text[LENGTH];
+};
+
+/* A single producer single consumer ring of messages per logging thread */
+struct Ring {
+    Ring() noexcept : head(0), tail(0), dropped(0), orphan(false) {}
+
+    Message               messages[CAPACITY];
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    std::atomic<uint32_t> dropped;
+    std::atomic<bool>     orphan;
+};
+
+struct Limiter {
+    std::atomic<const char *> format;
+    std::atomic<uint64_t>     second;
+    std::atomic<uint32_t>     count;
+    std::atomic<uint32_t>     suppressed;
+};
+
+/* The writer state, constant initialised so that it is still valid when the
+ * writer is destroyed on exit */
+enum State : int { IDLE = 0, RUNNING = 1, STOPPED = 2 };
+static std::atomic<int> state(IDLE);
+
+class Writer final {
+    public:
+        Writer() noexcept : registry(), rings(), writing(), pending(), 
+                            limiters(), stopping(false), thread() {
+            for (auto &l : limiters) {
+                l.format     = nullptr;
+                l.second     = 0;
+                l.count      = 0;
+                l.suppressed = 0;
+            }
+            thread = std::thread([this]() { work(); });
+            state  = RUNNING;
+        }
+
+        ~Writer() noexcept {
+            state    = STOPPED;
+            stopping = true;
+            thread.join();
+            drain();
+        }
+
+        std::shared_ptr<Ring> attach() noexcept {
+            auto ring = std::make_shared<Ring>();
+            std::lock_guard<std::mutex> lock(registry);
+            rings.push_back(ring);
+            return ring;
+        }
+
+        /* Returning the number of suppressed messages of this format if it
+         * shall be printed, or -1 if it shall be suppressed */
+        int64_t admit(const char *format, uint64_t ns) noexcept {
+            auto &l = limiters[(reinterpret_cast<uintptr_t>(format) >> 3) %
+                               LIMITERS];
+            auto second = ns / 1000000000ull;
+            if ( (l.format.load(std::memory_order_relaxed) != format) ||
+                 (l.second.load(std::memory_order_relaxed) != second) ) {
+                l.format.store(format, std::memory_order_relaxed);
+                l.second.store(second, std::memory_order_relaxed);
+                l.count.store(0, std::memory_order_relaxed);
+            }
+
+            if (l.count.fetch_add(1, std::memory_order_relaxed) >= BURST) {
+                l.suppressed.fetch_add(1, std::memory_order_relaxed);
+                return -1;
+            }
+
+            return l.suppressed.exchange(0, std::memory_order_relaxed);
+        }
+
+        /* Printing all the queued messages in their chronological order */
+        void drain() noexcept {
+            std::lock_guard<std::mutex> guard(writing);
+            {
+                std::lock_guard<std::mutex> lock(registry);
+                for (auto r = rings.begin(); r != rings.end(); ) {
+                    collect(**r);
+                    /* Rings of exited threads are forgotten once empty */
+                    if ( ((*r)->orphan) && 
+                         ((*r)->head.load() == (*r)->tail.load()) ) {
+                        r = rings.erase(r);
+                    } else {
+                        ++r;
+                    }
+                }
+            }
+
+            std::stable_sort(pending.begin(), pending.end(),
+                             [](const Message *a, const Message *b) {
+                                 return a->ns < b->ns; });
+
+            FILE *last = nullptr;
+            for (auto m : pending) {
+                fwrite(m->text, 1, m->length, m->file);
+                fputc('\n', m->file);
+                if ( (last != nullptr) && (last != m->file) ) {
+                    fflush(last);
+                }
+                last = m->file;
+            }
+            if (last != nullptr) {
+                fflush(last);
+            }
+
+            /* Releasing the ring slots of the printed messages only now */
+            for (auto &r : consumed) {
+                r.first->tail.store(r.second, std::memory_order_release);
+            }
+            pending.clear();
+            consumed.clear();
+        }
+
+    private:
+        void collect(Ring &ring) noexcept {
+            auto tail = ring.tail.load(std::memory_order_relaxed);
+            auto head = ring.head.load(std::memory_order_acquire);
+            if (tail == head) {
+                return;
+            }
+
+            for (auto i = tail; i != head; ++i) {
+                pending.push_back(&ring.messages[i % CAPACITY]);
+            }
+            consumed.emplace_back(&ring, head);
+        }
+
+        void work() noexcept {
+            while (!stopping) {
+                drain();
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        }
+
+        std::mutex                                registry;
+        std::vector<std::shared_ptr<Ring>>        rings;
+        std::mutex                                writing;
+        std::vector<const Message *>              pending;
+        std::vector<std::pair<Ring *, uint64_t>>  consumed;
+        Limiter                                   limiters[LIMITERS];
+        std::atomic<bool>                         stopping;
+        std::thread                               thread;
+};
+
+static Writer &writer() noexcept {
+    static Writer instance;
+    return instance;
+}
+
+/* The ring of the calling thread, orphaned when the thread exits */
+struct Local final {
+    Local() noexcept : ring(writer().attach()) {}
+    ~Local() noexcept {
+        ring->orphan = true;
+    }
+
+    std::shared_ptr<Ring> ring;
+};
+
+void print(FILE *file, const char *format, ...) noexcept {
+    va_list args;
+    va_start(args, format);
+
+    /* Once the writer is destroyed on exit, the messages are printed inline */
+    if (state == STOPPED) {
+        vfprintf(file, format, args);
+        fputc('\n', file);
+        va_end(args);
+        return;
+    }
+
+    auto ns = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch())
+                .count());
+
+    auto suppressed = writer().admit(format, ns);
+    if (suppressed < 0) {
+        va_end(args);
+        return;
+    }
+
+    static thread_local Local local;
+    auto &ring = *local.ring;
+    auto head  = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= CAPACITY) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        va_end(args);
+        return;
+    }
+
+    auto &m  = ring.messages[head % CAPACITY];
+    auto n   = vsnprintf(m.text, LENGTH, format, args);
+    va_end(args);
+    if (n < 0) {
+        return;
+    }
+    m.ns     = ns;
+    m.file   = file;
+    m.length = static_cast<uint32_t>(std::min<std::size_t>(n, LENGTH - 1));
+
+    /* Reporting the lost messages within the same message, if it fits */
+    auto dropped = ring.dropped.exchange(0, std::memory_order_relaxed);
+    if ( (suppressed > 0) || (dropped > 0) ) {
+        auto k = snprintf(m.text + m.length, LENGTH - m.length,
+                          " (%ld similar messages suppressed, %u dropped)",
+                          static_cast<long>(suppressed), dropped);
+        if (k > 0) {
+            m.length = static_cast<uint32_t>(
+                        std::min<std::size_t>(m.length + k, LENGTH - 1));
+        }
+    }
+
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void flush() noexcept {
+    if (state == RUNNING) {
+        writer().drain();
+    }
+}
+
+}  // namespace Log
+}  // namespace VPP
+#endif
@@ -0,0 +1,156 @@
+/**
+ *
+ * @file      vpp/metrics.cpp
+ *
+ * @brief     This is the VPP metrics endpoint implementation file
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "vpp/log.hpp"
+#include "vpp/metrics.hpp"
+#include "vpp/util/allocation.hpp"
+#include "vpp/util/io/socket.hpp"
+#include "vpp/util/ocv/pool.hpp"
+
+namespace VPP {
+
+/* How long the server waits for a connection before checking its status */
+static const int POLLING_MS = 200;
+
+static void respond(int client, const char *status, const std::string &body) {
+    std::string out("HTTP/1.0 ");
+    out += status;
+    out += "\r\nContent-Type: text/plain; version=0.0.4\r\n"
+           "Connection: close\r\nContent-Length: ";
+    out += std::to_string(body.size());
+    out += "\r\n\r\n";
+    out += body;
+
+    const char *data = out.data();
+    auto left = out.size();
+    while (left > 0) {
+        auto sent = send(client, data, left, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            break;
+        }
+        data += sent;
+        left -= static_cast<std::size_t>(sent);
+    }
+}
+
+Metrics::Metrics() noexcept 
+    : Customisation::Entity("Metrics"), serving(false), server(), 
+      listener(-1), pooling(0) {
+    port.denominate("port")
+        .describe("The TCP port serving the metrics in the Prometheus text "
+                  "format on 'GET /metrics', or 0 for not serving them")
+        .characterise(Customisation::Trait::SETTABLE);
+    port.range(0, 65535);
+    port.trigger([this](const int &p) { return onPortUpdate(p); });
+    Customisation::Entity::expose(port);
+    port = 0;
+
+    pooling = Util::Metrics::Registry::instance().attach(
+        [](Util::Metrics::Exposition &e) {
+            auto s = Util::OCV::Pool::shared().statistics();
+            e.counter("vpp_pool_allocations_total", 
+                      "Buffers allocated from the system", "", 
+                      s.allocations);
+            e.counter("vpp_pool_reuses_total", 
+                      "Buffers reused from the pool", "", s.reuses);
+            e.gauge("vpp_pool_used_bytes", 
+                    "Bytes used by the live matrices", "", s.used);
+            e.gauge("vpp_pool_pooled_bytes", 
+                    "Bytes kept in the pool", "", s.pooled);
+            e.gauge("vpp_pool_peak_bytes", 
+                    "Peak of the used and pooled bytes", "", s.peak);
+
+            /* The heap allocations, only counted in instrumented builds */
+            if (Util::Allocation::tracked()) {
+                auto h = Util::Allocation::process();
+                e.counter("vpp_heap_allocations_total",
+                          "Heap allocations of the process", "",
+                          h.allocations);
+                e.counter("vpp_heap_allocated_bytes_total",
+                          "Bytes allocated from the heap", "", h.bytes);
+            } });
+}
+
+Metrics::~Metrics() noexcept {
+    stop();
+    Util::Metrics::Registry::instance().detach(pooling);
+}
+
+void Metrics::stop() noexcept {
+    serving = false;
+    if (server.joinable()) {
+        server.join();
+    }
+    if (listener >= 0) {
+        close(listener);
+        listener = -1;
+    }
+}
+
+Customisation::Error Metrics::onPortUpdate(const int &p) noexcept {
+    stop();
+    if (p == 0) {
+        return Customisation::Error::NONE;
+    }
+
+    listener = Util::IO::Socket::listening(p, 4);
+    if (listener < 0) {
+        LOGE("%s[%s]::port(): Cannot listen on port %d: %s!",
+             value_to_string().c_str(), name().c_str(), p, strerror(errno));
+        return Customisation::Error::INVALID_VALUE;
+    }
+
+    serving = true;
+    server  = std::thread([this]() { serve(listener); });
+
+    return Customisation::Error::NONE;
+}
+
+void Metrics::serve(int socket) noexcept {
+    struct pollfd waiting;
+    waiting.fd     = socket;
+    waiting.events = POLLIN;
+
+    while (serving) {
+        if (poll(&waiting, 1, POLLING_MS) <= 0) {
+            continue;
+        }
+
+        auto client = accept(socket, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+
+        auto request = Util::IO::Socket::requested(client, POLLING_MS * 5);
+        if (request == "GET /metrics") {
+            respond(client, "200 OK",
+                    Util::Metrics::Registry::instance().collect());
+        } else if (!request.empty()) {
+            respond(client, "404 Not Found", "Not found\n");
+        }
+
+        close(client);
+    }
+}
+
+}  // namespace VPP
@@ -17,6 +17,7 @@
  **/
 
 #include "core/pipeline.tpl.hpp"
+#include "core/runner.tpl.hpp"
 #include "vpp/pipeline.hpp"
 
 namespace VPP {
@@ -24,46 +25,25 @@ namespace Core {
 
 /* Create template implementations */
 
-template<> void Pipeline<>::launch() noexcept {
-    Scene scene;
-    auto s = &scene;
-    return work(s);
-}
-
-template<> void Pipeline<>::prepare(Scene *&s) noexcept {
-    *s = std::move(Scene());
-}
+template class Runner<>;
+template class Runner<Zone>;
+template class Runner<Zones>;
 
 template class Pipeline<>;
 
 template<> void Pipeline<Zone>::launch() noexcept {
-    Scene scene;
-    Zone  zone;
-    auto s = &scene;
-    auto z = &zone;
-    return work(s, z);
-}
-
-template<> void Pipeline<Zone>::prepare(Scene *& /*s*/, Zone *&z) noexcept {
-    *z = std::move(Zone());
+    /* Single zones of a same scene all share their scene, so that they are
+     * always processed sequentially */
+    if (static_cast<int>(inflight) > 1) {
+        LOGW("%s[%s]::launch(): Single zone pipelines cannot be pipelined!",
+             value_to_string().c_str(), name().c_str());
+    }
+
+    Runner<Zone>::launch();
 }
 
 template class Pipeline<Zone>;
 
-template<> 
-void Pipeline<Zones>::launch() noexcept {
-    Scene scene;
-    Zones zones;
-    auto s = &scene;
-    auto z = &zones;
-
-    return work(s, z);
-}
-
-template<> void Pipeline<Zones>::prepare(Scene *& /*s*/, Zones *&z) noexcept {
-    *z = std::move(Zones());
-}
-
 template class Pipeline<Zones>;
 
 }  // namespace Core
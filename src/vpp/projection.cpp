@@ -0,0 +1,133 @@
+/**
+ *
+ * @file      vpp/projection.cpp
+ *
+ * @brief     This is a 3D to 2D (and vice-versa) projection implementation
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <limits>
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "vpp/projection.hpp"
+
+namespace VPP {
+
+cv::Point3f Pinhole::deproject(const cv::Point &p, float z) const noexcept {
+    float x  = (p.x - ppx) / fx;
+    float y  = (p.y - ppy) / fy;
+    float r2 = x*x + y*y;
+    float f  = 1 + (coeffs[0] + (coeffs[1] + coeffs[4]*r2)*r2)*r2;
+    float ux = x*f + 2*coeffs[2]*x*y + coeffs[3]*(r2 + 2*x*x);
+    float uy = y*f + 2*coeffs[3]*x*y + coeffs[2]*(r2 + 2*y*y);
+
+    return cv::Point3f(z*ux, z*uy, z);
+}
+
+void Pinhole::deproject(int x, int y, const float *z, int n,
+                        cv::Point3f *points) const noexcept {
+    static const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float        yn  = (y - ppy) / fy;
+    int                i   = 0;
+
+#if CV_SIMD128
+    /* Using whatever SIMD instructions OpenCV was built with (SSE, AVX or
+     * NEON) for deprojecting 4 pixels at once */
+    const cv::v_float32x4 zero = cv::v_setzero_f32();
+    const cv::v_float32x4 one  = cv::v_setall_f32(1.0f);
+    const cv::v_float32x4 two  = cv::v_setall_f32(2.0f);
+    const cv::v_float32x4 vnan = cv::v_setall_f32(nan);
+    const cv::v_float32x4 vppx = cv::v_setall_f32(ppx);
+    const cv::v_float32x4 vifx = cv::v_setall_f32(1.0f / fx);
+    const cv::v_float32x4 vy   = cv::v_setall_f32(yn);
+    const cv::v_float32x4 vy2  = vy * vy;
+    const cv::v_float32x4 k1   = cv::v_setall_f32(coeffs[0]);
+    const cv::v_float32x4 k2   = cv::v_setall_f32(coeffs[1]);
+    const cv::v_float32x4 p1   = cv::v_setall_f32(coeffs[2]);
+    const cv::v_float32x4 p2   = cv::v_setall_f32(coeffs[3]);
+    const cv::v_float32x4 k3   = cv::v_setall_f32(coeffs[4]);
+    const cv::v_float32x4 step = cv::v_setall_f32(4.0f);
+    float                 cols[4] = { static_cast<float>(x),
+                                      static_cast<float>(x + 1),
+                                      static_cast<float>(x + 2),
+                                      static_cast<float>(x + 3) };
+    cv::v_float32x4       vcol = cv::v_load(cols);
+    float                *out  = reinterpret_cast<float *>(points);
+
+    for (; i + 4 <= n; i += 4, vcol += step) {
+        auto vz  = cv::v_load(z + i);
+        auto vx  = (vcol - vppx) * vifx;
+        auto r2  = vx * vx + vy2;
+        auto f   = one + (k1 + (k2 + k3 * r2) * r2) * r2;
+        auto xy2 = two * vx * vy;
+        auto ux  = vx * f + p1 * xy2 + p2 * (r2 + two * vx * vx);
+        auto uy  = vy * f + p2 * xy2 + p1 * (r2 + two * vy2);
+        auto ok  = (vz > zero);
+
+        cv::v_store_interleave(out + 3 * i,
+                               cv::v_select(ok, vz * ux, vnan),
+                               cv::v_select(ok, vz * uy, vnan),
+                               cv::v_select(ok, vz, vnan));
+    }
+#endif /*CV_SIMD128*/
+
+    for (; i < n; ++i) {
+        if (z[i] > 0) {
+            points[i] = deproject(cv::Point(x + i, y), z[i]);
+        } else {
+            points[i] = cv::Point3f(nan, nan, nan);
+        }
+    }
+}
+
+void Projecter::project(const std::vector<cv::Point3f> &p,
+                        std::vector<cv::Point> &pixels) const noexcept {
+    pixels.resize(p.size());
+    for (std::size_t i = 0; i < p.size(); ++i) {
+        pixels[i] = project(p[i]);
+    }
+}
+
+void Projecter::deproject(const std::vector<cv::Point> &p, float z,
+                          std::vector<cv::Point3f> &points) const noexcept {
+    points.resize(p.size());
+    for (std::size_t i = 0; i < p.size(); ++i) {
+        points[i] = deproject(p[i], z);
+    }
+}
+
+void Projecter::deproject(const std::vector<cv::Point> &p,
+                          const std::vector<float> &z,
+                          std::vector<cv::Point3f> &points) const noexcept {
+    points.resize(p.size());
+    for (std::size_t i = 0; i < p.size(); ++i) {
+        points[i] = deproject(p[i], z[i]);
+    }
+}
+
+void Projecter::deproject(const cv::Mat &depth, const cv::Point &origin,
+                          cv::Mat &cloud) const noexcept {
+    static const float nan = std::numeric_limits<float>::quiet_NaN();
+
+    cloud.create(depth.size(), CV_32FC3);
+    for (int r = 0; r < depth.rows; ++r) {
+        auto *points = cloud.ptr<cv::Point3f>(r);
+        for (int c = 0; c < depth.cols; ++c) {
+            const float z = (depth.type() == CV_16UC1) ?
+                            depth.at<uint16_t>(r, c) * zscale :
+                            depth.at<float>(r, c);
+            points[c] = (z > 0) ? deproject(origin + cv::Point(c, r), z) :
+                                  cv::Point3f(nan, nan, nan);
+        }
+    }
+}
+
+}  // namespace VPP
@@ -14,50 +14,459 @@
  *
  **/
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
 #include <ctime>
 #include <functional>
 #include <iterator>
 
 #include "vpp/scene.hpp"
+#include "vpp/util/ocv/pool.hpp"
 
 namespace VPP {
 
-Scene::Scene() noexcept : view(), areas() { }
+Scene::Geometry::Geometry() noexcept 
+    : boxes(), uuids(), scores(), zones(), ox(0), oy(0), cw(1), ch(1),
+      cols(0), rows(0), starts(), entries() {}
+
+void Scene::Geometry::clear() noexcept {
+    boxes.x0.clear();
+    boxes.y0.clear();
+    boxes.x1.clear();
+    boxes.y1.clear();
+    uuids.clear();
+    scores.clear();
+    zones.clear();
+    starts.clear();
+    entries.clear();
+}
+
+void Scene::Geometry::reserve(std::size_t n) noexcept {
+    boxes.reserve(n);
+    uuids.reserve(n);
+    scores.reserve(n);
+    zones.reserve(n);
+}
+
+void Scene::Geometry::emplace_back(Zone &zone) noexcept {
+    boxes.emplace_back(zone);
+    uuids.emplace_back(zone.uuid);
+    scores.emplace_back(zone.context.score);
+    zones.emplace_back(&zone);
+
+    /* Any new entry invalidates the grid */
+    starts.clear();
+}
+
+void Scene::Geometry::iou(const cv::Rect &r, float *results) const noexcept {
+    Util::OCV::Rects src;
+    src.emplace_back(r);
+    Util::OCV::iou(src, boxes, results);
+}
+
+void Scene::Geometry::iou(const Geometry &other, float *results) 
+    const noexcept {
+    Util::OCV::iou(boxes, other.boxes, results);
+}
+
+std::vector<std::size_t> Scene::Geometry::within(const cv::Rect &r) 
+    const noexcept {
+    const auto x0 = static_cast<float>(r.x);
+    const auto y0 = static_cast<float>(r.y);
+    const auto x1 = static_cast<float>(r.x + r.width);
+    const auto y1 = static_cast<float>(r.y + r.height);
+    std::vector<std::size_t> found;
+
+    for (std::size_t i = 0; i < size(); ++i) {
+        if ( (boxes.x0[i] >= x0) && (boxes.y0[i] >= y0) &&
+             (boxes.x1[i] <= x1) && (boxes.y1[i] <= y1) ) {
+            found.emplace_back(i);
+        }
+    }
+
+    /* Copy elision */
+    return found;
+}
+
+std::vector<std::size_t> Scene::Geometry::containing(const cv::Point &p) 
+    const noexcept {
+    const auto x = static_cast<float>(p.x);
+    const auto y = static_cast<float>(p.y);
+    std::vector<std::size_t> found;
+
+    /* Right and bottom edges are excluded as in cv::Rect::contains() */
+    for (std::size_t i = 0; i < size(); ++i) {
+        if ( (boxes.x0[i] <= x) && (boxes.y0[i] <= y) &&
+             (boxes.x1[i] > x) && (boxes.y1[i] > y) ) {
+            found.emplace_back(i);
+        }
+    }
+
+    /* Copy elision */
+    return found;
+}
+
+std::vector<std::size_t> Scene::Geometry::sized(float min, float max) 
+    const noexcept {
+    const auto n = size();
+    std::vector<float> areas(n);
+    std::vector<std::size_t> found;
+
+    /* A branchless first pass over the contiguous corners for vectorising */
+    for (std::size_t i = 0; i < n; ++i) {
+        areas[i] = (boxes.x1[i] - boxes.x0[i]) * (boxes.y1[i] - boxes.y0[i]);
+    }
+
+    for (std::size_t i = 0; i < n; ++i) {
+        if ( (areas[i] >= min) && (areas[i] <= max) ) {
+            found.emplace_back(i);
+        }
+    }
+
+    /* Copy elision */
+    return found;
+}
+
+void Scene::Geometry::grid() noexcept {
+    const auto n = size();
+    starts.clear();
+    entries.clear();
+    if (n == 0) {
+        return;
+    }
+
+    /* Bounds of the entries and mean cell size */
+    float x0 = boxes.x0[0], y0 = boxes.y0[0];
+    float x1 = boxes.x1[0], y1 = boxes.y1[0];
+    float sw = 0, sh = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        x0  = std::min(x0, boxes.x0[i]);
+        y0  = std::min(y0, boxes.y0[i]);
+        x1  = std::max(x1, boxes.x1[i]);
+        y1  = std::max(y1, boxes.y1[i]);
+        sw += boxes.x1[i] - boxes.x0[i];
+        sh += boxes.y1[i] - boxes.y0[i];
+    }
+
+    ox   = x0;
+    oy   = y0;
+    cw   = std::max({ sw / n, (x1 - x0) / 64.0f, 1.0f });
+    ch   = std::max({ sh / n, (y1 - y0) / 64.0f, 1.0f });
+    cols = std::max(1, static_cast<int>(std::ceil((x1 - x0) / cw)));
+    rows = std::max(1, static_cast<int>(std::ceil((y1 - y0) / ch)));
+
+    /* Count the entries per cell, prefix sum them and then scatter them */
+    auto span = [this](std::size_t i, int &cx0, int &cy0, int &cx1, int &cy1) {
+        cx0 = static_cast<int>((boxes.x0[i] - ox) / cw);
+        cy0 = static_cast<int>((boxes.y0[i] - oy) / ch);
+        cx1 = std::min(cols - 1, static_cast<int>((boxes.x1[i] - ox) / cw));
+        cy1 = std::min(rows - 1, static_cast<int>((boxes.y1[i] - oy) / ch));
+    };
+
+    starts.assign(cols * rows + 1, 0);
+    for (std::size_t i = 0; i < n; ++i) {
+        int cx0, cy0, cx1, cy1;
+        span(i, cx0, cy0, cx1, cy1);
+        for (int cy = cy0; cy <= cy1; ++cy) {
+            for (int cx = cx0; cx <= cx1; ++cx) {
+                ++starts[cy * cols + cx + 1];
+            }
+        }
+    }
+
+    for (std::size_t c = 1; c < starts.size(); ++c) {
+        starts[c] += starts[c - 1];
+    }
+
+    std::vector<uint32_t> fill(starts.begin(), starts.end() - 1);
+    entries.resize(starts.back());
+    for (std::size_t i = 0; i < n; ++i) {
+        int cx0, cy0, cx1, cy1;
+        span(i, cx0, cy0, cx1, cy1);
+        for (int cy = cy0; cy <= cy1; ++cy) {
+            for (int cx = cx0; cx <= cx1; ++cx) {
+                entries[fill[cy * cols + cx]++] = static_cast<uint32_t>(i);
+            }
+        }
+    }
+}
+
+std::vector<std::size_t> Scene::Geometry::intersecting(const cv::Rect &r)
+    const noexcept {
+    const auto x0 = static_cast<float>(r.x);
+    const auto y0 = static_cast<float>(r.y);
+    const auto x1 = static_cast<float>(r.x + r.width);
+    const auto y1 = static_cast<float>(r.y + r.height);
+    std::vector<std::size_t> found;
+
+    auto overlaps = [&](std::size_t i) {
+        return (boxes.x0[i] < x1) && (boxes.x1[i] > x0) &&
+               (boxes.y0[i] < y1) && (boxes.y1[i] > y0);
+    };
+
+    if (!gridded()) {
+        for (std::size_t i = 0; i < size(); ++i) {
+            if (overlaps(i)) {
+                found.emplace_back(i);
+            }
+        }
+
+        /* Copy elision */
+        return found;
+    }
+
+    auto cell = [](float v, float o, float c, int n) {
+        return std::max(0, std::min(n - 1, static_cast<int>((v - o) / c)));
+    };
+
+    const int cx0 = cell(x0, ox, cw, cols), cx1 = cell(x1, ox, cw, cols);
+    const int cy0 = cell(y0, oy, ch, rows), cy1 = cell(y1, oy, ch, rows);
+    for (int cy = cy0; cy <= cy1; ++cy) {
+        for (int cx = cx0; cx <= cx1; ++cx) {
+            const auto c = cy * cols + cx;
+            for (auto e = starts[c]; e < starts[c + 1]; ++e) {
+                const auto i = entries[e];
+                if (!overlaps(i)) {
+                    continue;
+                }
+
+                /* Entries spanning several cells are only reported from the
+                 * cell holding the top-left corner of their intersection */
+                auto ix = cell(std::max(x0, boxes.x0[i]), ox, cw, cols);
+                auto iy = cell(std::max(y0, boxes.y0[i]), oy, ch, rows);
+                if ( (ix == cx) && (iy == cy) ) {
+                    found.emplace_back(i);
+                }
+            }
+        }
+    }
+
+    /* Copy elision */
+    return found;
+}
+
+/* The sequence numbers are unique across all the scenes, including the ones
+ * of the pipelines running concurrently */
+static std::atomic<uint64_t> sequenced(0);
+
+static inline uint64_t sequencing() noexcept {
+    return sequenced.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+Scene::Scene() noexcept 
+    : view(), contours(), areas(), spares(), index(), stale(false),
+      stillness(false), detected(false), departures(), serial(sequencing()),
+      discarded(), generation(0), memos() { }
+
+uint64_t Scene::latency_us() const noexcept {
+    auto captured = view.clock_us();
+    if ( (captured == 0) || (departures.empty()) ||
+         (departures.back().us < captured) ) {
+        return 0;
+    }
+
+    return departures.back().us - captured;
+}
+
+std::string Scene::breakdown() const {
+    std::string steps;
+    auto since = view.clock_us();
+    for (auto &d : departures) {
+        auto elapsed = ( (since != 0) && (d.us >= since) ) ? d.us - since : 0;
+        if (!steps.empty()) {
+            steps += ", ";
+        }
+        steps += d.stage + " +" + std::to_string(elapsed) + "us";
+        since  = d.us;
+    }
+
+    return steps;
+}
+
+Scene::Footprint Scene::footprint() noexcept {
+    Util::OCV::Footprint buffers;
+    Footprint f = { view.footprint(buffers), 0, 0 };
+
+    /* Every zone is a list node, whose predictions and labels are held in
+     * place as are the short descriptions */
+    const std::size_t node = sizeof(Zone) + 2 * sizeof(void *);
+    auto held = [&f, node](const std::list<Zone> &zones) {
+        for (auto &z : zones) {
+            f.zones    += node;
+            f.contours += z.contour.size() * sizeof(cv::Point);
+            if (z.description.capacity() >= sizeof(std::string)) {
+                f.zones += z.description.capacity() + 1;
+            }
+        }
+    };
+    held(areas);
+    held(spares);
+
+    f.zones += index.boxes.x0.capacity() * 4 * sizeof(float) +
+               index.uuids.capacity() * sizeof(uint64_t) +
+               index.scores.capacity() * sizeof(float) +
+               index.zones.capacity() * sizeof(Zone *);
+    for (auto &m : memos) {
+        f.zones += sizeof(Memo) +
+                   m.zones.capacity() * sizeof(std::reference_wrapper<Zone>);
+    }
+
+    return f;
+}
+
+void Scene::clear() noexcept {
+    view = View();
+    contours.reset();
+    spares.splice(spares.end(), areas);
+    index.clear();
+    stale     = false;
+    stillness = false;
+    detected  = false;
+    departures.clear();
+    serial = sequencing();
+    ++generation;
+}
+
+void Scene::recycle(std::list<Zone> &zones) noexcept {
+    spares.splice(spares.end(), zones);
+}
 
 Zone &Scene::mark(Zone zone) noexcept {
-    static uint64_t next_uuid = 0;
-    static Zone     invalid;
+    /* The identifiers are unique across all the scenes, including the ones
+     * of the branches marking their zones concurrently */
+    static std::atomic<uint64_t> next_uuid(0);
  
     /* Crop the zone to prevent any issue and discard outside zones */
     static_cast<cv::Rect &>(zone) = zone & view.frame(); 
     if ((zone.width <= 0 ) || (zone.height <= 0)) {
-        invalid = std::move(zone);
-        invalid.invalidate();
-        return invalid;
+        discarded = std::move(zone);
+        discarded.invalidate();
+        return discarded;
     }
 
     if (zone.uuid == 0) {
-        zone.uuid = ++next_uuid;
-        /* Update the zone state contents */
-        zone.deproject(view);
+        zone.uuid = next_uuid.fetch_add(1, std::memory_order_relaxed) + 1;
+        /* Update the zone state contents, only deprojected on demand */
+        zone.flatten();
     }
 
-    areas.emplace_back(std::move(zone));
+    if (spares.empty()) {
+        areas.emplace_back(std::move(zone));
+    } else {
+        spares.front() = std::move(zone);
+        areas.splice(areas.end(), spares, spares.begin());
+    }
+    if (!stale) {
+        index.emplace_back(areas.back());
+    }
+    ++generation;
 
     return areas.back();
 }
+
+void Scene::deproject() noexcept {
+    if (!view.depth.available()) {
+        return;
+    }
+
+    /* Gather the corners of the flat zones at the depth of their centres */
+    std::vector<Zone *>      flats;
+    std::vector<cv::Point>   corners;
+    std::vector<float>       depths;
+    std::vector<cv::Point3f> points;
+    for (auto &zone : areas) {
+        if (zone.deprojected) {
+            continue;
+        }
+        auto tl = zone.tl();
+        auto br = zone.br();
+        auto z  = view.depth.at((tl+br)/2);
+        flats.push_back(&zone);
+        corners.push_back(tl);
+        corners.push_back(br);
+        depths.push_back(z);
+        depths.push_back(z);
+    }
+
+    if (flats.empty()) {
+        return;
+    }
+
+    view.depth.deproject(corners, depths, points);
+    for (std::size_t i = 0; i < flats.size(); ++i) {
+        const auto &tl = points[2*i];
+        const auto &br = points[2*i+1];
+        auto        sz = br-tl;
+        auto &state    = flats[i]->state;
+
+        state.centre = (tl+br)/2;
+        state.size.x = sz.x;
+        state.size.y = sz.y;
+        flats[i]->deprojected = true;
+    }
+}
+
+void Scene::flatten() noexcept {
+    for (auto &zone : areas) {
+        if (zone.deprojected) {
+            zone.flatten();
+        }
+    }
+}
+
+const Scene::Geometry &Scene::geometry() noexcept {
+    if (stale) {
+        index.clear();
+        index.reserve(areas.size());
+        for (auto &zone : areas) {
+            index.emplace_back(zone);
+        }
+        stale = false;
+    }
+
+    return index;
+}
         
+Zones Scene::zones(const cv::Rect &area) noexcept {
+    geometry();
+    if ( (!index.gridded()) && (index.size() >= gridding) ) {
+        index.grid();
+    }
+
+    Zones found;
+    for (auto i : index.intersecting(area)) {
+        found.emplace_back(*index.zones[i]);
+    }
+
+    /* Copy elision */
+    return found;
+}
+
+Zones Scene::overlapping(const Zone &zone) noexcept {
+    Zones found(zones(static_cast<const cv::Rect &>(zone)));
+    found.erase(std::remove_if(found.begin(), found.end(), 
+                               [&zone](const Zone &z) {
+                                   return &z == &zone;
+                               }), found.end());
+
+    /* Copy elision */
+    return found;
+}
+
 ConstZones Scene::zones() const noexcept {
     return ConstZones(areas.cbegin(), areas.cend());
 }
 
 Zones Scene::zones() noexcept {
+    stale = true;
     return Zones(areas.begin(), areas.end());
 }
 
 Zones Scene::zones(const ZoneFilterDelegate &f) noexcept {
     Zones filtered;
+    stale = true;
     for (auto &zone : areas) {
         if (f.filter(zone)) {
             filtered.emplace_back(zone);
@@ -82,6 +491,7 @@ ConstZones Scene::zones(const ZoneFilterDelegate &f) const noexcept {
 
 Zones Scene::zones(const ZoneFilter &filter) noexcept {
     Zones filtered;
+    stale = true;
     for (auto &zone : areas) {
         if (filter(zone)) {
             filtered.emplace_back(zone);
@@ -104,8 +514,99 @@ ConstZones Scene::zones(const ZoneFilter &filter) const noexcept {
     return filtered;
 }
 
+Zones Scene::zones(const Classes &c) noexcept {
+    Zones filtered;
+    zones(c, filtered);
+
+    /* Copy elision */
+    return filtered;
+}
+
+ConstZones Scene::zones(const Classes &c) const noexcept {
+    ConstZones filtered;
+    for (auto const&zone : areas) {
+        if (zone.context.is_in(c)) {
+            filtered.emplace_back(zone);
+        }
+    }
+
+    /* Copy elision */
+    return filtered;
+}
+
+void Scene::zones(Zones &into) noexcept {
+    stale = true;
+    into.clear();
+    for (auto &zone : areas) {
+        into.emplace_back(zone);
+    }
+}
+
+void Scene::zones(const ZoneFilterDelegate &f, Zones &into) noexcept {
+    stale = true;
+    into.clear();
+    for (auto &zone : areas) {
+        if (f.filter(zone)) {
+            into.emplace_back(zone);
+        }
+    }
+}
+
+void Scene::zones(const ZoneFilter &filter, Zones &into) noexcept {
+    stale = true;
+    into.clear();
+    for (auto &zone : areas) {
+        if (filter(zone)) {
+            into.emplace_back(zone);
+        }
+    }
+}
+
+void Scene::zones(const Classes &c, Zones &into) noexcept {
+    stale = true;
+    into.clear();
+    for (auto &zone : areas) {
+        if (zone.context.is_in(c)) {
+            into.emplace_back(zone);
+        }
+    }
+}
+
+const Zones &Scene::memoised(const ZoneFilterDelegate *f) noexcept {
+    /* The zones of the views may be altered, as for any other mutable view */
+    stale = true;
+
+    auto memo = std::find_if(memos.begin(), memos.end(),
+                             [f](const Memo &m) { return m.filter == f; });
+    if (memo == memos.end()) {
+        memos.push_back(Memo{ f, generation, Zones() });
+        memo = std::prev(memos.end());
+    } else if (memo->generation == generation) {
+        return memo->zones;
+    }
+
+    if (f == nullptr) {
+        zones(memo->zones);
+    } else {
+        zones(*f, memo->zones);
+    }
+    memo->generation = generation;
+
+    return memo->zones;
+}
+
+const Zones &Scene::cached() noexcept {
+    return memoised(nullptr);
+}
+
+const Zones &Scene::cached(const ZoneFilterDelegate &f) noexcept {
+    return memoised(&f);
+}
+
 std::list<Zone> Scene::extract(const ZoneFilterDelegate &f) noexcept {
     std::list<Zone> exfiltered;
+    stale = true;
+    ++generation;
 
     for (auto it = areas.begin(); it != areas.end(); ) {
         auto n = std::next(it, 1);
@@ -121,6 +622,8 @@ std::list<Zone> Scene::extract(const ZoneFilterDelegate &f) noexcept {
 
 std::list<Zone> Scene::extract(const ZoneFilter &filter) noexcept {
     std::list<Zone> exfiltered;
+    stale = true;
+    ++generation;
 
     for (auto it = areas.begin(); it != areas.end();) {
         auto n = std::next(it, 1);
@@ -134,14 +637,78 @@ std::list<Zone> Scene::extract(const ZoneFilter &filter) noexcept {
     return exfiltered;
 }
 
+std::list<Zone> Scene::extract(const Classes &c) noexcept {
+    std::list<Zone> exfiltered;
+    stale = true;
+    ++generation;
+
+    for (auto it = areas.begin(); it != areas.end();) {
+        auto n = std::next(it, 1);
+        if (it->context.is_in(c)) {
+            exfiltered.splice(exfiltered.end(), areas, it);
+        } 
+        it = n;
+    }
+
+    /* Copy elision */
+    return exfiltered;
+}
+
+Scene::ZoneFilter Scene::filter(Classes c) noexcept {
+    return [c](const Zone &zone) noexcept { return zone.context.is_in(c); };
+}
+
 Scene Scene::remember() const noexcept {
     Scene copy;
     
     /* This is a copy of the scene to be used carefully */
     copy.view  = view;
     copy.areas = areas;
+    copy.stale = true;
 
     return copy;
 }
 
+void Scene::remember(Scene &into) const noexcept {
+    /* List assignment reuses the existing nodes, and zone assignment reuses
+     * their descriptions and shares their contours */
+    into.view  = view;
+    into.areas = areas;
+    into.stale = true;
+    ++into.generation;
+}
+
+Scene Scene::remember(const Zone::Copier &copier) const noexcept {
+    Scene copy;
+    remember(copy, copier);
+
+    return copy;
+}
+
+void Scene::remember(Scene &into, const Zone::Copier &copier) const noexcept {
+    into.view = view;
+
+    while (into.areas.size() > areas.size()) {
+        into.spares.splice(into.spares.end(), into.areas, 
+                           std::prev(into.areas.end()));
+    }
+    while (into.areas.size() < areas.size()) {
+        if (into.spares.empty()) {
+            into.areas.emplace_back();
+        } else {
+            into.areas.splice(into.areas.end(), into.spares, 
+                              into.spares.begin());
+        }
+    }
+
+    auto out = into.areas.begin();
+    for (auto const &zone : areas) {
+        zone.copy(*out, copier);
+        out->context = zone.context;
+        ++out;
+    }
+    into.stale = true;
+    ++into.generation;
+}
+
 }  // namespace VPP
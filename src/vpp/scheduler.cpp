@@ -0,0 +1,370 @@
+/**
+ *
+ * @file      vpp/scheduler.cpp
+ *
+ * @brief     This is the VPP cross-pipeline scheduler implementation file
+ *
+ * @details   This is a closed-loop scheduler sharing the workers of a process
+ *            between the streams of pipelines it runs.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+
+#include "vpp/log.hpp"
+#include "vpp/scheduler.hpp"
+#include "vpp/util/task.hpp"
+
+namespace VPP {
+
+Scheduler::Stream::Stream() noexcept
+    : Customisation::Entity("Schedule"), scheduler(nullptr), decimators(),
+      scalers(), coster(), latencies(), admitted(false) {
+    weight.denominate("weight")
+          .describe("The share of the workers of the stream, relative to the "
+                    "weights of the other streams")
+          .characterise(Customisation::Trait::SETTABLE);
+    weight.range(1, 100);
+    Customisation::Entity::expose(weight);
+    weight = 1;
+
+    rate.denominate("rate")
+        .describe("The frame rate expected from the stream")
+        .characterise(Customisation::Trait::SETTABLE);
+    rate.range(0.1f, 240.0f);
+    Customisation::Entity::expose(rate);
+    rate = 25.0f;
+
+    target.denominate("target")
+          .describe("The 90th percentile of the end to end latency targeted "
+                    "in milliseconds (0 for only sharing the workers fairly)")
+          .characterise(Customisation::Trait::SETTABLE);
+    target.range(0, 10000);
+    Customisation::Entity::expose(target);
+    target = 0;
+
+    decimation.denominate("decimation")
+              .describe("The actual decimation of the costly stages of the "
+                        "stream")
+              .characterise(Customisation::Trait::SETTABLE);
+    decimation.range(1, 1000);
+    Customisation::Entity::expose(decimation);
+    decimation = 1;
+
+    scale.denominate("scale")
+         .describe("The actual processing scale of the stream")
+         .characterise(Customisation::Trait::SETTABLE);
+    scale.range(0.1f, 1.0f);
+    Customisation::Entity::expose(scale);
+    scale = 1.0f;
+}
+
+void Scheduler::Stream::decimate(Decimator d) noexcept {
+    decimators.emplace_back(std::move(d));
+}
+
+void Scheduler::Stream::rescale(Scaler s) noexcept {
+    scalers.emplace_back(std::move(s));
+}
+
+void Scheduler::Stream::cost(Coster c) noexcept {
+    coster = std::move(c);
+}
+
+uint64_t Scheduler::Stream::estimate() noexcept {
+    uint64_t ns = (coster != nullptr) ? coster() : 0;
+    return (ns != 0) ? ns : latencies.percentile(0.5);
+}
+
+void Scheduler::Stream::apply() noexcept {
+    int   every = decimation;
+    float s     = scale;
+
+    for (auto &d : decimators) {
+        d(every);
+    }
+    for (auto &a : scalers) {
+        a(s);
+    }
+}
+
+bool Scheduler::Stream::admit() noexcept {
+    if (scheduler == nullptr) {
+        return true;
+    }
+
+    /* Inside a lock_guard scoped block */
+    std::lock_guard<std::mutex> lock(scheduler->access);
+    if (admitted) {
+        return true;
+    }
+
+    /* A stream never run is assumed to cost as much as the admitted ones */
+    double   used  = 0.0;
+    uint64_t known = 0;
+    int      n     = 0;
+    for (auto &s : scheduler->streams) {
+        if (s.get().admitted) {
+            used  += scheduler->demand(s.get());
+            known += s.get().estimate();
+            ++n;
+        }
+    }
+
+    auto ns = estimate();
+    if ( (ns == 0) && (n > 0) ) {
+        ns = known / n;
+    }
+    double needed = static_cast<double>(ns) * static_cast<float>(rate);
+    double room   = scheduler->available();
+
+    if (used + needed > room) {
+        LOGW("%s[%s]::admit(): Not admitted, as it needs %.0fms/s of the "
+             "%.0fms/s left", value_to_string().c_str(), name().c_str(),
+             needed / 1e6, std::max(0.0, room - used) / 1e6);
+        return false;
+    }
+
+    decimation = 1;
+    scale      = 1.0f;
+    apply();
+    latencies.reset();
+    admitted = true;
+
+    return true;
+}
+
+void Scheduler::Stream::retire() noexcept {
+    if (scheduler == nullptr) {
+        return;
+    }
+
+    /* Inside a lock_guard scoped block */
+    std::lock_guard<std::mutex> lock(scheduler->access);
+    admitted = false;
+}
+
+void Scheduler::Stream::measure(uint64_t latency) noexcept {
+    latencies.record(latency);
+    if (scheduler != nullptr) {
+        scheduler->evaluate();
+    }
+}
+
+Scheduler::Scheduler() noexcept
+    : Customisation::Entity("Scheduler"), access(), streams(), evaluated(0) {
+    capacity.denominate("capacity")
+            .describe("The share of the workers of the pool the streams may "
+                      "use")
+            .characterise(Customisation::Trait::SETTABLE);
+    capacity.range(0.1f, 1.0f);
+    Customisation::Entity::expose(capacity);
+    capacity = 0.9f;
+
+    largest.denominate("largest")
+           .describe("The largest decimation of the costly stages of a "
+                     "stream")
+           .characterise(Customisation::Trait::SETTABLE);
+    largest.range(1, 100);
+    Customisation::Entity::expose(largest);
+    largest = 4;
+
+    minimum.denominate("minimum")
+           .describe("The minimal processing scale of a stream")
+           .characterise(Customisation::Trait::SETTABLE);
+    minimum.range(0.1f, 1.0f);
+    Customisation::Entity::expose(minimum);
+    minimum = 0.5f;
+
+    step.denominate("step")
+        .describe("The ratio between two successive processing scales")
+        .characterise(Customisation::Trait::SETTABLE);
+    step.range(1.05f, 2.0f);
+    Customisation::Entity::expose(step);
+    step = 1.25f;
+
+    hysteresis.denominate("hysteresis")
+              .describe("The margin below the targets and the capacity for "
+                        "restoring the degraded streams")
+              .characterise(Customisation::Trait::SETTABLE);
+    hysteresis.range(0.0f, 0.9f);
+    Customisation::Entity::expose(hysteresis);
+    hysteresis = 0.3f;
+
+    period.denominate("period")
+          .describe("The period in milliseconds between two evaluations")
+          .characterise(Customisation::Trait::SETTABLE);
+    period.range(100, 60000);
+    Customisation::Entity::expose(period);
+    period = 2000;
+}
+
+void Scheduler::enrol(Stream &stream) noexcept {
+    /* Inside a lock_guard scoped block */
+    std::lock_guard<std::mutex> lock(access);
+    stream.scheduler = this;
+    streams.emplace_back(stream);
+}
+
+double Scheduler::demand(Stream &stream) noexcept {
+    return static_cast<double>(stream.estimate()) *
+           static_cast<float>(stream.rate);
+}
+
+double Scheduler::available() noexcept {
+    auto workers = std::max(1, Util::Task::Pool::instance().size());
+    return workers * 1e9 * static_cast<float>(capacity);
+}
+
+bool Scheduler::degrade(Stream &stream) noexcept {
+    int   every = stream.decimation;
+    float s     = stream.scale;
+    float lower = minimum;
+
+    /* Decimating first, as the tracking carries the zones between the
+     * decimated scenes, then scaling down */
+    if (every < static_cast<int>(largest)) {
+        stream.decimation = every + 1;
+    } else if (s > lower) {
+        stream.scale = std::max(lower, s / static_cast<float>(step));
+    } else {
+        return false;
+    }
+
+    LOGI("%s[%s]::evaluate(): Degrading to a decimation of %d and a scale of "
+         "%.2f", stream.value_to_string().c_str(), stream.name().c_str(),
+         static_cast<int>(stream.decimation),
+         static_cast<float>(stream.scale));
+    stream.apply();
+    return true;
+}
+
+bool Scheduler::restore(Stream &stream) noexcept {
+    int   every = stream.decimation;
+    float s     = stream.scale;
+
+    /* Restoring in the reverse order of the degradation */
+    if (s < 1.0f) {
+        stream.scale = std::min(1.0f, s * static_cast<float>(step));
+    } else if (every > 1) {
+        stream.decimation = every - 1;
+    } else {
+        return false;
+    }
+
+    LOGI("%s[%s]::evaluate(): Restoring to a decimation of %d and a scale of "
+         "%.2f", stream.value_to_string().c_str(), stream.name().c_str(),
+         static_cast<int>(stream.decimation),
+         static_cast<float>(stream.scale));
+    stream.apply();
+    return true;
+}
+
+void Scheduler::evaluate() noexcept {
+    std::unique_lock<std::mutex> lock(access, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+
+    auto now = Util::Histogram::now();
+    if (evaluated == 0) {
+        evaluated = now;
+        return;
+    }
+    if (now - evaluated < static_cast<uint64_t>(static_cast<int>(period)) *
+                          1000000ull) {
+        return;
+    }
+    evaluated = now;
+
+    /* The fair share of a stream is its weighted part of the capacity */
+    std::vector<std::reference_wrapper<Stream>> active;
+    std::vector<double> demands;
+    double total  = 0.0;
+    int    weighs = 0;
+    for (auto &s : streams) {
+        if (s.get().admitted) {
+            active.emplace_back(s);
+            demands.emplace_back(demand(s.get()));
+            total  += demands.back();
+            weighs += static_cast<int>(s.get().weight);
+        }
+    }
+    if (active.empty()) {
+        return;
+    }
+
+    const double room       = available();
+    const bool   overloaded = (total > room);
+    const float  margin     = 1.0f - static_cast<float>(hysteresis);
+
+    std::vector<bool> over(active.size(), false);
+    std::vector<bool> relaxed(active.size(), false);
+    for (std::size_t i = 0; i < active.size(); ++i) {
+        auto &s    = active[i].get();
+        int  goal  = s.target;
+        auto p90   = s.latencies.percentile(0.9) / 1e6f;
+        auto late  = (goal > 0) && (s.latencies.count() > 0) && (p90 > goal);
+        auto share = room * static_cast<int>(s.weight) / weighs;
+        over[i]    = late || (overloaded && (demands[i] > share));
+        relaxed[i] = ( (goal == 0) || (p90 < goal * margin) ) &&
+                     (total < room * margin);
+        s.latencies.reset();
+    }
+
+    /* The late and greedy streams are degraded first, and only once they are
+     * all degraded their most, the lightest other stream is */
+    bool stuck    = false;
+    bool degraded = false;
+    for (std::size_t i = 0; i < active.size(); ++i) {
+        if (over[i]) {
+            degraded = true;
+            stuck    = (!degrade(active[i].get())) || stuck;
+        }
+    }
+
+    if (degraded) {
+        if ( (stuck) && (overloaded) ) {
+            int lightest = -1;
+            for (std::size_t i = 0; i < active.size(); ++i) {
+                if ( (!over[i]) &&
+                     ( (lightest < 0) ||
+                       (static_cast<int>(active[i].get().weight) <
+                        static_cast<int>(active[lightest].get().weight)) ) ) {
+                    lightest = static_cast<int>(i);
+                }
+            }
+            if (lightest >= 0) {
+                degrade(active[lightest].get());
+            }
+        }
+        return;
+    }
+
+    /* Restoring a single stream per period, the heaviest first */
+    int heaviest = -1;
+    for (std::size_t i = 0; i < active.size(); ++i) {
+        auto &s = active[i].get();
+        if ( (relaxed[i]) &&
+             ( (static_cast<int>(s.decimation) > 1) ||
+               (static_cast<float>(s.scale) < 1.0f) ) &&
+             ( (heaviest < 0) ||
+               (static_cast<int>(s.weight) >
+                static_cast<int>(active[heaviest].get().weight)) ) ) {
+            heaviest = static_cast<int>(i);
+        }
+    }
+    if (heaviest >= 0) {
+        restore(active[heaviest].get());
+    }
+}
+
+}  // namespace VPP
@@ -21,6 +21,9 @@ namespace Stage {
 
 Blur::Blur() noexcept : ForScene(true), skipping() {
     use("skipping", skipping);
+
+    /* Only measuring the sharpness of the gray image, which can be forked */
+    declare(Resource::NONE, Resource::NONE, { Image::Mode::GRAY });
 }
 
 }  // namespace Stage
@@ -0,0 +1,35 @@
+/**
+ *
+ * @file      vpp/stage/cache.cpp
+ *
+ * @brief     These are the VPP classification cache stages implementation
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "vpp/stage/cache.hpp"
+
+namespace VPP {
+namespace Stage {
+namespace Cache {
+
+Lookup::Lookup(VPP::Engine::Cache::Store &store) noexcept 
+    : ForZone(true), lookup(store) {
+    use("lookup", lookup);
+}
+
+Record::Record(VPP::Engine::Cache::Store &store) noexcept 
+    : ForZone(true), record(store) {
+    use("record", record);
+}
+
+}  // namespace Cache
+}  // namespace Stage
+}  // namespace VPP
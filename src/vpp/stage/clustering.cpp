@@ -21,6 +21,9 @@ namespace Stage {
 
 Clustering::Clustering() noexcept : ForScene(true), basic() {
     use("basic", basic);
+
+    /* Only clustering the zones, without reading any image */
+    consume({});
 }
 
 }  // namespace Stage
@@ -0,0 +1,30 @@
+/**
+ *
+ * @file      vpp/stage/culling.cpp
+ *
+ * @brief     This is the VPP zone culling stage implementation
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "vpp/stage/culling.hpp"
+
+namespace VPP {
+namespace Stage {
+
+Culling::Culling() noexcept : ForScene(true), depth() {
+    use("depth", depth);
+
+    /* Only reading the depth map, which is never released */
+    consume({});
+}
+
+}  // namespace Stage
+}  // namespace VPP
@@ -21,23 +21,204 @@ namespace VPP {
 namespace Stage {
 namespace DNN {
 
-Detector::Detector() noexcept : ForScene(true) {
+Detector::Detector() noexcept 
+    : ForScene(true), tracking(), proposals(), predictions(), elapsed(0),
+      passes(0) {
 #ifdef VPP_HAS_OPENCV_DNN_SUPPORT
+    use("cascade", cascade);
     use("ocv", ocv);
 #endif
 #ifdef VPP_HAS_DARKNET_SUPPORT
     use("darknet", darknet);
 #endif
+#ifdef VPP_HAS_TFLITE_SUPPORT
+    use("tflite", tflite);
+#endif
+#ifdef VPP_HAS_TRACKING_SUPPORT
+    use("background", background);
+#endif
+
+    interval.denominate("interval")
+            .describe("The number of frames between two detections, the "
+                      "tracker propagating the zones in between")
+            .characterise(Customisation::Trait::SETTABLE);
+    interval.range(1, 1000);
+    expose(interval);
+
+    threshold.denominate("threshold")
+             .describe("The tracking confidence below which a detection is "
+                       "performed regardless of the interval")
+             .characterise(Customisation::Trait::SETTABLE);
+    threshold.range(0.0f, 1.0f);
+    expose(threshold);
+
+    cropped.denominate("cropped")
+           .describe("Is the detection only performed within the regions "
+                     "proposed for the scene ?")
+           .characterise(Customisation::Trait::SETTABLE);
+    cropped.use(Customisation::Translator::BoolFormat::NO_YES);
+    expose(cropped);
+
+    coverage.denominate("coverage")
+            .describe("The share of the frame covered by the proposed regions "
+                      "above which the full frame is processed instead")
+            .characterise(Customisation::Trait::SETTABLE);
+    coverage.range(0.0f, 1.0f);
+    expose(coverage);
+
+    predicted.denominate("predicted")
+             .describe("Is the detection only performed within the regions "
+                       "predicted by the tracker ?")
+             .characterise(Customisation::Trait::SETTABLE);
+    predicted.use(Customisation::Translator::BoolFormat::NO_YES);
+    expose(predicted);
+
+    refresh.denominate("refresh")
+           .describe("The number of detections between two full frame "
+                     "detections when predicted")
+           .characterise(Customisation::Trait::SETTABLE);
+    refresh.range(1, 1000);
+    expose(refresh);
+
+#ifdef VPP_HAS_TRACKING_SUPPORT
+    gated.denominate("gated")
+         .describe("Is the detection only performed when the background "
+                   "engine finds enough foreground in the scene ?")
+         .characterise(Customisation::Trait::SETTABLE);
+    gated.use(Customisation::Translator::BoolFormat::NO_YES);
+    expose(gated);
+
+    activity.denominate("activity")
+            .describe("The share of foreground pixels in the scene below "
+                      "which a gated detection is skipped")
+            .characterise(Customisation::Trait::SETTABLE);
+    activity.range(0.0f, 1.0f);
+    expose(activity);
+
+    gated    = false;
+    activity = 0.01f;
+#endif
+
+    /* Detect on every frame and in the full frame by default */
+    interval  = 1;
+    threshold = 0.5f;
+    cropped   = false;
+    coverage  = 0.5f;
+    predicted = false;
+    refresh   = 10;
+
+    /* The networks read the BGR images, the background subtraction the gray
+     * ones, and the detections only add zones, hence the stage can be
+     * forked */
+    declare(Resource::NONE, Resource::ZONES,
+            { Image::Mode::BGR, Image::Mode::GRAY });
+}
+
+/* Do the regions cover at most the given share of the scene frame ? */
+static bool covers(const Scene &s, const std::vector<cv::Rect> &rois,
+                   float share) noexcept {
+    int covered = 0;
+    for (auto &r : rois) {
+        covered += r.area();
+    }
+    return covered <= share * s.view.frame().area();
+}
+
+bool Detector::suspendable() const noexcept {
+    return false;
+}
+
+Error::Type Detector::process(Scene &s) noexcept {
+#ifdef VPP_HAS_TRACKING_SUPPORT
+    /* The background model learns every frame, even the skipped ones */
+    if (gated) {
+        auto e = background.measure(s);
+        if (e != Error::NONE) {
+            return e;
+        }
+        if (background.foreground(s) < activity) {
+            return Error::NONE;
+        }
+    }
+#endif
+
+    if ( (++elapsed < interval) && 
+         ((!tracking) || (tracking() >= threshold)) ) {
+        return Error::NONE;
+    }
+
+    elapsed = 0;
+    s.keyframe(true);
+
+    /* Detect around the tracked zones, all at once when the engine can */
+    std::vector<cv::Rect> rois;
+    if ( (predicted) && (predictions) && (++passes < refresh) && 
+         (predictions(s, rois)) && (covers(s, rois, coverage)) ) {
+#ifdef VPP_HAS_OPENCV_DNN_SUPPORT
+        if (static_cast<std::string>(engine) == "ocv") {
+            return ocv.process(s, rois);
+        }
+#endif
+        return detect(s, rois);
+    }
+    passes = 0;
+
+    /* Fall back to the full frame without any fresh region proposal */
+    if ( (!cropped) || (!proposals) || (!proposals(s, rois)) ) {
+        return ForScene::process(s);
+    }
+
+    if (!covers(s, rois, coverage)) {
+        return ForScene::process(s);
+    }
+
+    return detect(s, rois);
+}
+
+Error::Type Detector::detect(Scene &s, 
+                             const std::vector<cv::Rect> &rois) noexcept {
+    const cv::Mat &frame = s.view.bgr().input();
+
+    for (auto &r : rois) {
+        /* Detect within a scene viewing the region only */
+        Scene crop;
+        crop.view.stamp(s.ts_ms());
+        crop.keyframe(true);
+        crop.view.use(frame(r), VPP::Image::Mode::BGR);
+        auto e = ForScene::process(crop);
+        if (e != Error::NONE) {
+            return e;
+        }
+
+        /* And map the detected zones back to the frame coordinates */
+        for (auto &z : crop.zones()) {
+            Zone zone(z.get());
+            zone.x += r.x;
+            zone.y += r.y;
+            s.mark(std::move(zone));
+        }
+    }
+
+    return Error::NONE;
 }
 
 Classifier::Classifier() noexcept : ForZone(true) {
 #ifdef VPP_HAS_OPENCV_DNN_SUPPORT
     use("ocv", ocv);
+#endif
+#ifdef VPP_HAS_TFLITE_SUPPORT
+    use("tflite", tflite);
 #endif
     filter = ([](const Scene &, const Zone &z) noexcept { 
                         return !VPP::DNN::Dataset::isText(z); });
 }
 
+Classifiers::Classifiers() noexcept : ForZones(true) {
+#ifdef VPP_HAS_OPENCV_DNN_SUPPORT
+    use("ocv", ocv);
+#endif
+}
+
 }  // namespace DNN
 }  // namespace Stage
 }  // namespace VPP
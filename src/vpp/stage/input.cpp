@@ -22,13 +22,17 @@ namespace VPP {
 namespace Stage {
 
 template <typename ...Z> Input<Z...>::Input() noexcept
-    : Core::Stage<Z...>(false), bridge() {
-    this->use("bridge", bridge);
+    : Core::Stage<Z...>(false), bridge(), downlink() {
+    this->use("bridge",   bridge);
+    this->use("downlink", downlink);
 }
 
-Input<>::Input() noexcept : Core::Stage<>(false), bridge(), capture() {
-    use("bridge",  bridge);
-    use("capture", capture);
+Input<>::Input() noexcept : Core::Stage<>(false), bridge(), capture(),
+                            cameras(), subscription() {
+    use("bridge",       bridge);
+    use("capture",      capture);
+    use("cameras",      cameras);
+    use("subscription", subscription);
 }
 
 /* Create template implementations */
@@ -0,0 +1,31 @@
+/**
+ *
+ * @file      vpp/stage/motion.cpp
+ *
+ * @brief     This is the VPP motion handling stage implementation
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "vpp/stage/motion.hpp"
+
+namespace VPP {
+namespace Stage {
+
+Motion::Motion() noexcept : ForScene(true), proposal() {
+    use("proposal", proposal);
+
+    /* The flow is only estimated on the gray images, around the zones of the
+     * scene, and is added to its view, hence the stage cannot be forked */
+    declare(Resource::ZONES, Resource::VIEW, { Image::Mode::GRAY });
+}
+
+}  // namespace Stage
+}  // namespace VPP
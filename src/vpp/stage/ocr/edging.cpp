@@ -22,6 +22,9 @@ namespace OCR {
 
 Edging::Edging() noexcept : ForScene(true), engine() {
     use("engine", engine);
+
+    /* The edges are only searched in the BGR planes */
+    consume({ Image::Mode::BGR });
 }
 
 }  // namespace Reader
@@ -22,6 +22,17 @@ namespace OCR {
 
 MSER::MSER() noexcept : ForScene(true), mser() {
     use("mser", mser);
+#ifdef VPP_HAS_OPENCV_DNN_SUPPORT
+    use("east", east);
+#endif
+
+    /* Only adding text zones, around the zones of the scene if restricted,
+     * which can be forked */
+    declare(Resource::ZONES, Resource::ZONES,
+            { Image::Mode::BGR, Image::Mode::GRAY });
+
+    /* The regions may be searched in the channels of any colour mode */
+    consume({ Image::Mode::HSV, Image::Mode::YUV, Image::Mode::YCrCb });
 }
 
 }  // namespace Reader
@@ -30,6 +30,13 @@ Reader::Reader() noexcept : ForZone(true) {
                         return VPP::DNN::Dataset::isText(z); });
 }
 
+Readers::Readers() noexcept : ForZones(true) {
+#ifdef VPP_HAS_TESSERACT_SUPPORT
+    tesseract.selection = VPP::DNN::Dataset::isText;
+    use("tesseract", tesseract);
+#endif
+}
+
 }  // namespace Reader
 }  // namespace Stage
 }  // namespace VPP
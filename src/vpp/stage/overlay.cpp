@@ -23,6 +23,9 @@ namespace Overlay {
 template <typename ...Z> 
 Core<Z...>::Core() noexcept : VPP::Core::Stage<Z...>(true), ocv() {
     VPP::Core::Stage<Z...>::use("ocv", ocv);
+
+    /* Only drawing onto the BGR image */
+    VPP::Core::Stage<Z...>::consume({ Image::Mode::BGR });
 }
 
 /* Create template implementations */
@@ -0,0 +1,31 @@
+/**
+ *
+ * @file      vpp/stage/publisher.cpp
+ *
+ * @brief     This the VPP publisher stage
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "vpp/stage/publisher.hpp"
+
+namespace VPP {
+namespace Stage {
+
+Publisher::Publisher() noexcept : ForScene(true), wire(), uplink() {
+    use("wire",   wire);
+    use("uplink", uplink);
+
+    /* Only the crops of the uplink read the BGR image */
+    consume({ Image::Mode::BGR });
+}
+
+}  // namespace Stage
+}  // namespace VPP
@@ -0,0 +1,32 @@
+/**
+ *
+ * @file      vpp/stage/recorder.cpp
+ *
+ * @brief     This the VPP recorder stage
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "vpp/stage/recorder.hpp"
+
+namespace VPP {
+namespace Stage {
+
+Recorder::Recorder() noexcept : ForScene(true), recorder() {
+    use("recorder", recorder);
+
+    /* Recording the first colour image of the view, besides the depth and
+     * motion maps which are never released */
+    consume({ Image::Mode::BGR, Image::Mode::HSV, Image::Mode::YUV,
+              Image::Mode::YCrCb });
+}
+
+}  // namespace Stage
+}  // namespace VPP
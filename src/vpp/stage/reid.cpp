@@ -0,0 +1,40 @@
+/**
+ *
+ * @file      vpp/stage/reid.cpp
+ *
+ * @brief     This is the VPP re-identification stage implementation
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "vpp/stage/reid.hpp"
+
+namespace VPP {
+namespace Stage {
+
+Reid::Reid() noexcept
+    : ForScene(true), gallery()
+#ifdef VPP_HAS_OPENCV_DNN_SUPPORT
+      , ocv(gallery)
+#endif
+{
+#ifdef VPP_HAS_OPENCV_DNN_SUPPORT
+    use("ocv", ocv);
+#endif
+
+    gallery.denominate("gallery");
+    expose(gallery);
+
+    /* The embeddings are inferred on the BGR crops */
+    consume({ Image::Mode::BGR });
+}
+
+}  // namespace Stage
+}  // namespace VPP
@@ -0,0 +1,27 @@
+/**
+ *
+ * @file      vpp/stage/selection.cpp
+ *
+ * @brief     This is the VPP zone selection stage implementation
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "vpp/stage/selection.hpp"
+
+namespace VPP {
+namespace Stage {
+
+Selection::Selection() noexcept : ForZones(true), utility() {
+    use("utility", utility);
+}
+
+}  // namespace Stage
+}  // namespace VPP
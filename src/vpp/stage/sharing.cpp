@@ -0,0 +1,30 @@
+/**
+ *
+ * @file      vpp/stage/sharing.cpp
+ *
+ * @brief     This the VPP sharing stage
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "vpp/stage/sharing.hpp"
+
+namespace VPP {
+namespace Stage {
+
+Sharing::Sharing() noexcept : ForScene(true), ring() {
+    use("ring", ring);
+
+    /* Only sharing the BGR image */
+    consume({ Image::Mode::BGR });
+}
+
+}  // namespace Stage
+}  // namespace VPP
@@ -0,0 +1,30 @@
+/**
+ *
+ * @file      vpp/stage/stillness.cpp
+ *
+ * @brief     This is the VPP stillness stage implementation
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "vpp/stage/stillness.hpp"
+
+namespace VPP {
+namespace Stage {
+
+Stillness::Stillness() noexcept : ForScene(true), difference() {
+    use("difference", difference);
+
+    /* Only comparing gray thumbnails */
+    consume({ Image::Mode::GRAY });
+}
+
+}  // namespace Stage
+}  // namespace VPP
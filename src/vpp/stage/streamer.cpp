@@ -0,0 +1,30 @@
+/**
+ *
+ * @file      vpp/stage/streamer.cpp
+ *
+ * @brief     This the VPP streamer stage
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "vpp/stage/streamer.hpp"
+
+namespace VPP {
+namespace Stage {
+
+Streamer::Streamer() noexcept : ForScene(true), mjpeg() {
+    use("mjpeg", mjpeg);
+
+    /* Only streaming the BGR image */
+    consume({ Image::Mode::BGR });
+}
+
+}  // namespace Stage
+}  // namespace VPP
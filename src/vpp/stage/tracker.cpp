@@ -14,6 +14,8 @@
  *
  **/
 
+#include <algorithm>
+
 #include "vpp/stage/tracker.hpp"
 
 namespace VPP {
@@ -24,39 +26,138 @@ Tracker::Tracker() noexcept
     : ForScene(true), ocv(latest, synchro, &added, &removed),
       camshift(latest, synchro, &added, &removed),
       kalman(latest, synchro, &added, &removed), history(latest, synchro),
-      none(latest), event(), synchro(), latest(), added(), removed() {
+      none(latest), event(), synchro("tracker"), latest(), added(), removed(),
+      reference(0), published(std::make_shared<Snapshot>()), spare(),
+      tracked(0), entered(0), left(0), exported(0) {
     use("none",     none);
     use("history",  history);
     use("camshift", camshift);
     use("kalman",   kalman);
     use("ocv",      ocv);
+
+    /* The histograms of the zones may be in any colour mode */
+    consume({ Image::Mode::BGR, Image::Mode::GRAY, Image::Mode::HSV,
+              Image::Mode::YUV, Image::Mode::YCrCb });
+
+    exported = Util::Metrics::Registry::instance().attach(
+        [this](Util::Metrics::Exposition &e) {
+            auto labels = "tracker=" + 
+                          Util::Metrics::Exposition::quote(name());
+            e.gauge("vpp_tracker_contexts", "Zones currently tracked",
+                    labels, tracked.load(std::memory_order_relaxed));
+            e.counter("vpp_tracker_entering_total", 
+                      "Zones entering the tracked scenes", labels,
+                      entered.load(std::memory_order_relaxed));
+            e.counter("vpp_tracker_leaving_total", 
+                      "Zones leaving the tracked scenes", labels,
+                      left.load(std::memory_order_relaxed)); });
+}
+
+Tracker::~Tracker() noexcept {
+    Util::Metrics::Registry::instance().detach(exported);
+}
+
+Tracker::Published Tracker::current() const noexcept {
+    return std::atomic_load(&published);
 }
 
 void Tracker::snapshot(Scene &s) noexcept {
-    std::lock_guard<std::mutex> lock(synchro);
-    s = std::move(latest.remember());
+    current()->scene.remember(s);
 }
 
 void Tracker::snapshot(std::vector<Zone> &entering,
                       std::vector<Zone> &leaving) noexcept {
-    std::lock_guard<std::mutex> lock(synchro);
-    entering = added;
-    leaving  = removed;
+    auto snap = current();
+    entering  = snap->entering;
+    leaving   = snap->leaving;
 }
 
 void Tracker::snapshot(Scene &s, std::vector<Zone> &entering, 
                       std::vector<Zone> &leaving) noexcept {
-    std::lock_guard<std::mutex> lock(synchro);
-    s = std::move(latest.remember());
-    entering = added;
-    leaving  = removed;
+    auto snap = current();
+    snap->scene.remember(s);
+    entering  = snap->entering;
+    leaving   = snap->leaving;
+}
+
+float Tracker::confidence() noexcept {
+    auto known = reference.load(std::memory_order_relaxed);
+    if (known == 0) {
+        return 1.0f;
+    }
+
+    auto count = tracked.load(std::memory_order_relaxed);
+    return std::min(1.0f, static_cast<float>(count) / 
+                          static_cast<float>(known));
+}
+
+Tracker::Published Tracker::publish() noexcept {
+    /* Reusing the buffers of the previous snapshot when possible */
+    auto snap = std::move(spare);
+    if (!snap) {
+        snap = std::make_shared<Snapshot>();
+    }
+
+    {
+        /* Inside a lock_guard scoped block, as the engines update them */
+        std::lock_guard<Util::Mutex> lock(synchro);
+        latest.remember(snap->scene);
+
+        /* Swapping the changes out, keeping the buffers of the spare ones */
+        std::swap(snap->entering, added);
+        std::swap(snap->leaving, removed);
+        added.clear();
+        removed.clear();
+    }
+
+    /* Readers only get the snapshots from the published pointer, so nobody
+     * can hold the previous one but the already existing holders */
+    Published fresh(snap);
+    auto previous = std::atomic_exchange(&published, fresh);
+    if (previous.use_count() == 1) {
+        spare = std::const_pointer_cast<Snapshot>(previous);
+    }
+
+    return fresh;
+}
+
+bool Tracker::suspendable() const noexcept {
+    return false;
 }
 
 Error::Type Tracker::process(Scene &s) noexcept {
+    /* Still scenes reuse the latest tracked zones as they are */
+    if (s.still()) {
+        {
+            /* Inside a lock_guard scoped block, as the engines update them */
+            std::lock_guard<Util::Mutex> lock(synchro);
+            for (auto const &z : static_cast<const Scene &>(latest).zones()) {
+                s.mark(z.get());
+            }
+            added.clear();
+            removed.clear();
+        }
+
+        /* The observers are signalled without holding the mutex */
+        auto snap = publish();
+        event.signal(snap->scene, snap->entering, snap->leaving, Error::NONE);
+
+        return Error::NONE;
+    }
+
+    /* Frames without any zone are only propagated by the tracker */
+    bool detected = !s.zones().empty();
     auto error = ForScene::process(s);
         
-    std::lock_guard<std::mutex> lock(synchro);
-    event.signal(latest, added, removed, error);
+    auto snap  = publish();
+    auto count = snap->scene.zones().size();
+    if ( (detected) || (count > reference.load(std::memory_order_relaxed)) ) {
+        reference.store(count, std::memory_order_relaxed);
+    }
+    tracked.store(count, std::memory_order_relaxed);
+    entered.fetch_add(snap->entering.size(), std::memory_order_relaxed);
+    left.fetch_add(snap->leaving.size(), std::memory_order_relaxed);
+    event.signal(snap->scene, snap->entering, snap->leaving, error);
     
     return error;
 }
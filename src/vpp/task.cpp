@@ -0,0 +1,110 @@
+/**
+ *
+ * @file      vpp/task.cpp
+ *
+ * @brief     This is the VPP tasks implementation file
+ *
+ * @details   This is the customisable interface of the process-wide pool of
+ *            workers running all the asynchronous VPP tasks.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "vpp/task.hpp"
+
+namespace VPP {
+namespace Task {
+
+Pool::Pool() noexcept : Customisation::Entity("Pool") {
+    workers.denominate("workers")
+           .describe("The number of persistent workers running the "
+                     "asynchronous tasks (0 for a thread per task)")
+           .characterise(Customisation::Trait::CONFIGURABLE);
+    workers.range(0, 256);
+    workers.trigger([this](const int &w) {
+                           return onWorkersUpdate(w); });
+    Customisation::Entity::expose(workers);
+    workers = Util::Task::Pool::instance().size();
+
+    using Priority = Util::Task::Priority;
+    critical.denominate("critical")
+            .describe("The share of the workers running the critical tasks, "
+                      "e.g. the ones of the detection path")
+            .characterise(Customisation::Trait::SETTABLE);
+    critical.range(1, 1000);
+    critical.trigger([this](const int &w) {
+                            return onWeightUpdate(Priority::Critical, w); });
+    Customisation::Entity::expose(critical);
+    critical = Util::Task::Pool::instance().weight(Priority::Critical);
+
+    normal.denominate("normal")
+          .describe("The share of the workers running the normal tasks")
+          .characterise(Customisation::Trait::SETTABLE);
+    normal.range(1, 1000);
+    normal.trigger([this](const int &w) {
+                          return onWeightUpdate(Priority::Normal, w); });
+    Customisation::Entity::expose(normal);
+    normal = Util::Task::Pool::instance().weight(Priority::Normal);
+
+    background.denominate("background")
+              .describe("The share of the workers running the background "
+                        "tasks, e.g. the classification or OCR ones")
+              .characterise(Customisation::Trait::SETTABLE);
+    background.range(1, 1000);
+    background.trigger([this](const int &w) {
+                              return onWeightUpdate(Priority::Background, w);
+                       });
+    Customisation::Entity::expose(background);
+    background = Util::Task::Pool::instance().weight(Priority::Background);
+
+    affinity.denominate("affinity")
+            .describe("The cores running the workers: indices and ranges "
+                      "such as 0-3,6, big or little, or empty for all the "
+                      "cores")
+            .characterise(Customisation::Trait::CONFIGURABLE);
+    affinity.trigger([this](const std::string &a) {
+                            return onAffinityUpdate(a); });
+    Customisation::Entity::expose(affinity);
+    affinity = "";
+
+    concurrent.denominate("concurrent")
+              .describe("Are the engines set up concurrently at startup, the "
+                        "pipelines only starting once they are all set up?")
+              .characterise(Customisation::Trait::CONFIGURABLE);
+    concurrent.use(Customisation::Translator::BoolFormat::NO_YES);
+    concurrent.trigger([this](const bool &yes) {
+                              return onConcurrentUpdate(yes); });
+    Customisation::Entity::expose(concurrent);
+    concurrent = Util::Task::Startup::instance().concurrent();
+}
+
+Customisation::Error Pool::onWorkersUpdate(const int &w) noexcept {
+    Util::Task::Pool::instance().resize(w);
+    return Customisation::Error::NONE;
+}
+
+Customisation::Error Pool::onAffinityUpdate(const std::string &a) noexcept {
+    Util::Task::Pool::instance().pin(Util::Affinity::parse(a));
+    return Customisation::Error::NONE;
+}
+
+Customisation::Error Pool::onConcurrentUpdate(const bool &yes) noexcept {
+    Util::Task::Startup::instance().concurrent(yes);
+    return Customisation::Error::NONE;
+}
+
+Customisation::Error Pool::onWeightUpdate(int priority,
+                                          const int &w) noexcept {
+    Util::Task::Pool::instance().weigh(priority, w);
+    return Customisation::Error::NONE;
+}
+
+}  // namespace Task
+}  // namespace VPP
@@ -16,7 +16,10 @@
  *
  **/
 
-#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <opencv2/core/hal/intrin.hpp>
 
 #include "vpp/log.hpp"
 #include "vpp/task/blur.hpp"
@@ -25,7 +28,10 @@ namespace VPP {
 namespace Task {
 namespace Blur {
 
-Skipping::Skipping(const int mode) noexcept : Parent(mode) {
+Skipping::Skipping(const int mode) noexcept 
+    : Parent(mode), settings(), gray(), sx(1), sy(1), calibration(1),
+      tiles_expected(0), tiles_required(0), 
+      tiles_valid(0), tiles_blurred(0) {
     sharpness.denominate("sharpness")
              .describe("The minimum sharpness level to consider a tile as "
                        "not being blurred")
@@ -37,49 +43,201 @@ Skipping::Skipping(const int mode) noexcept : Parent(mode) {
                       "scene ")
             .characterise(Customisation::Trait::CONFIGURABLE);
     expose(coverage);
+
+    sampling.denominate("sampling")
+            .describe("The gray pyramid level on which the sharpness is "
+                      "estimated, each level halving the frame size and "
+                      "level 0 being the full-resolution frame")
+            .characterise(Customisation::Trait::CONFIGURABLE);
+    sampling.range(0, 4);
+    expose(sampling);
+    sampling = 0;
+
+    gain.denominate("gain")
+        .describe("The factor applied to the sharpness measured at each "
+                  "sampling level, for matching the full-resolution sharpness "
+                  "level. Natural images having a scale-invariant spectrum, "
+                  "their Laplacian variance is about the same at all levels")
+        .characterise(Customisation::Trait::CONFIGURABLE);
+    gain.range(0.01f, 100.0f);
+    expose(gain);
+    gain = 1.0f;
 }
 
 Error::Type Skipping::start(Scene &s, cv::Rect &frame) noexcept {
-    tiles_valid = 0;
+    settings = { static_cast<float>(sharpness), static_cast<float>(coverage) };
+
+    /* Sampled frames come from the pyramid shared with the other tasks */
+    int k = sampling;
+    if (k > 0) {
+        gray = s.view.pyramid(Image::Mode::GRAY).level(k);
+    } else {
+        gray = s.view.gray().input();
+    }
+    sx          = gray.cols / static_cast<float>(std::max(1, frame.width));
+    sy          = gray.rows / static_cast<float>(std::max(1, frame.height));
+    calibration = std::pow(static_cast<float>(gain), 
+                           std::log2(1.0f / std::max(sx, 1e-6f)));
+
+    tiles_valid    = 0;
+    tiles_blurred  = 0;
+
+    /* Tiles are laid out from the top-left corner until they leave the frame,
+     * so that their number is known before processing any of them, the
+     * masked ones being skipped */
+    auto dx        = std::max(1, static_cast<int>(stride.x));
+    auto dy        = std::max(1, static_cast<int>(stride.y));
+    tiles_expected = 0;
+    Parent::mask(s);
+    if ( (!frame.empty()) && (masking == nullptr) ) {
+        tiles_expected = ((frame.width + dx - 1) / dx) * 
+                         ((frame.height + dy - 1) / dy);
+    } else if (!frame.empty()) {
+        const auto size = static_cast<cv::Size>(tile);
+        for (int y = frame.y; y < frame.y + frame.height; y += dy) {
+            for (int x = frame.x; x < frame.x + frame.width; x += dx) {
+                if (!masking->excluded(cv::Rect(cv::Point(x, y), size))) {
+                    ++ tiles_expected;
+                }
+            }
+        }
+    }
+    tiles_required = tiles_expected * settings.coverage;
 
     return Parent::start(s, frame);
 }
 
 Error::Type Skipping::wait() noexcept {
     auto error = Parent::wait();
+    gray.release();
 
     if (error < Error::OK) {
         return error;
     }
 
-    if (tiles_valid < tiles_total * coverage) {
+    if (tiles_valid < tiles_total * settings.coverage) {
         return Error::RETRY;
     }
         
     return error;
 }
 
-Error::Type Skipping::process(Scene &s, cv::Rect &r) noexcept {
+/* Reflected index, as OpenCV BORDER_REFLECT_101 does */
+static inline int reflect(int i, int n) noexcept {
+    if (n == 1) {
+        return 0;
+    }
+    if (i < 0) {
+        return -i;
+    }
+    if (i >= n) {
+        return 2*n - 2 - i;
+    }
+    return i;
+}
+
+/* The sum and the sum of squares of the 3x3 aperture Laplacian of cv::Laplacian
+ * (2 0 2 / 0 -8 0 / 2 0 2) over a region of a gray image, in a single pass and
+ * without any intermediate image. The image borders are reflected */
+static void laplacian(const cv::Mat &gray, const cv::Rect &r,
+                      int64_t &sum, int64_t &squares) noexcept {
+    const int cols = gray.cols;
+    const int rows = gray.rows;
+    sum     = 0;
+    squares = 0;
+
+    for (int y = r.y; y < r.y + r.height; ++y) {
+        const uchar *up = gray.ptr<uchar>(reflect(y - 1, rows));
+        const uchar *md = gray.ptr<uchar>(y);
+        const uchar *dn = gray.ptr<uchar>(reflect(y + 1, rows));
+
+        auto scalar = [&](int x) noexcept {
+            int l = reflect(x - 1, cols), h = reflect(x + 1, cols);
+            int v = 2 * (up[l] + up[h] + dn[l] + dn[h]) - 8 * md[x];
+            sum     += v;
+            squares += v * v;
+        };
+
+        int x     = r.x;
+        int inner = std::max(r.x, 1);
+        int last  = std::min(r.x + r.width, cols - 1);
+        for (; x < inner; ++x) {
+            scalar(x);
+        }
+
+#if CV_SIMD128
+        /* Using whatever SIMD instructions OpenCV was built with (SSE, AVX or
+         * NEON) for processing 8 pixels at once. Responses fit in 16 bits and
+         * their products are accumulated pairwise in 32 bits, the 32-bit
+         * accumulators being flushed before they could overflow */
+        const cv::v_int16x8 ones = cv::v_setall_s16(1);
+        cv::v_int32x4 vsum = cv::v_setzero_s32(), vsq = cv::v_setzero_s32();
+        int pending = 0;
+        for (; x + 8 <= last; x += 8) {
+            auto ul = cv::v_reinterpret_as_s16(cv::v_load_expand(up + x - 1));
+            auto ur = cv::v_reinterpret_as_s16(cv::v_load_expand(up + x + 1));
+            auto dl = cv::v_reinterpret_as_s16(cv::v_load_expand(dn + x - 1));
+            auto dr = cv::v_reinterpret_as_s16(cv::v_load_expand(dn + x + 1));
+            auto m  = cv::v_reinterpret_as_s16(cv::v_load_expand(md + x));
+            auto c  = (ul + ur) + (dl + dr);
+            auto m2 = m + m;
+            auto m4 = m2 + m2;
+            auto v  = (c + c) - (m4 + m4);
+
+            vsum = vsum + cv::v_dotprod(v, ones);
+            vsq  = vsq  + cv::v_dotprod(v, v);
+            if (++pending == 64) {
+                sum     += cv::v_reduce_sum(vsum);
+                squares += cv::v_reduce_sum(vsq);
+                vsum     = cv::v_setzero_s32();
+                vsq      = cv::v_setzero_s32();
+                pending  = 0;
+            }
+        }
+        sum     += cv::v_reduce_sum(vsum);
+        squares += cv::v_reduce_sum(vsq);
+#endif /*CV_SIMD128*/
+
+        for (; x < r.x + r.width; ++x) {
+            scalar(x);
+        }
+    }
+}
+
+Error::Type Skipping::process(Scene &/*s*/, cv::Rect &r) noexcept {
     /* Background information on this algorithm is provided at:
      * https://www.pyimagesearch.com/2015/09/07/blur-detection-with-opencv */
-    cv::Mat input, mean, laplacian, stddev;
-
-    /* Crop the ROI and move it to grey to compute the Laplacian */
-    /*cv::cvtColor(s.view.bgr(r).input(), grey, cv::COLOR_BGR2GRAY);
-    cv::Laplacian(grey, laplacian, CV_16S, 3, 1, 0, cv::BORDER_DEFAULT);*/
-    cv::Laplacian(s.view.gray(r).input(), laplacian, CV_16S, 3, 1, 0, 
-                  cv::BORDER_DEFAULT);
-    
-    /* Compute the standard deviation which first element is an estimation
-     * of its sharpness */
-    cv::meanStdDev(laplacian, mean, stddev);
-
-    auto level = stddev.at<double>(0, 0);
-    level = level * level; 
-
-    if (level >= sharpness) {
-        std::lock_guard<std::mutex> lock(synchro);
+
+    /* Skip the tile once the frame is known to be either sharp enough or too
+     * blurred whatever the remaining tiles */
+    if ( (tiles_valid >= tiles_required) ||
+         (tiles_expected - tiles_blurred < tiles_required) ) {
+        return Error::OK;
+    }
+
+    /* Map the tile onto the sampled frame, covering at least a pixel */
+    auto x0 = static_cast<int>(std::floor(r.x * sx));
+    auto y0 = static_cast<int>(std::floor(r.y * sy));
+    auto x1 = static_cast<int>(std::ceil((r.x + r.width) * sx));
+    auto y1 = static_cast<int>(std::ceil((r.y + r.height) * sy));
+    cv::Rect roi(x0, y0, std::max(1, x1 - x0), std::max(1, y1 - y0));
+    roi &= cv::Rect(0, 0, gray.cols, gray.rows);
+    auto n   = static_cast<double>(roi.area());
+    if (n <= 0) {
+        return Error::OK;
+    }
+
+    /* The variance of the Laplacian is an estimation of the sharpness */
+    int64_t sum, squares;
+    laplacian(gray, roi, sum, squares);
+
+    auto mean  = sum / n;
+    auto level = (squares / n - mean * mean) * calibration;
+
+    if (level >= settings.sharpness) {
         ++ tiles_valid;
+    } else {
+        ++ tiles_blurred;
     }
 
     return Error::OK;
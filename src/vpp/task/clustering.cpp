@@ -17,7 +17,9 @@
  *
  **/
 
+#include <algorithm>
 #include <climits>
+#include <numeric>
 #include "vpp/config.hpp"
 #ifdef VPP_HAS_SIMILARITY_CLUSTERING_SUPPORT
 #include <opencv2/objdetect.hpp>
@@ -51,18 +53,124 @@ DilateAndJoin::DilateAndJoin(const int mode) noexcept
     cross.use(Customisation::Translator::BoolFormat::NO_YES);
     cross = false;
     expose(cross);
+
+    joining.denominate("joining")
+           .describe("The algorithm for joining the overlapping zones: either "
+                     "pairwise for repeated scans of all pairs of zones, or "
+                     "sweep for a sweep-line search of the connected zones")
+           .characterise(Customisation::Trait::SETTABLE);
+    joining.define(
+        { { "pairwise", static_cast<int>(Joining::PAIRWISE) },
+          { "sweep",    static_cast<int>(Joining::SWEEP) } });
+    expose(joining);
+    joining = static_cast<int>(Joining::SWEEP);
+}
+
+/* Join overlapping clusters by repeatedly scanning all pairs of them */
+static void pairwise(std::vector<Zone> &clusters) noexcept {
+    bool joined;
+    do {
+        joined = false;
+        for (auto cluster = clusters.begin(); cluster != clusters.end(); ) {
+            for (auto other = cluster+1; other != clusters.end(); ) {
+                if ((*cluster & *other).area() > 0) {
+                    (*cluster).merge(*other);
+                    clusters.erase(other);
+                    other = cluster + 1;
+                    joined = true;
+                } else {
+                    ++other;
+                }
+            }
+            ++cluster;
+        }
+    } while (joined);
+}
+
+/* Find the component of a cluster, with path halving */
+static inline std::size_t root(std::vector<std::size_t> &parent, 
+                               std::size_t i) noexcept {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+/* Join overlapping clusters by sweeping them along the x axis for finding the
+ * overlapping pairs, and then merging each connected component at once. As
+ * merged clusters are larger, they may overlap other ones, hence rounds are
+ * repeated until nothing joins, like the pairwise algorithm */
+static void sweep(std::vector<Zone> &clusters) noexcept {
+    bool joined;
+    do {
+        const auto n = clusters.size();
+        std::vector<std::size_t> order(n), parent(n), active;
+        std::iota(order.begin(), order.end(), 0);
+        std::iota(parent.begin(), parent.end(), 0);
+        std::sort(order.begin(), order.end(),
+                  [&clusters](std::size_t a, std::size_t b) {
+                      return clusters[a].x < clusters[b].x;
+                  });
+
+        /* The active clusters are the ones still spanning the sweep line */
+        joined = false;
+        for (auto i : order) {
+            const auto &c = clusters[i];
+            active.erase(std::remove_if(active.begin(), active.end(),
+                                        [&](std::size_t j) {
+                                            auto &o = clusters[j];
+                                            return o.x + o.width <= c.x;
+                                        }), active.end());
+            for (auto j : active) {
+                if ((c & clusters[j]).area() > 0) {
+                    auto ri = root(parent, i);
+                    auto rj = root(parent, j);
+                    if (ri != rj) {
+                        /* The lowest index is the root to keep the order */
+                        parent[std::max(ri, rj)] = std::min(ri, rj);
+                        joined = true;
+                    }
+                }
+            }
+            active.push_back(i);
+        }
+
+        if (!joined) {
+            break;
+        }
+
+        /* Merge each component into its root, in the original order */
+        std::vector<Zone> merged;
+        std::vector<std::size_t> slot(n);
+        merged.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            auto r = root(parent, i);
+            if (r == i) {
+                slot[i] = merged.size();
+                merged.emplace_back(std::move(clusters[i]));
+            } else {
+                merged[slot[r]].merge(clusters[i]);
+            }
+        }
+        clusters = std::move(merged);
+    } while (joined);
 }
 
 Error::Type DilateAndJoin::process(Scene &scn) noexcept {
     /* Matching zones are removed from the scene zones */
     auto to_cluster(scn.extract(filter));
     std::vector<Zone> clusters;
+
+    /* The parameters are read once for all the zones of the scene */
+    const float dilatation = ratio;
+    const bool  crossed    = cross;
                     
     for (auto const &z : to_cluster) {
         int dx, dy;
-        if (cross) {
-            dx = static_cast<int>(z.height*ratio);
-            dy = static_cast<int>(z.width*ratio);
+        if (crossed) {
+            dx = static_cast<int>(z.height*dilatation);
+            dy = static_cast<int>(z.width*dilatation);
 
             /* If a contraction is making the zone disappear, then do not keep
              * the zone! */
@@ -70,8 +178,8 @@ Error::Type DilateAndJoin::process(Scene &scn) noexcept {
                 continue;
             }
         } else {
-            dx = static_cast<int>(z.width*ratio);
-            dy = static_cast<int>(z.height*ratio);
+            dx = static_cast<int>(z.width*dilatation);
+            dy = static_cast<int>(z.height*dilatation);
         }
 
         /* Apply the transform to the zone */
@@ -85,25 +193,15 @@ Error::Type DilateAndJoin::process(Scene &scn) noexcept {
     }
 
     /* Join overlapping clusters */
-    bool joined;
-    do {
-        joined = false;
-        for (auto cluster = clusters.begin(); cluster != clusters.end(); ) {
-            for (auto other = cluster+1; other != clusters.end(); ) {
-                if ((*cluster & *other).area() > 0) {
-                    (*cluster).merge(*other);
-                    clusters.erase(other);
-                    other = cluster + 1;
-                    joined = true;
-                } else {
-                    ++other;
-                }
-            }
-            ++cluster;
-        }
-    } while (joined);
+    if (static_cast<int>(joining) == static_cast<int>(Joining::SWEEP)) {
+        sweep(clusters);
+    } else {
+        pairwise(clusters);
+    }
                 
-    /* Let's put back the clustered zones in the scene */
+    /* Let's put back the clustered zones in the scene, in the recycled list
+     * nodes of the original zones */
+    scn.recycle(to_cluster);
     for (auto cluster : clusters) {
         scn.mark(std::move(cluster));
     }
@@ -179,6 +277,137 @@ Error::Type Similarity::process(Scene &scn) noexcept {
             }
         }
     }
+    scn.recycle(to_cluster);
+
+    return Error::OK;
+}
+
+Classwise::Classwise(const int mode) noexcept 
+    : Parent(mode), filter([](const Zone &){ return true; }), partitions(),
+      used(0) {
+    threshold.denominate("threshold")
+             .describe("Threshold for the similarity clustering of each class. "
+                       "The smaller the threshold, the pickier the clustering "
+                       "is")
+             .characterise(Customisation::Trait::SETTABLE);
+    threshold = 1.0;
+    expose(threshold);
+}
+
+Error::Type Classwise::cluster(Scene &scn) noexcept {
+    /* Matching zones are removed from the scene zones */
+    auto to_cluster(scn.extract(filter));
+    if (to_cluster.empty()) {
+        return Error::OK;
+    }
+
+    /* Dispatch the zones in the partitions of their class, the few classes of
+     * a frame being linearly searched */
+    for (std::size_t i = 0; i < used; ++i) {
+        partitions[i].zones.clear();
+        partitions[i].clusters.clear();
+    }
+    used = 0;
+    for (auto &z : to_cluster) {
+        auto gid = z.context.gid();
+        std::size_t i = 0;
+        while ( (i < used) && (partitions[i].gid != gid) ) {
+            ++i;
+        }
+        if (i == used) {
+            if (used == partitions.size()) {
+                partitions.emplace_back();
+            }
+            partitions[used].gid = gid;
+            ++used;
+        }
+        partitions[i].zones.emplace_back(std::move(z));
+    }
+    scn.recycle(to_cluster);
+
+    /* Unused partitions have no zones and are processed at once */
+    auto error = Parent::start(partitions);
+    if (error == Error::NONE) {
+        error = wait();
+    }
+
+    for (std::size_t i = 0; i < used; ++i) {
+        for (auto &cluster : partitions[i].clusters) {
+            scn.mark(std::move(cluster));
+        }
+    }
+
+    return error;
+}
+
+Error::Type Classwise::process(Partition &p) noexcept {
+    constexpr auto rect_affinity = Util::OCV::affinity<cv::Rect>;
+    
+    p.clusters.clear();
+    if (p.zones.empty()) {
+        return Error::OK;
+    }
+
+    /* Put every zone twice so that at least two can be grouped in a cluster */
+    p.areas.clear();
+    for (auto const &z : p.zones) {
+        p.areas.push_back(z);
+        p.areas.push_back(z);
+    }
+
+    /* Group rectangles through a similarity criteria */
+    cv::groupRectangles(p.areas, p.weights, 1, threshold);
+    if (p.areas.empty()) {
+        for (auto &z : p.zones) {
+            p.clusters.emplace_back(std::move(z));
+        }
+        return Error::OK;
+    }
+
+    /* Label each zone with the cluster that it has most affinity with */
+    const int n = static_cast<int>(p.zones.size());
+    const int k = static_cast<int>(p.areas.size());
+    p.labels.resize(n);
+    p.firsts.assign(k + 1, 0);
+    for (int i = 0; i < n; ++i) {
+        int best_affinity = INT_MIN;
+        int best          = 0;
+        for (int c = 0; c < k; ++c) {
+            auto affinity = rect_affinity(p.zones[i], p.areas[c]);
+            if (affinity > best_affinity) {
+                best_affinity = affinity;
+                best          = c;
+            }
+        }
+        p.labels[i] = best;
+        ++p.firsts[best + 1];
+    }
+
+    /* Counting sort of the zones by label, keeping their initial ordering */
+    for (int c = 0; c < k; ++c) {
+        p.firsts[c + 1] += p.firsts[c];
+    }
+    p.order.resize(n);
+    p.weights.assign(p.firsts.begin(), p.firsts.end() - 1);
+    for (int i = 0; i < n; ++i) {
+        p.order[p.weights[p.labels[i]]++] = i;
+    }
+
+    /* Going through the original list to keep the initial ordering, the first
+     * zone of each cluster merging all the cluster zones and the cluster */
+    for (int i = 0; i < n; ++i) {
+        auto c = p.labels[i];
+        if (p.order[p.firsts[c]] != i) {
+            continue;
+        }
+
+        Zone merged;
+        for (int j = p.firsts[c]; j < p.firsts[c + 1]; ++j) {
+            merged.merge(p.zones[p.order[j]]);
+        }
+        merged.merge(Zone(BBox(p.areas[c])));
+        p.clusters.emplace_back(std::move(merged));
+    }
 
     return Error::OK;
 }
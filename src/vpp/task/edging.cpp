@@ -28,7 +28,16 @@
 namespace VPP {
 namespace Task {
 
-Edging::Edging(const int mode) noexcept : Parent(mode) {
+Edging::Canny::Canny(const int mode) noexcept : Parent(mode) {}
+
+Error::Type Edging::Canny::process(Level &level) noexcept {
+    cv::Canny(*level.plane, level.edges, level.low, level.high, level.kernel);
+    return Error::NONE;
+}
+
+Edging::Edging(const int mode) noexcept 
+    : Parent(mode), canny(Canny::Mode::Async*8), scaled(), blurred(), edged(),
+      planes(3), detections() {
     
     input_scale.denominate("input_scale")
          .describe("Input scaling factor for accelerating edge detection")
@@ -82,6 +91,9 @@ Edging::Edging(const int mode) noexcept : Parent(mode) {
     expose(levels);
     levels.range(1, 16);
     levels = 3; 
+
+    canny.denominate("canny");
+    expose(canny);
 }
 
 /* Checking if the angle cosine is below 0.3, i.e. the angle is close to
@@ -110,48 +122,73 @@ Error::Type Edging::process(Scene &scene) noexcept {
     } else {          // Manual scaling
         scale = std::max(scale, 1);
     }
-    cv::Mat scaled;
-
-    if (scale != 1) {
-        cv::resize(input, scaled, input.size()/scale);
+    /* The buffers never alias the input, as they are overwritten by the next
+     * frames while the input may still be in use elsewhere */
+    const cv::Mat *source = &input;
+    if ( (scale & (scale - 1)) == 0 ) {
+        /* Power of two scales are shared in the pyramid of the view */
+        int k = 0;
+        while ((1 << k) < scale) {
+            ++k;
+        }
+        source = &scene.view.pyramid(VPP::Image::Mode::BGR).level(k);
     } else {
-        scaled = input;
+        cv::resize(input, scaled, input.size()/scale);
+        source = &scaled;
     }
 
     /* Blur the scaled image */
-    cv::Mat blurred;
     const std::vector<int> &bs = static_cast<std::vector<int>>(blur_size);
 
     if ( (!bs.empty()) && (bs.size() < 3) &&
          (std::accumulate(bs.begin(), bs.end(), 0) > 0) ) {
         if (bs.size() == 1) {
-            cv::medianBlur(scaled, blurred, bs.front());
+            cv::medianBlur(*source, blurred, bs.front());
         } else {
-            cv::blur(scaled, blurred, cv::Size(bs.front(), bs.back()));
+            cv::blur(*source, blurred, cv::Size(bs.front(), bs.back()));
         }
-    } else {
-        blurred = scaled;
+        source = &blurred;
     }
 
-    cv::Mat plane(blurred.size(), CV_8U), edged;
-    std::vector<Contour> contours;
-    Contour approx;
-    
-    /* Find edge boxes into every color plane of the image */
-    for (int c = 0; c < 3; c++) {
-        int ch[] = { c, 0 };
-        cv::mixChannels(&blurred, 1, &plane, 1, ch, 1);
+    /* Only search within the bounds of the relevant areas of the mask, the
+     * masked edges being dropped */
+    const Util::OCV::Mask::Raster *masking = nullptr;
+    cv::Rect area(0, 0, source->cols, source->rows);
+    if (scene.view.mask != nullptr) {
+        masking = &scene.view.mask->raster(source->size());
+        area   &= masking->bounds;
+        if (area.area() <= 0) {
+            return Error::NONE;
+        }
+    }
 
-        /* Do a canny search at various levels */
-        const int max_level = std::max(1, static_cast<int>(levels));
+    std::vector<std::vector<cv::Point>> contours;
+    std::vector<cv::Point> approx;
+    
+    /* Find edge boxes into every color plane of the image, doing a canny
+     * search at various levels, all of them in parallel */
+    cv::split((*source)(area), planes);
+    const int max_level = std::max(1, static_cast<int>(levels));
+    detections.resize(planes.size() * max_level);
+    for (size_t c = 0; c < planes.size(); c++) {
         for (int l=0; l < max_level; ++l) {
-            cv::Mat canny;
-            cv::Canny(plane, canny, (threshold_low*(l+1))/max_level, 
-                      (threshold_high*(l+1))/max_level, kernel_size);
-            if (edged.empty()) edged = canny;
-            cv::bitwise_or(canny, edged, edged);
+            auto &d  = detections[c * max_level + l];
+            d.plane  = &planes[c];
+            d.low    = (threshold_low*(l+1))/max_level;
+            d.high   = (threshold_high*(l+1))/max_level;
+            d.kernel = kernel_size;
         }
     }
+    canny.start(detections);
+    canny.wait();
+
+    detections.front().edges.copyTo(edged);
+    for (size_t i = 1; i < detections.size(); ++i) {
+        cv::bitwise_or(detections[i].edges, edged, edged);
+    }
+    if (masking != nullptr) {
+        cv::bitwise_and(edged, masking->pixels(area), edged);
+    }
     
     DISPLAY("canny", edged);
 #define HOUGHLINES
@@ -163,9 +200,10 @@ Error::Type Edging::process(Scene &scene) noexcept {
         cv::line(edged, cv::Point(l[0], l[1]), cv::Point(l[2], l[3]),
                  cv::Scalar(255), 1, cv::LINE_AA);
 #endif
-        cv::line(scene.view.bgr().drawable(), cv::Point(l[0], l[1])*scale,
-                 cv::Point(l[2], l[3])*scale, cv::Scalar(0, 0 ,255), 3, 
-                 cv::LINE_AA);
+        cv::line(scene.view.bgr().drawable(),
+                 (cv::Point(l[0], l[1]) + area.tl())*scale,
+                 (cv::Point(l[2], l[3]) + area.tl())*scale,
+                 cv::Scalar(0, 0 ,255), 3, cv::LINE_AA);
     }
     SHOW("hough", scene);
 #endif /* HOUGHLINES */
@@ -174,8 +212,9 @@ Error::Type Edging::process(Scene &scene) noexcept {
     DISPLAY("dilated", edged);
             
     /* Get contours */
-    cv::findContours(edged, contours, cv::RETR_LIST, cv::CHAIN_APPROX_SIMPLE);
-    auto area_threshold = (edged.total() * static_cast<int>(min_area))/1024;
+    cv::findContours(edged, contours, cv::RETR_LIST, cv::CHAIN_APPROX_SIMPLE,
+                     area.tl());
+    auto area_threshold = (source->total() * static_cast<int>(min_area))/1024;
     for (auto &c : contours) {
         cv::approxPolyDP(cv::Mat(c), approx,
                          cv::arcLength(cv::Mat(c), true)*0.02, true);
@@ -188,6 +227,9 @@ Error::Type Edging::process(Scene &scene) noexcept {
                 valid &= is_nearly_squared(approx[j%4], approx[j-2],
                                                approx[j-1]);
             }
+            if ( (valid) && (masking != nullptr) ) {
+                valid = !masking->excluded(cv::boundingRect(approx));
+            }
 
             if (valid) {
                 for (auto &p : approx) {
@@ -202,7 +244,7 @@ Error::Type Edging::process(Scene &scene) noexcept {
                                   cv::Scalar(0,255,0), 3, cv::LINE_AA);
                 }
     
-                Zone z(approx);
+                Zone z(scene.contours.store(approx));
                 scene.mark(std::move(z)).context = Prediction(1.0f, 0, 50);
                 SHOW("edging", scene);
             }
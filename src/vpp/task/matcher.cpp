@@ -15,6 +15,10 @@
  *
  **/
 
+#include <algorithm>
+#include <limits>
+#include <vector>
+
 #include "vpp/task/matcher.hpp"
 
 namespace VPP {
@@ -22,11 +26,77 @@ namespace Task {
 namespace Matcher {
         
 Matches Measures::extract(float threshold, bool exclusive_dst, 
-                          bool exclusive_src) const noexcept {
+                          bool exclusive_src, Assignment solver) 
+    const noexcept {
+    /* Optimal assignments only make sense for one-to-one matches */
+    bool optimal = (exclusive_dst) && (exclusive_src) && 
+                   (solver != Assignment::GREEDY);
+
+    if (gated) {
+        if (candidates.empty()) {
+            return Matches();
+        }
+        if (!optimal) {
+            return ranked(threshold, exclusive_dst, exclusive_src);
+        }
+    } else if (measurements.empty()) {
+        return Matches();
+    }
+
+    if (optimal) {
+        const cv::Mat &measures = gated ? densify() : measurements;
+        if (solver == Assignment::HUNGARIAN) {
+            return hungarian(measures, threshold);
+        } else {
+            return auction(measures, threshold);
+        }
+    }
+
+    return greedy(threshold, exclusive_dst, exclusive_src);
+}
+
+cv::Mat Measures::densify() const noexcept {
+    cv::Mat dense(sources, destinations, CV_32F,
+                  cv::Scalar(std::numeric_limits<float>::lowest()));
+    for (auto &c : candidates) {
+        dense.at<float>(c.src, c.dst) = c.score;
+    }
+    return dense;
+}
+
+Matches Measures::ranked(float threshold, bool exclusive_dst, 
+                         bool exclusive_src) const noexcept {
     Matches matches;
-    if(measurements.empty()) {
-        return matches;
+    std::vector<bool> used_src(sources, false), used_dst(destinations, false);
+    
+    /* Greedily extracting the best candidates first */
+    Matches sorted;
+    sorted.reserve(candidates.size());
+    for (auto &c : candidates) {
+        if (c.score >= threshold) {
+            sorted.emplace_back(c);
+        }
     }
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const Match &a, const Match &b) noexcept {
+                        return a.score > b.score; });
+
+    for (auto &c : sorted) {
+        if ( (exclusive_src && used_src[c.src]) ||
+             (exclusive_dst && used_dst[c.dst]) ) {
+            continue;
+        }
+        matches.emplace_back(c);
+        used_src[c.src] = true;
+        used_dst[c.dst] = true;
+    }
+
+    return matches;
+}
+
+Matches Measures::greedy(float threshold, bool exclusive_dst, 
+                         bool exclusive_src) const noexcept {
+    Matches matches;
     
     cv::Mat mask(cv::Mat::ones(measurements.rows, measurements.cols, CV_8U));
 
@@ -53,14 +123,208 @@ Matches Measures::extract(float threshold, bool exclusive_dst,
     }
 }
 
+/* Both optimal solvers maximise the same benefit: every admissible pair is
+ * worth one plus its margin above the threshold, whereas any other pair is
+ * worth nothing and stands for leaving a source unmatched */
+static inline double benefit(float score, float threshold) noexcept {
+    return (score >= threshold) ? (1.0 + score - threshold) : 0.0;
+}
+
+/* Sorting the matches as the greedy solver would return them */
+static inline Matches sorted(Matches matches) noexcept {
+    std::sort(matches.begin(), matches.end(), 
+              [](const Match &a, const Match &b) noexcept {
+                    return a.score > b.score; });
+    return matches;
+}
+
+Matches Measures::hungarian(const cv::Mat &measures, float threshold)
+    const noexcept {
+    /* The Hungarian algorithm requires no more rows than columns, so that the
+     * problem is transposed if need be */
+    const bool   transposed = (measures.rows > measures.cols);
+    const int    n = transposed ? measures.cols : measures.rows;
+    const int    m = transposed ? measures.rows : measures.cols;
+    const auto   inf = std::numeric_limits<double>::max();
+    
+    auto score = [&measures, transposed](int i, int j) noexcept {
+        return transposed ? measures.at<float>(j, i) :
+                            measures.at<float>(i, j); };
+
+    /* Shortest augmenting path implementation minimising the opposite of the
+     * benefits, with 1-based potentials u and v, and p[j] being the row 
+     * assigned to column j */
+    std::vector<double> u(n+1, 0.0), v(m+1, 0.0), minv(m+1);
+    std::vector<int>    p(m+1, 0), way(m+1, 0);
+    std::vector<bool>   used(m+1);
+
+    for (int i = 1; i <= n; ++i) {
+        int j0 = 0;
+        p[0] = i;
+        std::fill(minv.begin(), minv.end(), inf);
+        std::fill(used.begin(), used.end(), false);
+
+        do {
+            used[j0] = true;
+            int    i0 = p[j0], j1 = 0;
+            double delta = inf;
+            for (int j = 1; j <= m; ++j) {
+                if (!used[j]) {
+                    double cur = -benefit(score(i0-1, j-1), threshold) - 
+                                 u[i0] - v[j];
+                    if (cur < minv[j]) {
+                        minv[j] = cur;
+                        way[j]  = j0;
+                    }
+                    if (minv[j] < delta) {
+                        delta = minv[j];
+                        j1    = j;
+                    }
+                }
+            }
+            for (int j = 0; j <= m; ++j) {
+                if (used[j]) {
+                    u[p[j]] += delta;
+                    v[j]    -= delta;
+                } else {
+                    minv[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while (p[j0] != 0);
+
+        do {
+            int j1 = way[j0];
+            p[j0]  = p[j1];
+            j0     = j1;
+        } while (j0 != 0);
+    }
+
+    Matches matches;
+    for (int j = 1; j <= m; ++j) {
+        if (p[j] != 0) {
+            int   src = transposed ? j-1 : p[j]-1;
+            int   dst = transposed ? p[j]-1 : j-1;
+            float s   = measures.at<float>(src, dst);
+            if (s >= threshold) {
+                matches.emplace_back(src, dst, s);
+            }
+        }
+    }
+
+    return sorted(std::move(matches));
+}
+
+Matches Measures::auction(const cv::Mat &measures, float threshold)
+    const noexcept {
+    const int rows = measures.rows;
+    const int cols = measures.cols;
+
+    /* Only admissible pairs take part in the auction, and each source also
+     * bids on its own private dummy destination for being left unmatched */
+    std::vector<std::vector<int>> candidates(rows);
+    for (int i = 0; i < rows; ++i) {
+        const float *r = measures.ptr<float>(i);
+        for (int j = 0; j < cols; ++j) {
+            if (r[j] >= threshold) {
+                candidates[i].emplace_back(j);
+            }
+        }
+    }
+
+    std::vector<double> prices(cols + rows, 0.0);
+    std::vector<int>    owner(cols + rows, -1);
+    std::vector<int>    assigned(rows, -1);
+    std::vector<int>    unassigned;
+    unassigned.reserve(rows);
+
+    /* Epsilon-scaling: the benefits are in [0, 2] for scores in [0, 1], and a
+     * final epsilon below 1/(rows+1) reaches the optimum for such a range */
+    const double final_eps = 1.0 / (4.0 * (rows + 1));
+    for (double eps = 0.5; ; eps = std::max(eps / 4.0, final_eps)) {
+        std::fill(owner.begin(), owner.end(), -1);
+        std::fill(assigned.begin(), assigned.end(), -1);
+        unassigned.clear();
+        for (int i = rows-1; i >= 0; --i) {
+            unassigned.emplace_back(i);
+        }
+
+        while (!unassigned.empty()) {
+            int i = unassigned.back();
+            unassigned.pop_back();
+
+            /* Find the best and second best values for source i */
+            const float *r     = measures.ptr<float>(i);
+            int          best  = cols + i;
+            double       first = -prices[best];
+            double       second= std::numeric_limits<double>::lowest();
+            for (auto j : candidates[i]) {
+                double value = benefit(r[j], threshold) - prices[j];
+                if (value > first) {
+                    second = first;
+                    first  = value;
+                    best   = j;
+                } else if (value > second) {
+                    second = value;
+                }
+            }
+
+            /* Bid for the best destination, evicting its previous owner */
+            if (second == std::numeric_limits<double>::lowest()) {
+                prices[best] += eps;
+            } else {
+                prices[best] += first - second + eps;
+            }
+            if (owner[best] >= 0) {
+                assigned[owner[best]] = -1;
+                unassigned.emplace_back(owner[best]);
+            }
+            owner[best] = i;
+            assigned[i] = best;
+        }
+
+        if (eps <= final_eps) {
+            break;
+        }
+    }
+
+    Matches matches;
+    for (int i = 0; i < rows; ++i) {
+        if ( (assigned[i] >= 0) && (assigned[i] < cols) ) {
+            matches.emplace_back(i, assigned[i],
+                                 measures.at<float>(i, assigned[i]));
+        }
+    }
+
+    return sorted(std::move(matches));
+}
+
 std::vector<float> Measures::scores(Match &m) const noexcept {
     std::vector <float> v;
+    if (gated) {
+        v.assign(destinations, std::numeric_limits<float>::lowest());
+        for (auto &c : candidates) {
+            if (c.src == m.src) {
+                v[c.dst] = c.score;
+            }
+        }
+        return v;
+    }
     measurements.row(m.src).copyTo(v);
     return v;
 }
 
 std::vector<float> Measures::peers(Match &m) const noexcept {
     std::vector <float> v;
+    if (gated) {
+        v.assign(sources, std::numeric_limits<float>::lowest());
+        for (auto &c : candidates) {
+            if (c.dst == m.dst) {
+                v[c.src] = c.score;
+            }
+        }
+        return v;
+    }
     measurements.col(m.dst).copyTo(v);
     return v;
 }
@@ -15,16 +15,24 @@
  *
  **/
 
+#include <algorithm>
+#include <opencv2/core/ocl.hpp>
 #include <opencv2/video/tracking.hpp>
+#include <vector>
 
 #include "customisation.hpp"
 #include "vpp/task/motion.hpp"
+#include "vpp/util/ocv/functions.hpp"
 
 namespace VPP {
 namespace Task {
 
 Motion::Motion(Scene &history) noexcept 
-    : Customisation::Entity("Task"), latest(history) {
+    : Customisation::Entity("Task"), latest(history), previous(), stamp(0)
+#if CV_VERSION_MAJOR >= 4
+      , searcher(), searching(-1)
+#endif
+      {
     scale.denominate("scale")
          .describe("the scale to apply on both directions to build the pyramid")
          .characterise(Customisation::Trait::SETTABLE);
@@ -70,25 +78,68 @@ Motion::Motion(Scene &history) noexcept
     sigma.range(0.1, 2);
     Customisation::Entity::expose(sigma);
     sigma = 1.2;
-}
 
-Error::Type Motion::estimate(Scene &scene) noexcept {
-    scene.view.cache(VPP::Image::Mode::GRAY);
-    if (latest.view.empty()) {
-        return Error::NONE;
-    }
+    backend.denominate("backend")
+           .describe("the optical flow backend: either farneback, opencl for "
+                     "farneback with OpenCL, dis-ultrafast or dis-fast for "
+                     "dense inverse search, sparse for pyramidal "
+                     "Lucas-Kanade on the corners of the previous zones, or "
+                     "zones for farneback within the previous zones only")
+           .characterise(Customisation::Trait::SETTABLE);
+    backend.define(
+        { { "farneback",     static_cast<int>(Backend::FARNEBACK) },
+          { "opencl",        static_cast<int>(Backend::OPENCL) },
+#if CV_VERSION_MAJOR >= 4
+          { "dis-ultrafast", static_cast<int>(Backend::DIS_ULTRAFAST) },
+          { "dis-fast",      static_cast<int>(Backend::DIS_FAST) },
+#endif
+          { "sparse",        static_cast<int>(Backend::SPARSE) },
+          { "zones",         static_cast<int>(Backend::ZONES) } });
+    Customisation::Entity::expose(backend);
+    backend = static_cast<int>(Backend::FARNEBACK);
+
+    dilation.denominate("dilation")
+            .describe("the dilation in pixels of the flow image of the "
+                      "previous zones for the zones backend")
+            .characterise(Customisation::Trait::SETTABLE);
+    dilation.range(0, 64);
+    Customisation::Entity::expose(dilation);
+    dilation = 8;
 
-    cv::Mat flow, gray, old_gray;
+    speeds.denominate("speeds")
+          .describe("whether the median flow of every flat zone is set as "
+                    "its speed in pixels")
+          .characterise(Customisation::Trait::SETTABLE);
+    speeds.use(Customisation::Translator::BoolFormat::NO_YES);
+    Customisation::Entity::expose(speeds);
+    speeds = false;
+}
+
+void Motion::farneback(const cv::Mat &old_gray, const cv::Mat &gray,
+                       cv::Mat &flow, bool device,
+                       const cv::Rect &area) noexcept {
     auto old_flow = latest.view.cached_motion();
-    cv::resize(scene.view.gray().input(), gray, scene.view.frame().size()/2);
-    if (old_flow != nullptr) {
-        old_flow->input().copyTo(flow);
+    if ( (old_flow != nullptr) &&
+         ((area & cv::Rect(cv::Point(), old_flow->input().size())) == area) ) {
+        old_flow->input()(area).copyTo(flow);
     } else {
-        flow = std::move(cv::Mat(gray.size(), CV_32FC2));
+        flow = std::move(cv::Mat(gray.size(), CV_32FC2, cv::Scalar::all(0)));
     }
 
-    cv::resize(latest.view.gray().input(), old_gray, 
-               scene.view.frame().size()/2);
+    if ( (device) && (cv::ocl::useOpenCL()) ) {
+        /* The transparent API runs the OpenCL kernels on device matrices */
+        cv::UMat u_flow = flow.getUMat(cv::ACCESS_RW);
+        cv::calcOpticalFlowFarneback(old_gray.getUMat(cv::ACCESS_READ),
+                                     gray.getUMat(cv::ACCESS_READ), u_flow,
+                                     static_cast<double>(scale),
+                                     static_cast<int>(layers)+1, 
+                                     static_cast<int>(window),
+                                     static_cast<int>(iterations),
+                                     static_cast<int>(neighbourhood), 
+                                     static_cast<double>(sigma),
+                                     cv::OPTFLOW_USE_INITIAL_FLOW);
+        return;
+    }
 
     cv::calcOpticalFlowFarneback(old_gray, gray, flow, 
                                  static_cast<double>(scale),
@@ -98,7 +149,226 @@ Error::Type Motion::estimate(Scene &scene) noexcept {
                                  static_cast<int>(neighbourhood), 
                                  static_cast<double>(sigma),
                                  cv::OPTFLOW_USE_INITIAL_FLOW);
+}
+
+void Motion::dis(const cv::Mat &old_gray, const cv::Mat &gray,
+                 cv::Mat &flow, int preset) noexcept {
+#if CV_VERSION_MAJOR >= 4
+    /* The instance is only rebuilt when the preset changes */
+    if ( (searcher.empty()) || (searching != preset) ) {
+        searcher  = cv::DISOpticalFlow::create(preset);
+        searching = preset;
+    }
+    searcher->calc(old_gray, gray, flow);
+#else
+    (void) preset;
+    farneback(old_gray, gray, flow, false,
+              cv::Rect(0, 0, gray.cols, gray.rows));
+#endif
+}
+
+void Motion::sparse(const cv::Mat &old_gray, const cv::Mat &gray,
+                    cv::Mat &flow,
+                    const Util::OCV::Mask::Raster *masking) noexcept {
+    flow = std::move(cv::Mat(gray.size(), CV_32FC2, cv::Scalar::all(0)));
+
+    /* Track the corners and the centre of the previous zones only, at the
+     * scale of the half-size gray images */
+    std::vector<cv::Rect>    areas;
+    std::vector<cv::Point2f> from;
+    previous_areas(gray.size(), 0, masking, areas);
+    for (auto const &area : areas) {
+        from.emplace_back(area.x, area.y);
+        from.emplace_back(area.x + area.width - 1, area.y);
+        from.emplace_back(area.x, area.y + area.height - 1);
+        from.emplace_back(area.x + area.width - 1, area.y + area.height - 1);
+        from.emplace_back(area.x + area.width/2.0f, area.y + area.height/2.0f);
+    }
+
+    if (from.empty()) {
+        return;
+    }
+
+    std::vector<cv::Point2f> to;
+    std::vector<uchar>       status;
+    std::vector<float>       error;
+    int w = std::max(3, static_cast<int>(window));
+    cv::calcOpticalFlowPyrLK(old_gray, gray, from, to, status, error,
+                             cv::Size(w, w), static_cast<int>(layers));
+
+    /* Each zone moves by the median displacement of its tracked points */
+    for (std::size_t i = 0; i < areas.size(); ++i) {
+        std::vector<float> dx, dy;
+        for (std::size_t p = i*5; p < i*5 + 5; ++p) {
+            if (status[p]) {
+                dx.push_back(to[p].x - from[p].x);
+                dy.push_back(to[p].y - from[p].y);
+            }
+        }
+        if (dx.empty()) {
+            continue;
+        }
+        std::nth_element(dx.begin(), dx.begin() + dx.size()/2, dx.end());
+        std::nth_element(dy.begin(), dy.begin() + dy.size()/2, dy.end());
+        flow(areas[i]).setTo(cv::Scalar(dx[dx.size()/2], dy[dy.size()/2]));
+    }
+}
+
+void Motion::zoned(const cv::Mat &old_gray, const cv::Mat &gray,
+                   cv::Mat &flow,
+                   const Util::OCV::Mask::Raster *masking) noexcept {
+    flow = std::move(cv::Mat(gray.size(), CV_32FC2, cv::Scalar::all(0)));
+
+    /* The dense flow is only estimated within the merged dilated areas of the
+     * previous zones, its cost scaling with their area */
+    std::vector<cv::Rect> areas;
+    previous_areas(gray.size(), dilation, masking, areas);
+    Util::OCV::merge(areas);
+
+    cv::Mat part;
+    for (auto const &area : areas) {
+        farneback(old_gray(area), gray(area), part, false, area);
+        part.copyTo(flow(area));
+    }
+}
+
+void Motion::previous_areas(const cv::Size &size, int margin,
+                            const Util::OCV::Mask::Raster *masking,
+                            std::vector<cv::Rect> &areas) const noexcept {
+    const Scene   &history = latest;
+    const float    sx = size.width / 
+                        static_cast<float>(history.view.frame().width);
+    const float    sy = size.height / 
+                        static_cast<float>(history.view.frame().height);
+    const cv::Rect frame(cv::Point(), size);
+    for (auto const &z : history.zones()) {
+        const auto &zone = z.get();
+        cv::Rect area(static_cast<int>(zone.x * sx) - margin, 
+                      static_cast<int>(zone.y * sy) - margin,
+                      std::max(1, static_cast<int>(zone.width * sx)) +
+                      2 * margin,
+                      std::max(1, static_cast<int>(zone.height * sy)) +
+                      2 * margin);
+        area &= frame;
+        if ( (area.area() <= 0) ||
+             ( (masking != nullptr) && (masking->excluded(area)) ) ) {
+            continue;
+        }
+        areas.push_back(area);
+    }
+}
+
+void Motion::measure(Scene &scene, const cv::Mat &flow) const noexcept {
+    const float    sx = flow.cols / 
+                        static_cast<float>(scene.view.frame().width);
+    const float    sy = flow.rows / 
+                        static_cast<float>(scene.view.frame().height);
+    const cv::Rect frame(0, 0, flow.cols, flow.rows);
+
+    std::vector<float> dx, dy;
+    for (auto &z : scene.zones()) {
+        auto &zone = z.get();
+        if (zone.deprojected) {
+            continue;
+        }
+        cv::Rect area(static_cast<int>(zone.x * sx), 
+                      static_cast<int>(zone.y * sy),
+                      std::max(1, static_cast<int>(zone.width * sx)),
+                      std::max(1, static_cast<int>(zone.height * sy)));
+        area &= frame;
+        if (area.area() <= 0) {
+            continue;
+        }
+
+        dx.clear();
+        dy.clear();
+        for (int y = area.y; y < area.y + area.height; ++y) {
+            auto v = flow.ptr<cv::Point2f>(y);
+            for (int x = area.x; x < area.x + area.width; ++x) {
+                dx.push_back(v[x].x);
+                dy.push_back(v[x].y);
+            }
+        }
+        std::nth_element(dx.begin(), dx.begin() + dx.size()/2, dx.end());
+        std::nth_element(dy.begin(), dy.begin() + dy.size()/2, dy.end());
+
+        /* The speed is in pixels of the frame rather than of the flow */
+        zone.state.speed.x = dx[dx.size()/2] / sx;
+        zone.state.speed.y = dy[dy.size()/2] / sy;
+    }
+}
+
+Error::Type Motion::estimate(Scene &scene) noexcept {
+    scene.view.cache(VPP::Image::Mode::GRAY);
+    if (latest.view.empty()) {
+        return Error::NONE;
+    }
+
+    /* The half-size gray image of the latest scene is the one kept from the
+     * previous estimation, unless the history moved since then */
+    const auto &gray = scene.view.pyramid(VPP::Image::Mode::GRAY).level(1);
+    cv::Mat old_gray;
+    if ( (!previous.empty()) && (stamp == latest.ts_ms()) ) {
+        old_gray = previous;
+    } else {
+        old_gray = latest.view.pyramid(VPP::Image::Mode::GRAY).level(1);
+    }
+
+    /* The dense flow is only estimated within the bounds of the relevant
+     * areas of the mask, and is null in its masked areas */
+    const cv::Rect                 frame(0, 0, gray.cols, gray.rows);
+    const Util::OCV::Mask::Raster *masking = nullptr;
+    cv::Rect                       area(frame);
+    if (scene.view.mask != nullptr) {
+        masking = &scene.view.mask->raster(gray.size());
+        area    = masking->bounds & frame;
+    }
+
+    cv::Mat flow;
+    cv::Mat part;
+    auto    chosen = static_cast<Backend>(static_cast<int>(backend));
+    if (chosen == Backend::SPARSE) {
+        sparse(old_gray, gray, flow, masking);
+    } else if (chosen == Backend::ZONES) {
+        zoned(old_gray, gray, flow, masking);
+    } else if (area.area() <= 0) {
+        flow = cv::Mat(gray.size(), CV_32FC2, cv::Scalar::all(0));
+    } else {
+        auto &out  = (area == frame) ? flow : part;
+        auto  from = old_gray(area);
+        auto  to   = gray(area);
+        switch (chosen) {
+            case Backend::OPENCL:
+                farneback(from, to, out, true, area);
+                break;
+#if CV_VERSION_MAJOR >= 4
+            case Backend::DIS_ULTRAFAST:
+                dis(from, to, out, cv::DISOpticalFlow::PRESET_ULTRAFAST);
+                break;
+            case Backend::DIS_FAST:
+                dis(from, to, out, cv::DISOpticalFlow::PRESET_FAST);
+                break;
+#endif
+            default:
+                farneback(from, to, out, false, area);
+                break;
+        }
+
+        if (area != frame) {
+            flow = cv::Mat(gray.size(), CV_32FC2, cv::Scalar::all(0));
+            part.copyTo(flow(area));
+        }
+        if (masking != nullptr) {
+            flow.setTo(cv::Scalar::all(0), masking->pixels == 0);
+        }
+    }
+
+    if (speeds) {
+        measure(scene, flow);
+    }
 
+    previous = gray;
+    stamp    = scene.ts_ms();
     scene.view.use(std::move(flow), VPP::Image::Mode::MOTION);
 
     return Error::NONE;
@@ -14,16 +14,19 @@
  *
  **/
 
+#include <algorithm>
 #include <opencv2/imgproc.hpp>
 
 #include "vpp/log.hpp"
 #include "vpp/task/mser.hpp"
+#include "vpp/util/ocv/functions.hpp"
 
 namespace VPP {
 namespace Task {
 
 MSER::MSER(const int mode) noexcept 
-    : Parent(mode), filter(nullptr), core(static_cast<cv::MSER *>(nullptr)) {
+    : Parent(mode), filter(nullptr), planes(),
+      searches(Util::Task::Core::Mode::Async*4), rois(), masking(nullptr) {
     
     delta.denominate("delta")
          .describe("Indice-delta for comparing size difference")
@@ -78,33 +81,252 @@ MSER::MSER(const int mode) noexcept
                   .characterise(Customisation::Trait::CONFIGURABLE);
     expose(edge_blur_size);
     edge_blur_size = 5;
+
+    input_scale.denominate("input_scale")
+               .describe("Input scaling factor for searching the candidate "
+                         "regions before refining them at full resolution")
+               .characterise(Customisation::Trait::CONFIGURABLE);
+    input_scale.range(1, 16);
+    expose(input_scale);
+    input_scale = 1;
+
+    restricted.denominate("restricted")
+              .describe("Is the search restricted to the zones already in "
+                        "the scene ?")
+              .characterise(Customisation::Trait::SETTABLE);
+    restricted.use(Customisation::Translator::BoolFormat::NO_YES);
+    expose(restricted);
+    restricted = false;
+
+    margin.denominate("margin")
+          .describe("The margin in pixels around the candidate regions and "
+                    "the restricted zones")
+          .characterise(Customisation::Trait::SETTABLE);
+    margin.range(0, 256);
+    expose(margin);
+    margin = 8;
+
+    channels.denominate("channels")
+            .describe("The channels searched in parallel, i.e. any of GRAY, "
+                      "B, G, R, H, S, Cr or Cb, their regions being merged")
+            .characterise(Customisation::Trait::CONFIGURABLE);
+    channels.define("GRAY", Image::Channel::GRAY);
+    channels.define("B",    Image::Channel::B);
+    channels.define("G",    Image::Channel::G);
+    channels.define("R",    Image::Channel::R);
+    channels.define("H",    Image::Channel::H);
+    channels.define("S",    Image::Channel::S);
+    channels.define("Cr",   Image::Channel::Cr);
+    channels.define("Cb",   Image::Channel::Cb);
+    expose(channels);
+    channels = { Image::Channel::GRAY };
+
+    overlap.denominate("overlap")
+           .describe("The overlap (IoU) above which a region of a channel is "
+                     "merged with a region of a former channel")
+           .characterise(Customisation::Trait::SETTABLE);
+    overlap.range(0.0f, 1.0f);
+    expose(overlap);
+    overlap = 0.8f;
+
+    searches.denominate("search");
+    expose(searches);
 }
 
 Customisation::Error MSER::setup() noexcept {
-    core = cv::MSER::create(delta, min_area, max_area, max_variation,
-                            min_diversity, max_evolution, threshold_area,
-                            min_margin, edge_blur_size);
+    std::vector<int> selected = channels;
+    if (selected.empty()) {
+        LOGE("Task::MSER::setup(): no channels selected!");
+        return Customisation::Error::INVALID_RANGE;
+    }
+
+    /* Each plane has its own detectors, the coarse areas being scaled down
+     * alike */
+    int s2 = input_scale * input_scale;
+    planes.resize(selected.size());
+    for (std::size_t i = 0; i < selected.size(); ++i) {
+        auto &p   = planes[i];
+        p.channel = selected[i];
+        p.core    = cv::MSER::create(delta, min_area, max_area, max_variation,
+                                     min_diversity, max_evolution,
+                                     threshold_area, min_margin,
+                                     edge_blur_size);
+        p.coarse  = cv::MSER::create(delta, std::max(1, min_area / s2),
+                                     std::max(1, max_area / s2),
+                                     max_variation, min_diversity,
+                                     max_evolution, threshold_area,
+                                     min_margin, edge_blur_size);
+    }
 
     return Customisation::Error::NONE;
 }
 
 void MSER::terminate() noexcept {
-    core = static_cast<cv::MSER *>(nullptr);
+    planes.clear();
 }
 
-Error::Type MSER::process(Scene &scene) noexcept {
-    std::vector<std::vector<cv::Point> > areas;
-    std::vector<cv::Rect>                bboxes;
+/* Grow a rectangle by a margin, within a frame */
+static inline cv::Rect grow(const cv::Rect &r, int m, 
+                            const cv::Rect &frame) noexcept {
+    return cv::Rect(r.x - m, r.y - m, r.width + 2*m, r.height + 2*m) & frame;
+}
 
-    auto &gray = scene.view.gray().input();
-    core->detectRegions(gray, areas, bboxes);
+void MSER::detect(Plane &p, const cv::Rect &roi) noexcept {
+    if (roi.area() <= 0) {
+        return;
+    }
+    /* Only the searched area of a strided channel is copied */
+    p.core->detectRegions(p.image(roi).mat(), p.found, p.boxes);
     
-    for (size_t i = 0; i < areas.size(); ++i) {
-        if ((filter == nullptr) || (filter(gray, bboxes[i], areas[i])) ) {
-            Zone z(std::move(bboxes[i]), std::move(areas[i]));
+    const auto origin = roi.tl();
+    for (size_t i = 0; i < p.found.size(); ++i) {
+        p.boxes[i] += origin;
+        for (auto &pt : p.found[i]) {
+            pt += origin;
+        }
+        if ( (masking != nullptr) && (masking->excluded(p.boxes[i])) ) {
+            continue;
+        }
+        if ((filter == nullptr) || (filter(p.image, p.boxes[i], p.found[i]))) {
+            p.areas.emplace_back(std::move(p.found[i]));
+            p.bboxes.emplace_back(p.boxes[i]);
+        }
+    }
+}
+
+void MSER::search(Plane &p) noexcept {
+    p.areas.clear();
+    p.bboxes.clear();
+    if (p.image.empty()) {
+        return;
+    }
+
+    cv::Rect frame(0, 0, p.image.cols(), p.image.rows());
+    int      m = margin;
+
+    /* Search the candidates at a coarse scale before refining them */
+    int scale = input_scale;
+    if (scale > 1) {
+        std::vector<cv::Rect> candidates;
+        cv::Mat               scaled;
+        for (auto &r : rois) {
+            auto roi = r & frame;
+            if (roi.area() <= 0) {
+                continue;
+            }
+            cv::resize(p.image(roi).mat(), scaled, roi.size() / scale, 0, 0, 
+                       cv::INTER_AREA);
+            if (scaled.empty()) {
+                continue;
+            }
+
+            p.coarse->detectRegions(scaled, p.found, p.boxes);
+            for (auto &b : p.boxes) {
+                cv::Rect c(b.x * scale + roi.x, b.y * scale + roi.y,
+                           b.width * scale, b.height * scale);
+                candidates.push_back(grow(c, m + scale, frame));
+            }
+        }
+        Util::OCV::merge(candidates);
+        for (auto &roi : candidates) {
+            detect(p, roi);
+        }
+        return;
+    }
+
+    for (auto &r : rois) {
+        detect(p, r & frame);
+    }
+}
+
+void MSER::merge(Scene &scene) noexcept {
+    Util::OCV::Rects   kept, found;
+    std::vector<float> overlaps;
+    const float        o = overlap;
+
+    for (auto &p : planes) {
+        const auto n = p.bboxes.size();
+        const auto k = kept.size();
+
+        /* The regions of a single plane are all kept, as the nested regions
+         * of MSER are expected */
+        std::vector<bool> merged(n, false);
+        if ((k > 0) && (n > 0)) {
+            found = Util::OCV::Rects();
+            found.reserve(n);
+            for (auto &b : p.bboxes) {
+                found.emplace_back(b);
+            }
+            overlaps.resize(n * k);
+            Util::OCV::iou(found, kept, overlaps.data());
+            for (std::size_t i = 0; i < n; ++i) {
+                auto row  = overlaps.data() + i * k;
+                merged[i] = (*std::max_element(row, row + k) >= o);
+            }
+        }
+
+        for (std::size_t i = 0; i < n; ++i) {
+            if (merged[i]) {
+                continue;
+            }
+            kept.emplace_back(p.bboxes[i]);
+            Zone z(std::move(p.bboxes[i]), std::move(p.areas[i]));
             scene.mark(std::move(z)).context = Prediction(1.0f, 0, 32767);
         }
     }
+}
+
+Error::Type MSER::process(Scene &scene) noexcept {
+    auto &gray = scene.view.gray().input();
+    cv::Rect frame(0, 0, gray.cols, gray.rows);
+    int      m = margin;
+
+    /* Search either the whole frame or only the zones already there, within
+     * the relevant areas of the mask */
+    masking = (scene.view.mask != nullptr) ?
+              &scene.view.mask->raster(gray.size()) : nullptr;
+    rois.clear();
+    if (restricted) {
+        for (auto &z : scene.zones()) {
+            auto r = grow(z.get(), m, frame);
+            if ( (r.area() > 0) &&
+                 ( (masking == nullptr) || (!masking->excluded(r)) ) ) {
+                rois.push_back(r);
+            }
+        }
+        Util::OCV::merge(rois);
+    } else if (masking != nullptr) {
+        auto r = masking->bounds & frame;
+        if (r.area() > 0) {
+            rois.push_back(r);
+        }
+    } else {
+        rois.push_back(frame);
+    }
+
+    /* View the channels in place beforehand, as the view caches their
+     * images, only the searched areas being copied */
+    for (auto &p : planes) {
+        if (p.channel == Image::Channel::GRAY) {
+            p.image = Image::Strided(gray, 0);
+        } else {
+            auto &img = scene.view.image(Image::Channel::mode(p.channel));
+            p.image   = img.channel(Image::Channel(p.channel));
+        }
+    }
+
+    /* Search a single channel in place, or all the channels in parallel */
+    if (planes.size() == 1) {
+        search(planes.front());
+    } else if (!planes.empty()) {
+        searches.start(planes, *this);
+        auto e = searches.wait();
+        if (e != Error::NONE) {
+            return e;
+        }
+    }
+
+    merge(scene);
    
     return Error::NONE;
 }
@@ -33,9 +33,10 @@ Initialiser::Initialiser(const int mode,
 Error::Type Initialiser::start(Scene &s, Zones &zs, 
                                VPP::Tracker::Histogram::Contexts &ctx)
     noexcept {
-    /* Cache the right mode for the view and prepare the engine for the new
-     * zones */
+    /* Cache the right mode for the view, quantise it once for all the new
+     * contexts and prepare the engine for the new zones */
     s.view.cache(histogram.mode());
+    histogram.quantise(s.view);
     histogram.prepare(zs);
     ctx = std::move(histogram.contexts(histogram.original_contexts));
     return Parent::start(ctx, s);
@@ -89,8 +90,10 @@ CamShift::CamShift(const int mode, VPP::Tracker::Histogram::Engine &e) noexcept
 
 Error::Type CamShift::start(Scene &s, 
                             VPP::Tracker::Histogram::Contexts &ctx) noexcept {
-    /* Cache the right mode for the view */
+    /* Cache the right mode for the view and quantise it once for all the
+     * contexts to back project */
     s.view.cache(histogram.mode());
+    histogram.quantise(s.view);
     return Parent::start(ctx, s);
 }
 
@@ -0,0 +1,67 @@
+/**
+ *
+ * @file      vpp/tracer.cpp
+ *
+ * @brief     This is the VPP trace recorder implementation file
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include "vpp/log.hpp"
+#include "vpp/tracer.hpp"
+#include "vpp/util/trace.hpp"
+
+namespace VPP {
+
+Tracer::Tracer() noexcept : Customisation::Entity("Tracer") {
+    recording.denominate("recording")
+             .describe("Are the spans of the pipelines, stages, tasks and "
+                       "bridges recorded ?")
+             .characterise(Customisation::Trait::SETTABLE);
+    recording.use(Customisation::Translator::BoolFormat::NO_YES);
+    recording.trigger([this](const bool &yes) {
+                             return onRecordingUpdate(yes); });
+    Customisation::Entity::expose(recording);
+    recording = false;
+
+    output.denominate("output")
+          .describe("The Chrome trace (JSON) file the recorded spans are "
+                    "exported into, for Perfetto or chrome://tracing")
+          .characterise(Customisation::Trait::SETTABLE);
+    output.trigger([this](const std::string &path) {
+                          return onOutputUpdate(path); });
+    Customisation::Entity::expose(output);
+}
+
+Customisation::Error Tracer::onRecordingUpdate(const bool &yes) noexcept {
+    if ( (yes) && (!Util::Trace::enabled()) ) {
+        Util::Trace::clear();
+    }
+    Util::Trace::enable(yes);
+
+    return Customisation::Error::NONE;
+}
+
+Customisation::Error Tracer::onOutputUpdate(const std::string &path) 
+    noexcept {
+    if (path.empty()) {
+        return Customisation::Error::NONE;
+    }
+
+    if (!Util::Trace::save(path)) {
+        LOGE("%s[%s]::output(): Cannot export the trace into '%s'!",
+             value_to_string().c_str(), name().c_str(), path.c_str());
+        return Customisation::Error::INVALID_VALUE;
+    }
+
+    return Customisation::Error::NONE;
+}
+
+}  // namespace VPP
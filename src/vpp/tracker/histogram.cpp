@@ -16,6 +16,8 @@
 
 #include <algorithm>
 #include <functional>
+#include <initializer_list>
+#include <opencv2/core.hpp>
 #include <opencv2/core/mat.hpp>
 #include <opencv2/video/tracking.hpp>
 
@@ -40,6 +42,30 @@ Context::Context(Zone &zone, Zone::Copier &copier, unsigned int sz,
       validity(1.0), config(params) {}
 
 void Context::initialise(View &view) noexcept {
+    /* With a shared bin index image, the histogram is just a count of the
+     * bins of the zone, the mask of the frame being computed once as well */
+    if (!config.quantised.empty()) {
+        const auto &q = config.quantised;
+        auto roi = static_cast<cv::Rect>(zone(-1)) & cv::Rect(0, 0, q.cols,
+                                                              q.rows);
+        mask = config.mask.valid ? config.masked(roi) : cv::Mat();
+
+        signature.create(config.entries, config.sizes.data(), CV_32F);
+        signature.setTo(0);
+        auto bins = signature.ptr<float>();
+        for (int y = roi.y; y < roi.y + roi.height; ++y) {
+            auto from = q.ptr<int>(y) + roi.x;
+            auto kept = mask.empty() ? nullptr : mask.ptr<uchar>(y - roi.y);
+            for (int x = 0; x < roi.width; ++x) {
+                if ((from[x] >= 0) && ((kept == nullptr) || kept[x])) {
+                    bins[from[x]] += 1.0f;
+                }
+            }
+        }
+        cv::normalize(signature, signature, 0, 255, cv::NORM_MINMAX);
+        return;
+    }
+
     /* Use the cached histogram mode view and only make it to the zone if 
      * it is not available */
     auto roi = std::move(view.image(config.mode, zone(-1)));
@@ -99,12 +125,12 @@ void Context::camshift(View &view, cv::TermCriteria &term,
         float score;
         if ((shift_score > keep_score) && (shift_score > threshold) ) {
             score = shift_score;
-            z.deproject(view);
+            z.flatten();
             zone(-2) = std::move(z);
-            zones.pop_back();
+            unstack();
         } else {
             score = keep_score;
-            zones.pop_back();
+            unstack();
         }
            
         signature = std::move(orig_signature);
@@ -118,9 +144,28 @@ cv::Mat Context::back_project(View &view) const noexcept {
     /* Get a reference to a cached view of the requested mode (and create the
      * cache if it does not exists yet). And do the back project computation
      * with this cached image */
-    auto &img = view.image(config.mode);
     cv::Mat dst;
 
+    /* With a shared bin index image, back projecting is just a gather of the
+     * signature bins */
+    if (!config.quantised.empty()) {
+        const auto &q = config.quantised;
+        auto bins = signature.ptr<float>();
+        dst.create(q.size(), CV_8U);
+
+        for (int y = 0; y < q.rows; ++y) {
+            auto from = q.ptr<int>(y);
+            auto to   = dst.ptr<uchar>(y);
+            for (int x = 0; x < q.cols; ++x) {
+                to[x] = (from[x] < 0) ? 0 :
+                                        cv::saturate_cast<uchar>(bins[from[x]]);
+            }
+        }
+
+        return dst;
+    }
+
+    auto &img = view.image(config.mode);
     cv::calcBackProject(&img.input(), 1, config.channels.data(), signature, dst,
                         config.ranges.data(), 1.0, true);
 
@@ -227,6 +272,13 @@ Engine::Engine(const Zone::Copier &c, unsigned int sz) noexcept
     bins.range(2, 256);
     Customisation::Entity::expose(bins);
 
+    shared.denominate("shared")
+          .describe("Quantise the view once per frame and share the "
+                    "resulting bin index image for all back projections")
+          .characterise(Customisation::Trait::CONFIGURABLE);
+    shared.use(Customisation::Translator::BoolFormat::NO_YES);
+    Customisation::Entity::expose(shared);
+
     /* Setup a default configuration */
     channels    = { Image::Channel::H, Image::Channel::S, Image::Channel::V };
     mask.low    = std::vector<float>(); /* Empty vector */
@@ -234,6 +286,7 @@ Engine::Engine(const Zone::Copier &c, unsigned int sz) noexcept
     ranges.low  = { 0, 0, 0 };
     ranges.high = { 179, 255, 255 };
     bins        = { 180, 256, 256 };
+    shared      = true;
 }
 
 Customisation::Error Engine::setup() noexcept {
@@ -321,6 +374,28 @@ Customisation::Error Engine::setup() noexcept {
         ++high_it;
     }
 
+    /* Build the per-channel contributions to the flat histogram bin index for
+     * 8-bit images, the last channel being the innermost dimension */
+    config.shared = shared;
+    config.lut.assign(entries*256, -1);
+    config.quantised = cv::Mat();
+    config.masked    = cv::Mat();
+    config.clocked   = 0;
+    config.source    = nullptr;
+    int stride = 1;
+    for (int e = static_cast<int>(entries) - 1; e >= 0; --e) {
+        auto low   = config.ranges[e][0];
+        auto scale = config.sizes[e] / (config.ranges[e][1] - low);
+        auto lut   = &config.lut[e*256];
+        for (int v = 0; v < 256; ++v) {
+            auto b = cvFloor((v - low) * scale);
+            if ((b >= 0) && (b < config.sizes[e])) {
+                lut[v] = b * stride;
+            }
+        }
+        stride *= config.sizes[e];
+    }
+
     /* Fill in the mask configuration (if any) */
     low  = mask.low;
     high = mask.high;
@@ -362,6 +437,192 @@ void Engine::prepare(Zones &zs) noexcept {
     Parent::prepare(zs, config);
 }
 
+void Engine::quantise(View &view) noexcept {
+    const auto &img = view.image(config.mode).input();
+
+    /* The initialisations and back projections of a frame share the same
+     * quantisation */
+    if ((view.clock_us() != 0) && (view.clock_us() == config.clocked) &&
+        (img.data == config.source)) {
+        return;
+    }
+    config.clocked = view.clock_us();
+    config.source  = img.data;
+
+    /* Only 8-bit images can use the lookup tables */
+    if ((!config.shared) || (img.depth() != CV_8U)) {
+        config.quantised = cv::Mat();
+        config.masked    = cv::Mat();
+        return;
+    }
+
+    if (config.mask.valid) {
+        cv::inRange(img, config.mask.low, config.mask.high, config.masked);
+    } else {
+        config.masked = cv::Mat();
+    }
+
+    auto &q      = config.quantised;
+    auto entries = config.entries;
+    auto cn      = img.channels();
+    q.create(img.size(), CV_32S);
+
+    for (int y = 0; y < img.rows; ++y) {
+        auto from = img.ptr<uchar>(y);
+        auto to   = q.ptr<int>(y);
+        for (int x = 0; x < img.cols; ++x, from += cn) {
+            int index = 0;
+            for (int e = 0; e < entries; ++e) {
+                auto l = config.lut[e*256 + from[config.channels[e]]];
+                if (l < 0) {
+                    index = -1;
+                    break;
+                }
+                index += l;
+            }
+            to[x] = index;
+        }
+    }
+}
+
+/* Normalising a signature into a row of packed signatures for a method, i.e.
+ * the square roots of its probabilities for the Bhattacharyya coefficients,
+ * its centred unit vector for the correlations, or its probabilities for the
+ * chi-square distances. Empty signatures, or signatures of another size, are
+ * zeroed and are not valid */
+static bool normalise(const cv::Mat &signature, enum cv::HistCompMethods method,
+                      cv::Mat row) noexcept {
+    if (signature.empty() ||
+        (static_cast<int>(signature.total()) != row.cols)) {
+        row.setTo(0);
+        return false;
+    }
+
+    signature.reshape(1, 1).convertTo(row, CV_32F);
+    if (method == cv::HISTCMP_CORREL) {
+        row -= cv::mean(row)[0];
+        auto n = cv::norm(row);
+        if (n > 0) {
+            row *= 1.0 / n;
+        }
+    } else {
+        auto s = cv::sum(row)[0];
+        if (s > 0) {
+            row *= 1.0 / s;
+        }
+        if (method == cv::HISTCMP_BHATTACHARYYA) {
+            cv::sqrt(row, row);
+        }
+    }
+
+    return true;
+}
+
+/* Scoring all the rows of packed signatures against each other */
+static void score(const cv::Mat &a, const cv::Mat &b,
+                  enum cv::HistCompMethods method, cv::Mat &results) noexcept {
+    switch (method) {
+        case cv::HISTCMP_BHATTACHARYYA:
+            /* The products are the Bhattacharyya coefficients, and the
+             * distances the square roots of their complements */
+            cv::gemm(a, b, 1.0, cv::noArray(), 0.0, results, cv::GEMM_2_T);
+            cv::subtract(1.0, results, results);
+            cv::max(results, 0.0, results);
+            cv::sqrt(results, results);
+            cv::subtract(1.0, results, results);
+            break;
+
+        case cv::HISTCMP_CORREL:
+            cv::gemm(a, b, 1.0, cv::noArray(), 0.0, results, cv::GEMM_2_T);
+            break;
+
+        case cv::HISTCMP_CHISQR_ALT:
+        default:
+            /* The distances are 2 * sum((p-q)^2/(p+q)), from 0 to 4, and are
+             * not separable into products of the packed rows */
+            results.create(a.rows, b.rows, CV_32F);
+            for (int i = 0; i < a.rows; ++i) {
+                auto p = a.ptr<float>(i);
+                auto r = results.ptr<float>(i);
+                for (int j = 0; j < b.rows; ++j) {
+                    auto q = b.ptr<float>(j);
+                    float d = 0.0f;
+                    for (int k = 0; k < a.cols; ++k) {
+                        auto s = p[k] + q[k];
+                        auto e = p[k] - q[k];
+                        d += (s > 0.0f) ? e * e / s : 0.0f;
+                    }
+                    r[j] = 1.0f - 0.5f * d;
+                }
+            }
+            break;
+    }
+}
+
+void similarities(const Contexts &srcs, const Contexts &dsts,
+                  enum cv::HistCompMethods method, cv::Mat &results) noexcept {
+    auto rows = static_cast<int>(srcs.size());
+    auto cols = static_cast<int>(dsts.size());
+    results.create(rows, cols, CV_32F);
+    if ((rows == 0) || (cols == 0)) {
+        return;
+    }
+
+    /* All the signatures have the size of the engine configuration, and the
+     * size of the first one is used for packing them all */
+    int bins = 0;
+    for (const Contexts *l : { &srcs, &dsts }) {
+        for (auto &c : *l) {
+            if ((bins == 0) && (!c.get().signature.empty())) {
+                bins = static_cast<int>(c.get().signature.total());
+            }
+        }
+    }
+    if (bins == 0) {
+        results.setTo(0);
+        return;
+    }
+
+    cv::Mat a(rows, bins, CV_32F), b(cols, bins, CV_32F);
+    std::vector<bool> sv(rows), dv(cols);
+    for (int i = 0; i < rows; ++i) {
+        sv[i] = normalise(srcs[i].get().signature, method, a.row(i));
+    }
+    for (int j = 0; j < cols; ++j) {
+        dv[j] = normalise(dsts[j].get().signature, method, b.row(j));
+    }
+
+    score(a, b, method, results);
+
+    /* Empty signatures are not similar to anything */
+    for (int i = 0; i < rows; ++i) {
+        auto r = results.ptr<float>(i);
+        for (int j = 0; j < cols; ++j) {
+            if (!(sv[i] && dv[j])) {
+                r[j] = 0.0f;
+            }
+        }
+    }
+}
+
+float similarity(const Context &src, const Context &dst,
+                 enum cv::HistCompMethods method) noexcept {
+    auto bins = static_cast<int>(std::max(src.signature.total(),
+                                          dst.signature.total()));
+    if (bins == 0) {
+        return 0.0f;
+    }
+
+    cv::Mat a(1, bins, CV_32F), b(1, bins, CV_32F), result;
+    if (!(normalise(src.signature, method, a) &&
+          normalise(dst.signature, method, b))) {
+        return 0.0f;
+    }
+    score(a, b, method, result);
+
+    return result.at<float>(0, 0);
+}
+
 }  // namespace Histogram
 }  // namespace Tracker
 }  // namespace VPP
@@ -14,7 +14,10 @@
  *
  **/
 
+#include <algorithm>
+#include <cmath>
 #include <opencv2/core/mat.hpp>
+#include <vector>
 
 #include "vpp/tracker/kalman.hpp"
 
@@ -22,18 +25,41 @@ namespace VPP {
 namespace Tracker {
 namespace Kalman {
 
+void Parameters::freeze() noexcept {
+    transition  = StateMatrix(transitionMatrix.ptr<float>());
+    observation = Observation(measurementMatrix.ptr<float>());
+    process     = StateMatrix(processNoiseCov.ptr<float>());
+    noise       = MeasureMatrix(measurementNoiseCov.ptr<float>());
+    error       = StateMatrix(errorCovPost.ptr<float>());
+}
+
 Context::Context(Zone &zone, Zone::Copier &copier,
-                 unsigned int sz, Parameters &params) noexcept
-    : VPP::Tracker::Context(zone, copier, sz), 
-      cv::KalmanFilter(Zone::State::length, Zone::Measure::length, 0, CV_32F),
-      validity(params.timeout), config(params) {
+                 unsigned int sz, Parameters &params,
+                 Filters &filters) noexcept
+    : VPP::Tracker::Context(zone, copier, sz), cv::KalmanFilter(),
+      validity(params.timeout), config(params), bank(filters),
+      slot(filters.acquire()) {
           initialise();
 }
 
+Context::~Context() noexcept {
+    bank.release(slot);
+}
+
 void Context::initialise() noexcept {
+    if (config.batched) {
+        /* The batched backend never touches the OpenCV matrices */
+        bank.assign(slot, zone().state.vector(), config.error);
+        return;
+    }
+
+    if (statePost.empty()) {
+        init(Zone::State::length, Zone::Measure::length, 0, CV_32F);
+    }
+
 #define KF_MATRIX_COPY(x) x = std::move(config.x.clone())
     KF_MATRIX_COPY(statePre);
-    statePost = std::move(static_cast<cv::Mat&>(zone().state).clone());
+    statePost = std::move(zone().state.mat().clone());
     KF_MATRIX_COPY(transitionMatrix);
     KF_MATRIX_COPY(controlMatrix);
     KF_MATRIX_COPY(measurementMatrix);
@@ -53,25 +79,64 @@ float Context::accuracy() const noexcept {
     return std::max(validity, 0.0f)/config.timeout;
 }
 
+/* Only the dt terms of F change from one frame to another */
+static inline StateMatrix transition(const Parameters &config,
+                                     float dt) noexcept {
+    auto F = config.transition;
+    F(0, 5) = dt;
+    F(1, 6) = dt;
+    F(2, 7) = dt;
+
+    return F;
+}
+
+bool Context::predictable() const noexcept {
+    return valid() && (original == nullptr);
+}
+
+void Context::predicted(const VPP::View &view, float dt) noexcept {
+    /* Duplicate the previous zone with the predicted state */
+    auto &z = shadow(zone(-1));
+    z.state = bank.state(slot);
+    z.project(view);
+
+    validity -= dt;
+}
+
 void Context::predict(const VPP::View &view, float dt) noexcept {
-    if (valid() && (original == nullptr)) {
-        /* Set the time delta */
-        transitionMatrix.at<float>(5)  = dt;
-        transitionMatrix.at<float>(14) = dt;
-        transitionMatrix.at<float>(23) = dt;
-    
-        /* Duplicate the previous zone and predict it !*/
-        auto &z = stack(zone(-1));
-        cv::KalmanFilter::predict().copyTo(static_cast<cv::Mat&>(z.state));
-        z.project(view);
+    if (!predictable()) {
+        return;
+    }
 
-        validity -= dt;
+    if (config.batched) {
+        bank.predict(&slot, 1, transition(config, dt), config.process);
+        predicted(view, dt);
+        return;
     }
+
+    /* Set the time delta */
+    transitionMatrix.at<float>(5)  = dt;
+    transitionMatrix.at<float>(14) = dt;
+    transitionMatrix.at<float>(23) = dt;
+
+    /* Duplicate the previous zone and predict it !*/
+    auto &z = shadow(zone(-1));
+    auto predicted = z.state.mat();
+    cv::KalmanFilter::predict().copyTo(predicted);
+    z.project(view);
+
+    validity -= dt;
 }
 
 void Context::correct(unsigned int threshold) noexcept {
-    if (zones.size() > threshold) {
-        cv::KalmanFilter::correct(static_cast<Zone::Measure>(zone(-1).state));
+    if (stacked() > threshold) {
+        auto m = static_cast<Zone::Measure>(zone(-1).state);
+        if (config.batched) {
+            auto z = m.vector();
+            bank.correct(&slot, &z, 1, config.observation, config.noise);
+        } else {
+            cv::KalmanFilter::correct(m.mat());
+        }
         validity = config.timeout;
     } else {
         if (validity < 0) {
@@ -80,6 +145,423 @@ void Context::correct(unsigned int threshold) noexcept {
     } 
 }
 
+void Context::posterior(StateVector &state, 
+                        StateMatrix &covariance) const noexcept {
+    if (config.batched) {
+        bank.fetch(slot, state, covariance);
+    } else {
+        state      = StateVector(statePost.ptr<float>());
+        covariance = StateMatrix(errorCovPost.ptr<float>());
+    }
+}
+
+void Context::innovation(MeasureVector &measure,
+                         MeasureMatrix &covariance) const noexcept {
+    StateVector state;
+    StateMatrix error;
+    posterior(state, error);
+
+    const auto &H = config.observation;
+    measure    = H * state;
+    covariance = H * error * H.t() + config.noise;
+}
+
+/* The structure of arrays of the whitened destinations: the predicted measures
+ * first, then the lower triangular Cholesky factors of their innovation
+ * covariances row by row, with the inverses of their diagonals */
+static constexpr int MEASURES  = Zone::Measure::length;
+static constexpr int FACTORS   = MEASURES * (MEASURES + 1) / 2;
+static constexpr int WHITENING = MEASURES + FACTORS;
+
+static inline int factor(int row, int col) noexcept {
+    return MEASURES + row * (row + 1) / 2 + col;
+}
+
+/* Whitening the destination j of n, i.e. storing its predicted measure and
+ * the Cholesky factor L of its innovation covariance S = L.Lt */
+static void whiten(const Context &c, float *soa, std::size_t j,
+                   std::size_t n) noexcept {
+    MeasureVector m;
+    MeasureMatrix S;
+    c.innovation(m, S);
+
+    for (int k = 0; k < MEASURES; ++k) {
+        soa[k * n + j] = m(k);
+    }
+
+    MeasureMatrix L;
+    for (int r = 0; r < MEASURES; ++r) {
+        for (int k = 0; k <= r; ++k) {
+            float v = S(r, k);
+            for (int l = 0; l < k; ++l) {
+                v -= L(r, l) * L(k, l);
+            }
+            if (k == r) {
+                /* S is positive definite, but for its rounding errors */
+                L(r, r) = std::sqrt(std::max(v, 1e-12f));
+                soa[factor(r, r) * n + j] = 1.0f / L(r, r);
+            } else {
+                L(r, k) = v / L(k, k);
+                soa[factor(r, k) * n + j] = L(r, k);
+            }
+        }
+    }
+}
+
+/* Scoring a measure against all the n whitened destinations, by forward
+ * substitution of L.y = z - m, the squared distance being |y|^2. The loop on
+ * the destinations is the innermost one for being vectorised */
+static void score(const MeasureVector &z, const float *soa, std::size_t n,
+                  float *results) noexcept {
+    float y[MEASURES][64];
+    for (std::size_t b = 0; b < n; b += 64) {
+        auto e = std::min<std::size_t>(n - b, 64);
+        for (std::size_t j = 0; j < e; ++j) {
+            results[b + j] = 0.0f;
+        }
+        for (int r = 0; r < MEASURES; ++r) {
+            auto mean = soa + r * n + b;
+            auto diag = soa + factor(r, r) * n + b;
+            for (std::size_t j = 0; j < e; ++j) {
+                y[r][j] = z(r) - mean[j];
+            }
+            for (int l = 0; l < r; ++l) {
+                auto L = soa + factor(r, l) * n + b;
+                for (std::size_t j = 0; j < e; ++j) {
+                    y[r][j] -= L[j] * y[l][j];
+                }
+            }
+            for (std::size_t j = 0; j < e; ++j) {
+                y[r][j] *= diag[j];
+                results[b + j] += y[r][j] * y[r][j];
+            }
+        }
+    }
+}
+
+static inline MeasureVector observed(const Context &c) noexcept {
+    return static_cast<Zone::Measure>(c.zone(-1).state).vector();
+}
+
+void mahalanobis(const Contexts &srcs, const Contexts &dsts,
+                 cv::Mat &results) noexcept {
+    auto rows = srcs.size();
+    auto cols = dsts.size();
+    results.create(static_cast<int>(rows), static_cast<int>(cols), CV_32F);
+    if ((rows == 0) || (cols == 0)) {
+        return;
+    }
+
+    std::vector<float> soa(WHITENING * cols);
+    for (std::size_t j = 0; j < cols; ++j) {
+        whiten(dsts[j].get(), soa.data(), j, cols);
+    }
+
+    for (std::size_t i = 0; i < rows; ++i) {
+        score(observed(srcs[i].get()), soa.data(), cols,
+              results.ptr<float>(static_cast<int>(i)));
+    }
+}
+
+float mahalanobis(const Context &src, const Context &dst) noexcept {
+    float soa[WHITENING], result;
+    whiten(dst, soa, 0, 1);
+    score(observed(src), soa, 1, &result);
+
+    return result;
+}
+
+/* The filters are processed by blocks of slots, the loops on the slots of a
+ * block being the innermost ones for being vectorised */
+static constexpr int         STATES = Filters::states;
+static constexpr std::size_t BLOCK  = 16;
+
+static inline int covariance(int row, int col) noexcept {
+    return STATES + row * STATES + col;
+}
+
+Filters::Filters() noexcept : storage(), used(0), spares() {}
+
+unsigned int Filters::acquire() noexcept {
+    if (!spares.empty()) {
+        auto slot = spares.back();
+        spares.pop_back();
+        return slot;
+    }
+
+    /* Growing the lanes by doubling their capacity, whilst keeping all the
+     * slots in use where they are */
+    if (static_cast<int>(used) == storage.cols) {
+        cv::Mat grown(lanes, std::max<int>(BLOCK, 2 * storage.cols), CV_32F,
+                      cv::Scalar::all(0));
+        if (!storage.empty()) {
+            storage.copyTo(grown.colRange(0, storage.cols));
+        }
+        storage = std::move(grown);
+    }
+
+    return used++;
+}
+
+void Filters::release(unsigned int slot) noexcept {
+    spares.push_back(slot);
+}
+
+void Filters::assign(unsigned int slot, const StateVector &x,
+                     const StateMatrix &p) noexcept {
+    for (int r = 0; r < STATES; ++r) {
+        lane(r)[slot] = x(r);
+        for (int c = 0; c < STATES; ++c) {
+            lane(covariance(r, c))[slot] = p(r, c);
+        }
+    }
+}
+
+void Filters::fetch(unsigned int slot, StateVector &x,
+                    StateMatrix &p) const noexcept {
+    for (int r = 0; r < STATES; ++r) {
+        x(r) = lane(r)[slot];
+        for (int c = 0; c < STATES; ++c) {
+            p(r, c) = lane(covariance(r, c))[slot];
+        }
+    }
+}
+
+StateVector Filters::state(unsigned int slot) const noexcept {
+    StateVector x;
+    for (int r = 0; r < STATES; ++r) {
+        x(r) = lane(r)[slot];
+    }
+
+    return x;
+}
+
+void Filters::predict(const unsigned int *slots, std::size_t n,
+                      const StateMatrix &F, const StateMatrix &Q) noexcept {
+    float x[STATES][BLOCK];
+    float t[STATES * STATES][BLOCK];
+    float v[BLOCK];
+
+    for (std::size_t b = 0; b < n; b += BLOCK) {
+        auto e = std::min(n - b, BLOCK);
+        auto s = slots + b;
+
+        /* x = F.x, skipping the nil terms of F */
+        for (int r = 0; r < STATES; ++r) {
+            std::fill(x[r], x[r] + e, 0.0f);
+            for (int k = 0; k < STATES; ++k) {
+                const float f = F(r, k);
+                if (f == 0.0f) {
+                    continue;
+                }
+                auto X = lane(k);
+                for (std::size_t j = 0; j < e; ++j) {
+                    x[r][j] += f * X[s[j]];
+                }
+            }
+        }
+        for (int r = 0; r < STATES; ++r) {
+            auto X = lane(r);
+            for (std::size_t j = 0; j < e; ++j) {
+                X[s[j]] = x[r][j];
+            }
+        }
+
+        /* T = F.P */
+        for (int r = 0; r < STATES; ++r) {
+            for (int c = 0; c < STATES; ++c) {
+                auto T = t[r * STATES + c];
+                std::fill(T, T + e, 0.0f);
+                for (int k = 0; k < STATES; ++k) {
+                    const float f = F(r, k);
+                    if (f == 0.0f) {
+                        continue;
+                    }
+                    auto P = lane(covariance(k, c));
+                    for (std::size_t j = 0; j < e; ++j) {
+                        T[j] += f * P[s[j]];
+                    }
+                }
+            }
+        }
+
+        /* P = T.Ft + Q */
+        for (int r = 0; r < STATES; ++r) {
+            for (int c = 0; c < STATES; ++c) {
+                std::fill(v, v + e, Q(r, c));
+                for (int k = 0; k < STATES; ++k) {
+                    const float f = F(c, k);
+                    if (f == 0.0f) {
+                        continue;
+                    }
+                    auto T = t[r * STATES + k];
+                    for (std::size_t j = 0; j < e; ++j) {
+                        v[j] += T[j] * f;
+                    }
+                }
+                auto P = lane(covariance(r, c));
+                for (std::size_t j = 0; j < e; ++j) {
+                    P[s[j]] = v[j];
+                }
+            }
+        }
+    }
+}
+
+void Filters::correct(const unsigned int *slots, const MeasureVector *z,
+                      std::size_t n, const Observation &H,
+                      const MeasureMatrix &R) noexcept {
+    float hp[MEASURES * STATES][BLOCK];
+    float kt[MEASURES * STATES][BLOCK];
+    float l[MEASURES * MEASURES][BLOCK];
+    float y[MEASURES][BLOCK];
+    float v[BLOCK];
+
+    for (std::size_t b = 0; b < n; b += BLOCK) {
+        auto e = std::min(n - b, BLOCK);
+        auto s = slots + b;
+
+        /* HP = H.P, skipping the nil terms of H */
+        for (int m = 0; m < MEASURES; ++m) {
+            for (int c = 0; c < STATES; ++c) {
+                auto HP = hp[m * STATES + c];
+                std::fill(HP, HP + e, 0.0f);
+                for (int k = 0; k < STATES; ++k) {
+                    const float h = H(m, k);
+                    if (h == 0.0f) {
+                        continue;
+                    }
+                    auto P = lane(covariance(k, c));
+                    for (std::size_t j = 0; j < e; ++j) {
+                        HP[j] += h * P[s[j]];
+                    }
+                }
+            }
+        }
+
+        /* The lower triangular Cholesky factor L of S = HP.Ht + R */
+        for (int r = 0; r < MEASURES; ++r) {
+            for (int k = 0; k <= r; ++k) {
+                std::fill(v, v + e, R(r, k));
+                for (int c = 0; c < STATES; ++c) {
+                    const float h = H(k, c);
+                    if (h == 0.0f) {
+                        continue;
+                    }
+                    auto HP = hp[r * STATES + c];
+                    for (std::size_t j = 0; j < e; ++j) {
+                        v[j] += HP[j] * h;
+                    }
+                }
+                for (int q = 0; q < k; ++q) {
+                    auto Lr = l[r * MEASURES + q];
+                    auto Lk = l[k * MEASURES + q];
+                    for (std::size_t j = 0; j < e; ++j) {
+                        v[j] -= Lr[j] * Lk[j];
+                    }
+                }
+                auto L = l[r * MEASURES + k];
+                if (k == r) {
+                    /* S is positive definite, but for its rounding errors */
+                    for (std::size_t j = 0; j < e; ++j) {
+                        L[j] = std::sqrt(std::max(v[j], 1e-12f));
+                    }
+                } else {
+                    auto D = l[k * MEASURES + k];
+                    for (std::size_t j = 0; j < e; ++j) {
+                        L[j] = v[j] / D[j];
+                    }
+                }
+            }
+        }
+
+        /* The gain K = P.Ht.S^-1 is obtained as the transpose of the solution
+         * of S.Kt = HP, by forward then backward substitutions */
+        for (int c = 0; c < STATES; ++c) {
+            for (int r = 0; r < MEASURES; ++r) {
+                auto K = kt[r * STATES + c];
+                std::copy(hp[r * STATES + c], hp[r * STATES + c] + e, K);
+                for (int q = 0; q < r; ++q) {
+                    auto L = l[r * MEASURES + q];
+                    auto Y = kt[q * STATES + c];
+                    for (std::size_t j = 0; j < e; ++j) {
+                        K[j] -= L[j] * Y[j];
+                    }
+                }
+                auto D = l[r * MEASURES + r];
+                for (std::size_t j = 0; j < e; ++j) {
+                    K[j] /= D[j];
+                }
+            }
+            for (int r = MEASURES - 1; r >= 0; --r) {
+                auto K = kt[r * STATES + c];
+                for (int q = r + 1; q < MEASURES; ++q) {
+                    auto L = l[q * MEASURES + r];
+                    auto X = kt[q * STATES + c];
+                    for (std::size_t j = 0; j < e; ++j) {
+                        K[j] -= L[j] * X[j];
+                    }
+                }
+                auto D = l[r * MEASURES + r];
+                for (std::size_t j = 0; j < e; ++j) {
+                    K[j] /= D[j];
+                }
+            }
+        }
+
+        /* The innovation y = z - H.x */
+        for (int m = 0; m < MEASURES; ++m) {
+            for (std::size_t j = 0; j < e; ++j) {
+                y[m][j] = z[b + j](m);
+            }
+            for (int k = 0; k < STATES; ++k) {
+                const float h = H(m, k);
+                if (h == 0.0f) {
+                    continue;
+                }
+                auto X = lane(k);
+                for (std::size_t j = 0; j < e; ++j) {
+                    y[m][j] -= h * X[s[j]];
+                }
+            }
+        }
+
+        /* x += Kt.t().y and P -= Kt.t().HP */
+        for (int r = 0; r < STATES; ++r) {
+            auto X = lane(r);
+            for (std::size_t j = 0; j < e; ++j) {
+                v[j] = X[s[j]];
+            }
+            for (int m = 0; m < MEASURES; ++m) {
+                auto K = kt[m * STATES + r];
+                for (std::size_t j = 0; j < e; ++j) {
+                    v[j] += K[j] * y[m][j];
+                }
+            }
+            for (std::size_t j = 0; j < e; ++j) {
+                X[s[j]] = v[j];
+            }
+
+            for (int c = 0; c < STATES; ++c) {
+                auto P = lane(covariance(r, c));
+                for (std::size_t j = 0; j < e; ++j) {
+                    v[j] = P[s[j]];
+                }
+                for (int m = 0; m < MEASURES; ++m) {
+                    auto K  = kt[m * STATES + r];
+                    auto HP = hp[m * STATES + c];
+                    for (std::size_t j = 0; j < e; ++j) {
+                        v[j] -= K[j] * HP[j];
+                    }
+                }
+                for (std::size_t j = 0; j < e; ++j) {
+                    P[s[j]] = v[j];
+                }
+            }
+        }
+    }
+}
+
 #define EXPOSE_MATRIX(M, L, D) \
     M##L.denominate(#M#L)\
         .describe("Line " #L " of the " #D " matrix " #M)\
@@ -88,7 +570,7 @@ void Context::correct(unsigned int threshold) noexcept {
 
 Engine::Engine(const Zone::Copier &c, unsigned int sz) noexcept 
     : VPP::Tracker::Engine<Engine, Context>(c, sz), predictability(10.0),
-      tscale(1.0),
+      tscale(1.0), batched(true),
       F0({   1.0,   0.0,   0.0,   0.0,   0.0,   0.0,   0.0,   0.0 }),
       F1({   0.0,   1.0,   0.0,   0.0,   0.0,   0.0,   0.0,   0.0 }),
       F2({   0.0,   0.0,   1.0,   0.0,   0.0,   0.0,   0.0,   0.0 }),
@@ -115,7 +597,7 @@ Engine::Engine(const Zone::Copier &c, unsigned int sz) noexcept
       R2({   0.0,   0.0,   0.1,   0.0,   0.0 }),
       R3({   0.0,   0.0,   0.0,   0.1,   0.0 }),
       R4({   0.0,   0.0,   0.0,   0.0,   0.1 }),
-      model() {
+      model(), filters(), slots(), measures(), selected() {
 
     predictability.denominate("predictability")
                   .describe("The timeout after which a tracked object is no "
@@ -131,6 +613,13 @@ Engine::Engine(const Zone::Copier &c, unsigned int sz) noexcept
                   .characterise(Customisation::Trait::SETTABLE);
     Customisation::Entity::expose(tscale);
 
+    batched.denominate("batched")
+           .describe("Use the fixed-size batched kernels rather than the "
+                     "generic OpenCV Kalman filter")
+           .characterise(Customisation::Trait::CONFIGURABLE);
+    batched.use(Customisation::Translator::BoolFormat::NO_YES);
+    Customisation::Entity::expose(batched);
+
     EXPOSE_MATRIX(F, 0, "transition state");
     EXPOSE_MATRIX(F, 1, "transition state");
     EXPOSE_MATRIX(F, 2, "transition state");
@@ -242,17 +731,74 @@ Customisation::Error Engine::setup() noexcept {
     if (e != Customisation::Error::NONE) { return e; }
    
     setIdentity(model.errorCovPost, cv::Scalar::all(1));
+    model.batched = batched;
+    model.freeze();
 
     return clear(); 
 }
     
+Engine::~Engine() noexcept {
+    /* The contexts release their slots before the filters are destroyed */
+    storage.clear();
+}
+
 Customisation::Error Engine::clear() noexcept {
     storage.clear();
     return Customisation::Error::NONE;
 }
 
 void Engine::prepare(Zones &zs) noexcept {
-    Parent::prepare(zs, model);
+    Parent::prepare(zs, model, filters);
+}
+
+void Engine::predict(const VPP::View &view, float dt, Contexts &cs) noexcept {
+    if (!model.batched) {
+        for (auto &c : cs) {
+            c.get().predict(view, dt);
+        }
+        return;
+    }
+
+    slots.clear();
+    selected.clear();
+    for (auto &c : cs) {
+        if (c.get().predictable()) {
+            slots.push_back(c.get().slot);
+            selected.emplace_back(c);
+        }
+    }
+
+    filters.predict(slots.data(), slots.size(), transition(model, dt),
+                    model.process);
+    for (auto &c : selected) {
+        c.get().predicted(view, dt);
+    }
+}
+
+void Engine::correct(Contexts &cs, unsigned int threshold) noexcept {
+    if (!model.batched) {
+        for (auto &c : cs) {
+            c.get().correct(threshold);
+        }
+        return;
+    }
+
+    slots.clear();
+    measures.clear();
+    for (auto &c : cs) {
+        auto &context = c.get();
+        if (context.stacked() > threshold) {
+            auto m = static_cast<Zone::Measure>(context.zone(-1).state);
+            slots.push_back(context.slot);
+            measures.push_back(m.vector());
+            context.validity = model.timeout;
+        } else if (context.validity < 0) {
+            context.invalidate();
+        }
+    }
+
+    filters.correct(slots.data(), measures.data(), slots.size(),
+                    model.observation, model.noise);
 }
 
 
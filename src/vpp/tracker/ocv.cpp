@@ -23,27 +23,55 @@ namespace Tracker {
 namespace OCV {
 
 Context::Context(Zone &zone, Zone::Copier &copier,
-                 unsigned int sz, Factory *factory) noexcept
-    : VPP::Tracker::Context(zone, copier, sz), tracker((*factory)()) {}
+                 unsigned int sz, Factory *factory,
+                 const Sampling &s) noexcept
+    : VPP::Tracker::Context(zone, copier, sz), tracker((*factory)()),
+      sampling(s) {}
+
+const cv::Mat &Context::input(VPP::View &view, double &scale) 
+    const noexcept {
+    /* The pyramid levels are shared by all the contexts of a view */
+    const auto &im = 
+        view.pyramid(sampling.gray ? Image::Mode::GRAY : Image::Mode::BGR)
+            .level(sampling.level);
+    scale = (view.frame().width > 0) ? 
+        static_cast<double>(im.cols) / view.frame().width : 1.0;
+    return im;
+}
 
 void Context::initialise(VPP::View &view) noexcept {
-    if (!tracker->init(view.bgr().input(), zone())) {
+    double scale;
+    const auto &im = input(view, scale);
+    const cv::Rect &z = zone();
+    cv::Rect2d box(z.x * scale, z.y * scale, z.width * scale, 
+                   z.height * scale);
+    if (!tracker->init(im, box)) {
         invalidate();
     }
 }
 
 void Context::predict(VPP::View &view) noexcept {
     if (valid()) {
+        double scale;
+        const auto &im = input(view, scale);
         cv::Rect2d estimated;
-        if ( (!(tracker->update(view.bgr().input(), estimated))) ||
-             ((static_cast<cv::Rect >(estimated) & view.frame()).area() == 0) ) {
+        if (!(tracker->update(im, estimated))) {
+            invalidate();
+            return;
+        }
+
+        /* Back to the frame coordinates */
+        cv::Rect box(cv::Rect2d(estimated.x / scale, estimated.y / scale,
+                                estimated.width / scale, 
+                                estimated.height / scale));
+        if ((box & view.frame()).area() == 0) {
             invalidate();
             return;
         }
-        Zone &z = stack(zone(-1));
-        static_cast<cv::Rect &>(z) = estimated;
+        Zone &z = shadow(zone(-1));
+        static_cast<cv::Rect &>(z) = box;
 
-        z.deproject(view);
+        z.flatten();
     }
 }
 
@@ -86,6 +114,22 @@ Engine::Engine(const Zone::Copier &c, unsigned int sz) noexcept
     tracker.allow(std::move(models));
     Customisation::Entity::expose(tracker);
     tracker = "MIL";
+
+    level.denominate("level")
+         .describe("The pyramid level of the images the new trackers run on, "
+                   "every level halving the resolution")
+         .characterise(Customisation::Trait::SETTABLE);
+    level.range(0, 4);
+    Customisation::Entity::expose(level);
+    level = 0;
+
+    gray.denominate("gray")
+        .describe("Do the new trackers run on gray images rather than on "
+                  "colour ones ?")
+        .characterise(Customisation::Trait::SETTABLE);
+    gray.use(Customisation::Translator::BoolFormat::NO_YES);
+    Customisation::Entity::expose(gray);
+    gray = false;
 }
         
 Customisation::Error Engine::setup() noexcept {
@@ -98,7 +142,8 @@ Customisation::Error Engine::clear() noexcept {
 }
 
 void Engine::prepare(Zones &zs) noexcept {
-    Parent::prepare(zs, factory);
+    Sampling sampling { static_cast<int>(level), static_cast<bool>(gray) };
+    Parent::prepare(zs, factory, sampling);
 }
 
 Customisation::Error Engine::onTrackerUpdate(const std::string &t) noexcept {
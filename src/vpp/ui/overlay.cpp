@@ -14,6 +14,10 @@
  *
  **/
 
+#include <algorithm>
+#include <cstdlib>
+
+#include "vpp/dnn/dataset.hpp"
 #include "vpp/ui/overlay.hpp"
 
 namespace VPP {
@@ -55,34 +59,18 @@ void Overlay::draw(cv::Mat &frame, const VPP::Zone &zone,
                    const Overlay::ZoneStyle &baseStyle,
                    const Overlay::ZoneStyleDelegate &delegate) const noexcept {
 
-    auto style = delegate.getStyle(zone, baseStyle);
-
-    if ( (style.adaptColor) && (style.box.thickness <= 0) ) {
-        style.box.color[3] += (255 - style.box.color[3]) * 
-                              (1.0 - zone.context.score);
-    }
-
-    Util::OCV::Overlay::draw(frame, zone, style.box);
-    Util::OCV::Overlay::draw(frame, zone.description,
-                             (zone.tl() + zone.br())/2,
-                             style.text);
+    Batch batch;
+    collect(batch, zone, delegate.getStyle(zone, baseStyle));
+    Util::OCV::Overlay::draw(frame, batch);
 }
 
 void Overlay::draw(cv::Mat &frame, const VPP::Zone &zone,
                    const Overlay::ZoneStyle &baseStyle,
                    const Overlay::ZoneStylist &stylist) const noexcept {
 
-    auto style = stylist(zone, baseStyle);
-
-    if ( (style.adaptColor) && (style.box.thickness <= 0) ) {
-        style.box.color[3] += (255 - style.box.color[3]) * 
-                              (1.0 - zone.context.score);
-    }
-
-    Util::OCV::Overlay::draw(frame, zone, style.box);
-    Util::OCV::Overlay::draw(frame, zone.description,
-                             (zone.tl() + zone.br())/2,
-                             style.text);
+    Batch batch;
+    collect(batch, zone, stylist(zone, baseStyle));
+    Util::OCV::Overlay::draw(frame, batch);
 }
 
 void Overlay::draw(cv::Mat &frame,
@@ -109,17 +97,119 @@ void Overlay::draw(cv::Mat &frame, const VPP::Scene &scn,
 void Overlay::draw(cv::Mat &frame, const VPP::Scene &scn,
                    const Overlay::ZoneStyle &style,
                    const Overlay::ZoneStyleDelegate &delegate) const noexcept {
+    /* All the zones are drawn at once */
+    Batch batch;
     for (auto const &zone : scn.zones()) {
-        draw(frame, zone.get(), style, delegate);
+        collect(batch, zone.get(), delegate.getStyle(zone.get(), style));
     }
+    Util::OCV::Overlay::draw(frame, batch);
 }
 
 void Overlay::draw(cv::Mat &frame, const VPP::Scene &scn,
                    const Overlay::ZoneStyle &style,
                    const Overlay::ZoneStylist &stylist) const noexcept {
+    /* All the zones are drawn at once */
+    Batch batch;
     for (auto const &zone : scn.zones()) {
-        draw(frame, zone.get(), style, stylist);
+        collect(batch, zone.get(), stylist(zone.get(), style));
     }
+    Util::OCV::Overlay::draw(frame, batch);
+}
+
+void Overlay::draw(cv::Mat &frame, const VPP::Scene &scn,
+                   Overlay::Styles &styles) const noexcept {
+    /* All the zones are drawn at once */
+    Batch batch;
+    collect(batch, scn, styles);
+    Util::OCV::Overlay::draw(frame, batch);
+}
+
+void Overlay::collect(Batch &batch, const VPP::Scene &scn,
+                      const Overlay::ZoneStylist &stylist) const {
+    for (auto const &zone : scn.zones()) {
+        collect(batch, zone.get(), stylist(zone.get(), defaultZoneStyle));
+    }
+}
+
+void Overlay::collect(Batch &batch, const VPP::Scene &scn,
+                      Overlay::Styles &styles) const {
+    for (auto const &zone : scn.zones()) {
+        add(batch, zone.get(), styles.of(zone.get()));
+    }
+}
+
+cv::Rect Overlay::area(const VPP::Zone &zone,
+                       const Overlay::ZoneStylist &stylist) const noexcept {
+    return drawn(zone, stylist(zone, defaultZoneStyle));
+}
+
+cv::Rect Overlay::area(const VPP::Zone &zone,
+                       Overlay::Styles &styles) const noexcept {
+    return drawn(zone, styles.of(zone));
+}
+
+cv::Rect Overlay::drawn(const VPP::Zone &zone,
+                        const Overlay::ZoneStyle &style) noexcept {
+    auto margin = std::abs(style.box.thickness) + 2;
+    cv::Rect drawn(zone.tl() - cv::Point(margin, margin),
+                   zone.br() + cv::Point(margin, margin));
+
+    /* The description is written around the centre of the zone, no glyph
+     * being wider than the text height */
+    auto text = DNN::Dataset::text(zone);
+    if (!text.empty()) {
+        const int h = style.text.height + style.text.thickness + 2;
+        const int w = static_cast<int>(text.size()) * h;
+        const auto c = (zone.tl() + zone.br())/2;
+        drawn |= cv::Rect(c.x - w, c.y - 2*h, 2*w, 4*h);
+    }
+
+    return drawn;
+}
+
+void Overlay::collect(Batch &batch, const VPP::Zone &zone,
+                      Overlay::ZoneStyle style) {
+    add(batch, zone, adapt(std::move(style), zone.context.score));
+}
+
+void Overlay::add(Batch &batch, const VPP::Zone &zone,
+                  const Overlay::ZoneStyle &style) {
+    batch.add(zone, style.box);
+    batch.add(DNN::Dataset::text(zone), (zone.tl() + zone.br())/2,
+              style.text);
+}
+
+Overlay::ZoneStyle Overlay::adapt(Overlay::ZoneStyle style,
+                                  float score) noexcept {
+    if ( (style.adaptColor) && (style.box.thickness <= 0) ) {
+        style.box.color[3] += (255 - style.box.color[3]) * (1.0 - score);
+    }
+
+    /* Copy elision */
+    return style;
+}
+
+const Overlay::ZoneStyle &
+    Overlay::Styles::of(const VPP::Zone &zone) noexcept {
+    auto gid    = zone.context.gid();
+    auto score  = std::min(std::max(zone.context.score, 0.0f), 1.0f);
+    auto bucket = static_cast<int>(score * (buckets - 1) + 0.5f);
+    auto key    = static_cast<int64_t>(gid) * buckets + bucket;
+
+    auto found = adapted.find(key);
+    if (found != adapted.end()) {
+        return found->second;
+    }
+
+    /* The stylist is only called for the first zone of each class */
+    auto style = classes.find(gid);
+    if (style == classes.end()) {
+        style = classes.emplace(gid, stylist(zone, base)).first;
+    }
+
+    return adapted.emplace(key, adapt(style->second,
+                                      static_cast<float>(bucket) /
+                                      (buckets - 1))).first->second;
 }
 
 Overlay::ZoneStyle 
@@ -0,0 +1,208 @@
+/**
+ *
+ * @file      vpp/util/affinity.cpp
+ *
+ * @brief     This is the VPP thread affinity implementation file
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+#include "vpp/log.hpp"
+#include "vpp/util/affinity.hpp"
+
+namespace Util {
+namespace Affinity {
+
+/* Adding the cores of a list of indices and ranges, e.g. "0-3,6" */
+static bool ranges(const std::string &list, Cores &cores) noexcept {
+    std::istringstream iss(list);
+    std::string item;
+    while (std::getline(iss, item, ',')) {
+        char *end = nullptr;
+        auto first = std::strtol(item.c_str(), &end, 10);
+        auto last  = first;
+        if (*end == '-') {
+            last = std::strtol(end + 1, &end, 10);
+        }
+        if ( (item.empty()) || (*end != '\0') || (first < 0) ||
+             (last < first) ) {
+            return false;
+        }
+        for (auto c = first; c <= last; ++c) {
+            cores.push_back(static_cast<int>(c));
+        }
+    }
+    return true;
+}
+
+/* The topology of the host, as read once from the sysfs */
+struct Topology {
+    Topology() noexcept;
+
+    std::vector<long> capacities;  /* Capacity of every core, -1 if unknown */
+    std::vector<int>  numa;        /* NUMA node of every core */
+    int               count;       /* Number of NUMA nodes */
+};
+
+static long value(const std::string &path) noexcept {
+    std::ifstream ifs(path);
+    long v = -1;
+    if (!(ifs >> v)) {
+        return -1;
+    }
+    return v;
+}
+
+Topology::Topology() noexcept : capacities(), numa(), count(1) {
+    int n = static_cast<int>(std::thread::hardware_concurrency());
+#ifdef __linux__
+    n = std::max(n, static_cast<int>(sysconf(_SC_NPROCESSORS_CONF)));
+#endif
+
+    /* The capacity of the cores of heterogeneous processors, or their
+     * maximal frequency when their capacity is not provided */
+    const std::string cpu("/sys/devices/system/cpu/cpu");
+    for (int i = 0; i < n; ++i) {
+        auto base = cpu + std::to_string(i);
+        auto c    = value(base + "/cpu_capacity");
+        if (c < 0) {
+            c = value(base + "/cpufreq/cpuinfo_max_freq");
+        }
+        capacities.push_back(c);
+    }
+
+    numa.assign(n, 0);
+    const std::string node("/sys/devices/system/node/node");
+    for (int k = 0; ; ++k) {
+        std::ifstream ifs(node + std::to_string(k) + "/cpulist");
+        std::string list;
+        Cores cores;
+        if ( (!std::getline(ifs, list)) || (!ranges(list, cores)) ) {
+            break;
+        }
+        for (auto c : cores) {
+            if (c < n) {
+                numa[c] = k;
+            }
+        }
+        count = k + 1;
+    }
+}
+
+static const Topology &topology() noexcept {
+    static const Topology *t = new Topology();
+    return *t;
+}
+
+Cores parse(const std::string &cores) noexcept {
+    Cores parsed;
+    if (cores.empty()) {
+        return parsed;
+    }
+
+    auto &t = topology();
+    const int n = static_cast<int>(t.capacities.size());
+    if ( ( (cores == "big") || (cores == "little") ) && (n > 0) ) {
+        auto range = std::minmax_element(t.capacities.begin(),
+                                         t.capacities.end());
+        auto wanted = (cores == "big") ? *range.second : *range.first;
+        for (int c = 0; c < n; ++c) {
+            if (t.capacities[c] == wanted) {
+                parsed.push_back(c);
+            }
+        }
+        return parsed;
+    }
+
+    if (!ranges(cores, parsed)) {
+        LOGW("Affinity::parse(): Invalid list of cores '%s'", cores.c_str());
+        return Cores();
+    }
+
+    auto unknown = std::remove_if(parsed.begin(), parsed.end(),
+                                  [n](int c) { return c >= n; });
+    if (unknown != parsed.end()) {
+        LOGW("Affinity::parse(): Ignoring the unknown cores of '%s'",
+             cores.c_str());
+        parsed.erase(unknown, parsed.end());
+    }
+
+    return parsed;
+}
+
+#ifdef __linux__
+static bool pin(pthread_t thread, const Cores &cores) noexcept {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    const int n = static_cast<int>(topology().capacities.size());
+    for (int c = 0; (cores.empty()) && (c < n) && (c < CPU_SETSIZE); ++c) {
+        CPU_SET(c, &set);
+    }
+    for (auto c : cores) {
+        if ( (c >= 0) && (c < CPU_SETSIZE) ) {
+            CPU_SET(c, &set);
+        }
+    }
+    if (CPU_COUNT(&set) == 0) {
+        return false;
+    }
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+#endif
+
+bool pin(const Cores &cores) noexcept {
+#ifdef __linux__
+    return pin(pthread_self(), cores);
+#else
+    (void)cores;
+    return false;
+#endif
+}
+
+bool pin(std::thread &thread, const Cores &cores) noexcept {
+#ifdef __linux__
+    return pin(thread.native_handle(), cores);
+#else
+    (void)thread;
+    (void)cores;
+    return false;
+#endif
+}
+
+int nodes() noexcept {
+    return topology().count;
+}
+
+int node() noexcept {
+#ifdef __linux__
+    auto &t = topology();
+    if (t.count > 1) {
+        auto c = sched_getcpu();
+        if ( (c >= 0) && (c < static_cast<int>(t.numa.size())) ) {
+            return t.numa[c];
+        }
+    }
+#endif
+    return 0;
+}
+
+}  // namespace Affinity
+}  // namespace Util
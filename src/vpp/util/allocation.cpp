@@ -0,0 +1,131 @@
+/**
+ *
+ * @file      vpp/util/allocation.cpp
+ *
+ * @brief     This is the VPP heap allocation accounting implementation file
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "vpp/config.hpp"
+#include "vpp/util/allocation.hpp"
+
+namespace Util {
+namespace Allocation {
+
+namespace {
+
+/* The counters of a thread are constant initialised, hence usable from the
+ * very first allocation of the thread */
+thread_local Counters local = { 0, 0 };
+
+std::atomic<uint64_t> allocations(0);
+std::atomic<uint64_t> bytes(0);
+
+}  // namespace
+
+#ifdef VPP_HAS_ALLOCATION_TRACKING
+
+static inline void count(std::size_t size) noexcept {
+    ++local.allocations;
+    local.bytes += size;
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+static void *allocate(std::size_t size) noexcept {
+    /* A null allocation still returns a unique pointer */
+    void *p = std::malloc((size == 0) ? 1 : size);
+    if (p != nullptr) {
+        count(size);
+    }
+    return p;
+}
+
+bool tracked() noexcept {
+    return true;
+}
+
+#else
+
+bool tracked() noexcept {
+    return false;
+}
+
+#endif
+
+Counters thread() noexcept {
+    return local;
+}
+
+Counters process() noexcept {
+    return Counters{ allocations.load(std::memory_order_relaxed),
+                     bytes.load(std::memory_order_relaxed) };
+}
+
+}  // namespace Allocation
+}  // namespace Util
+
+#ifdef VPP_HAS_ALLOCATION_TRACKING
+
+/* The replaced global allocation operators, for the whole process */
+void *operator new(std::size_t size) {
+    auto p = Util::Allocation::allocate(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](std::size_t size) {
+    auto p = Util::Allocation::allocate(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return Util::Allocation::allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return Util::Allocation::allocate(size);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+#endif
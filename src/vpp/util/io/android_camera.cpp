@@ -14,7 +14,9 @@
  *
  **/
 
+#include <chrono>
 #include <cstring>
+#include <ctime>
 #include "vpp/log.hpp"
 #include "vpp/util/io/android_camera.hpp"
 
@@ -23,6 +25,10 @@ namespace Util
 namespace IO
 {
 
+// The maximal age in us of a sensor timestamp, beyond which it is not on the
+// boot time clock
+static constexpr int64_t MAXIMUM_AGE = 10000000;
+
 static void onDisconnected(void *context, ACameraDevice * /*device*/)
 {
     AndroidCamera *cam = static_cast<AndroidCamera *>(context);
@@ -72,6 +78,8 @@ static void onImageAvailable(void *context, AImageReader *imageReader)
     // Get their promise and image
     auto promise = callback.promise;
     auto image = callback.image;
+    auto mode = callback.mode;
+    auto timestamp = callback.timestamp;
 
     // Get the AImage structure
     AImage *aImage;
@@ -97,6 +105,12 @@ static void onImageAvailable(void *context, AImageReader *imageReader)
     std::thread processor([=]() {
         int error = ACAMERA_OK;
 
+        // Get the sensor timestamp of the image, on the boot time clock
+        if (AImage_getTimestamp(aImage, timestamp) != AMEDIA_OK)
+        {
+            *timestamp = 0;
+        }
+
         // Read the image and make it an OpenCV matrix
         int32_t format = 0;
         AImage_getFormat(aImage, &format);
@@ -120,7 +134,6 @@ static void onImageAvailable(void *context, AImageReader *imageReader)
                 int32_t width, height, uvsz;
                 AImage_getWidth(aImage, &width);
                 AImage_getHeight(aImage, &height);
-                cv::ColorConversionCodes convMode;
 
                 uvsz = width * height / 4;
 
@@ -130,32 +143,36 @@ static void onImageAvailable(void *context, AImageReader *imageReader)
                 cv::Mat yo(height, width, CV_8UC1, data);
                 yi.copyTo(yo);
 
+                // Native images are provided as is, the pipeline only
+                // converting them to BGR if it needs a colour image
                 if (ud == (vd + 1))
                 {
-                    convMode = cv::COLOR_YUV2BGR_NV21;
                     cv::Mat uvi(height / 2, width, CV_8UC1, vd, vs);
                     cv::Mat uvo(height / 2, width, CV_8UC1, data + 4 * uvsz);
                     uvi.copyTo(uvo);
+                    *image = std::move(yuv);
+                    *mode = VPP::Image::Mode::NV21;
                 }
                 else if (vd == (ud + 1))
                 {
-                    convMode = cv::COLOR_YUV2BGR_NV12;
                     cv::Mat uvi(height / 2, width, CV_8UC1, ud, us);
                     cv::Mat uvo(height / 2, width, CV_8UC1, data + 4 * uvsz);
                     uvi.copyTo(uvo);
+                    *image = std::move(yuv);
+                    *mode = VPP::Image::Mode::NV12;
                 }
                 else
                 {
-                    convMode = cv::COLOR_YUV2BGR_I420;
                     cv::Mat ui(height / 2, width / 2, CV_8UC1, ud, us);
                     cv::Mat vi(height / 2, width / 2, CV_8UC1, vd, vs);
                     cv::Mat uo(height / 2, width / 2, CV_8UC1, data + 4 * uvsz);
                     cv::Mat vo(height / 2, width / 2, CV_8UC1, data + 5 * uvsz);
                     ui.copyTo(uo);
                     vi.copyTo(vo);
+                    *image = std::move(yuv);
+                    *mode = VPP::Image::Mode::I420;
                 }
 
-                cv::cvtColor(yuv, *image, convMode, 3);
                 LOGD("AndroidCamera::onImageAvailable(): "
                      "Created cv::Mat from YUV image");
             }
@@ -197,7 +214,8 @@ AndroidCamera::AndroidCamera() noexcept : Input({"internal"}),
                                           captureCapabilities({}), captureRequest(nullptr), captureMode(0, 0, 0),
                                           imageMode(0, 0, 0), imageReader(nullptr), imageReaderCallbacks(),
                                           imageWindow(nullptr), imageTarget(nullptr), imageOutputs(nullptr),
-                                          imageOutput(nullptr), captureSession(nullptr)
+                                          imageOutput(nullptr), captureSession(nullptr),
+                                          imageClock(0)
 {
     ACameraIdList *cameraIds = nullptr;
 
@@ -739,7 +757,9 @@ int AndroidCamera::read(cv::Mat &image, VPP::Image::Mode &mode) noexcept
     std::promise<int> promise;
     std::future<int> completion = promise.get_future();
 
-    imageReaderCallbacks.push({&promise, &image});
+    int64_t timestamp = 0;
+    mode = VPP::Image::Mode::BGR;
+    imageReaderCallbacks.push({&promise, &image, &mode, &timestamp});
     ACameraCaptureSession_capture(captureSession, nullptr, 1,
                                   &captureRequest, nullptr);
 
@@ -750,8 +770,34 @@ int AndroidCamera::read(cv::Mat &image, VPP::Image::Mode &mode) noexcept
         return error;
     }
 
+    // Move the sensor timestamp to the steady clock, the sensors whose
+    // timestamps are not on the boot time clock being left unknown
+    imageClock = 0;
+    struct timespec boot;
+    if ((timestamp > 0) && (clock_gettime(CLOCK_BOOTTIME, &boot) == 0))
+    {
+        auto now = static_cast<int64_t>(boot.tv_sec) * 1000000000ll +
+                   boot.tv_nsec;
+        auto age = (now - timestamp) / 1000;
+        auto steady = static_cast<int64_t>(VPP::View::now_us());
+        if ((age >= 0) && (age < MAXIMUM_AGE) && (age < steady))
+        {
+            imageClock = static_cast<uint64_t>(steady - age);
+        }
+    }
+
     // Get what should be the right capture mode
     auto reqMode = imageMode.swapWidthHeightIf((imageRotation % 2) == 1);
+
+    // Native images cannot be resized nor rotated as is
+    if ( (mode.is_native()) &&
+         ((!(reqMode == captureMode)) || (imageRotation != 0)) )
+    {
+        VPP::Image orig(std::move(image), mode);
+        image = orig.to(VPP::Image::Mode::BGR);
+        mode = VPP::Image::Mode::BGR;
+    }
+
     if (!(reqMode == captureMode))
     {
         cv::Mat orig(std::move(image));
@@ -796,7 +842,23 @@ int AndroidCamera::read(cv::Mat &image, VPP::Image::Mode &mode) noexcept
         cv::rotate(orig, image, rotation);
     }
 
-    mode = VPP::Image::Mode::BGR;
+    return ACAMERA_OK;
+}
+
+int AndroidCamera::attach(VPP::View &view) noexcept
+{
+    // The capture time of the sensor, moved to the epoch for the wall-clock
+    // timestamp of the view
+    auto now = VPP::View::now_us();
+    if ((imageClock != 0) && (imageClock <= now))
+    {
+        using namespace std::chrono;
+        auto epoch = system_clock::now().time_since_epoch();
+        auto age = microseconds(now - imageClock);
+        view.clock(imageClock);
+        view.stamp(static_cast<uint64_t>(
+            duration_cast<milliseconds>(epoch - age).count()));
+    }
 
     return ACAMERA_OK;
 }
@@ -842,6 +904,7 @@ int AndroidCamera::close() noexcept
     cameraName.clear();
     cameraSensor = {};
     captureCapabilities.clear();
+    imageClock = 0;
 
     return error;
 }
@@ -0,0 +1,258 @@
+/**
+ *
+ * @file      vpp/util/io/android_exchange.cpp
+ *
+ * @brief     These are the Android zero-copy frame and result exchanges
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <cstring>
+
+#include "vpp/log.hpp"
+#include "vpp/util/io/android_exchange.hpp"
+
+namespace Util {
+namespace IO {
+namespace Android {
+
+/* The wrapped images own a reference on their buffer through the matrix data
+ * of their headers, the reference being released with the last header. The
+ * allocator is only the one of these data, never the one of any image, so it
+ * never allocates anything itself */
+class Holder : public cv::MatAllocator {
+    public:
+        using Release = void (*)(void *context, void *buffer);
+
+        explicit Holder(Release r) noexcept : release(r) {}
+
+        /* Wrapping some data into an image holding their buffer */
+        cv::Mat hold(int rows, int cols, int type, void *data,
+                     std::size_t step, void *buffer, void *context) const {
+            cv::Mat image(rows, cols, type, data, step);
+            auto u      = new cv::UMatData(this);
+            u->data     = u->origdata = static_cast<uchar *>(data);
+            u->size     = image.step[0] * rows;
+            u->userdata = buffer;
+            u->handle   = context;
+            image.u     = u;
+            image.addref();
+            return image;
+        }
+
+#if CV_VERSION_MAJOR >= 4
+        cv::UMatData *allocate(int, const int *, int, void *, std::size_t *,
+                               cv::AccessFlag, cv::UMatUsageFlags)
+            const override {
+            return nullptr;
+        }
+
+        bool allocate(cv::UMatData *, cv::AccessFlag, cv::UMatUsageFlags)
+            const override {
+            return false;
+        }
+#else
+        cv::UMatData *allocate(int, const int *, int, void *, std::size_t *,
+                               int, cv::UMatUsageFlags) const override {
+            return nullptr;
+        }
+
+        bool allocate(cv::UMatData *, int, cv::UMatUsageFlags)
+            const override {
+            return false;
+        }
+#endif
+
+        void deallocate(cv::UMatData *u) const override {
+            if (u != nullptr) {
+                release(u->handle, u->userdata);
+                delete u;
+            }
+        }
+
+    private:
+        Release release;
+};
+
+/* The byte buffers are kept alive with a global reference, deleted from the
+ * thread releasing the last image, be it attached to the VM or not */
+static void unreference(void *context, void *buffer) {
+    auto vm = static_cast<JavaVM *>(context);
+    JNIEnv *env = nullptr;
+    if (vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) ==
+        JNI_OK) {
+        env->DeleteGlobalRef(static_cast<jobject>(buffer));
+        return;
+    }
+
+    if (vm->AttachCurrentThread(&env, nullptr) == JNI_OK) {
+        env->DeleteGlobalRef(static_cast<jobject>(buffer));
+        vm->DetachCurrentThread();
+    } else {
+        LOGE("Android::unreference(): Cannot attach to the Java VM, leaking "
+             "a frame buffer!");
+    }
+}
+
+static const Holder &references() noexcept {
+    static const Holder *holder = new Holder(unreference);
+    return *holder;
+}
+
+cv::Mat wrap(JNIEnv *env, jobject buffer, int width, int height, int stride,
+             const VPP::Image::Mode &mode) noexcept {
+    auto m = static_cast<int>(mode);
+    auto data = env->GetDirectBufferAddress(buffer);
+    auto size = env->GetDirectBufferCapacity(buffer);
+    if ( (data == nullptr) || (size < 0) || (width <= 0) || (height <= 0) ) {
+        LOGE("Android::wrap(): Invalid direct buffer provided!");
+        return cv::Mat();
+    }
+
+    /* The chroma planes of the native images follow the luma plane */
+    int rows  = VPP::Image::Mode::is_native(m) ? height * 3 / 2 : height;
+    int type  = CV_8UC(VPP::Image::Mode::channels(m));
+    if (m == VPP::Image::Mode::DEPTH16) {
+        type = CV_16UC1;
+    } else if (m == VPP::Image::Mode::DEPTHF) {
+        type = CV_32FC1;
+    }
+    std::size_t step = (stride > 0) ? static_cast<std::size_t>(stride) :
+                                      width * CV_ELEM_SIZE(type);
+    if ( (step < static_cast<std::size_t>(width * CV_ELEM_SIZE(type))) ||
+         (static_cast<std::size_t>(size) < step * rows) ) {
+        LOGE("Android::wrap(): Direct buffer of %lld bytes too small for a "
+             "%dx%d frame!", static_cast<long long>(size), width, height);
+        return cv::Mat();
+    }
+
+    JavaVM *vm = nullptr;
+    if (env->GetJavaVM(&vm) != JNI_OK) {
+        LOGE("Android::wrap(): Cannot get the Java VM!");
+        return cv::Mat();
+    }
+
+    return references().hold(rows, width, type, data, step,
+                             env->NewGlobalRef(buffer), vm);
+}
+
+#if __ANDROID_API__ >= 29
+/* The hardware buffers are unlocked and released with the last image */
+static void unlock(void * /*context*/, void *buffer) {
+    auto hb = static_cast<AHardwareBuffer *>(buffer);
+    AHardwareBuffer_unlock(hb, nullptr);
+    AHardwareBuffer_release(hb);
+}
+
+static const Holder &locks() noexcept {
+    static const Holder *holder = new Holder(unlock);
+    return *holder;
+}
+
+cv::Mat wrap(AHardwareBuffer *buffer, VPP::Image::Mode &mode) noexcept {
+    AHardwareBuffer_Desc desc;
+    AHardwareBuffer_describe(buffer, &desc);
+    if (desc.format != AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420) {
+        LOGE("Android::wrap(): Unsupported hardware buffer format 0x%x",
+             desc.format);
+        return cv::Mat();
+    }
+
+    AHardwareBuffer_Planes planes;
+    if (AHardwareBuffer_lockPlanes(buffer,
+                                   AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN, -1,
+                                   nullptr, &planes) != 0) {
+        LOGE("Android::wrap(): Cannot lock the hardware buffer!");
+        return cv::Mat();
+    }
+
+    auto &y  = planes.planes[0];
+    auto &u  = planes.planes[1];
+    auto &v  = planes.planes[2];
+    auto  yd = static_cast<uint8_t *>(y.data);
+    auto  ud = static_cast<uint8_t *>(u.data);
+    auto  vd = static_cast<uint8_t *>(v.data);
+    auto  uv = yd + y.rowStride * desc.height;
+
+    /* Only the semi-planar layouts with contiguous planes can be wrapped */
+    int m = VPP::Image::Mode::AMBIGUOUS;
+    if ( (planes.planeCount == 3) && (u.pixelStride == 2) &&
+         (u.rowStride == y.rowStride) && (v.rowStride == y.rowStride) ) {
+        if ( (vd == uv) && (ud == vd + 1) ) {
+            m = VPP::Image::Mode::NV21;
+        } else if ( (ud == uv) && (vd == ud + 1) ) {
+            m = VPP::Image::Mode::NV12;
+        }
+    }
+    if (m == VPP::Image::Mode::AMBIGUOUS) {
+        AHardwareBuffer_unlock(buffer, nullptr);
+        LOGW("Android::wrap(): Cannot wrap a hardware buffer whose chroma "
+             "planes are not contiguous and interleaved!");
+        return cv::Mat();
+    }
+
+    AHardwareBuffer_acquire(buffer);
+    mode = VPP::Image::Mode(m);
+    return locks().hold(desc.height * 3 / 2, desc.width, CV_8UC1, yd,
+                        y.rowStride, buffer, nullptr);
+}
+#endif
+
+Results::Results() noexcept : data(nullptr), capacity(0) {}
+
+int Results::attach(JNIEnv *env, jobject buffer) noexcept {
+    auto d = env->GetDirectBufferAddress(buffer);
+    auto c = env->GetDirectBufferCapacity(buffer);
+    if ( (d == nullptr) || (c < static_cast<jlong>(header)) ) {
+        LOGE("Results::attach(): Invalid direct buffer provided!");
+        data     = nullptr;
+        capacity = 0;
+        return -1;
+    }
+
+    data     = static_cast<uint8_t *>(d);
+    capacity = static_cast<std::size_t>(c);
+    return static_cast<int>((capacity - header) / record);
+}
+
+int Results::write(const VPP::Scene &scene) noexcept {
+    if (data == nullptr) {
+        return -1;
+    }
+
+    auto    at    = data + header;
+    int32_t count = 0;
+    for (const VPP::Zone &z : scene.zones()) {
+        if (at + record > data + capacity) {
+            break;
+        }
+
+        int64_t uuid    = static_cast<int64_t>(z.uuid);
+        int32_t box[4]  = { z.x, z.y, z.width, z.height };
+        float   score   = z.context.score;
+        int32_t gid     = z.context.gid();
+        std::memcpy(at, &uuid, 8);
+        std::memcpy(at + 8, box, 16);
+        std::memcpy(at + 24, &score, 4);
+        std::memcpy(at + 28, &gid, 4);
+        at += record;
+        ++count;
+    }
+
+    int64_t ts = static_cast<int64_t>(scene.ts_ms());
+    std::memcpy(data, &ts, 8);
+    std::memcpy(data + 8, &count, 4);
+
+    return count;
+}
+
+}  // namespace Android
+}  // namespace IO
+}  // namespace Util
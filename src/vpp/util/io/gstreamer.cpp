@@ -0,0 +1,407 @@
+/**
+ *
+ * @file      vpp/util/io/gstreamer.cpp
+ *
+ * @brief     This is the GStreamer pipeline Input class implementation
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <chrono>
+#include <gst/app/gstappsink.h>
+#include <gst/video/video.h>
+
+#include "vpp/log.hpp"
+#include "vpp/util/io/gstreamer.hpp"
+
+namespace Util {
+namespace IO {
+
+/* The name of the appsink of the frames, the number of samples it queues
+ * before dropping the oldest ones, and the time a frame is waited for */
+static const char              sinking[] = "vpp";
+static constexpr guint         queueing  = 4;
+static constexpr GstClockTime  polling   = 100 * GST_MSECOND;
+static constexpr int           patience  = 50;
+
+/* The caps of the frames supported by the appsink */
+static const std::string raw("video/x-raw,format=(string){NV12,NV21,BGR}");
+
+namespace {
+
+/* The wrapped images hold a lease on their sample through the matrix data of
+ * their headers, the sample being unmapped and released with the last one.
+ * The allocator is only the one of these data, never the one of any image,
+ * so it never allocates anything itself */
+struct GstLease final {
+    explicit GstLease(GstSample *s) noexcept
+        : sample(s), frame(), mapped(false) {}
+
+    ~GstLease() noexcept {
+        if (mapped) {
+            gst_video_frame_unmap(&frame);
+        }
+        gst_sample_unref(sample);
+    }
+
+    GstLease(const GstLease& other) = delete;
+    GstLease& operator=(const GstLease& other) = delete;
+
+    GstSample     *sample;
+    GstVideoFrame  frame;
+    bool           mapped;
+};
+
+class GstLender : public cv::MatAllocator {
+    public:
+        GstLender() noexcept = default;
+
+        cv::Mat lend(int rows, int cols, int type, void *data,
+                     std::size_t step, GstLease *lease) const {
+            cv::Mat image(rows, cols, type, data, step);
+            auto u      = new cv::UMatData(this);
+            u->data     = u->origdata = static_cast<uchar *>(data);
+            u->size     = image.step[0] * rows;
+            u->userdata = lease;
+            image.u     = u;
+            image.addref();
+            return image;
+        }
+
+#if CV_VERSION_MAJOR >= 4
+        cv::UMatData *allocate(int, const int *, int, void *, std::size_t *,
+                               cv::AccessFlag, cv::UMatUsageFlags)
+            const override {
+            return nullptr;
+        }
+
+        bool allocate(cv::UMatData *, cv::AccessFlag, cv::UMatUsageFlags)
+            const override {
+            return false;
+        }
+#else
+        cv::UMatData *allocate(int, const int *, int, void *, std::size_t *,
+                               int, cv::UMatUsageFlags) const override {
+            return nullptr;
+        }
+
+        bool allocate(cv::UMatData *, int, cv::UMatUsageFlags)
+            const override {
+            return false;
+        }
+#endif
+
+        void deallocate(cv::UMatData *u) const override {
+            if (u != nullptr) {
+                delete static_cast<GstLease *>(u->userdata);
+                delete u;
+            }
+        }
+};
+
+static const GstLender &lender() noexcept {
+    static const GstLender *l = new GstLender();
+    return *l;
+}
+
+}  // namespace
+
+GStreamer::GStreamer() noexcept
+    : Input({ "gst/pipeline" }), launch(), pipeline(nullptr), sink(nullptr),
+      pending(nullptr), stamped(0) {
+    if (!gst_is_initialized()) {
+        gst_init(nullptr, nullptr);
+    }
+}
+
+GStreamer::~GStreamer() noexcept {
+    close();
+}
+
+std::vector<std::string> GStreamer::modes() noexcept {
+    return { "0x0", "640x480", "1280x720", "1920x1080", "3840x2160" };
+}
+
+int GStreamer::open(const std::string &/*protocol*/, int /*id*/) noexcept {
+    return -1;
+}
+
+int GStreamer::open(const std::string &protocol,
+                    const std::string &source) noexcept {
+    ASSERT(supports(protocol), "GStreamer::open(): Unsupported protocol '%s'",
+           protocol.c_str());
+    close();
+
+    launch = source;
+    if (launch.find(std::string("name=") + sinking) == std::string::npos) {
+        launch += std::string(" ! appsink name=") + sinking;
+    }
+
+    GError *error = nullptr;
+    pipeline = gst_parse_launch(launch.c_str(), &error);
+    if (error != nullptr) {
+        if (pipeline == nullptr) {
+            LOGE("GStreamer::open(): Invalid pipeline '%s': %s",
+                 launch.c_str(), error->message);
+        } else {
+            LOGW("GStreamer::open(): Pipeline '%s' opened with: %s",
+                 launch.c_str(), error->message);
+        }
+        g_error_free(error);
+    }
+    if ( (pipeline == nullptr) || (!GST_IS_BIN(pipeline)) ) {
+        close();
+        return -1;
+    }
+
+    sink = gst_bin_get_by_name(GST_BIN(pipeline), sinking);
+    if ( (sink == nullptr) || (!GST_IS_APP_SINK(sink)) ) {
+        LOGE("GStreamer::open(): No appsink named '%s' in '%s'", sinking,
+             launch.c_str());
+        close();
+        return -1;
+    }
+
+    /* The live sources shall never be blocked by a late pipeline */
+    auto app = GST_APP_SINK(sink);
+    gst_app_sink_set_max_buffers(app, queueing);
+    gst_app_sink_set_drop(app, TRUE);
+    gst_app_sink_set_emit_signals(app, FALSE);
+    g_object_set(sink, "sync", FALSE, nullptr);
+
+    return 0;
+}
+
+int GStreamer::setup(const std::string & /*username*/,
+                     const std::string & /*password*/) noexcept {
+    /* Nothing to do, we are fine */
+    return 0;
+}
+
+int GStreamer::setup(int &width, int &height, int &rotation) noexcept {
+    if (pipeline == nullptr) {
+        return -1;
+    }
+    rotation = 0;
+    stop();
+
+    /* The frames are scaled by the pipeline if it can, and are otherwise of
+     * their native size */
+    if ( (width > 0) && (height > 0) ) {
+        auto sized = raw + ",width=(int)" + std::to_string(width) +
+                     ",height=(int)" + std::to_string(height);
+        if (start(sized, width, height)) {
+            return 0;
+        }
+        LOGW("GStreamer::setup(): Cannot scale '%s' to %dx%d, keeping the "
+             "native size", launch.c_str(), width, height);
+    }
+
+    return start(raw, width, height) ? 0 : -1;
+}
+
+int GStreamer::read(cv::Mat &image, VPP::Image::Mode &mode) noexcept {
+    if (pipeline == nullptr) {
+        return -1;
+    }
+
+    auto app    = GST_APP_SINK(sink);
+    auto sample = pending;
+    pending     = nullptr;
+    for (int i = 0; (sample == nullptr) && (i < patience); ++i) {
+        sample = gst_app_sink_try_pull_sample(app, polling);
+        if ( (sample == nullptr) &&
+             ( (gst_app_sink_is_eos(app)) || (failed()) ) ) {
+            return -1;
+        }
+    }
+    if (sample == nullptr) {
+        LOGE("GStreamer::read(): No frame from '%s'", launch.c_str());
+        return -1;
+    }
+    stamped = stamp(sample);
+
+    GstVideoInfo info;
+    auto lease = new GstLease(sample);
+    if ( (!gst_video_info_from_caps(&info, gst_sample_get_caps(sample))) ||
+         (!gst_video_frame_map(&lease->frame, &info,
+                               gst_sample_get_buffer(sample), GST_MAP_READ)) ) {
+        LOGE("GStreamer::read(): Cannot map a frame from '%s'",
+             launch.c_str());
+        delete lease;
+        return -1;
+    }
+    lease->mapped = true;
+
+    auto &frame  = lease->frame;
+    auto  format = GST_VIDEO_FRAME_FORMAT(&frame);
+    int   w      = GST_VIDEO_FRAME_WIDTH(&frame);
+    int   h      = GST_VIDEO_FRAME_HEIGHT(&frame);
+    auto  y      = static_cast<uchar *>(GST_VIDEO_FRAME_PLANE_DATA(&frame, 0));
+    auto  ys     = static_cast<std::size_t>(
+                       GST_VIDEO_FRAME_PLANE_STRIDE(&frame, 0));
+
+    if (format == GST_VIDEO_FORMAT_BGR) {
+        mode  = VPP::Image::Mode::BGR;
+        image = lender().lend(h, w, CV_8UC3, y, ys, lease);
+        return 0;
+    }
+
+    mode = (format == GST_VIDEO_FORMAT_NV12) ? VPP::Image::Mode::NV12 :
+                                               VPP::Image::Mode::NV21;
+    auto uv  = static_cast<uchar *>(GST_VIDEO_FRAME_PLANE_DATA(&frame, 1));
+    auto uvs = static_cast<std::size_t>(
+                   GST_VIDEO_FRAME_PLANE_STRIDE(&frame, 1));
+
+    /* Only the contiguous planes can be wrapped into native images */
+    if ( (uv == y + ys * h) && (uvs == ys) ) {
+        image = lender().lend(h * 3 / 2, w, CV_8UC1, y, ys, lease);
+        return 0;
+    }
+
+    cv::Mat native(h * 3 / 2, w, CV_8UC1);
+    cv::Mat(h, w, CV_8UC1, y, ys).copyTo(native.rowRange(0, h));
+    cv::Mat(h / 2, w, CV_8UC1, uv, uvs).copyTo(native.rowRange(h, h * 3 / 2));
+    delete lease;
+    image = std::move(native);
+
+    return 0;
+}
+
+int GStreamer::attach(VPP::View &view) noexcept {
+    /* The timestamp of the pipeline clock, if any, is the capture time of
+     * the view and is moved to the epoch for its wall-clock timestamp */
+    auto now = VPP::View::now_us();
+    if ( (stamped != 0) && (stamped <= now) ) {
+        using namespace std::chrono;
+        auto epoch = system_clock::now().time_since_epoch();
+        auto age   = microseconds(now - stamped);
+        view.clock(stamped);
+        view.stamp(static_cast<uint64_t>(
+                       duration_cast<milliseconds>(epoch - age).count()));
+    }
+    return 0;
+}
+
+int GStreamer::close() noexcept {
+    stop();
+    if (sink != nullptr) {
+        gst_object_unref(sink);
+        sink = nullptr;
+    }
+    if (pipeline != nullptr) {
+        gst_object_unref(pipeline);
+        pipeline = nullptr;
+    }
+    launch.clear();
+    stamped = 0;
+
+    return 0;
+}
+
+bool GStreamer::start(const std::string &caps, int &width,
+                      int &height) noexcept {
+    auto app    = GST_APP_SINK(sink);
+    auto filter = gst_caps_from_string(caps.c_str());
+    gst_app_sink_set_caps(app, filter);
+    gst_caps_unref(filter);
+
+    if (gst_element_set_state(pipeline, GST_STATE_PLAYING) ==
+        GST_STATE_CHANGE_FAILURE) {
+        failed();
+        stop();
+        return false;
+    }
+
+    /* The caps can only be negotiated once the first sample arrives, for
+     * the live sources do not preroll */
+    for (int i = 0; (pending == nullptr) && (i < patience); ++i) {
+        pending = gst_app_sink_try_pull_sample(app, polling);
+        if ( (pending == nullptr) &&
+             ( (gst_app_sink_is_eos(app)) || (failed()) ) ) {
+            break;
+        }
+    }
+
+    GstVideoInfo info;
+    if ( (pending == nullptr) ||
+         (!gst_video_info_from_caps(&info, gst_sample_get_caps(pending))) ) {
+        stop();
+        return false;
+    }
+
+    width  = GST_VIDEO_INFO_WIDTH(&info);
+    height = GST_VIDEO_INFO_HEIGHT(&info);
+
+    return true;
+}
+
+void GStreamer::stop() noexcept {
+    if (pending != nullptr) {
+        gst_sample_unref(pending);
+        pending = nullptr;
+    }
+    if (pipeline != nullptr) {
+        gst_element_set_state(pipeline, GST_STATE_NULL);
+    }
+}
+
+bool GStreamer::failed() noexcept {
+    auto bus = gst_element_get_bus(pipeline);
+    bool any = false;
+    GstMessage *message;
+    while ( (message = gst_bus_pop_filtered(bus, GST_MESSAGE_ERROR)) !=
+            nullptr ) {
+        GError *error = nullptr;
+        gchar  *debug = nullptr;
+        gst_message_parse_error(message, &error, &debug);
+        LOGE("GStreamer::failed(): '%s' failed: %s (%s)", launch.c_str(),
+             error->message, (debug != nullptr) ? debug : "");
+        g_error_free(error);
+        g_free(debug);
+        gst_message_unref(message);
+        any = true;
+    }
+    gst_object_unref(bus);
+
+    return any;
+}
+
+uint64_t GStreamer::stamp(GstSample *sample) noexcept {
+    auto buffer  = gst_sample_get_buffer(sample);
+    auto segment = gst_sample_get_segment(sample);
+    if ( (buffer == nullptr) || (segment == nullptr) ||
+         (!GST_BUFFER_PTS_IS_VALID(buffer)) ) {
+        return 0;
+    }
+
+    auto running = gst_segment_to_running_time(segment, GST_FORMAT_TIME,
+                                               GST_BUFFER_PTS(buffer));
+    auto clock   = gst_element_get_clock(pipeline);
+    if ( (clock == nullptr) || (!GST_CLOCK_TIME_IS_VALID(running)) ) {
+        if (clock != nullptr) {
+            gst_object_unref(clock);
+        }
+        return 0;
+    }
+
+    /* The age of the frame on the pipeline clock, whatever this clock */
+    auto at  = gst_element_get_base_time(pipeline) + running;
+    auto now = gst_clock_get_time(clock);
+    gst_object_unref(clock);
+    auto age = (now > at) ? (now - at) / 1000 : 0;
+
+    /* Hence the time of the frame on the steady clock */
+    auto steady = VPP::View::now_us();
+    return (steady > age) ? steady - age : 0;
+}
+
+} // namespace IO
+} // namespace Util
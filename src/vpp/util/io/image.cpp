@@ -23,9 +23,45 @@
 namespace Util {
 namespace IO {
 
+/* Get the reduced decoding mode for snapshots of a given size to be no
+ * smaller than the requested size */
+static int decoding_for(const cv::Size &native, int width, int height) {
+    static const int reduced[] = { cv::IMREAD_REDUCED_COLOR_8,
+                                   cv::IMREAD_REDUCED_COLOR_4,
+                                   cv::IMREAD_REDUCED_COLOR_2 };
+    static const int factors[] = { 8, 4, 2 };
+
+    for (int i = 0; i < 3; ++i) {
+        if ( (width > 0) && (height > 0) &&
+             (native.width >= width * factors[i]) &&
+             (native.height >= height * factors[i]) ) {
+            return reduced[i];
+        }
+    }
+
+    return cv::IMREAD_UNCHANGED;
+}
+
 Image::Image() noexcept
-    : Input({ "image/http", "image/https", "image/file" }) {}
-Image::~Image() noexcept = default;
+    : Input({ "image/http", "image/https", "image/file" }), socket(), data(),
+      next(), pending(), decoding(cv::IMREAD_UNCHANGED) {}
+
+Image::~Image() noexcept {
+    settle();
+}
+
+void Image::prefetch() noexcept {
+    next.clear();
+    pending = std::async(std::launch::async, 
+                         [this]() { return socket.get(next); });
+}
+
+void Image::settle() noexcept {
+    if (pending.valid()) {
+        pending.wait();
+        pending = std::future<int>();
+    }
+}
  
 std::vector<std::string> Image::modes() noexcept {
     return {};
@@ -40,11 +76,14 @@ int Image::open(const std::string &protocol,
     auto kind = protocol.substr(6, protocol.length()-6);
     ASSERT(supports(protocol), "Image::open(): unsupported protocol %s", 
            protocol.c_str());
+    settle();
+    decoding = cv::IMREAD_UNCHANGED;
     return socket.open(kind, source);
 }
 
 int Image::setup(const std::string &username,
                  const std::string &password) noexcept {
+    settle();
     return socket.setup(username, password);
 }
 
@@ -52,12 +91,20 @@ int Image::setup(int &width, int &height, int &rotation) noexcept {
     cv::Mat          test;
     VPP::Image::Mode mode;
 
+    /* Snapshots much larger than requested are decoded at a reduced size,
+     * the decoder then skipping most of the work */
+    decoding = cv::IMREAD_UNCHANGED;
     auto error = read(test, mode);
     if (error) {
         LOGE("SETUP IMAGE: error %d", error);
         return error;
     }
 
+    decoding = decoding_for(test.size(), width, height);
+    if (decoding != cv::IMREAD_UNCHANGED) {
+        test = cv::imdecode(data, decoding);
+    }
+
     width    = test.cols;
     height   = test.rows;
     rotation = 0;
@@ -66,11 +113,20 @@ int Image::setup(int &width, int &height, int &rotation) noexcept {
 }
 
 int Image::read(cv::Mat &image, VPP::Image::Mode &mode) noexcept {
-    data.clear();
+    int error;
+
+    /* Use the prefetched snapshot if any, or get one otherwise */
+    if (pending.valid()) {
+        error = pending.get();
+        std::swap(data, next);
+    } else {
+        data.clear();
+        error = socket.get(data);
+    }
 
-    auto error = socket.get(data);
     if (! error) {
-        image = cv::imdecode(data, -1);
+        prefetch();
+        image = cv::imdecode(data, decoding);
         mode  = VPP::Image::Mode::BGR;
     }
 
@@ -78,6 +134,7 @@ int Image::read(cv::Mat &image, VPP::Image::Mode &mode) noexcept {
 }
 
 int Image::close() noexcept {
+    settle();
     return socket.close();
 }
 
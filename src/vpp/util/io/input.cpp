@@ -39,6 +39,10 @@ std::vector<std::string> Input::sources() const noexcept {
     return {};
 }
 
+std::string Input::identity() const noexcept {
+    return std::string();
+}
+
 static std::vector<std::pair<int, int>> test_modes = {
     /* 4:3 */ 
     {  640,  480 }, {  768,  576 }, {  800,  600 }, { 1024,  768 },
@@ -108,6 +112,12 @@ int Input::setup(int &width, int &height, int &rotation) noexcept {
     return -1;
 }
  
+int Input::prefer(const std::string & /*backend*/,
+                  const std::string & /*acceleration*/) noexcept {
+    /* Nothing to do, we are fine */
+    return 0;
+}
+
 int Input::read(cv::Mat & /*image*/, VPP::Image::Mode & /*mode*/) noexcept {
     LOGE("Input::read(cv::Mat &) not defined in child class");
     assert(false);
@@ -115,6 +125,11 @@ int Input::read(cv::Mat & /*image*/, VPP::Image::Mode & /*mode*/) noexcept {
     return -1;
 }
 
+int Input::attach(VPP::View & /*view*/) noexcept {
+    /* Nothing to do, we are fine */
+    return 0;
+}
+
 int Input::close() noexcept {
     LOGE("Input::close() not defined in child class");
     assert(false);
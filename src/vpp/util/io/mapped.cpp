@@ -0,0 +1,80 @@
+/**
+ *
+ * @file      vpp/util/io/mapped.cpp
+ *
+ * @brief     This is the read-only memory-mapped file implementation
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "vpp/util/io/mapped.hpp"
+
+namespace Util {
+namespace IO {
+
+Mapped::Mapped() noexcept : map(nullptr), length(0), opening(false) {}
+
+Mapped::~Mapped() noexcept {
+    close();
+}
+
+int Mapped::open(const std::string &path) noexcept {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if ( (fstat(fd, &st) < 0) || (!S_ISREG(st.st_mode)) ) {
+        ::close(fd);
+        return -1;
+    }
+
+    length = static_cast<std::size_t>(st.st_size);
+    if (length > 0) {
+        void *m = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m == MAP_FAILED) {
+            ::close(fd);
+            length = 0;
+            return -1;
+        }
+
+        /* The whole file is about to be parsed in sequence */
+        madvise(m, length, MADV_SEQUENTIAL | MADV_WILLNEED);
+        map = static_cast<const char *>(m);
+    }
+
+    /* The mapping outlives its file descriptor */
+    ::close(fd);
+    opening = true;
+
+    return 0;
+}
+
+int Mapped::close() noexcept {
+    if (map != nullptr) {
+        munmap(const_cast<char *>(map), length);
+    }
+    map     = nullptr;
+    length  = 0;
+    opening = false;
+
+    return 0;
+}
+
+}  // namespace IO
+}  // namespace Util
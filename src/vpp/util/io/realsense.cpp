@@ -14,10 +14,15 @@
  *
  **/
 
+#include <atomic>
 #include <bitset>
+#include <chrono>
 #include <cstring>
 #include <librealsense2/rs.hpp>
 #include <librealsense2/hpp/rs_processing.hpp>
+#include <librealsense2/rsutil.h>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 
 #include "vpp/error.hpp"
@@ -39,17 +44,49 @@ public:
     Core &operator=(Core &&other) = delete;
 
     std::vector<std::string> modes(rs2_stream id) noexcept;
-    int use(rs2_stream id) noexcept; 
+    std::string identity() const noexcept;
+    int use(rs2_stream id, int decimation, bool sparse) noexcept;
     int setup(rs2_stream id, int &width, int &height) noexcept;
     int get(rs2_stream id, cv::Mat &image, VPP::Image::Mode &mode) noexcept;
     int release(rs2_stream id) noexcept;
 
+    /* Setting the inter-camera hardware sync mode of the device, shared by
+     * all its streams (0 for none, 1 for master and 2 for slave) */
+    int sync(int mode) noexcept;
+
+    /* The epoch timestamp in us of the last frame got, if stamped by the
+     * host clock, and 0 otherwise */
+    uint64_t stamp(rs2_stream id) const noexcept;
+
     cv::Point project(const cv::Point3f &p) const noexcept override;
     cv::Point3f deproject(const cv::Point &p,
                           float z) const noexcept override;
+    void deproject(const std::vector<cv::Point> &p, float z,
+                   std::vector<cv::Point3f> &points) const noexcept override;
+    void deproject(const std::vector<cv::Point> &p,
+                   const std::vector<float> &z,
+                   std::vector<cv::Point3f> &points) const noexcept override;
+    void deproject(const cv::Mat &depth, const cv::Point &origin,
+                   cv::Mat &cloud) const noexcept override;
+    cv::Point locate(const cv::Point &p,
+                     const cv::Mat &depth) const noexcept override;
 
 private:
-    void sync() noexcept;
+    /* Apply the sync mode to the running device, with the timestamps of all
+     * its sensors moved to the host clock for matching the frames of the
+     * synchronised devices */
+    void synchronise() noexcept;
+
+    /* Align and filter the streamed framesets, off the capture thread */
+    void run() noexcept;
+    void process(rs2::frame f, rs2::frame_source &src) noexcept;
+
+    /* Update the geometry for locating the colour pixels in a sparse depth
+     * map, and get the intrinsics of the frames to project, as a snapshot
+     * taken with the geometry lock held */
+    void map(const rs2::frame &depth) noexcept;
+    rs2_intrinsics optics() const noexcept;
+
     std::string                                 serial;
     std::bitset<RS2_STREAM_COUNT>               used;
     std::bitset<RS2_STREAM_COUNT>               configured;
@@ -57,21 +94,64 @@ private:
     rs2::pipeline                               pipe;
     rs2::pipeline_profile                       running;
     rs2::align                                  align_to_color;
-    rs2::frameset                               data;
     std::unordered_map<int, rs2::frame>         frame;
     std::unordered_map<int, unsigned long long> last_frame_id;
     std::unordered_map<int, unsigned long long> used_frame_id;
     rs2_intrinsics                              intrinsics;
+    int                                         syncing;
+
+    /* The depth map is decimated and left as is in sparse mode, the colour
+     * pixels being then located in it instead of aligning the whole map */
+    std::atomic<int>                            decimation;
+    std::atomic<bool>                           sparse;
+    bool                                        mapped;
+    rs2_intrinsics                              depth_intrinsics;
+    rs2_intrinsics                              color_intrinsics;
+    rs2_extrinsics                              color2depth;
+    rs2_extrinsics                              depth2color;
+
+    /* The geometry above (and the intrinsics) are updated by the capture
+     * thread whilst the scenes of the previous frames project with them */
+    mutable std::mutex                          geometry;
+    rs2::decimation_filter                      decimator;
     rs2::disparity_transform                    depth2disparity;
     rs2::disparity_transform                    disparity2depth;
     rs2::temporal_filter                        temporal_filter;
     rs2::hole_filling_filter                    hole_filter;
+
+    /* The streamed framesets and the processed ones, both holding only the
+     * latest frameset for never lagging behind the device */
+    rs2::frame_queue                            streamed;
+    rs2::frame_queue                            processed;
+    rs2::processing_block                       processor;
+    std::atomic<bool>                           exiting;
+    std::thread                                 worker;
 };
 
 /*
  * Static utility functions
  */
 
+/* Getting the pinhole model of undistorted or inverse distorted intrinsics,
+ * the only ones that can be deprojected */
+static bool pinhole(const rs2_intrinsics &in, VPP::Pinhole &model) noexcept {
+    if ( (in.model != RS2_DISTORTION_NONE) &&
+         (in.model != RS2_DISTORTION_INVERSE_BROWN_CONRADY) ) {
+        return false;
+    }
+
+    model.fx  = in.fx;
+    model.fy  = in.fy;
+    model.ppx = in.ppx;
+    model.ppy = in.ppy;
+    for (int i = 0; i < 5; ++i) {
+        model.coeffs[i] = (in.model == RS2_DISTORTION_NONE) ? 0 :
+                                                              in.coeffs[i];
+    }
+
+    return true;
+}
+
 /* Getting a realsense device (core) from an id */
 static rs2::context context;
 static rs2::device_list rs_devices(context.query_devices());
@@ -95,6 +175,17 @@ static const char *device_id_at(int id) {
     return nullptr;
 }
 
+static Realsense::Core *core_for(const std::string &did) {
+    auto found = cores.find(did);
+    if (found != cores.end()) {
+        return &found->second;
+    }
+    
+    cores.emplace(did, did.c_str());
+    
+    return &cores.find(did)->second;
+}
+
 static Realsense::Core *core_for(int id) {
     // Use a copy of the device_id
     auto rs_did = device_id_at(id);
@@ -102,34 +193,58 @@ static Realsense::Core *core_for(int id) {
         return nullptr;
     }
 
-    std::string copy(rs_did);
-    const char *did = copy.c_str();
-    
-    auto found = cores.find(did);
-    if (found != cores.end()) {
-        return &found->second;
+    return core_for(std::string(rs_did));
+}
+
+/* Getting a device index from its serial number, -1 if not found */
+static int device_index_of(const std::string &serial) {
+    for (int i = 0; i < static_cast<int>(rs_devices.size()); ++i) {
+        if (serial == device_id_at(i)) {
+            return i;
+        }
     }
-    
-    cores.emplace(did, did);
-    
-    return &cores.find(did)->second;
+    return -1;
 }
 
-/* Getting a stream id from a protocol string */
+/* Getting the inter-camera sync modes from their names */
+static const std::unordered_map<std::string, int> sync_of_string({
+        { "default", 0 }, { "master", 1 }, { "slave", 2 } });
+
+/* Getting a stream id, its decimation and sparsity from a protocol string */
 #define RS2_STREAM_DEPTH_STR    "rs/depth"
 #define RS2_STREAM_COLOR_STR    "rs/color"
-static int stream_for(const std::string &protocol) {
-    
-    static std::unordered_map<std::string, int> stream_of_string({
-            { RS2_STREAM_COLOR_STR, RS2_STREAM_COLOR },
-            { RS2_STREAM_DEPTH_STR, RS2_STREAM_DEPTH } });
+#define RS2_STREAM_SPARSE_STR   RS2_STREAM_DEPTH_STR "/sparse"
+#define RS2_STREAM_X2_STR       "/x2"
+#define RS2_STREAM_X4_STR       "/x4"
+struct Stream {
+    int  id;
+    int  decimation;
+    bool sparse;
+};
 
+static const std::unordered_map<std::string, Stream> stream_of_string({
+        { RS2_STREAM_COLOR_STR,                    { RS2_STREAM_COLOR, 1,
+                                                     false } },
+        { RS2_STREAM_DEPTH_STR,                    { RS2_STREAM_DEPTH, 1,
+                                                     false } },
+        { RS2_STREAM_DEPTH_STR RS2_STREAM_X2_STR,  { RS2_STREAM_DEPTH, 2,
+                                                     false } },
+        { RS2_STREAM_DEPTH_STR RS2_STREAM_X4_STR,  { RS2_STREAM_DEPTH, 4,
+                                                     false } },
+        { RS2_STREAM_SPARSE_STR,                   { RS2_STREAM_DEPTH, 1,
+                                                     true } },
+        { RS2_STREAM_SPARSE_STR RS2_STREAM_X2_STR, { RS2_STREAM_DEPTH, 2,
+                                                     true } },
+        { RS2_STREAM_SPARSE_STR RS2_STREAM_X4_STR, { RS2_STREAM_DEPTH, 4,
+                                                     true } } });
+
+static Stream stream_for(const std::string &protocol) {
     auto found = stream_of_string.find(protocol);
     if (found != stream_of_string.end()) {
         return found->second;
     }
 
-    return -1;
+    return Stream{ -1, 1, false };
 }
 
 /*
@@ -138,19 +253,135 @@ static int stream_for(const std::string &protocol) {
 
 Realsense::Core::Core(const char *device) noexcept
     : VPP::Projecter(), serial(device), used(), configured(),
-      cfg(), pipe(), running(), align_to_color(RS2_STREAM_COLOR), data(),
-      frame(), last_frame_id(), used_frame_id(), intrinsics(),
+      cfg(), pipe(), running(), align_to_color(RS2_STREAM_COLOR),
+      frame(), last_frame_id(), used_frame_id(), intrinsics(), syncing(-1),
+      decimation(1), sparse(false), mapped(false), depth_intrinsics(),
+      color_intrinsics(), color2depth(), depth2color(), geometry(),
+      decimator(),
       depth2disparity(), disparity2depth(false), 
       temporal_filter(0.4, 20.0, 8), /* alpha = 0.4, delta = 20, persistence 
                                         always (8) */ 
-      hole_filter(1) /* Fill with farest from */ {
+      hole_filter(1) /* Fill with farest from */, streamed(1), processed(1),
+      processor([this](rs2::frame f, rs2::frame_source &src) {
+                    process(std::move(f), src); }),
+      exiting(false), worker() {
     zscale = 0.0;
     LOGD("Realsense::Core::Core(%s)", serial.c_str());
     cfg.enable_device(serial.c_str());
+    processor.start(processed);
+    worker = std::thread(&Core::run, this);
 }
 
 Realsense::Core::~Core() noexcept {
     LOGD("Realsense::Core::~Core(%s)", serial.c_str());
+    exiting = true;
+    worker.join();
+}
+
+void Realsense::Core::run() noexcept {
+    rs2::frame f;
+
+    while (!exiting) {
+        /* Time out regularly for checking whether to exit */
+        if (streamed.try_wait_for_frame(&f, 100)) {
+            try {
+                processor.invoke(std::move(f));
+            } catch (const rs2::error &e) {
+                LOGE("Realsense::Core::run(%s): %s", serial.c_str(), e.what());
+            }
+        }
+    }
+}
+
+void Realsense::Core::process(rs2::frame f,
+                              rs2::frame_source &src) noexcept {
+    rs2::frameset data = f.as<rs2::frameset>();
+    rs2::frame    color, depth;
+
+    // A single stream may not be streamed as a frameset
+    if (data) {
+        color = data.get_color_frame();
+        depth = data.get_depth_frame();
+    } else if (f.get_profile().stream_type() == RS2_STREAM_COLOR) {
+        color = f;
+    } else {
+        depth = f;
+    }
+
+    // Filter the depth at its native (or decimated) resolution
+    const bool aligning = (color && depth && (!sparse));
+    std::vector<rs2::frame> frames;
+    if (depth) {
+        if (decimation > 1) {
+            decimator.set_option(RS2_OPTION_FILTER_MAGNITUDE,
+                                 static_cast<float>(decimation));
+            depth = std::move(decimator.process(depth));
+        }
+        depth = std::move(depth2disparity.process(depth));
+        depth = std::move(temporal_filter.process(depth));
+        depth = std::move(hole_filter.process(depth));
+        depth = std::move(disparity2depth.process(depth));
+        frames.emplace_back(std::move(depth));
+    }
+    if (color) {
+        frames.emplace_back(std::move(color));
+    }
+
+    rs2::frame filtered = src.allocate_composite_frame(std::move(frames));
+
+    // Make sure the frames are spatially aligned, unless the depth is sparse
+    if (aligning) {
+        filtered = align_to_color.process(filtered);
+    }
+
+    src.frame_ready(std::move(filtered));
+}
+
+void Realsense::Core::map(const rs2::frame &depth) noexcept {
+    bool sparsed = (sparse && configured[RS2_STREAM_COLOR]);
+    if (!sparsed) {
+        /* Inside a lock_guard scoped block, as we update the geometry */
+        std::lock_guard<std::mutex> lock(geometry);
+        mapped = false;
+        return;
+    }
+
+    auto d  = depth.get_profile().as<rs2::video_stream_profile>();
+    auto c  = running.get_stream(RS2_STREAM_COLOR)
+                     .as<rs2::video_stream_profile>();
+    auto di = d.get_intrinsics();
+    auto ci = c.get_intrinsics();
+    auto ce = c.get_extrinsics_to(d);
+    auto de = d.get_extrinsics_to(c);
+
+    /* Inside a lock_guard scoped block, as we update the geometry */
+    std::lock_guard<std::mutex> lock(geometry);
+    mapped           = true;
+    depth_intrinsics = di;
+    color_intrinsics = ci;
+    color2depth      = ce;
+    depth2color      = de;
+}
+
+rs2_intrinsics Realsense::Core::optics() const noexcept {
+    /* Sparse depth maps are looked up with colour pixels */
+    std::lock_guard<std::mutex> lock(geometry);
+    return mapped ? color_intrinsics : intrinsics;
+}
+
+std::string Realsense::Core::identity() const noexcept {
+    std::string id("rs:" RS2_API_VERSION_STR ":" + serial);
+
+    for (auto&& dev : rs_devices) {
+        if ( (serial == dev.get_info(RS2_CAMERA_INFO_SERIAL_NUMBER)) &&
+             (dev.supports(RS2_CAMERA_INFO_FIRMWARE_VERSION)) ) {
+            id += std::string(":") +
+                  dev.get_info(RS2_CAMERA_INFO_FIRMWARE_VERSION);
+            break;
+        }
+    }
+
+    return id;
 }
 
 std::vector<std::string> Realsense::Core::modes(rs2_stream id) noexcept {
@@ -185,11 +416,17 @@ std::vector<std::string> Realsense::Core::modes(rs2_stream id) noexcept {
     return valid_modes;
 }
 
-int Realsense::Core::use(rs2_stream id) noexcept {
+int Realsense::Core::use(rs2_stream id, int decimating,
+                         bool sparsing) noexcept {
     if (used[id]) {
         return Error::INVALID_REQUEST;
     }
 
+    if (id == RS2_STREAM_DEPTH) {
+        decimation = decimating;
+        sparse     = sparsing;
+    }
+
     used[id] = true;
     return Error::NONE;
 }
@@ -200,20 +437,22 @@ int Realsense::Core::setup(rs2_stream id, int &width, int &height) noexcept {
     }
 
     if (running) { // If pipe was already running then stop to reconfigure
-        pipe.wait_for_frames(); 
         pipe.stop();
     }
 
     cfg.enable_stream(id, width, height, (id == RS2_STREAM_COLOR) ? 
                                           RS2_FORMAT_BGR8 : RS2_FORMAT_Z16);
 
-    running = pipe.start(cfg);
+    /* Stream the framesets to the processing thread */
+    running = pipe.start(cfg, [this](rs2::frame f) {
+                                  streamed.enqueue(std::move(f)); });
 
     auto geom = running.get_stream(id).as<rs2::video_stream_profile>();
     width  = geom.width();
     height = geom.height();
 
     configured[id] = true;
+    synchronise();
 
     last_frame_id.emplace(id, 0);
     used_frame_id.emplace(id, 0);
@@ -232,7 +471,11 @@ int Realsense::Core::setup(rs2_stream id, int &width, int &height) noexcept {
         }
 
         zscale = sensor.get_depth_scale();
-        intrinsics = geom.get_intrinsics();
+        {
+            /* Inside a lock_guard scoped block, as we update the geometry */
+            std::lock_guard<std::mutex> lock(geometry);
+            intrinsics = geom.get_intrinsics();
+        }
         LOGD("Realsense::Core::setup(%s@%d): zscale = %f", 
               serial.c_str(), id, zscale);
     }
@@ -260,13 +503,8 @@ int Realsense::Core::get(rs2_stream id, cv::Mat &image,
                 (has_color && (used_frame_id[RS2_STREAM_COLOR] == 
                                last_frame_id[RS2_STREAM_COLOR]) ) ) {
 
-            // Wait for the next set of frames
-            data = pipe.wait_for_frames();
-
-            // Make sure the frames are spatially aligned
-            if (has_depth && has_color) {
-                data = align_to_color.process(data);
-            }
+            // Wait for the next set of aligned and filtered frames
+            rs2::frameset data = processed.wait_for_frame();
 
             // Update the color frame
             if (has_color) {
@@ -277,12 +515,8 @@ int Realsense::Core::get(rs2_stream id, cv::Mat &image,
 
             // Update the depth frame
             if (has_depth) {
-                rs2::frame depth = data.get_depth_frame();
-                depth = std::move(depth2disparity.process(depth));
-                depth = std::move(temporal_filter.process(depth));
-                depth = std::move(hole_filter.process(depth));
-                depth = std::move(disparity2depth.process(depth));
-                frame[RS2_STREAM_DEPTH] = std::move(depth);
+                frame[RS2_STREAM_DEPTH] = std::move(data.get_depth_frame());
+                map(frame[RS2_STREAM_DEPTH]);
                 last_frame_id[RS2_STREAM_DEPTH] = 
                                     frame[RS2_STREAM_DEPTH].get_frame_number();
             }
@@ -302,6 +536,67 @@ int Realsense::Core::get(rs2_stream id, cv::Mat &image,
     return Error::NONE; 
 }
 
+uint64_t Realsense::Core::stamp(rs2_stream id) const noexcept {
+    auto found = frame.find(id);
+    if ( (found == frame.end()) || (!found->second) ||
+         (!configured[id]) ) {
+        return 0;
+    }
+
+    /* The device timestamps are only moved to the host clock by the global
+     * time domain, as are the system ones */
+    auto domain = found->second.get_frame_timestamp_domain();
+    if ( (domain != RS2_TIMESTAMP_DOMAIN_GLOBAL_TIME) &&
+         (domain != RS2_TIMESTAMP_DOMAIN_SYSTEM_TIME) ) {
+        return 0;
+    }
+
+    return static_cast<uint64_t>(found->second.get_timestamp() * 1000.0);
+}
+
+int Realsense::Core::sync(int mode) noexcept {
+    /* All the streams of a device share its sync mode */
+    if ( (syncing >= 0) && (syncing != mode) ) {
+        LOGE("Realsense::Core::sync(%s): Already in sync mode %d, cannot "
+             "switch to sync mode %d", serial.c_str(), syncing, mode);
+        return Error::INVALID_REQUEST;
+    }
+
+    syncing = mode;
+    if (running) {
+        synchronise();
+    }
+
+    return Error::NONE;
+}
+
+void Realsense::Core::synchronise() noexcept {
+    if (syncing < 0) {
+        return;
+    }
+
+    try {
+        auto device = running.get_device();
+        for (auto &&s : device.query_sensors()) {
+            if (s.supports(RS2_OPTION_GLOBAL_TIME_ENABLED)) {
+                s.set_option(RS2_OPTION_GLOBAL_TIME_ENABLED, 1);
+            }
+        }
+
+        auto sensor = device.first<rs2::depth_sensor>();
+        if (sensor.supports(RS2_OPTION_INTER_CAM_SYNC_MODE)) {
+            sensor.set_option(RS2_OPTION_INTER_CAM_SYNC_MODE,
+                              static_cast<float>(syncing));
+        } else {
+            LOGW("Realsense::Core::synchronise(%s): No hardware sync "
+                 "support!", serial.c_str());
+        }
+    } catch (const rs2::error &e) {
+        LOGE("Realsense::Core::synchronise(%s): %s", serial.c_str(),
+             e.what());
+    }
+}
+
 int Realsense::Core::release(rs2_stream id) noexcept {
     LOGD("Realsense::Core::release(%s@%d)", serial.c_str(), id);
     if (!used[id]) {
@@ -319,19 +614,22 @@ int Realsense::Core::release(rs2_stream id) noexcept {
     }
 
     if (running) { // If pipe was already running then stop to reconfigure
-        pipe.wait_for_frames(); 
         pipe.stop();
     }
 
     configured[id] = false;
     used[id]       = false;
+    if (used.none()) {
+        syncing = -1;
+    }
     
     frame.erase(id);
     last_frame_id.erase(id);
     used_frame_id.erase(id);
 
     if (used.any()) {
-        running = pipe.start(cfg);
+        running = pipe.start(cfg, [this](rs2::frame f) {
+                                      streamed.enqueue(std::move(f)); });
     } else {
         running = rs2::pipeline_profile();
         cores.erase(serial);
@@ -347,35 +645,36 @@ cv::Point Realsense::Core::project(const cv::Point3f &p) const noexcept {
     }
 
     /* Otherwise, do the computation */
+    const rs2_intrinsics &in = optics();
     float x = p.x / p.z;
     float y = p.y / p.z;
 
-    if(intrinsics.model == RS2_DISTORTION_MODIFIED_BROWN_CONRADY)
+    if(in.model == RS2_DISTORTION_MODIFIED_BROWN_CONRADY)
     {
         float r2  = x*x + y*y;
-        float f = 1 + (intrinsics.coeffs[0] + 
-                  (intrinsics.coeffs[1] + intrinsics.coeffs[4]*r2)*r2)*r2;
+        float f = 1 + (in.coeffs[0] + 
+                  (in.coeffs[1] + in.coeffs[4]*r2)*r2)*r2;
         x *= f;
         y *= f;
-        float dx = x + 2*intrinsics.coeffs[2]*x*y + 
-                   intrinsics.coeffs[3]*(r2 + 2*x*x);
-        float dy = y + 2*intrinsics.coeffs[3]*x*y + 
-                   intrinsics.coeffs[2]*(r2 + 2*y*y);
+        float dx = x + 2*in.coeffs[2]*x*y + 
+                   in.coeffs[3]*(r2 + 2*x*x);
+        float dy = y + 2*in.coeffs[3]*x*y + 
+                   in.coeffs[2]*(r2 + 2*y*y);
         x = dx;
         y = dy;
     }
 
-    if (intrinsics.model == RS2_DISTORTION_FTHETA)
+    if (in.model == RS2_DISTORTION_FTHETA)
     {
         float r = sqrt(x*x + y*y);
-        float rd = (1.0f / intrinsics.coeffs[0] * 
-                    atan(2 * r* tan(intrinsics.coeffs[0] / 2.0f)));
+        float rd = (1.0f / in.coeffs[0] * 
+                    atan(2 * r* tan(in.coeffs[0] / 2.0f)));
         x *= rd / r;
         y *= rd / r;
     }
 
-    return cv::Point(x * intrinsics.fx + intrinsics.ppx, 
-                     y * intrinsics.fy + intrinsics.ppy);
+    return cv::Point(x * in.fx + in.ppx, 
+                     y * in.fy + in.ppy);
 }
 
 cv::Point3f Realsense::Core::deproject(const cv::Point &p, 
@@ -386,24 +685,25 @@ cv::Point3f Realsense::Core::deproject(const cv::Point &p,
     }
 
     /* Otherwise, do the computation */
-    ASSERT(intrinsics.model != RS2_DISTORTION_MODIFIED_BROWN_CONRADY,
+    const rs2_intrinsics &in = optics();
+    ASSERT(in.model != RS2_DISTORTION_MODIFIED_BROWN_CONRADY,
            "Realsense::Core::deproject() : "
            "Cannot deproject from a forward-distorted image");
-    ASSERT(intrinsics.model != RS2_DISTORTION_FTHETA,
+    ASSERT(in.model != RS2_DISTORTION_FTHETA,
            "Realsense::Core::deproject() : "
            "Cannot deproject to an FTheta image");
 
-    float x  = (p.x - intrinsics.ppx) / intrinsics.fx;
-    float y  = (p.y - intrinsics.ppy) / intrinsics.fy;
-    if(intrinsics.model == RS2_DISTORTION_INVERSE_BROWN_CONRADY)
+    float x  = (p.x - in.ppx) / in.fx;
+    float y  = (p.y - in.ppy) / in.fy;
+    if(in.model == RS2_DISTORTION_INVERSE_BROWN_CONRADY)
     {
         float r2  = x*x + y*y;
-        float f = 1 + (intrinsics.coeffs[0] + (intrinsics.coeffs[1] + 
-                       intrinsics.coeffs[4]*r2)*r2)*r2;
-        float ux = x*f + 2*intrinsics.coeffs[2]*x*y +
-                   intrinsics.coeffs[3]*(r2 + 2*x*x);
-        float uy = y*f + 2*intrinsics.coeffs[3]*x*y +
-                   intrinsics.coeffs[2]*(r2 + 2*y*y);
+        float f = 1 + (in.coeffs[0] + (in.coeffs[1] + 
+                       in.coeffs[4]*r2)*r2)*r2;
+        float ux = x*f + 2*in.coeffs[2]*x*y +
+                   in.coeffs[3]*(r2 + 2*x*x);
+        float uy = y*f + 2*in.coeffs[3]*x*y +
+                   in.coeffs[2]*(r2 + 2*y*y);
         x = ux;
         y = uy;
     }
@@ -411,12 +711,118 @@ cv::Point3f Realsense::Core::deproject(const cv::Point &p,
     return cv::Point3f(z*x, z*y, z);
 }
 
+void Realsense::Core::deproject(const std::vector<cv::Point> &p, float z,
+                                std::vector<cv::Point3f> &points)
+    const noexcept {
+    VPP::Pinhole model;
+
+    /* Without any pinhole model, deproject the points one by one */
+    if ( (zscale == 0) || (!pinhole(optics(), model)) ) {
+        VPP::Projecter::deproject(p, z, points);
+        return;
+    }
+
+    points.resize(p.size());
+    for (std::size_t i = 0; i < p.size(); ++i) {
+        points[i] = model.deproject(p[i], z);
+    }
+}
+
+void Realsense::Core::deproject(const std::vector<cv::Point> &p,
+                                const std::vector<float> &z,
+                                std::vector<cv::Point3f> &points)
+    const noexcept {
+    VPP::Pinhole model;
+
+    /* Without any pinhole model, deproject the points one by one */
+    if ( (zscale == 0) || (!pinhole(optics(), model)) ) {
+        VPP::Projecter::deproject(p, z, points);
+        return;
+    }
+
+    points.resize(p.size());
+    for (std::size_t i = 0; i < p.size(); ++i) {
+        points[i] = model.deproject(p[i], z[i]);
+    }
+}
+
+void Realsense::Core::deproject(const cv::Mat &depth, const cv::Point &origin,
+                                cv::Mat &cloud) const noexcept {
+    VPP::Pinhole   model;
+    rs2_intrinsics in;
+    {
+        /* Inside a lock_guard scoped block, as we snapshot the geometry */
+        std::lock_guard<std::mutex> lock(geometry);
+        in = mapped ? depth_intrinsics : intrinsics;
+    }
+
+    /* The depth map pixels are those of the depth stream in sparse mode and
+     * those of the colour stream otherwise */
+    if ( (zscale == 0) || (!pinhole(in, model)) ) {
+        VPP::Projecter::deproject(depth, origin, cloud);
+        return;
+    }
+
+    cloud.create(depth.size(), CV_32FC3);
+    cv::Mat z;
+    for (int r = 0; r < depth.rows; ++r) {
+        if (depth.type() == CV_16UC1) {
+            depth.row(r).convertTo(z, CV_32F, zscale);
+        } else {
+            z = depth.row(r);
+        }
+        model.deproject(origin.x, origin.y + r, z.ptr<float>(), depth.cols,
+                        cloud.ptr<cv::Point3f>(r));
+    }
+}
+
+cv::Point Realsense::Core::locate(const cv::Point &p,
+                                  const cv::Mat &depth) const noexcept {
+    rs2_intrinsics di, ci;
+    rs2_extrinsics ce, de;
+    {
+        /* Inside a lock_guard scoped block, as we snapshot the geometry */
+        std::lock_guard<std::mutex> lock(geometry);
+
+        /* Aligned depth maps share the colour pixels */
+        if (!mapped) {
+            return p;
+        }
+        di = depth_intrinsics;
+        ci = color_intrinsics;
+        ce = color2depth;
+        de = depth2color;
+    }
+
+    /* The raw depth map of the view is the one searched, which has to be the
+     * full continuous depth frame of the sparse depth stream */
+    if ( (depth.type() != CV_16UC1) || (!depth.isContinuous()) ||
+         (depth.cols != di.width) || (depth.rows != di.height) ) {
+        return p;
+    }
+
+    /* Search the depth pixel along the epipolar line of the colour pixel
+     * within the working range of the camera (10 cm to 10 m) */
+    float from[2] = { static_cast<float>(p.x), static_cast<float>(p.y) };
+    float to[2];
+    rs2_project_color_pixel_to_depth_pixel(to,
+                    depth.ptr<uint16_t>(), zscale, 0.1f, 10.0f, &di, &ci,
+                    &ce, &de, from);
+
+    return cv::Point(static_cast<int>(to[0] + 0.5f),
+                     static_cast<int>(to[1] + 0.5f));
+}
+
 /*
  * Realsense interface methods
  */
 
 Realsense::Realsense() noexcept : 
-    Input({RS2_STREAM_COLOR_STR, RS2_STREAM_DEPTH_STR}), 
+    Input({RS2_STREAM_COLOR_STR, RS2_STREAM_DEPTH_STR,
+           RS2_STREAM_DEPTH_STR RS2_STREAM_X2_STR,
+           RS2_STREAM_DEPTH_STR RS2_STREAM_X4_STR, RS2_STREAM_SPARSE_STR,
+           RS2_STREAM_SPARSE_STR RS2_STREAM_X2_STR,
+           RS2_STREAM_SPARSE_STR RS2_STREAM_X4_STR}),
     stream(-1), core(nullptr) {}
 
 Realsense::~Realsense() noexcept {
@@ -446,6 +852,14 @@ std::vector<std::string> Realsense::modes() noexcept {
     return std::vector<std::string>();
 }
 
+std::string Realsense::identity() const noexcept {
+    if (core != nullptr) {
+        return core->identity();
+    }
+
+    return std::string();
+}
+
 int Realsense::open(const std::string &protocol, int id) noexcept {
     ASSERT(supports(protocol),
            "Realsense::open(): unsupported protocol %s",
@@ -458,12 +872,13 @@ int Realsense::open(const std::string &protocol, int id) noexcept {
 
     if (supports(protocol)) {
         auto stm = stream_for(protocol);
-        auto error = dev->use(static_cast<rs2_stream>(stm));
+        auto error = dev->use(static_cast<rs2_stream>(stm.id), stm.decimation,
+                              stm.sparse);
         if (error != Error::NONE) {
             return error;
         }
 
-        stream = stm;
+        stream = stm.id;
         core   = dev;
 
         return Error::NONE;
@@ -475,15 +890,42 @@ int Realsense::open(const std::string &protocol, int id) noexcept {
 
 int Realsense::open(const std::string &protocol,
                     const std::string &source) noexcept {
+    /* The source is the index or the serial number of the device, followed
+     * by its hardware sync mode, if any, as in "1@slave" */
+    auto at   = source.find('@');
+    auto name = source.substr(0, at);
+    int  mode = -1;
+    if (at != std::string::npos) {
+        auto found = sync_of_string.find(source.substr(at + 1));
+        if (found == sync_of_string.end()) {
+            return Error::INVALID_VALUE;
+        }
+        mode = found->second;
+    }
+
     int src;
-    std::istringstream data(source);
+    std::istringstream data(name);
 
     data >> src;
     auto status = data.rdstate();
     if (status != (std::ios::goodbit|std::ios::eofbit)) {
-        return Error::INVALID_VALUE;
+        discover();
+        src = device_index_of(name);
+        if (src < 0) {
+            return Error::INVALID_VALUE;
+        }
     }
-    return open(protocol, src);
+
+    auto error = open(protocol, src);
+    if ( (error != Error::NONE) || (mode < 0) ) {
+        return error;
+    }
+
+    error = core->sync(mode);
+    if (error != Error::NONE) {
+        close();
+    }
+    return error;
 }
 
 int Realsense::setup(const std::string & /*username*/,
@@ -511,6 +953,27 @@ int Realsense::read(cv::Mat &image, VPP::Image::Mode &mode) noexcept {
     return Error::INVALID_REQUEST;
 }
 
+int Realsense::attach(VPP::View &view) noexcept {
+    if (core == nullptr) {
+        return Error::INVALID_REQUEST;
+    }
+
+    /* The host timestamp of the frame, if any, gives its wall-clock timestamp
+     * and its capture time on the steady clock */
+    auto at = core->stamp(static_cast<rs2_stream>(stream));
+    if (at != 0) {
+        using namespace std::chrono;
+        auto epoch = static_cast<uint64_t>(duration_cast<microseconds>(
+                         system_clock::now().time_since_epoch()).count());
+        auto now   = VPP::View::now_us();
+        auto age   = (epoch > at) ? epoch - at : 0;
+        view.stamp(at / 1000);
+        view.clock((now > age) ? now - age : now);
+    }
+
+    return Error::NONE;
+}
+
 int Realsense::close() noexcept {
     if (core != nullptr) {
         auto error = core->release(static_cast<rs2_stream>(stream));
@@ -0,0 +1,349 @@
+/**
+ *
+ * @file      vpp/util/io/recording.cpp
+ *
+ * @brief     These are the view recorder and replay Input class
+ *            implementations
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#include "vpp/log.hpp"
+#include "vpp/util/io/recording.hpp"
+
+namespace Util {
+namespace IO {
+
+/* The frame header, followed by the headers and data of its images */
+struct FrameHeader {
+    uint32_t magic;
+    uint32_t count;
+    uint64_t ts;
+};
+
+struct PlaneHeader {
+    int32_t  mode;
+    int32_t  type;
+    int32_t  rows;
+    int32_t  cols;
+    float    zscale;
+    uint32_t reserved;
+    uint64_t size;
+};
+
+static constexpr uint32_t magic = 0x46505056; /* "VPPF" */
+
+/* The image data are aligned on 16 bytes */
+static inline std::size_t aligned(std::size_t size) {
+    return (size + 15) & ~static_cast<std::size_t>(15);
+}
+
+static const char padding[16] = { 0 };
+
+/*
+ * Recorder
+ */
+
+Recorder::Recorder() noexcept : file() {}
+
+Recorder::~Recorder() noexcept {
+    close();
+}
+
+int Recorder::open(const std::string &path) noexcept {
+    close();
+    file.open(path, std::ios::binary | std::ios::app);
+
+    return file.is_open() ? 0 : -1;
+}
+
+int Recorder::write(VPP::View &view) noexcept {
+    if (!file.is_open()) {
+        return -1;
+    }
+
+    /* Only the original images of the view are recorded */
+    std::vector<VPP::Image *> images;
+    for (auto im : { view.cached_colour(), view.cached_depth(),
+                     view.cached_motion() }) {
+        if (im != nullptr) {
+            images.push_back(im);
+        }
+    }
+
+    FrameHeader frame{ magic, static_cast<uint32_t>(images.size()),
+                       view.ts_ms() };
+    file.write(reinterpret_cast<const char *>(&frame), sizeof(frame));
+
+    for (auto im : images) {
+        cv::Mat data = im->input();
+        if (!data.isContinuous()) {
+            data = data.clone();
+        }
+
+        const auto mode = im->mode();
+        PlaneHeader plane{ static_cast<int>(mode), data.type(), data.rows,
+                           data.cols,
+                           mode.is_depth() ? 
+                              view.depth.scaler(mode, 
+                                                VPP::Image::Mode::DEPTHF) : 
+                              0.0f,
+                           0, data.total() * data.elemSize() };
+        file.write(reinterpret_cast<const char *>(&plane), sizeof(plane));
+        file.write(reinterpret_cast<const char *>(data.data), plane.size);
+        file.write(padding, aligned(plane.size) - plane.size);
+    }
+
+    return file.good() ? 0 : -1;
+}
+
+int Recorder::close() noexcept {
+    if (file.is_open()) {
+        file.close();
+    }
+
+    return 0;
+}
+
+/*
+ * Replay
+ */
+
+cv::Point Replay::Flat::project(const cv::Point3f &p) const noexcept {
+    return cv::Point(p.x, p.y);
+}
+
+cv::Point3f Replay::Flat::deproject(const cv::Point &p,
+                                    float z) const noexcept {
+    return cv::Point3f(p.x, p.y, z);
+}
+
+Replay::Replay() noexcept 
+    : Input({ "vpp/file", "vpp/file/realtime" }), fd(-1), map(nullptr),
+      length(0), index(), next(0), realtime(false), start(), first(0), ts(0),
+      extras(), flat() {
+    flat.zscale = 0.0f;
+}
+
+Replay::~Replay() noexcept {
+    close();
+}
+
+std::vector<std::string> Replay::modes() noexcept {
+    return {};
+}
+
+int Replay::open(const std::string &/*protocol*/, int /*id*/) noexcept {
+    return -1;
+}
+
+int Replay::open(const std::string &protocol,
+                 const std::string &source) noexcept {
+    ASSERT(supports(protocol), "Replay::open(): unsupported protocol %s", 
+           protocol.c_str());
+    close();
+
+    fd = ::open(source.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOGE("Replay::open(): Cannot open recording '%s'", source.c_str());
+        return -1;
+    }
+
+    struct stat info;
+    if ( (fstat(fd, &info) != 0) || (info.st_size <= 0) ) {
+        close();
+        return -1;
+    }
+
+    /* Map the recording privately for the replayed images to be writable
+     * without ever modifying the recording */
+    length = static_cast<std::size_t>(info.st_size);
+    void *m = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (m == MAP_FAILED) {
+        LOGE("Replay::open(): Cannot map recording '%s'", source.c_str());
+        map = nullptr;
+        close();
+        return -1;
+    }
+    map = static_cast<unsigned char *>(m);
+
+    scan();
+    if (index.empty()) {
+        LOGE("Replay::open(): No frame in recording '%s'", source.c_str());
+        close();
+        return -1;
+    }
+
+    realtime = (protocol == "vpp/file/realtime");
+    return 0;
+}
+
+void Replay::scan() noexcept {
+    std::size_t offset = 0;
+
+    /* Stop at the first truncated or broken frame */
+    while (offset + sizeof(FrameHeader) <= length) {
+        const FrameHeader *frame = 
+            reinterpret_cast<const FrameHeader *>(map + offset);
+        if (frame->magic != magic) {
+            break;
+        }
+
+        std::size_t end = offset + sizeof(FrameHeader);
+        uint32_t    i;
+        for (i = 0; i < frame->count; ++i) {
+            if (end + sizeof(PlaneHeader) > length) {
+                break;
+            }
+            const PlaneHeader *plane = 
+                reinterpret_cast<const PlaneHeader *>(map + end);
+            end += sizeof(PlaneHeader) + aligned(plane->size);
+            if (end > length) {
+                break;
+            }
+        }
+
+        if (i != frame->count) {
+            break;
+        }
+
+        index.push_back(offset);
+        offset = end;
+    }
+}
+
+int Replay::setup(const std::string & /*username*/,
+                  const std::string & /*password*/) noexcept {
+    /* Nothing to do, we are fine */
+    return 0;
+}
+
+int Replay::setup(int &width, int &height, int &rotation) noexcept {
+    cv::Mat          test;
+    VPP::Image::Mode mode;
+
+    /* Replay from the first frame after having checked its size */
+    next = 0;
+    auto error = read(test, mode);
+    next = 0;
+    if (error) {
+        return error;
+    }
+
+    width    = test.cols;
+    height   = test.rows;
+    rotation = 0;
+
+    return 0;
+}
+
+int Replay::read(cv::Mat &image, VPP::Image::Mode &mode) noexcept {
+    if (next >= index.size()) {
+        return -1;
+    }
+
+    const FrameHeader *frame = 
+        reinterpret_cast<const FrameHeader *>(map + index[next]);
+    std::size_t offset = index[next] + sizeof(FrameHeader);
+
+    /* Replay at the recording pace if requested, or as fast as possible */
+    if (next == 0) {
+        start = std::chrono::steady_clock::now();
+        first = frame->ts;
+    } else if (realtime && (frame->ts > first)) {
+        std::this_thread::sleep_until(start + 
+                            std::chrono::milliseconds(frame->ts - first));
+    }
+    ++next;
+
+    ts = frame->ts;
+    extras.clear();
+    for (uint32_t i = 0; i < frame->count; ++i) {
+        const PlaneHeader *plane = 
+            reinterpret_cast<const PlaneHeader *>(map + offset);
+        offset += sizeof(PlaneHeader);
+
+        cv::Mat data(plane->rows, plane->cols, plane->type, map + offset);
+        extras.push_back(Extra{ std::move(data), 
+                                VPP::Image::Mode(plane->mode),
+                                plane->zscale });
+        offset += aligned(plane->size);
+    }
+
+    /* The colour image is the one read, or the depth map of depth-only
+     * recordings, the others being attached to the view afterwards */
+    std::size_t primary = 0;
+    for (std::size_t i = 0; i < extras.size(); ++i) {
+        if ( (!extras[i].mode.is_depth()) && (!extras[i].mode.is_motion()) ) {
+            primary = i;
+            break;
+        }
+    }
+
+    if ( (extras.empty()) || (extras[primary].mode.is_motion()) ) {
+        extras.clear();
+        return -1;
+    }
+
+    image = std::move(extras[primary].data);
+    mode  = extras[primary].mode;
+    flat.zscale = extras[primary].zscale;
+    extras.erase(extras.begin() + primary);
+
+    return 0;
+}
+
+int Replay::attach(VPP::View &view) noexcept {
+    view.stamp(ts);
+
+    for (auto &e : extras) {
+        if (e.mode.is_depth()) {
+            flat.zscale = e.zscale;
+            view.use(e.data, e.mode, flat);
+        } else {
+            view.use(e.data, e.mode);
+        }
+    }
+    extras.clear();
+
+    return 0;
+}
+
+VPP::Projecter *Replay::projecter() const noexcept {
+    return const_cast<Flat *>(&flat);
+}
+
+int Replay::close() noexcept {
+    extras.clear();
+    index.clear();
+    next = 0;
+
+    if (map != nullptr) {
+        munmap(map, length);
+        map = nullptr;
+    }
+    length = 0;
+
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+
+    return 0;
+}
+
+} // namespace IO
+} // namespace Util
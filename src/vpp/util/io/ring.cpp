@@ -0,0 +1,297 @@
+/**
+ *
+ * @file      vpp/util/io/ring.cpp
+ *
+ * @brief     These are the shared-memory frame ring and tap implementations
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "vpp/util/io/ring.hpp"
+
+namespace Util {
+namespace IO {
+
+static constexpr uint32_t magic = 0x52505056; /* "VPPR" */
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+              "Shared atomics shall be plain words");
+
+/* The slots and their data are aligned on 64 bytes */
+static inline std::size_t aligned(std::size_t size) {
+    return (size + 63) & ~static_cast<std::size_t>(63);
+}
+
+static inline std::size_t header() {
+    return aligned(sizeof(Ring::Control));
+}
+
+static inline std::size_t preamble() {
+    return aligned(sizeof(Ring::Slot));
+}
+
+/* The futexes are shared across processes, hence not private */
+static inline void futex_wake(std::atomic<uint32_t> *word) noexcept {
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE,
+            INT_MAX, nullptr, nullptr, 0);
+}
+
+static inline void futex_wait(std::atomic<uint32_t> *word, uint32_t value,
+                              int timeout_ms) noexcept {
+    struct timespec timeout;
+    timeout.tv_sec  = timeout_ms / 1000;
+    timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT,
+            value, &timeout, nullptr, 0);
+}
+
+/*
+ * Ring
+ */
+
+Ring::Ring() noexcept : file(), map(nullptr), length(0), control(nullptr) {}
+
+Ring::~Ring() noexcept {
+    close();
+}
+
+int Ring::open(const std::string &path, int slots, std::size_t size) noexcept {
+    close();
+    if ( (slots < 2) || (size == 0) ) {
+        return -1;
+    }
+
+    /* A fresh file is created, for the taps still mapping a former ring to
+     * keep their own copy of it */
+    unlink(path.c_str());
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+
+    const std::size_t slot = preamble() + aligned(size);
+    length = header() + slot * static_cast<std::size_t>(slots);
+    if (ftruncate(fd, static_cast<off_t>(length)) < 0) {
+        ::close(fd);
+        unlink(path.c_str());
+        return -1;
+    }
+
+    void *m = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED) {
+        unlink(path.c_str());
+        return -1;
+    }
+
+    /* The file is zero-filled, hence all the slots are empty */
+    map     = static_cast<unsigned char *>(m);
+    file    = path;
+    control = new (map) Control();
+    control->slots = static_cast<uint32_t>(slots);
+    control->size  = slot;
+    control->latest.store(0, std::memory_order_relaxed);
+    control->futex.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    control->magic = magic;
+
+    return 0;
+}
+
+int Ring::close() noexcept {
+    if (map != nullptr) {
+        munmap(map, length);
+        unlink(file.c_str());
+    }
+    map     = nullptr;
+    length  = 0;
+    control = nullptr;
+    file.clear();
+
+    return 0;
+}
+
+int Ring::write(uint64_t ts, const cv::Mat &frame, const void *metadata,
+                std::size_t size) noexcept {
+    if (control == nullptr) {
+        return -1;
+    }
+
+    const std::size_t bytes = frame.total() * frame.elemSize();
+    if (preamble() + aligned(bytes) + size > control->size) {
+        return -1;
+    }
+
+    const uint64_t sequence = control->latest.load(std::memory_order_relaxed)
+                              + 1;
+    auto base = map + header() +
+                ((sequence - 1) % control->slots) * control->size;
+    auto s    = reinterpret_cast<Slot *>(base);
+
+    /* The slot is marked as being written before being overwritten */
+    s->sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    s->ts       = ts;
+    s->type     = frame.type();
+    s->rows     = frame.rows;
+    s->cols     = frame.cols;
+    s->frame    = bytes;
+    s->metadata = size;
+
+    auto data = base + preamble();
+    if (frame.isContinuous()) {
+        std::memcpy(data, frame.data, bytes);
+    } else {
+        const std::size_t row = frame.cols * frame.elemSize();
+        for (int y = 0; y < frame.rows; ++y) {
+            std::memcpy(data + y * row, frame.ptr(y), row);
+        }
+    }
+    if (size > 0) {
+        std::memcpy(data + aligned(bytes), metadata, size);
+    }
+
+    s->sequence.store(sequence, std::memory_order_release);
+    control->latest.store(sequence, std::memory_order_release);
+    control->futex.fetch_add(1, std::memory_order_release);
+    futex_wake(&control->futex);
+
+    return 0;
+}
+
+/*
+ * Tap
+ */
+
+Tap::Tap() noexcept : map(nullptr), length(0), control(nullptr) {}
+
+Tap::~Tap() noexcept {
+    close();
+}
+
+int Tap::open(const std::string &path) noexcept {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDWR);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if ( (fstat(fd, &st) < 0) ||
+         (static_cast<std::size_t>(st.st_size) < header()) ) {
+        ::close(fd);
+        return -1;
+    }
+
+    /* The futex requires a writable mapping, the slots being only read */
+    length = static_cast<std::size_t>(st.st_size);
+    void *m = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED) {
+        length = 0;
+        return -1;
+    }
+
+    map     = static_cast<unsigned char *>(m);
+    control = reinterpret_cast<Ring::Control *>(map);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if ( (control->magic != magic) ||
+         (header() + control->size * control->slots > length) ) {
+        close();
+        return -1;
+    }
+
+    return 0;
+}
+
+int Tap::close() noexcept {
+    if (map != nullptr) {
+        munmap(map, length);
+    }
+    map     = nullptr;
+    length  = 0;
+    control = nullptr;
+
+    return 0;
+}
+
+uint64_t Tap::wait(uint64_t sequence, int timeout_ms) const noexcept {
+    if (control == nullptr) {
+        return 0;
+    }
+
+    auto word = control->futex.load(std::memory_order_acquire);
+    auto last = control->latest.load(std::memory_order_acquire);
+    if (last > sequence) {
+        return last;
+    }
+
+    futex_wait(&control->futex, word, timeout_ms);
+    return control->latest.load(std::memory_order_acquire);
+}
+
+const Ring::Slot *Tap::slot(uint64_t sequence) const noexcept {
+    return reinterpret_cast<const Ring::Slot *>(
+               map + header() +
+               ((sequence - 1) % control->slots) * control->size);
+}
+
+bool Tap::read(Frame &frame) const noexcept {
+    if (control == nullptr) {
+        return false;
+    }
+
+    const uint64_t sequence = control->latest.load(std::memory_order_acquire);
+    if (sequence == 0) {
+        return false;
+    }
+
+    auto s = slot(sequence);
+    if (s->sequence.load(std::memory_order_acquire) != sequence) {
+        return false;
+    }
+
+    auto data = map + header() + ((sequence - 1) % control->slots) *
+                                 control->size + preamble();
+    frame.sequence = sequence;
+    frame.ts       = s->ts;
+    frame.image    = cv::Mat(s->rows, s->cols, s->type, data);
+    frame.metadata = data + aligned(s->frame);
+    frame.length   = s->metadata;
+
+    /* The header may have been overwritten while being read */
+    return intact(frame);
+}
+
+bool Tap::intact(const Frame &frame) const noexcept {
+    if ( (control == nullptr) || (frame.sequence == 0) ) {
+        return false;
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot(frame.sequence)->sequence.load(std::memory_order_relaxed) ==
+           frame.sequence;
+}
+
+} // namespace IO
+} // namespace Util
@@ -0,0 +1,183 @@
+/**
+ *
+ * @file      vpp/util/io/socket.cpp
+ *
+ * @brief     These are the VPP TCP socket helpers
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "vpp/util/io/socket.hpp"
+
+namespace Util {
+namespace IO {
+namespace Socket {
+
+bool put(int fd, const void *data, std::size_t size) noexcept {
+    auto p = static_cast<const char *>(data);
+    while (size > 0) {
+        auto sent = send(fd, p, size, MSG_NOSIGNAL);
+        if ( (sent < 0) && (errno == EINTR) ) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        p    += sent;
+        size -= static_cast<std::size_t>(sent);
+    }
+    return true;
+}
+
+/* Receiving some data, every chunk being waited for up to ms milliseconds */
+bool get(int fd, void *data, std::size_t size, int ms) noexcept {
+    auto p = static_cast<char *>(data);
+    while (size > 0) {
+        pollfd pfd = { fd, POLLIN, 0 };
+        auto ready = poll(&pfd, 1, ms);
+        if ( (ready < 0) && (errno == EINTR) ) {
+            continue;
+        }
+        if (ready <= 0) {
+            return false;
+        }
+        auto got = recv(fd, p, size, 0);
+        if ( (got < 0) && (errno == EINTR) ) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        p    += got;
+        size -= static_cast<std::size_t>(got);
+    }
+    return true;
+}
+
+/* Connecting to a host:port server within ms milliseconds */
+int dial(const std::string &server, int ms) noexcept {
+    auto colon = server.rfind(':');
+    auto host  = server.substr(0, colon);
+    auto port  = server.substr(colon + 1);
+
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *found   = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0) {
+        return -1;
+    }
+
+    int fd = -1;
+    for (auto a = found; (a != nullptr) && (fd < 0); a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+
+        /* Connecting without blocking for longer than the timeout */
+        auto flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        auto error = connect(fd, a->ai_addr, a->ai_addrlen);
+        if ( (error < 0) && (errno == EINPROGRESS) ) {
+            pollfd    pfd = { fd, POLLOUT, 0 };
+            int       e   = 0;
+            socklen_t len = sizeof(e);
+            if ( (poll(&pfd, 1, ms) == 1) &&
+                 (getsockopt(fd, SOL_SOCKET, SO_ERROR, &e, &len) == 0) &&
+                 (e == 0) ) {
+                error = 0;
+            }
+        }
+        fcntl(fd, F_SETFL, flags);
+
+        if (error != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(found);
+
+    if (fd >= 0) {
+        /* The requests are latency-bound, and never block the sender for
+         * longer than the timeout */
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        timeval tv;
+        tv.tv_sec  = ms / 1000;
+        tv.tv_usec = (ms % 1000) * 1000;
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    }
+
+    return fd;
+}
+
+int listening(int port, int backlog) noexcept {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int yes = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port        = htons(static_cast<uint16_t>(port));
+
+    if ( (bind(fd, reinterpret_cast<struct sockaddr *>(&address),
+               sizeof(address)) < 0) || (listen(fd, backlog) < 0) ) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+std::string requested(int fd, int ms) noexcept {
+    /* Only the request line matters, and it fits in the first read */
+    pollfd  pfd  = { fd, POLLIN, 0 };
+    char    request[1024];
+    ssize_t size = 0;
+    if (poll(&pfd, 1, ms) > 0) {
+        size = recv(fd, request, sizeof(request) - 1, 0);
+    }
+    if (size <= 0) {
+        return std::string();
+    }
+
+    /* The method and the path end at the second space, or at the query */
+    std::string line(request, static_cast<std::size_t>(size));
+    auto method = line.find(' ');
+    if (method == std::string::npos) {
+        return line.substr(0, line.find_first_of("\r\n"));
+    }
+
+    return line.substr(0, line.find_first_of(" ?\r\n", method + 1));
+}
+
+}  // namespace Socket
+}  // namespace IO
+}  // namespace Util
@@ -0,0 +1,311 @@
+/**
+ *
+ * @file      vpp/util/io/synthetic.cpp
+ *
+ * @brief     This is the synthetic input class implementation
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <cstdlib>
+#include <opencv2/imgproc.hpp>
+#include <sstream>
+#include <thread>
+
+#include "vpp/log.hpp"
+#include "vpp/util/io/synthetic.hpp"
+
+namespace Util {
+namespace IO {
+
+#define SYNTHETIC_STR       "vpp/synthetic"
+#define SYNTHETIC_DEPTH_STR SYNTHETIC_STR "/depth"
+
+/* The height of the camera above the floor, and the distance of the back
+ * wall, in metres, with the depth units of the depth maps */
+static constexpr float elevation = 1.5f;
+static constexpr float wall      = 10.0f;
+static constexpr float units     = 0.001f;
+
+Synthetic::Lens::Lens() noexcept : VPP::Projecter(), model() {
+    zscale = units;
+    focus(640, 480);
+}
+
+void Synthetic::Lens::focus(int width, int height) noexcept {
+    model.fx  = static_cast<float>(width);
+    model.fy  = static_cast<float>(width);
+    model.ppx = width / 2.0f;
+    model.ppy = height / 2.0f;
+    std::fill(model.coeffs, model.coeffs + 5, 0.0f);
+}
+
+cv::Point Synthetic::Lens::project(const cv::Point3f &p) const noexcept {
+    return cv::Point(static_cast<int>(p.x / p.z * model.fx + model.ppx),
+                     static_cast<int>(p.y / p.z * model.fy + model.ppy));
+}
+
+cv::Point3f Synthetic::Lens::deproject(const cv::Point &p,
+                                       float z) const noexcept {
+    return model.deproject(p, z);
+}
+
+Synthetic::Synthetic() noexcept
+    : Input({ SYNTHETIC_STR, SYNTHETIC_DEPTH_STR }), frames(0), next(0),
+      moving(8), seed(1), period(1000.0 / 30.0), text(false), noise(0),
+      paced(false), depth(false), background(), noised(), boxes(), lens(),
+      started() {}
+
+Synthetic::~Synthetic() noexcept {
+    close();
+}
+
+int Synthetic::open(const std::string &/*protocol*/, int /*id*/) noexcept {
+    return -1;
+}
+
+/* Parsing an option as a number within some bounds */
+static bool parse(const std::string &value, double low, double high,
+                  double &out) noexcept {
+    char *end = nullptr;
+    out = std::strtod(value.c_str(), &end);
+    return (!value.empty()) && (*end == '\0') && (out >= low) &&
+           (out <= high);
+}
+
+int Synthetic::open(const std::string &protocol,
+                    const std::string &source) noexcept {
+    ASSERT(supports(protocol), "Synthetic::open(): unsupported protocol %s",
+           protocol.c_str());
+    close();
+
+    frames = 0;
+    moving = 8;
+    seed   = 1;
+    period = 1000.0 / 30.0;
+    text   = false;
+    noise  = 0;
+    paced  = false;
+    depth  = (protocol == SYNTHETIC_DEPTH_STR);
+
+    /* A bare number is the frame count, as for the former sources */
+    std::istringstream options(source.find('=') == std::string::npos ?
+                               "frames=" + source : source);
+    std::string option;
+    while (std::getline(options, option, ',')) {
+        auto   equal = option.find('=');
+        auto   key   = option.substr(0, equal);
+        auto   value = (equal == std::string::npos) ?
+                       std::string() : option.substr(equal + 1);
+        double n     = 0;
+        bool   valid = true;
+        if (key == "frames") {
+            valid  = parse(value, 0, 1e18, n);
+            frames = static_cast<uint64_t>(n);
+        } else if (key == "boxes") {
+            valid  = parse(value, 0, 4096, n);
+            moving = static_cast<int>(n);
+        } else if (key == "fps") {
+            valid  = parse(value, 0.1, 1000, n);
+            period = 1000.0 / n;
+        } else if (key == "seed") {
+            valid  = parse(value, 0, 4294967295.0, n);
+            seed   = static_cast<uint64_t>(n);
+        } else if (key == "noise") {
+            valid  = parse(value, 0, 128, n);
+            noise  = n;
+        } else if (key == "text") {
+            valid  = (value == "yes") || (value == "no");
+            text   = (value == "yes");
+        } else if (key == "paced") {
+            valid  = (value == "yes") || (value == "no");
+            paced  = (value == "yes");
+        } else {
+            valid  = false;
+        }
+
+        if (!valid) {
+            LOGE("Synthetic::open(): Invalid option '%s' in '%s'",
+                 option.c_str(), source.c_str());
+            return -1;
+        }
+    }
+
+    /* A nil seed is a random one, for the soak tests */
+    if (seed == 0) {
+        seed = static_cast<uint64_t>(cv::getTickCount()) | 1;
+    }
+
+    return 0;
+}
+
+int Synthetic::setup(const std::string & /*username*/,
+                     const std::string & /*password*/) noexcept {
+    /* Nothing to do, we are fine */
+    return 0;
+}
+
+int Synthetic::setup(int &width, int &height, int &rotation) noexcept {
+    if ( (width <= 0) || (height <= 0) ) {
+        return -1;
+    }
+    rotation = 0;
+
+    /* Always the same background and boxes for a seed, whatever the stream
+     * for the colour and depth inputs to match */
+    cv::RNG rng(seed);
+    background.create(height, width, CV_8UC3);
+    rng.fill(background, cv::RNG::UNIFORM, cv::Scalar::all(0),
+             cv::Scalar::all(256));
+    cv::GaussianBlur(background, background, cv::Size(7, 7), 0);
+
+    boxes.clear();
+    for (int i = 0; i < moving; ++i) {
+        float w = width  * rng.uniform(0.05f, 0.2f);
+        float h = height * rng.uniform(0.05f, 0.2f);
+        Box box;
+        box.area   = cv::Rect2f(rng.uniform(0.0f, width - w),
+                                rng.uniform(0.0f, height - h), w, h);
+        box.speed  = cv::Point2f(rng.uniform(-0.01f, 0.01f) * width,
+                                 rng.uniform(-0.01f, 0.01f) * height);
+        box.depth  = rng.uniform(1.5f, 6.0f);
+
+        /* A coloured texture of stripes and dots for the features */
+        cv::Scalar colour(rng.uniform(0, 256), rng.uniform(0, 256),
+                          rng.uniform(0, 256));
+        box.texture = cv::Mat(std::max(1, static_cast<int>(h)),
+                              std::max(1, static_cast<int>(w)), CV_8UC3,
+                              colour);
+        int stripe = std::max(2, static_cast<int>(h) / 8);
+        for (int y = 0; y < box.texture.rows; y += 2 * stripe) {
+            cv::rectangle(box.texture,
+                          cv::Rect(0, y, box.texture.cols, stripe),
+                          colour * 0.5, cv::FILLED);
+        }
+        for (int d = 0; d < 16; ++d) {
+            cv::circle(box.texture,
+                       cv::Point(rng.uniform(0, box.texture.cols),
+                                 rng.uniform(0, box.texture.rows)),
+                       stripe / 2 + 1, cv::Scalar::all(255) - colour,
+                       cv::FILLED);
+        }
+        boxes.push_back(std::move(box));
+    }
+
+    /* The depth of the floor seen from above, up to the back wall */
+    if (depth) {
+        lens.focus(width, height);
+        background.create(height, width, CV_16UC1);
+        const float fy  = static_cast<float>(width);
+        const float ppy = height / 2.0f;
+        for (int y = 0; y < height; ++y) {
+            float z = (y > ppy) ? std::min(wall, elevation * fy / (y - ppy)) :
+                                  wall;
+            background.row(y).setTo(cv::Scalar(z / units));
+        }
+    }
+
+    next    = 0;
+    started = std::chrono::steady_clock::now();
+
+    return 0;
+}
+
+void Synthetic::move() noexcept {
+    const float width  = static_cast<float>(background.cols);
+    const float height = static_cast<float>(background.rows);
+    for (auto &b : boxes) {
+        b.area.x += b.speed.x;
+        b.area.y += b.speed.y;
+        if ( (b.area.x < 0) || (b.area.x + b.area.width > width) ) {
+            b.speed.x = -b.speed.x;
+            b.area.x += 2 * b.speed.x;
+        }
+        if ( (b.area.y < 0) || (b.area.y + b.area.height > height) ) {
+            b.speed.y = -b.speed.y;
+            b.area.y += 2 * b.speed.y;
+        }
+    }
+}
+
+int Synthetic::read(cv::Mat &image, VPP::Image::Mode &mode) noexcept {
+    if ( (background.empty()) || ((frames != 0) && (next >= frames)) ) {
+        return -1;
+    }
+
+    /* Reading no faster than the frame rate when paced */
+    if (paced) {
+        auto due = started + std::chrono::microseconds(
+                       static_cast<int64_t>(next * period * 1000.0));
+        std::this_thread::sleep_until(due);
+    }
+    ++next;
+
+    /* A new image for every frame, as the former ones may still be in use */
+    background.copyTo(image);
+    const cv::Rect frame(0, 0, image.cols, image.rows);
+    for (std::size_t i = 0; i < boxes.size(); ++i) {
+        const auto &b = boxes[i];
+        const cv::Rect at(cv::Point(b.area.tl()), b.texture.size());
+        const auto     r = at & frame;
+        if (r.area() <= 0) {
+            continue;
+        }
+
+        if (depth) {
+            image(r).setTo(cv::Scalar(b.depth / units));
+        } else {
+            b.texture(r - at.tl()).copyTo(image(r));
+            if (text) {
+                auto scale = std::max(0.3, r.height / 60.0);
+                cv::putText(image, "VPP " + std::to_string(i),
+                            cv::Point(r.x + 2, r.y + r.height * 2 / 3),
+                            cv::FONT_HERSHEY_SIMPLEX, scale,
+                            cv::Scalar::all(0), 2);
+            }
+        }
+    }
+    move();
+
+    /* The noise is the same for a seed and a frame */
+    if ( (!depth) && (noise > 0) ) {
+        cv::RNG rng(seed + next);
+        noised.create(image.size(), CV_16SC3);
+        rng.fill(noised, cv::RNG::NORMAL, cv::Scalar::all(0),
+                 cv::Scalar::all(noise));
+        cv::add(image, noised, image, cv::noArray(), CV_8U);
+    }
+
+    mode = (depth) ? VPP::Image::Mode::DEPTH16 : VPP::Image::Mode::BGR;
+
+    return 0;
+}
+
+int Synthetic::attach(VPP::View &view) noexcept {
+    /* A steady source at the frame rate, whatever the actual reading pace */
+    view.stamp(static_cast<uint64_t>(next * period));
+    return 0;
+}
+
+int Synthetic::close() noexcept {
+    background.release();
+    noised.release();
+    boxes.clear();
+    next = 0;
+    return 0;
+}
+
+VPP::Projecter *Synthetic::projecter() const noexcept {
+    return (depth) ? const_cast<Lens *>(&lens) : nullptr;
+}
+
+} // namespace IO
+} // namespace Util
@@ -0,0 +1,675 @@
+/**
+ *
+ * @file      vpp/util/io/v4l2.cpp
+ *
+ * @brief     This is the V4L2 camera Input class implementation
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <opencv2/imgproc.hpp>
+#include <thread>
+
+#include <fcntl.h>
+#include <linux/videodev2.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "vpp/config.hpp"
+#ifdef VPP_HAS_IMAGE_CODEC_SUPPORT
+#include <opencv2/imgcodecs.hpp>
+#endif
+#include "vpp/log.hpp"
+#include "vpp/util/io/v4l2.hpp"
+
+namespace Util {
+namespace IO {
+
+/* The number of mapped buffers, the number of them left to the driver below
+ * which the frames are copied rather than wrapped, and the time in ms a frame
+ * is waited for */
+static constexpr int BUFFERS = 6;
+static constexpr int MARGIN  = 2;
+static constexpr int WAITING = 2000;
+
+/* The pixel formats by order of preference, the wrapped ones first */
+static const uint32_t preferred[] = {
+    V4L2_PIX_FMT_NV12, V4L2_PIX_FMT_NV21, V4L2_PIX_FMT_YUYV,
+#ifdef VPP_HAS_IMAGE_CODEC_SUPPORT
+    V4L2_PIX_FMT_MJPEG,
+#endif
+};
+
+static int xioctl(int fd, unsigned long request, void *arg) noexcept {
+    int r;
+    do {
+        r = ioctl(fd, request, arg);
+    } while ( (r < 0) && (errno == EINTR) );
+    return r;
+}
+
+/* A buffer descriptor of the memory-mapped queue, with its single plane for
+ * the multi-planar devices */
+struct Descriptor final {
+    Descriptor(uint32_t type, uint32_t index) noexcept : buffer(), plane() {
+        std::memset(&buffer, 0, sizeof(buffer));
+        std::memset(&plane, 0, sizeof(plane));
+        buffer.type   = type;
+        buffer.memory = V4L2_MEMORY_MMAP;
+        buffer.index  = index;
+        if (planar()) {
+            buffer.m.planes = &plane;
+            buffer.length   = 1;
+        }
+    }
+
+    Descriptor(const Descriptor& other) = delete;
+    Descriptor& operator=(const Descriptor& other) = delete;
+
+    inline bool planar() const noexcept {
+        return buffer.type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    }
+
+    inline uint32_t offset() const noexcept {
+        return planar() ? plane.m.mem_offset : buffer.m.offset;
+    }
+
+    inline uint32_t length() const noexcept {
+        return planar() ? plane.length : buffer.length;
+    }
+
+    inline uint32_t used() const noexcept {
+        return planar() ? plane.bytesused : buffer.bytesused;
+    }
+
+    v4l2_buffer buffer;
+    v4l2_plane  plane;
+};
+
+class V4L2::Device {
+    public:
+        struct Buffer {
+            void       *data;
+            std::size_t length;
+        };
+
+        explicit Device(int f) noexcept
+            : fd(f), type(V4L2_BUF_TYPE_VIDEO_CAPTURE), name(), buffers(),
+              access(), started(false), streaming(false), queued(0) {}
+
+        ~Device() noexcept {
+            stop();
+            for (auto &b : buffers) {
+                munmap(b.data, b.length);
+            }
+            ::close(fd);
+        }
+
+        Device(const Device& other) = delete;
+        Device& operator=(const Device& other) = delete;
+
+        /* Querying the device, false if it is not a streaming camera */
+        bool query() noexcept {
+            v4l2_capability cap;
+            std::memset(&cap, 0, sizeof(cap));
+            if (xioctl(fd, VIDIOC_QUERYCAP, &cap) < 0) {
+                return false;
+            }
+
+            auto caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ?
+                            cap.device_caps : cap.capabilities;
+            if (!(caps & V4L2_CAP_STREAMING)) {
+                return false;
+            }
+            if (caps & V4L2_CAP_VIDEO_CAPTURE) {
+                type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            } else if (caps & V4L2_CAP_VIDEO_CAPTURE_MPLANE) {
+                type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+            } else {
+                return false;
+            }
+
+            auto field = [](const __u8 *s, std::size_t n) {
+                return std::string(reinterpret_cast<const char *>(s),
+                                   strnlen(reinterpret_cast<const char *>(s),
+                                           n));
+            };
+            name = "v4l2:" + field(cap.driver, sizeof(cap.driver)) + ":" +
+                   field(cap.card, sizeof(cap.card)) + ":" +
+                   field(cap.bus_info, sizeof(cap.bus_info)) + ":" +
+                   std::to_string(cap.version);
+            return true;
+        }
+
+        bool supports(uint32_t fourcc) noexcept {
+            v4l2_fmtdesc desc;
+            std::memset(&desc, 0, sizeof(desc));
+            desc.type = type;
+            for (; xioctl(fd, VIDIOC_ENUM_FMT, &desc) == 0; ++desc.index) {
+                if (desc.pixelformat == fourcc) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /* Setting a format of a single plane, and getting its actual size */
+        bool configure(uint32_t fourcc, int &w, int &h,
+                       std::size_t &stride) noexcept {
+            v4l2_format fmt;
+            std::memset(&fmt, 0, sizeof(fmt));
+            fmt.type = type;
+            if (type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+                auto &p       = fmt.fmt.pix_mp;
+                p.width       = static_cast<uint32_t>(w);
+                p.height      = static_cast<uint32_t>(h);
+                p.pixelformat = fourcc;
+                p.field       = V4L2_FIELD_NONE;
+                p.num_planes  = 1;
+            } else {
+                auto &p       = fmt.fmt.pix;
+                p.width       = static_cast<uint32_t>(w);
+                p.height      = static_cast<uint32_t>(h);
+                p.pixelformat = fourcc;
+                p.field       = V4L2_FIELD_NONE;
+            }
+            if (xioctl(fd, VIDIOC_S_FMT, &fmt) < 0) {
+                return false;
+            }
+
+            if (type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+                auto &p = fmt.fmt.pix_mp;
+                if ( (p.pixelformat != fourcc) || (p.num_planes != 1) ) {
+                    return false;
+                }
+                w      = static_cast<int>(p.width);
+                h      = static_cast<int>(p.height);
+                stride = p.plane_fmt[0].bytesperline;
+            } else {
+                auto &p = fmt.fmt.pix;
+                if (p.pixelformat != fourcc) {
+                    return false;
+                }
+                w      = static_cast<int>(p.width);
+                h      = static_cast<int>(p.height);
+                stride = p.bytesperline;
+            }
+            return true;
+        }
+
+        /* Mapping and queueing the buffers, and streaming them */
+        bool start(int count) noexcept {
+            v4l2_requestbuffers req;
+            std::memset(&req, 0, sizeof(req));
+            req.count  = static_cast<uint32_t>(count);
+            req.type   = type;
+            req.memory = V4L2_MEMORY_MMAP;
+
+            /* The buffers of a former streaming of the camera are still
+             * allocated until the last images wrapping them are released */
+            int r = xioctl(fd, VIDIOC_REQBUFS, &req);
+            for (int i = 0; (r < 0) && (errno == EBUSY) && (i < 100); ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                req.count = static_cast<uint32_t>(count);
+                r = xioctl(fd, VIDIOC_REQBUFS, &req);
+            }
+            if ( (r < 0) || (req.count < 2) ) {
+                LOGE("V4L2::Device::start(): Cannot allocate the buffers: %s",
+                     std::strerror(errno));
+                return false;
+            }
+
+            for (uint32_t i = 0; i < req.count; ++i) {
+                Descriptor d(type, i);
+                if (xioctl(fd, VIDIOC_QUERYBUF, &d.buffer) < 0) {
+                    return false;
+                }
+                auto data = mmap(nullptr, d.length(), PROT_READ | PROT_WRITE,
+                                 MAP_SHARED, fd, d.offset());
+                if (data == MAP_FAILED) {
+                    LOGE("V4L2::Device::start(): Cannot map a buffer: %s",
+                         std::strerror(errno));
+                    return false;
+                }
+                buffers.push_back({ data, d.length() });
+            }
+
+            std::lock_guard<std::mutex> lock(access);
+            started = true;
+            for (uint32_t i = 0; i < req.count; ++i) {
+                Descriptor d(type, i);
+                if (xioctl(fd, VIDIOC_QBUF, &d.buffer) < 0) {
+                    return false;
+                }
+                ++queued;
+            }
+            if (xioctl(fd, VIDIOC_STREAMON, &type) < 0) {
+                LOGE("V4L2::Device::start(): Cannot stream: %s",
+                     std::strerror(errno));
+                return false;
+            }
+            streaming = true;
+            return true;
+        }
+
+        void stop() noexcept {
+            std::lock_guard<std::mutex> lock(access);
+            if (streaming) {
+                xioctl(fd, VIDIOC_STREAMOFF, &type);
+                streaming = false;
+                queued    = 0;
+            }
+        }
+
+        /* Getting the index of the next filled buffer, its size and its
+         * steady clock timestamp in us, or -1 if no frame is streamed */
+        int dequeue(uint32_t &used, uint64_t &us) noexcept {
+            for (;;) {
+                pollfd p = { fd, POLLIN, 0 };
+                int r;
+                do {
+                    r = poll(&p, 1, WAITING);
+                } while ( (r < 0) && (errno == EINTR) );
+                if (r <= 0) {
+                    LOGE("V4L2::Device::dequeue(): No frame streamed!");
+                    return -1;
+                }
+
+                Descriptor d(type, 0);
+                std::unique_lock<std::mutex> lock(access);
+                if ( (!streaming) ||
+                     (xioctl(fd, VIDIOC_DQBUF, &d.buffer) < 0) ) {
+                    return -1;
+                }
+                --queued;
+                lock.unlock();
+
+                /* The corrupted frames are skipped */
+                if (d.buffer.flags & V4L2_BUF_FLAG_ERROR) {
+                    requeue(d.buffer.index);
+                    continue;
+                }
+
+                used = d.used();
+                us   = stamp(d.buffer);
+                return static_cast<int>(d.buffer.index);
+            }
+        }
+
+        /* Giving a buffer back to the driver, unless no longer streaming */
+        void requeue(uint32_t index) noexcept {
+            std::lock_guard<std::mutex> lock(access);
+            if (streaming) {
+                Descriptor d(type, index);
+                if (xioctl(fd, VIDIOC_QBUF, &d.buffer) == 0) {
+                    ++queued;
+                }
+            }
+        }
+
+        /* The number of buffers left to the driver */
+        int available() noexcept {
+            std::lock_guard<std::mutex> lock(access);
+            return queued;
+        }
+
+        inline bool active() const noexcept {
+            return started;
+        }
+
+        const int           fd;
+        uint32_t            type;
+        std::string         name;
+        std::vector<Buffer> buffers;
+
+    private:
+        /* The monotonic timestamps of the driver are the ones of the steady
+         * clock, the other ones being left unknown */
+        static uint64_t stamp(const v4l2_buffer &b) noexcept {
+            if ( (b.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) !=
+                 V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC ) {
+                return 0;
+            }
+
+            return static_cast<uint64_t>(b.timestamp.tv_sec) * 1000000ull +
+                   static_cast<uint64_t>(b.timestamp.tv_usec);
+        }
+
+        std::mutex access;
+        bool       started;
+        bool       streaming;
+        int        queued;
+};
+
+namespace {
+
+/* The wrapped images hold a lease on their buffer through the matrix data of
+ * their headers, the buffer being queued back to its device with the last
+ * header. The allocator is only the one of these data, never the one of any
+ * image, so it never allocates anything itself */
+struct V4L2Lease final {
+    std::shared_ptr<V4L2::Device> device;
+    uint32_t                      index;
+};
+
+class V4L2Lender : public cv::MatAllocator {
+    public:
+        V4L2Lender() noexcept = default;
+
+        cv::Mat lend(int rows, int cols, void *data, std::size_t step,
+                     std::shared_ptr<V4L2::Device> device,
+                     uint32_t index) const {
+            cv::Mat image(rows, cols, CV_8UC1, data, step);
+            auto u      = new cv::UMatData(this);
+            u->data     = u->origdata = static_cast<uchar *>(data);
+            u->size     = image.step[0] * rows;
+            u->userdata = new V4L2Lease{ std::move(device), index };
+            image.u     = u;
+            image.addref();
+            return image;
+        }
+
+#if CV_VERSION_MAJOR >= 4
+        cv::UMatData *allocate(int, const int *, int, void *, std::size_t *,
+                               cv::AccessFlag, cv::UMatUsageFlags)
+            const override {
+            return nullptr;
+        }
+
+        bool allocate(cv::UMatData *, cv::AccessFlag, cv::UMatUsageFlags)
+            const override {
+            return false;
+        }
+#else
+        cv::UMatData *allocate(int, const int *, int, void *, std::size_t *,
+                               int, cv::UMatUsageFlags) const override {
+            return nullptr;
+        }
+
+        bool allocate(cv::UMatData *, int, cv::UMatUsageFlags)
+            const override {
+            return false;
+        }
+#endif
+
+        void deallocate(cv::UMatData *u) const override {
+            if (u != nullptr) {
+                auto lease = static_cast<V4L2Lease *>(u->userdata);
+                lease->device->requeue(lease->index);
+                delete lease;
+                delete u;
+            }
+        }
+};
+
+static const V4L2Lender &lender() noexcept {
+    static const V4L2Lender *l = new V4L2Lender();
+    return *l;
+}
+
+}  // namespace
+
+/* Opening a streaming camera, nullptr if it is not one */
+static std::shared_ptr<V4L2::Device> connect(const std::string &path)
+    noexcept {
+    int fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    auto device = std::make_shared<V4L2::Device>(fd);
+    if (!device->query()) {
+        return nullptr;
+    }
+    return device;
+}
+
+V4L2::V4L2() noexcept
+    : Input({ "v4l2/camera" }), path(), device(), format(0), width(0),
+      height(0), stride(0), stamped(0) {}
+
+V4L2::~V4L2() noexcept {
+    close();
+}
+
+std::vector<std::string> V4L2::sources() const noexcept {
+    std::vector<std::string> found;
+    for (int i = 0; i < 64; ++i) {
+        auto p = "/dev/video" + std::to_string(i);
+        if (connect(p) != nullptr) {
+            found.emplace_back(std::move(p));
+        }
+    }
+    return found;
+}
+
+std::vector<std::string> V4L2::modes() noexcept {
+    std::vector<std::string> found;
+    if (device == nullptr) {
+        return found;
+    }
+
+    auto add = [&found](uint32_t w, uint32_t h) {
+        auto m = std::to_string(w) + "x" + std::to_string(h);
+        if (std::find(found.begin(), found.end(), m) == found.end()) {
+            found.emplace_back(std::move(m));
+        }
+    };
+
+    for (auto f : preferred) {
+        if (!device->supports(f)) {
+            continue;
+        }
+
+        v4l2_frmsizeenum size;
+        std::memset(&size, 0, sizeof(size));
+        size.pixel_format = f;
+        for (; xioctl(device->fd, VIDIOC_ENUM_FRAMESIZES, &size) == 0;
+             ++size.index) {
+            if (size.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+                add(size.discrete.width, size.discrete.height);
+            } else {
+                /* Only the bounds of the continuous or stepwise sizes */
+                add(size.stepwise.min_width, size.stepwise.min_height);
+                add(size.stepwise.max_width, size.stepwise.max_height);
+                break;
+            }
+        }
+    }
+
+    return found;
+}
+
+std::string V4L2::identity() const noexcept {
+    return (device != nullptr) ? device->name : std::string();
+}
+
+int V4L2::open(const std::string &protocol, int id) noexcept {
+    return open(protocol, "/dev/video" + std::to_string(id));
+}
+
+int V4L2::open(const std::string &protocol,
+               const std::string &source) noexcept {
+    ASSERT(supports(protocol), "V4L2::open(): Unsupported protocol '%s'",
+           protocol.c_str());
+    close();
+
+    std::string p(source);
+    if ( (!p.empty()) && (std::all_of(p.begin(), p.end(), ::isdigit)) ) {
+        p = "/dev/video" + p;
+    }
+
+    device = connect(p);
+    if (device == nullptr) {
+        LOGE("V4L2::open(): Cannot stream from '%s'", p.c_str());
+        return -1;
+    }
+    path = p;
+
+    return 0;
+}
+
+int V4L2::setup(const std::string & /*username*/,
+                const std::string & /*password*/) noexcept {
+    /* Nothing to do, we are fine */
+    return 0;
+}
+
+int V4L2::setup(int &w, int &h, int &rotation) noexcept {
+    if (device == nullptr) {
+        return -1;
+    }
+    rotation = 0;
+
+    /* The buffers of a streaming device cannot be reallocated, so it is
+     * opened again, the images wrapping its buffers keeping it alive */
+    if (device->active()) {
+        device->stop();
+        device = connect(path);
+        if (device == nullptr) {
+            LOGE("V4L2::setup(): Cannot stream from '%s' again",
+                 path.c_str());
+            return -1;
+        }
+    }
+
+    format = 0;
+    for (auto f : preferred) {
+        int         fw = w;
+        int         fh = h;
+        std::size_t fs = 0;
+        if ( (device->supports(f)) && (device->configure(f, fw, fh, fs)) ) {
+            format = f;
+            width  = fw;
+            height = fh;
+            stride = fs;
+            break;
+        }
+    }
+    if (format == 0) {
+        LOGE("V4L2::setup(): No NV12, NV21, YUYV or MJPEG %dx%d frames "
+             "from '%s'", w, h, path.c_str());
+        return -1;
+    }
+
+    if (!device->start(BUFFERS)) {
+        device->stop();
+        return -1;
+    }
+
+    w = width;
+    h = height;
+
+    return 0;
+}
+
+int V4L2::read(cv::Mat &image, VPP::Image::Mode &mode) noexcept {
+    if ( (device == nullptr) || (!device->active()) ) {
+        return -1;
+    }
+
+    for (;;) {
+        uint32_t used = 0;
+        auto index = device->dequeue(used, stamped);
+        if (index < 0) {
+            return -1;
+        }
+
+        auto  i    = static_cast<uint32_t>(index);
+        auto &b    = device->buffers[i];
+        auto  data = static_cast<uchar *>(b.data);
+        if (used == 0) {
+            used = static_cast<uint32_t>(b.length);
+        }
+
+        if ( (format == V4L2_PIX_FMT_NV12) ||
+             (format == V4L2_PIX_FMT_NV21) ) {
+            mode = (format == V4L2_PIX_FMT_NV12) ?
+                       VPP::Image::Mode::NV12 : VPP::Image::Mode::NV21;
+            int rows = height * 3 / 2;
+            if (used < stride * rows) {
+                device->requeue(i);
+                LOGW("V4L2::read(): Skipping a truncated frame");
+                continue;
+            }
+
+            /* The frames are copied once the pipeline holds most buffers,
+             * for the driver not to run out of them */
+            if (device->available() >= MARGIN) {
+                image = lender().lend(rows, width, data, stride, device, i);
+            } else {
+                image = cv::Mat(rows, width, CV_8UC1, data, stride).clone();
+                device->requeue(i);
+            }
+            return 0;
+        }
+
+        cv::Mat decoded;
+        if ( (format == V4L2_PIX_FMT_YUYV) &&
+             (used >= stride * static_cast<uint32_t>(height)) ) {
+            cv::Mat yuyv(height, width, CV_8UC2, data, stride);
+            cv::cvtColor(yuyv, decoded, cv::COLOR_YUV2BGR_YUYV);
+        }
+#ifdef VPP_HAS_IMAGE_CODEC_SUPPORT
+        else if (format == V4L2_PIX_FMT_MJPEG) {
+            cv::Mat jpeg(1, static_cast<int>(used), CV_8UC1, data);
+            decoded = cv::imdecode(jpeg, cv::IMREAD_COLOR);
+        }
+#endif
+        device->requeue(i);
+
+        if (decoded.empty()) {
+            LOGW("V4L2::read(): Skipping a corrupted frame");
+            continue;
+        }
+        mode  = VPP::Image::Mode::BGR;
+        image = std::move(decoded);
+        return 0;
+    }
+}
+
+int V4L2::attach(VPP::View &view) noexcept {
+    /* The timestamp of the driver, if monotonic, is the capture time of the
+     * view and is moved to the epoch for its wall-clock timestamp */
+    auto now = VPP::View::now_us();
+    if ( (stamped != 0) && (stamped <= now) ) {
+        using namespace std::chrono;
+        auto epoch = system_clock::now().time_since_epoch();
+        auto age   = microseconds(now - stamped);
+        view.clock(stamped);
+        view.stamp(static_cast<uint64_t>(
+                       duration_cast<milliseconds>(epoch - age).count()));
+    }
+    return 0;
+}
+
+int V4L2::close() noexcept {
+    /* The images still wrapping the buffers keep the device alive */
+    if (device != nullptr) {
+        device->stop();
+        device.reset();
+    }
+    path.clear();
+    format  = 0;
+    stamped = 0;
+
+    return 0;
+}
+
+} // namespace IO
+} // namespace Util
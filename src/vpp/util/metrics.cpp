@@ -0,0 +1,147 @@
+/**
+ *
+ * @file      vpp/util/metrics.cpp
+ *
+ * @brief     This is the metrics registry implementation
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+
+#include "vpp/util/metrics.hpp"
+
+namespace Util {
+namespace Metrics {
+
+static std::string sample(const std::string &name, const std::string &labels,
+                          const char *value) {
+    if (labels.empty()) {
+        return name + " " + value;
+    }
+    return name + "{" + labels + "} " + value;
+}
+
+Exposition::Family &Exposition::family(const std::string &name, 
+                                       const char *type,
+                                       const std::string &help) {
+    auto &f = families[name];
+    if (f.type.empty()) {
+        f.type = type;
+        f.help = help;
+    }
+    return f;
+}
+
+void Exposition::counter(const std::string &name, const std::string &help,
+                         const std::string &labels, uint64_t value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%llu", 
+             static_cast<unsigned long long>(value));
+    family(name, "counter", help).samples.emplace_back(
+        sample(name, labels, text));
+}
+
+void Exposition::gauge(const std::string &name, const std::string &help,
+                       const std::string &labels, double value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.9g", value);
+    family(name, "gauge", help).samples.emplace_back(
+        sample(name, labels, text));
+}
+
+void Exposition::summary(const std::string &name, const std::string &help,
+                         const std::string &labels, const Histogram &h) {
+    auto &f = family(name, "summary", help);
+    auto prefix = labels.empty() ? labels : labels + ",";
+    char text[32];
+    for (auto q : { 0.5, 0.9, 0.99 }) {
+        char quantile[48];
+        snprintf(quantile, sizeof(quantile), "quantile=\"%g\"", q);
+        snprintf(text, sizeof(text), "%.9g", h.percentile(q) / 1e9);
+        f.samples.emplace_back(sample(name, prefix + quantile, text));
+    }
+    snprintf(text, sizeof(text), "%.9g", 
+             static_cast<double>(h.mean()) * h.count() / 1e9);
+    f.samples.emplace_back(sample(name + "_sum", labels, text));
+    snprintf(text, sizeof(text), "%llu", 
+             static_cast<unsigned long long>(h.count()));
+    f.samples.emplace_back(sample(name + "_count", labels, text));
+}
+
+std::string Exposition::text() const {
+    std::string out;
+    for (auto &f : families) {
+        out += "# HELP " + f.first + " " + f.second.help + "\n";
+        out += "# TYPE " + f.first + " " + f.second.type + "\n";
+        for (auto &s : f.second.samples) {
+            out += s;
+            out += '\n';
+        }
+    }
+    return out;
+}
+
+std::string Exposition::quote(const std::string &value) {
+    std::string q("\"");
+    for (auto c : value) {
+        if ( (c == '"') || (c == '\\') ) {
+            q += '\\';
+            q += c;
+        } else if (c == '\n') {
+            q += "\\n";
+        } else {
+            q += c;
+        }
+    }
+    q += '"';
+    return q;
+}
+
+Registry::Registry() noexcept 
+    : access(), collectors(), handles(0), identifiers(0) {}
+
+Registry &Registry::instance() noexcept {
+    static Registry registry;
+    return registry;
+}
+
+Registry::Handle Registry::attach(Collector c) {
+    std::lock_guard<std::mutex> lock(access);
+    collectors.emplace_back(++handles, std::move(c));
+    return handles;
+}
+
+void Registry::detach(Handle h) noexcept {
+    std::lock_guard<std::mutex> lock(access);
+    collectors.erase(std::remove_if(collectors.begin(), collectors.end(),
+                                    [h](const std::pair<Handle, 
+                                                        Collector> &c) {
+                                        return c.first == h; }),
+                     collectors.end());
+}
+
+uint64_t Registry::identify() noexcept {
+    return ++identifiers;
+}
+
+std::string Registry::collect() {
+    Exposition e;
+    {
+        std::lock_guard<std::mutex> lock(access);
+        for (auto &c : collectors) {
+            c.second(e);
+        }
+    }
+    return e.text();
+}
+
+}  // namespace Metrics
+}  // namespace Util
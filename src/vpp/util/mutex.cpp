@@ -0,0 +1,75 @@
+/**
+ *
+ * @file      vpp/util/mutex.cpp
+ *
+ * @brief     This is the VPP named mutex implementation file
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "vpp/util/mutex.hpp"
+
+namespace Util {
+
+Mutex::Contention::Contention() noexcept
+    : acquisitions(0), contended(0), waiting(), holding() {}
+
+#ifdef VPP_HAS_LOCK_PROFILING
+
+/* The contentions of all the names, never destroyed for the mutexes to be
+ * released at any time, and exported whenever the metrics are collected */
+static Mutex::Contention *named(const char *name) noexcept {
+    using Contentions = std::map<std::string,
+                                 std::unique_ptr<Mutex::Contention>>;
+    static std::mutex   registry;
+    static Contentions *contentions = nullptr;
+
+    std::lock_guard<std::mutex> lock(registry);
+    if (contentions == nullptr) {
+        contentions = new Contentions();
+        Metrics::Registry::instance().attach(
+            [](Metrics::Exposition &e) {
+                std::lock_guard<std::mutex> lock(registry);
+                for (auto &c : *contentions) {
+                    auto l = "lock=" + Metrics::Exposition::quote(c.first);
+                    auto &s = *c.second;
+                    e.counter("vpp_lock_acquisitions_total",
+                              "Acquisitions of the named mutexes", l,
+                              s.acquisitions.load(std::memory_order_relaxed));
+                    e.counter("vpp_lock_contended_total",
+                              "Acquisitions waiting for the named mutexes", l,
+                              s.contended.load(std::memory_order_relaxed));
+                    e.summary("vpp_lock_wait_seconds",
+                              "Time waited for the contended mutexes", l,
+                              s.waiting);
+                    e.summary("vpp_lock_hold_seconds",
+                              "Time the named mutexes are held", l,
+                              s.holding);
+                } });
+    }
+
+    auto &found = (*contentions)[name];
+    if (found == nullptr) {
+        found.reset(new Mutex::Contention());
+    }
+
+    return found.get();
+}
+
+Mutex::Mutex(const char *name) noexcept
+    : native(), contention(named(name)), acquired(0) {}
+
+#endif
+
+}  // namespace Util
@@ -14,15 +14,48 @@
  *
  **/
 
+#include <unordered_map>
+#include <vector>
+
 #include "vpp/log.hpp"
 #include "vpp/util/ocv/capture.hpp"
 
+/* Hardware accelerated decoding is only available from OpenCV 4.5.2 */
+#if (CV_VERSION_MAJOR > 4) || \
+    ((CV_VERSION_MAJOR == 4) && ((CV_VERSION_MINOR > 5) || \
+                                 ((CV_VERSION_MINOR == 5) && \
+                                  (CV_VERSION_REVISION >= 2))))
+#define OCV_HAS_HW_ACCELERATION
+#endif
+
 namespace Util {
 namespace OCV {
-        
+
+/* The supported backends and accelerations */
+static const std::unordered_map<std::string, int> backends({
+    { "auto",      cv::CAP_ANY },
+    { "ffmpeg",    cv::CAP_FFMPEG },
+    { "gstreamer", cv::CAP_GSTREAMER },
+    { "v4l2",      cv::CAP_V4L2 } });
+
+#ifdef OCV_HAS_HW_ACCELERATION
+static const std::unordered_map<std::string, int> accelerations({
+    { "none",  cv::VIDEO_ACCELERATION_NONE },
+    { "any",   cv::VIDEO_ACCELERATION_ANY },
+    { "vaapi", cv::VIDEO_ACCELERATION_VAAPI },
+    { "d3d11", cv::VIDEO_ACCELERATION_D3D11 },
+    { "mfx",   cv::VIDEO_ACCELERATION_MFX } });
+
+/* The opening parameters for the selected acceleration */
+static std::vector<int> accelerated(int acceleration) {
+    return { cv::CAP_PROP_HW_ACCELERATION, acceleration };
+}
+#endif
+
 Capture::Capture() noexcept 
     : Util::IO::Input({ "ocv/file", "ocv/http", "ocv/https", "ocv/internal",
-                        "ocv/rtsp", "ocv/videoio"}), cap() {}
+                        "ocv/rtsp", "ocv/videoio"}), cap(), api(cv::CAP_ANY),
+      acceleration(0) {}
 
 Capture::~Capture() noexcept = default;
         
@@ -37,8 +70,25 @@ int Capture::open(const std::string &protocol, int id) noexcept {
     }
 }
 
+std::string Capture::identity() const noexcept {
+    /* The modes only depend on the source and on the OpenCV backend */
+    if (! cap.isOpened()) {
+        return std::string();
+    }
+
+#if CV_VERSION_MAJOR >= 4
+    return "ocv:" CV_VERSION ":" + cap.getBackendName();
+#else
+    return "ocv:" CV_VERSION;
+#endif
+}
+
 int Capture::open(int id) noexcept {
-    if (cap.open(id)) {
+#ifdef OCV_HAS_HW_ACCELERATION
+    if (cap.open(id, api, accelerated(acceleration))) {
+#else
+    if (cap.open(id, api)) {
+#endif
         return 0;
     } else {
         return -1;
@@ -69,7 +119,11 @@ int Capture::open(const std::string &protocol,
 }
 
 int Capture::open(const std::string &url) noexcept {
-    if (cap.open(url)) {
+#ifdef OCV_HAS_HW_ACCELERATION
+    if (cap.open(url, api, accelerated(acceleration))) {
+#else
+    if (cap.open(url, api)) {
+#endif
         return 0;
     } else {
         return -1;
@@ -97,6 +151,33 @@ int Capture::setup(int &width, int &height, int &rotation) noexcept {
     return 0;
 }
 
+int Capture::prefer(const std::string &backend,
+                    const std::string &accel) noexcept {
+    auto found = backends.find(backend);
+    if (found == backends.end()) {
+        LOGE("Capture::prefer(): Unsupported backend '%s'", backend.c_str());
+        return -1;
+    }
+    api = found->second;
+
+#ifdef OCV_HAS_HW_ACCELERATION
+    auto kind = accelerations.find(accel);
+    if (kind == accelerations.end()) {
+        LOGE("Capture::prefer(): Unsupported acceleration '%s'",
+             accel.c_str());
+        return -1;
+    }
+    acceleration = kind->second;
+#else
+    if (accel != "none") {
+        LOGW("Capture::prefer(): No '%s' acceleration before OpenCV 4.5.2",
+             accel.c_str());
+    }
+#endif
+
+    return 0;
+}
+
 int Capture::read(cv::Mat &image, VPP::Image::Mode &mode) noexcept {
     if (! cap.isOpened()) {
         return -1;
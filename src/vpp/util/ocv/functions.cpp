@@ -17,6 +17,10 @@
  *
  **/
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <opencv2/core/hal/intrin.hpp>
 
 #include "vpp/util/ocv/functions.hpp"
 
@@ -55,5 +59,224 @@ template int affinity(const cv::Rect2i &a, const cv::Rect2i &b);
 template float affinity(const cv::Rect2f &a, const cv::Rect2f &b); 
 template double affinity(const cv::Rect2d &a, const cv::Rect2d &b); 
 
+static inline float iou(float ax0, float ay0, float ax1, float ay1,
+                        float bx0, float by0, float bx1, float by1) noexcept {
+    auto w = std::min(ax1, bx1) - std::max(ax0, bx0);
+    auto h = std::min(ay1, by1) - std::max(ay0, by0);
+    if ( (w <= 0) || (h <= 0) ) {
+        return 0;
+    }
+    
+    auto bw = std::max(ax1, bx1) - std::min(ax0, bx0);
+    auto bh = std::max(ay1, by1) - std::min(ay0, by0);
+
+    return (w * h) / (bw * bh);
+}
+
+void iou(const Rects &src, const Rects &dst, float *results) noexcept {
+    const auto n = src.size();
+    const auto m = dst.size();
+
+    for (std::size_t i = 0; i < n; ++i) {
+        const auto ax0 = src.x0[i], ay0 = src.y0[i];
+        const auto ax1 = src.x1[i], ay1 = src.y1[i];
+        float *r = results + i * m;
+        std::size_t j = 0;
+
+#if CV_SIMD128
+        /* Using whatever SIMD instructions OpenCV was built with (SSE, AVX or
+         * NEON) for processing 4 destinations at once */
+        const cv::v_float32x4 zero = cv::v_setzero_f32();
+        const cv::v_float32x4 vax0 = cv::v_setall_f32(ax0);
+        const cv::v_float32x4 vay0 = cv::v_setall_f32(ay0);
+        const cv::v_float32x4 vax1 = cv::v_setall_f32(ax1);
+        const cv::v_float32x4 vay1 = cv::v_setall_f32(ay1);
+        for (; j + 4 <= m; j += 4) {
+            auto bx0 = cv::v_load(&dst.x0[j]);
+            auto by0 = cv::v_load(&dst.y0[j]);
+            auto bx1 = cv::v_load(&dst.x1[j]);
+            auto by1 = cv::v_load(&dst.y1[j]);
+
+            auto w  = cv::v_min(vax1, bx1) - cv::v_max(vax0, bx0);
+            auto h  = cv::v_min(vay1, by1) - cv::v_max(vay0, by0);
+            auto bw = cv::v_max(vax1, bx1) - cv::v_min(vax0, bx0);
+            auto bh = cv::v_max(vay1, by1) - cv::v_min(vay0, by0);
+            auto overlap = (w > zero) & (h > zero);
+            auto top = cv::v_max(w, zero) * cv::v_max(h, zero);
+            auto bot = cv::v_max(bw * bh, cv::v_setall_f32(1.0f));
+
+            cv::v_store(r + j, cv::v_select(overlap, top / bot, zero));
+        }
+#endif /*CV_SIMD128*/
+
+        for (; j < m; ++j) {
+            r[j] = iou(ax0, ay0, ax1, ay1,
+                       dst.x0[j], dst.y0[j], dst.x1[j], dst.y1[j]);
+        }
+    }
+}
+
+#if CV_SIMD128
+/* Widen 16 unsigned bytes into 16 scaled floats */
+static inline void widen(const cv::v_uint8x16 &v, float *to,
+                         const cv::v_float32x4 &k) noexcept {
+    cv::v_uint16x8 lo, hi;
+    cv::v_uint32x4 q0, q1, q2, q3;
+    cv::v_expand(v, lo, hi);
+    cv::v_expand(lo, q0, q1);
+    cv::v_expand(hi, q2, q3);
+    cv::v_store(to,      cv::v_cvt_f32(cv::v_reinterpret_as_s32(q0)) * k);
+    cv::v_store(to + 4,  cv::v_cvt_f32(cv::v_reinterpret_as_s32(q1)) * k);
+    cv::v_store(to + 8,  cv::v_cvt_f32(cv::v_reinterpret_as_s32(q2)) * k);
+    cv::v_store(to + 12, cv::v_cvt_f32(cv::v_reinterpret_as_s32(q3)) * k);
+}
+#endif /*CV_SIMD128*/
+
+void planarise(const cv::Mat &bgr, float *planes, int width, int height,
+               const cv::Point &at, float scale) noexcept {
+    auto area = static_cast<std::size_t>(width) * height;
+    int  n    = bgr.cols;
+
+    for (int y = 0; y < bgr.rows; ++y) {
+        auto from = bgr.ptr<uchar>(y);
+        auto o    = static_cast<std::size_t>(y + at.y) * width + at.x;
+        auto r    = planes + o;
+        auto g    = r + area;
+        auto b    = g + area;
+        int  x    = 0;
+
+#if CV_SIMD128
+        const cv::v_float32x4 k = cv::v_setall_f32(scale);
+        for (; x <= n - 16; x += 16) {
+            cv::v_uint8x16 vb, vg, vr;
+            cv::v_load_deinterleave(from + 3*x, vb, vg, vr);
+            widen(vr, r + x, k);
+            widen(vg, g + x, k);
+            widen(vb, b + x, k);
+        }
+#endif /*CV_SIMD128*/
+
+        for (; x < n; ++x) {
+            b[x] = from[3*x]     * scale;
+            g[x] = from[3*x + 1] * scale;
+            r[x] = from[3*x + 2] * scale;
+        }
+    }
+}
+
+void metric(const cv::Mat &depth, float scale, cv::Mat &metres) noexcept {
+    const float invalid = std::numeric_limits<float>::quiet_NaN();
+    const bool  scaled  = (depth.type() == CV_16UC1);
+    const int   n       = depth.cols;
+
+    metres.create(depth.size(), CV_32FC1);
+    for (int y = 0; y < depth.rows; ++y) {
+        auto to = metres.ptr<float>(y);
+        int  x  = 0;
+
+#if CV_SIMD128
+        /* The nil unsigned depths and the non-positive or NaN float depths
+         * are all selected as NaN */
+        const cv::v_float32x4 k    = cv::v_setall_f32(scale);
+        const cv::v_float32x4 nan  = cv::v_setall_f32(invalid);
+        const cv::v_float32x4 zero = cv::v_setzero_f32();
+        if (scaled) {
+            auto from = depth.ptr<uint16_t>(y);
+            for (; x <= n - 8; x += 8) {
+                cv::v_uint32x4 lo, hi;
+                cv::v_expand(cv::v_load(from + x), lo, hi);
+                auto flo = cv::v_cvt_f32(cv::v_reinterpret_as_s32(lo));
+                auto fhi = cv::v_cvt_f32(cv::v_reinterpret_as_s32(hi));
+                cv::v_store(to + x,     cv::v_select(flo > zero, flo * k, nan));
+                cv::v_store(to + x + 4, cv::v_select(fhi > zero, fhi * k, nan));
+            }
+        } else {
+            auto from = depth.ptr<float>(y);
+            for (; x <= n - 4; x += 4) {
+                auto v = cv::v_load(from + x);
+                cv::v_store(to + x, cv::v_select(v > zero, v, nan));
+            }
+        }
+#endif /*CV_SIMD128*/
+
+        if (scaled) {
+            auto from = depth.ptr<uint16_t>(y);
+            for (; x < n; ++x) {
+                to[x] = (from[x] > 0) ? from[x] * scale : invalid;
+            }
+        } else {
+            auto from = depth.ptr<float>(y);
+            for (; x < n; ++x) {
+                to[x] = (from[x] > 0) ? from[x] : invalid;
+            }
+        }
+    }
+}
+
+void merge(std::vector<cv::Rect> &rects) noexcept {
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (auto i = rects.begin(); i != rects.end(); ++i) {
+            for (auto j = i + 1; j != rects.end(); ) {
+                if ((*i & *j).area() > 0) {
+                    *i |= *j;
+                    j = rects.erase(j);
+                    merged = true;
+                } else {
+                    ++j;
+                }
+            }
+        }
+    }
+}
+
+int argmax(const float *values, int n, float &best) noexcept {
+    int   index = 0;
+    float peak  = values[0];
+    int   i     = 1;
+
+#if CV_SIMD128
+    /* Keeping the greatest value and its index in each lane, the lanes being
+     * reduced afterwards */
+    if (n >= 8) {
+        const cv::v_int32x4 four = cv::v_setall_s32(4);
+        cv::v_float32x4 vmax = cv::v_load(values);
+        cv::v_int32x4   vidx(0, 1, 2, 3);
+        cv::v_int32x4   vcur = vidx;
+        for (i = 4; i + 4 <= n; i += 4) {
+            vcur = vcur + four;
+            auto v  = cv::v_load(values + i);
+            auto gt = v > vmax;
+            vmax = cv::v_max(v, vmax);
+            vidx = cv::v_select(cv::v_reinterpret_as_s32(gt), vcur, vidx);
+        }
+
+        float m[4];
+        int   k[4];
+        cv::v_store(m, vmax);
+        cv::v_store(k, vidx);
+        peak  = m[0];
+        index = k[0];
+        for (int l = 1; l < 4; ++l) {
+            if ( (m[l] > peak) || ((m[l] == peak) && (k[l] < index)) ) {
+                peak  = m[l];
+                index = k[l];
+            }
+        }
+    }
+#endif /*CV_SIMD128*/
+
+    for (; i < n; ++i) {
+        if (values[i] > peak) {
+            peak  = values[i];
+            index = i;
+        }
+    }
+
+    best = peak;
+    return index;
+}
+
 }  // namespace OCV
 }  // namespace Util
@@ -0,0 +1,194 @@
+/**
+ *
+ * @file      vpp/util/ocv/mask.cpp
+ *
+ * @brief     This is the static mask of the relevant areas of a source
+ *
+ * @details   This is a mask of the areas of a source worth processing, as
+ *            rasterised once per resolution.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <cstdio>
+#include <opencv2/imgproc.hpp>
+#include <sstream>
+
+#include "vpp/util/ocv/mask.hpp"
+
+namespace Util {
+namespace OCV {
+
+float Mask::Raster::masked(const cv::Rect &r) const noexcept {
+    auto in = r & cv::Rect(0, 0, pixels.cols, pixels.rows);
+    if ( (r.area() <= 0) || (in.area() <= 0) ) {
+        return 1.0f;
+    }
+
+    /* The integral holds the number of relevant pixels */
+    auto relevant = sums.at<int>(in.y + in.height, in.x + in.width) -
+                    sums.at<int>(in.y, in.x + in.width) -
+                    sums.at<int>(in.y + in.height, in.x) +
+                    sums.at<int>(in.y, in.x);
+    return 1.0f - relevant / static_cast<float>(r.area());
+}
+
+Mask::Mask() noexcept
+    : included(), excluded(), threshold(0.5f), rasterising(), rasters() {}
+
+/* Parsing polygons of at least 3 normalised points */
+static bool parse(const std::string &text,
+                  std::vector<Mask::Polygon> &polygons) noexcept {
+    polygons.clear();
+
+    std::istringstream all(text);
+    std::string        list;
+    while (std::getline(all, list, ';')) {
+        std::istringstream points(list);
+        std::string        point;
+        Mask::Polygon      polygon;
+        while (points >> point) {
+            float x, y;
+            char  end;
+            if ( (std::sscanf(point.c_str(), "%f,%f%c", &x, &y, &end) != 2) ||
+                 (x < 0.0f) || (x > 1.0f) || (y < 0.0f) || (y > 1.0f) ) {
+                return false;
+            }
+            polygon.emplace_back(x, y);
+        }
+
+        if (polygon.empty()) {
+            continue;
+        }
+        if (polygon.size() < 3) {
+            return false;
+        }
+        polygons.emplace_back(std::move(polygon));
+    }
+
+    return true;
+}
+
+bool Mask::define(const std::string &inclusions,
+                  const std::string &exclusions, float t) noexcept {
+    std::vector<Polygon> in, out;
+    if ( (!parse(inclusions, in)) || (!parse(exclusions, out)) ) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(rasterising);
+    included  = std::move(in);
+    excluded  = std::move(out);
+    threshold = t;
+    rasters.clear();
+
+    return true;
+}
+
+void Mask::compose(const std::vector<const Mask *> &masks,
+                   const std::vector<cv::Rect_<float>> &cells) noexcept {
+    std::lock_guard<std::mutex> lock(rasterising);
+    included.clear();
+    excluded.clear();
+    rasters.clear();
+
+    auto n = std::min(masks.size(), cells.size());
+    bool including = false;
+    for (std::size_t i = 0; i < n; ++i) {
+        including = including ||
+                    ( (masks[i] != nullptr) && (!masks[i]->included.empty()) );
+    }
+
+    for (std::size_t i = 0; i < n; ++i) {
+        const auto &c = cells[i];
+        auto place = [&c](const Polygon &p) noexcept {
+            Polygon placed;
+            placed.reserve(p.size());
+            for (auto const &pt : p) {
+                placed.emplace_back(c.x + pt.x * c.width,
+                                    c.y + pt.y * c.height);
+            }
+            return placed; };
+
+        /* The cells without any inclusion are wholly included whenever
+         * another cell restricts its relevant areas */
+        const Mask *m = masks[i];
+        if ( (m == nullptr) || (m->included.empty()) ) {
+            if (including) {
+                included.emplace_back(Polygon{ c.tl(),
+                                               cv::Point2f(c.x + c.width, c.y),
+                                               c.br(),
+                                               cv::Point2f(c.x,
+                                                           c.y + c.height) });
+            }
+        } else {
+            for (auto const &p : m->included) {
+                included.emplace_back(place(p));
+            }
+        }
+
+        if (m != nullptr) {
+            for (auto const &p : m->excluded) {
+                excluded.emplace_back(place(p));
+            }
+            threshold = m->threshold;
+        }
+    }
+}
+
+/* Filling the polygons scaled to a raster */
+static void fill(cv::Mat &pixels, const std::vector<Mask::Polygon> &polygons,
+                 uchar value) noexcept {
+    std::vector<std::vector<cv::Point>> scaled;
+    scaled.reserve(polygons.size());
+    for (auto const &p : polygons) {
+        std::vector<cv::Point> points;
+        points.reserve(p.size());
+        for (auto const &pt : p) {
+            points.emplace_back(cvRound(pt.x * pixels.cols),
+                                cvRound(pt.y * pixels.rows));
+        }
+        scaled.emplace_back(std::move(points));
+    }
+    cv::fillPoly(pixels, scaled, cv::Scalar::all(value));
+}
+
+const Mask::Raster &Mask::raster(const cv::Size &size) const noexcept {
+    /* Inside a lock_guard scoped block */
+    std::lock_guard<std::mutex> lock(rasterising);
+    for (auto const &r : rasters) {
+        if (r.pixels.size() == size) {
+            return r;
+        }
+    }
+
+    rasters.emplace_back();
+    auto &r = rasters.back();
+    r.threshold = threshold;
+    r.pixels    = cv::Mat(size, CV_8UC1,
+                          cv::Scalar::all((included.empty()) ? 255 : 0));
+    fill(r.pixels, included, 255);
+    fill(r.pixels, excluded, 0);
+
+    /* The integral counts the relevant pixels */
+    cv::Mat ones;
+    cv::threshold(r.pixels, ones, 0, 1, cv::THRESH_BINARY);
+    cv::integral(ones, r.sums, CV_32S);
+
+    std::vector<cv::Point> relevant;
+    cv::findNonZero(r.pixels, relevant);
+    r.bounds = (relevant.empty()) ? cv::Rect() : cv::boundingRect(relevant);
+
+    return r;
+}
+
+}  // namespace OCV
+}  // namespace Util
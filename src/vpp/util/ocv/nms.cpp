@@ -0,0 +1,262 @@
+/**
+ *
+ * @file      vpp/util/ocv/nms.cpp
+ *
+ * @brief     This is the non-maximum suppression of the detected boxes
+ *
+ * @details   This is the non-maximum suppression shared by all the detectors.
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "vpp/util/ocv/nms.hpp"
+
+namespace Util {
+namespace OCV {
+
+void NMS::Boxes::clear() noexcept {
+    x0.clear();
+    y0.clear();
+    x1.clear();
+    y1.clear();
+    area.clear();
+    index.clear();
+}
+
+void NMS::Boxes::push(const cv::Rect &r, int i) noexcept {
+    x0.emplace_back(static_cast<float>(r.x));
+    y0.emplace_back(static_cast<float>(r.y));
+    x1.emplace_back(static_cast<float>(r.x + r.width));
+    y1.emplace_back(static_cast<float>(r.y + r.height));
+    area.emplace_back(static_cast<float>(r.area()));
+    index.emplace_back(i);
+}
+
+void NMS::Boxes::erase(std::size_t n) noexcept {
+    /* The order of the boxes does not matter, so the last one moves in */
+    x0[n]    = x0.back();
+    y0[n]    = y0.back();
+    x1[n]    = x1.back();
+    y1[n]    = y1.back();
+    area[n]  = area.back();
+    index[n] = index.back();
+    x0.pop_back();
+    y0.pop_back();
+    x1.pop_back();
+    y1.pop_back();
+    area.pop_back();
+    index.pop_back();
+}
+
+/* The corners and the area of a box */
+static inline void corners(const cv::Rect &r, float *a) noexcept {
+    a[0] = static_cast<float>(r.x);
+    a[1] = static_cast<float>(r.y);
+    a[2] = static_cast<float>(r.x + r.width);
+    a[3] = static_cast<float>(r.y + r.height);
+    a[4] = static_cast<float>(r.area());
+}
+
+NMS::NMS() noexcept
+    : threshold(0.4f), minimal(0.0f), classwise(false), sigma(0.0f),
+      merging(false), order(), keys(), groups(), buffer() {}
+
+int NMS::overlapped(const Boxes &b, const float *a) const noexcept {
+    const auto  n = b.index.size();
+    const float t = threshold;
+    std::size_t j = 0;
+
+#if CV_SIMD128
+    /* Finding the first block of 4 boxes holding an overlapping one, which
+     * the scalar loop then tells apart */
+    const cv::v_float32x4 zero = cv::v_setzero_f32();
+    const cv::v_float32x4 vt   = cv::v_setall_f32(t);
+    const cv::v_float32x4 vx0  = cv::v_setall_f32(a[0]);
+    const cv::v_float32x4 vy0  = cv::v_setall_f32(a[1]);
+    const cv::v_float32x4 vx1  = cv::v_setall_f32(a[2]);
+    const cv::v_float32x4 vy1  = cv::v_setall_f32(a[3]);
+    const cv::v_float32x4 va   = cv::v_setall_f32(a[4]);
+    for (; j + 4 <= n; j += 4) {
+        auto w = cv::v_min(vx1, cv::v_load(&b.x1[j])) -
+                 cv::v_max(vx0, cv::v_load(&b.x0[j]));
+        auto h = cv::v_min(vy1, cv::v_load(&b.y1[j])) -
+                 cv::v_max(vy0, cv::v_load(&b.y0[j]));
+        auto inter = cv::v_max(w, zero) * cv::v_max(h, zero);
+        auto areas = cv::v_load(&b.area[j]);
+        auto denom = (merging) ? cv::v_min(va, areas) : va + areas - inter;
+        if (cv::v_check_any(inter > vt * denom)) {
+            break;
+        }
+    }
+#endif /*CV_SIMD128*/
+
+    for (; j < n; ++j) {
+        auto w = std::min(a[2], b.x1[j]) - std::max(a[0], b.x0[j]);
+        auto h = std::min(a[3], b.y1[j]) - std::max(a[1], b.y0[j]);
+        auto inter = std::max(w, 0.0f) * std::max(h, 0.0f);
+        auto denom = (merging) ? std::min(a[4], b.area[j]) :
+                                 a[4] + b.area[j] - inter;
+        if (inter > t * denom) {
+            return static_cast<int>(j);
+        }
+    }
+
+    return -1;
+}
+
+void NMS::overlaps(const Boxes &b, const float *a, float *results)
+    const noexcept {
+    const auto  n = b.index.size();
+    std::size_t j = 0;
+
+#if CV_SIMD128
+    const cv::v_float32x4 zero = cv::v_setzero_f32();
+    const cv::v_float32x4 tiny = cv::v_setall_f32(1e-6f);
+    const cv::v_float32x4 vx0  = cv::v_setall_f32(a[0]);
+    const cv::v_float32x4 vy0  = cv::v_setall_f32(a[1]);
+    const cv::v_float32x4 vx1  = cv::v_setall_f32(a[2]);
+    const cv::v_float32x4 vy1  = cv::v_setall_f32(a[3]);
+    const cv::v_float32x4 va   = cv::v_setall_f32(a[4]);
+    for (; j + 4 <= n; j += 4) {
+        auto w = cv::v_min(vx1, cv::v_load(&b.x1[j])) -
+                 cv::v_max(vx0, cv::v_load(&b.x0[j]));
+        auto h = cv::v_min(vy1, cv::v_load(&b.y1[j])) -
+                 cv::v_max(vy0, cv::v_load(&b.y0[j]));
+        auto inter = cv::v_max(w, zero) * cv::v_max(h, zero);
+        auto areas = cv::v_load(&b.area[j]);
+        auto denom = (merging) ? cv::v_min(va, areas) : va + areas - inter;
+        cv::v_store(results + j, inter / cv::v_max(denom, tiny));
+    }
+#endif /*CV_SIMD128*/
+
+    for (; j < n; ++j) {
+        auto w = std::min(a[2], b.x1[j]) - std::max(a[0], b.x0[j]);
+        auto h = std::min(a[3], b.y1[j]) - std::max(a[1], b.y0[j]);
+        auto inter = std::max(w, 0.0f) * std::max(h, 0.0f);
+        auto denom = (merging) ? std::min(a[4], b.area[j]) :
+                                 a[4] + b.area[j] - inter;
+        results[j] = inter / std::max(denom, 1e-6f);
+    }
+}
+
+void NMS::apply(std::vector<cv::Rect> &boxes, std::vector<float> &scores,
+                const std::vector<int> &classes,
+                std::vector<int> &kept) noexcept {
+    kept.clear();
+
+    /* Sorting the candidates scoring enough once and for all */
+    order.clear();
+    for (std::size_t i = 0; i < boxes.size(); ++i) {
+        if (scores[i] > minimal) {
+            order.emplace_back(static_cast<int>(i));
+        }
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&scores](int a, int b) noexcept {
+                         return scores[a] > scores[b]; });
+
+    if ( (classwise) && (classes.size() == boxes.size()) ) {
+        keys = classes;
+    } else {
+        keys.assign(boxes.size(), 0);
+    }
+
+    for (auto &g : groups) {
+        g.second.clear();
+    }
+
+    if (sigma > 0.0f) {
+        decay(boxes, scores, kept);
+    } else {
+        suppress(boxes, kept);
+    }
+}
+
+void NMS::suppress(std::vector<cv::Rect> &boxes,
+                   std::vector<int> &kept) noexcept {
+    float a[5];
+    for (auto i : order) {
+        auto &g = groups[keys[i]];
+        corners(boxes[i], a);
+
+        auto p = overlapped(g, a);
+        if (p < 0) {
+            g.push(boxes[i], i);
+            kept.emplace_back(i);
+        } else if (merging) {
+            /* The kept box grows to the part of the object it misses */
+            auto &r = boxes[g.index[p]];
+            r |= boxes[i];
+            g.x0[p]   = static_cast<float>(r.x);
+            g.y0[p]   = static_cast<float>(r.y);
+            g.x1[p]   = static_cast<float>(r.x + r.width);
+            g.y1[p]   = static_cast<float>(r.y + r.height);
+            g.area[p] = static_cast<float>(r.area());
+        }
+    }
+}
+
+void NMS::decay(std::vector<cv::Rect> &boxes, std::vector<float> &scores,
+                std::vector<int> &kept) noexcept {
+    for (auto i : order) {
+        groups[keys[i]].push(boxes[i], i);
+    }
+
+    float a[5];
+    for (auto &entry : groups) {
+        auto &g = entry.second;
+        while (!g.index.empty()) {
+            /* Keeping the best remaining box, with its score decayed so far */
+            std::size_t best = 0;
+            for (std::size_t p = 1; p < g.index.size(); ++p) {
+                if (scores[g.index[p]] > scores[g.index[best]]) {
+                    best = p;
+                }
+            }
+
+            auto m = g.index[best];
+            corners(boxes[m], a);
+            kept.emplace_back(m);
+            g.erase(best);
+
+            /* Decaying the ones it overlaps, and dropping the ones no longer
+             * scoring enough */
+            buffer.resize(g.index.size());
+            overlaps(g, a, buffer.data());
+            for (auto p = g.index.size(); p-- > 0; ) {
+                auto o = buffer[p];
+                if (o <= threshold) {
+                    continue;
+                }
+
+                auto i = g.index[p];
+                scores[i] *= std::exp(-(o * o) / sigma);
+                if (scores[i] <= minimal) {
+                    if (merging) {
+                        boxes[m] |= boxes[i];
+                    }
+                    g.erase(p);
+                }
+            }
+        }
+    }
+
+    /* The kept boxes of all the classes by decreasing scores */
+    std::stable_sort(kept.begin(), kept.end(),
+                     [&scores](int a, int b) noexcept {
+                         return scores[a] > scores[b]; });
+}
+
+}  // namespace OCV
+}  // namespace Util
@@ -16,14 +16,17 @@
 
 #include "vpp/config.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <memory>
+#include <numeric>
 #ifdef VPP_HAS_EXTERNAL_FONT_SUPPORT
 #include <opencv2/freetype.hpp>
 #endif
 #ifdef VPP_HAS_IMAGE_CODEC_SUPPORT
 #include <opencv2/imgcodecs.hpp>
 #endif
+#include <opencv2/core/hal/intrin.hpp>
 #include <opencv2/imgproc.hpp>
 #include <sstream>
 #include <unordered_map>
@@ -121,15 +124,32 @@ namespace Font {
                     Util::UTF8::toASCII(line);
                     curSz = cv::getTextSize(line, font, fontScale, thickness,
                                             &baseLine);
-                    cv::putText(frame, line, 
-                                at + offset/2 + 
-                                cv::Point((maxSz.width-curSz.width)/2, 
-                                          (lineCnt+1)*height),
-                                font, fontScale, color, thickness, 
-                                static_cast<int>(antialiasing), false);
+                    stamp(frame, line, 
+                          at + offset/2 + 
+                          cv::Point((maxSz.width-curSz.width)/2, 
+                                    (lineCnt+1)*height),
+                          thickness, antialiasing, color, height);
                     ++lineCnt;
                 }
             }
+
+        protected:
+            virtual int advance(const std::string &text, int thickness,
+                                int height) const noexcept {
+                int baseLine;
+                return cv::getTextSize(text, font,
+                                       static_cast<double>(height)/32.0,
+                                       thickness, &baseLine).width;
+            }
+
+            virtual void raster(cv::Mat &frame, const std::string &text,
+                                const cv::Point &origin, int thickness,
+                                Overlay::AAMode antialiasing, cv::Scalar color,
+                                int height) const noexcept {
+                cv::putText(frame, text, origin, font,
+                            static_cast<double>(height)/32.0, color,
+                            thickness, static_cast<int>(antialiasing), false);
+            }
             
         private:
             enum cv::HersheyFonts font;
@@ -176,15 +196,29 @@ namespace Font {
                 lineCnt = 0;
                 while (std::getline(input, line)) {
                     curSz = font->getTextSize(line, height, -1, &baseLine);
-                    font->putText(frame, line, 
-                                  at + offset/2 +
-                                  cv::Point((maxSz.width-curSz.width)/2, 
-                                            ((4*lineCnt-1)*height)/4),
-                                  height, color, -1, 
-                                  static_cast<int>(antialiasing), false);
+                    stamp(frame, line, 
+                          at + offset/2 +
+                          cv::Point((maxSz.width-curSz.width)/2, 
+                                    ((4*lineCnt-1)*height)/4),
+                          thickness, antialiasing, color, height);
                     ++lineCnt;
                 }
             }
+
+        protected:
+            virtual int advance(const std::string &text, int /*thickness*/,
+                                int height) const noexcept {
+                int baseLine;
+                return font->getTextSize(text, height, -1, &baseLine).width;
+            }
+
+            virtual void raster(cv::Mat &frame, const std::string &text,
+                                const cv::Point &origin, int /*thickness*/,
+                                Overlay::AAMode antialiasing, cv::Scalar color,
+                                int height) const noexcept {
+                font->putText(frame, text, origin, height, color, -1,
+                              static_cast<int>(antialiasing), false);
+            }
             
         private:
             cv::Ptr<cv::freetype::FreeType2> font;
@@ -197,8 +231,47 @@ namespace Font {
 static std::unordered_map<std::string,
                           std::unique_ptr<Overlay::Font>> defined_fonts;
 
+/* The maximal number of glyphs kept in the atlas of a font, the next ones
+ * being drawn directly */
+static constexpr std::size_t ATLAS_CAPACITY = 4096;
+
+/* The length of the UTF-8 sequence starting with a given byte */
+static inline std::size_t sequence(char c) noexcept {
+    auto b = static_cast<uint8_t>(c);
+    if (b < 0xC0) {
+        return 1;
+    }
+    if (b < 0xE0) {
+        return 2;
+    }
+    return (b < 0xF0) ? 3 : 4;
+}
+
+/* Blending a colour into a BGR frame through a coverage mask */
+static void blend(cv::Mat &frame, const cv::Mat &mask, const cv::Point &at,
+                  const uint8_t color[3]) noexcept {
+    cv::Rect area(at, mask.size());
+    cv::Rect clipped = area & cv::Rect(0, 0, frame.cols, frame.rows);
+
+    for (int y = clipped.y; y < clipped.y + clipped.height; ++y) {
+        const uint8_t *m = mask.ptr<uint8_t>(y - area.y) + clipped.x - area.x;
+        uint8_t       *p = frame.ptr<uint8_t>(y) + 3*clipped.x;
+        for (int x = 0; x < clipped.width; ++x, p += 3) {
+            const int a = m[x];
+            if (a == 0) {
+                continue;
+            }
+            for (int k = 0; k < 3; ++k) {
+                p[k] = static_cast<uint8_t>((p[k]*(255-a) + color[k]*a + 127)
+                                            / 255);
+            }
+        }
+    }
+}
+
 Overlay::Font::Font(std::string id, std::string path) noexcept
-    : name(std::move(id)), location(std::move(path)) {}
+    : name(std::move(id)), location(std::move(path)), access(), atlas(),
+      glyphs(0) {}
 Overlay::Font::~Font() noexcept = default;
 
 Overlay::Font *Overlay::Font::any() noexcept {
@@ -268,7 +341,121 @@ void Overlay::Font::write(cv::Mat &/*frame*/, const std::string &/*text*/,
     LOGE("Overlay::Font::write() has to be implemented in all child classes.");
 }
 
-Overlay::Layer::Layer() noexcept : width(0), height(0), fg(), msk() {}
+int Overlay::Font::advance(const std::string &/*text*/, int /*thickness*/,
+                           int /*height*/) const noexcept {
+    return 0;
+}
+
+void Overlay::Font::raster(cv::Mat &/*frame*/, const std::string &/*text*/,
+                           const cv::Point &/*origin*/, int /*thickness*/,
+                           AAMode /*antialiasing*/, cv::Scalar /*color*/,
+                           int /*height*/) const noexcept {
+    LOGE("Overlay::Font::raster() has to be implemented in all child "
+         "classes.");
+}
+
+const Overlay::Font::Glyph *
+    Overlay::Font::glyph(const std::string &g, int thickness,
+                         AAMode antialiasing, int height) const noexcept {
+    auto size = (static_cast<uint64_t>(static_cast<uint32_t>(height)) << 32) |
+                (static_cast<uint64_t>(thickness & 0xFFFF) << 16) |
+                static_cast<uint64_t>(static_cast<int>(antialiasing) & 0xFFFF);
+
+    /* Glyphs are never removed, so that they outlive the lock */
+    std::lock_guard<std::mutex> lock(access);
+    auto &sized = atlas[size];
+    auto found  = sized.find(g);
+    if (found != sized.end()) {
+        return &found->second;
+    }
+    if (glyphs >= ATLAS_CAPACITY) {
+        return nullptr;
+    }
+
+    /* Rasterise the glyph in white on a canvas leaving room for any overhang,
+     * and only keep the coverage mask of its bounding box. The advance of a
+     * glyph is the one of a pair of glyphs less the one of a single glyph, as
+     * the fonts account for the overhang of the last glyph of some text */
+    Glyph created;
+    auto single      = advance(g, thickness, height);
+    created.advance  = advance(g + g, thickness, height) - single;
+    const int margin = 2*(height + std::abs(thickness));
+    const cv::Point origin(margin, margin);
+    cv::Mat canvas(2*margin, single + 2*margin, CV_8UC3,
+                   cv::Scalar(0, 0, 0)), mask;
+    raster(canvas, g, origin, thickness, antialiasing,
+           cv::Scalar(255, 255, 255), height);
+    cv::cvtColor(canvas, mask, cv::COLOR_BGR2GRAY);
+
+    auto box = cv::boundingRect(mask);
+    if (box.area() > 0) {
+        created.mask = mask(box).clone();
+    }
+    created.offset = box.tl() - origin;
+
+    ++glyphs;
+    return &sized.emplace(g, std::move(created)).first->second;
+}
+
+void Overlay::Font::stamp(cv::Mat &frame, const std::string &line,
+                          cv::Point origin, int thickness,
+                          AAMode antialiasing, const cv::Scalar &color,
+                          int height) const noexcept {
+    /* Only BGR frames are blended glyph by glyph */
+    if (frame.type() != CV_8UC3) {
+        return raster(frame, line, origin, thickness, antialiasing, color,
+                      height);
+    }
+
+    const uint8_t bgr[3] = { cv::saturate_cast<uint8_t>(color[0]),
+                             cv::saturate_cast<uint8_t>(color[1]),
+                             cv::saturate_cast<uint8_t>(color[2]) };
+    for (std::size_t i = 0; i < line.size(); ) {
+        auto n = std::min(sequence(line[i]), line.size() - i);
+        auto c = line.substr(i, n);
+        i += n;
+
+        auto g = glyph(c, thickness, antialiasing, height);
+        if (g == nullptr) {
+            /* The atlas is full */
+            raster(frame, c, origin, thickness, antialiasing, color, height);
+            origin.x += advance(c + c, thickness, height) - 
+                        advance(c, thickness, height);
+            continue;
+        }
+
+        if (!g->mask.empty()) {
+            blend(frame, g->mask, origin + g->offset, bgr);
+        }
+        origin.x += g->advance;
+    }
+}
+
+Overlay::Batch::Batch() noexcept : boxes(), texts() {}
+Overlay::Batch::~Batch() noexcept = default;
+
+void Overlay::Batch::clear() noexcept {
+    boxes.clear();
+    texts.clear();
+}
+
+bool Overlay::Batch::empty() const noexcept {
+    return boxes.empty() && texts.empty();
+}
+
+void Overlay::Batch::add(const cv::Rect &box, const DrawingStyle &style) {
+    boxes.push_back(Box{box, style});
+}
+
+void Overlay::Batch::add(std::string text, const cv::Point &at,
+                         const TextStyle &style) {
+    if (!text.empty()) {
+        texts.push_back(Text{std::move(text), at, style});
+    }
+}
+
+Overlay::Layer::Layer() noexcept
+    : width(0), height(0), fg(), msk(), access(), sfg(), smsk() {}
 Overlay::Layer::~Layer() noexcept = default;
 
 void Overlay::Layer::clear() noexcept {
@@ -276,12 +463,86 @@ void Overlay::Layer::clear() noexcept {
     msk    = cv::Mat();
     width  = 0;
     height = 0;
+
+    /* Inside a lock_guard scoped block */
+    {
+        std::lock_guard<std::mutex> lock(access);
+        sfg  = cv::Mat();
+        smsk = cv::Mat();
+    }
 }
 
 bool Overlay::Layer::empty() const noexcept {
     return ((width <= 0) || (height <= 0));
 }
 
+cv::Size Overlay::Layer::size(const cv::Size &frame,
+                              const Overlay::LayerStyle &style)
+    const noexcept {
+    if ((style.reference <= 0) || (frame.height == style.reference)) {
+        return cv::Size(width, height);
+    }
+
+    auto k = static_cast<double>(frame.height) / style.reference;
+    return cv::Size(std::max(1, cvRound(width * k)),
+                    std::max(1, cvRound(height * k)));
+}
+
+void Overlay::Layer::scaled(const cv::Size &to, cv::Mat &f,
+                            cv::Mat &m) const noexcept {
+    if (to == fg.size()) {
+        f = fg;
+        m = msk;
+        return;
+    }
+
+    /* Inside a lock_guard scoped block */
+    {
+        std::lock_guard<std::mutex> lock(access);
+        if (sfg.size() != to) {
+            /* The premultiplied colours are scaled without any fringe */
+            cv::resize(fg, sfg, to, 0, 0, cv::INTER_AREA);
+            cv::resize(msk, smsk, to, 0, 0, cv::INTER_AREA);
+        }
+        f = sfg;
+        m = smsk;
+    }
+}
+
+/* Blending n premultiplied bytes into the background, as fg + bg * inv * s,
+ * where the inverse alpha is in 1/255 and the saturation s in 1/256 */
+static void blend(const uchar *fg, const uchar *inv, uchar *bg, int n,
+                  int s) noexcept {
+    int i = 0;
+
+#if CV_SIMD128
+    const cv::v_uint16x8 vs  = cv::v_setall_u16(static_cast<ushort>(s));
+    const cv::v_uint16x8 one = cv::v_setall_u16(1);
+    for (; i <= n - 16; i += 16) {
+        cv::v_uint16x8 b0, b1, w0, w1;
+        cv::v_expand(cv::v_load(bg + i), b0, b1);
+        cv::v_expand(cv::v_load(inv + i), w0, w1);
+
+        /* The saturated inverse alpha, then the background product divided
+         * by 255 as (p + 1 + p/256) / 256 */
+        w0 = cv::v_mul_wrap(w0, vs) >> 8;
+        w1 = cv::v_mul_wrap(w1, vs) >> 8;
+        b0 = cv::v_mul_wrap(b0, w0);
+        b1 = cv::v_mul_wrap(b1, w1);
+        b0 = (b0 + one + (b0 >> 8)) >> 8;
+        b1 = (b1 + one + (b1 >> 8)) >> 8;
+
+        cv::v_store(bg + i, cv::v_load(fg + i) + cv::v_pack(b0, b1));
+    }
+#endif /*CV_SIMD128*/
+
+    for (; i < n; ++i) {
+        int w = (inv[i] * s) >> 8;
+        int p = bg[i] * w;
+        bg[i] = cv::saturate_cast<uchar>(fg[i] + ((p + 1 + (p >> 8)) >> 8));
+    }
+}
+
 void Overlay::Layer::merge(cv::Mat &frame, const cv::Point &at,
                            const Overlay::LayerStyle &style) const noexcept {
     
@@ -290,20 +551,34 @@ void Overlay::Layer::merge(cv::Mat &frame, const cv::Point &at,
         return;
     }
 
-    cv::Mat bg;
+    ASSERT((frame.type() == CV_8UC3),
+           "Overlay::Layer::merge(): Invalid frame type provided!");
+
+    cv::Mat f, m;
+    scaled(size(frame.size(), style), f, m);
 
-    cv::Rect location(at, fg.size());
+    cv::Rect location(at, f.size());
     if (location.x < 0) {
-        location.x += frame.cols-fg.cols;
+        location.x += frame.cols-f.cols;
     }
 
     if (location.y < 0) {
-        location.y += frame.rows-fg.rows;
+        location.y += frame.rows-f.rows;
+    }
+
+    /* Only blending the part of the layer rectangle within the frame */
+    auto area = location & cv::Rect(0, 0, frame.cols, frame.rows);
+    if (area.empty()) {
+        return;
     }
 
-    cv::Mat(frame, location).convertTo(bg, CV_32FC3, 1.0, 0);
-    bg = bg.mul(msk, style.saturation);
-    cv::add(fg, bg, frame(location), cv::noArray(), -1);
+    auto ox = area.x - location.x;
+    auto oy = area.y - location.y;
+    auto s  = std::min(256, std::max(0, cvRound(style.saturation * 256)));
+    for (int y = 0; y < area.height; ++y) {
+        blend(f.ptr<uchar>(oy + y, ox), m.ptr<uchar>(oy + y, ox),
+              frame.ptr<uchar>(area.y + y, area.x), area.width * 3, s);
+    }
 }
 
 void Overlay::Layer::set(const std::string &filename) noexcept {
@@ -354,16 +629,22 @@ void Overlay::Layer::set(const cv::Mat &bgr, const cv::Mat &alpha) noexcept {
         return clear();
     }
 
-    cv::Mat msk1, msk3;
+    cv::Mat alpha3;
 
-    alpha.convertTo(msk1, CV_32FC1, 1.0/255.0, 0);
-    cv::cvtColor(msk1, msk3, cv::COLOR_GRAY2RGB, 3);
-    bgr.convertTo(fg, CV_32FC3, 1.0, 0);
-    fg = fg.mul(msk3, 1.0);
-    cv::cvtColor(1.0 - msk1, msk, cv::COLOR_GRAY2RGB, 3);
+    /* Premultiplying the colours once, and keeping the inverse alpha */
+    cv::cvtColor(alpha, alpha3, cv::COLOR_GRAY2BGR, 3);
+    cv::multiply(bgr, alpha3, fg, 1.0/255.0, CV_8UC3);
+    cv::subtract(cv::Scalar::all(255), alpha3, msk);
 
     width  = fg.cols;
     height = fg.rows; 
+
+    /* Inside a lock_guard scoped block */
+    {
+        std::lock_guard<std::mutex> lock(access);
+        sfg  = cv::Mat();
+        smsk = cv::Mat();
+    }
 }
 
 Overlay::Overlay() noexcept {
@@ -382,6 +663,7 @@ void Overlay::resetDefaultDrawingStyle() noexcept {
 
 void Overlay::resetDefaultLayerStyle() noexcept {
     defaultLayerStyle.saturation    = 1.0;
+    defaultLayerStyle.reference     = 0;
 }
 
 void Overlay::resetDefaultTextStyle() noexcept {
@@ -442,10 +724,106 @@ void Overlay::draw(cv::Mat &frame, const cv::Rect &box,
     }
 }
 
+void Overlay::draw(cv::Mat &frame, const Overlay::Batch &batch)
+    const noexcept {
+    /* Only BGR frames are blended row by row */
+    if (frame.type() != CV_8UC3) {
+        for (auto &b : batch.boxes) {
+            draw(frame, b.rect, b.style);
+        }
+        for (auto &t : batch.texts) {
+            draw(frame, t.text, t.at, t.style);
+        }
+        return;
+    }
+
+    /* Gather the translucent boxes within the frame, the alpha channel being
+     * the weight of the background */
+    struct Fill {
+        cv::Rect rect;
+        int      alpha;
+        int      color[3];
+    };
+    const cv::Rect   bounds(0, 0, frame.cols, frame.rows);
+    std::vector<Fill> fills;
+    for (auto &b : batch.boxes) {
+        if ( (b.style.thickness <= 0) && (b.style.color[3] > 0) ) {
+            Fill f;
+            f.rect  = b.rect & bounds;
+            f.alpha = std::min(255, static_cast<int>(b.style.color[3]));
+            for (int k = 0; k < 3; ++k) {
+                f.color[k] = cv::saturate_cast<uint8_t>(b.style.color[k]) * 
+                             (255 - f.alpha);
+            }
+            if (f.rect.area() > 0) {
+                fills.push_back(f);
+            }
+        }
+    }
+
+    /* Blend them in a single pass over the rows, the overlapping boxes being
+     * blended in their batch order */
+    std::vector<int> order(fills.size()), active;
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), 
+                     [&fills](int a, int b) noexcept {
+                         return fills[a].rect.y < fills[b].rect.y; });
+    std::size_t next = 0;
+    int y = fills.empty() ? 0 : fills[order[0]].rect.y;
+    while ( (next < order.size()) || (!active.empty()) ) {
+        while ( (next < order.size()) && (fills[order[next]].rect.y <= y) ) {
+            auto i = order[next++];
+            active.insert(std::upper_bound(active.begin(), active.end(), i),
+                          i);
+        }
+        auto done = [&fills, y](int i) noexcept {
+                        return fills[i].rect.y + fills[i].rect.height <= y; };
+        active.erase(std::remove_if(active.begin(), active.end(), done),
+                     active.end());
+        if (active.empty()) {
+            if (next < order.size()) {
+                y = fills[order[next]].rect.y;
+            }
+            continue;
+        }
+
+        uint8_t *row = frame.ptr<uint8_t>(y);
+        for (auto i : active) {
+            const auto &f = fills[i];
+            uint8_t *p = row + 3*f.rect.x;
+            for (int x = 0; x < f.rect.width; ++x, p += 3) {
+                for (int k = 0; k < 3; ++k) {
+                    p[k] = static_cast<uint8_t>((p[k]*f.alpha + f.color[k] +
+                                                 127) / 255);
+                }
+            }
+        }
+        ++y;
+    }
+
+    /* Then draw the outlines */
+    for (auto &b : batch.boxes) {
+        auto thickness = b.style.thickness;
+        if ( (thickness <= 0) && (b.style.color[3] > 0) ) {
+            thickness = -thickness;
+        }
+        if (thickness != 0) {
+            cv::rectangle(frame, b.rect, b.style.color, thickness,
+                          static_cast<int>(b.style.antialiasing), 0);
+        }
+    }
+
+    /* And finally the texts */
+    for (auto &t : batch.texts) {
+        draw(frame, t.text, t.at, t.style);
+    }
+}
+
 void Overlay::draw(cv::Mat &frame, const Overlay::Layer &layer) const noexcept {
     /* Center the layer by default */
-    return draw(frame, layer, cv::Point((frame.cols - layer.width)/2,
-                                        (frame.rows - layer.height)/2));
+    auto sz = layer.size(frame.size(), defaultLayerStyle);
+    return draw(frame, layer, cv::Point((frame.cols - sz.width)/2,
+                                        (frame.rows - sz.height)/2));
 }
 
 void Overlay::draw(cv::Mat &frame, const Overlay::Layer &layer, 
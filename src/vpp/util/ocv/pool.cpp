@@ -0,0 +1,190 @@
+/**
+ *
+ * @file      vpp/util/ocv/pool.cpp
+ *
+ * @brief     This is a pool of OpenCV matrix buffers
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+#include <cstdint>
+
+#include "vpp/util/affinity.hpp"
+#include "vpp/util/ocv/pool.hpp"
+
+namespace Util {
+namespace OCV {
+
+/* By default, keep up to 64MB of buffers in the pool */
+static const std::size_t default_max_pooled = 64 * 1024 * 1024;
+
+Pool &Pool::shared() noexcept {
+    static Pool *pool = new Pool();
+    return *pool;
+}
+
+cv::Mat Pool::mat(const cv::Size &size, int type) noexcept {
+    cv::Mat m;
+    m.allocator = &shared();
+    m.create(size, type);
+    return m;
+}
+
+Pool::Pool() noexcept : access(), buffers(Util::Affinity::nodes()), stats(),
+                        max_pooled(default_max_pooled) {}
+
+Pool::~Pool() noexcept {
+    trim();
+}
+
+cv::UMatData *Pool::allocate(int dims, const int *sizes, int type,
+                             void *data, std::size_t *step, Access /*flags*/,
+                             cv::UMatUsageFlags /*usage*/) const {
+    std::size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; --i) {
+        if (step != nullptr) {
+            if ( (data != nullptr) && (step[i] != CV_AUTOSTEP) ) {
+                total = step[i];
+            } else {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    auto *u = new cv::UMatData(this);
+    if (data != nullptr) {
+        u->data   = u->origdata = static_cast<uchar *>(data);
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+    } else {
+        /* The node of the buffer is kept for recycling it on the same node */
+        auto node   = Util::Affinity::node();
+        u->data     = u->origdata = take(total, node);
+        u->userdata = reinterpret_cast<void *>(static_cast<intptr_t>(node));
+    }
+    u->size = total;
+
+    return u;
+}
+
+bool Pool::allocate(cv::UMatData *data, Access /*flags*/,
+                    cv::UMatUsageFlags /*usage*/) const {
+    return data != nullptr;
+}
+
+void Pool::deallocate(cv::UMatData *data) const {
+    if (data == nullptr) {
+        return;
+    }
+
+    if (!(data->flags & cv::UMatData::USER_ALLOCATED)) {
+        auto node = static_cast<int>(reinterpret_cast<intptr_t>(
+                                                            data->userdata));
+        give(data->origdata, data->size, node);
+        data->origdata = nullptr;
+    }
+
+    delete data;
+}
+
+uchar *Pool::take(std::size_t size, int node) const noexcept {
+    {
+        std::lock_guard<std::mutex> lock(access);
+
+        stats.used += size;
+        auto &local = buffers[node];
+        auto found  = local.find(size);
+        if (found != local.end()) {
+            auto *buffer = found->second;
+            local.erase(found);
+            stats.pooled -= size;
+            ++stats.reuses;
+            return buffer;
+        }
+
+        ++stats.allocations;
+        stats.peak = std::max(stats.peak, stats.used + stats.pooled);
+    }
+
+    /* The pages of a new buffer are placed on the node of the thread first
+     * touching them, i.e. the one creating the matrix on a pinned thread */
+    return static_cast<uchar *>(cv::fastMalloc(size));
+}
+
+void Pool::give(uchar *buffer, std::size_t size, int node) const noexcept {
+    {
+        std::lock_guard<std::mutex> lock(access);
+
+        stats.used -= size;
+        if (stats.pooled + size <= max_pooled) {
+            buffers[node].emplace(size, buffer);
+            stats.pooled += size;
+            return;
+        }
+    }
+
+    cv::fastFree(buffer);
+}
+
+void Pool::limit(std::size_t bytes) noexcept {
+    {
+        std::lock_guard<std::mutex> lock(access);
+        max_pooled = bytes;
+    }
+
+    /* Release the whole pool if it exceeds the new limit as it only holds
+     * buffers released from former frames */
+    if (statistics().pooled > bytes) {
+        trim();
+    }
+}
+
+void Pool::trim() noexcept {
+    std::vector<Buffers> released;
+    {
+        std::lock_guard<std::mutex> lock(access);
+        released.resize(buffers.size());
+        released.swap(buffers);
+        stats.pooled = 0;
+    }
+
+    for (auto &node : released) {
+        for (auto &b : node) {
+            cv::fastFree(b.second);
+        }
+    }
+}
+
+Pool::Statistics Pool::statistics() const noexcept {
+    std::lock_guard<std::mutex> lock(access);
+    return stats;
+}
+
+std::size_t Footprint::add(const cv::Mat &m) noexcept {
+    if (m.empty()) {
+        return 0;
+    }
+
+    /* The matrices wrapping an external buffer have no matrix data */
+    const void *buffer = (m.u != nullptr) ?
+                             static_cast<const void *>(m.u) :
+                             static_cast<const void *>(m.datastart);
+    if (std::find(seen.begin(), seen.end(), buffer) != seen.end()) {
+        return 0;
+    }
+    seen.push_back(buffer);
+
+    return ( (m.u != nullptr) && (m.u->size > 0) ) ?
+               m.u->size : static_cast<std::size_t>(m.dataend - m.datastart);
+}
+
+}  // namespace OCV
+}  // namespace Util
@@ -0,0 +1,75 @@
+/**
+ *
+ * @file      vpp/util/slab.cpp
+ *
+ * @brief     This is the VPP slab allocator implementation file
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <algorithm>
+
+#include "vpp/util/slab.hpp"
+
+namespace Util {
+
+/* Blocks are rounded up to the fundamental alignment, for every block of a
+ * chunk to be suitably aligned for any object */
+static std::size_t aligned(std::size_t size) noexcept {
+    const std::size_t a = alignof(std::max_align_t);
+    return ((std::max(size, sizeof(void *)) + a - 1) / a) * a;
+}
+
+Slab::Slab(std::size_t size, std::size_t blocks) noexcept 
+    : block(aligned(size)), count(std::max<std::size_t>(blocks, 1)), 
+      chunks(), available(nullptr), live(0) {}
+
+void *Slab::allocate() {
+    if (available == nullptr) {
+        /* Carve a new chunk out and chain all its blocks */
+        std::unique_ptr<char[]> chunk(new char[block * count]);
+        for (std::size_t i = count; i-- > 0; ) {
+            auto f = reinterpret_cast<Free *>(chunk.get() + i * block);
+            f->next   = available;
+            available = f;
+        }
+        chunks.emplace_back(std::move(chunk));
+    }
+
+    auto p    = available;
+    available = p->next;
+    ++live;
+
+    return p;
+}
+
+void Slab::release(void *p) noexcept {
+    if (p == nullptr) {
+        return;
+    }
+
+    auto f    = static_cast<Free *>(p);
+    f->next   = available;
+    available = f;
+    --live;
+}
+
+Slab &Slabs::of(std::size_t size) {
+    for (auto &s : slabs) {
+        if (s->size() == aligned(size)) {
+            return *s;
+        }
+    }
+
+    slabs.emplace_back(new Slab(size));
+    return *slabs.back();
+}
+
+}  // namespace Util
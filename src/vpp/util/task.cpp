@@ -20,13 +20,41 @@
  **/
 
 #include <algorithm>
+#include <chrono>
 #include <climits>
+#include <cstdio>
+#include <memory>
 
+#include "vpp/log.hpp"
 #include "vpp/util/task.hpp"
+#include "vpp/util/trace.hpp"
 
 namespace Util {
 namespace Task {
 
+constexpr int Priority::Critical;
+constexpr int Priority::Normal;
+constexpr int Priority::Background;
+constexpr int Priority::Levels;
+
+/* The priority of every thread, the main one being a normal one */
+static thread_local int inherited = Priority::Normal;
+
+/* The virtual time taken by a work of a weight-1 priority */
+static constexpr uint64_t unit = 1 << 16;
+
+int Priority::current() noexcept {
+    return inherited;
+}
+
+Priority::Scope::Scope(int p) noexcept : _previous(inherited) {
+    inherited = std::min(std::max(p, 0), Levels - 1);
+}
+
+Priority::Scope::~Scope() noexcept {
+    inherited = _previous;
+}
+
 Core::Core(const int mode) noexcept : _error(0) {
     int cnt = abs(mode);
     
@@ -42,17 +70,43 @@ Core::Core(const int mode) noexcept : _error(0) {
 }
 
 int Core::start(Work work) noexcept {
+    Util::Trace::Span span("task", "start");
+
+    /* The work is traced in the thread actually running it */
+    if (Util::Trace::enabled()) {
+        work = [work]() noexcept { 
+                   Util::Trace::Span running("task", "work");
+                   return work(); };
+    }
+
     if (_mode == Mode::Sync) {
         _error = work();
         return 0;
     }
 
+    /* Asynchronous tasks are run by the persistent workers (if any) */
+    auto &pool = Pool::instance();
+    if ( (_mode == Mode::Async) && (pool.size() > 0) ) {
+        for (auto &s : _status) {
+            s = pool.submit(work);
+        }
+        return 0;
+    }
+
     std::launch kind;
     if (_mode == Mode::Async) {
         kind = std::launch::async;
     } else {
         kind = std::launch::deferred;
     }
+
+    /* The threads launched for the work inherit the priority */
+    auto p = Priority::current();
+    if (p != Priority::Normal) {
+        work = [work, p]() noexcept {
+                   Priority::Scope scope(p);
+                   return work(); };
+    }
  
     for (auto &s : _status) {
         s = std::async(kind, work);
@@ -62,10 +116,20 @@ int Core::start(Work work) noexcept {
 }
 
 int Core::wait() noexcept {
+    Util::Trace::Span span("task", "wait");
+
     if (_mode != Mode::Sync) {
 
         _error = INT_MAX;
         for (auto &s : _status) {
+            /* Help the pool until the work is done, as it may be waiting for
+             * this very thread to be available. As soon as there is no more
+             * pending work, then the work is already running somewhere */
+            if (_mode == Mode::Async) {
+                while ( (s.wait_for(std::chrono::seconds(0)) !=
+                         std::future_status::ready) &&
+                        (Pool::instance().help()) ) {}
+            }
             int e = s.get();
             if (e < _error) {
                 _error = e;
@@ -76,5 +140,364 @@ int Core::wait() noexcept {
     return _error;
 }
 
+Pool &Pool::instance() noexcept {
+    static Pool pool;
+    return pool;
+}
+
+Pool::Pool() noexcept : _access(), _ready(), _jobs(),
+    _weights{ 16, 4, 1 }, _passes{ 0, 0, 0 }, _clock(0), _workers(),
+    _cores(), _exiting(false) {
+    resize(std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+}
+
+Pool::~Pool() noexcept {
+    resize(0);
+}
+
+void Pool::resize(int workers) noexcept {
+    std::vector<std::thread> retired;
+
+    {
+        /* Inside a lock_guard scoped block */
+        std::lock_guard<std::mutex> lock(_access);
+
+        if (static_cast<int>(_workers.size()) == workers) {
+            return;
+        }
+
+        _exiting = true;
+        std::swap(retired, _workers);
+    }
+
+    /* Pending works are all processed before retiring the workers */
+    _ready.notify_all();
+    for (auto &w : retired) {
+        w.join();
+    }
+
+    /* Inside a lock_guard scoped block */
+    std::lock_guard<std::mutex> lock(_access);
+    _exiting = false;
+    for (int i = 0; i < std::max(0, workers); ++i) {
+        _workers.emplace_back([this] { return this->run(); });
+        if (!_cores.empty()) {
+            Affinity::pin(_workers.back(), _cores);
+        }
+    }
+}
+
+int Pool::size() noexcept {
+    /* Inside a lock_guard scoped block */
+    std::lock_guard<std::mutex> lock(_access);
+    return static_cast<int>(_workers.size());
+}
+
+void Pool::pin(const Util::Affinity::Cores &cores) noexcept {
+    /* Inside a lock_guard scoped block */
+    std::lock_guard<std::mutex> lock(_access);
+    _cores = cores;
+    for (auto &w : _workers) {
+        Affinity::pin(w, _cores);
+    }
+}
+
+void Pool::weigh(int priority, int weight) noexcept {
+    /* Inside a lock_guard scoped block */
+    std::lock_guard<std::mutex> lock(_access);
+    priority = std::min(std::max(priority, 0), Priority::Levels - 1);
+    _weights[priority] = std::max(1, weight);
+}
+
+int Pool::weight(int priority) noexcept {
+    /* Inside a lock_guard scoped block */
+    std::lock_guard<std::mutex> lock(_access);
+    priority = std::min(std::max(priority, 0), Priority::Levels - 1);
+    return _weights[priority];
+}
+
+std::future<int> Pool::submit(const Core::Work &work) noexcept {
+    return submit(work, Priority::current());
+}
+
+std::future<int> Pool::submit(const Core::Work &work, int priority) noexcept {
+    /* Packaged tasks cannot be copied, so share them with the pending work */
+    auto job    = std::make_shared<std::packaged_task<int()> >(work);
+    auto status = job->get_future();
+    auto p      = std::min(std::max(priority, 0), Priority::Levels - 1);
+
+    {
+        /* Inside a lock_guard scoped block */
+        std::lock_guard<std::mutex> lock(_access);
+
+        /* An idle priority does not bank any share whilst idle */
+        if (_jobs[p].empty()) {
+            _passes[p] = std::max(_passes[p], _clock);
+        }
+        _jobs[p].emplace_back([job, p] {
+                                  Priority::Scope scope(p);
+                                  (*job)(); });
+    }
+    _ready.notify_one();
+
+    return status;
+}
+
+bool Pool::take(std::function<void()> &job) noexcept {
+    int chosen = -1;
+    for (int p = 0; p < Priority::Levels; ++p) {
+        if ( (!_jobs[p].empty()) &&
+             ( (chosen < 0) || (_passes[p] < _passes[chosen]) ) ) {
+            chosen = p;
+        }
+    }
+    if (chosen < 0) {
+        return false;
+    }
+
+    job = std::move(_jobs[chosen].front());
+    _jobs[chosen].pop_front();
+    _clock            = _passes[chosen];
+    _passes[chosen]  += unit / static_cast<uint64_t>(_weights[chosen]);
+
+    return true;
+}
+
+bool Pool::pending() const noexcept {
+    for (auto &jobs : _jobs) {
+        if (!jobs.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Pool::help() noexcept {
+    std::function<void()> job;
+
+    {
+        /* Inside a lock_guard scoped block */
+        std::lock_guard<std::mutex> lock(_access);
+        if (!take(job)) {
+            return false;
+        }
+    }
+
+    job();
+    return true;
+}
+
+void Pool::run() noexcept {
+    while (true) {
+        std::function<void()> job;
+
+        {
+            /* Lock and wait safely inside scoped block */
+            std::unique_lock<std::mutex> lock(_access);
+            _ready.wait(lock, [this] { 
+                        return this->_exiting || this->pending(); });
+
+            /* Only exit once all the pending works are done */
+            if (!take(job)) {
+                return;
+            }
+        }
+
+        job();
+    }
+}
+
+/* The steady time in ns */
+static uint64_t steady() noexcept {
+    return static_cast<uint64_t>(
+               std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+               .count());
+}
+
+Startup::Phase::State::State() noexcept
+    : access(), completed(), done(false), error(0), name(), elapsed(0) {}
+
+Startup::Phase::Phase() noexcept : _state(std::make_shared<State>()) {
+    _state->done = true;
+}
+
+bool Startup::Phase::ready() const noexcept {
+    std::lock_guard<std::mutex> lock(_state->access);
+    return _state->done;
+}
+
+int Startup::Phase::wait() const noexcept {
+    /* Help the pool as long as the phase is pending, as it may be waiting in
+     * the pool, and only block once there is nothing left to help with */
+    auto &pool = Pool::instance();
+    while ( (!ready()) && (pool.help()) ) {}
+
+    std::unique_lock<std::mutex> lock(_state->access);
+    _state->completed.wait(lock, [this] { return this->_state->done; });
+    return _state->error;
+}
+
+Startup &Startup::instance() noexcept {
+    static Startup startup;
+    return startup;
+}
+
+Startup::Startup() noexcept
+    : _access(), _concurrent(false), _phases(), _ended(), _began(0),
+      _lasted(0) {}
+
+Startup::~Startup() noexcept {
+    /* The phases running in the background shall never outlive the startup */
+    std::vector<Phase> phases;
+    {
+        /* Inside a lock_guard scoped block */
+        std::lock_guard<std::mutex> lock(_access);
+        phases.swap(_phases);
+    }
+
+    for (auto &p : phases) {
+        p.wait();
+    }
+}
+
+void Startup::concurrent(bool yes) noexcept {
+    std::lock_guard<std::mutex> lock(_access);
+    _concurrent = yes;
+}
+
+bool Startup::concurrent() noexcept {
+    std::lock_guard<std::mutex> lock(_access);
+    return _concurrent;
+}
+
+Startup::Phase Startup::run(std::string name, Core::Work setup,
+                            std::vector<Phase> after) noexcept {
+    Phase phase;
+    auto  state = phase._state;
+    state->done = false;
+    state->name = std::move(name);
+
+    auto job = [state, setup, after]() noexcept {
+        int error = 0;
+        for (auto &p : after) {
+            if (error == 0) {
+                error = p.wait();
+            }
+        }
+
+        auto began = steady();
+        if (error == 0) {
+            error = setup();
+        }
+
+        {
+            /* Inside a lock_guard scoped block */
+            std::lock_guard<std::mutex> lock(state->access);
+            state->elapsed = steady() - began;
+            state->error   = error;
+            state->done    = true;
+        }
+        state->completed.notify_all();
+        return error;
+    };
+
+    bool background;
+    {
+        /* Inside a lock_guard scoped block */
+        std::lock_guard<std::mutex> lock(_access);
+        background = _concurrent;
+        if (background) {
+            if (_phases.empty()) {
+                _began = steady();
+            }
+            _phases.push_back(phase);
+        }
+    }
+
+    if (!background) {
+        job();
+    } else if (Pool::instance().size() > 0) {
+        /* The setups are about as urgent as the critical tasks, since no
+         * scene is processed before they are done */
+        Pool::instance().submit(job, Priority::Critical);
+    } else {
+        std::thread(job).detach();
+    }
+
+    return phase;
+}
+
+int Startup::run(Phase &phase, std::string name, Core::Work setup) noexcept {
+    phase.wait();
+    phase = run(std::move(name), std::move(setup));
+    return (phase.ready()) ? phase.wait() : 0;
+}
+
+int Startup::wait() noexcept {
+    std::vector<Phase> phases;
+    uint64_t           began;
+    {
+        /* Inside a lock_guard scoped block */
+        std::lock_guard<std::mutex> lock(_access);
+        phases.swap(_phases);
+        began = _began;
+    }
+
+    if (phases.empty()) {
+        return 0;
+    }
+
+    int error = 0;
+    for (auto &p : phases) {
+        auto e = p.wait();
+        if (error == 0) {
+            error = e;
+        }
+    }
+
+    /* The slowest phases first */
+    std::stable_sort(phases.begin(), phases.end(),
+                     [](const Phase &a, const Phase &b) {
+                         return a._state->elapsed > b._state->elapsed; });
+
+    {
+        /* Inside a lock_guard scoped block */
+        std::lock_guard<std::mutex> lock(_access);
+        _lasted = steady() - began;
+        _ended  = std::move(phases);
+    }
+
+    LOGI("Startup::wait(): %s", summary().c_str());
+
+    return error;
+}
+
+std::string Startup::summary() noexcept {
+    std::lock_guard<std::mutex> lock(_access);
+
+    std::string text;
+    uint64_t    total = 0;
+    char        entry[64];
+    for (auto &p : _ended) {
+        /* The phases are complete, hence no longer written */
+        auto &s = *p._state;
+        snprintf(entry, sizeof(entry), "%.1fms%s",
+                 static_cast<double>(s.elapsed) / 1e6,
+                 (s.error != 0) ? " (failed)" : "");
+        if (!text.empty()) {
+            text += ", ";
+        }
+        text  += s.name + " " + entry;
+        total += s.elapsed;
+    }
+
+    snprintf(entry, sizeof(entry), "%.1fms for %.1fms of setups",
+             static_cast<double>(_lasted) / 1e6,
+             static_cast<double>(total) / 1e6);
+
+    return (text.empty()) ? std::string(entry) : text + ": " + entry;
+}
+
 }  // namespace Task
 }  // namespace Util
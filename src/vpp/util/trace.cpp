@@ -0,0 +1,189 @@
+/**
+ *
+ * @file      vpp/util/trace.cpp
+ *
+ * @brief     This is the timeline trace recorder implementation
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "vpp/util/trace.hpp"
+
+namespace Util {
+namespace Trace {
+
+std::atomic<bool> recording(false);
+
+/* The number of spans recorded per thread, further ones being dropped */
+static constexpr std::size_t CAPACITY = 1 << 16;
+
+namespace {
+
+struct Event {
+    uint64_t    start;
+    uint64_t    duration;
+    const char *category;
+    char        name[40];
+};
+
+/* The events of a single thread, only appended by this very thread and read
+ * up to their published size by the exporter */
+struct Buffer {
+    explicit Buffer(int id) noexcept : tid(id), size(0), events(CAPACITY) {}
+
+    const int                tid;
+    std::atomic<std::size_t> size;
+    std::vector<Event>       events;
+};
+
+class Registry final {
+    public:
+        Registry() noexcept : access(), buffers() {}
+
+        std::shared_ptr<Buffer> attach() noexcept {
+            std::lock_guard<std::mutex> lock(access);
+            buffers.emplace_back(std::make_shared<Buffer>(
+                                    static_cast<int>(buffers.size()) + 1));
+            return buffers.back();
+        }
+
+        std::vector<std::shared_ptr<Buffer>> all() noexcept {
+            std::lock_guard<std::mutex> lock(access);
+            return buffers;
+        }
+
+    private:
+        std::mutex                           access;
+        std::vector<std::shared_ptr<Buffer>> buffers;
+};
+
+Registry &registry() noexcept {
+    static Registry instance;
+    return instance;
+}
+
+Buffer &local() noexcept {
+    /* Buffers outlive their thread, for being exported afterwards */
+    static thread_local std::shared_ptr<Buffer> buffer = registry().attach();
+    return *buffer;
+}
+
+uint64_t now() noexcept {
+    auto t = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    /* A zero start is an unrecorded span */
+    return static_cast<uint64_t>(t) | 1;
+}
+
+void append(const char *category, const char *name, uint64_t start,
+            uint64_t stop) noexcept {
+    auto &b = local();
+    auto n  = b.size.load(std::memory_order_relaxed);
+    if (n >= CAPACITY) {
+        return;
+    }
+
+    auto &e    = b.events[n];
+    e.start    = start;
+    e.duration = stop - start;
+    e.category = category;
+    strncpy(e.name, name, sizeof(e.name) - 1);
+    e.name[sizeof(e.name) - 1] = '\0';
+    b.size.store(n + 1, std::memory_order_release);
+}
+
+void escape(FILE *f, const char *s) noexcept {
+    for (; *s != '\0'; ++s) {
+        if ( (*s == '"') || (*s == '\\') ) {
+            fputc('\\', f);
+            fputc(*s, f);
+        } else if (static_cast<unsigned char>(*s) >= 0x20) {
+            fputc(*s, f);
+        }
+    }
+}
+
+}  // namespace
+
+void enable(bool yes) noexcept {
+    recording.store(yes, std::memory_order_relaxed);
+}
+
+void clear() noexcept {
+    if (enabled()) {
+        return;
+    }
+
+    for (auto &b : registry().all()) {
+        b->size.store(0, std::memory_order_release);
+    }
+}
+
+void Span::begin() noexcept {
+    strncpy(name, label, LENGTH - 1);
+    name[LENGTH - 1] = '\0';
+    start = now();
+}
+
+void Span::end() noexcept {
+    append(category, name, start, now());
+}
+
+void span(const char *category, const char *name, uint64_t since) noexcept {
+    auto stop = now();
+    if ( (enabled()) && (since != 0) && (since < stop) ) {
+        append(category, name, since, stop);
+    }
+}
+
+bool save(const std::string &path) noexcept {
+    FILE *f = fopen(path.c_str(), "w");
+    if (f == nullptr) {
+        return false;
+    }
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", f);
+    bool first = true;
+    for (auto &b : registry().all()) {
+        auto n = b->size.load(std::memory_order_acquire);
+        if (n == 0) {
+            continue;
+        }
+
+        fprintf(f, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                   "\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                first ? "" : ",", b->tid, b->tid);
+        first = false;
+
+        for (std::size_t i = 0; i < n; ++i) {
+            const auto &e = b->events[i];
+            fputs(",\n{\"name\":\"", f);
+            escape(f, e.name);
+            fputs("\",\"cat\":\"", f);
+            escape(f, e.category);
+            fprintf(f, "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                       "\"pid\":1,\"tid\":%d}", e.start / 1e3, 
+                    e.duration / 1e3, b->tid);
+        }
+    }
+    fputs("\n]}\n", f);
+
+    return (fclose(f) == 0);
+}
+
+}  // namespace Trace
+}  // namespace Util
@@ -12,11 +12,17 @@
  *
  **/
 
+#include <algorithm>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/dnn.hpp>
+#include <opencv2/imgproc.hpp>
 #include <chrono>
 #include <ctime>
 #include <vector>
 
 #include "vpp/log.hpp"
+#include "vpp/util/ocv/functions.hpp"
+#include "vpp/util/ocv/pool.hpp"
 #include "vpp/view.hpp"
 
 namespace VPP {
@@ -36,8 +42,11 @@ Error::Type View::Depth::map(const Image &d, const Projecter &p) noexcept {
            "View::Depth::map(): Cannot map a non-depth image of mode %d "
            "as a depth-map!", static_cast<int>(d.mode()));
 
-    depth_map = &d;
-    projecter = &p;
+    depth_map  = &d;
+    projecter  = &p;
+    integrated = nullptr;
+    indexed    = nullptr;
+    measured   = nullptr;
         
     return Error::NONE;
 }
@@ -66,24 +75,110 @@ Error::Type View::Depth::remap(const Image &d, bool force) noexcept {
         }
     }
 
-    depth_map = &d;
+    depth_map  = &d;
+    integrated = nullptr;
+    indexed    = nullptr;
+    measured   = nullptr;
     
     return Error::NONE;
 }
 
-float View::Depth::at(const cv::Point &pix) const noexcept {
+float View::Depth::at(const cv::Point &p) const noexcept {
     /* If there is no depth map and no projection, or if the pixel is outside
      * of the map then there is no depth! */
-    if ((depth_map == nullptr) || (!depth_map->frame().contains(pix)) ) {
+    if (depth_map == nullptr) {
+       return -1;
+    }
+
+    auto pix = projecter->locate(p, depth_map->input());
+    if (!depth_map->frame().contains(pix)) {
        return -1;
     }
 
+    if (filling) {
+        pix = nearest(pix);
+        if (pix.x < 0) {
+            return -1;
+        }
+    }
+
+    const float z = metres().at<float>(pix);
+    return (z > 0) ? z : -1;
+}
+
+const cv::Mat &View::Depth::metres() const noexcept {
+    /* Inside a lock_guard scoped block */
+    std::lock_guard<std::mutex> lock(caching);
+
+    if (measured == depth_map) {
+        return metric;
+    }
+
+    /* A depth map remapped onto the metric one is already converted, and the
+     * previous metric depths are never overwritten as they may be shared */
+    if (depth_map->input().data != metric.data) {
+        cv::Mat converted;
+        Util::OCV::metric(depth_map->input(), projecter->zscale, converted);
+        metric = std::move(converted);
+    }
+    measured = depth_map;
+
+    return metric;
+}
+
+void View::Depth::integrate() const noexcept {
+    std::lock_guard<std::mutex> lock(caching);
+
+    if (integrated == depth_map) {
+        return;
+    }
+
+    /* Invalid depths are zeroed so that they never add up, which is already
+     * the case for unsigned depth maps, but not for floating point ones that
+     * may hold negative or NaN values */
+    const auto &map   = depth_map->input();
+    cv::Mat     valid = (map > 0);
     if (depth_map->mode() == Image::Mode::DEPTHF) {
-        return depth_map->input().at<float>(pix); 
+        cv::Mat zeroed(map.size(), map.type(), cv::Scalar(0));
+        map.copyTo(zeroed, valid);
+        cv::integral(zeroed, sums, CV_64F);
     } else {
-        return static_cast<float>(depth_map->input().at<uint16_t>(pix)) *
-               projecter->zscale; 
+        cv::integral(map, sums, CV_64F);
+    }
+    cv::integral(valid / 255, counts, CV_32S);
+
+    integrated = depth_map;
+}
+
+void View::Depth::index() const noexcept {
+    std::lock_guard<std::mutex> lock(caching);
+
+    if (indexed == depth_map) {
+        return;
     }
+
+    /* The distance transform labels every pixel with its closest valid one,
+     * valid pixels being labelled from 1 in the raster order, which is also
+     * the order in which they are listed */
+    cv::Mat valid = (depth_map->input() > 0);
+    cv::Mat invalid = ~valid;
+    cv::Mat distances;
+    cv::distanceTransform(invalid, distances, labels, cv::DIST_L2,
+                          cv::DIST_MASK_5, cv::DIST_LABEL_PIXEL);
+    cv::findNonZero(valid, valids);
+
+    indexed = depth_map;
+}
+
+cv::Point View::Depth::nearest(const cv::Point &pix) const noexcept {
+    index();
+
+    const auto label = labels.at<int>(pix);
+    if ( (label <= 0) || (label > static_cast<int>(valids.size())) ) {
+        return cv::Point(-1, -1);
+    }
+
+    return valids[label - 1];
 }
 
 float View::Depth::at(const cv::Rect &area) const noexcept {
@@ -92,9 +187,26 @@ float View::Depth::at(const cv::Rect &area) const noexcept {
        return -1;
     }
 
-    const auto &map = depth_map->input()(area & depth_map->frame());
-    auto mask = (map > 0);
-    auto z = static_cast<float>(cv::mean(map, mask)[0]);
+    const auto    &raw = depth_map->input();
+    const cv::Rect located(projecter->locate(area.tl(), raw),
+                           projecter->locate(area.br(), raw));
+    const auto r = located & depth_map->frame();
+    if (r.empty()) {
+        return -1;
+    }
+
+    integrate();
+
+    const int  x0 = r.x, y0 = r.y, x1 = r.x + r.width, y1 = r.y + r.height;
+    const auto n  = counts.at<int>(y1, x1) - counts.at<int>(y0, x1) -
+                    counts.at<int>(y1, x0) + counts.at<int>(y0, x0);
+    if (n <= 0) {
+        return -1;
+    }
+
+    const auto s = sums.at<double>(y1, x1) - sums.at<double>(y0, x1) -
+                   sums.at<double>(y1, x0) + sums.at<double>(y0, x0);
+    auto z = static_cast<float>(s / n);
 
     if (z <= 0) {
         return -1;
@@ -149,17 +261,23 @@ cv::Point3f View::Depth::deproject(const cv::Point &p,
         return deproject(p);
     }
 
-    float z = -1;
-    for (auto n : neighbours) {
-        if (n == 0) {
-            z = at(p);
-        } else {
-            z = at(cv::Rect(p.x-n, p.y-n, 2*n+1, 2*n+1));
-        }
-
-        /* Stop as soon as a valid depth is found */
-        if (z > 0) {
-            break;
+    /* The depth is given by the nearest valid pixel, provided that it lies
+     * within the largest requested neighbourhood */
+    float z = at(p);
+    if (z <= 0) {
+        const int  n   = *std::max_element(neighbours.begin(),
+                                           neighbours.end());
+        const auto &raw = depth_map->input();
+        const auto  pix = projecter->locate(p, raw);
+        if (depth_map->frame().contains(pix)) {
+            const auto near = nearest(pix);
+            const cv::Rect area(projecter->locate(cv::Point(p.x-n, p.y-n),
+                                                  raw),
+                                projecter->locate(cv::Point(p.x+n+1,
+                                                            p.y+n+1), raw));
+            if ( (near.x >= 0) && (area.contains(near)) ) {
+                z = metres().at<float>(near);
+            }
         }
     }
 
@@ -196,44 +314,271 @@ cv::Point View::Depth::project(const cv::Point3f &p) const noexcept {
     return projecter->project(p);
 }
 
+void View::Depth::deproject(const std::vector<cv::Point> &p, float z,
+                            std::vector<cv::Point3f> &points) const noexcept {
+    /* If there is no depth map and no projection, or if the provided z depth
+     * is not valid then projection is only about adding an invalid depth */
+    if ( (projecter == nullptr) || (z <= 0) ) {
+        points.resize(p.size());
+        for (std::size_t i = 0; i < p.size(); ++i) {
+            points[i] = cv::Point3f(p[i].x, p[i].y, -1);
+        }
+        return;
+    }
+
+    projecter->deproject(p, z, points);
+}
+
+void View::Depth::deproject(const std::vector<cv::Point> &p,
+                            const std::vector<float> &z,
+                            std::vector<cv::Point3f> &points) const noexcept {
+    if (projecter != nullptr) {
+        projecter->deproject(p, z, points);
+    } else {
+        points.resize(p.size());
+    }
+
+    /* The invalid depths are only about adding an invalid depth */
+    for (std::size_t i = 0; i < p.size(); ++i) {
+        if ( (projecter == nullptr) || (z[i] <= 0) ) {
+            points[i] = cv::Point3f(p[i].x, p[i].y, -1);
+        }
+    }
+}
+
+cv::Mat View::Depth::cloud(const cv::Rect &area) const noexcept {
+    cv::Mat points;
+
+    if (depth_map == nullptr) {
+        return points;
+    }
+
+    const auto    &raw = depth_map->input();
+    const cv::Rect located(projecter->locate(area.tl(), raw),
+                           projecter->locate(area.br(), raw));
+    const auto r = located & depth_map->frame();
+    if (!r.empty()) {
+        projecter->deproject(metres()(r), r.tl(), points);
+    }
+
+    return points;
+}
+
 std::vector<uint16_t> 
     View::Depth::default_neighbourhood = fallback_neighbourhood; 
 
 
+View::Pyramid::Pyramid(cv::Mat base) noexcept : levels(), building() {
+    levels.emplace_back(std::move(base));
+}
+
+std::size_t View::Pyramid::footprint(Util::OCV::Footprint &f) noexcept {
+    std::lock_guard<std::mutex> lock(building);
+
+    std::size_t bytes = 0;
+    for (std::size_t k = 1; k < levels.size(); ++k) {
+        bytes += f.add(levels[k]);
+    }
+
+    return bytes;
+}
+
+const cv::Mat &View::Pyramid::level(int k) noexcept {
+    std::lock_guard<std::mutex> lock(building);
+
+    /* The levels are stored in a deque for never moving the former ones
+     * when adding new levels */
+    while (static_cast<int>(levels.size()) <= k) {
+        const auto &last = levels.back();
+        const auto  size = last.size() / 2;
+        if (size.area() == 0) {
+            break;
+        }
+
+        cv::Mat scaled = Util::OCV::Pool::mat(size, last.type());
+        cv::resize(last, scaled, size, 0, 0, cv::INTER_AREA);
+        levels.emplace_back(std::move(scaled));
+    }
+
+    return levels[std::min(std::max(k, 0),
+                           static_cast<int>(levels.size()) - 1)];
+}
+
+const cv::Mat &View::Pyramid::fitting(const cv::Size &size) noexcept {
+    int k = 0;
+    for (auto s = level(0).size() / 2;
+         (s.width >= size.width) && (s.height >= size.height) &&
+         (s.area() > 0); s = s / 2) {
+        ++k;
+    }
+
+    return level(k);
+}
+
+View::Crops::Crops(cv::Mat b, const Image::Mode &m, const cv::Size &sz,
+                   const cv::Scalar &f) noexcept
+    : base(std::move(b)), mode(m), size(sz), fill(f), entries(),
+      building() {}
+
+bool View::Crops::of(const Image::Mode &m, const cv::Size &sz,
+                     const cv::Scalar &f) const noexcept {
+    return (mode == m) && (size == sz) && (fill == f);
+}
+
+/* Letterbox an area of an image in a crop (of the crop size) */
+static float letterbox(const cv::Mat &input, const cv::Rect &area,
+                       cv::Mat &crop) noexcept {
+    const auto size = crop.size();
+    int centrex = area.x + area.width / 2;
+    int centrey = area.y + area.height / 2;
+
+    /* Get the scaling factor (no more than 4 !) */
+    float xscale = static_cast<float>(size.width) /
+                   static_cast<float>(std::max(1, area.width));
+    float yscale = static_cast<float>(size.height) /
+                   static_cast<float>(std::max(1, area.height));
+    float scale  = std::min(std::min(xscale, yscale), 4.0f);
+
+    /* Compute the actual area to crop, clipped to the image */
+    int inputw = static_cast<int>(static_cast<float>(size.width) / scale);
+    int inputh = static_cast<int>(static_cast<float>(size.height) / scale);
+    int origw  = std::min(std::min(inputw / 2, centrex),
+                          input.cols - centrex);
+    int origh  = std::min(std::min(inputh / 2, centrey),
+                          input.rows - centrey);
+    if ( (origw <= 0) || (origh <= 0) ) {
+        return scale;
+    }
+
+    cv::Size scaled(static_cast<int>(scale * 2 * origw),
+                    static_cast<int>(scale * 2 * origh));
+    cv::Point at((size.width - scaled.width) / 2,
+                 (size.height - scaled.height) / 2);
+    cv::Rect roi(centrex - origw, centrey - origh, 2 * origw, 2 * origh);
+
+    /* Resizing straight in the middle of the crop */
+    auto inside = crop(cv::Rect(at, scaled));
+    cv::resize(input(roi), inside, scaled, 0, 0, cv::INTER_NEAREST);
+
+    return scale;
+}
+
+std::size_t View::Crops::footprint(Util::OCV::Footprint &f) noexcept {
+    std::lock_guard<std::mutex> lock(building);
+
+    std::size_t bytes = 0;
+    for (auto &e : entries) {
+        bytes += f.add(e.crop.image);
+    }
+
+    return bytes;
+}
+
+std::vector<View::Crops::Crop>
+    View::Crops::of(const std::vector<cv::Rect> &areas) noexcept {
+    std::lock_guard<std::mutex> lock(building);
+
+    /* Find the areas already cropped, and the missing ones */
+    std::vector<Crop>        found(areas.size());
+    std::vector<std::size_t> missing;
+    for (std::size_t i = 0; i < areas.size(); ++i) {
+        auto e = std::find_if(entries.begin(), entries.end(),
+                              [&](const Entry &entry) {
+                                  return entry.area == areas[i]; });
+        if (e != entries.end()) {
+            found[i] = e->crop;
+        } else if (std::find_if(missing.begin(), missing.end(),
+                                [&](std::size_t j) {
+                                    return areas[j] == areas[i]; }) ==
+                   missing.end()) {
+            missing.push_back(i);
+        }
+    }
+
+    if (!missing.empty()) {
+        /* All the missing crops are rows of a single batch buffer */
+        const int n = static_cast<int>(missing.size());
+        cv::Mat batch = Util::OCV::Pool::mat(cv::Size(size.width,
+                                                       size.height * n),
+                                             base.type());
+        batch.setTo(fill);
+
+        std::vector<Crop> built(missing.size());
+        cv::parallel_for_(cv::Range(0, n), [&](const cv::Range &range) {
+            for (int k = range.start; k < range.end; ++k) {
+                auto &c = built[k];
+                c.image = batch.rowRange(k * size.height,
+                                         (k + 1) * size.height);
+                c.scale = letterbox(base, areas[missing[k]], c.image);
+            }
+        });
+
+        for (std::size_t k = 0; k < missing.size(); ++k) {
+            entries.push_back({ areas[missing[k]], built[k] });
+        }
+    }
+
+    /* The duplicated areas as well as the missing ones get their crops */
+    for (std::size_t i = 0; i < areas.size(); ++i) {
+        if (found[i].image.empty()) {
+            for (auto &e : entries) {
+                if (e.area == areas[i]) {
+                    found[i] = e.crop;
+                    break;
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+uint64_t View::now_us() noexcept {
+    auto now = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               now.time_since_epoch()).count();
+}
+
 View::View() noexcept 
-    : depth(), c_bgr(nullptr), c_hsv(nullptr), c_yuv(nullptr), c_ycc(nullptr), 
-      c_gray(nullptr), c_motion(nullptr), boundaries(), images(), ts(0) {}
+    : depth(), mask(), conversions(), converting(), pyramids(), scaling(), 
+      croppings(), cropping(), blobs(), blobbing(), mirrors(), boundaries(),
+      images(), originals(0), ts(0), clocked(0) {}
 
 View::~View() noexcept = default;
 
 View::View(const View& other) noexcept
-    : depth(other.depth), c_bgr(nullptr), c_hsv(nullptr), c_yuv(nullptr),
-      c_ycc(nullptr), c_gray(nullptr), c_motion(nullptr),
-      boundaries(other.boundaries), images(other.images), ts(other.ts) {
-    reshortcut();
+    : depth(other.depth), mask(other.mask), conversions(), converting(),
+      pyramids(), scaling(), croppings(), cropping(), blobs(), blobbing(),
+      mirrors(), boundaries(other.boundaries), images(other.images),
+      originals(other.originals), ts(other.ts), clocked(other.clocked) {
+    remap();
 }
 
 View::View(View&& other) noexcept
-    : depth(std::move(other.depth)), c_bgr(nullptr), c_hsv(nullptr),
-    c_yuv(nullptr), c_ycc(nullptr), c_gray(nullptr), c_motion(nullptr), 
-    boundaries(std::move(other.boundaries)), images(std::move(other.images)), 
-    ts(std::move(other.ts)) {
-    reshortcut();
+    : depth(std::move(other.depth)), mask(std::move(other.mask)),
+      conversions(), converting(), pyramids(), scaling(), croppings(),
+      cropping(), blobs(), blobbing(), mirrors(),
+      boundaries(std::move(other.boundaries)),
+      images(std::move(other.images)), originals(other.originals),
+      ts(std::move(other.ts)), clocked(other.clocked) {
+    remap();
 }
 
 View& View::operator=(const View& other) noexcept {
     if (&other != this) {
         depth      = Depth(other.depth);
-        c_bgr      = nullptr;
-        c_hsv      = nullptr;
-        c_yuv      = nullptr;
-        c_ycc      = nullptr;
-        c_gray     = nullptr;
-        c_motion   = nullptr;
+        mask       = other.mask;
+        conversions.clear();
+        pyramids.clear();
+        croppings.clear();
+        blobs.clear();
+        mirrors.clear();
         boundaries = other.boundaries;
         images     = other.images;
+        originals  = other.originals;
         ts         = other.ts;
-        reshortcut();
+        clocked    = other.clocked;
+        remap();
     }
 
     return *this;
@@ -242,23 +587,25 @@ View& View::operator=(const View& other) noexcept {
 View& View::operator=(View&& other) noexcept {
     if (&other != this) {
         depth      = Depth(std::move(other.depth));
-        c_bgr      = nullptr;
-        c_hsv      = nullptr;
-        c_yuv      = nullptr;
-        c_ycc      = nullptr;
-        c_gray     = nullptr;
-        c_motion   = nullptr;
+        mask       = std::move(other.mask);
+        conversions.clear();
+        pyramids.clear();
+        croppings.clear();
+        blobs.clear();
+        mirrors.clear();
         boundaries = std::move(other.boundaries);
         images     = std::move(other.images);
+        originals  = other.originals;
         ts         = std::move(other.ts);
-        reshortcut();
+        clocked    = other.clocked;
+        remap();
     }
 
     return *this;
 }
 
 Error::Type View::use(cv::Mat data, Image::Mode mode) noexcept {
-    ASSERT(mode.is_colour() || mode.is_motion(),
+    ASSERT(mode.is_colour() || mode.is_motion() || mode.is_native(),
            "View::Use::use(): Expecting a colour or motion image but got a "
            "mode %d image instead!", static_cast<int>(mode));
 
@@ -270,17 +617,23 @@ Error::Type View::use(cv::Mat data, Image::Mode mode) noexcept {
         ts = now_ms.time_since_epoch().count();
     }
 
+    /* And the capture time as well, for the latencies */
+    if (clocked == 0) {
+        clocked = now_us();
+    }
+
     /* If there is already one such matrix, then we have a problem */
-    auto it = images.find(mode);
-    if (it != images.end()) {
-        ASSERT((cv::sum(data != it->second.input()) == 
+    auto found = cached(mode);
+    if (found != nullptr) {
+        ASSERT((cv::sum(data != found->input()) == 
                 cv::Scalar(0, 0, 0)),
                 "View::use(): Changing the colour image of mode %d with a "
                 "different one!", static_cast<int>(mode));
             return Error::INVALID_REQUEST;
     }
     
-    if ((mode.is_colour()) && (cached_colour() != nullptr)) {
+    if ((mode.is_colour() || mode.is_native()) && 
+        (cached_colour() != nullptr)) {
         ASSERT( false,
                 "View::use(): Changing the original colour image of mode %d "
                 "with a new one of mode %d!", 
@@ -296,14 +649,9 @@ Error::Type View::use(cv::Mat data, Image::Mode mode) noexcept {
         return Error::INVALID_REQUEST;
     }
 
-    auto p = images.emplace(std::piecewise_construct,
-                            std::forward_as_tuple(mode), 
-                            std::forward_as_tuple(std::move(data), 
-                                                  std::move(mode)));
-    
-    auto &i = p.first->second;
-    shortcut(i.mode(), &i);
-    if (mode.is_colour()) {
+    auto &i = store(Image(std::move(data), mode));
+    originals |= mode;
+    if (mode.is_colour() || mode.is_native()) {
         boundaries = i.frame();
     }
 
@@ -324,9 +672,9 @@ Error::Type View::use(cv::Mat data, Image::Mode mode,
            "instead!", static_cast<int>(mode));
 
     /* If there is already one such matrix, then we have a problem */
-    auto it = images.find(mode);
-    if (it != images.end()) {
-        ASSERT((cv::sum(data != it->second.input()) == cv::Scalar(0)),
+    auto found = cached(mode);
+    if (found != nullptr) {
+        ASSERT((cv::sum(data != found->input()) == cv::Scalar(0)),
                 "View::use(): Changing the depth image of mode %d with a "
                 "different one!", static_cast<int>(mode));
             return Error::INVALID_REQUEST;
@@ -341,13 +689,9 @@ Error::Type View::use(cv::Mat data, Image::Mode mode,
         return Error::INVALID_REQUEST;
     }
 
-    auto p = images.emplace(std::piecewise_construct,
-                            std::forward_as_tuple(mode), 
-                            std::forward_as_tuple(std::move(data), 
-                                                  std::move(mode)));
-
     /* Map this depth image in the depth object */
-    auto &i = p.first->second;
+    auto &i = store(Image(std::move(data), mode));
+    originals |= mode;
     depth.map(i, pd);
 
     return Error::NONE;
@@ -355,9 +699,9 @@ Error::Type View::use(cv::Mat data, Image::Mode mode,
 
 const Image *View::cached(Image::Mode mode) const noexcept {
     /* If there is already one such image, then use it directly! */
-    const auto it = images.find(mode);
-    if (it != images.end()) {
-        return &it->second;
+    const auto i = slot(mode);
+    if ( (i >= 0) && (images[i].mode() == mode) ) {
+        return &images[i];
     }
     
     return nullptr;
@@ -365,52 +709,62 @@ const Image *View::cached(Image::Mode mode) const noexcept {
 
 Image *View::cached(Image::Mode mode) noexcept {
     /* If there is already one such image, then use it directly! */
-    auto it = images.find(mode);
-    if (it != images.end()) {
-        return &it->second;
+    const auto i = slot(mode);
+    if ( (i >= 0) && (images[i].mode() == mode) ) {
+        return &images[i];
     }
     
     return nullptr;
 }
 
 Image *View::cached_colour() noexcept {
-    if (c_bgr != nullptr) {
-        return c_bgr;
-    }
-    if (c_hsv != nullptr) {
-        return c_hsv;
-    }
-    if (c_yuv != nullptr) {
-        return c_yuv;
+    for (auto m : { Image::Mode::BGR, Image::Mode::HSV, Image::Mode::YUV,
+                    Image::Mode::YCrCb, Image::Mode::NV12, Image::Mode::NV21,
+                    Image::Mode::I420 }) {
+        auto im = cached(m);
+        if (im != nullptr) {
+            return im;
+        }
     }
-    if (c_ycc != nullptr) {
-        return c_ycc;
+
+    return nullptr;
+}
+
+Image *View::cached_native() noexcept {
+    for (auto m : { Image::Mode::NV12, Image::Mode::NV21,
+                    Image::Mode::I420 }) {
+        auto im = cached(m);
+        if (im != nullptr) {
+            return im;
+        }
     }
 
     return nullptr;
 }
 
 Image *View::cached_depth() noexcept {
-    Image *depth = nullptr;
-    for (auto &p : images) {
-            auto &i = p.second;
-            if (i.mode().is_depth()) {
-                depth = &i;
-                if (i.mode() == Image::Mode::DEPTHF) {
-                    return depth;
-                }
-            }
+    auto d = cached(Image::Mode::DEPTHF);
+    if (d != nullptr) {
+        return d;
     }
 
-    return depth;
+    return cached(Image::Mode::DEPTH16);
 }
 
 Image *View::cached_motion() noexcept {
-    if (c_motion != nullptr) {
-        return c_motion;
+    return cached(Image::Mode::MOTION);
+}
+
+Image &View::store(Image image) noexcept {
+    const auto i = slot(image.mode());
+    if (i < 0) {
+        ASSERT(false, "View::store(): Cannot store an image of mode %d!",
+               static_cast<int>(image.mode()));
+        return Image::INVALID;
     }
 
-    return nullptr;
+    images[i] = std::move(image);
+    return images[i];
 }
 
 Image View::image(const Image::Mode &mode, const cv::Rect &roi) noexcept {
@@ -425,21 +779,36 @@ Image View::image(const Image::Mode &mode, const cv::Rect &roi) noexcept {
     if (mode.is_depth()) {
         auto d = cached_depth();
         if (d != nullptr) {
+            /* The metric depths are shared with the depth lookups */
+            if ( (mode == Image::Mode::DEPTHF) && (depth.maps(*d)) ) {
+                return Image(depth.metres()(roi & d->frame()), mode);
+            }
             return Image(*d, mode, roi, depth.scaler(d->mode(), mode));
         }
         ASSERT(false, "View::image(): Requesting a depth image but none is "
                       "available!"); 
     } else {
 
-        /* Used the images bgr if available */
-        if (c_bgr != nullptr) {
-            return Image(*c_bgr, mode, roi);
-        }
-
-        /* Otherwise, generate the bgr sub image for generating the output */
+        /* Used the images bgr if available, otherwise, generate the bgr sub
+         * image for generating the output, unless the output can directly be
+         * translated. In any case reuse any matching latest conversion */
         auto im = cached_colour();
         if (im != nullptr) {
-            return Image(Image(*im, Image::Mode::BGR, roi), mode);
+            const auto area   = roi & boundaries;
+            const auto source = im->input().data;
+            Image      out;
+            if (converted(mode, area, source, out)) {
+                return out;
+            }
+
+            if (im->translatable(mode)) {
+                out = Image(*im, mode, area);
+            } else {
+                out = Image(Image(*im, Image::Mode::BGR, area), mode);
+            }
+            convert(mode, area, source, out);
+
+            return out;
         }
         ASSERT(false, "View::image(): Requesting a colour image but none is "
                       "available!");
@@ -448,10 +817,53 @@ Image View::image(const Image::Mode &mode, const cv::Rect &roi) noexcept {
     return Image::INVALID;
 }
 
+/* Number of converted regions of interest kept in a view */
+static const std::size_t max_conversions = 8;
+
+bool View::converted(int mode, const cv::Rect &area, const uchar *source,
+                     Image &image) noexcept {
+    std::lock_guard<std::mutex> lock(converting);
+
+    for (auto it = conversions.begin(); it != conversions.end(); ++it) {
+        /* Conversions from any former source image are obsolete */
+        if (it->source != source) {
+            conversions.clear();
+            return false;
+        }
+
+        if ( (it->mode == mode) && ((it->area & area) == area) ) {
+            if (it->area == area) {
+                image = it->image;
+            } else {
+                image = it->image(area - it->area.tl());
+            }
+            conversions.splice(conversions.begin(), conversions, it);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void View::convert(int mode, const cv::Rect &area, const uchar *source,
+                   const Image &image) noexcept {
+    if (area.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(converting);
+
+    conversions.push_front(Converted{ mode, area, source, image });
+    if (conversions.size() > max_conversions) {
+        conversions.pop_back();
+    }
+}
+
 #define GENERATE_ROI_SHORTCUT(n,M) \
 Image View::n(const cv::Rect &roi) noexcept { \
-    if (c_##n != nullptr) {\
-        return (*c_##n)(roi);\
+    auto im = cached(Image::Mode::M);\
+    if (im != nullptr) {\
+        return (*im)(roi);\
     }\
 \
     return image(Image::Mode::M, roi);\
@@ -468,8 +880,9 @@ Image &View::image(const Image::Mode &mode) noexcept {
 
 #define GENERATE_SHORTCUT(n,M) \
 Image &View::n() noexcept { \
-    if (c_##n != nullptr) {\
-        return *c_##n;\
+    auto im = cached(Image::Mode::M);\
+    if (im != nullptr) {\
+        return *im;\
     }\
 \
     return image(Image::Mode::M);\
@@ -491,87 +904,286 @@ Image &View::cache(const Image::Mode &mode) noexcept {
     if (mode.is_depth()) {
         auto d = cached_depth();
         if (d != nullptr) {
-            auto scale = depth.scaler(d->mode(), mode);
-            auto p = images.emplace(std::piecewise_construct,
-                                    std::forward_as_tuple(mode), 
-                                    std::forward_as_tuple(*im, mode,
-                                                          scale));
-            auto &d = p.first->second;
-            depth.remap(d, true);
-            return d;
+            /* The metric depths of the depth lookups are stored as is */
+            if ( (mode == Image::Mode::DEPTHF) && (depth.maps(*d)) ) {
+                auto &map = store(Image(depth.metres(), mode));
+                depth.remap(map, true);
+                return map;
+            }
+            auto  scale = depth.scaler(d->mode(), mode);
+            auto &map   = store(Image(*d, mode, scale));
+            depth.remap(map, true);
+            return map;
         }
         ASSERT(false, "View::cache(): Requesting a depth image but none is "
                       "available!"); 
     } else {
 
-        /* Use the BGR images (or generate it if not available) */
-        if (c_bgr == nullptr) {
+        /* Use the BGR images (or generate it if not available), unless the
+         * requested image is directly translated from a native one, such as
+         * the gray image of a semi-planar image */
+        auto bgr    = cached(Image::Mode::BGR);
+        auto native = cached_native();
+        if ( (bgr == nullptr) && (native != nullptr) &&
+             (native->translatable(mode)) ) {
+            return store(Image(*native, mode));
+        }
+
+        if (bgr == nullptr) {
             auto im = cached_colour();
             if (im != nullptr) {
-                auto m = Image::Mode(Image::Mode::BGR);
-                auto p = images.emplace(std::piecewise_construct,
-                                        std::forward_as_tuple(m), 
-                                        std::forward_as_tuple(*im, 
-                                                              std::move(m)));
-                c_bgr = &p.first->second;
+                bgr = &store(Image(*im, Image::Mode::BGR));
             }
         }
 
-        if (c_bgr == nullptr) {
+        if (bgr == nullptr) {
             ASSERT(false, "View::image(): Requesting a colour image but "
                           "none is available!");
             return Image::INVALID;
         }
 
         /* Otherwise, cache the requested image generated from the bgr */
-        auto p = images.emplace(std::piecewise_construct,
-                                std::forward_as_tuple(mode), 
-                                std::forward_as_tuple(*c_bgr, mode));
-        auto &im = p.first->second;
-        shortcut(im.mode(), &im);
-
-        return im;
+        return store(Image(*bgr, mode));
     }
             
     return Image::INVALID;
 }
 
-void View::shortcut(Image::Mode m, Image *i) noexcept {
-    switch(m) {
-        case Image::Mode::BGR:
-            c_bgr = i;
-            break;
-        case Image::Mode::HSV:
-            c_hsv = i;
-            break;
-        case Image::Mode::YUV:
-            c_yuv = i;
-            break;
-        case Image::Mode::YCrCb:
-            c_ycc = i;
-            break;
-        case Image::Mode::GRAY:
-            c_gray = i;
-            break;
-        case Image::Mode::MOTION:
-            c_motion = i;
-            break;
-        default:
-            ASSERT(false, "View::shortcut(): Invalid shortcut requested "
-                          "for image mode %d", static_cast<int>(m));
-            break;
+void View::release(const Image::Mode &mode) noexcept {
+    if ( (mode.is_depth()) || (mode.is_motion()) ||
+         ((originals & mode) != 0) ) {
+        return;
+    }
+
+    const auto i = slot(mode);
+    if ( (i >= 0) && (images[i].mode() == mode) ) {
+        images[i] = Image();
+    }
+    mirrors.erase(mode);
+
+    /* Inside a lock_guard scoped block */
+    {
+        std::lock_guard<std::mutex> lock(converting);
+        conversions.remove_if([&mode](const Converted &c) noexcept {
+                                  return c.mode == mode; });
+    }
+
+    /* Inside a lock_guard scoped block */
+    {
+        std::lock_guard<std::mutex> lock(scaling);
+        pyramids.erase(mode);
+    }
+
+    /* Inside a lock_guard scoped block */
+    {
+        std::lock_guard<std::mutex> lock(cropping);
+        croppings.erase(std::remove_if(croppings.begin(), croppings.end(),
+                                       [&mode](const std::unique_ptr<Crops> &c)
+                                           noexcept { return c->of(mode); }),
+                        croppings.end());
     }
+
+    std::lock_guard<std::mutex> lock(blobbing);
+    blobs.erase(std::remove_if(blobs.begin(), blobs.end(),
+                               [&mode](const Blob &b) noexcept {
+                                   return b.mode == mode; }),
+                blobs.end());
 }
-    
-void View::reshortcut() noexcept {
-    for (auto &p : images) {
-            auto &i = p.second;
-            if (i.mode().is_colour() || i.mode().is_gray() || 
-                i.mode().is_motion()) {
-                shortcut(i.mode(), &i);
+
+View::Pyramid &View::pyramid(const Image::Mode &mode) noexcept {
+    std::lock_guard<std::mutex> lock(scaling);
+
+    auto &p = pyramids[mode];
+    if (p == nullptr) {
+        p.reset(new Pyramid(cache(mode).input()));
+    }
+
+    return *p;
+}
+
+View::Crops &View::crops(const Image::Mode &mode, const cv::Size &size,
+                         const cv::Scalar &fill) noexcept {
+    std::lock_guard<std::mutex> lock(cropping);
+
+    for (auto &c : croppings) {
+        if (c->of(mode, size, fill)) {
+            return *c;
+        }
+    }
+
+    croppings.emplace_back(new Crops(cache(mode).input(), mode, size, fill));
+    return *croppings.back();
+}
+
+cv::Mat View::blob(const Image::Mode &mode, const cv::Size &size,
+                   double scale, const cv::Scalar &mean, bool swap) noexcept {
+    /* The lock is held while building, for the networks wanting the same
+     * blob to wait for it instead of building it again */
+    std::lock_guard<std::mutex> lock(blobbing);
+
+    for (auto const &b : blobs) {
+        if ( (b.mode == mode) && (b.size == size) && (b.scale == scale) &&
+             (b.mean == mean) && (b.swap == swap) ) {
+            return b.data;
+        }
+    }
+
+    const auto &fitting = pyramid(mode).fitting(size);
+    Blob b{ mode, size, scale, mean, swap, cv::Mat() };
+    cv::dnn::blobFromImage(fitting, b.data, scale, size, mean, swap, false);
+    blobs.emplace_back(b);
+
+    return b.data;
+}
+
+std::size_t View::footprint(Util::OCV::Footprint &f) noexcept {
+    std::size_t bytes = 0;
+    for (auto &i : images) {
+        bytes += i.footprint(f);
+    }
+
+    /* Inside a lock_guard scoped block */
+    {
+        std::lock_guard<std::mutex> lock(converting);
+        for (auto &c : conversions) {
+            bytes += c.image.footprint(f);
+        }
+    }
+
+    /* Inside a lock_guard scoped block */
+    {
+        std::lock_guard<std::mutex> lock(scaling);
+        for (auto &p : pyramids) {
+            bytes += p.second->footprint(f);
+        }
+    }
+
+    /* Inside a lock_guard scoped block */
+    {
+        std::lock_guard<std::mutex> lock(cropping);
+        for (auto &c : croppings) {
+            bytes += c->footprint(f);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(blobbing);
+    for (auto &b : blobs) {
+        bytes += f.add(b.data);
+    }
+
+    return bytes;
+}
+
+const cv::UMat &View::device(const Image::Mode &mode) noexcept {
+    /* Images cached on the host are mirrored as they are */
+    auto im = cached(mode);
+    if (im != nullptr) {
+        return im->device();
+    }
+
+    auto &mirror = mirrors[mode];
+    if (!mirror.empty()) {
+        return mirror;
+    }
+
+    if (mode.is_depth()) {
+        auto d = cached_depth();
+        if (d != nullptr) {
+            d->to(mode, mirror, depth.scaler(d->mode(), mode));
+        }
+        return mirror;
+    }
+
+    /* Translate the colour image on the device if possible, otherwise go
+     * through the BGR image on the device */
+    im = cached_colour();
+    if (im == nullptr) {
+        ASSERT(false, "View::device(): Requesting a colour image but none is "
+                      "available!");
+        return mirror;
+    }
+
+    if (im->translatable(mode)) {
+        im->to(mode, mirror);
+    } else {
+        const auto &bgr = device(Image::Mode::BGR);
+        cv::cvtColor(bgr, mirror, Image::conversion(Image::Mode::BGR, mode));
+    }
+
+    return mirror;
+}
+
+/* Size of the bands of BGR rows converted at once, for them to stay in the
+ * processor cache for all the conversions */
+static const int band_size = 64 * 1024;
+
+Error::Type View::prefetch(const std::vector<Image::Mode> &modes) noexcept {
+    std::vector<Image::Mode> fused;
+    std::vector<int>         codes;
+
+    /* Modes that are already cached, translated from a native image or not
+     * converted from a BGR image are simply cached one by one */
+    for (auto &m : modes) {
+        if (cached(m) != nullptr) {
+            continue;
+        }
+        if ( ((cached(Image::Mode::BGR) == nullptr) &&
+              (cached_native() != nullptr) &&
+              (cached_native()->translatable(m))) ||
+             (Image::conversion(Image::Mode::BGR, m) < 0) ) {
+            if (cache(m).mode() != m) {
+                return Error::INVALID_REQUEST;
             }
+            continue;
+        }
+        if (std::find(fused.begin(), fused.end(), m) == fused.end()) {
+            fused.push_back(m);
+            codes.push_back(Image::conversion(Image::Mode::BGR, m));
+        }
     }
 
+    if (fused.empty()) {
+        return Error::NONE;
+    }
+
+    const auto &bgr = this->bgr();
+    if (bgr.mode() != Image::Mode::BGR) {
+        return Error::INVALID_REQUEST;
+    }
+
+    const auto &in = bgr.input();
+    std::vector<cv::Mat> out(fused.size());
+    for (std::size_t i = 0; i < fused.size(); ++i) {
+        out[i] = Util::OCV::Pool::mat(in.size(),
+                                      CV_8UC(fused[i].channels()));
+    }
+
+    /* Convert the bands in parallel, each band being converted in all modes
+     * whilst it is still in the cache */
+    const int rows  = std::max(1, band_size / 
+                                  std::max(1, static_cast<int>(in.step[0])));
+    const int bands = (in.rows + rows - 1) / rows;
+    cv::parallel_for_(cv::Range(0, bands), [&](const cv::Range &range) {
+        for (int b = range.start; b < range.end; ++b) {
+            const int  r0   = b * rows;
+            const int  r1   = std::min(in.rows, r0 + rows);
+            const auto band = in.rowRange(r0, r1);
+            for (std::size_t i = 0; i < out.size(); ++i) {
+                auto dst = out[i].rowRange(r0, r1);
+                cv::cvtColor(band, dst, codes[i]);
+            }
+        }
+    });
+
+    for (std::size_t i = 0; i < fused.size(); ++i) {
+        store(Image(std::move(out[i]), fused[i]));
+    }
+
+    return Error::NONE;
+}
+
+void View::remap() noexcept {
+    /* The depth object shall use the depth map of this view */
     auto d = cached_depth();
     if (d != nullptr) {
         depth.remap(*d);
@@ -0,0 +1,128 @@
+/**
+ *
+ * @file      vpp/wire.cpp
+ *
+ * @brief     This is the VPP scene wire format implementation file
+ *
+ *            This file is part of the VPP framework (see link).
+ *
+ * @author    Olivier Stoltz-Douchet <ezdayo@gmail.com>
+ *
+ * @copyright (c) 2019-2020 Olivier Stoltz-Douchet
+ * @license   http://opensource.org/licenses/MIT MIT
+ * @link      https://github.com/ezdayo/vpp
+ *
+ **/
+
+#include <cstring>
+
+#include "vpp/wire.hpp"
+
+namespace VPP {
+namespace Wire {
+
+/* The variable-size data are aligned on 8 bytes */
+static inline std::size_t aligned(std::size_t size) {
+    return (size + 7) & ~static_cast<std::size_t>(7);
+}
+
+static inline void convert(const Prediction &p, Score &s) noexcept {
+    s.score   = p.score;
+    s.dataset = p.dataset;
+    s.id      = p.id;
+}
+
+void Writer::write(const Scene &scene, uint16_t fields) noexcept {
+    auto zones = scene.zones();
+    const bool contours     = (fields & Field::CONTOURS) != 0;
+    const bool descriptions = (fields & Field::DESCRIPTIONS) != 0;
+
+    /* Size the message at once, the buffer keeping its former capacity */
+    std::size_t size = sizeof(Header) + zones.size() * sizeof(Record);
+    for (auto &z : zones) {
+        const VPP::Zone &zone = z;
+        if (contours) {
+            size += aligned(zone.contour.size() * sizeof(cv::Point));
+        }
+        if (descriptions) {
+            size += aligned(zone.description.size());
+        }
+    }
+    buffer.resize(size);
+
+    auto base   = buffer.data();
+    auto header = reinterpret_cast<Header *>(base);
+    header->magic   = MAGIC;
+    header->version = VERSION;
+    header->fields  = fields;
+    header->ts      = scene.ts_ms();
+    header->count   = static_cast<uint32_t>(zones.size());
+    header->size    = static_cast<uint32_t>(size);
+
+    auto record = reinterpret_cast<Record *>(base + sizeof(Header));
+    std::size_t offset = sizeof(Header) + zones.size() * sizeof(Record);
+    for (auto &z : zones) {
+        const VPP::Zone &zone = z;
+        std::memset(record, 0, sizeof(Record));
+        record->uuid   = zone.uuid;
+        record->x      = zone.x;
+        record->y      = zone.y;
+        record->width  = zone.width;
+        record->height = zone.height;
+        std::memcpy(record->state, zone.state.data(), sizeof(record->state));
+        convert(zone.context, record->context);
+
+        for (auto const &p : zone.predictions) {
+            convert(p, record->predictions[record->ranked++]);
+        }
+
+        if ( (contours) && (!zone.contour.empty()) ) {
+            auto bytes = zone.contour.size() * sizeof(cv::Point);
+            std::memcpy(base + offset, zone.contour.data(), bytes);
+            record->contour = static_cast<uint32_t>(offset);
+            record->points  = static_cast<uint32_t>(zone.contour.size());
+            offset         += aligned(bytes);
+        }
+
+        if ( (descriptions) && (!zone.description.empty()) ) {
+            auto bytes = zone.description.size();
+            std::memcpy(base + offset, zone.description.data(), bytes);
+            record->description = static_cast<uint32_t>(offset);
+            record->length      = static_cast<uint32_t>(bytes);
+            offset             += aligned(bytes);
+        }
+
+        ++record;
+    }
+}
+
+Reader::Reader(const void *data, std::size_t size) noexcept
+    : base(static_cast<const uint8_t *>(data)),
+      header(static_cast<const Header *>(data)),
+      records(reinterpret_cast<const Record *>(base + sizeof(Header))),
+      consistent(false) {
+    if ( (data == nullptr) || (size < sizeof(Header)) ||
+         (header->magic != MAGIC) || (header->version != VERSION) ||
+         (header->size > size) ||
+         (sizeof(Header) + static_cast<std::size_t>(header->count) *
+                           sizeof(Record) > header->size) ) {
+        return;
+    }
+
+    /* Check once that all the offsets lie within the message */
+    const std::size_t end = header->size;
+    for (uint32_t i = 0; i < header->count; ++i) {
+        auto &r = records[i];
+        if ( (r.ranked > Predictions::capacity) ||
+             (r.contour + static_cast<std::size_t>(r.points) *
+                          sizeof(cv::Point) > end) ||
+             (r.description + static_cast<std::size_t>(r.length) > end) ) {
+            return;
+        }
+    }
+
+    consistent = true;
+}
+
+}  // namespace Wire
+}  // namespace VPP
@@ -25,64 +25,53 @@ namespace VPP {
 
 void Zone::Copy::Geometry(Zone& out, const Zone &in) noexcept {
     out.state       = in.state;
+    out.deprojected = in.deprojected;
 }
 
 void Zone::Copy::AllButContour(Zone& out, const Zone &in) noexcept {
     out.state       = in.state;
+    out.deprojected = in.deprojected;
     out.predictions = in.predictions;
+    out.labels      = in.labels;
     out.description = in.description;
 }
 
 void Zone::Copy::All(Zone& out, const Zone &in) noexcept {
     out.state       = in.state;
+    out.deprojected = in.deprojected;
     out.contour     = in.contour;
     out.predictions = in.predictions;
+    out.labels      = in.labels;
     out.description = in.description;
 }
 
+Zone::Copier Zone::Copy::Simplified(double epsilon) noexcept {
+    return [epsilon](Zone& out, const Zone &in) noexcept {
+        All(out, in);
+        out.contour = in.contour.simplified(epsilon); };
+}
+
 Zone &Zone::predict(Prediction pred, float recall_f) noexcept {
     if (predictions.empty()) {
-        predictions.emplace_front(std::move(pred)); 
+        predictions.insert(pred); 
         context = predictions.front();
         return *this;
     } 
     
-    std::list<Prediction> preds;
-    preds.emplace_front(std::move(pred));
-    return predict(std::move(preds), recall_f);
+    return predict(Predictions({ pred }), recall_f);
 }
 
 /* Add a forgetting factor ? */
-Zone &Zone::predict(std::list<Prediction> preds, float recall_f) noexcept {
+Zone &Zone::predict(const Predictions &preds, float recall_f) noexcept {
     if (! preds.empty()) {
-
+        /* Merging keeps the predictions sorted, with the higher score of
+         * each GID */
         if (!predictions.empty()) {
-            /* Create a map of previously existing predictions (there is only
-             * one entry at most per GID */
-            std::unordered_map<int32_t, Prediction *> existing;
-            for (auto &p : predictions) {
-                p.score *= recall_f;
-                existing.emplace(p.gid(), &p);
-            }
-
-            /* Append new predictions or update the old one if the new one is
-             * higher than the old one */
-            for (auto &p : preds) {
-                auto found = existing.find(p.gid());
-                if (found != existing.end()) {
-                    auto &o = *found->second;
-                    if (p.score > o.score) {
-                        o.score = p.score;
-                    }
-                } else {
-                    predictions.push_back(p);
-                }
-            }
+            predictions.merge(preds, recall_f);
         } else {
-            predictions = std::move(preds);
+            predictions = preds;
         }
 
-        predictions.sort(std::greater<Prediction>());
         if ( (context.id < 0) && (!predictions.empty()) ) {
             context = predictions.front();
         }
@@ -97,9 +86,16 @@ void Zone::project(const View &view) noexcept {
     auto size     = state.size;
     cv::Point3f c = centre;
     cv::Point3f s(size.x/2, size.y/2, 0);
-            
-    auto tl       = view.depth.project(c-s);
-    auto br       = view.depth.project(c+s);
+
+    /* Flat states are already in pixels */
+    cv::Point tl, br;
+    if (deprojected) {
+        tl = view.depth.project(c-s);
+        br = view.depth.project(c+s);
+    } else {
+        tl = cv::Point(c.x-s.x, c.y-s.y);
+        br = cv::Point(c.x+s.x, c.y+s.y);
+    }
     auto geom     = br - tl;
 
     x             = tl.x;
@@ -109,16 +105,42 @@ void Zone::project(const View &view) noexcept {
 }
 
 void Zone::deproject(const View &view) noexcept {
+    /* Without any depth, the flat state is the deprojected one */
+    if (!view.depth.available()) {
+        flatten();
+        return;
+    }
+
     /* Update the state from the zone */
     auto z = view.depth.at((cv::Rect::tl()+cv::Rect::br())/2);
 
-    auto tl = view.depth.deproject(cv::Rect::tl(), z);
-    auto br = view.depth.deproject(cv::Rect::br(), z);
-    auto sz = br-tl;
+    std::vector<cv::Point3f> corners;
+    view.depth.deproject({ cv::Rect::tl(), cv::Rect::br() }, z, corners);
+
+    const auto &tl = corners[0];
+    const auto &br = corners[1];
+    auto        sz = br-tl;
 
     state.centre = (tl+br)/2;
     state.size.x = sz.x;
     state.size.y = sz.y;
+    deprojected  = true;
+}
+
+void Zone::flatten() noexcept {
+    /* As deprojected without any depth: in pixels with an invalid depth */
+    const cv::Point3f tl(cv::Rect::x, cv::Rect::y, -1);
+    const cv::Point3f br(cv::Rect::x + cv::Rect::width,
+                         cv::Rect::y + cv::Rect::height, -1);
+
+    state.centre = (tl+br)/2;
+    state.size.x = br.x-tl.x;
+    state.size.y = br.y-tl.y;
+    deprojected  = false;
+}
+
+cv::Mat Zone::cloud(const View &view) const noexcept {
+    return view.depth.cloud(*this);
 }
 
 Zone &Zone::update(Zone &older, float recall_f) noexcept {
@@ -138,6 +160,7 @@ Zone &Zone::update(Zone &older, float recall_f) noexcept {
     older.predict(predictions, recall_f);
     predictions = std::move(older.predictions);
     context = std::move(older.context);
+    labels.merge(older.labels);
 
     /* Keep older description if newer does not have any! */
     if (description.empty()) {
@@ -156,6 +179,7 @@ Zone &Zone::merge(const Zone &zone) noexcept {
         contour = zone.contour;
     }
     predict(zone.predictions);
+    labels.merge(zone.labels);
     if ((description.empty()) && (!zone.description.empty())) {
         description = zone.description;
     }